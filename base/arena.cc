@@ -71,6 +71,16 @@ void UnsafeArena::Reset() {
   status_.bytes_allocated_ = 0;
 }
 
+void UnsafeArena::Recycle() {
+  if (blocks_.empty() || blocks_.front().size > block_size_) {
+    Reset();
+    return;
+  }
+  blocks_.erase(blocks_.begin() + 1, blocks_.end());
+  blocks_.front().used = 0;
+  status_.bytes_allocated_ = blocks_.front().size;
+}
+
 void UnsafeArena::Reserve(size_t additional_space) {
   if (blocks_.empty()) {
     AllocBlock(std::max(additional_space, block_size_));
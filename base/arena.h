@@ -49,6 +49,10 @@ class NET_EXPORT_PRIVATE UnsafeArena {
 
   void Reset();
 
+  // Like Reset(), but keeps the first block for later allocations, unless it
+  // is larger than the block size given to the constructor.
+  void Recycle();
+
   Status status() const { return status_; }
 
  private:
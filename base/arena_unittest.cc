@@ -63,6 +63,25 @@ TEST(UnsafeArenaTest, UseAfterReset) {
   EXPECT_EQ(StringPiece(c, length), kTestString);
 }
 
+TEST(UnsafeArenaTest, Recycle) {
+  UnsafeArena arena(40 /* block size */);
+  char* c1 = arena.Alloc(30);
+  arena.Alloc(30);
+  EXPECT_EQ(80u, arena.status().bytes_allocated());
+  // The first block is kept, and handed out again from its start.
+  arena.Recycle();
+  EXPECT_EQ(40u, arena.status().bytes_allocated());
+  char* c2 = arena.Memdup(kTestString, 10);
+  EXPECT_EQ(c1, c2);
+  EXPECT_EQ(StringPiece(c2, 10), StringPiece(kTestString, 10));
+
+  // An oversized first block is not kept.
+  arena.Reset();
+  arena.Alloc(100);
+  arena.Recycle();
+  EXPECT_EQ(0u, arena.status().bytes_allocated());
+}
+
 TEST(UnsafeArenaTest, Free) {
   UnsafeArena arena(kDefaultBlockSize);
   const size_t length = strlen(kTestString);
@@ -744,6 +744,11 @@ NET_ERROR(CACHE_LOCK_TIMEOUT, -409)
 // credentials aren't available.  There isn't a way to get them at that point.
 NET_ERROR(CACHE_AUTH_FAILURE_AFTER_READ, -410)
 
+// The disk cache declined to create an entry because its admission filter
+// expects the entry to be used less often than the entries it would displace.
+// The HttpCache goes on without caching the response.
+NET_ERROR(CACHE_ENTRY_NOT_ADMITTED, -411)
+
 // The server's response was insecure (e.g. there was a cert error).
 NET_ERROR(INSECURE_RESPONSE, -501)
 
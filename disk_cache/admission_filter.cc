@@ -0,0 +1,121 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/admission_filter.h"
+
+#include <algorithm>
+
+#include "base/bits.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/trace_event/memory_usage_estimator.h"
+
+namespace disk_cache {
+
+const base::Feature kDiskCacheAdmissionFilter = {
+    "DiskCacheAdmissionFilter", base::FEATURE_DISABLED_BY_DEFAULT};
+
+namespace {
+
+// The number of rows of counters. Each row lowers the odds that a rare key
+// shares all its counters with popular ones.
+const int kDepth = 4;
+
+// Odd constants which scramble a hash differently for each row.
+const uint64_t kRowSeeds[kDepth] = {
+    UINT64_C(0xc3a5c85c97cb3127), UINT64_C(0xb492b66fbe98f273),
+    UINT64_C(0x9ae16a3b2f90404f), UINT64_C(0xcbf29ce484222325)};
+
+// Counters stop at this value; after that, a key is simply popular.
+const uint8_t kMaxCount = 15;
+
+// The counters are halved after this many increments per counter in a row, as
+// suggested by the TinyLFU paper.
+const size_t kSampleSizeMultiplier = 10;
+
+const int kMinWidthBits = 8;
+const int kMaxWidthBits = 24;
+
+// Used to guess how many entries a cache holds from its size. HTTP cache
+// entries are mostly small, with a long tail of large ones.
+const int64_t kAverageEntrySize = 32 * 1024;
+
+}  // namespace
+
+AdmissionFilter::AdmissionFilter(size_t expected_entries) : additions_(0) {
+  const uint32_t entries = static_cast<uint32_t>(
+      std::min<size_t>(expected_entries, 1u << kMaxWidthBits));
+  width_bits_ = std::max(kMinWidthBits, base::bits::Log2Ceiling(entries));
+  counters_.resize(kDepth << width_bits_);
+  sample_size_ = kSampleSizeMultiplier << width_bits_;
+}
+
+AdmissionFilter::~AdmissionFilter() {}
+
+// static
+std::unique_ptr<AdmissionFilter> AdmissionFilter::MaybeCreate(
+    net::CacheType cache_type,
+    int64_t max_bytes) {
+  if (!base::FeatureList::IsEnabled(kDiskCacheAdmissionFilter))
+    return nullptr;
+  // Only the HTTP cache can do without an entry it tries to create.
+  if (cache_type != net::DISK_CACHE && cache_type != net::MEMORY_CACHE &&
+      cache_type != net::MEDIA_CACHE) {
+    return nullptr;
+  }
+  const int64_t expected_entries = max_bytes / kAverageEntrySize;
+  return base::MakeUnique<AdmissionFilter>(
+      static_cast<size_t>(std::max<int64_t>(expected_entries, 0)));
+}
+
+void AdmissionFilter::RecordAccess(uint64_t hash) {
+  size_t indices[kDepth];
+  uint8_t min_count = kMaxCount;
+  for (int row = 0; row < kDepth; ++row) {
+    indices[row] = GetCounterIndex(hash, row);
+    min_count = std::min(min_count, counters_[indices[row]]);
+  }
+  if (min_count == kMaxCount)
+    return;
+
+  // Only raise the smallest counters, which are the ones that decide the
+  // estimate. The others are already too high because of other keys.
+  for (int row = 0; row < kDepth; ++row) {
+    if (counters_[indices[row]] == min_count)
+      ++counters_[indices[row]];
+  }
+  if (++additions_ >= sample_size_)
+    Age();
+}
+
+int AdmissionFilter::EstimateFrequency(uint64_t hash) const {
+  uint8_t min_count = kMaxCount;
+  for (int row = 0; row < kDepth; ++row)
+    min_count = std::min(min_count, counters_[GetCounterIndex(hash, row)]);
+  return min_count;
+}
+
+bool AdmissionFilter::ShouldAdmit(uint64_t candidate_hash,
+                                  uint64_t victim_hash) const {
+  return EstimateFrequency(candidate_hash) > EstimateFrequency(victim_hash);
+}
+
+size_t AdmissionFilter::EstimateMemoryUsage() const {
+  return base::trace_event::EstimateMemoryUsage(counters_);
+}
+
+size_t AdmissionFilter::GetCounterIndex(uint64_t hash, int row) const {
+  // The top bits of a multiplicative hash are the well mixed ones.
+  const uint64_t mixed = (hash + kRowSeeds[row]) * kRowSeeds[row];
+  return (static_cast<size_t>(row) << width_bits_) +
+         static_cast<size_t>(mixed >> (64 - width_bits_));
+}
+
+void AdmissionFilter::Age() {
+  for (uint8_t& counter : counters_)
+    counter >>= 1;
+  additions_ /= 2;
+}
+
+}  // namespace disk_cache
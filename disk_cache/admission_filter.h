@@ -0,0 +1,84 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_ADMISSION_FILTER_H_
+#define NET_DISK_CACHE_ADMISSION_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/feature_list.h"
+#include "base/macros.h"
+#include "net/base/cache_type.h"
+#include "net/base/net_export.h"
+
+namespace disk_cache {
+
+// When enabled, the backends only create an entry once the cache is full if
+// its key has been looked up more often than the entry it would displace; see
+// AdmissionFilter. Rejected entries fail to be created with
+// net::ERR_CACHE_ENTRY_NOT_ADMITTED.
+NET_EXPORT_PRIVATE extern const base::Feature kDiskCacheAdmissionFilter;
+
+// A TinyLFU admission policy. It keeps an approximate count of how often each
+// key hash has been looked up recently, in a count-min sketch: a few rows of
+// small counters, each row indexed by a different hash of the key, where the
+// estimate for a key is its smallest counter. Every so many lookups all the
+// counters are halved, so that keys which were popular a long time ago don't
+// keep their advantage.
+//
+// A full cache has to evict an entry to admit a new one. Admitting the new
+// entry only if it is looked up more often than the eviction candidate keeps
+// a stream of keys which are used once from flushing out the entries which are
+// used over and over. Not thread safe.
+class NET_EXPORT_PRIVATE AdmissionFilter {
+ public:
+  // |expected_entries| is roughly the number of entries the cache holds.
+  explicit AdmissionFilter(size_t expected_entries);
+  ~AdmissionFilter();
+
+  // Returns a filter sized for a cache of |max_bytes|, or null if
+  // kDiskCacheAdmissionFilter is disabled or |cache_type| is not one of the
+  // HTTP cache types.
+  static std::unique_ptr<AdmissionFilter> MaybeCreate(net::CacheType cache_type,
+                                                      int64_t max_bytes);
+
+  // Records a lookup of the key with |hash|.
+  void RecordAccess(uint64_t hash);
+
+  // Returns the estimated number of recent lookups of the key with |hash|.
+  // This is never lower than the real number, up to the maximum count.
+  int EstimateFrequency(uint64_t hash) const;
+
+  // Returns true if the entry with |candidate_hash| should replace the one
+  // with |victim_hash|.
+  bool ShouldAdmit(uint64_t candidate_hash, uint64_t victim_hash) const;
+
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  // Returns the index in |counters_| of the counter for |hash| in |row|.
+  size_t GetCounterIndex(uint64_t hash, int row) const;
+
+  // Halves all the counters.
+  void Age();
+
+  // kDepth rows of 2^|width_bits_| counters.
+  std::vector<uint8_t> counters_;
+  int width_bits_;
+
+  // The number of increments since the counters were last halved, and how
+  // many make them be halved again.
+  size_t additions_;
+  size_t sample_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(AdmissionFilter);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_ADMISSION_FILTER_H_
@@ -0,0 +1,62 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/admission_filter.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+TEST(AdmissionFilterTest, CountsLookups) {
+  AdmissionFilter filter(1000);
+  EXPECT_EQ(0, filter.EstimateFrequency(1));
+
+  filter.RecordAccess(1);
+  filter.RecordAccess(1);
+  filter.RecordAccess(1);
+  filter.RecordAccess(2);
+  EXPECT_EQ(3, filter.EstimateFrequency(1));
+  EXPECT_EQ(1, filter.EstimateFrequency(2));
+  EXPECT_EQ(0, filter.EstimateFrequency(3));
+}
+
+TEST(AdmissionFilterTest, ShouldAdmit) {
+  AdmissionFilter filter(1000);
+  const uint64_t kPopular = 0x123456789abcdef0;
+  const uint64_t kRare = 0x0fedcba987654321;
+  filter.RecordAccess(kPopular);
+  filter.RecordAccess(kPopular);
+  filter.RecordAccess(kRare);
+
+  EXPECT_TRUE(filter.ShouldAdmit(kPopular, kRare));
+  EXPECT_FALSE(filter.ShouldAdmit(kRare, kPopular));
+  // Ties go to the entry already in the cache.
+  EXPECT_FALSE(filter.ShouldAdmit(kRare, kRare));
+}
+
+TEST(AdmissionFilterTest, Saturates) {
+  AdmissionFilter filter(1000);
+  for (int i = 0; i < 100; ++i)
+    filter.RecordAccess(1);
+  EXPECT_EQ(15, filter.EstimateFrequency(1));
+}
+
+// Old lookups count for less and less as new ones come in.
+TEST(AdmissionFilterTest, Ages) {
+  AdmissionFilter filter(256);
+  for (int i = 0; i < 8; ++i)
+    filter.RecordAccess(1);
+  EXPECT_EQ(8, filter.EstimateFrequency(1));
+
+  // Enough lookups of other keys to halve the counters a few times.
+  for (uint64_t hash = 2; hash < 100000; ++hash)
+    filter.RecordAccess(hash * 0x9e3779b97f4a7c15);
+  EXPECT_GT(8, filter.EstimateFrequency(1));
+}
+
+}  // namespace
+
+}  // namespace disk_cache
@@ -14,6 +14,7 @@
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/test/mock_entropy_provider.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_restrictions.h"
@@ -23,6 +24,7 @@
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
 #include "net/disk_cache/blockfile/entry_impl.h"
 #include "net/disk_cache/blockfile/experiments.h"
@@ -34,7 +36,9 @@
 #include "net/disk_cache/memory/mem_backend_impl.h"
 #include "net/disk_cache/simple/simple_backend_impl.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
+#include "net/disk_cache/simple/simple_experiment.h"
 #include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_packed_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_test_util.h"
 #include "net/disk_cache/simple/simple_util.h"
@@ -110,6 +114,7 @@ class DiskCacheBackendTest : public DiskCacheTestWithCache {
   void BackendShutdownWithPendingIO(bool fast);
   void BackendShutdownWithPendingCreate(bool fast);
   void BackendShutdownWithPendingDoom();
+  void BackendAdmissionFilter();
   void BackendSetSize();
   void BackendLoad();
   void BackendChain();
@@ -3128,6 +3133,132 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyUseAfterFree) {
                                                 net::CompletionCallback()));
 }
 
+// Entries which have been read survive a stream of entries which are only
+// written, as long as they fit in the protected segment of the LRU.
+TEST_F(DiskCacheBackendTest, MemoryOnlySegmentedEviction) {
+  SetMemoryOnlyMode();
+
+  const int kMaxSize = 200 * 1024;
+  const int kMaxEntryCount = 20;
+  const int kWriteSize = kMaxSize / kMaxEntryCount;
+
+  SetMaxSize(kMaxSize);
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kWriteSize));
+  CacheTestFillBuffer(buffer->data(), kWriteSize, false);
+
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry("read", &entry), IsOk());
+  EXPECT_EQ(kWriteSize,
+            WriteData(entry, 1, 0, buffer.get(), kWriteSize, false));
+  EXPECT_EQ(kWriteSize, ReadData(entry, 1, 0, buffer.get(), kWriteSize));
+  entry->Close();
+
+  ASSERT_THAT(CreateEntry("not read", &entry), IsOk());
+  EXPECT_EQ(kWriteSize,
+            WriteData(entry, 1, 0, buffer.get(), kWriteSize, false));
+  entry->Close();
+
+  std::string key_prefix("prefix");
+  for (int i = 0; i < kMaxEntryCount * 2; ++i) {
+    AddDelay();
+    ASSERT_THAT(CreateEntry(key_prefix + base::IntToString(i), &entry),
+                IsOk());
+    EXPECT_EQ(kWriteSize,
+              WriteData(entry, 1, 0, buffer.get(), kWriteSize, false));
+    entry->Close();
+  }
+  EXPECT_GT(kMaxSize, CalculateSizeOfAllEntries());
+
+  ASSERT_THAT(OpenEntry("read", &entry), IsOk());
+  entry->Close();
+  EXPECT_NE(net::OK, OpenEntry("not read", &entry));
+
+  disk_cache::StatsItems stats;
+  cache_->GetStats(&stats);
+  disk_cache::StatsItems::value_type protected_size(
+      "Protected size", base::IntToString(kWriteSize + 4));
+  EXPECT_EQ(1, std::count(stats.begin(), stats.end(), protected_size));
+}
+
+// Once the cache is full, a key gets an entry only if it has been looked up
+// more often than the entry eviction would remove.
+void DiskCacheBackendTest::BackendAdmissionFilter() {
+  const int kWriteSize = 1024;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kWriteSize));
+  CacheTestFillBuffer(buffer->data(), kWriteSize, false);
+
+  // Like the HttpCache, look up each key before creating its entry.
+  disk_cache::Entry* entry;
+  EXPECT_NE(net::OK, OpenEntry("first", &entry));
+  ASSERT_THAT(CreateEntry("first", &entry), IsOk());
+  EXPECT_EQ(kWriteSize,
+            WriteData(entry, 1, 0, buffer.get(), kWriteSize, false));
+  entry->Close();
+
+  if (simple_cache_mode_) {
+    // The Simple cache is full once it is past 90% of its maximum size, and
+    // evicts past 95%. Make "first" fill it to about 93%.
+    disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+    base::RunLoop().RunUntilIdle();
+    uint64_t cache_size = simple_cache_impl_->index()->GetCacheSize();
+    ASSERT_LT(0u, cache_size);
+    SetMaxSize(static_cast<int>(cache_size * 100 / 93));
+  }
+
+  // "second" has been looked up only as often as "first".
+  EXPECT_NE(net::OK, OpenEntry("second", &entry));
+  EXPECT_EQ(net::ERR_CACHE_ENTRY_NOT_ADMITTED, CreateEntry("second", &entry));
+
+  EXPECT_NE(net::OK, OpenEntry("second", &entry));
+  ASSERT_THAT(CreateEntry("second", &entry), IsOk());
+  EXPECT_EQ(2, cache_->GetEntryCount());
+  entry->Close();
+}
+
+// The blockfile cache is full, as far as eviction goes, once it holds any data
+// at all if its maximum size is below its 1 MB eviction margin.
+TEST_F(DiskCacheBackendTest, AdmissionFilter) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kDiskCacheAdmissionFilter);
+  SetMaxSize(200 * 1024);
+  InitCache();
+  BackendAdmissionFilter();
+}
+
+TEST_F(DiskCacheBackendTest, NewEvictionAdmissionFilter) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kDiskCacheAdmissionFilter);
+  SetNewEviction();
+  SetMaxSize(200 * 1024);
+  InitCache();
+  BackendAdmissionFilter();
+}
+
+// The memory cache is so small that any entry in it makes it full, as far as
+// eviction goes.
+TEST_F(DiskCacheBackendTest, MemoryOnlyAdmissionFilter) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kDiskCacheAdmissionFilter);
+  SetMemoryOnlyMode();
+  SetMaxSize(200 * 1024);
+  InitCache();
+  BackendAdmissionFilter();
+}
+
+TEST_F(DiskCacheBackendTest, SimpleCacheAdmissionFilter) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kDiskCacheAdmissionFilter);
+  SetSimpleCacheMode();
+  InitCache();
+  BackendAdmissionFilter();
+}
+
 TEST_F(DiskCacheTest, Backend_UsageStatsTimer) {
   MessageLoopHelper helper;
 
@@ -3935,3 +4066,92 @@ TEST_F(DiskCacheBackendTest, SimpleCacheLateDoom) {
   EXPECT_EQ(disk_cache::SimpleIndex::INITIALIZE_METHOD_LOADED,
             simple_cache_impl_->index()->init_method());
 }
+
+// Small entries are kept in the packed store, and entries that outgrow it are
+// moved to files of their own.
+TEST_F(DiskCacheBackendTest, SimpleCachePackedStorage) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimplePackedStorage);
+  SetSimpleCacheMode();
+  InitCache();
+
+  const int kSmallSize = 100;
+  const int kLargeSize = disk_cache::SimplePackedStore::kMaxEntrySize * 2;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kLargeSize));
+  CacheTestFillBuffer(buffer->data(), kLargeSize, false);
+
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry("small", &entry), IsOk());
+  EXPECT_EQ(kSmallSize,
+            WriteData(entry, 1, 0, buffer.get(), kSmallSize, true));
+  entry->Close();
+
+  // This entry starts out small, then grows.
+  ASSERT_THAT(CreateEntry("large", &entry), IsOk());
+  EXPECT_EQ(kSmallSize,
+            WriteData(entry, 1, 0, buffer.get(), kSmallSize, true));
+  EXPECT_EQ(kLargeSize,
+            WriteData(entry, 1, 0, buffer.get(), kLargeSize, true));
+  entry->Close();
+
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(base::PathExists(cache_path_.AppendASCII(
+      disk_cache::simple_util::GetFilenameFromKeyAndFileIndex("small", 0))));
+  EXPECT_TRUE(base::PathExists(cache_path_.AppendASCII(
+      disk_cache::simple_util::GetFilenameFromKeyAndFileIndex("large", 0))));
+
+  cache_.reset();
+  DisableFirstCleanup();
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kLargeSize));
+  ASSERT_THAT(OpenEntry("small", &entry), IsOk());
+  EXPECT_EQ(kSmallSize, entry->GetDataSize(1));
+  EXPECT_EQ(kSmallSize, ReadData(entry, 1, 0, read_buffer.get(), kSmallSize));
+  EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), kSmallSize));
+  entry->Close();
+
+  ASSERT_THAT(OpenEntry("large", &entry), IsOk());
+  EXPECT_EQ(kLargeSize, entry->GetDataSize(1));
+  EXPECT_EQ(kLargeSize, ReadData(entry, 1, 0, read_buffer.get(), kLargeSize));
+  EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), kLargeSize));
+  entry->Close();
+
+  // Dooming a packed entry removes it for good.
+  ASSERT_THAT(DoomEntry("small"), IsOk());
+  EXPECT_NE(net::OK, OpenEntry("small", &entry));
+}
+
+// Zero-length writes to a packed entry, which may pass a NULL buffer, still
+// extend or truncate the stream.
+TEST_F(DiskCacheBackendTest, SimpleCachePackedStorageZeroLengthWrite) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimplePackedStorage);
+  SetSimpleCacheMode();
+  InitCache();
+
+  const int kSize = 100;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry("key", &entry), IsOk());
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer.get(), kSize, true));
+  EXPECT_EQ(0, WriteData(entry, 1, 1000, NULL, 0, false));
+  EXPECT_EQ(1000, entry->GetDataSize(1));
+  EXPECT_EQ(0, WriteData(entry, 1, 50, NULL, 0, true));
+  EXPECT_EQ(50, entry->GetDataSize(1));
+  entry->Close();
+
+  cache_.reset();
+  DisableFirstCleanup();
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kSize));
+  ASSERT_THAT(OpenEntry("key", &entry), IsOk());
+  EXPECT_EQ(50, entry->GetDataSize(1));
+  EXPECT_EQ(50, ReadData(entry, 1, 0, read_buffer.get(), kSize));
+  EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), 50));
+  entry->Close();
+}
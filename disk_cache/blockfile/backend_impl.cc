@@ -34,6 +34,7 @@
 #include "net/disk_cache/blockfile/file.h"
 #include "net/disk_cache/blockfile/histogram_macros.h"
 #include "net/disk_cache/blockfile/webfonts_histogram.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/cache_util.h"
 
 // Provide a BackendImpl object to macros from histogram_macros.h.
@@ -114,6 +115,9 @@ void FinalCleanupCallback(disk_cache::BackendImpl* backend) {
 
 namespace disk_cache {
 
+const base::Feature kBlockfileConcurrentReads = {
+    "BlockfileConcurrentReads", base::FEATURE_DISABLED_BY_DEFAULT};
+
 BackendImpl::BackendImpl(
     const base::FilePath& path,
     const scoped_refptr<base::SingleThreadTaskRunner>& cache_thread,
@@ -124,6 +128,7 @@ BackendImpl::BackendImpl(
       mask_(0),
       max_size_(0),
       up_ticks_(0),
+      doom_count_(0),
       cache_type_(net::DISK_CACHE),
       uma_report_(0),
       user_flags_(0),
@@ -135,6 +140,8 @@ BackendImpl::BackendImpl(
       new_eviction_(false),
       first_timer_(true),
       user_load_(false),
+      concurrent_reads_(
+          base::FeatureList::IsEnabled(kBlockfileConcurrentReads)),
       net_log_(net_log),
       done_(base::WaitableEvent::ResetPolicy::MANUAL,
             base::WaitableEvent::InitialState::NOT_SIGNALED),
@@ -151,6 +158,7 @@ BackendImpl::BackendImpl(
       mask_(mask),
       max_size_(0),
       up_ticks_(0),
+      doom_count_(0),
       cache_type_(net::DISK_CACHE),
       uma_report_(0),
       user_flags_(kMask),
@@ -162,6 +170,8 @@ BackendImpl::BackendImpl(
       new_eviction_(false),
       first_timer_(true),
       user_load_(false),
+      concurrent_reads_(
+          base::FeatureList::IsEnabled(kBlockfileConcurrentReads)),
       net_log_(net_log),
       done_(base::WaitableEvent::ResetPolicy::MANUAL,
             base::WaitableEvent::InitialState::NOT_SIGNALED),
@@ -269,6 +279,7 @@ int BackendImpl::SyncInit() {
     DCHECK(!new_eviction_);
   }
 
+  admission_filter_ = AdmissionFilter::MaybeCreate(cache_type(), max_size_);
   eviction_.Init(this);
 
   // stats_ and rankings_ may end up calling back to us so we better be enabled.
@@ -335,6 +346,8 @@ void BackendImpl::CleanupCache() {
 int BackendImpl::SyncOpenEntry(const std::string& key,
                                scoped_refptr<EntryImpl>* entry) {
   DCHECK(entry);
+  if (admission_filter_)
+    admission_filter_->RecordAccess(base::Hash(key));
   *entry = OpenEntryImpl(key);
   return (*entry) ? net::OK : net::ERR_FAILED;
 }
@@ -342,6 +355,8 @@ int BackendImpl::SyncOpenEntry(const std::string& key,
 int BackendImpl::SyncCreateEntry(const std::string& key,
                                  scoped_refptr<EntryImpl>* entry) {
   DCHECK(entry);
+  if (!disabled_ && !eviction_.ShouldAdmit(base::Hash(key)))
+    return net::ERR_CACHE_ENTRY_NOT_ADMITTED;
   *entry = CreateEntryImpl(key);
   return (*entry) ? net::OK : net::ERR_FAILED;
 }
@@ -804,6 +819,7 @@ void BackendImpl::InternalDoomEntry(EntryImpl* entry) {
 
   if (!entry->doomed()) {
     // We may have doomed this entry from within MatchEntry.
+    doom_count_++;
     eviction_.OnDoomEntry(entry);
     entry->InternalDoom();
     if (!new_eviction_) {
@@ -1481,6 +1497,7 @@ void BackendImpl::RestartCache(bool failure) {
   int64_t last_report = stats_.GetCounter(Stats::LAST_REPORT);
 
   PrepareForRestart();
+  doom_count_++;
   if (failure) {
     DCHECK(!num_refs_);
     DCHECK(open_entries_.empty());
@@ -9,8 +9,10 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <unordered_map>
 
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/macros.h"
 #include "base/memory/ref_counted.h"
@@ -35,6 +37,7 @@ class NetLog;
 
 namespace disk_cache {
 
+class AdmissionFilter;
 struct Index;
 
 enum BackendFlags {
@@ -49,6 +52,10 @@ enum BackendFlags {
   kNoBuffering = 1 << 7         // Disable extended IO buffering.
 };
 
+// Lets the reads of entry data stored in external files that are already open
+// run on worker threads instead of waiting for the cache thread.
+NET_EXPORT_PRIVATE extern const base::Feature kBlockfileConcurrentReads;
+
 // This class implements the Backend interface. An object of this
 // class handles the operations of the cache for a particular profile.
 class NET_EXPORT_PRIVATE BackendImpl : public Backend {
@@ -160,6 +167,15 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   // Returns the maximum size for a file to reside on the cache.
   int MaxFileSize() const;
 
+  // Returns a number which changes whenever an entry may have been removed from
+  // the cache, so that what is known about entries can be dropped.
+  int64_t doom_count() const { return doom_count_; }
+
+  // Called when the data of an entry is evicted without dooming the entry.
+  void OnEntryDataEvicted() { doom_count_++; }
+
+  bool concurrent_reads() const { return concurrent_reads_; }
+
   // A user data block is being created, extended or truncated.
   void ModifyStorageSize(int32_t old_size, int32_t new_size);
 
@@ -394,6 +410,7 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   int byte_count_;  // Number of bytes read/written lately.
   int buffer_bytes_;  // Total size of the temporary entries' buffers.
   int up_ticks_;  // The number of timer ticks received (OnStatsTimer).
+  int64_t doom_count_;  // The number of entries doomed or evicted, or restarts.
   net::CacheType cache_type_;
   int uma_report_;  // Controls transmission of UMA data.
   uint32_t user_flags_;  // Flags set by the user.
@@ -405,6 +422,10 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   bool new_eviction_;  // What eviction algorithm should be used.
   bool first_timer_;  // True if the timer has not been called.
   bool user_load_;  // True if we see a high load coming from the caller.
+  bool concurrent_reads_;  // True if kBlockfileConcurrentReads is enabled.
+
+  // Null unless kDiskCacheAdmissionFilter is enabled. Consulted by |eviction_|.
+  std::unique_ptr<AdmissionFilter> admission_filter_;
 
   net::NetLog* net_log_;
 
@@ -6,10 +6,12 @@
 
 #include <limits>
 
+#include "base/bind.h"
 #include "base/hash.h"
 #include "base/macros.h"
 #include "base/message_loop/message_loop.h"
 #include "base/strings/string_util.h"
+#include "base/task_scheduler/post_task.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
@@ -305,10 +307,12 @@ bool EntryImpl::UserBuffer::GrowBuffer(int required, int limit) {
 EntryImpl::EntryImpl(BackendImpl* backend, Addr address, bool read_only)
     : entry_(NULL, Addr(0)), node_(NULL, Addr(0)),
       backend_(backend->GetWeakPtr()), doomed_(false), read_only_(read_only),
-      dirty_(false) {
+      dirty_(false), concurrent_reads_(false), concurrent_reads_in_flight_(0),
+      pending_writes_(0), close_pending_(false) {
   entry_.LazyInit(backend->File(address), address);
   for (int i = 0; i < kNumStreams; i++) {
     unreported_size_[i] = 0;
+    concurrent_read_sizes_[i] = 0;
   }
 }
 
@@ -346,8 +350,9 @@ int EntryImpl::WriteDataImpl(int index, int offset, IOBuffer* buf, int buf_len,
         CreateNetLogReadWriteDataCallback(index, offset, buf_len, truncate));
   }
 
-  int result = InternalWriteData(index, offset, buf, buf_len, callback,
-                                 truncate);
+  int result =
+      InternalWriteData(index, offset, buf, buf_len, callback, truncate);
+  UpdateConcurrentReadFile(index);
 
   if (result != net::ERR_IO_PENDING && net_log_.IsCapturing()) {
     net_log_.EndEvent(net::NetLogEventType::ENTRY_WRITE_DATA,
@@ -408,6 +413,15 @@ int EntryImpl::ReadyForSparseIOImpl(const CompletionCallback& callback) {
   return sparse_->ReadyToUse(callback);
 }
 
+void EntryImpl::OnConcurrentReadImpl(int bytes_read) {
+  if (!backend_.get())
+    return;
+
+  UpdateRank(false);
+  backend_->OnEvent(Stats::READ_DATA);
+  backend_->OnRead(bytes_read);
+}
+
 uint32_t EntryImpl::GetHash() {
   return entry_.Data()->hash;
 }
@@ -498,6 +512,7 @@ void EntryImpl::DeleteEntryData(bool everything) {
       entry_.Data()->data_addr[index] = 0;
       entry_.Data()->data_size[index] = 0;
       entry_.Store();
+      UpdateConcurrentReadFile(index);
       DeleteData(address, index);
     }
   }
@@ -693,6 +708,7 @@ void EntryImpl::DecrementIoCount() {
 void EntryImpl::OnEntryCreated(BackendImpl* backend) {
   // Just grab a reference to the backround queue.
   background_queue_ = backend->GetBackgroundQueue();
+  concurrent_reads_ = backend->concurrent_reads();
 }
 
 void EntryImpl::SetTimes(base::Time last_used, base::Time last_modified) {
@@ -764,6 +780,11 @@ void EntryImpl::Doom() {
 }
 
 void EntryImpl::Close() {
+  if (concurrent_reads_in_flight_ || pending_writes_) {
+    // The cache thread may not release this entry before those are done.
+    close_pending_ = true;
+    return;
+  }
   if (background_queue_.get())
     background_queue_->CloseEntryImpl(this);
 }
@@ -837,6 +858,27 @@ int EntryImpl::ReadData(int index, int offset, IOBuffer* buf, int buf_len,
   if (!background_queue_.get())
     return net::ERR_UNEXPECTED;
 
+  if (!deferred_operations_.empty()) {
+    // A write issued before this read is waiting for concurrent reads.
+    deferred_operations_.push_back(base::Bind(
+        &InFlightBackendIO::ReadData, background_queue_, base::Unretained(this),
+        index, offset, base::RetainedRef(buf), buf_len, callback));
+    return net::ERR_IO_PENDING;
+  }
+
+  if (concurrent_reads_ && !pending_writes_ && !net_log_.IsCapturing() &&
+      CanReadConcurrently(index)) {
+    concurrent_reads_in_flight_++;
+    base::PostTaskWithTraitsAndReplyWithResult(
+        FROM_HERE, base::TaskTraits().MayBlock().WithPriority(
+                       base::TaskPriority::USER_BLOCKING),
+        base::Bind(&EntryImpl::ConcurrentReadData, base::Unretained(this),
+                   index, offset, base::RetainedRef(buf), buf_len),
+        base::Bind(&EntryImpl::OnConcurrentReadDone, base::Unretained(this),
+                   index, offset, make_scoped_refptr(buf), buf_len, callback));
+    return net::ERR_IO_PENDING;
+  }
+
   background_queue_->ReadData(this, index, offset, buf, buf_len, callback);
   return net::ERR_IO_PENDING;
 }
@@ -856,6 +898,27 @@ int EntryImpl::WriteData(int index, int offset, IOBuffer* buf, int buf_len,
   if (!background_queue_.get())
     return net::ERR_UNEXPECTED;
 
+  if (concurrent_reads_) {
+    // Reads issued after this write should see its data, so they must not
+    // bypass the cache thread until it is done.
+    pending_writes_++;
+    CompletionCallback write_callback = base::Bind(
+        &EntryImpl::OnWriteDataDone, base::Unretained(this), callback);
+    if (concurrent_reads_in_flight_) {
+      // Reads issued before this write must not see its data, so it waits
+      // for them to finish before it goes to the cache thread.
+      deferred_operations_.push_back(
+          base::Bind(&InFlightBackendIO::WriteData, background_queue_,
+                     base::Unretained(this), index, offset,
+                     base::RetainedRef(buf), buf_len, truncate,
+                     write_callback));
+      return net::ERR_IO_PENDING;
+    }
+    background_queue_->WriteData(this, index, offset, buf, buf_len, truncate,
+                                 write_callback);
+    return net::ERR_IO_PENDING;
+  }
+
   background_queue_->WriteData(this, index, offset, buf, buf_len, truncate,
                                callback);
   return net::ERR_IO_PENDING;
@@ -986,6 +1049,116 @@ EntryImpl::~EntryImpl() {
 
 // ------------------------------------------------------------------------
 
+bool EntryImpl::CanReadConcurrently(int index) {
+  base::subtle::AutoReadLock lock(data_lock_);
+  return concurrent_read_files_[index].get() != NULL;
+}
+
+// Runs on a worker thread. The entry itself stays alive because Close() waits
+// for this read, but the cache thread may be changing it, and the backend may
+// be gone, so only the state published by UpdateConcurrentReadFile() is used.
+int EntryImpl::ConcurrentReadData(int index,
+                                  int offset,
+                                  IOBuffer* buf,
+                                  int buf_len) {
+  scoped_refptr<File> file;
+  int entry_size;
+  {
+    // The file is read without the lock, so that the cache thread never waits
+    // for the disk. Holding a reference keeps it open even if the cache thread
+    // lets go of it meanwhile.
+    base::subtle::AutoReadLock lock(data_lock_);
+    file = concurrent_read_files_[index];
+    entry_size = concurrent_read_sizes_[index];
+  }
+  if (!file)
+    return net::ERR_IO_PENDING;
+
+  if (offset >= entry_size)
+    return 0;
+  if (offset + buf_len > entry_size)
+    buf_len = entry_size - offset;
+
+  if (!file->Read(buf->data(), buf_len, offset))
+    return net::ERR_CACHE_READ_FAILURE;
+  return buf_len;
+}
+
+void EntryImpl::OnConcurrentReadDone(int index,
+                                     int offset,
+                                     scoped_refptr<IOBuffer> buf,
+                                     int buf_len,
+                                     const CompletionCallback& callback,
+                                     int result) {
+  DCHECK_GT(concurrent_reads_in_flight_, 0);
+  concurrent_reads_in_flight_--;
+  bool retry = false;
+  if (background_queue_.get()) {
+    if (result < 0) {
+      // Let the cache thread do the read, and deal with any error. Operations
+      // issued after this read are still deferred, so they stay behind it.
+      background_queue_->ReadData(this, index, offset, buf.get(), buf_len,
+                                  callback);
+      retry = true;
+    } else {
+      background_queue_->OnConcurrentRead(this, result);
+    }
+  }
+  if (!concurrent_reads_in_flight_)
+    RunDeferredOperations();
+  MaybeCloseDeferred();
+  if (!retry)
+    callback.Run(result);
+}
+
+void EntryImpl::OnWriteDataDone(const CompletionCallback& callback,
+                                int result) {
+  DCHECK_GT(pending_writes_, 0);
+  pending_writes_--;
+  MaybeCloseDeferred();
+  callback.Run(result);
+}
+
+void EntryImpl::UpdateConcurrentReadFile(int index) {
+  if (index < 0 || index >= kNumStreams)
+    return;
+
+  File* file = NULL;
+  int size = 0;
+  Addr address(entry_.Data()->data_addr[index]);
+  if (!user_buffers_[index].get() && address.is_initialized() &&
+      address.is_separate_file()) {
+    file = files_[index].get();
+    size = entry_.Data()->data_size[index];
+  }
+
+  // Only the cache thread changes these, so they can be compared without the
+  // lock, which is only taken when workers must see something new.
+  if (concurrent_read_files_[index].get() == file &&
+      concurrent_read_sizes_[index] == size) {
+    return;
+  }
+  base::subtle::AutoWriteLock lock(data_lock_);
+  concurrent_read_files_[index] = file;
+  concurrent_read_sizes_[index] = size;
+}
+
+void EntryImpl::RunDeferredOperations() {
+  DCHECK(!concurrent_reads_in_flight_);
+  std::vector<base::Closure> operations;
+  operations.swap(deferred_operations_);
+  for (const base::Closure& operation : operations)
+    operation.Run();
+}
+
+void EntryImpl::MaybeCloseDeferred() {
+  if (!close_pending_ || concurrent_reads_in_flight_ || pending_writes_)
+    return;
+  close_pending_ = false;
+  if (background_queue_.get())
+    background_queue_->CloseEntryImpl(this);
+}
+
 int EntryImpl::InternalReadData(int index, int offset,
                                 IOBuffer* buf, int buf_len,
                                 const CompletionCallback& callback) {
@@ -1032,6 +1205,8 @@ int EntryImpl::InternalReadData(int index, int offset,
   }
 
   File* file = GetBackingFile(address, index);
+  // Once the external file is open, later reads can skip the cache thread.
+  UpdateConcurrentReadFile(index);
   if (!file) {
     DoomImpl();
     LOG(ERROR) << "No file for " << std::hex << address.value();
@@ -1548,6 +1723,7 @@ void EntryImpl::GetData(int index, char** buffer, Addr* address) {
                                     unreported_size_[index], 0);
     entry_.Data()->data_addr[index] = 0;
     entry_.Data()->data_size[index] = 0;
+    UpdateConcurrentReadFile(index);
   }
 }
 
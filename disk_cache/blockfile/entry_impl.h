@@ -9,8 +9,11 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/callback.h"
 #include "base/macros.h"
+#include "base/synchronization/read_write_lock.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/blockfile/disk_format.h"
 #include "net/disk_cache/blockfile/storage_block-inl.h"
@@ -68,6 +71,10 @@ class NET_EXPORT_PRIVATE EntryImpl
   void CancelSparseIOImpl();
   int ReadyForSparseIOImpl(const CompletionCallback& callback);
 
+  // Does the bookkeeping for |bytes_read| bytes read from this entry outside
+  // of the cache thread.
+  void OnConcurrentReadImpl(int bytes_read);
+
   inline CacheEntryBlock* entry() {
     return &entry_;
   }
@@ -202,6 +209,34 @@ class NET_EXPORT_PRIVATE EntryImpl
 
   ~EntryImpl() override;
 
+  // Returns true if stream |index| can be read by ConcurrentReadData().
+  bool CanReadConcurrently(int index);
+
+  // Reads stream |index| straight from its external file, on a worker thread.
+  // Returns net::ERR_IO_PENDING if the cache thread stopped allowing it since
+  // the read was posted, and the read has to go through the cache thread.
+  int ConcurrentReadData(int index, int offset, IOBuffer* buf, int buf_len);
+  void OnConcurrentReadDone(int index,
+                            int offset,
+                            scoped_refptr<IOBuffer> buf,
+                            int buf_len,
+                            const CompletionCallback& callback,
+                            int result);
+  void OnWriteDataDone(const CompletionCallback& callback, int result);
+
+  // Lets the primary thread read stream |index| on a worker thread if its data
+  // is in an external file that is already open. Called on the cache thread
+  // whenever that may have changed.
+  void UpdateConcurrentReadFile(int index);
+
+  // Sends the operations which waited for concurrent reads to the cache
+  // thread, in the order they were issued.
+  void RunDeferredOperations();
+
+  // Sends a Close() that had to wait for concurrent reads or pending writes to
+  // the cache thread, once there are none left.
+  void MaybeCloseDeferred();
+
   // Do all the work for ReadDataImpl and WriteDataImpl.  Implemented as
   // separate functions to make logging of results simpler.
   int InternalReadData(int index, int offset, IOBuffer* buf,
@@ -294,6 +329,28 @@ class NET_EXPORT_PRIVATE EntryImpl
   bool dirty_;                // True if we detected that this is a dirty entry.
   std::unique_ptr<SparseControl> sparse_;  // Support for sparse entries.
 
+  // Guards |concurrent_read_files_| and |concurrent_read_sizes_|. It is never
+  // held across IO.
+  base::subtle::ReadWriteLock data_lock_;
+
+  // The open external file of each stream that can be read on a worker
+  // thread, or null, and the size of the stream. Workers use these instead of
+  // |entry_| and |files_|, which belong to the cache thread and may go away
+  // with the backend.
+  scoped_refptr<File> concurrent_read_files_[kNumStreams];
+  int concurrent_read_sizes_[kNumStreams];
+
+  // Only used on the primary thread. With |concurrent_reads_|, reads of data
+  // in external files bypass the cache thread. They wait for the writes
+  // issued before them, writes wait for the reads issued before them, and a
+  // Close() waits for all of them. A write waiting for reads is kept in
+  // |deferred_operations_|, along with the reads and writes issued after it.
+  bool concurrent_reads_;
+  int concurrent_reads_in_flight_;
+  std::vector<base::Closure> deferred_operations_;
+  int pending_writes_;
+  bool close_pending_;
+
   net::NetLogWithSource net_log_;
 
   DISALLOW_COPY_AND_ASSIGN(EntryImpl);
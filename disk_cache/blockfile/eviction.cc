@@ -41,6 +41,7 @@
 #include "base/strings/string_util.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "base/time/time.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
 #include "net/disk_cache/blockfile/disk_format.h"
 #include "net/disk_cache/blockfile/entry_impl.h"
@@ -173,6 +174,32 @@ void Eviction::TrimCache(bool empty) {
   return;
 }
 
+bool Eviction::ShouldAdmit(uint32_t hash) {
+  AdmissionFilter* filter = backend_->admission_filter_.get();
+  if (!filter || header_->num_bytes <= max_size_)
+    return true;
+
+  // Compare with the least recently used entry of the first list that has
+  // one. TrimCacheV2() may start with a later list when the first one is
+  // short, but the first list is where most evictions come from.
+  const int num_lists = new_eviction_ ? Rankings::HIGH_USE + 1 : 1;
+  for (int list = 0; list < num_lists; ++list) {
+    Rankings::ScopedRankingsBlock node(
+        rankings_,
+        rankings_->GetPrev(nullptr, static_cast<Rankings::List>(list)));
+    if (!node.get())
+      continue;
+    Addr address(node->Data()->contents);
+    if (!address.SanityCheckForEntry())
+      return true;
+    CacheEntryBlock victim(backend_->File(address), address);
+    if (!victim.Load())
+      return true;
+    return filter->ShouldAdmit(hash, victim.Data()->hash);
+  }
+  return true;
+}
+
 void Eviction::UpdateRank(EntryImpl* entry, bool modified) {
   if (new_eviction_)
     return UpdateRankV2(entry, modified);
@@ -301,6 +328,7 @@ bool Eviction::EvictEntry(CacheRankingsBlock* node, bool empty,
     entry->DoomImpl();
   } else {
     entry->DeleteEntryData(false);
+    backend_->OnEntryDataEvicted();
     EntryStore* info = entry->entry()->Data();
     DCHECK_EQ(ENTRY_NORMAL, info->state);
 
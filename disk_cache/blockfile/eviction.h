@@ -5,6 +5,8 @@
 #ifndef NET_DISK_CACHE_BLOCKFILE_EVICTION_H_
 #define NET_DISK_CACHE_BLOCKFILE_EVICTION_H_
 
+#include <stdint.h>
+
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
 #include "net/disk_cache/blockfile/rankings.h"
@@ -30,6 +32,10 @@ class Eviction {
   // use.
   void TrimCache(bool empty);
 
+  // Returns false if the backend's admission filter turns down a new entry
+  // with |hash|, in favor of the entry the next trim would evict.
+  bool ShouldAdmit(uint32_t hash);
+
   // Updates the ranking information for an entry.
   void UpdateRank(EntryImpl* entry, bool modified);
 
@@ -229,6 +229,12 @@ void BackendIO::ReadyForSparseIO(EntryImpl* entry) {
   entry_ = entry;
 }
 
+void BackendIO::OnConcurrentRead(EntryImpl* entry, int bytes_read) {
+  operation_ = OP_CONCURRENT_READ;
+  entry_ = entry;
+  buf_len_ = bytes_read;
+}
+
 BackendIO::~BackendIO() {}
 
 bool BackendIO::ReturnsEntry() {
@@ -347,6 +353,10 @@ void BackendIO::ExecuteEntryOperation() {
       result_ = entry_->ReadyForSparseIOImpl(
                     base::Bind(&BackendIO::OnIOComplete, this));
       break;
+    case OP_CONCURRENT_READ:
+      entry_->OnConcurrentReadImpl(buf_len_);
+      result_ = net::OK;
+      break;
     default:
       NOTREACHED() << "Invalid Operation";
       result_ = net::ERR_UNEXPECTED;
@@ -537,6 +547,13 @@ void InFlightBackendIO::ReadyForSparseIO(
   PostOperation(FROM_HERE, operation.get());
 }
 
+void InFlightBackendIO::OnConcurrentRead(EntryImpl* entry, int bytes_read) {
+  scoped_refptr<BackendIO> operation(
+      new BackendIO(this, backend_, net::CompletionCallback()));
+  operation->OnConcurrentRead(entry, bytes_read);
+  PostOperation(FROM_HERE, operation.get());
+}
+
 void InFlightBackendIO::WaitForPendingIO() {
   InFlightIO::WaitForPendingIO();
 }
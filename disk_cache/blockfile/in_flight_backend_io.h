@@ -86,6 +86,7 @@ class BackendIO : public BackgroundIO {
                          int64_t* start);
   void CancelSparseIO(EntryImpl* entry);
   void ReadyForSparseIO(EntryImpl* entry);
+  void OnConcurrentRead(EntryImpl* entry, int bytes_read);
 
  private:
   // There are two types of operations to proxy: regular backend operations are
@@ -117,7 +118,8 @@ class BackendIO : public BackgroundIO {
     OP_WRITE_SPARSE,
     OP_GET_RANGE,
     OP_CANCEL_IO,
-    OP_IS_READY
+    OP_IS_READY,
+    OP_CONCURRENT_READ
   };
 
   ~BackendIO() override;
@@ -211,6 +213,7 @@ class InFlightBackendIO : public InFlightIO {
   void CancelSparseIO(EntryImpl* entry);
   void ReadyForSparseIO(EntryImpl* entry,
                         const net::CompletionCallback& callback);
+  void OnConcurrentRead(EntryImpl* entry, int bytes_read);
 
   // Blocks until all operations are cancelled or completed.
   void WaitForPendingIO();
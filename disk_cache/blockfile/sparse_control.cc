@@ -45,6 +45,10 @@ const int kMaxEntrySize = 0x100000;
 // The size of each data block (tracked by the child allocation bitmap).
 const int kBlockSize = 1024;
 
+// The number of children whose allocation data is kept around, enough for 1 GB
+// of sparse data.
+const size_t kMaxCachedChildren = 1024;
+
 // Returns the name of a child entry given the base_name and signature of the
 // parent and the child_id.
 // If the entry is called entry_name, child entries will be named something
@@ -189,10 +193,73 @@ void LogChildOperationEnd(const net::NetLogWithSource& net_log,
   }
 }
 
+// Updates the allocation data of a child, |child_data| and |child_map|, after
+// |result| bytes were written at |child_offset|.
+void UpdateChildRange(int child_offset,
+                      int result,
+                      disk_cache::SparseData* child_data,
+                      disk_cache::Bitmap* child_map) {
+  DCHECK_GE(child_data->header.last_block_len, 0);
+  DCHECK_LT(child_data->header.last_block_len, kBlockSize);
+
+  // Write the bitmap.
+  int first_bit = child_offset >> 10;
+  int block_offset = child_offset & (kBlockSize - 1);
+  if (block_offset && (child_data->header.last_block != first_bit ||
+                       child_data->header.last_block_len < block_offset)) {
+    // The first block is not completely filled; ignore it.
+    first_bit++;
+  }
+
+  int last_bit = (child_offset + result) >> 10;
+  block_offset = (child_offset + result) & (kBlockSize - 1);
+
+  // This condition will hit with the following criteria:
+  // 1. The first byte doesn't follow the last write.
+  // 2. The first byte is in the middle of a block.
+  // 3. The first byte and the last byte are in the same block.
+  if (first_bit > last_bit)
+    return;
+
+  if (block_offset && !child_map->Get(last_bit)) {
+    // The last block is not completely filled; save it for later.
+    child_data->header.last_block = last_bit;
+    child_data->header.last_block_len = block_offset;
+  } else {
+    child_data->header.last_block = -1;
+  }
+
+  child_map->SetRange(first_bit, last_bit, true);
+}
+
 }  // namespace.
 
 namespace disk_cache {
 
+// The IO of a parallel operation on one child, which goes on while the
+// following children are opened.
+struct SparseControl::ChildIO {
+  ChildIO(int child_offset, int len)
+      : child_map(child_data.bitmap, kNumSparseBits, kNumSparseBits / 32),
+        child_index(0),
+        child_offset(child_offset),
+        len(len),
+        result(net::ERR_IO_PENDING) {}
+
+  scoped_refptr<EntryImpl> child;
+  SparseData child_data;  // Parent and allocation map of |child|.
+  Bitmap child_map;  // The allocation map as a bitmap.
+  int64_t child_index;
+  int child_offset;
+  int len;
+  int result;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ChildIO);
+};
+
+const int SparseControl::kMaxParallelChildIO;
+
 SparseControl::SparseControl(EntryImpl* entry)
     : entry_(entry),
       child_(NULL),
@@ -207,7 +274,10 @@ SparseControl::SparseControl(EntryImpl* entry)
       buf_len_(0),
       child_offset_(0),
       child_len_(0),
-      result_(0) {
+      result_(0),
+      child_ios_in_flight_(0),
+      child_data_cache_doom_count_(0),
+      child_data_from_cache_(false) {
   memset(&sparse_header_, 0, sizeof(sparse_header_));
   memset(&child_data_, 0, sizeof(child_data_));
 }
@@ -292,7 +362,10 @@ int SparseControl::StartIO(SparseOperation op,
         GetSparseEventType(operation_),
         CreateNetLogSparseOperationCallback(offset_, buf_len_));
   }
-  DoChildrenIO();
+  if (ShouldDoParallelIO())
+    DoParallelChildrenIO();
+  else
+    DoChildrenIO();
 
   if (!pending_) {
     // Everything was done synchronously.
@@ -463,11 +536,16 @@ bool SparseControl::OpenChild() {
       return true;
     CloseChild();
   }
+  child_data_from_cache_ = false;
 
   // See if we are tracking this child.
   if (!ChildPresent())
     return ContinueWithoutChild(key);
 
+  // Looking for a range only needs the allocation map of the child.
+  if (kGetRangeOperation == operation_ && LoadCachedChildData())
+    return true;
+
   if (!entry_->backend_.get())
     return false;
 
@@ -499,6 +577,7 @@ bool SparseControl::OpenChild() {
     child_data_.header.last_block = -1;
   }
 
+  CacheChildData(offset_, child_data_);
   return true;
 }
 
@@ -622,37 +701,39 @@ void SparseControl::UpdateRange(int result) {
   if (result <= 0 || operation_ != kWriteOperation)
     return;
 
-  DCHECK_GE(child_data_.header.last_block_len, 0);
-  DCHECK_LT(child_data_.header.last_block_len, kBlockSize);
-
-  // Write the bitmap.
-  int first_bit = child_offset_ >> 10;
-  int block_offset = child_offset_ & (kBlockSize - 1);
-  if (block_offset && (child_data_.header.last_block != first_bit ||
-                       child_data_.header.last_block_len < block_offset)) {
-    // The first block is not completely filled; ignore it.
-    first_bit++;
-  }
-
-  int last_bit = (child_offset_ + result) >> 10;
-  block_offset = (child_offset_ + result) & (kBlockSize - 1);
+  UpdateChildRange(child_offset_, result, &child_data_, &child_map_);
+  CacheChildData(offset_, child_data_);
+}
 
-  // This condition will hit with the following criteria:
-  // 1. The first byte doesn't follow the last write.
-  // 2. The first byte is in the middle of a block.
-  // 3. The first byte and the last byte are in the same block.
-  if (first_bit > last_bit)
-    return;
+bool SparseControl::LoadCachedChildData() {
+  ValidateChildDataCache();
+  auto it = child_data_cache_.find(static_cast<int>(offset_ >> 20));
+  if (it == child_data_cache_.end())
+    return false;
+  child_data_ = it->second;
+  child_data_from_cache_ = true;
+  return true;
+}
 
-  if (block_offset && !child_map_.Get(last_bit)) {
-    // The last block is not completely filled; save it for later.
-    child_data_.header.last_block = last_bit;
-    child_data_.header.last_block_len = block_offset;
-  } else {
-    child_data_.header.last_block = -1;
+void SparseControl::CacheChildData(int64_t offset,
+                                   const SparseData& child_data) {
+  ValidateChildDataCache();
+  int child_index = static_cast<int>(offset >> 20);
+  if (child_data_cache_.size() >= kMaxCachedChildren &&
+      !child_data_cache_.count(child_index)) {
+    child_data_cache_.clear();
   }
+  child_data_cache_[child_index] = child_data;
+}
 
-  child_map_.SetRange(first_bit, last_bit, true);
+void SparseControl::ValidateChildDataCache() {
+  // Children can be evicted like any other entry.
+  int64_t doom_count =
+      entry_->backend_.get() ? entry_->backend_->doom_count() : -1;
+  if (doom_count != child_data_cache_doom_count_) {
+    child_data_cache_.clear();
+    child_data_cache_doom_count_ = doom_count;
+  }
 }
 
 int SparseControl::PartialBlockLength(int block_index) const {
@@ -677,6 +758,7 @@ void SparseControl::InitChildData() {
   if (rv != sizeof(child_data_))
     DLOG(ERROR) << "Failed to save child data";
   SetChildBit(true);
+  CacheChildData(offset_, child_data_);
 }
 
 void SparseControl::DoChildrenIO() {
@@ -765,7 +847,7 @@ bool SparseControl::DoChildIO() {
 }
 
 int SparseControl::DoGetAvailableRange() {
-  if (!child_)
+  if (!child_ && !child_data_from_cache_)
     return child_len_;  // Move on to the next child.
 
   // Bits on the bitmap should only be set when the corresponding block was
@@ -879,6 +961,150 @@ void SparseControl::OnChildIOCompleted(int result) {
   DoChildrenIO();
 }
 
+bool SparseControl::ShouldDoParallelIO() const {
+  if (operation_ != kReadOperation && operation_ != kWriteOperation)
+    return false;
+
+  // Synchronous callers get one child at a time.
+  if (user_callback_.is_null())
+    return false;
+
+  int child_offset = static_cast<int>(offset_) & (kMaxEntrySize - 1);
+  return buf_len_ > kMaxEntrySize - child_offset;
+}
+
+void SparseControl::DoParallelChildrenIO() {
+  while (child_ios_in_flight_ < kMaxParallelChildIO && StartNextChildIO())
+    continue;
+
+  if (!child_ios_in_flight_)
+    FinishParallelIO();  // Don't touch this object after this point.
+}
+
+bool SparseControl::StartNextChildIO() {
+  if (!buf_len_ || result_ < 0 || abort_)
+    return false;
+
+  // This leaves the child in |child_| and |child_data_|, which are then
+  // handed over to a ChildIO so that the next child can be opened.
+  if (!OpenChild() || !VerifyRange())
+    return false;
+
+  std::unique_ptr<ChildIO> child_io(new ChildIO(child_offset_, child_len_));
+  child_io->child.swap(child_);
+  child_io->child_data = child_data_;
+  child_io->child_index = offset_ >> 20;
+  ChildIO* io = child_io.get();
+  child_ios_.push_back(std::move(child_io));
+
+  // Carve the part of the user buffer for this child.
+  scoped_refptr<net::DrainableIOBuffer> buf(
+      new net::DrainableIOBuffer(user_buf_.get(), io->len));
+  offset_ += io->len;
+  buf_len_ -= io->len;
+  if (buf_len_)
+    user_buf_->DidConsume(io->len);
+
+  CompletionCallback callback =
+      base::Bind(&SparseControl::OnParallelChildIOCompleted,
+                 base::Unretained(this), io);
+  child_ios_in_flight_++;
+  int rv;
+  if (kReadOperation == operation_) {
+    rv = io->child->ReadDataImpl(kSparseData, io->child_offset, buf.get(),
+                                 io->len, callback);
+  } else {
+    rv = io->child->WriteDataImpl(kSparseData, io->child_offset, buf.get(),
+                                  io->len, callback, false);
+  }
+
+  if (rv != net::ERR_IO_PENDING) {
+    ParallelChildIOCompleted(io, rv);
+  } else if (!pending_) {
+    pending_ = true;
+    entry_->AddRef();  // Balanced in DoUserCallback.
+  }
+  return true;
+}
+
+void SparseControl::ParallelChildIOCompleted(ChildIO* child_io, int result) {
+  DCHECK_NE(net::ERR_IO_PENDING, result);
+  child_ios_in_flight_--;
+  child_io->result = result;
+
+  if (result > 0 && kWriteOperation == operation_) {
+    UpdateChildRange(child_io->child_offset, result, &child_io->child_data,
+                     &child_io->child_map);
+  }
+  CacheChildData(child_io->child_index << 20, child_io->child_data);
+
+  // Save the allocation bitmap before closing the child entry.
+  scoped_refptr<net::WrappedIOBuffer> buf(new net::WrappedIOBuffer(
+      reinterpret_cast<char*>(&child_io->child_data)));
+  int rv = child_io->child->WriteData(kSparseIndex, 0, buf.get(),
+                                      sizeof(child_io->child_data),
+                                      CompletionCallback(), false);
+  if (rv != sizeof(child_io->child_data))
+    DLOG(ERROR) << "Failed to save child data";
+  child_io->child = NULL;
+
+  // The data after a short or failed IO is not going to be used.
+  if (result != child_io->len)
+    buf_len_ = 0;
+}
+
+void SparseControl::OnParallelChildIOCompleted(ChildIO* child_io, int result) {
+  ParallelChildIOCompleted(child_io, result);
+  DoParallelChildrenIO();
+}
+
+void SparseControl::FinishParallelIO() {
+  DCHECK(!child_ios_in_flight_);
+
+  // An error while opening the children comes after all their IO.
+  int open_result = result_;
+  result_ = 0;
+  bool complete = true;
+  for (const auto& child_io : child_ios_) {
+    if (child_io->result < 0) {
+      // We fail the whole operation if we encounter an error.
+      result_ = child_io->result;
+      complete = false;
+      break;
+    }
+    result_ += child_io->result;
+    if (child_io->result < child_io->len) {
+      complete = false;
+      break;
+    }
+  }
+  if (complete && open_result < 0)
+    result_ = open_result;
+  child_ios_.clear();
+  finished_ = true;
+
+  if (abort_) {
+    // Same as in OnChildIOCompleted(): the user gets what was done so far. The
+    // operation can only be cancelled once it is pending.
+    DCHECK(pending_);
+    abort_ = false;
+    if (entry_->net_log().IsCapturing()) {
+      entry_->net_log().AddEvent(net::NetLogEventType::CANCELLED);
+      entry_->net_log().EndEvent(GetSparseEventType(operation_));
+    }
+    bool has_abort_callbacks = !abort_callbacks_.empty();
+    DoUserCallback();
+    if (has_abort_callbacks)
+      DoAbortCallbacks();
+    return;
+  }
+
+  if (entry_->net_log().IsCapturing())
+    entry_->net_log().EndEvent(GetSparseEventType(operation_));
+  if (pending_)
+    DoUserCallback();  // Don't touch this object after this point.
+}
+
 void SparseControl::DoUserCallback() {
   DCHECK(!user_callback_.is_null());
   CompletionCallback cb = user_callback_;
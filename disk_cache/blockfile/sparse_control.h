@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,6 +33,10 @@ class EntryImpl;
 // the operation into multiple small pieces, sending each one to the
 // appropriate entry. An instance of this class is asociated with each entry
 // used directly for sparse operations (the entry passed in to the constructor).
+//
+// Asynchronous reads and writes which span several children are sent to up to
+// kMaxParallelChildIO children at a time, and their results are put together
+// in order once they all finish.
 class SparseControl {
  public:
   typedef net::CompletionCallback CompletionCallback;
@@ -81,7 +87,12 @@ class SparseControl {
   // Deletes the children entries of |entry|.
   static void DeleteChildren(EntryImpl* entry);
 
+  // The maximum number of children with IO in flight for one operation.
+  static const int kMaxParallelChildIO = 4;
+
  private:
+  struct ChildIO;
+
   // Creates a new sparse entry or opens an aready created entry from disk.
   // These methods just read / write the required info from disk for the current
   // entry, and verify that everything is correct. The return value is a net
@@ -123,6 +134,17 @@ class SparseControl {
   // the current operation.
   void UpdateRange(int result);
 
+  // Loads |child_data_| for the current child from |child_data_cache_|, if it
+  // is there. Returns true on success.
+  bool LoadCachedChildData();
+
+  // Saves a copy of |child_data| as the allocation data of the child which
+  // stores |offset|.
+  void CacheChildData(int64_t offset, const SparseData& child_data);
+
+  // Drops |child_data_cache_| if the backend may have doomed any children.
+  void ValidateChildDataCache();
+
   // Returns the number of bytes stored at |block_index|, if its allocation-bit
   // is off (because it is not completely filled).
   int PartialBlockLength(int block_index) const;
@@ -147,6 +169,27 @@ class SparseControl {
   // Invoked by the callback of asynchronous operations.
   void OnChildIOCompleted(int result);
 
+  // Returns true if the current operation should be split among children in
+  // parallel rather than one child at a time.
+  bool ShouldDoParallelIO() const;
+
+  // Starts IO on as many children as allowed, and finishes the operation if
+  // they all completed synchronously.
+  void DoParallelChildrenIO();
+
+  // Opens the next child for the current operation and starts its IO. Returns
+  // false if there is nothing more to start.
+  bool StartNextChildIO();
+
+  // Performs the required work after the IO of |child_io| finishes.
+  void ParallelChildIOCompleted(ChildIO* child_io, int result);
+
+  // Invoked by the callback of asynchronous parallel IO.
+  void OnParallelChildIOCompleted(ChildIO* child_io, int result);
+
+  // Adds up the results of |child_ios_|, in order, into |result_|.
+  void FinishParallelIO();
+
   // Reports to the user that we are done.
   void DoUserCallback();
   void DoAbortCallbacks();
@@ -174,6 +217,17 @@ class SparseControl {
   int child_len_;  // Bytes to read or write for this child.
   int result_;
 
+  // The children IO of the current parallel operation, in offset order.
+  std::vector<std::unique_ptr<ChildIO>> child_ios_;
+  int child_ios_in_flight_;
+
+  // The allocation data of the children used lately, by child index, so that
+  // GetAvailableRange() doesn't have to open them again. It is dropped when
+  // the backend's doom count moves away from |child_data_cache_doom_count_|.
+  std::map<int, SparseData> child_data_cache_;
+  int64_t child_data_cache_doom_count_;
+  bool child_data_from_cache_;  // True if |child_data_| came from the cache.
+
   DISALLOW_COPY_AND_ASSIGN(SparseControl);
 };
 
@@ -3,30 +3,45 @@
 // found in the LICENSE file.
 
 #include <limits>
+#include <memory>
 #include <string>
+#include <unordered_set>
 
 #include "base/bind.h"
 #include "base/bind_helpers.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
+#include "base/format_macros.h"
 #include "base/hash.h"
 #include "base/process/process_metrics.h"
 #include "base/rand_util.h"
 #include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_log.h"
 #include "base/test/perf_time_logger.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/test_file_util.h"
 #include "base/threading/thread.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "net/base/cache_type.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
 #include "net/disk_cache/blockfile/block_files.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/simple/simple_backend_impl.h"
+#include "net/disk_cache/simple/simple_experiment.h"
+#include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_index_file.h"
+#include "net/disk_cache/simple/simple_util.h"
+#include "net/net_features.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
 
@@ -55,7 +70,8 @@ struct TestEntry {
 
 class DiskCachePerfTest : public DiskCacheTestWithCache {
  public:
-  DiskCachePerfTest() : saved_fd_limit_(MaybeGetMaxFds()) {
+  DiskCachePerfTest()
+      : max_body_size_(kBodySize), saved_fd_limit_(MaybeGetMaxFds()) {
     if (saved_fd_limit_ < kFdLimitForCacheTests)
       MaybeSetFdLimit(kFdLimitForCacheTests);
   }
@@ -74,17 +90,28 @@ class DiskCachePerfTest : public DiskCacheTestWithCache {
   // Helper methods for constructing tests.
   bool TimeWrite();
   bool TimeRead(WhatToRead what_to_read, const char* timer_message);
+  bool TimeMixedIO(int read_percent, const char* timer_message);
   void ResetAndEvictSystemDiskCache();
 
   // Complete perf tests.
   void CacheBackendPerformance();
+  void SmallEntryPerformance();
+  void IndexPerformance(size_t entry_count);
+  void IOEnginePerformance();
+  void MemoryCachePerformance();
+  void ReplaySkewedTrace(const char* label);
+  void SparseRangePerformance();
+  void ConcurrentReadPerformance(const char* label);
 
   const size_t kFdLimitForCacheTests = 8192;
 
   const int kNumEntries = 1000;
   const int kHeadersSize = 800;
   const int kBodySize = 256 * 1024 - 1;
+  const int kSmallBodySize = 4 * 1024;
 
+  // Bodies are up to this large.
+  int max_body_size_;
   std::vector<TestEntry> entries_;
 
  private:
@@ -92,7 +119,7 @@ class DiskCachePerfTest : public DiskCacheTestWithCache {
 };
 
 // Creates num_entries on the cache, and writes kHeaderSize bytes of metadata
-// and up to kBodySize of data to each entry.
+// and up to |max_body_size_| of data to each entry.
 bool DiskCachePerfTest::TimeWrite() {
   // TODO(gavinp): This test would be significantly more realistic if it didn't
   // do single reads and writes. Perhaps entries should be written 64kb at a
@@ -115,7 +142,7 @@ bool DiskCachePerfTest::TimeWrite() {
   for (int i = 0; i < kNumEntries; i++) {
     TestEntry entry;
     entry.key = GenerateKey(true);
-    entry.data_len = base::RandInt(0, kBodySize);
+    entry.data_len = base::RandInt(0, max_body_size_);
     entries_.push_back(entry);
 
     disk_cache::Entry* cache_entry;
@@ -196,6 +223,50 @@ bool DiskCachePerfTest::TimeRead(WhatToRead what_to_read,
   return (expected == helper.callbacks_called());
 }
 
+// Opens random entries from |entries_|, and either reads the body of each one
+// or rewrites it, reading |read_percent| percent of the time.
+bool DiskCachePerfTest::TimeMixedIO(int read_percent,
+                                    const char* timer_message) {
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kBodySize));
+  CacheTestFillBuffer(buffer->data(), kBodySize, false);
+
+  int expected = 0;
+
+  MessageLoopHelper helper;
+  CallbackTest callback(&helper, true);
+
+  base::PerfTimeLogger timer(timer_message);
+
+  for (int i = 0; i < kNumEntries; i++) {
+    const TestEntry& entry = entries_[base::RandInt(0, kNumEntries - 1)];
+    disk_cache::Entry* cache_entry;
+    net::TestCompletionCallback cb;
+    int rv = cache_->OpenEntry(entry.key, &cache_entry, cb.callback());
+    if (net::OK != cb.GetResult(rv))
+      break;
+    int ret;
+    if (base::RandInt(0, 99) < read_percent) {
+      ret = cache_entry->ReadData(
+          1, 0, buffer.get(), entry.data_len,
+          base::Bind(&CallbackTest::Run, base::Unretained(&callback)));
+    } else {
+      ret = cache_entry->WriteData(
+          1, 0, buffer.get(), entry.data_len,
+          base::Bind(&CallbackTest::Run, base::Unretained(&callback)), false);
+    }
+    if (net::ERR_IO_PENDING == ret)
+      expected++;
+    else if (entry.data_len != ret)
+      break;
+    cache_entry->Close();
+  }
+
+  helper.WaitUntilCacheIoFinished(expected);
+  timer.Done();
+
+  return (expected == helper.callbacks_called());
+}
+
 TEST_F(DiskCachePerfTest, BlockfileHashes) {
   base::PerfTimeLogger timer("Hash disk cache keys");
   for (int i = 0; i < 300000; i++) {
@@ -257,6 +328,353 @@ void DiskCachePerfTest::CacheBackendPerformance() {
   base::RunLoop().RunUntilIdle();
 }
 
+// Most entries in a typical cache are small, so the time spent on them goes to
+// opening, creating and closing files rather than to reading and writing.
+void DiskCachePerfTest::SmallEntryPerformance() {
+  max_body_size_ = kSmallBodySize;
+  CacheBackendPerformance();
+}
+
+// Compares how the Simple cache reads and writes entries with and without a
+// SimpleIOEngine, under a read-mostly and a write-heavy mix of operations.
+void DiskCachePerfTest::IOEnginePerformance() {
+  SetSimpleCacheMode();
+  InitCache();
+  EXPECT_TRUE(TimeWrite());
+
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+
+  ResetAndEvictSystemDiskCache();
+  EXPECT_TRUE(TimeMixedIO(90, "Random reads and some writes (cold)"));
+  EXPECT_TRUE(TimeMixedIO(90, "Random reads and some writes (warm)"));
+  EXPECT_TRUE(TimeMixedIO(20, "Random writes and some reads"));
+
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+}
+
+// Runs a memory cache under a skewed load: most lookups go to a set of popular
+// entries which fits in the cache, with a stream of entries which are written
+// once and never read again mixed in. Entries that miss are written, as the
+// HttpCache would. Reports the time taken and the share of lookups that hit.
+void DiskCachePerfTest::MemoryCachePerformance() {
+  const int kCacheSize = 10 * 1024 * 1024;
+  const int kPopularEntries = 400;
+  const int kLookups = 100000;
+  const int kPopularPercent = 80;
+  const int kMaxEntryBodySize = 16 * 1024;
+
+  SetMemoryOnlyMode();
+  SetMaxSize(kCacheSize);
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> headers(new net::IOBuffer(kHeadersSize));
+  scoped_refptr<net::IOBuffer> body(new net::IOBuffer(kMaxEntryBodySize));
+  CacheTestFillBuffer(headers->data(), kHeadersSize, false);
+  CacheTestFillBuffer(body->data(), kMaxEntryBodySize, false);
+
+  std::vector<TestEntry> popular_entries(kPopularEntries);
+  for (TestEntry& entry : popular_entries) {
+    entry.key = GenerateKey(true);
+    entry.data_len = base::RandInt(0, kMaxEntryBodySize);
+  }
+
+  int hits = 0;
+  base::PerfTimeLogger timer("Memory cache lookups with one-off entries");
+  for (int i = 0; i < kLookups; ++i) {
+    TestEntry entry;
+    if (base::RandInt(0, 99) < kPopularPercent) {
+      // Favor the first popular entries: the square of a uniform number
+      // leans towards zero.
+      const double r = base::RandDouble();
+      entry = popular_entries[static_cast<int>(r * r * kPopularEntries)];
+    } else {
+      entry.key = GenerateKey(true);
+      entry.data_len = base::RandInt(0, kMaxEntryBodySize);
+    }
+
+    disk_cache::Entry* cache_entry;
+    if (OpenEntry(entry.key, &cache_entry) == net::OK) {
+      ++hits;
+      EXPECT_EQ(kHeadersSize,
+                ReadData(cache_entry, 0, 0, headers.get(), kHeadersSize));
+      EXPECT_EQ(entry.data_len,
+                ReadData(cache_entry, 1, 0, body.get(), entry.data_len));
+    } else {
+      ASSERT_EQ(net::OK, CreateEntry(entry.key, &cache_entry));
+      EXPECT_EQ(kHeadersSize, WriteData(cache_entry, 0, 0, headers.get(),
+                                        kHeadersSize, false));
+      EXPECT_EQ(entry.data_len, WriteData(cache_entry, 1, 0, body.get(),
+                                          entry.data_len, false));
+    }
+    cache_entry->Close();
+  }
+  timer.Done();
+  base::LogPerfResult("Memory cache hit rate", 100.0 * hits / kLookups, "%");
+
+  base::StringPairs stats;
+  cache_->GetStats(&stats);
+  for (const auto& item : stats) {
+    double overhead;
+    if (item.first == "Overhead per entry" &&
+        base::StringToDouble(item.second, &overhead)) {
+      base::LogPerfResult("Memory cache overhead per entry", overhead,
+                          "bytes");
+    }
+  }
+}
+
+// Replays a trace of lookups against a Simple cache, as the HttpCache would
+// issue them: a lookup that misses creates and writes the entry, unless the
+// backend turns it down. Most lookups go to a set of popular keys, and the
+// rest to keys which are never looked up again. Reports the share of lookups
+// that hit and the bytes written to the cache.
+void DiskCachePerfTest::ReplaySkewedTrace(const char* label) {
+  const int kCacheSize = 8 * 1024 * 1024;
+  const int kPopularEntries = 400;
+  const int kLookups = 20000;
+  const int kPopularPercent = 60;
+  const int kMaxEntryBodySize = 32 * 1024;
+
+  SetSimpleCacheMode();
+  SetMaxSize(kCacheSize);
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> headers(new net::IOBuffer(kHeadersSize));
+  scoped_refptr<net::IOBuffer> body(new net::IOBuffer(kMaxEntryBodySize));
+  CacheTestFillBuffer(headers->data(), kHeadersSize, false);
+  CacheTestFillBuffer(body->data(), kMaxEntryBodySize, false);
+
+  std::vector<TestEntry> popular_entries(kPopularEntries);
+  for (TestEntry& entry : popular_entries) {
+    entry.key = GenerateKey(true);
+    entry.data_len = base::RandInt(0, kMaxEntryBodySize);
+  }
+
+  int hits = 0;
+  int64_t bytes_written = 0;
+  base::PerfTimeLogger timer(
+      base::StringPrintf("Replay skewed trace, %s", label).c_str());
+  for (int i = 0; i < kLookups; ++i) {
+    TestEntry entry;
+    if (base::RandInt(0, 99) < kPopularPercent) {
+      const double r = base::RandDouble();
+      entry = popular_entries[static_cast<int>(r * r * kPopularEntries)];
+    } else {
+      entry.key = GenerateKey(true);
+      entry.data_len = base::RandInt(0, kMaxEntryBodySize);
+    }
+
+    disk_cache::Entry* cache_entry;
+    net::TestCompletionCallback open_cb;
+    int rv = cache_->OpenEntry(entry.key, &cache_entry, open_cb.callback());
+    if (open_cb.GetResult(rv) == net::OK) {
+      ++hits;
+      net::TestCompletionCallback read_cb;
+      rv = cache_entry->ReadData(1, 0, body.get(), entry.data_len,
+                                 read_cb.callback());
+      EXPECT_EQ(entry.data_len, read_cb.GetResult(rv));
+      cache_entry->Close();
+      continue;
+    }
+
+    net::TestCompletionCallback create_cb;
+    rv = cache_->CreateEntry(entry.key, &cache_entry, create_cb.callback());
+    rv = create_cb.GetResult(rv);
+    if (rv == net::ERR_CACHE_ENTRY_NOT_ADMITTED)
+      continue;
+    ASSERT_EQ(net::OK, rv);
+    net::TestCompletionCallback headers_cb;
+    rv = cache_entry->WriteData(0, 0, headers.get(), kHeadersSize,
+                                headers_cb.callback(), false);
+    EXPECT_EQ(kHeadersSize, headers_cb.GetResult(rv));
+    net::TestCompletionCallback body_cb;
+    rv = cache_entry->WriteData(1, 0, body.get(), entry.data_len,
+                                body_cb.callback(), false);
+    EXPECT_EQ(entry.data_len, body_cb.GetResult(rv));
+    bytes_written += kHeadersSize + entry.data_len;
+    cache_entry->Close();
+  }
+  timer.Done();
+
+  base::LogPerfResult(
+      base::StringPrintf("Hit rate, %s", label).c_str(),
+      100.0 * hits / kLookups, "%");
+  base::LogPerfResult(
+      base::StringPrintf("Bytes written, %s", label).c_str(),
+      static_cast<double>(bytes_written), "bytes");
+
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+}
+
+// Writes a large sparse entry, and then serves range requests from it the way
+// the HttpCache does for media: a GetAvailableRange() followed by a read of
+// whatever is there.
+void DiskCachePerfTest::SparseRangePerformance() {
+  const int kSparseSize = 256 * 1024 * 1024;
+  const int kWriteSize = 1024 * 1024;
+  const int kRangeSize = 4 * 1024 * 1024;
+  const int kRangeRequests = 200;
+
+  SetMaxSize(2 * kSparseSize);
+  InitCache();
+
+  disk_cache::Entry* entry = nullptr;
+  ASSERT_EQ(net::OK, CreateEntry("sparse", &entry));
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kRangeSize));
+  CacheTestFillBuffer(buffer->data(), kRangeSize, false);
+
+  base::PerfTimeLogger write_timer("Write a sparse entry");
+  for (int64_t offset = 0; offset < kSparseSize; offset += kWriteSize) {
+    ASSERT_EQ(kWriteSize,
+              WriteSparseData(entry, offset, buffer.get(), kWriteSize));
+  }
+  write_timer.Done();
+  entry->Close();
+
+  ResetAndEvictSystemDiskCache();
+  ASSERT_EQ(net::OK, OpenEntry("sparse", &entry));
+
+  base::PerfTimeLogger read_timer("Serve range requests from a sparse entry");
+  for (int i = 0; i < kRangeRequests; i++) {
+    int64_t offset = base::RandInt(0, (kSparseSize - kRangeSize) / 1024);
+    offset *= 1024;
+    int64_t start;
+    net::TestCompletionCallback cb;
+    int rv =
+        entry->GetAvailableRange(offset, kRangeSize, &start, cb.callback());
+    ASSERT_EQ(kRangeSize, cb.GetResult(rv));
+    ASSERT_EQ(offset, start);
+    ASSERT_EQ(kRangeSize,
+              ReadSparseData(entry, offset, buffer.get(), kRangeSize));
+  }
+  read_timer.Done();
+  entry->Close();
+}
+
+// Keeps every entry in |entries_| open and reads their bodies in chunks, the
+// way the HttpCache does, with the reads of all the entries in flight at once.
+// The first chunk of each entry is read apart, as that is what opens the file.
+void DiskCachePerfTest::ConcurrentReadPerformance(const char* label) {
+  const int kChunkSize = 32 * 1024;
+
+  InitCache();
+  EXPECT_TRUE(TimeWrite());
+  ResetAndEvictSystemDiskCache();
+
+  std::vector<disk_cache::Entry*> cache_entries;
+  for (const TestEntry& entry : entries_) {
+    disk_cache::Entry* cache_entry;
+    ASSERT_EQ(net::OK, OpenEntry(entry.key, &cache_entry));
+    cache_entries.push_back(cache_entry);
+  }
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kChunkSize));
+  MessageLoopHelper helper;
+  CallbackTest callback(&helper, true);
+  int expected = 0;
+  for (disk_cache::Entry* cache_entry : cache_entries) {
+    int ret = cache_entry->ReadData(
+        1, 0, buffer.get(), kChunkSize,
+        base::Bind(&CallbackTest::Run, base::Unretained(&callback)));
+    if (ret == net::ERR_IO_PENDING)
+      expected++;
+  }
+  EXPECT_TRUE(helper.WaitUntilCacheIoFinished(expected));
+
+  base::PerfTimeLogger timer(
+      base::StringPrintf("Read entries in chunks, %s", label).c_str());
+  for (size_t i = 0; i < cache_entries.size(); i++) {
+    for (int offset = kChunkSize; offset < entries_[i].data_len;
+         offset += kChunkSize) {
+      int ret = cache_entries[i]->ReadData(
+          1, offset, buffer.get(), kChunkSize,
+          base::Bind(&CallbackTest::Run, base::Unretained(&callback)));
+      if (ret == net::ERR_IO_PENDING)
+        expected++;
+      else
+        EXPECT_LT(0, ret);
+    }
+  }
+  EXPECT_TRUE(helper.WaitUntilCacheIoFinished(expected));
+  timer.Done();
+
+  for (disk_cache::Entry* cache_entry : cache_entries)
+    cache_entry->Close();
+}
+
+// Writes an index of |entry_count| entries, flushes it again after a few of
+// them change, as happens on every idle write, and loads it.
+void DiskCachePerfTest::IndexPerformance(size_t entry_count) {
+  ASSERT_TRUE(CleanupCacheDir());
+  disk_cache::SimpleIndex::EntrySet entries;
+  entries.reserve(entry_count);
+  uint64_t cache_size = 0;
+  while (entries.size() < entry_count) {
+    const uint32_t entry_size = base::RandInt(1, kBodySize);
+    disk_cache::SimpleIndex::InsertInEntrySet(
+        base::RandUint64(), disk_cache::EntryMetadata(Time::Now(), entry_size),
+        &entries);
+    cache_size += entry_size;
+  }
+
+  std::unique_ptr<disk_cache::SimpleIndexFile> index_file(
+      new disk_cache::SimpleIndexFile(base::ThreadTaskRunnerHandle::Get(),
+                                      base::ThreadTaskRunnerHandle::Get(),
+                                      net::DISK_CACHE, cache_path_, nullptr));
+  const char* format =
+      index_file->uses_mapped_table() ? "index table" : "index file";
+  std::unordered_set<uint64_t> dirty_entries;
+
+  base::PerfTimeLogger timer1(
+      base::StringPrintf("Write %s of %" PRIuS " entries", format, entry_count)
+          .c_str());
+  base::RunLoop write_run_loop;
+  index_file->WriteUpdatesToDisk(
+      disk_cache::SimpleIndex::INDEX_WRITE_REASON_IDLE, entries, dirty_entries,
+      cache_size, base::TimeTicks::Now(), false, write_run_loop.QuitClosure());
+  write_run_loop.Run();
+  timer1.Done();
+
+  for (auto& entry : entries) {
+    if (dirty_entries.size() == entry_count / 100)
+      break;
+    entry.second.SetLastUsedTime(Time::Now());
+    dirty_entries.insert(entry.first);
+  }
+  base::PerfTimeLogger timer2(
+      base::StringPrintf("Flush %s of %" PRIuS " entries, 1%% changed", format,
+                         entry_count)
+          .c_str());
+  base::RunLoop flush_run_loop;
+  index_file->WriteUpdatesToDisk(
+      disk_cache::SimpleIndex::INDEX_WRITE_REASON_IDLE, entries, dirty_entries,
+      cache_size, base::TimeTicks::Now(), false, flush_run_loop.QuitClosure());
+  flush_run_loop.Run();
+  timer2.Done();
+
+  index_file.reset(new disk_cache::SimpleIndexFile(
+      base::ThreadTaskRunnerHandle::Get(), base::ThreadTaskRunnerHandle::Get(),
+      net::DISK_CACHE, cache_path_, nullptr));
+  base::Time cache_mtime;
+  ASSERT_TRUE(disk_cache::simple_util::GetMTime(cache_path_, &cache_mtime));
+  disk_cache::SimpleIndexLoadResult load_result;
+  base::PerfTimeLogger timer3(
+      base::StringPrintf("Load %s of %" PRIuS " entries", format, entry_count)
+          .c_str());
+  base::RunLoop load_run_loop;
+  index_file->LoadIndexEntries(cache_mtime, load_run_loop.QuitClosure(),
+                               &load_result);
+  load_run_loop.Run();
+  timer3.Done();
+  EXPECT_TRUE(load_result.did_load);
+  EXPECT_EQ(disk_cache::SimpleIndex::INITIALIZE_METHOD_LOADED,
+            load_result.init_method);
+  EXPECT_EQ(entry_count, load_result.entries.size());
+}
+
 TEST_F(DiskCachePerfTest, CacheBackendPerformance) {
   CacheBackendPerformance();
 }
@@ -266,6 +684,80 @@ TEST_F(DiskCachePerfTest, SimpleCacheBackendPerformance) {
   CacheBackendPerformance();
 }
 
+TEST_F(DiskCachePerfTest, SimpleCacheSmallEntryPerformance) {
+  SetSimpleCacheMode();
+  SmallEntryPerformance();
+}
+
+TEST_F(DiskCachePerfTest, SimpleCachePackedSmallEntryPerformance) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimplePackedStorage);
+  SetSimpleCacheMode();
+  SmallEntryPerformance();
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheIOPerformance) {
+  IOEnginePerformance();
+}
+
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+TEST_F(DiskCachePerfTest, SimpleCacheIOUringPerformance) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimpleCacheIOUring);
+  IOEnginePerformance();
+}
+#endif
+
+TEST_F(DiskCachePerfTest, MemoryCachePerformance) {
+  MemoryCachePerformance();
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheSkewedTrace) {
+  ReplaySkewedTrace("admitting every entry");
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheSkewedTraceAdmissionFilter) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kDiskCacheAdmissionFilter);
+  ReplaySkewedTrace("with an admission filter");
+}
+
+TEST_F(DiskCachePerfTest, BlockfileConcurrentReads) {
+  ConcurrentReadPerformance("on the cache thread");
+}
+
+TEST_F(DiskCachePerfTest, BlockfileConcurrentReadsEnabled) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kBlockfileConcurrentReads);
+  ConcurrentReadPerformance("on worker threads");
+}
+
+TEST_F(DiskCachePerfTest, SparseRangePerformance) {
+  SparseRangePerformance();
+}
+
+TEST_F(DiskCachePerfTest, SimpleIndexPerformance1M) {
+  IndexPerformance(1000000);
+}
+
+TEST_F(DiskCachePerfTest, SimpleIndexPerformance5M) {
+  IndexPerformance(5000000);
+}
+
+TEST_F(DiskCachePerfTest, SimpleIndexTablePerformance1M) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimpleIndexMappedTable);
+  IndexPerformance(1000000);
+}
+
+TEST_F(DiskCachePerfTest, SimpleIndexTablePerformance5M) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimpleIndexMappedTable);
+  IndexPerformance(5000000);
+}
+
 // Creating and deleting "entries" on a block-file is something quite frequent
 // (after all, almost everything is stored on block files). The operation is
 // almost free when the file is empty, but can be expensive if the file gets
@@ -12,6 +12,7 @@
 #include "base/run_loop.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/threading/platform_thread.h"
 #include "net/base/completion_callback.h"
 #include "net/base/io_buffer.h"
@@ -25,6 +26,7 @@
 #include "net/disk_cache/simple/simple_backend_impl.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
 #include "net/disk_cache/simple/simple_entry_impl.h"
+#include "net/disk_cache/simple/simple_experiment.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_test_util.h"
 #include "net/disk_cache/simple/simple_util.h"
@@ -619,6 +621,125 @@ TEST_F(DiskCacheEntryTest, MAYBE_ExternalAsyncIONoBuffer) {
   ExternalAsyncIO();
 }
 
+TEST_F(DiskCacheEntryTest, ExternalAsyncIOConcurrentReads) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kBlockfileConcurrentReads);
+  InitCache();
+  cache_impl_->SetFlags(disk_cache::kNoBuffering);
+  ExternalAsyncIO();
+}
+
+// Tests that closing an entry waits for the reads which bypass the cache
+// thread.
+TEST_F(DiskCacheEntryTest, ConcurrentReadsThenClose) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kBlockfileConcurrentReads);
+  InitCache();
+  cache_impl_->SetFlags(disk_cache::kNoBuffering);
+
+  const int kSize = 40000;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer3(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+
+  disk_cache::Entry* entry = NULL;
+  ASSERT_THAT(CreateEntry("the first key", &entry), IsOk());
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer1.get(), kSize, false));
+
+  net::TestCompletionCallback cb1;
+  net::TestCompletionCallback cb2;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            entry->ReadData(1, 0, buffer2.get(), kSize, cb1.callback()));
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            entry->ReadData(1, 1000, buffer3.get(), kSize, cb2.callback()));
+  entry->Close();
+
+  EXPECT_EQ(kSize, cb1.WaitForResult());
+  EXPECT_EQ(kSize - 1000, cb2.WaitForResult());
+  EXPECT_EQ(0, memcmp(buffer1->data(), buffer2->data(), kSize));
+  EXPECT_EQ(0, memcmp(buffer1->data() + 1000, buffer3->data(), kSize - 1000));
+  FlushQueueForTest();
+
+  ASSERT_THAT(OpenEntry("the first key", &entry), IsOk());
+  EXPECT_EQ(kSize, entry->GetDataSize(1));
+  entry->Close();
+}
+
+// Tests that a write waits for the reads which bypass the cache thread and
+// were issued before it, and that reads issued after it see its data.
+TEST_F(DiskCacheEntryTest, ConcurrentReadThenWrite) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kBlockfileConcurrentReads);
+  InitCache();
+  cache_impl_->SetFlags(disk_cache::kNoBuffering);
+
+  const int kSize = 40000;
+  const int kNewSize = 1000;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer3(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer4(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+  CacheTestFillBuffer(buffer3->data(), kNewSize, false);
+
+  disk_cache::Entry* entry = NULL;
+  ASSERT_THAT(CreateEntry("the first key", &entry), IsOk());
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer1.get(), kSize, false));
+
+  net::TestCompletionCallback read_cb;
+  net::TestCompletionCallback write_cb;
+  net::TestCompletionCallback second_read_cb;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            entry->ReadData(1, 0, buffer2.get(), kSize, read_cb.callback()));
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            entry->WriteData(1, 0, buffer3.get(), kNewSize,
+                             write_cb.callback(), true));
+  EXPECT_EQ(net::ERR_IO_PENDING, entry->ReadData(1, 0, buffer4.get(), kSize,
+                                                 second_read_cb.callback()));
+
+  EXPECT_EQ(kSize, read_cb.WaitForResult());
+  EXPECT_EQ(0, memcmp(buffer1->data(), buffer2->data(), kSize));
+  EXPECT_EQ(kNewSize, write_cb.WaitForResult());
+  EXPECT_EQ(kNewSize, second_read_cb.WaitForResult());
+  EXPECT_EQ(0, memcmp(buffer3->data(), buffer4->data(), kNewSize));
+  entry->Close();
+}
+
+#if !defined(LEAK_SANITIZER)
+// Tests that a read which bypasses the cache thread doesn't need the backend,
+// which may go away while the read runs. We'll be leaking the entry.
+TEST_F(DiskCacheEntryTest, ConcurrentReadThenDestroyBackend) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      disk_cache::kBlockfileConcurrentReads);
+  InitCache();
+  cache_impl_->SetFlags(disk_cache::kNoBuffering);
+
+  const int kSize = 40000;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+
+  disk_cache::Entry* entry = NULL;
+  ASSERT_THAT(CreateEntry("the first key", &entry), IsOk());
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer1.get(), kSize, false));
+
+  net::TestCompletionCallback cb;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            entry->ReadData(1, 0, buffer2.get(), kSize, cb.callback()));
+  cache_.reset();
+  cache_impl_ = NULL;
+
+  EXPECT_EQ(kSize, cb.WaitForResult());
+  EXPECT_EQ(0, memcmp(buffer1->data(), buffer2->data(), kSize));
+  entry->Close();
+}
+#endif
+
 TEST_F(DiskCacheEntryTest, MemoryOnlyExternalAsyncIO) {
   SetMemoryOnlyMode();
   InitCache();
@@ -1754,6 +1875,79 @@ TEST_F(DiskCacheEntryTest, MemoryOnlyHugeSparseIO) {
   HugeSparseIO();
 }
 
+// Sparse IO which spans more children than SparseControl works on at a time.
+TEST_F(DiskCacheEntryTest, ParallelSparseIO) {
+  InitCache();
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+
+  // Write 6.5 MB at offset 0x1080000 (16.5 MB), which covers 7 children.
+  const int kSize = 6656 * 1024;
+  const int64_t kOffset = 0x1080000;
+  scoped_refptr<net::IOBuffer> buf_1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buf_2(new net::IOBuffer(kSize + 0x200000));
+  CacheTestFillBuffer(buf_1->data(), kSize, false);
+  VerifySparseIO(entry, kOffset, buf_1.get(), kSize, buf_2.get());
+
+  // Reads stop at the first hole, even with data after it.
+  const int64_t kOffset2 = kOffset + kSize + 0x100000;
+  EXPECT_EQ(1024, WriteSparseData(entry, kOffset2, buf_1.get(), 1024));
+  EXPECT_EQ(kSize,
+            ReadSparseData(entry, kOffset, buf_2.get(), kSize + 0x200000));
+  EXPECT_EQ(0, memcmp(buf_1->data(), buf_2->data(), kSize));
+
+  // The range in the first child with data.
+  int64_t start;
+  net::TestCompletionCallback cb;
+  int rv = entry->GetAvailableRange(0, 0x3000000, &start, cb.callback());
+  EXPECT_EQ(0x80000, cb.GetResult(rv));
+  EXPECT_EQ(kOffset, start);
+  rv = entry->GetAvailableRange(kOffset + kSize, 0x200000, &start,
+                                cb.callback());
+  EXPECT_EQ(1024, cb.GetResult(rv));
+  EXPECT_EQ(kOffset2, start);
+  entry->Close();
+
+  // Again, with the children read from disk.
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  rv = entry->GetAvailableRange(0, 0x3000000, &start, cb.callback());
+  EXPECT_EQ(0x80000, cb.GetResult(rv));
+  EXPECT_EQ(kOffset, start);
+  VerifyContentSparseIO(entry, kOffset, buf_1->data(), kSize);
+  entry->Close();
+}
+
+// Tests that GetAvailableRange() doesn't report data of a child which the new
+// eviction algorithm evicted, without dooming it, while the parent was open.
+TEST_F(DiskCacheEntryTest, NewEvictionSparseChildEvicted) {
+  SetNewEviction();
+  InitCache();
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+
+  const int kSize = 1024;
+  scoped_refptr<net::IOBuffer> buf(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buf->data(), kSize, false);
+  EXPECT_EQ(kSize, WriteSparseData(entry, 0, buf.get(), kSize));
+
+  int64_t start;
+  net::TestCompletionCallback cb;
+  int rv = entry->GetAvailableRange(0, kSize, &start, cb.callback());
+  EXPECT_EQ(kSize, cb.GetResult(rv));
+  EXPECT_EQ(0, start);
+
+  // The parent is in use, so the child is the one evicted.
+  EXPECT_EQ(2, cache_->GetEntryCount());
+  TrimForTest(false);
+
+  rv = entry->GetAvailableRange(0, kSize, &start, cb.callback());
+  EXPECT_EQ(0, cb.GetResult(rv));
+  EXPECT_EQ(0, ReadSparseData(entry, 0, buf.get(), kSize));
+  entry->Close();
+}
+
 void DiskCacheEntryTest::GetAvailableRange() {
   std::string key("the first key");
   disk_cache::Entry* entry;
@@ -4292,3 +4486,65 @@ TEST_F(DiskCacheEntryTest, SimpleCacheReadCorruptLength) {
       disk_cache::simple_util::CorruptStream0LengthFromEntry(key, cache_path_));
   EXPECT_NE(net::OK, OpenEntry(key, &entry));
 }
+
+// Speculative opens read small entries whole, and the end of larger ones.
+TEST_F(DiskCacheEntryTest, SimpleCacheSpeculativeOpen) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimpleSpeculativeOpen);
+  // This test runs as APP_CACHE to make operations more synchronous.
+  SetCacheType(net::APP_CACHE);
+  SetSimpleCacheMode();
+  InitCache();
+
+  const int kHeadersSize = 500;
+  const int kSmallSize = 1000;
+  const int kLargeSize =
+      disk_cache::SimpleSynchronousEntry::kSpeculativeReadSize * 2;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kLargeSize));
+  CacheTestFillBuffer(buffer->data(), kLargeSize, false);
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kLargeSize));
+
+  for (int size : {kSmallSize, kLargeSize}) {
+    const std::string key = base::IntToString(size);
+    disk_cache::Entry* entry;
+    ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+    EXPECT_EQ(kHeadersSize,
+              WriteData(entry, 0, 0, buffer.get(), kHeadersSize, false));
+    EXPECT_EQ(size, WriteData(entry, 1, 0, buffer.get(), size, false));
+    entry->Close();
+
+    ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+    EXPECT_EQ(kHeadersSize, entry->GetDataSize(0));
+    EXPECT_EQ(size, entry->GetDataSize(1));
+    EXPECT_EQ(kHeadersSize,
+              ReadData(entry, 0, 0, read_buffer.get(), kHeadersSize));
+    EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), kHeadersSize));
+    EXPECT_EQ(size, ReadData(entry, 1, 0, read_buffer.get(), size));
+    EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), size));
+
+    // Reads see writes to stream 1 made after the entry was opened.
+    const char kNewData[] = "new data";
+    scoped_refptr<net::IOBuffer> new_data(new net::StringIOBuffer(kNewData));
+    EXPECT_EQ(static_cast<int>(strlen(kNewData)),
+              WriteData(entry, 1, 0, new_data.get(), strlen(kNewData), true));
+    EXPECT_EQ(static_cast<int>(strlen(kNewData)),
+              ReadData(entry, 1, 0, read_buffer.get(), size));
+    EXPECT_EQ(0, memcmp(kNewData, read_buffer->data(), strlen(kNewData)));
+    entry->Close();
+  }
+}
+
+// An entry read whole when opened has its checksum checked right away.
+TEST_F(DiskCacheEntryTest, SimpleCacheSpeculativeOpenBadChecksum) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(disk_cache::kSimpleSpeculativeOpen);
+  SetSimpleCacheMode();
+  InitCache();
+
+  const char key[] = "the first key";
+  int size_unused;
+  ASSERT_TRUE(SimpleCacheMakeBadChecksumEntry(key, &size_unused));
+
+  disk_cache::Entry* entry = NULL;
+  EXPECT_NE(net::OK, OpenEntry(key, &entry));
+}
@@ -8,11 +8,14 @@
 #include <functional>
 #include <utility>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/memory/ptr_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/sys_info.h"
 #include "base/trace_event/memory_usage_estimator.h"
 #include "net/base/net_errors.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/cache_util.h"
 #include "net/disk_cache/memory/mem_entry_impl.h"
 
@@ -25,6 +28,9 @@ namespace {
 const int kDefaultInMemoryCacheSize = 10 * 1024 * 1024;
 const int kDefaultEvictionSize = kDefaultInMemoryCacheSize / 10;
 
+// The share of the cache, in percent, which protected entries may take up.
+const int kProtectedPercent = 80;
+
 bool CheckLRUListOrder(const base::LinkedList<MemEntryImpl>& lru_list) {
   // TODO(gavinp): Check MemBackendImpl::current_size_ here as well.
   base::Time previous_last_use_time;
@@ -37,17 +43,35 @@ bool CheckLRUListOrder(const base::LinkedList<MemEntryImpl>& lru_list) {
   return true;
 }
 
+int32_t GetDefaultMaxSize() {
+  int64_t total_memory = base::SysInfo::AmountOfPhysicalMemory();
+
+  if (total_memory <= 0)
+    return kDefaultInMemoryCacheSize;
+
+  // We want to use up to 2% of the computer's memory, with a limit of 50 MB,
+  // reached on system with more than 2.5 GB of RAM.
+  total_memory = total_memory * 2 / 100;
+  if (total_memory > kDefaultInMemoryCacheSize * 5)
+    return kDefaultInMemoryCacheSize * 5;
+  return static_cast<int32_t>(total_memory);
+}
+
 }  // namespace
 
 MemBackendImpl::MemBackendImpl(net::NetLog* net_log)
-    : max_size_(0), current_size_(0), net_log_(net_log), weak_factory_(this) {
-}
+    : max_size_(0),
+      current_size_(0),
+      protected_size_(0),
+      net_log_(net_log),
+      weak_factory_(this) {}
 
 MemBackendImpl::~MemBackendImpl() {
-  DCHECK(CheckLRUListOrder(lru_list_));
+  DCHECK(CheckLRUListOrder(protected_list_));
   while (!entries_.empty())
     entries_.begin()->second->Doom();
   DCHECK(!current_size_);
+  DCHECK(!protected_size_);
 }
 
 // static
@@ -63,24 +87,10 @@ std::unique_ptr<Backend> MemBackendImpl::CreateBackend(int max_bytes,
 }
 
 bool MemBackendImpl::Init() {
-  if (max_size_)
-    return true;
-
-  int64_t total_memory = base::SysInfo::AmountOfPhysicalMemory();
-
-  if (total_memory <= 0) {
-    max_size_ = kDefaultInMemoryCacheSize;
-    return true;
-  }
-
-  // We want to use up to 2% of the computer's memory, with a limit of 50 MB,
-  // reached on system with more than 2.5 GB of RAM.
-  total_memory = total_memory * 2 / 100;
-  if (total_memory > kDefaultInMemoryCacheSize * 5)
-    max_size_ = kDefaultInMemoryCacheSize * 5;
-  else
-    max_size_ = static_cast<int32_t>(total_memory);
-
+  if (!max_size_)
+    max_size_ = GetDefaultMaxSize();
+  admission_filter_ =
+      AdmissionFilter::MaybeCreate(net::MEMORY_CACHE, max_size_);
   return true;
 }
 
@@ -103,26 +113,46 @@ int MemBackendImpl::MaxFileSize() const {
 }
 
 void MemBackendImpl::OnEntryInserted(MemEntryImpl* entry) {
-  lru_list_.Append(entry);
+  entry->set_lru_segment(MemEntryImpl::LRU_PROBATIONARY);
+  probationary_list_.Append(entry);
 }
 
-void MemBackendImpl::OnEntryUpdated(MemEntryImpl* entry) {
-  DCHECK(CheckLRUListOrder(lru_list_));
-  // LinkedList<>::RemoveFromList() removes |entry| from |lru_list_|.
+void MemBackendImpl::OnEntryUpdated(MemEntryImpl* entry,
+                                    MemEntryImpl::EntryModified modified_enum) {
+  DCHECK(CheckLRUListOrder(protected_list_));
+  DCHECK_NE(MemEntryImpl::NOT_IN_LRU, entry->lru_segment());
+  // LinkedList<>::RemoveFromList() removes |entry| from its list.
   entry->RemoveFromList();
-  lru_list_.Append(entry);
+  // Writes alone don't promote an entry: every entry is written when it is
+  // created.
+  if (entry->lru_segment() == MemEntryImpl::LRU_PROBATIONARY &&
+      modified_enum == MemEntryImpl::ENTRY_WAS_NOT_MODIFIED) {
+    entry->set_lru_segment(MemEntryImpl::LRU_PROTECTED);
+    protected_size_ += entry->GetStorageSize();
+  }
+  if (entry->lru_segment() == MemEntryImpl::LRU_PROTECTED) {
+    protected_list_.Append(entry);
+    DemoteIfNeeded();
+  } else {
+    probationary_list_.Append(entry);
+  }
 }
 
 void MemBackendImpl::OnEntryDoomed(MemEntryImpl* entry) {
-  DCHECK(CheckLRUListOrder(lru_list_));
+  DCHECK(CheckLRUListOrder(protected_list_));
   if (entry->type() == MemEntryImpl::PARENT_ENTRY)
     entries_.erase(entry->key());
-  // LinkedList<>::RemoveFromList() removes |entry| from |lru_list_|.
+  if (entry->lru_segment() == MemEntryImpl::LRU_PROTECTED)
+    protected_size_ -= entry->GetStorageSize();
+  entry->set_lru_segment(MemEntryImpl::NOT_IN_LRU);
+  // LinkedList<>::RemoveFromList() removes |entry| from its list.
   entry->RemoveFromList();
 }
 
-void MemBackendImpl::ModifyStorageSize(int32_t delta) {
+void MemBackendImpl::ModifyStorageSize(MemEntryImpl* entry, int32_t delta) {
   current_size_ += delta;
+  if (entry->lru_segment() == MemEntryImpl::LRU_PROTECTED)
+    protected_size_ += delta;
   if (delta > 0)
     EvictIfNeeded();
 }
@@ -138,6 +168,9 @@ int32_t MemBackendImpl::GetEntryCount() const {
 int MemBackendImpl::OpenEntry(const std::string& key,
                               Entry** entry,
                               const CompletionCallback& callback) {
+  if (admission_filter_)
+    admission_filter_->RecordAccess(base::Hash(key));
+
   EntryMap::iterator it = entries_.find(key);
   if (it == entries_.end())
     return net::ERR_FAILED;
@@ -151,6 +184,9 @@ int MemBackendImpl::OpenEntry(const std::string& key,
 int MemBackendImpl::CreateEntry(const std::string& key,
                                 Entry** entry,
                                 const CompletionCallback& callback) {
+  if (!ShouldAdmit(key))
+    return net::ERR_CACHE_ENTRY_NOT_ADMITTED;
+
   std::pair<EntryMap::iterator, bool> create_result =
       entries_.insert(EntryMap::value_type(key, nullptr));
   const bool did_insert = create_result.second;
@@ -184,13 +220,26 @@ int MemBackendImpl::DoomEntriesBetween(Time initial_time,
     end_time = Time::Max();
   DCHECK_GE(end_time, initial_time);
 
-  base::LinkNode<MemEntryImpl>* node = lru_list_.head();
-  while (node != lru_list_.end() && node->value()->GetLastUsed() < initial_time)
-    node = node->next();
-  while (node != lru_list_.end() && node->value()->GetLastUsed() < end_time) {
-    MemEntryImpl* to_doom = node->value();
-    node = node->next();
-    to_doom->Doom();
+  // The segments are not ordered by last use time between each other, and the
+  // probationary segment isn't ordered within itself either, since entries
+  // demoted from the protected segment join it at its end.
+  for (base::LinkedList<MemEntryImpl>* lru_list :
+       {&probationary_list_, &protected_list_}) {
+    base::LinkNode<MemEntryImpl>* node = lru_list->head();
+    while (node != lru_list->end()) {
+      MemEntryImpl* to_doom = node->value();
+      node = node->next();
+      if (to_doom->GetLastUsed() < initial_time ||
+          to_doom->GetLastUsed() >= end_time) {
+        continue;
+      }
+      // Deleting a parent entry deletes its children, so step past those.
+      if (!to_doom->InUse()) {
+        while (node != lru_list->end() && node->value()->parent() == to_doom)
+          node = node->next();
+      }
+      to_doom->Doom();
+    }
   }
 
   return net::OK;
@@ -215,13 +264,16 @@ int MemBackendImpl::CalculateSizeOfEntriesBetween(
   DCHECK_GE(end_time, initial_time);
 
   int size = 0;
-  base::LinkNode<MemEntryImpl>* node = lru_list_.head();
-  while (node != lru_list_.end() && node->value()->GetLastUsed() < initial_time)
-    node = node->next();
-  while (node != lru_list_.end() && node->value()->GetLastUsed() < end_time) {
-    MemEntryImpl* entry = node->value();
-    size += entry->GetStorageSize();
-    node = node->next();
+  for (const base::LinkedList<MemEntryImpl>* lru_list :
+       {&probationary_list_, &protected_list_}) {
+    for (base::LinkNode<MemEntryImpl>* node = lru_list->head();
+         node != lru_list->end(); node = node->next()) {
+      MemEntryImpl* entry = node->value();
+      if (entry->GetLastUsed() >= initial_time &&
+          entry->GetLastUsed() < end_time) {
+        size += entry->GetStorageSize();
+      }
+    }
   }
   return size;
 }
@@ -278,6 +330,58 @@ std::unique_ptr<Backend::Iterator> MemBackendImpl::CreateIterator() {
       new MemIterator(weak_factory_.GetWeakPtr()));
 }
 
+void MemBackendImpl::GetStats(base::StringPairs* stats) {
+  size_t lru_entry_count = 0;
+  for (const base::LinkedList<MemEntryImpl>* lru_list :
+       {&probationary_list_, &protected_list_}) {
+    for (base::LinkNode<MemEntryImpl>* node = lru_list->head();
+         node != lru_list->end(); node = node->next()) {
+      ++lru_entry_count;
+    }
+  }
+  // Everything but the keys and data of the entries, spread over the entries
+  // and their sparse children.
+  const size_t memory_usage = EstimateMemoryUsage();
+  const size_t data_size = static_cast<size_t>(current_size_);
+  const size_t overhead =
+      memory_usage > data_size ? memory_usage - data_size : 0;
+
+  std::pair<std::string, std::string> item;
+
+  item.first = "Entries";
+  item.second = base::SizeTToString(entries_.size());
+  stats->push_back(item);
+
+  item.first = "Max size";
+  item.second = base::IntToString(max_size_);
+  stats->push_back(item);
+
+  item.first = "Current size";
+  item.second = base::IntToString(current_size_);
+  stats->push_back(item);
+
+  item.first = "Protected size";
+  item.second = base::IntToString(protected_size_);
+  stats->push_back(item);
+
+  item.first = "Arena allocated";
+  item.second = base::SizeTToString(arena_.allocated_bytes());
+  stats->push_back(item);
+
+  item.first = "Arena reserved";
+  item.second = base::SizeTToString(arena_.reserved_bytes());
+  stats->push_back(item);
+
+  item.first = "Overhead per entry";
+  item.second = base::SizeTToString(
+      lru_entry_count ? overhead / lru_entry_count : 0);
+  stats->push_back(item);
+
+  item.first = "Cache type";
+  item.second = "Memory Cache";
+  stats->push_back(item);
+}
+
 void MemBackendImpl::OnExternalCacheHit(const std::string& key) {
   EntryMap::iterator it = entries_.find(key);
   if (it != entries_.end())
@@ -285,10 +389,14 @@ void MemBackendImpl::OnExternalCacheHit(const std::string& key) {
 }
 
 size_t MemBackendImpl::EstimateMemoryUsage() const {
-  // Entries in lru_list_ will be counted by EMU but not in entries_ since
-  // they're pointers.
-  return base::trace_event::EstimateMemoryUsage(lru_list_) +
-         base::trace_event::EstimateMemoryUsage(entries_);
+  // Entries in the LRU lists will be counted by EMU but not in entries_ since
+  // they're pointers. Their data is counted as the size of their blocks in the
+  // arena, and the arena adds the rest of its slabs.
+  return base::trace_event::EstimateMemoryUsage(probationary_list_) +
+         base::trace_event::EstimateMemoryUsage(protected_list_) +
+         base::trace_event::EstimateMemoryUsage(entries_) +
+         arena_.EstimateMemoryUsage() +
+         (admission_filter_ ? admission_filter_->EstimateMemoryUsage() : 0);
 }
 
 void MemBackendImpl::EvictIfNeeded() {
@@ -296,13 +404,50 @@ void MemBackendImpl::EvictIfNeeded() {
     return;
 
   int target_size = std::max(0, max_size_ - kDefaultEvictionSize);
+  EvictFrom(&probationary_list_, target_size);
+  EvictFrom(&protected_list_, target_size);
+}
 
-  base::LinkNode<MemEntryImpl>* entry = lru_list_.head();
-  while (current_size_ > target_size && entry != lru_list_.end()) {
-    MemEntryImpl* to_doom = entry->value();
-    entry = entry->next();
-    if (!to_doom->InUse())
-      to_doom->Doom();
+void MemBackendImpl::EvictFrom(base::LinkedList<MemEntryImpl>* lru_list,
+                               int32_t target_size) {
+  base::LinkNode<MemEntryImpl>* node = lru_list->head();
+  while (current_size_ > target_size && node != lru_list->end()) {
+    MemEntryImpl* to_doom = node->value();
+    node = node->next();
+    if (to_doom->InUse())
+      continue;
+    // Deleting a parent entry deletes its children, so step past those.
+    while (node != lru_list->end() && node->value()->parent() == to_doom)
+      node = node->next();
+    to_doom->Doom();
+  }
+}
+
+bool MemBackendImpl::ShouldAdmit(const std::string& key) const {
+  if (!admission_filter_ ||
+      current_size_ <= std::max(0, max_size_ - kDefaultEvictionSize)) {
+    return true;
+  }
+  const base::LinkedList<MemEntryImpl>& lru_list =
+      probationary_list_.empty() ? protected_list_ : probationary_list_;
+  if (lru_list.empty())
+    return true;
+  const MemEntryImpl* victim = lru_list.head()->value();
+  if (victim->type() == MemEntryImpl::CHILD_ENTRY)
+    victim = victim->parent();
+  return admission_filter_->ShouldAdmit(base::Hash(key),
+                                        base::Hash(victim->key()));
+}
+
+void MemBackendImpl::DemoteIfNeeded() {
+  const int32_t max_protected_size = max_size_ / 100 * kProtectedPercent;
+  while (protected_size_ > max_protected_size) {
+    DCHECK(!protected_list_.empty());
+    MemEntryImpl* to_demote = protected_list_.head()->value();
+    to_demote->RemoveFromList();
+    to_demote->set_lru_segment(MemEntryImpl::LRU_PROBATIONARY);
+    protected_size_ -= to_demote->GetStorageSize();
+    probationary_list_.Append(to_demote);
   }
 }
 
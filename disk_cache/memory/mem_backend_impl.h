@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -21,6 +22,7 @@
 #include "net/base/net_export.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/memory/mem_entry_impl.h"
+#include "net/disk_cache/memory/mem_slab_arena.h"
 
 namespace net {
 class NetLog;
@@ -28,6 +30,8 @@ class NetLog;
 
 namespace disk_cache {
 
+class AdmissionFilter;
+
 // This class implements the Backend interface. An object of this class handles
 // the operations of the cache without writing to disk.
 class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
@@ -56,22 +60,27 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
   // called by MemEntryImpl to update the state of the backend during the entry
   // lifecycle.
 
-  // Signals that new entry has been created, and should be placed in
-  // |lru_list_| so that it is eligable for eviction.
+  // Signals that new entry has been created, and should be placed in the
+  // probationary segment of the LRU so that it is eligable for eviction.
   void OnEntryInserted(MemEntryImpl* entry);
 
-  // Signals that an entry has been updated, and thus should be moved to the end
-  // of |lru_list_|.
-  void OnEntryUpdated(MemEntryImpl* entry);
+  // Signals that an entry has been used, and thus should be moved to the end of
+  // its segment of the LRU. An entry which is read is moved to the protected
+  // segment.
+  void OnEntryUpdated(MemEntryImpl* entry,
+                      MemEntryImpl::EntryModified modified_enum);
 
   // Signals that an entry has been doomed, and so it should be removed from the
-  // list of active entries as appropriate, as well as removed from the
-  // |lru_list_|.
+  // list of active entries as appropriate, as well as removed from the LRU.
   void OnEntryDoomed(MemEntryImpl* entry);
 
-  // Adjust the current size of this backend by |delta|. This is used to
-  // determine if eviction is neccessary and when eviction is finished.
-  void ModifyStorageSize(int32_t delta);
+  // Adjust the current size of this backend by |delta|, a change in the size of
+  // |entry|. This is used to determine if eviction is neccessary and when
+  // eviction is finished.
+  void ModifyStorageSize(MemEntryImpl* entry, int32_t delta);
+
+  // The arena holding the data of the entries.
+  MemSlabArena* arena() { return &arena_; }
 
   // Backend interface.
   net::CacheType GetCacheType() const override;
@@ -96,7 +105,7 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
       base::Time end_time,
       const CompletionCallback& callback) override;
   std::unique_ptr<Iterator> CreateIterator() override;
-  void GetStats(base::StringPairs* stats) override {}
+  void GetStats(base::StringPairs* stats) override;
   void OnExternalCacheHit(const std::string& key) override;
   size_t EstimateMemoryUsage() const override;
 
@@ -109,14 +118,40 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
   // Deletes entries from the cache until the current size is below the limit.
   void EvictIfNeeded();
 
+  // Deletes the entries of |lru_list| which are not in use, from the least
+  // recently used, until the current size is at most |target_size|.
+  void EvictFrom(base::LinkedList<MemEntryImpl>* lru_list, int32_t target_size);
+
+  // Returns false if |admission_filter_| turns down a new entry for |key|, in
+  // favor of the entry eviction would remove next.
+  bool ShouldAdmit(const std::string& key) const;
+
+  // Moves the least recently used protected entries to the probationary
+  // segment until the protected segment is within its share of the cache.
+  void DemoteIfNeeded();
+
   EntryMap entries_;
 
-  // Stored in increasing order of last use time, from least recently used to
-  // most recently used.
-  base::LinkedList<MemEntryImpl> lru_list_;
+  // The LRU is segmented, so that a scan of entries which are written once and
+  // never read again can't flush out the entries which are in use. Entries
+  // start in |probationary_list_|, and move to |protected_list_| when they are
+  // read. The protected segment is capped, and the entries which fall out of it
+  // go back to the probationary segment. Eviction takes from the probationary
+  // segment first. Each list is ordered from least recently used to most
+  // recently used.
+  base::LinkedList<MemEntryImpl> probationary_list_;
+  base::LinkedList<MemEntryImpl> protected_list_;
 
   int32_t max_size_;      // Maximum data size for this instance.
   int32_t current_size_;
+  int32_t protected_size_;  // The part of |current_size_| that is protected.
+
+  // Holds the data of the entries. The destructor deletes all the entries
+  // before the arena goes away.
+  MemSlabArena arena_;
+
+  // Null unless kDiskCacheAdmissionFilter is enabled.
+  std::unique_ptr<AdmissionFilter> admission_filter_;
 
   net::NetLog* net_log_;
 
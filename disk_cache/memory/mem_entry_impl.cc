@@ -81,7 +81,7 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
                    nullptr,  // parent
                    net_log) {
   Open();
-  backend_->ModifyStorageSize(GetStorageSize());
+  backend_->ModifyStorageSize(this, GetStorageSize());
 }
 
 MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
@@ -120,7 +120,7 @@ int MemEntryImpl::GetStorageSize() const {
 
 void MemEntryImpl::UpdateStateOnUse(EntryModified modified_enum) {
   if (!doomed_)
-    backend_->OnEntryUpdated(this);
+    backend_->OnEntryUpdated(this, modified_enum);
 
   last_used_ = Time::Now();
   if (modified_enum == ENTRY_WAS_MODIFIED)
@@ -276,7 +276,10 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
       last_modified_(Time::Now()),
       last_used_(last_modified_),
       backend_(backend),
-      doomed_(false) {
+      doomed_(false),
+      lru_segment_(NOT_IN_LRU) {
+  for (StreamData& data : data_)
+    data = StreamData(MemSlabAllocator<char>(backend_->arena()));
   backend_->OnEntryInserted(this);
   net_log_ = net::NetLogWithSource::Make(
       net_log, net::NetLogSourceType::MEMORY_CACHE_ENTRY);
@@ -285,7 +288,7 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
 }
 
 MemEntryImpl::~MemEntryImpl() {
-  backend_->ModifyStorageSize(-GetStorageSize());
+  backend_->ModifyStorageSize(this, -GetStorageSize());
 
   if (type() == PARENT_ENTRY) {
     if (children_) {
@@ -353,7 +356,7 @@ int MemEntryImpl::InternalWriteData(int index, int offset, IOBuffer* buf,
                 data_[index].begin() + offset, 0);
     }
 
-    backend_->ModifyStorageSize(data_[index].size() - old_data_size);
+    backend_->ModifyStorageSize(this, data_[index].size() - old_data_size);
   }
 
   UpdateStateOnUse(ENTRY_WAS_MODIFIED);
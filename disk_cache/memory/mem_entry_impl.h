@@ -19,6 +19,7 @@
 #include "base/trace_event/memory_usage_estimator.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/memory/mem_slab_arena.h"
 #include "net/log/net_log_with_source.h"
 
 namespace net {
@@ -71,6 +72,15 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
     ENTRY_WAS_MODIFIED,
   };
 
+  // The segment of the backend LRU list this entry is in.
+  enum LRUSegment {
+    NOT_IN_LRU,
+    // Entries which have not been read since they were inserted.
+    LRU_PROBATIONARY,
+    // Entries which have been read at least once.
+    LRU_PROTECTED,
+  };
+
   // Constructor for parent entries.
   MemEntryImpl(MemBackendImpl* backend,
                const std::string& key,
@@ -90,6 +100,8 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
   const MemEntryImpl* parent() const { return parent_; }
   int child_id() const { return child_id_; }
   base::Time last_used() const { return last_used_; }
+  LRUSegment lru_segment() const { return lru_segment_; }
+  void set_lru_segment(LRUSegment lru_segment) { lru_segment_ = lru_segment; }
 
   // The in-memory size of this entry to use for the purposes of eviction.
   int GetStorageSize() const;
@@ -170,8 +182,10 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
   // bytes in the entry. The first child found is output to |child|.
   int FindNextChild(int64_t offset, int len, MemEntryImpl** child);
 
+  using StreamData = std::vector<char, MemSlabAllocator<char>>;
+
   std::string key_;
-  std::vector<char> data_[kNumStreams];  // User data.
+  StreamData data_[kNumStreams];  // User data, allocated from the backend.
   int ref_count_;
 
   int child_id_;              // The ID of a child entry.
@@ -185,6 +199,7 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
   base::Time last_used_;
   MemBackendImpl* backend_;   // Back pointer to the cache.
   bool doomed_;               // True if this entry was removed from the cache.
+  LRUSegment lru_segment_;
 
   net::NetLogWithSource net_log_;
 
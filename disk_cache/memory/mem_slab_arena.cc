@@ -0,0 +1,156 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/memory/mem_slab_arena.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "base/memory/aligned_memory.h"
+
+namespace disk_cache {
+
+namespace {
+
+// Powers of two, and the halfway points between them, so that no more than a
+// third of a block goes to waste.
+const size_t kBlockSizes[] = {16,    32,    48,    64,    96,   128,
+                              192,   256,   384,   512,   768,  1024,
+                              1536,  2048,  3072,  4096,  6144, 8192,
+                              12288, 16384, 24576, 32768};
+
+size_t GetSizeClass(size_t size) {
+  return std::lower_bound(std::begin(kBlockSizes), std::end(kBlockSizes),
+                          size) -
+         std::begin(kBlockSizes);
+}
+
+}  // namespace
+
+const size_t MemSlabArena::kSlabSize;
+const size_t MemSlabArena::kMaxSlabBlockSize;
+const size_t MemSlabArena::kNumSizeClasses;
+
+struct MemSlabArena::Slab : public base::LinkNode<Slab> {
+  Slab(char* memory, size_t size_class)
+      : memory(memory),
+        size_class(size_class),
+        block_size(kBlockSizes[size_class]),
+        live_blocks(0),
+        unused_offset(0),
+        free_list(nullptr),
+        in_partial_list(false) {}
+
+  char* const memory;
+  const size_t size_class;
+  const size_t block_size;
+  size_t live_blocks;
+  // The blocks from here to the end of the slab have never been allocated.
+  size_t unused_offset;
+  // Freed blocks, each holding a pointer to the next one.
+  char* free_list;
+  bool in_partial_list;
+};
+
+MemSlabArena::MemSlabArena() : allocated_bytes_(0), reserved_bytes_(0) {
+  static_assert(arraysize(kBlockSizes) == kNumSizeClasses,
+                "kNumSizeClasses does not match kBlockSizes");
+  DCHECK_EQ(kMaxSlabBlockSize, kBlockSizes[kNumSizeClasses - 1]);
+}
+
+MemSlabArena::~MemSlabArena() {
+  DCHECK_EQ(0u, allocated_bytes_);
+  for (const auto& it : slabs_)
+    base::AlignedFree(it.second->memory);
+}
+
+char* MemSlabArena::Allocate(size_t size) {
+  if (size > kMaxSlabBlockSize) {
+    allocated_bytes_ += size;
+    reserved_bytes_ += size;
+    return new char[size];
+  }
+
+  const size_t size_class = GetSizeClass(size);
+  base::LinkedList<Slab>& partial_slabs = partial_slabs_[size_class];
+  if (partial_slabs.empty())
+    AddSlab(size_class);
+
+  Slab* slab = partial_slabs.head()->value();
+  char* block;
+  if (slab->free_list) {
+    block = slab->free_list;
+    slab->free_list = *reinterpret_cast<char**>(block);
+  } else {
+    block = slab->memory + slab->unused_offset;
+    slab->unused_offset += slab->block_size;
+  }
+  ++slab->live_blocks;
+  allocated_bytes_ += slab->block_size;
+
+  if (!slab->free_list && slab->unused_offset + slab->block_size > kSlabSize) {
+    slab->RemoveFromList();
+    slab->in_partial_list = false;
+  }
+  return block;
+}
+
+void MemSlabArena::Free(char* block, size_t size) {
+  if (size > kMaxSlabBlockSize) {
+    allocated_bytes_ -= size;
+    reserved_bytes_ -= size;
+    delete[] block;
+    return;
+  }
+
+  auto it = slabs_.find(reinterpret_cast<uintptr_t>(block) & ~(kSlabSize - 1));
+  DCHECK(it != slabs_.end());
+  Slab* slab = it->second.get();
+  DCHECK_EQ(GetSizeClass(size), slab->size_class);
+
+  *reinterpret_cast<char**>(block) = slab->free_list;
+  slab->free_list = block;
+  --slab->live_blocks;
+  allocated_bytes_ -= slab->block_size;
+
+  base::LinkedList<Slab>& partial_slabs = partial_slabs_[slab->size_class];
+  if (!slab->in_partial_list) {
+    partial_slabs.Append(slab);
+    slab->in_partial_list = true;
+  }
+
+  // Keep one slab with room in each size class, so that a block allocated and
+  // freed over and over doesn't get a new slab each time.
+  if (slab->live_blocks == 0 && partial_slabs.head() != partial_slabs.tail()) {
+    slab->RemoveFromList();
+    base::AlignedFree(slab->memory);
+    reserved_bytes_ -= kSlabSize;
+    slabs_.erase(it);
+  }
+}
+
+// static
+size_t MemSlabArena::GetBlockSize(size_t size) {
+  if (size > kMaxSlabBlockSize)
+    return size;
+  return kBlockSizes[GetSizeClass(size)];
+}
+
+size_t MemSlabArena::EstimateMemoryUsage() const {
+  // Roughly, a Slab and a hash table node for each slab.
+  return reserved_bytes_ - allocated_bytes_ +
+         slabs_.size() * (sizeof(Slab) + 4 * sizeof(void*));
+}
+
+void MemSlabArena::AddSlab(size_t size_class) {
+  char* memory = static_cast<char*>(base::AlignedAlloc(kSlabSize, kSlabSize));
+  std::unique_ptr<Slab> slab(new Slab(memory, size_class));
+  partial_slabs_[size_class].Append(slab.get());
+  slab->in_partial_list = true;
+  slabs_[reinterpret_cast<uintptr_t>(memory)] = std::move(slab);
+  reserved_bytes_ += kSlabSize;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,130 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_MEMORY_MEM_SLAB_ARENA_H_
+#define NET_DISK_CACHE_MEMORY_MEM_SLAB_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+#include "base/containers/linked_list.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "net/base/net_export.h"
+
+namespace disk_cache {
+
+// Holds the payloads of the entries of a MemBackendImpl. Small blocks are
+// rounded up to one of a few size classes and carved out of large slabs, one
+// size class per slab, so that the many small streams of a memory cache don't
+// each pay for a heap allocation and its header, and so that the memory they
+// use can be accounted for. Blocks larger than the largest size class come
+// from the heap.
+//
+// Freed blocks are kept on a free list in their slab; a slab is given back to
+// the heap when its last block is freed, unless it is the only slab of its size
+// class with room left. Not thread safe.
+class NET_EXPORT_PRIVATE MemSlabArena {
+ public:
+  // Slabs are this large, and aligned to their size.
+  static const size_t kSlabSize = 256 * 1024;
+
+  // Blocks larger than this are allocated from the heap.
+  static const size_t kMaxSlabBlockSize = 32 * 1024;
+
+  MemSlabArena();
+  ~MemSlabArena();
+
+  // Returns a block of at least |size| bytes, aligned to 16 bytes if it comes
+  // from a slab.
+  char* Allocate(size_t size);
+
+  // Frees |block|, which was returned by Allocate(|size|).
+  void Free(char* block, size_t size);
+
+  // Returns the number of bytes used up by an allocation of |size| bytes.
+  static size_t GetBlockSize(size_t size);
+
+  // The total size of the blocks in use.
+  size_t allocated_bytes() const { return allocated_bytes_; }
+
+  // The memory taken from the heap: the slabs, and the blocks too large for
+  // them.
+  size_t reserved_bytes() const { return reserved_bytes_; }
+
+  // Returns the memory reserved but not allocated, and the bookkeeping of the
+  // slabs.
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  struct Slab;
+
+  static const size_t kNumSizeClasses = 22;
+
+  // Adds an empty slab for |size_class|.
+  void AddSlab(size_t size_class);
+
+  // Slabs by the address of their memory.
+  std::unordered_map<uintptr_t, std::unique_ptr<Slab>> slabs_;
+
+  // For each size class, the slabs which have free blocks.
+  base::LinkedList<Slab> partial_slabs_[kNumSizeClasses];
+
+  size_t allocated_bytes_;
+  size_t reserved_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemSlabArena);
+};
+
+// An allocator for standard containers which takes its memory from a
+// MemSlabArena. The arena must outlive the container.
+template <typename T>
+class MemSlabAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  // The default allocator has no arena, and must be assigned one before it
+  // allocates.
+  MemSlabAllocator() : arena_(nullptr) {}
+  explicit MemSlabAllocator(MemSlabArena* arena) : arena_(arena) {}
+  template <typename U>
+  MemSlabAllocator(const MemSlabAllocator<U>& other)
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    DCHECK(arena_);
+    return reinterpret_cast<T*>(arena_->Allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    DCHECK(arena_);
+    arena_->Free(reinterpret_cast<char*>(p), n * sizeof(T));
+  }
+
+  MemSlabArena* arena() const { return arena_; }
+
+ private:
+  MemSlabArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const MemSlabAllocator<T>& a, const MemSlabAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const MemSlabAllocator<T>& a, const MemSlabAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_MEMORY_MEM_SLAB_ARENA_H_
@@ -0,0 +1,95 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/memory/mem_slab_arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+TEST(MemSlabArenaTest, BlockSizes) {
+  EXPECT_EQ(16u, MemSlabArena::GetBlockSize(1));
+  EXPECT_EQ(16u, MemSlabArena::GetBlockSize(16));
+  EXPECT_EQ(48u, MemSlabArena::GetBlockSize(33));
+  EXPECT_EQ(4096u, MemSlabArena::GetBlockSize(4096));
+  EXPECT_EQ(6144u, MemSlabArena::GetBlockSize(4097));
+  EXPECT_EQ(MemSlabArena::kMaxSlabBlockSize,
+            MemSlabArena::GetBlockSize(MemSlabArena::kMaxSlabBlockSize));
+  EXPECT_EQ(MemSlabArena::kMaxSlabBlockSize + 1,
+            MemSlabArena::GetBlockSize(MemSlabArena::kMaxSlabBlockSize + 1));
+}
+
+TEST(MemSlabArenaTest, AllocateAndFree) {
+  MemSlabArena arena;
+  const size_t kSize = 100;
+  const size_t kCount = 2 * MemSlabArena::kSlabSize / kSize;
+  const size_t block_size = MemSlabArena::GetBlockSize(kSize);
+
+  std::vector<char*> blocks;
+  for (size_t i = 0; i < kCount; ++i) {
+    char* block = arena.Allocate(kSize);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(block) % 16);
+    memset(block, static_cast<int>(i), kSize);
+    blocks.push_back(block);
+  }
+  EXPECT_EQ(kCount * block_size, arena.allocated_bytes());
+  EXPECT_GE(arena.reserved_bytes(), arena.allocated_bytes());
+  EXPECT_EQ(0u, arena.reserved_bytes() % MemSlabArena::kSlabSize);
+
+  // The blocks don't overlap.
+  for (size_t i = 0; i < kCount; ++i)
+    EXPECT_EQ(static_cast<char>(i), blocks[i][kSize - 1]);
+
+  // Freed blocks are reused.
+  const size_t reserved_bytes = arena.reserved_bytes();
+  arena.Free(blocks[0], kSize);
+  for (size_t i = 0; i < 10; ++i) {
+    char* block = arena.Allocate(kSize);
+    arena.Free(block, kSize);
+  }
+  EXPECT_EQ(reserved_bytes, arena.reserved_bytes());
+  blocks[0] = arena.Allocate(kSize);
+
+  for (char* block : blocks)
+    arena.Free(block, kSize);
+  EXPECT_EQ(0u, arena.allocated_bytes());
+  // One empty slab is kept for the size class.
+  EXPECT_EQ(MemSlabArena::kSlabSize, arena.reserved_bytes());
+}
+
+TEST(MemSlabArenaTest, LargeBlocks) {
+  MemSlabArena arena;
+  const size_t kSize = MemSlabArena::kMaxSlabBlockSize + 1;
+  char* block = arena.Allocate(kSize);
+  ASSERT_TRUE(block);
+  memset(block, 0, kSize);
+  EXPECT_EQ(kSize, arena.allocated_bytes());
+  EXPECT_EQ(kSize, arena.reserved_bytes());
+  arena.Free(block, kSize);
+  EXPECT_EQ(0u, arena.allocated_bytes());
+  EXPECT_EQ(0u, arena.reserved_bytes());
+}
+
+TEST(MemSlabArenaTest, Allocator) {
+  MemSlabArena arena;
+  {
+    std::vector<char, MemSlabAllocator<char>> data(
+        (MemSlabAllocator<char>(&arena)));
+    data.resize(1000);
+    EXPECT_EQ(MemSlabArena::GetBlockSize(1000), arena.allocated_bytes());
+  }
+  EXPECT_EQ(0u, arena.allocated_bytes());
+}
+
+}  // namespace
+
+}  // namespace disk_cache
@@ -32,6 +32,7 @@
 #include "base/time/time.h"
 #include "base/trace_event/memory_usage_estimator.h"
 #include "net/base/net_errors.h"
+#include "net/disk_cache/admission_filter.h"
 #include "net/disk_cache/cache_util.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
 #include "net/disk_cache/simple/simple_entry_impl.h"
@@ -39,6 +40,8 @@
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_index.h"
 #include "net/disk_cache/simple/simple_index_file.h"
+#include "net/disk_cache/simple/simple_io_engine.h"
+#include "net/disk_cache/simple/simple_packed_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "net/disk_cache/simple/simple_version_upgrade.h"
@@ -247,6 +250,7 @@ SimpleBackendImpl::SimpleBackendImpl(
     : path_(path),
       cache_type_(cache_type),
       cache_thread_(cache_thread),
+      io_engine_(nullptr),
       orig_max_size_(max_bytes),
       entry_operations_mode_(cache_type == net::DISK_CACHE ?
                                  SimpleEntryImpl::OPTIMISTIC_OPERATIONS :
@@ -262,17 +266,24 @@ SimpleBackendImpl::~SimpleBackendImpl() {
 int SimpleBackendImpl::Init(const CompletionCallback& completion_callback) {
   worker_pool_ = g_sequenced_worker_pool.Get().GetTaskRunner();
 
+  const SimpleExperiment experiment = GetSimpleExperiment(cache_type_);
+  if (experiment.type == SimpleExperimentType::PACKED)
+    packed_store_ = new SimplePackedStore(path_, worker_pool_);
+  io_engine_ = SimpleIOEngine::Get();
+
   index_.reset(new SimpleIndex(
       base::ThreadTaskRunnerHandle::Get(), this, cache_type_,
       base::MakeUnique<SimpleIndexFile>(cache_thread_, worker_pool_.get(),
-                                        cache_type_, path_)));
+                                        cache_type_, path_,
+                                        packed_store_.get())));
   index_->ExecuteWhenReady(
       base::Bind(&RecordIndexLoad, cache_type_, base::TimeTicks::Now()));
 
   PostTaskAndReplyWithResult(
       cache_thread_.get(), FROM_HERE,
       base::Bind(&SimpleBackendImpl::InitCacheStructureOnDisk, path_,
-                 orig_max_size_, GetSimpleExperiment(cache_type_)),
+                 orig_max_size_, experiment,
+                 base::RetainedRef(packed_store_)),
       base::Bind(&SimpleBackendImpl::InitializeIndex, AsWeakPtr(),
                  completion_callback));
   return net::ERR_IO_PENDING;
@@ -364,7 +375,8 @@ void SimpleBackendImpl::DoomEntries(std::vector<uint64_t>* entry_hashes,
                              FROM_HERE,
                              base::Bind(&SimpleSynchronousEntry::DoomEntrySet,
                                         mass_doom_entry_hashes_ptr,
-                                        path_),
+                                        path_,
+                                        base::RetainedRef(packed_store_)),
                              base::Bind(&SimpleBackendImpl::DoomEntriesComplete,
                                         AsWeakPtr(),
                                         base::Passed(&mass_doom_entry_hashes),
@@ -397,6 +409,8 @@ int SimpleBackendImpl::OpenEntry(const std::string& key,
                                     operation, callback));
     return net::ERR_IO_PENDING;
   }
+  if (admission_filter_)
+    admission_filter_->RecordAccess(entry_hash);
   scoped_refptr<SimpleEntryImpl> simple_entry =
       CreateOrFindActiveEntry(entry_hash, key);
   return simple_entry->OpenEntry(entry, callback);
@@ -418,6 +432,8 @@ int SimpleBackendImpl::CreateEntry(const std::string& key,
                                     operation, callback));
     return net::ERR_IO_PENDING;
   }
+  if (!ShouldAdmit(entry_hash))
+    return net::ERR_CACHE_ENTRY_NOT_ADMITTED;
   scoped_refptr<SimpleEntryImpl> simple_entry =
       CreateOrFindActiveEntry(entry_hash, key);
   return simple_entry->CreateEntry(entry, callback);
@@ -564,7 +580,8 @@ size_t SimpleBackendImpl::EstimateMemoryUsage() const {
   // TODO(xunjieli): crbug.com/669108. Track |entries_pending_doom_| once
   // base::Closure is suppported in memory_usage_estimator.h.
   return base::trace_event::EstimateMemoryUsage(index_) +
-         base::trace_event::EstimateMemoryUsage(active_entries_);
+         base::trace_event::EstimateMemoryUsage(active_entries_) +
+         (admission_filter_ ? admission_filter_->EstimateMemoryUsage() : 0);
 }
 
 void SimpleBackendImpl::InitializeIndex(const CompletionCallback& callback,
@@ -572,10 +589,18 @@ void SimpleBackendImpl::InitializeIndex(const CompletionCallback& callback,
   if (result.net_error == net::OK) {
     index_->SetMaxSize(result.max_size);
     index_->Initialize(result.cache_dir_mtime);
+    admission_filter_ =
+        AdmissionFilter::MaybeCreate(cache_type_, result.max_size);
   }
   callback.Run(result.net_error);
 }
 
+bool SimpleBackendImpl::ShouldAdmit(uint64_t entry_hash) const {
+  uint64_t victim_hash;
+  return !admission_filter_ || !index_->GetEvictionCandidate(&victim_hash) ||
+         admission_filter_->ShouldAdmit(entry_hash, victim_hash);
+}
+
 void SimpleBackendImpl::IndexReadyForDoom(Time initial_time,
                                           Time end_time,
                                           const CompletionCallback& callback,
@@ -613,7 +638,8 @@ void SimpleBackendImpl::IndexReadyForSizeBetweenCalculation(
 SimpleBackendImpl::DiskStatResult SimpleBackendImpl::InitCacheStructureOnDisk(
     const base::FilePath& path,
     uint64_t suggested_max_size,
-    const SimpleExperiment& experiment) {
+    const SimpleExperiment& experiment,
+    SimplePackedStore* packed_store) {
   DiskStatResult result;
   result.max_size = suggested_max_size;
   result.net_error = net::OK;
@@ -638,6 +664,9 @@ SimpleBackendImpl::DiskStatResult SimpleBackendImpl::InitCacheStructureOnDisk(
       }
     }
     DCHECK(result.max_size);
+
+    if (packed_store)
+      packed_store->Load();
   }
   return result;
 }
@@ -47,8 +47,11 @@ namespace disk_cache {
 // The non-static functions below must be called on the IO thread unless
 // otherwise stated.
 
+class AdmissionFilter;
 class SimpleEntryImpl;
 class SimpleIndex;
+class SimpleIOEngine;
+class SimplePackedStore;
 
 class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
     public SimpleIndexDelegate,
@@ -68,6 +71,13 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
 
   base::TaskRunner* worker_pool() { return worker_pool_.get(); }
 
+  // Returns null unless small entries are packed into shared segment files.
+  SimplePackedStore* packed_store() { return packed_store_.get(); }
+
+  // Returns null unless entries run their file operations through a
+  // SimpleIOEngine.
+  SimpleIOEngine* io_engine() { return io_engine_; }
+
   int Init(const CompletionCallback& completion_callback);
 
   // Sets the maximum size for the total amount of data stored by this instance.
@@ -142,6 +152,10 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
   void InitializeIndex(const CompletionCallback& callback,
                        const DiskStatResult& result);
 
+  // Returns false if |admission_filter_| turns down a new entry with
+  // |entry_hash|, in favor of the entry it would make eviction remove.
+  bool ShouldAdmit(uint64_t entry_hash) const;
+
   // Dooms all entries previously accessed between |initial_time| and
   // |end_time|. Invoked when the index is ready.
   void IndexReadyForDoom(base::Time initial_time,
@@ -160,12 +174,13 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
                                            const CompletionCallback& callback,
                                            int result);
 
-  // Try to create the directory if it doesn't exist. This must run on the IO
-  // thread.
+  // Try to create the directory if it doesn't exist, and load |packed_store|
+  // if there is one. This must run on the IO thread.
   static DiskStatResult InitCacheStructureOnDisk(
       const base::FilePath& path,
       uint64_t suggested_max_size,
-      const SimpleExperiment& experiment);
+      const SimpleExperiment& experiment,
+      SimplePackedStore* packed_store);
 
   // Searches |active_entries_| for the entry corresponding to |key|. If found,
   // returns the found entry. Otherwise, creates a new entry and returns that.
@@ -216,6 +231,11 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
   std::unique_ptr<SimpleIndex> index_;
   const scoped_refptr<base::SingleThreadTaskRunner> cache_thread_;
   scoped_refptr<base::TaskRunner> worker_pool_;
+  scoped_refptr<SimplePackedStore> packed_store_;
+  SimpleIOEngine* io_engine_;
+  // Null unless kDiskCacheAdmissionFilter is enabled. Created once the size of
+  // the cache is known.
+  std::unique_ptr<AdmissionFilter> admission_filter_;
 
   int orig_max_size_;
   const SimpleEntryImpl::OperationsMode entry_operations_mode_;
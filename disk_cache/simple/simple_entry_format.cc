@@ -23,4 +23,9 @@ SimpleFileSparseRangeHeader::SimpleFileSparseRangeHeader() {
   std::memset(this, 0, sizeof(*this));
 }
 
+SimplePackedRecordHeader::SimplePackedRecordHeader() {
+  // Make hashing repeatable: leave no padding bytes untouched.
+  std::memset(this, 0, sizeof(*this));
+}
+
 }  // namespace disk_cache
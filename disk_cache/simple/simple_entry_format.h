@@ -14,6 +14,7 @@ namespace disk_cache {
 const uint64_t kSimpleInitialMagicNumber = UINT64_C(0xfcfb6d1ba7725c30);
 const uint64_t kSimpleFinalMagicNumber = UINT64_C(0xf4fa6f45970d41d8);
 const uint64_t kSimpleSparseRangeMagicNumber = UINT64_C(0xeb97bf016553676b);
+const uint64_t kSimplePackedRecordMagicNumber = UINT64_C(0x9d2c5680a3e1f7b4);
 
 // A file containing stream 0 and stream 1 in the Simple cache consists of:
 //   - a SimpleFileHeader.
@@ -72,6 +73,30 @@ struct SimpleFileSparseRangeHeader {
   uint32_t data_crc32;
 };
 
+// A segment file of the packed storage layout (see SimplePackedStore) is a
+// sequence of records, each of which consists of:
+//   - a SimplePackedRecordHeader.
+//   - the key.
+//   - the data from streams 0, 1 and 2, in that order.
+// A record with FLAG_REMOVED set has no key or data, and marks the removal of
+// any earlier record for the same entry hash.
+struct NET_EXPORT_PRIVATE SimplePackedRecordHeader {
+  enum Flags {
+    FLAG_REMOVED = (1U << 0),
+  };
+
+  SimplePackedRecordHeader();
+
+  uint64_t packed_record_magic_number;
+  uint64_t entry_hash;
+  uint32_t flags;
+  uint32_t key_length;
+  int32_t data_size[kSimpleEntryStreamCount];
+  // CRC32 of the key followed by the data of all streams.
+  uint32_t data_crc32;
+  int64_t last_modified;
+};
+
 }  // namespace disk_cache
 
 #endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_ENTRY_FORMAT_H_
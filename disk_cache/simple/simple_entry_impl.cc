@@ -28,6 +28,7 @@
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_index.h"
 #include "net/disk_cache/simple/simple_net_log_parameters.h"
+#include "net/disk_cache/simple/simple_packed_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "net/log/net_log.h"
@@ -183,6 +184,8 @@ SimpleEntryImpl::SimpleEntryImpl(net::CacheType cache_type,
     : backend_(backend->AsWeakPtr()),
       cache_type_(cache_type),
       worker_pool_(backend->worker_pool()),
+      packed_store_(backend->packed_store()),
+      io_engine_(backend->io_engine()),
       path_(path),
       entry_hash_(entry_hash),
       use_optimistic_operations_(operations_mode == OPTIMISTIC_OPERATIONS),
@@ -557,7 +560,8 @@ size_t SimpleEntryImpl::EstimateMemoryUsage() const {
   return sizeof(SimpleSynchronousEntry) +
          base::trace_event::EstimateMemoryUsage(pending_operations_) +
          base::trace_event::EstimateMemoryUsage(executing_operation_) +
-         (stream_0_data_ ? stream_0_data_->capacity() : 0);
+         (stream_0_data_ ? stream_0_data_->capacity() : 0) +
+         (stream_1_data_ ? stream_1_data_->capacity() : 0);
 }
 
 SimpleEntryImpl::~SimpleEntryImpl() {
@@ -716,7 +720,8 @@ void SimpleEntryImpl::OpenEntryInternal(bool have_index,
       new SimpleEntryCreationResults(SimpleEntryStat(
           last_used_, last_modified_, data_size_, sparse_data_size_)));
   Closure task =
-      base::Bind(&SimpleSynchronousEntry::OpenEntry, cache_type_, path_, key_,
+      base::Bind(&SimpleSynchronousEntry::OpenEntry, cache_type_, path_,
+                 base::RetainedRef(packed_store_), io_engine_, key_,
                  entry_hash_, have_index, results.get());
   Closure reply =
       base::Bind(&SimpleEntryImpl::CreationOperationComplete, this, callback,
@@ -760,6 +765,8 @@ void SimpleEntryImpl::CreateEntryInternal(bool have_index,
   Closure task = base::Bind(&SimpleSynchronousEntry::CreateEntry,
                             cache_type_,
                             path_,
+                            base::RetainedRef(packed_store_),
+                            io_engine_,
                             key_,
                             entry_hash_,
                             have_index,
@@ -862,7 +869,21 @@ void SimpleEntryImpl::ReadDataInternal(int stream_index,
 
   // Since stream 0 data is kept in memory, it is read immediately.
   if (stream_index == 0) {
-    int ret_value = ReadStream0Data(buf, offset, buf_len);
+    int ret_value = ReadInMemoryData(stream_0_data_.get(), buf, offset,
+                                     buf_len);
+    if (!callback.is_null()) {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::Bind(callback, ret_value));
+    }
+    return;
+  }
+
+  // So is stream 1 data that was read along with stream 0.
+  if (stream_index == 1 && stream_1_data_) {
+    if (!doomed_ && backend_.get())
+      backend_->index()->UseIfExists(entry_hash_);
+    int ret_value = ReadInMemoryData(stream_1_data_.get(), buf, offset,
+                                     buf_len);
     if (!callback.is_null()) {
       base::ThreadTaskRunnerHandle::Get()->PostTask(
           FROM_HERE, base::Bind(callback, ret_value));
@@ -950,6 +971,8 @@ void SimpleEntryImpl::WriteDataInternal(int stream_index,
   if (!doomed_ && backend_.get())
     backend_->index()->UseIfExists(entry_hash_);
 
+  if (stream_index == 1)
+    stream_1_data_ = nullptr;
   AdvanceCrc(buf, offset, buf_len, stream_index);
 
   // |entry_stat| needs to be initialized before modifying |data_size_|.
@@ -1100,7 +1123,7 @@ void SimpleEntryImpl::DoomEntryInternal(const CompletionCallback& callback) {
     PostTaskAndReplyWithResult(
         worker_pool_.get(), FROM_HERE,
         base::Bind(&SimpleSynchronousEntry::TruncateEntryFiles, path_,
-                   entry_hash_),
+                   base::RetainedRef(packed_store_), entry_hash_),
         base::Bind(&SimpleEntryImpl::DoomOperationComplete, this, callback,
                    // Return to STATE_FAILURE after dooming, since no operation
                    // can succeed on the truncated entry files.
@@ -1111,7 +1134,8 @@ void SimpleEntryImpl::DoomEntryInternal(const CompletionCallback& callback) {
   PostTaskAndReplyWithResult(
       worker_pool_.get(),
       FROM_HERE,
-      base::Bind(&SimpleSynchronousEntry::DoomEntry, path_, entry_hash_),
+      base::Bind(&SimpleSynchronousEntry::DoomEntry, path_,
+                 base::RetainedRef(packed_store_), entry_hash_),
       base::Bind(
           &SimpleEntryImpl::DoomOperationComplete, this, callback, state_));
   state_ = STATE_IO_PENDING;
@@ -1153,6 +1177,11 @@ void SimpleEntryImpl::CreationOperationComplete(
     crc32s_[0] = in_results->stream_0_crc32;
     crc32s_end_offset_[0] = in_results->entry_stat.data_size(0);
   }
+  if (in_results->stream_1_data.get()) {
+    stream_1_data_ = in_results->stream_1_data;
+    // The crc was checked in SimpleSynchronousEntry.
+    crc_check_state_[1] = CRC_CHECK_DONE;
+  }
   // If this entry was opened by hash, key_ could still be empty. If so, update
   // it with the key read from the synchronous entry.
   if (key_.empty()) {
@@ -1490,14 +1519,15 @@ void SimpleEntryImpl::RecordWriteDependencyType(
                    type, WRITE_DEPENDENCY_TYPE_MAX);
 }
 
-int SimpleEntryImpl::ReadStream0Data(net::IOBuffer* buf,
-                                     int offset,
-                                     int buf_len) {
+int SimpleEntryImpl::ReadInMemoryData(net::GrowableIOBuffer* in_buf,
+                                      net::IOBuffer* buf,
+                                      int offset,
+                                      int buf_len) {
   if (buf_len < 0) {
     RecordReadResult(cache_type_, READ_RESULT_SYNC_READ_FAILURE);
     return 0;
   }
-  memcpy(buf->data(), stream_0_data_->data() + offset, buf_len);
+  memcpy(buf->data(), in_buf->data() + offset, buf_len);
   UpdateDataFromEntryStat(
       SimpleEntryStat(base::Time::Now(), last_modified_, data_size_,
                       sparse_data_size_));
@@ -35,6 +35,8 @@ class NetLog;
 namespace disk_cache {
 
 class SimpleBackendImpl;
+class SimpleIOEngine;
+class SimplePackedStore;
 class SimpleSynchronousEntry;
 class SimpleEntryStat;
 struct SimpleEntryCreationResults;
@@ -296,8 +298,12 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   void RecordReadIsParallelizable(const SimpleEntryOperation& operation) const;
   void RecordWriteDependencyType(const SimpleEntryOperation& operation) const;
 
-  // Reads from the stream 0 data kept in memory.
-  int ReadStream0Data(net::IOBuffer* buf, int offset, int buf_len);
+  // Reads from stream data kept in memory, |stream_0_data_| or
+  // |stream_1_data_|.
+  int ReadInMemoryData(net::GrowableIOBuffer* in_buf,
+                       net::IOBuffer* buf,
+                       int offset,
+                       int buf_len);
 
   // Copies data from |buf| to the internal in-memory buffer for stream 0. If
   // |truncate| is set to true, the target buffer will be truncated at |offset|
@@ -322,6 +328,9 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   const base::WeakPtr<SimpleBackendImpl> backend_;
   const net::CacheType cache_type_;
   const scoped_refptr<base::TaskRunner> worker_pool_;
+  const scoped_refptr<SimplePackedStore> packed_store_;
+  // Never destroyed; see SimpleIOEngine::Get().
+  SimpleIOEngine* const io_engine_;
   const base::FilePath path_;
   const uint64_t entry_hash_;
   const bool use_optimistic_operations_;
@@ -387,6 +396,10 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   // used to write HTTP headers, the memory consumption of keeping it in memory
   // is acceptable.
   scoped_refptr<net::GrowableIOBuffer> stream_0_data_;
+
+  // Stream 1 data, if it was read along with stream 0 when the entry was
+  // opened. Reads of stream 1 are served from it until stream 1 is written.
+  scoped_refptr<net::GrowableIOBuffer> stream_1_data_;
 };
 
 }  // namespace disk_cache
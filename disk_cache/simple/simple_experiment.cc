@@ -16,6 +16,14 @@ namespace disk_cache {
 const base::Feature kSimpleSizeExperiment = {"SimpleSizeExperiment",
                                              base::FEATURE_DISABLED_BY_DEFAULT};
 const char kSizeMultiplierParam[] = "SizeMultiplier";
+const base::Feature kSimplePackedStorage = {"SimplePackedStorage",
+                                            base::FEATURE_DISABLED_BY_DEFAULT};
+const base::Feature kSimpleIndexMappedTable = {
+    "SimpleIndexMappedTable", base::FEATURE_DISABLED_BY_DEFAULT};
+const base::Feature kSimpleCacheIOUring = {"SimpleCacheIOUring",
+                                           base::FEATURE_DISABLED_BY_DEFAULT};
+const base::Feature kSimpleSpeculativeOpen = {
+    "SimpleSpeculativeOpen", base::FEATURE_DISABLED_BY_DEFAULT};
 
 namespace {
 
@@ -57,7 +65,10 @@ SimpleExperiment GetSimpleExperiment(net::CacheType cache_type) {
   if (cache_type != net::DISK_CACHE)
     return experiment;
 
-  CheckForSimpleSizeExperiment(&experiment);
+  if (!CheckForSimpleSizeExperiment(&experiment) &&
+      base::FeatureList::IsEnabled(kSimplePackedStorage)) {
+    experiment.type = SimpleExperimentType::PACKED;
+  }
   return experiment;
 }
 
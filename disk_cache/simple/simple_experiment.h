@@ -15,12 +15,24 @@ namespace disk_cache {
 
 NET_EXPORT_PRIVATE extern const base::Feature kSimpleSizeExperiment;
 NET_EXPORT_PRIVATE extern const char kSizeMultiplierParam[];
+NET_EXPORT_PRIVATE extern const base::Feature kSimplePackedStorage;
+// Keeps the index in a SimpleIndexTable, which is updated in place.
+NET_EXPORT_PRIVATE extern const base::Feature kSimpleIndexMappedTable;
+// Runs the file operations of entries through io_uring, in builds with the
+// SIMPLE_CACHE_IO_URING build flag; see SimpleIOEngine.
+NET_EXPORT_PRIVATE extern const base::Feature kSimpleCacheIOUring;
+// Opens entries with a single read of the end of file 0; see
+// SimpleSynchronousEntry::kSpeculativeReadSize.
+NET_EXPORT_PRIVATE extern const base::Feature kSimpleSpeculativeOpen;
 
 // This lists the experiment groups for SimpleCache. Only add new groups at
 // the end of the list, and always increase the number.
 enum class SimpleExperimentType : uint32_t {
   NONE = 0,
   SIZE = 1,
+  // Small entries are packed into shared segment files; see
+  // SimplePackedStore.
+  PACKED = 2,
 };
 
 struct NET_EXPORT_PRIVATE SimpleExperiment {
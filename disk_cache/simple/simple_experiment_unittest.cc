@@ -88,4 +88,16 @@ TEST_F(SimpleExperimentTest, SizeTrialProperlyConfiguredWrongCacheType) {
   EXPECT_EQ(0u, experiment.param);
 }
 
+TEST_F(SimpleExperimentTest, PackedStorage) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(kSimplePackedStorage);
+
+  SimpleExperiment experiment = GetSimpleExperiment(net::DISK_CACHE);
+  EXPECT_EQ(SimpleExperimentType::PACKED, experiment.type);
+  EXPECT_EQ(0u, experiment.param);
+
+  experiment = GetSimpleExperiment(net::APP_CACHE);
+  EXPECT_EQ(SimpleExperimentType::NONE, experiment.type);
+}
+
 }  // namespace disk_cache
@@ -18,6 +18,7 @@
 #include "base/metrics/field_trial.h"
 #include "base/numerics/safe_conversions.h"
 #include "base/pickle.h"
+#include "base/rand_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_tokenizer.h"
 #include "base/task_runner.h"
@@ -50,6 +51,9 @@ const uint32_t kEvictionMarginDivisor = 20;
 
 const uint32_t kBytesInKb = 1024;
 
+// The number of non-empty hash table buckets GetEvictionCandidate() samples.
+const int kEvictionCandidateBuckets = 8;
+
 // Utility class used for timestamp comparisons in entry metadata while sorting.
 class CompareHashesForTimestamp {
   typedef disk_cache::SimpleIndex SimpleIndex;
@@ -271,7 +275,8 @@ uint64_t SimpleIndex::GetCacheSizeBetween(base::Time initial_time,
 
 size_t SimpleIndex::EstimateMemoryUsage() const {
   return base::trace_event::EstimateMemoryUsage(entries_set_) +
-         base::trace_event::EstimateMemoryUsage(removed_entries_);
+         base::trace_event::EstimateMemoryUsage(removed_entries_) +
+         base::trace_event::EstimateMemoryUsage(dirty_entries_);
 }
 
 void SimpleIndex::Insert(uint64_t entry_hash) {
@@ -283,6 +288,7 @@ void SimpleIndex::Insert(uint64_t entry_hash) {
                    &entries_set_);
   if (!initialized_)
     removed_entries_.erase(entry_hash);
+  MarkDirty(entry_hash);
   PostponeWritingToDisk();
 }
 
@@ -296,6 +302,7 @@ void SimpleIndex::Remove(uint64_t entry_hash) {
 
   if (!initialized_)
     removed_entries_.insert(entry_hash);
+  MarkDirty(entry_hash);
   PostponeWritingToDisk();
 }
 
@@ -314,6 +321,7 @@ bool SimpleIndex::UseIfExists(uint64_t entry_hash) {
     // If not initialized, always return true, forcing it to go to the disk.
     return !initialized_;
   it->second.SetLastUsedTime(base::Time::Now());
+  MarkDirty(entry_hash);
   PostponeWritingToDisk();
   return true;
 }
@@ -367,6 +375,39 @@ void SimpleIndex::StartEvictionIfNeeded() {
                                                    AsWeakPtr()));
 }
 
+bool SimpleIndex::GetEvictionCandidate(uint64_t* entry_hash) const {
+  DCHECK(io_thread_checker_.CalledOnValidThread());
+  if (!initialized_ || cache_size_ <= low_watermark_ || entries_set_.empty())
+    return false;
+
+  // Eviction sorts the whole index by last use, which is too slow to do for
+  // every new entry. The oldest of the entries in a few buckets, from a random
+  // one on, stands in for the entries eviction would pick.
+  const size_t bucket_count = entries_set_.bucket_count();
+  const size_t first_bucket =
+      static_cast<size_t>(base::RandGenerator(bucket_count));
+  bool found = false;
+  base::Time oldest_last_used;
+  int sampled_buckets = 0;
+  for (size_t i = 0;
+       i < bucket_count && sampled_buckets < kEvictionCandidateBuckets; ++i) {
+    const size_t bucket = (first_bucket + i) % bucket_count;
+    if (entries_set_.bucket_size(bucket) == 0)
+      continue;
+    ++sampled_buckets;
+    for (auto it = entries_set_.begin(bucket); it != entries_set_.end(bucket);
+         ++it) {
+      const base::Time last_used = it->second.GetLastUsedTime();
+      if (!found || last_used < oldest_last_used) {
+        found = true;
+        oldest_last_used = last_used;
+        *entry_hash = it->first;
+      }
+    }
+  }
+  return found;
+}
+
 bool SimpleIndex::UpdateEntrySize(uint64_t entry_hash,
                                   base::StrictNumeric<uint32_t> entry_size) {
   DCHECK(io_thread_checker_.CalledOnValidThread());
@@ -375,6 +416,7 @@ bool SimpleIndex::UpdateEntrySize(uint64_t entry_hash,
     return false;
 
   UpdateEntryIteratorSize(&it, entry_size);
+  MarkDirty(entry_hash);
   PostponeWritingToDisk();
   StartEvictionIfNeeded();
   return true;
@@ -424,6 +466,11 @@ void SimpleIndex::UpdateEntryIteratorSize(
   (*it)->second.SetEntrySize(entry_size);
 }
 
+void SimpleIndex::MarkDirty(uint64_t entry_hash) {
+  if (index_file_->uses_mapped_table())
+    dirty_entries_.insert(entry_hash);
+}
+
 void SimpleIndex::MergeInitializingSet(
     std::unique_ptr<SimpleIndexLoadResult> load_result) {
   DCHECK(io_thread_checker_.CalledOnValidThread());
@@ -526,8 +573,10 @@ void SimpleIndex::WriteToDisk(IndexWriteToDiskReason reason) {
   }
   last_write_to_disk_ = start;
 
-  index_file_->WriteToDisk(reason, entries_set_, cache_size_, start,
-                           app_on_background_, base::Closure());
+  index_file_->WriteUpdatesToDisk(reason, entries_set_, dirty_entries_,
+                                  cache_size_, start, app_on_background_,
+                                  base::Closure());
+  dirty_entries_.clear();
 }
 
 }  // namespace disk_cache
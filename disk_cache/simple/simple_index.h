@@ -123,6 +123,11 @@ class NET_EXPORT_PRIVATE SimpleIndex
 
   void WriteToDisk(IndexWriteToDiskReason reason);
 
+  // Sets |entry_hash| to an entry which eviction would remove early, if the
+  // cache is full enough that adding an entry makes eviction take one. Returns
+  // false otherwise.
+  bool GetEvictionCandidate(uint64_t* entry_hash) const;
+
   // Update the size (in bytes) of an entry, in the metadata stored in the
   // index. This should be the total disk-file size including all streams of the
   // entry.
@@ -184,6 +189,10 @@ class NET_EXPORT_PRIVATE SimpleIndex
   void UpdateEntryIteratorSize(EntrySet::iterator* it,
                                base::StrictNumeric<uint32_t> entry_size);
 
+  // Notes that |entry_hash| was changed or removed since the last write, if
+  // the index file writes only those.
+  void MarkDirty(uint64_t entry_hash);
+
   // Must run on IO Thread.
   void MergeInitializingSet(std::unique_ptr<SimpleIndexLoadResult> load_result);
 
@@ -210,6 +219,10 @@ class NET_EXPORT_PRIVATE SimpleIndex
   // This stores all the entry_hash of entries that are removed during
   // initialization.
   std::unordered_set<uint64_t> removed_entries_;
+
+  // The entries changed or removed since the last write to disk, when the
+  // index file is a SimpleIndexTable.
+  std::unordered_set<uint64_t> dirty_entries_;
   bool initialized_;
   IndexInitMethod init_method_;
 
@@ -7,6 +7,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/feature_list.h"
 #include "base/files/file.h"
 #include "base/files/file_util.h"
 #include "base/files/memory_mapped_file.h"
@@ -19,8 +20,10 @@
 #include "base/threading/thread_restrictions.h"
 #include "net/disk_cache/simple/simple_backend_version.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
+#include "net/disk_cache/simple/simple_experiment.h"
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_packed_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "third_party/zlib/zlib.h"
@@ -102,6 +105,20 @@ void UmaRecordStaleIndexQuality(int missed_entry_count,
                    STALE_INDEX_MAX);
 }
 
+void UmaRecordIndexWriteToDiskTime(const base::TimeTicks& start_time,
+                                   bool app_on_background,
+                                   net::CacheType cache_type) {
+  if (app_on_background) {
+    SIMPLE_CACHE_UMA(TIMES,
+                     "IndexWriteToDiskTime.Background", cache_type,
+                     (base::TimeTicks::Now() - start_time));
+  } else {
+    SIMPLE_CACHE_UMA(TIMES,
+                     "IndexWriteToDiskTime.Foreground", cache_type,
+                     (base::TimeTicks::Now() - start_time));
+  }
+}
+
 bool WritePickleFile(base::Pickle* pickle, const base::FilePath& file_name) {
   File file(
       file_name,
@@ -118,6 +135,19 @@ bool WritePickleFile(base::Pickle* pickle, const base::FilePath& file_name) {
   return true;
 }
 
+// Called for each entry in the SimplePackedStore.
+void ProcessPackedEntry(SimpleIndex::EntrySet* entries,
+                        uint64_t entry_hash,
+                        uint32_t record_size,
+                        base::Time last_used) {
+  // An entry which also has files was spilled from the store after the
+  // record was written; its files take precedence.
+  if (entries->find(entry_hash) != entries->end())
+    return;
+  SimpleIndex::InsertInEntrySet(
+      entry_hash, EntryMetadata(last_used, record_size), entries);
+}
+
 // Called for each cache directory traversal iteration.
 void ProcessEntryFile(SimpleIndex::EntrySet* entries,
                       const base::FilePath& file_path) {
@@ -171,7 +201,8 @@ void ProcessEntryFile(SimpleIndex::EntrySet* entries,
 SimpleIndexLoadResult::SimpleIndexLoadResult()
     : did_load(false),
       index_write_reason(SimpleIndex::INDEX_WRITE_REASON_MAX),
-      flush_required(false) {}
+      flush_required(false),
+      loaded_from_table(false) {}
 
 SimpleIndexLoadResult::~SimpleIndexLoadResult() {
 }
@@ -180,6 +211,7 @@ void SimpleIndexLoadResult::Reset() {
   did_load = false;
   index_write_reason = SimpleIndex::INDEX_WRITE_REASON_MAX;
   flush_required = false;
+  loaded_from_table = false;
   entries.clear();
 }
 
@@ -189,6 +221,12 @@ const char SimpleIndexFile::kIndexFileName[] = "the-real-index";
 const char SimpleIndexFile::kIndexDirectory[] = "index-dir";
 // static
 const char SimpleIndexFile::kTempIndexFileName[] = "temp-index";
+// static
+const char SimpleIndexFile::kTableFileName[] = "the-real-index-table";
+// static
+const char SimpleIndexFile::kTempTableFileName[] = "temp-index-table";
+// static
+const char SimpleIndexFile::kJournalFileName[] = "the-real-index-journal";
 
 SimpleIndexFile::IndexMetadata::IndexMetadata()
     : magic_number_(kSimpleIndexMagicNumber),
@@ -282,15 +320,73 @@ void SimpleIndexFile::SyncWriteToDisk(net::CacheType cache_type,
   if (!base::ReplaceFile(temp_index_filename, index_filename, NULL))
     return;
 
-  if (app_on_background) {
-    SIMPLE_CACHE_UMA(TIMES,
-                     "IndexWriteToDiskTime.Background", cache_type,
-                     (base::TimeTicks::Now() - start_time));
-  } else {
-    SIMPLE_CACHE_UMA(TIMES,
-                     "IndexWriteToDiskTime.Foreground", cache_type,
-                     (base::TimeTicks::Now() - start_time));
+  UmaRecordIndexWriteToDiskTime(start_time, app_on_background, cache_type);
+}
+
+// static
+bool SimpleIndexFile::SyncWriteTable(
+    net::CacheType cache_type,
+    const base::FilePath& cache_directory,
+    const base::FilePath& index_filename,
+    const base::FilePath& table_filename,
+    const base::FilePath& temp_table_filename,
+    const base::FilePath& journal_filename,
+    std::unique_ptr<std::vector<SimpleIndexTable::Slot>> entries,
+    SimpleIndex::IndexWriteToDiskReason reason,
+    uint64_t cache_size,
+    const base::TimeTicks& start_time,
+    bool app_on_background) {
+  base::FilePath index_file_directory = table_filename.DirName();
+  if (!base::DirectoryExists(index_file_directory) &&
+      !base::CreateDirectory(index_file_directory)) {
+    LOG(ERROR) << "Could not create a directory to hold the index file";
+    return false;
+  }
+
+  SimpleIndexTable::Metadata metadata;
+  metadata.reason = reason;
+  metadata.cache_size = cache_size;
+  if (!simple_util::GetMTime(cache_directory, &metadata.cache_last_modified)) {
+    LOG(ERROR) << "Could obtain information about cache age";
+    return false;
   }
+  if (!SimpleIndexTable::Write(table_filename, temp_table_filename,
+                               journal_filename, *entries, metadata)) {
+    LOG(ERROR) << "Failed to write the index table";
+    return false;
+  }
+  // The table replaces the legacy index file, which is now stale.
+  simple_util::SimpleCacheDeleteFile(index_filename);
+
+  UmaRecordIndexWriteToDiskTime(start_time, app_on_background, cache_type);
+  return true;
+}
+
+// static
+bool SimpleIndexFile::SyncWriteTableUpdate(
+    net::CacheType cache_type,
+    const base::FilePath& cache_directory,
+    const base::FilePath& table_filename,
+    const base::FilePath& journal_filename,
+    std::unique_ptr<SimpleIndexTable::Update> update,
+    SimpleIndex::IndexWriteToDiskReason reason,
+    uint64_t cache_size,
+    const base::TimeTicks& start_time,
+    bool app_on_background) {
+  SimpleIndexTable::Metadata metadata;
+  metadata.reason = reason;
+  metadata.cache_size = cache_size;
+  if (!simple_util::GetMTime(cache_directory, &metadata.cache_last_modified)) {
+    LOG(ERROR) << "Could obtain information about cache age";
+    return false;
+  }
+  if (!SimpleIndexTable::WriteUpdate(table_filename, journal_filename, *update,
+                                     metadata)) {
+    return false;
+  }
+
+  UmaRecordIndexWriteToDiskTime(start_time, app_on_background, cache_type);
+  return true;
 }
 
 bool SimpleIndexFile::IndexMetadata::CheckIndexMetadata() {
@@ -310,7 +406,8 @@ SimpleIndexFile::SimpleIndexFile(
     const scoped_refptr<base::SingleThreadTaskRunner>& cache_thread,
     const scoped_refptr<base::TaskRunner>& worker_pool,
     net::CacheType cache_type,
-    const base::FilePath& cache_directory)
+    const base::FilePath& cache_directory,
+    SimplePackedStore* packed_store)
     : cache_thread_(cache_thread),
       worker_pool_(worker_pool),
       cache_type_(cache_type),
@@ -318,7 +415,18 @@ SimpleIndexFile::SimpleIndexFile(
       index_file_(cache_directory_.AppendASCII(kIndexDirectory)
                       .AppendASCII(kIndexFileName)),
       temp_index_file_(cache_directory_.AppendASCII(kIndexDirectory)
-                           .AppendASCII(kTempIndexFileName)) {
+                           .AppendASCII(kTempIndexFileName)),
+      packed_store_(packed_store),
+      use_mapped_table_(
+          base::FeatureList::IsEnabled(kSimpleIndexMappedTable)),
+      table_file_(cache_directory_.AppendASCII(kIndexDirectory)
+                      .AppendASCII(kTableFileName)),
+      temp_table_file_(cache_directory_.AppendASCII(kIndexDirectory)
+                           .AppendASCII(kTempTableFileName)),
+      journal_file_(cache_directory_.AppendASCII(kIndexDirectory)
+                        .AppendASCII(kJournalFileName)),
+      table_rebuild_required_(true),
+      weak_ptr_factory_(this) {
 }
 
 SimpleIndexFile::~SimpleIndexFile() {}
@@ -329,8 +437,19 @@ void SimpleIndexFile::LoadIndexEntries(base::Time cache_last_modified,
   base::Closure task = base::Bind(&SimpleIndexFile::SyncLoadIndexEntries,
                                   cache_type_,
                                   cache_last_modified, cache_directory_,
-                                  index_file_, out_result);
-  worker_pool_->PostTaskAndReply(FROM_HERE, task, callback);
+                                  base::RetainedRef(packed_store_),
+                                  index_file_, use_mapped_table_, table_file_,
+                                  journal_file_, out_result);
+  base::Closure reply = base::Bind(&SimpleIndexFile::OnLoadIndexEntriesDone,
+                                   weak_ptr_factory_.GetWeakPtr(), out_result,
+                                   callback);
+  worker_pool_->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void SimpleIndexFile::OnLoadIndexEntriesDone(SimpleIndexLoadResult* result,
+                                             const base::Closure& callback) {
+  table_rebuild_required_ = !result->loaded_from_table;
+  callback.Run();
 }
 
 void SimpleIndexFile::WriteToDisk(SimpleIndex::IndexWriteToDiskReason reason,
@@ -352,19 +471,94 @@ void SimpleIndexFile::WriteToDisk(SimpleIndex::IndexWriteToDiskReason reason,
     cache_thread_->PostTaskAndReply(FROM_HERE, task, callback);
 }
 
+void SimpleIndexFile::WriteUpdatesToDisk(
+    SimpleIndex::IndexWriteToDiskReason reason,
+    const SimpleIndex::EntrySet& entry_set,
+    const std::unordered_set<uint64_t>& dirty_entries,
+    uint64_t cache_size,
+    const base::TimeTicks& start,
+    bool app_on_background,
+    const base::Closure& callback) {
+  if (!use_mapped_table_) {
+    WriteToDisk(reason, entry_set, cache_size, start, app_on_background,
+                callback);
+    return;
+  }
+
+  UmaRecordIndexWriteReason(reason, cache_type_);
+  base::Callback<bool(void)> task;
+  if (table_rebuild_required_) {
+    std::unique_ptr<std::vector<SimpleIndexTable::Slot>> entries(
+        new std::vector<SimpleIndexTable::Slot>());
+    entries->reserve(entry_set.size());
+    for (const auto& entry : entry_set)
+      entries->push_back({entry.first, entry.second});
+    task = base::Bind(&SimpleIndexFile::SyncWriteTable, cache_type_,
+                      cache_directory_, index_file_, table_file_,
+                      temp_table_file_, journal_file_, base::Passed(&entries),
+                      reason, cache_size, start, app_on_background);
+    // Updates posted after this write run after it, and find the table it
+    // writes, or no table if it fails.
+    table_rebuild_required_ = false;
+  } else {
+    std::unique_ptr<SimpleIndexTable::Update> update(
+        new SimpleIndexTable::Update());
+    for (uint64_t entry_hash : dirty_entries) {
+      SimpleIndex::EntrySet::const_iterator it = entry_set.find(entry_hash);
+      if (it != entry_set.end())
+        update->entries.push_back({entry_hash, it->second});
+      else
+        update->removed_entries.push_back(entry_hash);
+    }
+    task = base::Bind(&SimpleIndexFile::SyncWriteTableUpdate, cache_type_,
+                      cache_directory_, table_file_, journal_file_,
+                      base::Passed(&update), reason, cache_size, start,
+                      app_on_background);
+  }
+  base::PostTaskAndReplyWithResult(
+      cache_thread_.get(), FROM_HERE, task,
+      base::Bind(&SimpleIndexFile::OnTableWriteDone,
+                 weak_ptr_factory_.GetWeakPtr(), callback));
+}
+
+// static
+void SimpleIndexFile::OnTableWriteDone(
+    base::WeakPtr<SimpleIndexFile> index_file,
+    const base::Closure& callback,
+    bool result) {
+  if (!result && index_file)
+    index_file->table_rebuild_required_ = true;
+  if (!callback.is_null())
+    callback.Run();
+}
+
 // static
 void SimpleIndexFile::SyncLoadIndexEntries(
     net::CacheType cache_type,
     base::Time cache_last_modified,
     const base::FilePath& cache_directory,
+    SimplePackedStore* packed_store,
     const base::FilePath& index_file_path,
+    bool use_mapped_table,
+    const base::FilePath& table_file_path,
+    const base::FilePath& journal_file_path,
     SimpleIndexLoadResult* out_result) {
-  // Load the index and find its age.
+  // Load the index and find its age. The table is preferred, but the legacy
+  // index file is still read when switching to the table.
   base::Time last_cache_seen_by_index;
-  SyncLoadFromDisk(index_file_path, &last_cache_seen_by_index, out_result);
+  if (use_mapped_table) {
+    SyncLoadFromTable(table_file_path, journal_file_path,
+                      &last_cache_seen_by_index, out_result);
+  }
+  if (!out_result->did_load)
+    SyncLoadFromDisk(index_file_path, &last_cache_seen_by_index, out_result);
+  const base::FilePath& loaded_file_path =
+      out_result->loaded_from_table ? table_file_path : index_file_path;
 
   // Consider the index loaded if it is fresh.
-  const bool index_file_existed = base::PathExists(index_file_path);
+  const bool index_file_existed =
+      base::PathExists(index_file_path) ||
+      (use_mapped_table && base::PathExists(table_file_path));
   if (!out_result->did_load) {
     if (index_file_existed)
       UmaRecordIndexFileState(INDEX_STATE_CORRUPT, cache_type);
@@ -377,7 +571,7 @@ void SimpleIndexFile::SyncLoadIndexEntries(
       }
       base::Time latest_dir_mtime;
       simple_util::GetMTime(cache_directory, &latest_dir_mtime);
-      if (LegacyIsIndexFileStale(latest_dir_mtime, index_file_path)) {
+      if (LegacyIsIndexFileStale(latest_dir_mtime, loaded_file_path)) {
         UmaRecordIndexFileState(INDEX_STATE_FRESH_CONCURRENT_UPDATES,
                                 cache_type);
       } else {
@@ -394,7 +588,8 @@ void SimpleIndexFile::SyncLoadIndexEntries(
   SimpleIndex::EntrySet entries_from_stale_index;
   entries_from_stale_index.swap(out_result->entries);
   const base::TimeTicks start = base::TimeTicks::Now();
-  SyncRestoreFromDisk(cache_directory, index_file_path, out_result);
+  SyncRestoreFromDisk(cache_directory, packed_store, index_file_path,
+                      out_result);
   SIMPLE_CACHE_UMA(MEDIUM_TIMES, "IndexRestoreTime", cache_type,
                    base::TimeTicks::Now() - start);
   SIMPLE_CACHE_UMA(COUNTS, "IndexEntriesRestored", cache_type,
@@ -450,6 +645,32 @@ void SimpleIndexFile::SyncLoadFromDisk(const base::FilePath& index_filename,
     simple_util::SimpleCacheDeleteFile(index_filename);
 }
 
+// static
+void SimpleIndexFile::SyncLoadFromTable(
+    const base::FilePath& table_filename,
+    const base::FilePath& journal_filename,
+    base::Time* out_last_cache_seen_by_index,
+    SimpleIndexLoadResult* out_result) {
+  out_result->Reset();
+
+  SimpleIndexTable::Metadata metadata;
+  bool journal_replayed = false;
+  if (!SimpleIndexTable::Load(table_filename, journal_filename,
+                              &out_result->entries, &metadata,
+                              &journal_replayed)) {
+    out_result->Reset();
+    simple_util::SimpleCacheDeleteFile(table_filename);
+    simple_util::SimpleCacheDeleteFile(journal_filename);
+    return;
+  }
+  *out_last_cache_seen_by_index = metadata.cache_last_modified;
+  out_result->index_write_reason = metadata.reason;
+  out_result->did_load = true;
+  // A replayed journal means the table was torn by a crash while it was
+  // updated, so it must be written again before it can be updated.
+  out_result->loaded_from_table = !journal_replayed;
+}
+
 // static
 std::unique_ptr<base::Pickle> SimpleIndexFile::Serialize(
     const SimpleIndexFile::IndexMetadata& index_metadata,
@@ -531,6 +752,7 @@ void SimpleIndexFile::Deserialize(const char* data, int data_len,
 // static
 void SimpleIndexFile::SyncRestoreFromDisk(
     const base::FilePath& cache_directory,
+    SimplePackedStore* packed_store,
     const base::FilePath& index_file_path,
     SimpleIndexLoadResult* out_result) {
   VLOG(1) << "Simple Cache Index is being restored from disk.";
@@ -544,6 +766,8 @@ void SimpleIndexFile::SyncRestoreFromDisk(
     LOG(ERROR) << "Could not reconstruct index from disk";
     return;
   }
+  if (packed_store)
+    packed_store->ForEachEntry(base::Bind(&ProcessPackedEntry, entries));
   out_result->did_load = true;
   // When we restore from disk we write the merged index file to disk right
   // away, this might save us from having to restore again next time.
@@ -9,16 +9,20 @@
 
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
 #include "base/pickle.h"
 #include "net/base/cache_type.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_index_table.h"
 
 namespace base {
 class SingleThreadTaskRunner;
@@ -27,6 +31,8 @@ class TaskRunner;
 
 namespace disk_cache {
 
+class SimplePackedStore;
+
 const uint64_t kSimpleIndexMagicNumber = UINT64_C(0x656e74657220796f);
 
 struct NET_EXPORT_PRIVATE SimpleIndexLoadResult {
@@ -39,6 +45,9 @@ struct NET_EXPORT_PRIVATE SimpleIndexLoadResult {
   SimpleIndex::IndexWriteToDiskReason index_write_reason;
   SimpleIndex::IndexInitMethod init_method;
   bool flush_required;
+  // Set if |entries| were loaded from a SimpleIndexTable which is up to date,
+  // so that later writes can update it in place.
+  bool loaded_from_table;
 };
 
 // Simple Index File format is a pickle of IndexMetadata and EntryMetadata
@@ -47,6 +56,9 @@ struct NET_EXPORT_PRIVATE SimpleIndexLoadResult {
 // the format see |SimpleIndexFile::Serialize()| and
 // |SimpleIndexFile::LoadFromDisk()|.
 //
+// With the SimpleIndexMappedTable feature, the index is kept in a
+// SimpleIndexTable instead, and the legacy file is only read when switching.
+//
 // The non-static methods must run on the IO thread. All the real
 // work is done in the static methods, which are run on the cache thread
 // or in worker threads. Synchronization between methods is the
@@ -85,7 +97,8 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
       const scoped_refptr<base::SingleThreadTaskRunner>& cache_thread,
       const scoped_refptr<base::TaskRunner>& worker_pool,
       net::CacheType cache_type,
-      const base::FilePath& cache_directory);
+      const base::FilePath& cache_directory,
+      SimplePackedStore* packed_store);
   virtual ~SimpleIndexFile();
 
   // Get index entries based on current disk context.
@@ -101,6 +114,22 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
                            bool app_on_background,
                            const base::Closure& callback);
 
+  // Like WriteToDisk(), but if the index is kept in a SimpleIndexTable, only
+  // the entries in |dirty_entries| which were changed or removed since the
+  // last write are written.
+  virtual void WriteUpdatesToDisk(
+      SimpleIndex::IndexWriteToDiskReason reason,
+      const SimpleIndex::EntrySet& entry_set,
+      const std::unordered_set<uint64_t>& dirty_entries,
+      uint64_t cache_size,
+      const base::TimeTicks& start,
+      bool app_on_background,
+      const base::Closure& callback);
+
+  // Whether the index is kept in a SimpleIndexTable, in which case callers
+  // should keep track of the entries to pass to WriteUpdatesToDisk().
+  bool uses_mapped_table() const { return use_mapped_table_; }
+
  private:
   friend class WrappedSimpleIndexFile;
 
@@ -115,9 +144,19 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
   static void SyncLoadIndexEntries(net::CacheType cache_type,
                                    base::Time cache_last_modified,
                                    const base::FilePath& cache_directory,
+                                   SimplePackedStore* packed_store,
                                    const base::FilePath& index_file_path,
+                                   bool use_mapped_table,
+                                   const base::FilePath& table_file_path,
+                                   const base::FilePath& journal_file_path,
                                    SimpleIndexLoadResult* out_result);
 
+  // Load the SimpleIndexTable from disk returning an EntrySet.
+  static void SyncLoadFromTable(const base::FilePath& table_filename,
+                                const base::FilePath& journal_filename,
+                                base::Time* out_last_cache_seen_by_index,
+                                SimpleIndexLoadResult* out_result);
+
   // Load the index file from disk returning an EntrySet.
   static void SyncLoadFromDisk(const base::FilePath& index_filename,
                                base::Time* out_last_cache_seen_by_index,
@@ -163,9 +202,38 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
                               const base::TimeTicks& start_time,
                               bool app_on_background);
 
-  // Scan the index directory for entries, returning an EntrySet of all entries
-  // found.
+  // Writes |entries| to a new SimpleIndexTable, replacing the legacy index
+  // file. Returns false on failure.
+  static bool SyncWriteTable(
+      net::CacheType cache_type,
+      const base::FilePath& cache_directory,
+      const base::FilePath& index_filename,
+      const base::FilePath& table_filename,
+      const base::FilePath& temp_table_filename,
+      const base::FilePath& journal_filename,
+      std::unique_ptr<std::vector<SimpleIndexTable::Slot>> entries,
+      SimpleIndex::IndexWriteToDiskReason reason,
+      uint64_t cache_size,
+      const base::TimeTicks& start_time,
+      bool app_on_background);
+
+  // Applies |update| to the SimpleIndexTable in place. Returns false if the
+  // table has to be written again with SyncWriteTable().
+  static bool SyncWriteTableUpdate(
+      net::CacheType cache_type,
+      const base::FilePath& cache_directory,
+      const base::FilePath& table_filename,
+      const base::FilePath& journal_filename,
+      std::unique_ptr<SimpleIndexTable::Update> update,
+      SimpleIndex::IndexWriteToDiskReason reason,
+      uint64_t cache_size,
+      const base::TimeTicks& start_time,
+      bool app_on_background);
+
+  // Scan the index directory, and |packed_store| if it is not null, for
+  // entries, returning an EntrySet of all entries found.
   static void SyncRestoreFromDisk(const base::FilePath& cache_directory,
+                                  SimplePackedStore* packed_store,
                                   const base::FilePath& index_file_path,
                                   SimpleIndexLoadResult* out_result);
 
@@ -176,6 +244,16 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
   static bool LegacyIsIndexFileStale(base::Time cache_last_modified,
                                      const base::FilePath& index_file_path);
 
+  // Reply to LoadIndexEntries(), which notes whether the loaded table can be
+  // updated in place.
+  void OnLoadIndexEntriesDone(SimpleIndexLoadResult* result,
+                              const base::Closure& callback);
+
+  // Reply to the table writes. Runs |callback| even if |index_file| is gone.
+  static void OnTableWriteDone(base::WeakPtr<SimpleIndexFile> index_file,
+                               const base::Closure& callback,
+                               bool result);
+
   struct PickleHeader : public base::Pickle::Header {
     uint32_t crc;
   };
@@ -186,10 +264,24 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
   const base::FilePath cache_directory_;
   const base::FilePath index_file_;
   const base::FilePath temp_index_file_;
+  const scoped_refptr<SimplePackedStore> packed_store_;
+  const bool use_mapped_table_;
+  const base::FilePath table_file_;
+  const base::FilePath temp_table_file_;
+  const base::FilePath journal_file_;
+
+  // Set until a table which holds all the entries is known to be on disk. The
+  // next write then writes the whole table, rather than updating it.
+  bool table_rebuild_required_;
 
   static const char kIndexDirectory[];
   static const char kIndexFileName[];
   static const char kTempIndexFileName[];
+  static const char kTableFileName[];
+  static const char kTempTableFileName[];
+  static const char kJournalFileName[];
+
+  base::WeakPtrFactory<SimpleIndexFile> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleIndexFile);
 };
@@ -132,7 +132,8 @@ class WrappedSimpleIndexFile : public SimpleIndexFile {
       : SimpleIndexFile(base::ThreadTaskRunnerHandle::Get(),
                         base::ThreadTaskRunnerHandle::Get(),
                         net::DISK_CACHE,
-                        index_file_directory) {}
+                        index_file_directory,
+                        nullptr) {}
   ~WrappedSimpleIndexFile() override {}
 
   const base::FilePath& GetIndexFilePath() const {
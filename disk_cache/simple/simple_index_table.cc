@@ -0,0 +1,466 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_index_table.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "net/disk_cache/simple/simple_util.h"
+#include "third_party/zlib/zlib.h"
+
+using base::File;
+
+namespace disk_cache {
+
+namespace {
+
+const uint64_t kTableMagicNumber = UINT64_C(0x656c626174786469);
+const uint32_t kTableVersion = 1;
+const uint64_t kJournalMagicNumber = UINT64_C(0x6c616e72756f6a78);
+
+// Slots are marked empty or removed with these hashes, so entries with these
+// hashes are not written to the table. They are missing from the index on the
+// next load, as if it were stale.
+const uint64_t kEmptySlotHash = 0;
+const uint64_t kRemovedSlotHash = 1;
+
+// The smallest table has 64kB of slots.
+const uint64_t kMinCapacity = 4096;
+
+struct TableHeader {
+  uint64_t magic_number;
+  uint32_t version;
+  uint32_t capacity;
+  uint64_t entry_count;
+  // Slots which hold an entry, or held one which was removed.
+  uint64_t used_slot_count;
+  uint64_t cache_size;
+  int64_t cache_last_modified;
+  // The sequence number of the last journal batch applied to the table. The
+  // header may reach the disk before the slots the batch changed, so the batch
+  // with this sequence number is replayed too if it is still in the journal.
+  uint64_t applied_journal_sequence;
+  uint32_t reason;
+  // Covers the fields above. The slots are not covered, so that an update
+  // does not have to read the whole table.
+  uint32_t crc;
+};
+static_assert(sizeof(TableHeader) == 64, "incorrect table header size");
+static_assert(sizeof(SimpleIndexTable::Slot) == 16, "incorrect slot size");
+
+// A batch in the journal is this header, followed by |entry_count| Slots and
+// |removed_entry_count| entry hashes.
+struct JournalBatchHeader {
+  uint64_t magic_number;
+  uint64_t sequence;
+  uint32_t entry_count;
+  uint32_t removed_entry_count;
+  // Covers the header, with |crc| set to zero, and the rest of the batch.
+  uint32_t crc;
+  uint32_t padding;
+};
+static_assert(sizeof(JournalBatchHeader) == 32,
+              "incorrect journal batch header size");
+
+// Removed slots are reused, but only an update which finds no live or removed
+// slot for an entry uses up an empty one. The table is rewritten before more
+// than three quarters of it is used, to keep the probe sequences short.
+uint64_t GetMaxUsedSlotCount(uint64_t capacity) {
+  return capacity / 4 * 3;
+}
+
+bool IsReservedHash(uint64_t entry_hash) {
+  return entry_hash == kEmptySlotHash || entry_hash == kRemovedSlotHash;
+}
+
+uint32_t CalculateHeaderCRC(const TableHeader& header) {
+  return crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(&header),
+               offsetof(TableHeader, crc));
+}
+
+// Flushes |path| to disk. A table must be unmapped first, so that the writes
+// made through the mapping are in the page cache for the flush to pick up.
+bool SyncFile(const base::FilePath& path) {
+  File file(path, File::FLAG_OPEN | File::FLAG_WRITE | File::FLAG_SHARE_DELETE);
+  return file.IsValid() && file.Flush();
+}
+
+void DeleteTable(const base::FilePath& table_path,
+                 const base::FilePath& journal_path) {
+  simple_util::SimpleCacheDeleteFile(table_path);
+  simple_util::SimpleCacheDeleteFile(journal_path);
+}
+
+// A table file mapped into memory.
+class MappedTable {
+ public:
+  using Slot = SimpleIndexTable::Slot;
+
+  MappedTable() {}
+
+  // Maps an existing table, and checks its header.
+  bool Open(const base::FilePath& path, bool writable) {
+    File file(path, File::FLAG_OPEN | File::FLAG_READ |
+                        (writable ? File::FLAG_WRITE : 0) |
+                        File::FLAG_SHARE_DELETE);
+    if (!file.IsValid())
+      return false;
+    if (!map_.Initialize(std::move(file),
+                         writable ? base::MemoryMappedFile::READ_WRITE
+                                  : base::MemoryMappedFile::READ_ONLY)) {
+      return false;
+    }
+    if (map_.length() < sizeof(TableHeader))
+      return false;
+    const TableHeader* header = this->header();
+    if (header->magic_number != kTableMagicNumber ||
+        header->version != kTableVersion ||
+        header->crc != CalculateHeaderCRC(*header)) {
+      return false;
+    }
+    const uint64_t capacity = header->capacity;
+    return capacity >= kMinCapacity && (capacity & (capacity - 1)) == 0 &&
+           map_.length() == sizeof(TableHeader) + capacity * sizeof(Slot) &&
+           header->used_slot_count <= GetMaxUsedSlotCount(capacity) &&
+           header->entry_count <= header->used_slot_count;
+  }
+
+  // Maps |file|, which must be zero filled and large enough for |capacity|
+  // slots, as a new, empty table.
+  bool Create(File file, uint32_t capacity) {
+    if (!map_.Initialize(std::move(file), base::MemoryMappedFile::READ_WRITE))
+      return false;
+    DCHECK_EQ(sizeof(TableHeader) + uint64_t{capacity} * sizeof(Slot),
+              map_.length());
+    TableHeader* header = this->header();
+    header->magic_number = kTableMagicNumber;
+    header->version = kTableVersion;
+    header->capacity = capacity;
+    return true;
+  }
+
+  TableHeader* header() { return reinterpret_cast<TableHeader*>(map_.data()); }
+
+  Slot* slots() {
+    return reinterpret_cast<Slot*>(map_.data() + sizeof(TableHeader));
+  }
+
+  // Sets the entry |entry_hash| to |metadata|. Returns false if there is no
+  // slot left for it.
+  bool Set(uint64_t entry_hash, const EntryMetadata& metadata) {
+    DCHECK(!IsReservedHash(entry_hash));
+    bool found;
+    Slot* slot = Lookup(entry_hash, &found);
+    if (!slot)
+      return false;
+    if (!found) {
+      if (slot->entry_hash == kEmptySlotHash)
+        ++header()->used_slot_count;
+      ++header()->entry_count;
+    }
+    // Write the metadata first, so that a slot which is torn by a crash has
+    // either no entry, or an entry with the wrong metadata.
+    slot->metadata = metadata;
+    slot->entry_hash = entry_hash;
+    return true;
+  }
+
+  void Remove(uint64_t entry_hash) {
+    bool found;
+    Slot* slot = Lookup(entry_hash, &found);
+    if (!found)
+      return;
+    slot->entry_hash = kRemovedSlotHash;
+    --header()->entry_count;
+  }
+
+  void FinishHeader(const SimpleIndexTable::Metadata& metadata,
+                    uint64_t applied_journal_sequence) {
+    TableHeader* header = this->header();
+    header->cache_size = metadata.cache_size;
+    header->cache_last_modified =
+        metadata.cache_last_modified.ToInternalValue();
+    header->applied_journal_sequence = applied_journal_sequence;
+    header->reason = static_cast<uint32_t>(metadata.reason);
+    header->crc = CalculateHeaderCRC(*header);
+  }
+
+ private:
+  // Returns the slot holding |entry_hash| and sets |found|. Otherwise returns
+  // the slot where |entry_hash| should be inserted: the first removed slot on
+  // its probe sequence, or the empty slot which ends it. Returns null if the
+  // probe sequence has no end, which only happens if the table is corrupt.
+  Slot* Lookup(uint64_t entry_hash, bool* found) {
+    *found = false;
+    const uint64_t capacity = header()->capacity;
+    const uint64_t mask = capacity - 1;
+    Slot* slots = this->slots();
+    Slot* first_removed_slot = nullptr;
+    uint64_t index = entry_hash & mask;
+    for (uint64_t probes = 0; probes < capacity; ++probes) {
+      Slot* slot = &slots[index];
+      if (slot->entry_hash == entry_hash) {
+        *found = true;
+        return slot;
+      }
+      if (slot->entry_hash == kEmptySlotHash)
+        return first_removed_slot ? first_removed_slot : slot;
+      if (slot->entry_hash == kRemovedSlotHash && !first_removed_slot)
+        first_removed_slot = slot;
+      index = (index + 1) & mask;
+    }
+    return first_removed_slot;
+  }
+
+  base::MemoryMappedFile map_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedTable);
+};
+
+bool AppendToJournal(const base::FilePath& journal_path,
+                     uint64_t sequence,
+                     const SimpleIndexTable::Update& update) {
+  File file(journal_path, File::FLAG_OPEN_ALWAYS | File::FLAG_READ |
+                              File::FLAG_WRITE | File::FLAG_SHARE_DELETE);
+  if (!file.IsValid())
+    return false;
+  // A batch left behind means that an earlier update was not applied.
+  if (file.GetLength() != 0)
+    return false;
+
+  JournalBatchHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic_number = kJournalMagicNumber;
+  header.sequence = sequence;
+  header.entry_count = update.entries.size();
+  header.removed_entry_count = update.removed_entries.size();
+
+  std::string batch(reinterpret_cast<const char*>(&header), sizeof(header));
+  batch.append(reinterpret_cast<const char*>(update.entries.data()),
+               update.entries.size() * sizeof(SimpleIndexTable::Slot));
+  batch.append(reinterpret_cast<const char*>(update.removed_entries.data()),
+               update.removed_entries.size() * sizeof(uint64_t));
+  header.crc = crc32(crc32(0, Z_NULL, 0),
+                     reinterpret_cast<const Bytef*>(batch.data()),
+                     batch.size());
+  memcpy(&batch[0], &header, sizeof(header));
+
+  // The batch must be on disk before the table is touched, or a crash could
+  // leave the table torn with nothing to replay.
+  return file.Write(0, batch.data(), batch.size()) ==
+             static_cast<int>(batch.size()) &&
+         file.Flush();
+}
+
+// Applies the batches in the journal from |applied_journal_sequence| on to
+// |entries|. Applying a batch twice is harmless. A torn batch, and anything
+// after it, is ignored. Returns true if any batch was applied.
+bool ReplayJournal(const base::FilePath& journal_path,
+                   uint64_t applied_journal_sequence,
+                   SimpleIndex::EntrySet* entries) {
+  std::string journal;
+  if (!base::ReadFileToString(journal_path, &journal))
+    return false;
+
+  bool replayed = false;
+  size_t offset = 0;
+  while (journal.size() - offset >= sizeof(JournalBatchHeader)) {
+    JournalBatchHeader header;
+    memcpy(&header, journal.data() + offset, sizeof(header));
+    if (header.magic_number != kJournalMagicNumber)
+      break;
+    const uint64_t batch_size =
+        sizeof(header) +
+        uint64_t{header.entry_count} * sizeof(SimpleIndexTable::Slot) +
+        uint64_t{header.removed_entry_count} * sizeof(uint64_t);
+    if (batch_size > journal.size() - offset)
+      break;
+
+    const uint32_t crc_read = header.crc;
+    header.crc = 0;
+    const char* data = journal.data() + offset + sizeof(header);
+    uint32_t crc_calculated =
+        crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(&header),
+              sizeof(header));
+    crc_calculated =
+        crc32(crc_calculated, reinterpret_cast<const Bytef*>(data),
+              batch_size - sizeof(header));
+    if (crc_read != crc_calculated) {
+      LOG(WARNING) << "Torn batch in the Simple Index journal.";
+      break;
+    }
+
+    if (header.sequence >= applied_journal_sequence) {
+      for (uint32_t i = 0; i < header.entry_count; ++i) {
+        SimpleIndexTable::Slot slot;
+        memcpy(&slot, data, sizeof(slot));
+        data += sizeof(slot);
+        if (!IsReservedHash(slot.entry_hash))
+          (*entries)[slot.entry_hash] = slot.metadata;
+      }
+      for (uint32_t i = 0; i < header.removed_entry_count; ++i) {
+        uint64_t entry_hash;
+        memcpy(&entry_hash, data, sizeof(entry_hash));
+        data += sizeof(entry_hash);
+        entries->erase(entry_hash);
+      }
+      replayed = true;
+    }
+    offset += batch_size;
+  }
+  return replayed;
+}
+
+bool ApplyUpdate(const base::FilePath& table_path,
+                 const base::FilePath& journal_path,
+                 const SimpleIndexTable::Update& update,
+                 const SimpleIndexTable::Metadata& metadata) {
+  MappedTable table;
+  if (!table.Open(table_path, true /* writable */))
+    return false;
+  TableHeader* header = table.header();
+  if (header->used_slot_count + update.entries.size() >
+      GetMaxUsedSlotCount(header->capacity)) {
+    return false;
+  }
+
+  const uint64_t sequence = header->applied_journal_sequence + 1;
+  if (!AppendToJournal(journal_path, sequence, update))
+    return false;
+
+  for (const SimpleIndexTable::Slot& slot : update.entries) {
+    if (!IsReservedHash(slot.entry_hash) &&
+        !table.Set(slot.entry_hash, slot.metadata)) {
+      return false;
+    }
+  }
+  for (uint64_t entry_hash : update.removed_entries)
+    table.Remove(entry_hash);
+  table.FinishHeader(metadata, sequence);
+  return true;
+}
+
+}  // namespace
+
+SimpleIndexTable::Update::Update() {}
+
+SimpleIndexTable::Update::~Update() {}
+
+// static
+bool SimpleIndexTable::Load(const base::FilePath& table_path,
+                            const base::FilePath& journal_path,
+                            SimpleIndex::EntrySet* out_entries,
+                            Metadata* out_metadata,
+                            bool* out_journal_replayed) {
+  DCHECK(out_entries->empty());
+  *out_journal_replayed = false;
+
+  MappedTable table;
+  if (!table.Open(table_path, false /* writable */))
+    return false;
+  const TableHeader header = *table.header();
+  if (header.reason > SimpleIndex::INDEX_WRITE_REASON_MAX)
+    return false;
+
+  out_entries->reserve(header.entry_count);
+  const Slot* slots = table.slots();
+  for (uint64_t i = 0; i < header.capacity; ++i) {
+    if (!IsReservedHash(slots[i].entry_hash))
+      out_entries->insert(std::make_pair(slots[i].entry_hash,
+                                         slots[i].metadata));
+  }
+
+  out_metadata->reason =
+      static_cast<SimpleIndex::IndexWriteToDiskReason>(header.reason);
+  out_metadata->cache_size = header.cache_size;
+  out_metadata->cache_last_modified =
+      base::Time::FromInternalValue(header.cache_last_modified);
+  *out_journal_replayed = ReplayJournal(
+      journal_path, header.applied_journal_sequence, out_entries);
+  return true;
+}
+
+// static
+bool SimpleIndexTable::Write(const base::FilePath& table_path,
+                             const base::FilePath& temp_table_path,
+                             const base::FilePath& journal_path,
+                             const std::vector<Slot>& entries,
+                             const Metadata& metadata) {
+  // Should this write fail, there must be no table left behind for a later
+  // WriteUpdate() to apply its changes to, as it would miss these.
+  DeleteTable(table_path, journal_path);
+
+  uint64_t capacity = kMinCapacity;
+  while (capacity < entries.size() * 2)
+    capacity *= 2;
+  if (capacity > std::numeric_limits<uint32_t>::max())
+    return false;
+
+  {
+    File file(temp_table_path, File::FLAG_CREATE_ALWAYS | File::FLAG_READ |
+                                   File::FLAG_WRITE | File::FLAG_SHARE_DELETE);
+    if (!file.IsValid())
+      return false;
+    MappedTable table;
+    if (!file.SetLength(sizeof(TableHeader) + capacity * sizeof(Slot)) ||
+        !table.Create(std::move(file), static_cast<uint32_t>(capacity))) {
+      simple_util::SimpleCacheDeleteFile(temp_table_path);
+      return false;
+    }
+    for (const Slot& slot : entries) {
+      if (!IsReservedHash(slot.entry_hash))
+        table.Set(slot.entry_hash, slot.metadata);
+    }
+    table.FinishHeader(metadata, 0);
+  }
+  if (!SyncFile(temp_table_path)) {
+    simple_util::SimpleCacheDeleteFile(temp_table_path);
+    return false;
+  }
+  return base::ReplaceFile(temp_table_path, table_path, nullptr);
+}
+
+// static
+bool SimpleIndexTable::WriteUpdate(const base::FilePath& table_path,
+                                   const base::FilePath& journal_path,
+                                   const Update& update,
+                                   const Metadata& metadata) {
+  if (!ApplyUpdate(table_path, journal_path, update, metadata)) {
+    DeleteTable(table_path, journal_path);
+    return false;
+  }
+  // The journal is only truncated once the table is on disk. Should the table
+  // not be flushed, the batch stays in the journal to be replayed on the next
+  // load, and the table must be rewritten before the next update, since
+  // AppendToJournal() refuses to add a batch to a non-empty journal.
+  if (!SyncFile(table_path))
+    return false;
+  // Should this fail, the batch is replayed on the next load, which is
+  // harmless.
+  File journal(journal_path, File::FLAG_OPEN | File::FLAG_WRITE |
+                                 File::FLAG_SHARE_DELETE);
+  if (journal.IsValid())
+    journal.SetLength(0);
+  return true;
+}
+
+// static
+bool SimpleIndexTable::AppendToJournalForTesting(
+    const base::FilePath& journal_path,
+    uint64_t sequence,
+    const Update& update) {
+  return AppendToJournal(journal_path, sequence, update);
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,104 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_INDEX_TABLE_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_INDEX_TABLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/time/time.h"
+#include "net/base/net_export.h"
+#include "net/disk_cache/simple/simple_index.h"
+
+namespace base {
+class FilePath;
+}
+
+namespace disk_cache {
+
+// The index as a memory-mapped, open-addressing hash table of entry hashes and
+// EntryMetadata, which is updated in place. A write only touches the slots of
+// the entries which changed since the last write, instead of serializing the
+// whole EntrySet.
+//
+// Each batch of updates is first appended to a journal, which is flushed to
+// disk, and the journal is truncated once the batch is applied to the table
+// and the table is flushed too. If a crash tears the table while a batch is
+// applied, the batch is replayed on top of the table when it is loaded, and
+// the table is rewritten from scratch. A new table is flushed before it
+// replaces the old one. Only the header of the table is covered by a CRC, so
+// that an update doesn't have to read the whole table.
+//
+// All methods block on IO.
+class NET_EXPORT_PRIVATE SimpleIndexTable {
+ public:
+  struct Slot {
+    uint64_t entry_hash;
+    EntryMetadata metadata;
+  };
+
+  // The entries which were inserted or changed, and those which were removed,
+  // since the last write.
+  struct NET_EXPORT_PRIVATE Update {
+    Update();
+    ~Update();
+
+    std::vector<Slot> entries;
+    std::vector<uint64_t> removed_entries;
+  };
+
+  // Describes the table as a whole.
+  struct Metadata {
+    SimpleIndex::IndexWriteToDiskReason reason;
+    uint64_t cache_size;
+    // The modification time of the cache directory when the table was
+    // written, to detect a stale index.
+    base::Time cache_last_modified;
+  };
+
+  // Reads the table at |table_path|, and the batches in the journal at
+  // |journal_path| which are not applied to it yet, into |out_entries|.
+  // Returns false if the table is missing or corrupt. Sets
+  // |out_journal_replayed| if the table must be rewritten with Write() to
+  // catch up with the journal.
+  static bool Load(const base::FilePath& table_path,
+                   const base::FilePath& journal_path,
+                   SimpleIndex::EntrySet* out_entries,
+                   Metadata* out_metadata,
+                   bool* out_journal_replayed);
+
+  // Writes a new table of |entries| to |temp_table_path|, renames it to
+  // |table_path|, and deletes the journal. Returns false on failure.
+  static bool Write(const base::FilePath& table_path,
+                    const base::FilePath& temp_table_path,
+                    const base::FilePath& journal_path,
+                    const std::vector<Slot>& entries,
+                    const Metadata& metadata);
+
+  // Journals |update| and applies it to the table in place. Returns false, and
+  // deletes the table, if the table must be rewritten with Write() because it
+  // is missing, corrupt or full, or because an earlier update was not applied.
+  // Also returns false, but leaves the batch in the journal, if the updated
+  // table can't be flushed to disk.
+  static bool WriteUpdate(const base::FilePath& table_path,
+                          const base::FilePath& journal_path,
+                          const Update& update,
+                          const Metadata& metadata);
+
+  // Appends |update| to the journal as batch |sequence|, as if a crash had
+  // happened before it was applied to the table.
+  static bool AppendToJournalForTesting(const base::FilePath& journal_path,
+                                        uint64_t sequence,
+                                        const Update& update);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SimpleIndexTable);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_INDEX_TABLE_H_
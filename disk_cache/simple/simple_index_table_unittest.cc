@@ -0,0 +1,260 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_index_table.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+SimpleIndexTable::Slot MakeSlot(uint64_t entry_hash, uint32_t entry_size) {
+  return {entry_hash, EntryMetadata(base::Time::Now(), entry_size)};
+}
+
+class SimpleIndexTableTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    table_path_ = temp_dir_.GetPath().AppendASCII("table");
+    temp_table_path_ = temp_dir_.GetPath().AppendASCII("temp-table");
+    journal_path_ = temp_dir_.GetPath().AppendASCII("journal");
+    metadata_.reason = SimpleIndex::INDEX_WRITE_REASON_IDLE;
+    metadata_.cache_size = 1234;
+    metadata_.cache_last_modified = base::Time::Now();
+  }
+
+  bool Write(const std::vector<SimpleIndexTable::Slot>& entries) {
+    return SimpleIndexTable::Write(table_path_, temp_table_path_,
+                                   journal_path_, entries, metadata_);
+  }
+
+  bool WriteUpdate(const SimpleIndexTable::Update& update) {
+    return SimpleIndexTable::WriteUpdate(table_path_, journal_path_, update,
+                                         metadata_);
+  }
+
+  bool Load(SimpleIndex::EntrySet* out_entries, bool* out_journal_replayed) {
+    out_entries->clear();
+    SimpleIndexTable::Metadata metadata;
+    if (!SimpleIndexTable::Load(table_path_, journal_path_, out_entries,
+                                &metadata, out_journal_replayed)) {
+      return false;
+    }
+    EXPECT_EQ(metadata_.reason, metadata.reason);
+    EXPECT_EQ(metadata_.cache_size, metadata.cache_size);
+    EXPECT_EQ(metadata_.cache_last_modified, metadata.cache_last_modified);
+    return true;
+  }
+
+  void ExpectEntry(const SimpleIndex::EntrySet& entries,
+                   const SimpleIndexTable::Slot& expected) {
+    SimpleIndex::EntrySet::const_iterator it =
+        entries.find(expected.entry_hash);
+    ASSERT_TRUE(it != entries.end());
+    EXPECT_EQ(expected.metadata.GetLastUsedTime(),
+              it->second.GetLastUsedTime());
+    EXPECT_EQ(expected.metadata.GetEntrySize(), it->second.GetEntrySize());
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath table_path_;
+  base::FilePath temp_table_path_;
+  base::FilePath journal_path_;
+  SimpleIndexTable::Metadata metadata_;
+};
+
+TEST_F(SimpleIndexTableTest, WriteThenLoad) {
+  std::vector<SimpleIndexTable::Slot> entries;
+  for (uint32_t i = 0; i < 10000; ++i)
+    entries.push_back(MakeSlot(i * UINT64_C(0x9e3779b97f4a7c15) + 2, i));
+  ASSERT_TRUE(Write(entries));
+  EXPECT_FALSE(base::PathExists(temp_table_path_));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_FALSE(journal_replayed);
+  EXPECT_EQ(entries.size(), loaded.size());
+  for (const SimpleIndexTable::Slot& slot : entries)
+    ExpectEntry(loaded, slot);
+}
+
+TEST_F(SimpleIndexTableTest, WriteUpdate) {
+  const SimpleIndexTable::Slot kept = MakeSlot(11, 100);
+  const SimpleIndexTable::Slot removed = MakeSlot(22, 200);
+  ASSERT_TRUE(Write({kept, removed, MakeSlot(33, 300)}));
+
+  SimpleIndexTable::Update update;
+  const SimpleIndexTable::Slot changed = MakeSlot(33, 301);
+  const SimpleIndexTable::Slot added = MakeSlot(44, 400);
+  update.entries.push_back(changed);
+  update.entries.push_back(added);
+  update.removed_entries.push_back(removed.entry_hash);
+  metadata_.cache_size = 801;
+  ASSERT_TRUE(WriteUpdate(update));
+
+  // The removed slot is reused.
+  SimpleIndexTable::Update readd_update;
+  const SimpleIndexTable::Slot readded = MakeSlot(22, 202);
+  readd_update.entries.push_back(readded);
+  metadata_.cache_size = 1003;
+  ASSERT_TRUE(WriteUpdate(readd_update));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_FALSE(journal_replayed);
+  EXPECT_EQ(4U, loaded.size());
+  ExpectEntry(loaded, kept);
+  ExpectEntry(loaded, changed);
+  ExpectEntry(loaded, added);
+  ExpectEntry(loaded, readded);
+}
+
+TEST_F(SimpleIndexTableTest, UpdateWithoutTable) {
+  SimpleIndexTable::Update update;
+  update.entries.push_back(MakeSlot(11, 100));
+  EXPECT_FALSE(WriteUpdate(update));
+  EXPECT_FALSE(base::PathExists(table_path_));
+}
+
+// An update which would fill the table deletes it, so that it is rewritten.
+TEST_F(SimpleIndexTableTest, UpdateOverflow) {
+  ASSERT_TRUE(Write({MakeSlot(11, 100)}));
+
+  SimpleIndexTable::Update update;
+  for (uint32_t i = 0; i < 10000; ++i)
+    update.entries.push_back(MakeSlot(i + 2, i));
+  EXPECT_FALSE(WriteUpdate(update));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  EXPECT_FALSE(Load(&loaded, &journal_replayed));
+  EXPECT_FALSE(base::PathExists(journal_path_));
+}
+
+// A batch left in the journal by a crash is replayed on the next load.
+TEST_F(SimpleIndexTableTest, JournalReplay) {
+  const SimpleIndexTable::Slot kept = MakeSlot(11, 100);
+  const SimpleIndexTable::Slot removed = MakeSlot(22, 200);
+  ASSERT_TRUE(Write({kept, removed}));
+
+  SimpleIndexTable::Update update;
+  const SimpleIndexTable::Slot added = MakeSlot(33, 300);
+  update.entries.push_back(added);
+  update.removed_entries.push_back(removed.entry_hash);
+  ASSERT_TRUE(SimpleIndexTable::AppendToJournalForTesting(journal_path_, 1,
+                                                          update));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_TRUE(journal_replayed);
+  EXPECT_EQ(2U, loaded.size());
+  ExpectEntry(loaded, kept);
+  ExpectEntry(loaded, added);
+
+  // An update can't be applied until the table is rewritten.
+  EXPECT_FALSE(WriteUpdate(update));
+  EXPECT_FALSE(base::PathExists(table_path_));
+}
+
+// A batch older than the last one applied to the table, or which was torn by
+// a crash, is ignored.
+TEST_F(SimpleIndexTableTest, JournalIgnoredBatches) {
+  const SimpleIndexTable::Slot kept = MakeSlot(11, 100);
+  ASSERT_TRUE(Write({kept}));
+  SimpleIndexTable::Update applied_update;
+  applied_update.entries.push_back(MakeSlot(33, 300));
+  ASSERT_TRUE(WriteUpdate(applied_update));
+
+  SimpleIndexTable::Update update;
+  update.removed_entries.push_back(kept.entry_hash);
+  ASSERT_TRUE(SimpleIndexTable::AppendToJournalForTesting(journal_path_, 0,
+                                                          update));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_FALSE(journal_replayed);
+  ExpectEntry(loaded, kept);
+
+  ASSERT_TRUE(base::DeleteFile(journal_path_, false));
+  ASSERT_TRUE(SimpleIndexTable::AppendToJournalForTesting(journal_path_, 2,
+                                                          update));
+  base::File journal(journal_path_,
+                     base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+  ASSERT_TRUE(journal.IsValid());
+  ASSERT_TRUE(journal.SetLength(journal.GetLength() - 3));
+  journal.Close();
+
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_FALSE(journal_replayed);
+  ExpectEntry(loaded, kept);
+}
+
+// The header of the table may reach the disk before the slots an update
+// changed. The last batch it claims is applied is replayed anyway.
+TEST_F(SimpleIndexTableTest, JournalReplayWithStaleSlots) {
+  const SimpleIndexTable::Slot kept = MakeSlot(11, 100);
+  const SimpleIndexTable::Slot removed = MakeSlot(22, 200);
+  ASSERT_TRUE(Write({kept, removed}));
+  std::string stale_table;
+  ASSERT_TRUE(base::ReadFileToString(table_path_, &stale_table));
+
+  SimpleIndexTable::Update update;
+  const SimpleIndexTable::Slot added = MakeSlot(33, 300);
+  update.entries.push_back(added);
+  update.removed_entries.push_back(removed.entry_hash);
+  ASSERT_TRUE(WriteUpdate(update));
+
+  // Put the updated header, which covers batch 1, on top of the slots from
+  // before the update, and put the batch back in the journal.
+  std::string updated_table;
+  ASSERT_TRUE(base::ReadFileToString(table_path_, &updated_table));
+  const size_t kHeaderSize = 64;
+  stale_table.replace(0, kHeaderSize, updated_table, 0, kHeaderSize);
+  ASSERT_EQ(static_cast<int>(stale_table.size()),
+            base::WriteFile(table_path_, stale_table.data(),
+                            stale_table.size()));
+  ASSERT_TRUE(SimpleIndexTable::AppendToJournalForTesting(journal_path_, 1,
+                                                          update));
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  ASSERT_TRUE(Load(&loaded, &journal_replayed));
+  EXPECT_TRUE(journal_replayed);
+  EXPECT_EQ(2U, loaded.size());
+  ExpectEntry(loaded, kept);
+  ExpectEntry(loaded, added);
+}
+
+TEST_F(SimpleIndexTableTest, CorruptHeader) {
+  ASSERT_TRUE(Write({MakeSlot(11, 100)}));
+  base::File table(table_path_, base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+  ASSERT_TRUE(table.IsValid());
+  const char kGarbage = 0x7f;
+  ASSERT_EQ(1, table.Write(16, &kGarbage, 1));
+  table.Close();
+
+  SimpleIndex::EntrySet loaded;
+  bool journal_replayed;
+  EXPECT_FALSE(Load(&loaded, &journal_replayed));
+}
+
+}  // namespace
+
+}  // namespace disk_cache
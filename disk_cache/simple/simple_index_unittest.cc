@@ -53,7 +53,7 @@ class MockSimpleIndexFile : public SimpleIndexFile,
                             public base::SupportsWeakPtr<MockSimpleIndexFile> {
  public:
   MockSimpleIndexFile()
-      : SimpleIndexFile(NULL, NULL, net::DISK_CACHE, base::FilePath()),
+      : SimpleIndexFile(NULL, NULL, net::DISK_CACHE, base::FilePath(), NULL),
         load_result_(NULL),
         load_index_entries_calls_(0),
         disk_writes_(0) {}
@@ -568,6 +568,28 @@ TEST_F(SimpleIndexTest, BasicEviction) {
   ASSERT_EQ(2u, last_doom_entry_hashes().size());
 }
 
+TEST_F(SimpleIndexTest, EvictionCandidate) {
+  base::Time now(base::Time::Now());
+  index()->SetMaxSize(1000);
+  InsertIntoIndexFileReturn(hashes_.at<1>(),
+                            now - base::TimeDelta::FromDays(1), 300u);
+  InsertIntoIndexFileReturn(hashes_.at<2>(),
+                            now - base::TimeDelta::FromDays(3), 300u);
+  InsertIntoIndexFileReturn(hashes_.at<3>(),
+                            now - base::TimeDelta::FromDays(2), 200u);
+  ReturnIndexFile();
+
+  // Not full enough for a new entry to make eviction take one.
+  uint64_t entry_hash;
+  EXPECT_FALSE(index()->GetEvictionCandidate(&entry_hash));
+
+  // With this few entries, all of them are looked at.
+  index()->UpdateEntrySize(hashes_.at<3>(), 350u);
+  ASSERT_TRUE(index()->GetEvictionCandidate(&entry_hash));
+  EXPECT_EQ(hashes_.at<2>(), entry_hash);
+  EXPECT_EQ(0, doom_entries_calls());
+}
+
 // Confirm all the operations queue a disk write at some point in the
 // future.
 TEST_F(SimpleIndexTest, DiskWriteQueued) {
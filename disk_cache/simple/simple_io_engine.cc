@@ -0,0 +1,82 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_io_engine.h"
+
+#include "base/files/file.h"
+#include "base/logging.h"
+#include "net/net_features.h"
+
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+#include "base/feature_list.h"
+#include "base/lazy_instance.h"
+#include "net/disk_cache/simple/simple_experiment.h"
+#include "net/disk_cache/simple/simple_io_engine_uring_linux.h"
+#endif
+
+namespace disk_cache {
+
+namespace {
+
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+class LeakyUringIOEngine {
+ public:
+  LeakyUringIOEngine() : engine_(SimpleUringIOEngine::Create()) {
+    if (!engine_)
+      LOG(WARNING) << "io_uring is not available, using base::File.";
+  }
+
+  SimpleIOEngine* get() { return engine_; }
+
+ private:
+  SimpleIOEngine* const engine_;
+
+  DISALLOW_COPY_AND_ASSIGN(LeakyUringIOEngine);
+};
+
+base::LazyInstance<LeakyUringIOEngine>::Leaky g_uring_io_engine =
+    LAZY_INSTANCE_INITIALIZER;
+#endif
+
+}  // namespace
+
+// static
+SimpleIOEngine::Operation SimpleIOEngine::Operation::Read(base::File* file,
+                                                          int64_t offset,
+                                                          char* data,
+                                                          int size) {
+  return {READ, file, offset, data, size, 0};
+}
+
+// static
+SimpleIOEngine::Operation SimpleIOEngine::Operation::Write(base::File* file,
+                                                           int64_t offset,
+                                                           const char* data,
+                                                           int size) {
+  return {WRITE, file, offset, const_cast<char*>(data), size, 0};
+}
+
+// static
+SimpleIOEngine* SimpleIOEngine::Get() {
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+  if (base::FeatureList::IsEnabled(kSimpleCacheIOUring))
+    return g_uring_io_engine.Get().get();
+#endif
+  return nullptr;
+}
+
+// static
+void SimpleIOEngine::RunSynchronously(std::vector<Operation>* operations) {
+  for (Operation& operation : *operations) {
+    if (operation.type == Operation::READ) {
+      operation.result = operation.file->Read(operation.offset, operation.data,
+                                              operation.size);
+    } else {
+      operation.result = operation.file->Write(
+          operation.offset, operation.data, operation.size);
+    }
+  }
+}
+
+}  // namespace disk_cache
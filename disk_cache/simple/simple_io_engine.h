@@ -0,0 +1,76 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "net/base/net_export.h"
+
+namespace base {
+class File;
+}
+
+namespace disk_cache {
+
+// Performs the reads and writes of SimpleSynchronousEntry on its files. An
+// entry hands over all the operations of one step, such as writing the EOF
+// records of all its streams, at once, so that an engine can issue them
+// together, along with those of the entries running on other worker threads.
+//
+// Without an engine, entries call base::File directly.
+class NET_EXPORT_PRIVATE SimpleIOEngine {
+ public:
+  struct NET_EXPORT_PRIVATE Operation {
+    enum Type {
+      READ,
+      WRITE,
+    };
+
+    static Operation Read(base::File* file,
+                          int64_t offset,
+                          char* data,
+                          int size);
+    static Operation Write(base::File* file,
+                           int64_t offset,
+                           const char* data,
+                           int size);
+
+    Type type;
+    base::File* file;
+    int64_t offset;
+    // Not written to by WRITE operations.
+    char* data;
+    int size;
+    // Set when the operation is complete, to what base::File::Read() or
+    // base::File::Write() would return.
+    int result;
+  };
+
+  // Returns the engine shared by all Simple cache backends, or null if no
+  // engine is enabled or the platform does not support it.
+  static SimpleIOEngine* Get();
+
+  // Runs |operations| on |base::File| in order, one at a time.
+  static void RunSynchronously(std::vector<Operation>* operations);
+
+  // Runs |operations|, in no particular order, and blocks until all of them
+  // are complete. May be called on any number of threads at once.
+  virtual void Run(std::vector<Operation>* operations) = 0;
+
+ protected:
+  SimpleIOEngine() {}
+  virtual ~SimpleIOEngine() {}
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SimpleIOEngine);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_H_
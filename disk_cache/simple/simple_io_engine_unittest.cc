@@ -0,0 +1,90 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_io_engine.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "net/net_features.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+#include "net/disk_cache/simple/simple_io_engine_uring_linux.h"
+#endif
+
+namespace disk_cache {
+
+namespace {
+
+typedef SimpleIOEngine::Operation Operation;
+
+class SimpleIOEngineTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    file_.Initialize(temp_dir_.GetPath().AppendASCII("file"),
+                     base::File::FLAG_CREATE | base::File::FLAG_READ |
+                         base::File::FLAG_WRITE);
+    ASSERT_TRUE(file_.IsValid());
+  }
+
+  // Writes two records, reads them back along with a read past the end of the
+  // file, and checks the results. |run| runs a batch of operations.
+  template <typename RunOperations>
+  void WriteAndReadBack(const RunOperations& run) {
+    const std::string first(1000, 'a');
+    const std::string second(5000, 'b');
+    std::vector<Operation> writes;
+    writes.push_back(Operation::Write(&file_, 0, first.data(), first.size()));
+    writes.push_back(Operation::Write(&file_, first.size(), second.data(),
+                                      second.size()));
+    run(&writes);
+    EXPECT_EQ(static_cast<int>(first.size()), writes[0].result);
+    EXPECT_EQ(static_cast<int>(second.size()), writes[1].result);
+
+    std::vector<char> first_read(first.size());
+    std::vector<char> second_read(second.size());
+    std::vector<char> past_end(100);
+    std::vector<Operation> reads;
+    reads.push_back(Operation::Read(&file_, 0, first_read.data(),
+                                    first_read.size()));
+    reads.push_back(Operation::Read(&file_, first.size(), second_read.data(),
+                                    second_read.size()));
+    // Only half of this read is in the file.
+    reads.push_back(Operation::Read(&file_, first.size() + second.size() - 50,
+                                    past_end.data(), past_end.size()));
+    run(&reads);
+    EXPECT_EQ(static_cast<int>(first.size()), reads[0].result);
+    EXPECT_EQ(first, std::string(first_read.begin(), first_read.end()));
+    EXPECT_EQ(static_cast<int>(second.size()), reads[1].result);
+    EXPECT_EQ(second, std::string(second_read.begin(), second_read.end()));
+    EXPECT_EQ(50, reads[2].result);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::File file_;
+};
+
+TEST_F(SimpleIOEngineTest, RunSynchronously) {
+  WriteAndReadBack(&SimpleIOEngine::RunSynchronously);
+}
+
+#if BUILDFLAG(SIMPLE_CACHE_IO_URING)
+TEST_F(SimpleIOEngineTest, Uring) {
+  SimpleIOEngine* engine = SimpleUringIOEngine::Create();
+  if (!engine)
+    return;  // The kernel doesn't support io_uring reads and writes.
+  WriteAndReadBack([engine](std::vector<Operation>* operations) {
+    engine->Run(operations);
+  });
+}
+#endif
+
+}  // namespace
+
+}  // namespace disk_cache
@@ -0,0 +1,276 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_io_engine_uring_linux.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "base/files/file.h"
+#include "base/logging.h"
+
+namespace disk_cache {
+
+namespace {
+
+// The most operations in flight at once. The completion queue is twice as
+// large, so it can't overflow.
+const unsigned kQueueDepth = 256;
+
+int IoUringSetup(unsigned entries, io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IoUringEnter(int ring_fd,
+                 unsigned to_submit,
+                 unsigned min_complete,
+                 unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+// The ring indices are shared with the kernel.
+unsigned LoadAcquire(const unsigned* index) {
+  return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* index, unsigned value) {
+  __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+}  // namespace
+
+struct SimpleUringIOEngine::Request {
+  explicit Request(size_t pending_count) : pending_count(pending_count) {}
+
+  // Guarded by |lock_|.
+  size_t pending_count;
+};
+
+struct SimpleUringIOEngine::PendingOperation {
+  Request* request;
+  Operation* operation;
+  // Short reads and writes are submitted again for the rest of the operation.
+  int transferred;
+};
+
+// static
+SimpleUringIOEngine* SimpleUringIOEngine::Create() {
+  SimpleUringIOEngine* engine = new SimpleUringIOEngine();
+  if (!engine->Initialize()) {
+    delete engine;
+    return nullptr;
+  }
+  return engine;
+}
+
+void SimpleUringIOEngine::Run(std::vector<Operation>* operations) {
+  std::vector<PendingOperation> pending;
+  pending.reserve(operations->size());
+  for (Operation& operation : *operations) {
+    if (operation.size == 0) {
+      operation.result = 0;
+      continue;
+    }
+    pending.push_back({nullptr, &operation, 0});
+  }
+  if (pending.empty())
+    return;
+
+  Request request(pending.size());
+  base::AutoLock auto_lock(lock_);
+  for (PendingOperation& pending_operation : pending) {
+    pending_operation.request = &request;
+    queue_.push_back(&pending_operation);
+  }
+  work_available_.Signal();
+  while (request.pending_count > 0)
+    request_done_.Wait();
+}
+
+SimpleUringIOEngine::SimpleUringIOEngine()
+    : ring_fd_(-1),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+      sqes_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_array_(nullptr),
+      sq_mask_(0),
+      sq_entries_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cqes_(nullptr),
+      cq_mask_(0),
+      work_available_(&lock_),
+      request_done_(&lock_) {}
+
+SimpleUringIOEngine::~SimpleUringIOEngine() {
+  if (sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != MAP_FAILED)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != MAP_FAILED)
+    munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0)
+    close(ring_fd_);
+}
+
+bool SimpleUringIOEngine::Initialize() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(kQueueDepth, &params);
+  if (ring_fd_ < 0)
+    return false;
+  // IORING_OP_READ and IORING_OP_WRITE came with this feature, in Linux 5.6.
+  if (!(params.features & IORING_FEAT_RW_CUR_POS))
+    return false;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(
+      mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED)
+    return false;
+
+  char* sq_ring = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  char* cq_ring = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+
+  return base::PlatformThread::CreateNonJoinable(0, this);
+}
+
+void SimpleUringIOEngine::ThreadMain() {
+  base::PlatformThread::SetName("SimpleCacheIOUring");
+
+  // Operations to submit, with those which were cut short first.
+  std::deque<PendingOperation*> to_submit;
+  std::vector<PendingOperation*> completed;
+  // Operations in the submission queue which the kernel has not taken yet.
+  size_t unsubmitted_count = 0;
+  size_t in_flight_count = 0;
+  for (;;) {
+    {
+      base::AutoLock auto_lock(lock_);
+      while (queue_.empty() && to_submit.empty() && unsubmitted_count == 0 &&
+             in_flight_count == 0) {
+        work_available_.Wait();
+      }
+      while (!queue_.empty() &&
+             to_submit.size() + unsubmitted_count + in_flight_count <
+                 sq_entries_) {
+        to_submit.push_back(queue_.front());
+        queue_.pop_front();
+      }
+    }
+
+    while (!to_submit.empty() &&
+           unsubmitted_count + in_flight_count < sq_entries_) {
+      PrepareSubmission(to_submit.front());
+      to_submit.pop_front();
+      ++unsubmitted_count;
+    }
+
+    const int submitted = IoUringEnter(ring_fd_, unsubmitted_count,
+                                       1 /* min_complete */,
+                                       IORING_ENTER_GETEVENTS);
+    if (submitted < 0) {
+      // Nothing was taken from the submission queue. Reap the completions
+      // that are ready, which may make room for the submissions.
+      PCHECK(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+          << "io_uring_enter";
+    } else {
+      unsubmitted_count -= submitted;
+      in_flight_count += submitted;
+    }
+
+    in_flight_count -= ReapCompletions(&to_submit, &completed);
+    if (completed.empty())
+      continue;
+    bool request_done = false;
+    {
+      base::AutoLock auto_lock(lock_);
+      for (PendingOperation* pending : completed) {
+        if (--pending->request->pending_count == 0)
+          request_done = true;
+      }
+      if (request_done)
+        request_done_.Broadcast();
+    }
+    completed.clear();
+  }
+}
+
+void SimpleUringIOEngine::PrepareSubmission(PendingOperation* pending) {
+  const Operation* operation = pending->operation;
+  // Only this thread writes the tail of the submission queue.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode =
+      operation->type == Operation::READ ? IORING_OP_READ : IORING_OP_WRITE;
+  sqe->fd = operation->file->GetPlatformFile();
+  sqe->off = operation->offset + pending->transferred;
+  sqe->addr =
+      reinterpret_cast<uint64_t>(operation->data + pending->transferred);
+  sqe->len = operation->size - pending->transferred;
+  sqe->user_data = reinterpret_cast<uint64_t>(pending);
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+}
+
+size_t SimpleUringIOEngine::ReapCompletions(
+    std::deque<PendingOperation*>* to_submit,
+    std::vector<PendingOperation*>* completed) {
+  // Only this thread writes the head of the completion queue.
+  unsigned head = *cq_head_;
+  const unsigned tail = LoadAcquire(cq_tail_);
+  size_t count = 0;
+  for (; head != tail; ++head, ++count) {
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    PendingOperation* pending =
+        reinterpret_cast<PendingOperation*>(cqe.user_data);
+    Operation* operation = pending->operation;
+    if (cqe.res > 0) {
+      pending->transferred += cqe.res;
+      if (pending->transferred < operation->size) {
+        to_submit->push_front(pending);
+        continue;
+      }
+    }
+    // Like base::File, report the bytes transferred before an error or the
+    // end of the file, if any.
+    operation->result =
+        (cqe.res < 0 && pending->transferred == 0) ? -1 : pending->transferred;
+    completed->push_back(pending);
+  }
+  StoreRelease(cq_head_, head);
+  return count;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,94 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_URING_LINUX_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_URING_LINUX_H_
+
+#include <stddef.h>
+
+#include <deque>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "net/base/net_export.h"
+#include "net/disk_cache/simple/simple_io_engine.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace disk_cache {
+
+// A SimpleIOEngine which issues the operations of all the worker threads
+// through a single io_uring, so that the reads and writes of many entries go
+// to the kernel in one system call. The ring is driven by a thread of its own:
+// it submits the operations queued by Run() as soon as there is room in the
+// ring, and wakes the callers as their operations complete.
+class NET_EXPORT_PRIVATE SimpleUringIOEngine
+    : public SimpleIOEngine,
+      public base::PlatformThread::Delegate {
+ public:
+  // Returns null if the kernel does not support io_uring reads and writes.
+  // The engine is never destroyed.
+  static SimpleUringIOEngine* Create();
+
+  // SimpleIOEngine:
+  void Run(std::vector<Operation>* operations) override;
+
+ private:
+  struct Request;
+  struct PendingOperation;
+
+  SimpleUringIOEngine();
+  ~SimpleUringIOEngine() override;
+
+  // Sets up the ring, and starts the thread driving it.
+  bool Initialize();
+
+  // base::PlatformThread::Delegate:
+  void ThreadMain() override;
+
+  // Fills a submission queue entry for the rest of |pending|.
+  void PrepareSubmission(PendingOperation* pending);
+
+  // Takes the completions off the ring. Operations which were cut short are
+  // added to |to_submit|, and the others to |completed|. Returns the number
+  // of completions.
+  size_t ReapCompletions(std::deque<PendingOperation*>* to_submit,
+                         std::vector<PendingOperation*>* completed);
+
+  int ring_fd_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  io_uring_cqe* cqes_;
+  unsigned cq_mask_;
+
+  base::Lock lock_;
+  // Signaled when operations are added to |queue_|.
+  base::ConditionVariable work_available_;
+  // Broadcast when the last operation of a Request completes.
+  base::ConditionVariable request_done_;
+  // Operations waiting to be submitted. Guarded by |lock_|.
+  std::deque<PendingOperation*> queue_;
+
+  DISALLOW_COPY_AND_ASSIGN(SimpleUringIOEngine);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_IO_ENGINE_URING_LINUX_H_
@@ -0,0 +1,567 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_packed_store.h"
+
+#include <string.h>
+
+#include <memory>
+#include <unordered_set>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/files/file.h"
+#include "base/files/file_enumerator.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/task_runner.h"
+#include "net/base/net_errors.h"
+#include "net/disk_cache/simple/simple_util.h"
+#include "third_party/zlib/zlib.h"
+
+namespace disk_cache {
+
+namespace {
+
+const char kSegmentFilePrefix[] = "packed_";
+const base::FilePath::CharType kSegmentFilePattern[] =
+    FILE_PATH_LITERAL("packed_*");
+
+const int64_t kDefaultMaxSegmentSize = 16 * 1024 * 1024;
+
+// A segment is compacted once this much of it is dead space.
+const int64_t kCompactionDeadSpacePercent = 50;
+
+// Segments that were left short by a restart are merged into the current
+// segment if they are smaller than this fraction of a full one.
+const int64_t kCompactionMinSegmentFraction = 4;
+
+// Returns the size of the record that starts with |header|, or 0 if |header|
+// is not a valid record header.
+uint32_t GetRecordSize(const SimplePackedRecordHeader& header) {
+  if (header.packed_record_magic_number != kSimplePackedRecordMagicNumber)
+    return 0;
+  if (header.flags & SimplePackedRecordHeader::FLAG_REMOVED)
+    return sizeof(header);
+  int64_t payload_size = header.key_length;
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i) {
+    if (header.data_size[i] < 0)
+      return 0;
+    payload_size += header.data_size[i];
+  }
+  if (payload_size > SimplePackedStore::kMaxEntrySize)
+    return 0;
+  return sizeof(header) + static_cast<uint32_t>(payload_size);
+}
+
+std::string SerializeRecord(uint64_t entry_hash,
+                            const SimplePackedStore::EntryData& data) {
+  SimplePackedRecordHeader header;
+  header.packed_record_magic_number = kSimplePackedRecordMagicNumber;
+  header.entry_hash = entry_hash;
+  header.key_length = data.key.size();
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+    header.data_size[i] = data.stream_data[i].size();
+  header.last_modified = data.last_modified.ToInternalValue();
+
+  std::string record(sizeof(header), '\0');
+  record.append(data.key);
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+    record.append(data.stream_data[i]);
+  header.data_crc32 =
+      crc32(crc32(0, Z_NULL, 0),
+            reinterpret_cast<const Bytef*>(record.data() + sizeof(header)),
+            record.size() - sizeof(header));
+  memcpy(&record[0], &header, sizeof(header));
+  return record;
+}
+
+std::string SerializeRemovalRecord(uint64_t entry_hash) {
+  SimplePackedRecordHeader header;
+  header.packed_record_magic_number = kSimplePackedRecordMagicNumber;
+  header.entry_hash = entry_hash;
+  header.flags = SimplePackedRecordHeader::FLAG_REMOVED;
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+}  // namespace
+
+const int SimplePackedStore::kMaxEntrySize = 16 * 1024;
+
+struct SimplePackedStore::Segment
+    : public base::RefCountedThreadSafe<Segment> {
+  Segment() : size(0), dead_bytes(0) {}
+
+  base::File file;
+  // The offset of the end of the last valid record.
+  int64_t size;
+  int64_t dead_bytes;
+  base::Time last_modified;
+  // The hashes of the entries with a record, live or not, in this segment.
+  std::unordered_set<uint64_t> entry_hashes;
+  // The hashes of the removal records in this segment which are still
+  // needed, because an older segment holds a record they remove. Other
+  // removal records are counted as dead space.
+  std::unordered_set<uint64_t> removal_hashes;
+
+ private:
+  friend class base::RefCountedThreadSafe<Segment>;
+  ~Segment() {}
+
+  DISALLOW_COPY_AND_ASSIGN(Segment);
+};
+
+SimplePackedStore::EntryData::EntryData() {}
+
+SimplePackedStore::EntryData::~EntryData() {}
+
+SimplePackedStore::SimplePackedStore(
+    const base::FilePath& path,
+    const scoped_refptr<base::TaskRunner>& worker_pool)
+    : path_(path),
+      worker_pool_(worker_pool),
+      max_segment_size_(kDefaultMaxSegmentSize),
+      current_segment_id_(-1),
+      next_segment_id_(0),
+      next_generation_(0),
+      compaction_pending_(false) {}
+
+void SimplePackedStore::Load() {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(segments_.empty());
+
+  std::map<int32_t, base::FilePath> filenames;
+  base::FileEnumerator enumerator(path_, false /* recursive */,
+                                  base::FileEnumerator::FILES,
+                                  kSegmentFilePattern);
+  for (base::FilePath filename = enumerator.Next(); !filename.empty();
+       filename = enumerator.Next()) {
+    const std::string name = filename.BaseName().MaybeAsASCII();
+    int segment_id;
+    if (!base::StringToInt(
+            base::StringPiece(name).substr(strlen(kSegmentFilePrefix)),
+            &segment_id) ||
+        segment_id < 0) {
+      continue;
+    }
+    filenames[segment_id] = filename;
+  }
+
+  // Records are applied in the order they were written.
+  for (const auto& it : filenames) {
+    if (!LoadSegment(it.first, it.second)) {
+      LOG(WARNING) << "Could not read packed segment "
+                   << it.second.LossyDisplayName();
+      simple_util::SimpleCacheDeleteFile(it.second);
+    }
+    next_segment_id_ = it.first + 1;
+  }
+}
+
+bool SimplePackedStore::HasEntry(uint64_t entry_hash) const {
+  base::AutoLock auto_lock(lock_);
+  return entries_.count(entry_hash) != 0;
+}
+
+int SimplePackedStore::ReadEntry(uint64_t entry_hash,
+                                 EntryData* out_data) const {
+  RecordLocation location;
+  scoped_refptr<Segment> segment;
+  {
+    base::AutoLock auto_lock(lock_);
+    auto it = entries_.find(entry_hash);
+    if (it == entries_.end())
+      return net::ERR_FAILED;
+    location = it->second;
+    segment = segments_.find(location.segment_id)->second;
+  }
+
+  // The whole record is read at once, outside of the lock.
+  std::string record(location.size, '\0');
+  const int size = base::checked_cast<int>(location.size);
+  if (segment->file.Read(location.offset, &record[0], size) != size)
+    return net::ERR_CACHE_READ_FAILURE;
+
+  SimplePackedRecordHeader header;
+  memcpy(&header, record.data(), sizeof(header));
+  if (GetRecordSize(header) != location.size ||
+      header.entry_hash != entry_hash ||
+      (header.flags & SimplePackedRecordHeader::FLAG_REMOVED)) {
+    return net::ERR_FAILED;
+  }
+  const char* payload = record.data() + sizeof(header);
+  if (crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(payload),
+            record.size() - sizeof(header)) != header.data_crc32) {
+    return net::ERR_CACHE_CHECKSUM_MISMATCH;
+  }
+
+  out_data->key.assign(payload, header.key_length);
+  payload += header.key_length;
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i) {
+    out_data->stream_data[i].assign(payload, header.data_size[i]);
+    payload += header.data_size[i];
+  }
+  out_data->last_modified = base::Time::FromInternalValue(header.last_modified);
+  return net::OK;
+}
+
+uint64_t SimplePackedStore::AcquireEntry(uint64_t entry_hash) {
+  base::AutoLock auto_lock(lock_);
+  auto result = handles_.insert(std::make_pair(entry_hash, Handle()));
+  Handle& handle = result.first->second;
+  if (result.second) {
+    handle.generation = next_generation_++;
+    handle.count = 0;
+  }
+  ++handle.count;
+  return handle.generation;
+}
+
+void SimplePackedStore::ReleaseEntry(uint64_t entry_hash) {
+  base::AutoLock auto_lock(lock_);
+  auto it = handles_.find(entry_hash);
+  DCHECK(it != handles_.end());
+  if (--it->second.count == 0)
+    handles_.erase(it);
+}
+
+bool SimplePackedStore::IsCurrentGeneration(uint64_t entry_hash,
+                                            uint64_t generation) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = handles_.find(entry_hash);
+  return it != handles_.end() && it->second.generation == generation;
+}
+
+bool SimplePackedStore::WriteEntry(uint64_t entry_hash,
+                                   uint64_t generation,
+                                   const EntryData& data) {
+  const std::string record = SerializeRecord(entry_hash, data);
+  if (GetRecordSize(*reinterpret_cast<const SimplePackedRecordHeader*>(
+          record.data())) != record.size()) {
+    NOTREACHED() << "Entry is too large for the packed store.";
+    return false;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  auto handle = handles_.find(entry_hash);
+  if (handle == handles_.end() || handle->second.generation != generation)
+    return false;
+
+  RecordLocation location;
+  if (!AppendRecordLocked(record, &location)) {
+    // The entry must not be read back as it was before this write.
+    RemoveEntryLocked(entry_hash);
+    return false;
+  }
+  auto result = entries_.insert(std::make_pair(entry_hash, location));
+  if (!result.second) {
+    ReleaseRecordLocked(result.first->second);
+    result.first->second = location;
+  }
+  MaybeScheduleCompactionLocked();
+  return true;
+}
+
+bool SimplePackedStore::RemoveEntry(uint64_t entry_hash) {
+  base::AutoLock auto_lock(lock_);
+  auto handle = handles_.find(entry_hash);
+  if (handle != handles_.end())
+    handle->second.generation = next_generation_++;
+  return RemoveEntryLocked(entry_hash);
+}
+
+void SimplePackedStore::ForEachEntry(const EntryCallback& callback) const {
+  base::AutoLock auto_lock(lock_);
+  for (const auto& it : entries_) {
+    const Segment* segment = segments_.find(it.second.segment_id)->second.get();
+    callback.Run(it.first, it.second.size, segment->last_modified);
+  }
+}
+
+void SimplePackedStore::Compact() {
+  for (;;) {
+    int32_t segment_id;
+    {
+      base::AutoLock auto_lock(lock_);
+      segment_id = FindSegmentToCompactLocked();
+      if (segment_id < 0) {
+        compaction_pending_ = false;
+        return;
+      }
+    }
+    if (!CompactSegment(segment_id)) {
+      // Try again after the next write.
+      base::AutoLock auto_lock(lock_);
+      compaction_pending_ = false;
+      return;
+    }
+  }
+}
+
+int SimplePackedStore::GetSegmentCountForTesting() const {
+  base::AutoLock auto_lock(lock_);
+  return static_cast<int>(segments_.size());
+}
+
+SimplePackedStore::~SimplePackedStore() {
+  // The last reference may be released on the IO thread, where closing the
+  // segment files is not allowed.
+  if (worker_pool_ && !segments_.empty()) {
+    std::unique_ptr<SegmentMap> segments(new SegmentMap);
+    segments->swap(segments_);
+    worker_pool_->PostTask(
+        FROM_HERE,
+        base::Bind(&base::DeletePointer<SegmentMap>, segments.release()));
+  }
+}
+
+base::FilePath SimplePackedStore::GetSegmentFilename(
+    int32_t segment_id) const {
+  return path_.AppendASCII(kSegmentFilePrefix +
+                           base::IntToString(segment_id));
+}
+
+bool SimplePackedStore::LoadSegment(int32_t segment_id,
+                                    const base::FilePath& filename) {
+  lock_.AssertAcquired();
+  scoped_refptr<Segment> segment(new Segment);
+  segment->file.Initialize(filename, base::File::FLAG_OPEN |
+                                         base::File::FLAG_READ |
+                                         base::File::FLAG_SHARE_DELETE);
+  base::File::Info file_info;
+  if (!segment->file.IsValid() || !segment->file.GetInfo(&file_info))
+    return false;
+  segment->last_modified = file_info.last_modified;
+  segments_[segment_id] = segment;
+
+  SimplePackedRecordHeader header;
+  int64_t offset = 0;
+  while (offset + static_cast<int64_t>(sizeof(header)) <= file_info.size) {
+    if (segment->file.Read(offset, reinterpret_cast<char*>(&header),
+                           sizeof(header)) != sizeof(header)) {
+      break;
+    }
+    const uint32_t record_size = GetRecordSize(header);
+    // A write that was cut short leaves a torn record at the end of the
+    // segment.
+    if (record_size == 0 || offset + record_size > file_info.size)
+      break;
+
+    auto it = entries_.find(header.entry_hash);
+    if (it != entries_.end())
+      ReleaseRecordLocked(it->second);
+    const RecordLocation location = {segment_id, record_size, offset};
+    if (header.flags & SimplePackedRecordHeader::FLAG_REMOVED) {
+      if (it != entries_.end())
+        entries_.erase(it);
+      AddRemovalRecordLocked(header.entry_hash, location);
+    } else {
+      segment->entry_hashes.insert(header.entry_hash);
+      if (it != entries_.end())
+        it->second = location;
+      else
+        entries_.insert(std::make_pair(header.entry_hash, location));
+    }
+    offset += record_size;
+  }
+  segment->size = offset;
+  return true;
+}
+
+bool SimplePackedStore::AppendRecordLocked(const std::string& record,
+                                           RecordLocation* out_location) {
+  lock_.AssertAcquired();
+  const int size = base::checked_cast<int>(record.size());
+  Segment* segment = nullptr;
+  if (current_segment_id_ >= 0) {
+    segment = segments_.find(current_segment_id_)->second.get();
+    if (segment->size > 0 && segment->size + size > max_segment_size_)
+      segment = nullptr;
+  }
+  if (!segment) {
+    scoped_refptr<Segment> new_segment(new Segment);
+    new_segment->file.Initialize(
+        GetSegmentFilename(next_segment_id_),
+        base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_READ |
+            base::File::FLAG_WRITE | base::File::FLAG_SHARE_DELETE);
+    if (!new_segment->file.IsValid())
+      return false;
+    new_segment->last_modified = base::Time::Now();
+    current_segment_id_ = next_segment_id_++;
+    segments_[current_segment_id_] = new_segment;
+    segment = new_segment.get();
+  }
+
+  // A failed write may leave part of the record behind, which the next
+  // record overwrites.
+  if (segment->file.Write(segment->size, record.data(), size) != size)
+    return false;
+  out_location->segment_id = current_segment_id_;
+  out_location->size = record.size();
+  out_location->offset = segment->size;
+  segment->size += size;
+  const SimplePackedRecordHeader* header =
+      reinterpret_cast<const SimplePackedRecordHeader*>(record.data());
+  if (!(header->flags & SimplePackedRecordHeader::FLAG_REMOVED))
+    segment->entry_hashes.insert(header->entry_hash);
+  return true;
+}
+
+void SimplePackedStore::ReleaseRecordLocked(const RecordLocation& location) {
+  lock_.AssertAcquired();
+  auto it = segments_.find(location.segment_id);
+  DCHECK(it != segments_.end());
+  it->second->dead_bytes += location.size;
+}
+
+bool SimplePackedStore::RemoveEntryLocked(uint64_t entry_hash) {
+  lock_.AssertAcquired();
+  auto it = entries_.find(entry_hash);
+  if (it == entries_.end())
+    return false;
+  ReleaseRecordLocked(it->second);
+  entries_.erase(it);
+
+  RecordLocation location;
+  if (AppendRecordLocked(SerializeRemovalRecord(entry_hash), &location))
+    AddRemovalRecordLocked(entry_hash, location);
+  MaybeScheduleCompactionLocked();
+  return true;
+}
+
+void SimplePackedStore::AddRemovalRecordLocked(uint64_t entry_hash,
+                                               const RecordLocation& location) {
+  lock_.AssertAcquired();
+  Segment* segment = segments_.find(location.segment_id)->second.get();
+  if (!OlderSegmentHasRecordLocked(location.segment_id, entry_hash) ||
+      !segment->removal_hashes.insert(entry_hash).second) {
+    segment->dead_bytes += location.size;
+  }
+}
+
+bool SimplePackedStore::OlderSegmentHasRecordLocked(int32_t segment_id,
+                                                    uint64_t entry_hash) const {
+  lock_.AssertAcquired();
+  for (auto it = segments_.begin();
+       it != segments_.end() && it->first < segment_id; ++it) {
+    if (it->second->entry_hashes.count(entry_hash))
+      return true;
+  }
+  return false;
+}
+
+void SimplePackedStore::EraseSegmentLocked(int32_t segment_id) {
+  lock_.AssertAcquired();
+  auto it = segments_.find(segment_id);
+  if (it == segments_.end())
+    return;
+  scoped_refptr<Segment> segment = it->second;
+  segments_.erase(it);
+  simple_util::SimpleCacheDeleteFile(GetSegmentFilename(segment_id));
+
+  // The removal records in newer segments which only removed records in this
+  // one are not needed any more.
+  for (uint64_t entry_hash : segment->entry_hashes) {
+    for (auto newer = segments_.upper_bound(segment_id);
+         newer != segments_.end(); ++newer) {
+      Segment* newer_segment = newer->second.get();
+      if (newer_segment->removal_hashes.count(entry_hash) &&
+          !OlderSegmentHasRecordLocked(newer->first, entry_hash)) {
+        newer_segment->removal_hashes.erase(entry_hash);
+        newer_segment->dead_bytes += sizeof(SimplePackedRecordHeader);
+      }
+    }
+  }
+}
+
+int32_t SimplePackedStore::FindSegmentToCompactLocked() const {
+  lock_.AssertAcquired();
+  for (const auto& it : segments_) {
+    if (it.first == current_segment_id_)
+      continue;
+    const Segment* segment = it.second.get();
+    if (segment->dead_bytes * 100 >=
+            segment->size * kCompactionDeadSpacePercent ||
+        segment->size < max_segment_size_ / kCompactionMinSegmentFraction) {
+      return it.first;
+    }
+  }
+  return -1;
+}
+
+void SimplePackedStore::MaybeScheduleCompactionLocked() {
+  lock_.AssertAcquired();
+  if (!worker_pool_ || compaction_pending_ ||
+      FindSegmentToCompactLocked() < 0) {
+    return;
+  }
+  compaction_pending_ = true;
+  worker_pool_->PostTask(FROM_HERE,
+                         base::Bind(&SimplePackedStore::Compact, this));
+}
+
+bool SimplePackedStore::CompactSegment(int32_t segment_id) {
+  scoped_refptr<Segment> segment;
+  int64_t size;
+  {
+    base::AutoLock auto_lock(lock_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end())
+      return true;
+    segment = it->second;
+    size = segment->size;
+  }
+
+  std::string record;
+  SimplePackedRecordHeader header;
+  int64_t offset = 0;
+  while (offset < size) {
+    if (segment->file.Read(offset, reinterpret_cast<char*>(&header),
+                           sizeof(header)) != sizeof(header)) {
+      return false;
+    }
+    const uint32_t record_size = GetRecordSize(header);
+    if (record_size == 0)
+      return false;
+
+    base::AutoLock auto_lock(lock_);
+    RecordLocation location;
+    if (header.flags & SimplePackedRecordHeader::FLAG_REMOVED) {
+      // A removal is only kept while an older segment still holds a record
+      // that it removes.
+      if (!entries_.count(header.entry_hash) &&
+          OlderSegmentHasRecordLocked(segment_id, header.entry_hash)) {
+        if (!AppendRecordLocked(SerializeRemovalRecord(header.entry_hash),
+                                &location)) {
+          return false;
+        }
+        AddRemovalRecordLocked(header.entry_hash, location);
+      }
+    } else {
+      auto it = entries_.find(header.entry_hash);
+      if (it != entries_.end() && it->second.segment_id == segment_id &&
+          it->second.offset == offset) {
+        record.resize(record_size);
+        if (segment->file.Read(offset, &record[0], record_size) !=
+                static_cast<int>(record_size) ||
+            !AppendRecordLocked(record, &location)) {
+          return false;
+        }
+        ReleaseRecordLocked(it->second);
+        it->second = location;
+      }
+    }
+    offset += record_size;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  EraseSegmentLocked(segment_id);
+  return true;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,193 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_PACKED_STORE_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_PACKED_STORE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "base/callback_forward.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "net/base/net_export.h"
+#include "net/disk_cache/simple/simple_entry_format.h"
+
+namespace base {
+class TaskRunner;
+}
+
+namespace disk_cache {
+
+// SimplePackedStore keeps small Simple cache entries in a few large,
+// append-only segment files in the cache directory, instead of in files of
+// their own. This saves an inode per entry, and an open() and close() per
+// access. The map from entry hash to the latest record for that entry, which
+// uses the same hashes as the SimpleIndex, lives in memory and is rebuilt from
+// the record headers by Load().
+//
+// Records that are replaced or removed leave dead space behind. Once enough of
+// a segment is dead, the segment is compacted on the worker pool: its live
+// records are copied to the end of the current segment, and its file is
+// deleted.
+//
+// All methods may be called on any thread, and may block on IO.
+class NET_EXPORT_PRIVATE SimplePackedStore
+    : public base::RefCountedThreadSafe<SimplePackedStore> {
+ public:
+  // The largest entry, counting its key and the data of all its streams, that
+  // is kept in the store. Larger entries are stored in files of their own.
+  static const int kMaxEntrySize;
+
+  struct NET_EXPORT_PRIVATE EntryData {
+    EntryData();
+    ~EntryData();
+
+    std::string key;
+    std::string stream_data[kSimpleEntryStreamCount];
+    base::Time last_modified;
+  };
+
+  using EntryCallback = base::Callback<
+      void(uint64_t entry_hash, uint32_t record_size, base::Time last_used)>;
+
+  // Compactions are run on |worker_pool|. If it is null, segments are only
+  // compacted by calls to Compact().
+  SimplePackedStore(const base::FilePath& path,
+                    const scoped_refptr<base::TaskRunner>& worker_pool);
+
+  // Reads the headers of all the records in the segment files under the
+  // cache directory. Must be called before any other method. A segment file
+  // that can't be read is deleted, along with the entries in it.
+  void Load();
+
+  bool HasEntry(uint64_t entry_hash) const;
+
+  // Reads the record for |entry_hash| into |out_data| and checks its CRC.
+  // Returns a net error code.
+  int ReadEntry(uint64_t entry_hash, EntryData* out_data) const;
+
+  // A SimpleSynchronousEntry acquires a handle on its entry while it is open.
+  // Removing the entry advances the generation of the handle, so that a
+  // doomed entry can't overwrite the record of a newer entry with the same
+  // hash when it is closed. Returns the current generation.
+  uint64_t AcquireEntry(uint64_t entry_hash);
+  void ReleaseEntry(uint64_t entry_hash);
+
+  // Returns true if |entry_hash| has not been removed since |generation| was
+  // returned by AcquireEntry().
+  bool IsCurrentGeneration(uint64_t entry_hash, uint64_t generation) const;
+
+  // Appends a record for |data|, which replaces any earlier record for
+  // |entry_hash|. Returns false, and writes nothing, if the entry was removed
+  // since |generation|. Returns false, and removes the entry, if the record
+  // can't be written.
+  bool WriteEntry(uint64_t entry_hash,
+                  uint64_t generation,
+                  const EntryData& data);
+
+  // Removes the entry, if any, and advances the generation of its handle.
+  // Returns true if there was a record for the entry.
+  bool RemoveEntry(uint64_t entry_hash);
+
+  // Runs |callback| for every entry, with the modification time of the
+  // segment holding its record as the last use time.
+  void ForEachEntry(const EntryCallback& callback) const;
+
+  // Compacts segments until none of them is mostly dead space.
+  void Compact();
+
+  int GetSegmentCountForTesting() const;
+  void set_max_segment_size_for_testing(int64_t max_segment_size) {
+    max_segment_size_ = max_segment_size;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<SimplePackedStore>;
+
+  // A segment file, and its accounting. A reader holds a reference to the
+  // segment while it reads from it, so that a concurrent compaction can
+  // remove the segment from |segments_| without closing the file under it.
+  struct Segment;
+  using SegmentMap = std::map<int32_t, scoped_refptr<Segment>>;
+
+  struct RecordLocation {
+    int32_t segment_id;
+    uint32_t size;
+    int64_t offset;
+  };
+
+  struct Handle {
+    uint64_t generation;
+    int count;
+  };
+
+  ~SimplePackedStore();
+
+  base::FilePath GetSegmentFilename(int32_t segment_id) const;
+
+  // Opens the segment file |filename| and applies all of its records to
+  // |entries_|.
+  bool LoadSegment(int32_t segment_id, const base::FilePath& filename);
+
+  // Writes |record| at the end of the current segment, starting a new segment
+  // if there is none or it is full.
+  bool AppendRecordLocked(const std::string& record,
+                          RecordLocation* out_location);
+
+  // Accounts for the record at |location| becoming dead space.
+  void ReleaseRecordLocked(const RecordLocation& location);
+
+  bool RemoveEntryLocked(uint64_t entry_hash);
+
+  // Accounts for the removal record for |entry_hash| at |location|. It is
+  // dead space unless an older segment holds a record that it removes.
+  void AddRemovalRecordLocked(uint64_t entry_hash,
+                              const RecordLocation& location);
+
+  // Returns true if a segment older than |segment_id| holds a record, live
+  // or not, for |entry_hash|.
+  bool OlderSegmentHasRecordLocked(int32_t segment_id,
+                                   uint64_t entry_hash) const;
+
+  // Deletes segment |segment_id|, and counts the removal records which were
+  // only needed for it as dead space.
+  void EraseSegmentLocked(int32_t segment_id);
+
+  // Returns the id of the oldest segment that should be compacted, or -1.
+  int32_t FindSegmentToCompactLocked() const;
+  void MaybeScheduleCompactionLocked();
+
+  // Copies the records of segment |segment_id| which are still needed to the
+  // current segment, and deletes it.
+  bool CompactSegment(int32_t segment_id);
+
+  const base::FilePath path_;
+  const scoped_refptr<base::TaskRunner> worker_pool_;
+  int64_t max_segment_size_;
+
+  mutable base::Lock lock_;
+  SegmentMap segments_;
+  // The segment new records are appended to, or -1 if none is open for
+  // appending yet. Segments which existed when the store was loaded are never
+  // appended to, in case they end with a torn record.
+  int32_t current_segment_id_;
+  int32_t next_segment_id_;
+  std::unordered_map<uint64_t, RecordLocation> entries_;
+  std::unordered_map<uint64_t, Handle> handles_;
+  uint64_t next_generation_;
+  bool compaction_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(SimplePackedStore);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_PACKED_STORE_H_
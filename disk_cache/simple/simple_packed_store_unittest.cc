@@ -0,0 +1,202 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_packed_store.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/file.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
+#include "net/base/net_errors.h"
+#include "net/test/gtest_util.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsError;
+using net::test::IsOk;
+
+namespace disk_cache {
+
+namespace {
+
+const uint64_t kHash1 = UINT64_C(0x1111);
+const uint64_t kHash2 = UINT64_C(0x2222);
+
+SimplePackedStore::EntryData MakeEntryData(const std::string& key,
+                                           const std::string& body) {
+  SimplePackedStore::EntryData data;
+  data.key = key;
+  data.stream_data[0] = "headers for " + key;
+  data.stream_data[1] = body;
+  data.last_modified = base::Time::Now();
+  return data;
+}
+
+class SimplePackedStoreTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    store_ = NewStore();
+  }
+
+  scoped_refptr<SimplePackedStore> NewStore() {
+    scoped_refptr<SimplePackedStore> store(
+        new SimplePackedStore(temp_dir_.GetPath(), nullptr));
+    store->Load();
+    return store;
+  }
+
+  bool Write(uint64_t entry_hash, const SimplePackedStore::EntryData& data) {
+    uint64_t generation = store_->AcquireEntry(entry_hash);
+    bool result = store_->WriteEntry(entry_hash, generation, data);
+    store_->ReleaseEntry(entry_hash);
+    return result;
+  }
+
+  void ExpectEntry(uint64_t entry_hash,
+                   const SimplePackedStore::EntryData& expected) {
+    SimplePackedStore::EntryData data;
+    ASSERT_THAT(store_->ReadEntry(entry_hash, &data), IsOk());
+    EXPECT_EQ(expected.key, data.key);
+    for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+      EXPECT_EQ(expected.stream_data[i], data.stream_data[i]);
+    EXPECT_EQ(expected.last_modified, data.last_modified);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  scoped_refptr<SimplePackedStore> store_;
+};
+
+TEST_F(SimplePackedStoreTest, WriteAndRead) {
+  const SimplePackedStore::EntryData data1 = MakeEntryData("key1", "body1");
+  const SimplePackedStore::EntryData data2 = MakeEntryData("key2", "");
+  EXPECT_FALSE(store_->HasEntry(kHash1));
+  ASSERT_TRUE(Write(kHash1, data1));
+  ASSERT_TRUE(Write(kHash2, data2));
+  EXPECT_TRUE(store_->HasEntry(kHash1));
+  ExpectEntry(kHash1, data1);
+  ExpectEntry(kHash2, data2);
+
+  // A later record replaces the earlier one.
+  const SimplePackedStore::EntryData data3 = MakeEntryData("key1", "body3");
+  ASSERT_TRUE(Write(kHash1, data3));
+  ExpectEntry(kHash1, data3);
+}
+
+TEST_F(SimplePackedStoreTest, Persistence) {
+  const SimplePackedStore::EntryData data1 = MakeEntryData("key1", "body1");
+  const SimplePackedStore::EntryData data2 = MakeEntryData("key2", "body2");
+  ASSERT_TRUE(Write(kHash1, data1));
+  ASSERT_TRUE(Write(kHash2, data2));
+  ASSERT_TRUE(store_->RemoveEntry(kHash2));
+  EXPECT_FALSE(store_->HasEntry(kHash2));
+
+  store_ = NewStore();
+  ExpectEntry(kHash1, data1);
+  EXPECT_FALSE(store_->HasEntry(kHash2));
+  EXPECT_THAT(store_->ReadEntry(kHash2, nullptr), IsError(net::ERR_FAILED));
+}
+
+// A doomed entry must not write over a newer entry with the same hash.
+TEST_F(SimplePackedStoreTest, RemoveAdvancesGeneration) {
+  const SimplePackedStore::EntryData data1 = MakeEntryData("key1", "old");
+  uint64_t old_generation = store_->AcquireEntry(kHash1);
+  ASSERT_TRUE(store_->WriteEntry(kHash1, old_generation, data1));
+  ASSERT_TRUE(store_->RemoveEntry(kHash1));
+  EXPECT_FALSE(store_->IsCurrentGeneration(kHash1, old_generation));
+
+  const SimplePackedStore::EntryData data2 = MakeEntryData("key1", "new");
+  ASSERT_TRUE(Write(kHash1, data2));
+  EXPECT_FALSE(store_->WriteEntry(kHash1, old_generation, data1));
+  store_->ReleaseEntry(kHash1);
+  ExpectEntry(kHash1, data2);
+}
+
+TEST_F(SimplePackedStoreTest, Compaction) {
+  store_->set_max_segment_size_for_testing(1024);
+  const SimplePackedStore::EntryData live = MakeEntryData("live", "kept");
+  ASSERT_TRUE(Write(kHash1, live));
+  SimplePackedStore::EntryData data =
+      MakeEntryData("key2", std::string(200, 'x'));
+  for (int i = 0; i < 20; ++i) {
+    data.stream_data[2] = std::string(i, 'y');
+    ASSERT_TRUE(Write(kHash2, data));
+  }
+  ASSERT_TRUE(store_->RemoveEntry(kHash2));
+  const int segment_count = store_->GetSegmentCountForTesting();
+  EXPECT_LT(3, segment_count);
+
+  store_->Compact();
+  EXPECT_GT(segment_count, store_->GetSegmentCountForTesting());
+  ExpectEntry(kHash1, live);
+  EXPECT_FALSE(store_->HasEntry(kHash2));
+
+  store_ = NewStore();
+  ExpectEntry(kHash1, live);
+  EXPECT_FALSE(store_->HasEntry(kHash2));
+}
+
+// Removal records are dropped once no older segment holds a record they
+// remove, so compacting segments full of them terminates.
+TEST_F(SimplePackedStoreTest, CompactionDropsRemovalRecords) {
+  store_->set_max_segment_size_for_testing(1024);
+  const SimplePackedStore::EntryData live = MakeEntryData("live", "kept");
+  ASSERT_TRUE(Write(kHash1, live));
+
+  const int kEntryCount = 200;
+  const SimplePackedStore::EntryData data =
+      MakeEntryData("key", std::string(100, 'x'));
+  for (int i = 0; i < kEntryCount; ++i)
+    ASSERT_TRUE(Write(kHash2 + i, data));
+  for (int i = 0; i < kEntryCount; ++i)
+    ASSERT_TRUE(store_->RemoveEntry(kHash2 + i));
+  const int segment_count = store_->GetSegmentCountForTesting();
+
+  store_->Compact();
+  EXPECT_GT(segment_count / 4, store_->GetSegmentCountForTesting());
+  ExpectEntry(kHash1, live);
+
+  // Nothing is left to compact.
+  const int compacted_segment_count = store_->GetSegmentCountForTesting();
+  store_->Compact();
+  EXPECT_EQ(compacted_segment_count, store_->GetSegmentCountForTesting());
+
+  store_ = NewStore();
+  ExpectEntry(kHash1, live);
+  for (int i = 0; i < kEntryCount; ++i)
+    EXPECT_FALSE(store_->HasEntry(kHash2 + i));
+}
+
+// A record cut short by a crash is ignored, along with anything after it.
+TEST_F(SimplePackedStoreTest, TornRecord) {
+  const SimplePackedStore::EntryData data1 = MakeEntryData("key1", "body1");
+  const SimplePackedStore::EntryData data2 = MakeEntryData("key2", "body2");
+  ASSERT_TRUE(Write(kHash1, data1));
+  ASSERT_TRUE(Write(kHash2, data2));
+  store_ = nullptr;
+
+  base::File segment(temp_dir_.GetPath().AppendASCII("packed_0"),
+                     base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+  ASSERT_TRUE(segment.IsValid());
+  ASSERT_TRUE(segment.SetLength(segment.GetLength() - 3));
+  segment.Close();
+
+  store_ = NewStore();
+  ExpectEntry(kHash1, data1);
+  EXPECT_FALSE(store_->HasEntry(kHash2));
+
+  // New records go to a new segment, rather than after the torn one.
+  ASSERT_TRUE(Write(kHash2, data2));
+  store_ = NewStore();
+  ExpectEntry(kHash1, data1);
+  ExpectEntry(kHash2, data2);
+}
+
+}  // namespace
+
+}  // namespace disk_cache
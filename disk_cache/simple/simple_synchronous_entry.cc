@@ -10,6 +10,7 @@
 #include <limits>
 
 #include "base/compiler_specific.h"
+#include "base/feature_list.h"
 #include "base/files/file_util.h"
 #include "base/hash.h"
 #include "base/location.h"
@@ -22,6 +23,7 @@
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/simple/simple_backend_version.h"
+#include "net/disk_cache/simple/simple_experiment.h"
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "third_party/zlib/zlib.h"
@@ -255,21 +257,24 @@ SimpleSynchronousEntry::EntryOperationData::EntryOperationData(
 void SimpleSynchronousEntry::OpenEntry(
     net::CacheType cache_type,
     const FilePath& path,
+    SimplePackedStore* packed_store,
+    SimpleIOEngine* io_engine,
     const std::string& key,
     const uint64_t entry_hash,
     const bool had_index,
     SimpleEntryCreationResults* out_results) {
   base::ElapsedTimer open_time;
-  SimpleSynchronousEntry* sync_entry =
-      new SimpleSynchronousEntry(cache_type, path, key, entry_hash, had_index);
+  SimpleSynchronousEntry* sync_entry = new SimpleSynchronousEntry(
+      cache_type, path, packed_store, io_engine, key, entry_hash, had_index);
   out_results->result = sync_entry->InitializeForOpen(
       &out_results->entry_stat, &out_results->stream_0_data,
-      &out_results->stream_0_crc32);
+      &out_results->stream_0_crc32, &out_results->stream_1_data);
   if (out_results->result != net::OK) {
     sync_entry->Doom();
     delete sync_entry;
     out_results->sync_entry = NULL;
     out_results->stream_0_data = NULL;
+    out_results->stream_1_data = NULL;
     return;
   }
   UMA_HISTOGRAM_TIMES("SimpleCache.DiskOpenLatency", open_time.Elapsed());
@@ -280,13 +285,15 @@ void SimpleSynchronousEntry::OpenEntry(
 void SimpleSynchronousEntry::CreateEntry(
     net::CacheType cache_type,
     const FilePath& path,
+    SimplePackedStore* packed_store,
+    SimpleIOEngine* io_engine,
     const std::string& key,
     const uint64_t entry_hash,
     const bool had_index,
     SimpleEntryCreationResults* out_results) {
   DCHECK_EQ(entry_hash, GetEntryHashKey(key));
-  SimpleSynchronousEntry* sync_entry =
-      new SimpleSynchronousEntry(cache_type, path, key, entry_hash, had_index);
+  SimpleSynchronousEntry* sync_entry = new SimpleSynchronousEntry(
+      cache_type, path, packed_store, io_engine, key, entry_hash, had_index);
   out_results->result =
       sync_entry->InitializeForCreate(&out_results->entry_stat);
   if (out_results->result != net::OK) {
@@ -301,26 +308,37 @@ void SimpleSynchronousEntry::CreateEntry(
 
 // static
 int SimpleSynchronousEntry::DoomEntry(const FilePath& path,
+                                      SimplePackedStore* packed_store,
                                       uint64_t entry_hash) {
+  const bool removed_packed =
+      packed_store && packed_store->RemoveEntry(entry_hash);
   const bool deleted_well = DeleteFilesForEntryHash(path, entry_hash);
-  return deleted_well ? net::OK : net::ERR_FAILED;
+  return (removed_packed || deleted_well) ? net::OK : net::ERR_FAILED;
 }
 
 // static
 int SimpleSynchronousEntry::TruncateEntryFiles(const base::FilePath& path,
+                                               SimplePackedStore* packed_store,
                                                uint64_t entry_hash) {
+  const bool removed_packed =
+      packed_store && packed_store->RemoveEntry(entry_hash);
   const bool deleted_well = TruncateFilesForEntryHash(path, entry_hash);
-  return deleted_well ? net::OK : net::ERR_FAILED;
+  return (removed_packed || deleted_well) ? net::OK : net::ERR_FAILED;
 }
 
 // static
 int SimpleSynchronousEntry::DoomEntrySet(
     const std::vector<uint64_t>* key_hashes,
-    const FilePath& path) {
+    const FilePath& path,
+    SimplePackedStore* packed_store) {
   const size_t did_delete_count = std::count_if(
       key_hashes->begin(), key_hashes->end(),
-      [&path](const uint64_t& key_hash) {
-        return SimpleSynchronousEntry::DeleteFilesForEntryHash(path, key_hash);
+      [&path, packed_store](const uint64_t& key_hash) {
+        const bool removed_packed =
+            packed_store && packed_store->RemoveEntry(key_hash);
+        const bool deleted_well =
+            SimpleSynchronousEntry::DeleteFilesForEntryHash(path, key_hash);
+        return removed_packed || deleted_well;
       });
   return (did_delete_count == key_hashes->size()) ? net::OK : net::ERR_FAILED;
 }
@@ -332,6 +350,22 @@ void SimpleSynchronousEntry::ReadData(const EntryOperationData& in_entry_op,
                                       int* out_result) {
   DCHECK(initialized_);
   DCHECK_NE(0, in_entry_op.index);
+  if (packed_) {
+    const std::string& data = packed_data_.stream_data[in_entry_op.index];
+    int bytes_read = std::max(
+        0, std::min(in_entry_op.buf_len,
+                    static_cast<int>(data.size()) - in_entry_op.offset));
+    if (bytes_read > 0) {
+      std::memcpy(out_buf->data(), data.data() + in_entry_op.offset,
+                  bytes_read);
+      entry_stat->set_last_used(Time::Now());
+      *out_crc32 = crc32(crc32(0L, Z_NULL, 0),
+                         reinterpret_cast<const Bytef*>(out_buf->data()),
+                         bytes_read);
+    }
+    *out_result = bytes_read;
+    return;
+  }
   int file_index = GetFileIndexFromStreamIndex(in_entry_op.index);
   if (header_and_key_check_needed_[file_index] &&
       !CheckHeaderAndKey(file_index)) {
@@ -345,8 +379,8 @@ void SimpleSynchronousEntry::ReadData(const EntryOperationData& in_entry_op,
   // be handled in the SimpleEntryImpl.
   DCHECK_GT(in_entry_op.buf_len, 0);
   DCHECK(!empty_file_omitted_[file_index]);
-  int bytes_read = files_[file_index].Read(file_offset, out_buf->data(),
-                                           in_entry_op.buf_len);
+  int bytes_read =
+      ReadFile(file_index, file_offset, out_buf->data(), in_entry_op.buf_len);
   if (bytes_read > 0) {
     entry_stat->set_last_used(Time::Now());
     *out_crc32 = crc32(crc32(0L, Z_NULL, 0),
@@ -368,6 +402,48 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
   DCHECK(initialized_);
   DCHECK_NE(0, in_entry_op.index);
   int index = in_entry_op.index;
+  if (packed_) {
+    int offset = in_entry_op.offset;
+    int buf_len = in_entry_op.buf_len;
+    SimpleEntryStat new_entry_stat = *out_entry_stat;
+    new_entry_stat.set_data_size(
+        index, in_entry_op.truncate
+                   ? offset + buf_len
+                   : std::max(out_entry_stat->data_size(index),
+                              offset + buf_len));
+    if (FitsInPackedStore(new_entry_stat)) {
+      std::string* data = &packed_data_.stream_data[index];
+      if (data->size() < static_cast<size_t>(offset))
+        data->resize(offset);
+      if (buf_len > 0)
+        data->replace(offset, buf_len, in_buf->data(), buf_len);
+      if (in_entry_op.truncate)
+        data->resize(offset + buf_len);
+      DCHECK_EQ(new_entry_stat.data_size(index),
+                static_cast<int32_t>(data->size()));
+
+      RecordWriteResult(cache_type_, WRITE_RESULT_SUCCESS);
+      base::Time modification_time = Time::Now();
+      out_entry_stat->set_data_size(index, new_entry_stat.data_size(index));
+      out_entry_stat->set_last_used(modification_time);
+      out_entry_stat->set_last_modified(modification_time);
+      *out_result = buf_len;
+      return;
+    }
+    // The entry outgrew the packed store, and needs files of its own. As with
+    // lazily created files below, don't create them for a doomed entry.
+    if (in_entry_op.doomed) {
+      RecordWriteResult(cache_type_, WRITE_RESULT_LAZY_STREAM_ENTRY_DOOMED);
+      *out_result = net::ERR_CACHE_WRITE_FAILURE;
+      return;
+    }
+    if (!SpillPackedEntry()) {
+      RecordWriteResult(cache_type_, WRITE_RESULT_LAZY_CREATE_FAILURE);
+      Doom();
+      *out_result = net::ERR_CACHE_WRITE_FAILURE;
+      return;
+    }
+  }
   int file_index = GetFileIndexFromStreamIndex(index);
   if (header_and_key_check_needed_[file_index] &&
       !empty_file_omitted_[file_index] && !CheckHeaderAndKey(file_index)) {
@@ -422,7 +498,7 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
     }
   }
   if (buf_len > 0) {
-    if (files_[file_index].Write(file_offset, in_buf->data(), buf_len) !=
+    if (WriteFile(file_index, file_offset, in_buf->data(), buf_len) !=
         buf_len) {
       RecordWriteResult(cache_type_, WRITE_RESULT_WRITE_FAILURE);
       Doom();
@@ -527,6 +603,13 @@ void SimpleSynchronousEntry::WriteSparseData(
   int written_so_far = 0;
   int appended_so_far = 0;
 
+  // Sparse data is only kept in files.
+  if (packed_ && !SpillPackedEntry()) {
+    Doom();
+    *out_result = net::ERR_CACHE_WRITE_FAILURE;
+    return;
+  }
+
   if (!sparse_file_open() && !CreateSparseFile()) {
     *out_result = net::ERR_CACHE_WRITE_FAILURE;
     return;
@@ -662,6 +745,22 @@ void SimpleSynchronousEntry::CheckEOFRecord(int index,
                                             uint32_t expected_crc32,
                                             int* out_result) const {
   DCHECK(initialized_);
+  if (packed_) {
+    // The CRC of the whole record was checked when it was read, so this only
+    // catches a mismatch with the CRC the SimpleEntryImpl computed.
+    const std::string& data = packed_data_.stream_data[index];
+    if (crc32(crc32(0L, Z_NULL, 0),
+              reinterpret_cast<const Bytef*>(data.data()),
+              data.size()) != expected_crc32) {
+      *out_result = net::ERR_CACHE_CHECKSUM_MISMATCH;
+      RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_CRC_MISMATCH);
+      Doom();
+      return;
+    }
+    *out_result = net::OK;
+    RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_SUCCESS);
+    return;
+  }
   uint32_t crc32;
   bool has_crc32;
   bool has_key_sha256;
@@ -688,63 +787,38 @@ void SimpleSynchronousEntry::Close(
     net::GrowableIOBuffer* stream_0_data) {
   DCHECK(stream_0_data);
 
-  for (std::vector<CRCRecord>::const_iterator it = crc32s_to_write->begin();
-       it != crc32s_to_write->end(); ++it) {
-    const int stream_index = it->index;
-    const int file_index = GetFileIndexFromStreamIndex(stream_index);
-    if (empty_file_omitted_[file_index])
-      continue;
-
-    if (stream_index == 0) {
-      // Write stream 0 data.
-      int stream_0_offset = entry_stat.GetOffsetInFile(key_.size(), 0, 0);
-      if (files_[0].Write(stream_0_offset, stream_0_data->data(),
-                          entry_stat.data_size(0)) != entry_stat.data_size(0)) {
-        RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-        DVLOG(1) << "Could not write stream 0 data.";
-        Doom();
-      }
-      net::SHA256HashValue hash_value;
-      CalculateSHA256OfKey(key_, &hash_value);
-      if (files_[0].Write(stream_0_offset + entry_stat.data_size(0),
-                          reinterpret_cast<char*>(hash_value.data),
-                          sizeof(hash_value)) != sizeof(hash_value)) {
-        RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-        DVLOG(1) << "Could not write stream 0 data.";
-        Doom();
+  if (packed_) {
+    if (FitsInPackedStore(entry_stat)) {
+      if (!crc32s_to_write->empty()) {
+        packed_data_.stream_data[0].assign(stream_0_data->data(),
+                                           entry_stat.data_size(0));
+        packed_data_.last_modified = entry_stat.last_modified();
+        if (!packed_store_->WriteEntry(entry_hash_, packed_generation_,
+                                       packed_data_)) {
+          DVLOG(1) << "Could not write packed record.";
+        }
       }
+      RecordCloseResult(cache_type_, CLOSE_RESULT_SUCCESS);
+      delete this;
+      return;
     }
-
-    SimpleFileEOF eof_record;
-    eof_record.stream_size = entry_stat.data_size(stream_index);
-    eof_record.final_magic_number = kSimpleFinalMagicNumber;
-    eof_record.flags = 0;
-    if (it->has_crc32)
-      eof_record.flags |= SimpleFileEOF::FLAG_HAS_CRC32;
-    if (stream_index == 0)
-      eof_record.flags |= SimpleFileEOF::FLAG_HAS_KEY_SHA256;
-    eof_record.data_crc32 = it->data_crc32;
-    int eof_offset = entry_stat.GetEOFOffsetInFile(key_.size(), stream_index);
-    // If stream 0 changed size, the file needs to be resized, otherwise the
-    // next open will yield wrong stream sizes. On stream 1 and stream 2 proper
-    // resizing of the file is handled in SimpleSynchronousEntry::WriteData().
-    if (stream_index == 0 &&
-        !files_[file_index].SetLength(eof_offset)) {
-      RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-      DVLOG(1) << "Could not truncate stream 0 file.";
-      Doom();
-      break;
-    }
-    if (files_[file_index].Write(eof_offset,
-                                 reinterpret_cast<const char*>(&eof_record),
-                                 sizeof(eof_record)) !=
-        sizeof(eof_record)) {
+    // Stream 0 grew too large for the packed store.
+    if (!SpillPackedEntry()) {
       RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-      DVLOG(1) << "Could not write eof record.";
       Doom();
-      break;
+      if (have_open_files_) {
+        CloseFiles();
+        have_open_files_ = false;
+      }
+      delete this;
+      return;
     }
   }
+
+  if (!WriteEOFRecords(entry_stat, *crc32s_to_write, stream_0_data->data())) {
+    RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
+    Doom();
+  }
   for (int i = 0; i < kSimpleEntryFileCount; ++i) {
     if (empty_file_omitted_[i])
       continue;
@@ -777,18 +851,27 @@ void SimpleSynchronousEntry::Close(
   delete this;
 }
 
-SimpleSynchronousEntry::SimpleSynchronousEntry(net::CacheType cache_type,
-                                               const FilePath& path,
-                                               const std::string& key,
-                                               const uint64_t entry_hash,
-                                               const bool had_index)
+SimpleSynchronousEntry::SimpleSynchronousEntry(
+    net::CacheType cache_type,
+    const FilePath& path,
+    SimplePackedStore* packed_store,
+    SimpleIOEngine* io_engine,
+    const std::string& key,
+    const uint64_t entry_hash,
+    const bool had_index)
     : cache_type_(cache_type),
       path_(path),
       entry_hash_(entry_hash),
       had_index_(had_index),
       key_(key),
       have_open_files_(false),
-      initialized_(false) {
+      initialized_(false),
+      files_created_(false),
+      packed_store_(packed_store),
+      io_engine_(io_engine),
+      file_0_prefetch_offset_(0),
+      packed_(false),
+      packed_generation_(0) {
   for (int i = 0; i < kSimpleEntryFileCount; ++i)
     empty_file_omitted_[i] = false;
 }
@@ -797,6 +880,8 @@ SimpleSynchronousEntry::~SimpleSynchronousEntry() {
   DCHECK(!(have_open_files_ && initialized_));
   if (have_open_files_)
     CloseFiles();
+  if (packed_)
+    packed_store_->ReleaseEntry(entry_hash_);
 }
 
 bool SimpleSynchronousEntry::MaybeOpenFile(
@@ -987,7 +1072,7 @@ bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
   std::vector<char> header_data(key_.empty() ? kInitialHeaderRead
                                              : GetHeaderSize(key_.size()));
   int bytes_read =
-      files_[file_index].Read(0, header_data.data(), header_data.size());
+      ReadFile(file_index, 0, header_data.data(), header_data.size());
   const SimpleFileHeader* header =
       reinterpret_cast<const SimpleFileHeader*>(header_data.data());
 
@@ -1016,8 +1101,8 @@ bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
     int bytes_to_read = expected_header_size - old_size;
     // This resize will invalidate iterators, since it is enlarging header_data.
     header_data.resize(expected_header_size);
-    int bytes_read = files_[file_index].Read(
-        old_size, header_data.data() + old_size, bytes_to_read);
+    int bytes_read = ReadFile(file_index, old_size,
+                              header_data.data() + old_size, bytes_to_read);
     if (bytes_read != bytes_to_read) {
       RecordSyncOpenResult(cache_type_, OPEN_ENTRY_CANT_READ_KEY, had_index_);
       return false;
@@ -1048,12 +1133,22 @@ bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
 int SimpleSynchronousEntry::InitializeForOpen(
     SimpleEntryStat* out_entry_stat,
     scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
-    uint32_t* out_stream_0_crc32) {
+    uint32_t* out_stream_0_crc32,
+    scoped_refptr<net::GrowableIOBuffer>* stream_1_data) {
   DCHECK(!initialized_);
+  if (packed_store_ && packed_store_->HasEntry(entry_hash_)) {
+    return InitializeForOpenPacked(out_entry_stat, stream_0_data,
+                                   out_stream_0_crc32);
+  }
   if (!OpenFiles(out_entry_stat)) {
     DLOG(WARNING) << "Could not open platform files for entry.";
     return net::ERR_FAILED;
   }
+  const bool speculative_read =
+      base::FeatureList::IsEnabled(kSimpleSpeculativeOpen);
+  // File size for stream 0 has been stored temporarily in data_size[1].
+  if (speculative_read)
+    PrefetchFile0(out_entry_stat->data_size(1));
   for (int i = 0; i < kSimpleEntryFileCount; ++i) {
     if (empty_file_omitted_[i])
       continue;
@@ -1083,6 +1178,15 @@ int SimpleSynchronousEntry::InitializeForOpen(
     }
   }
 
+  if (speculative_read) {
+    int ret_value_stream_1 =
+        ReadPrefetchedStream1(*out_entry_stat, stream_1_data);
+    // Later reads and writes go to the file.
+    std::vector<char>().swap(file_0_prefetch_);
+    if (ret_value_stream_1 != net::OK)
+      return ret_value_stream_1;
+  }
+
   int32_t sparse_data_size = 0;
   if (!OpenSparseFileIfExists(&sparse_data_size)) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_SPARSE_OPEN_FAILED,
@@ -1141,6 +1245,8 @@ bool SimpleSynchronousEntry::InitializeCreatedFile(
 int SimpleSynchronousEntry::InitializeForCreate(
     SimpleEntryStat* out_entry_stat) {
   DCHECK(!initialized_);
+  if (packed_store_)
+    return InitializeForCreatePacked(out_entry_stat);
   if (!CreateFiles(out_entry_stat)) {
     DLOG(WARNING) << "Could not create platform files.";
     return net::ERR_FILE_EXISTS;
@@ -1160,6 +1266,253 @@ int SimpleSynchronousEntry::InitializeForCreate(
   return net::OK;
 }
 
+void SimpleSynchronousEntry::PrefetchFile0(int64_t file_size) {
+  const int read_size =
+      static_cast<int>(std::min<int64_t>(file_size, kSpeculativeReadSize));
+  if (read_size <= 0)
+    return;
+  const int64_t offset = file_size - read_size;
+  std::vector<char> prefetch(read_size);
+  if (ReadFile(0, offset, prefetch.data(), read_size) != read_size)
+    return;
+  file_0_prefetch_.swap(prefetch);
+  file_0_prefetch_offset_ = offset;
+}
+
+int SimpleSynchronousEntry::ReadPrefetchedStream1(
+    const SimpleEntryStat& entry_stat,
+    scoped_refptr<net::GrowableIOBuffer>* stream_1_data) {
+  if (file_0_prefetch_.empty() || file_0_prefetch_offset_ != 0 ||
+      entry_stat.data_size(1) == 0) {
+    return net::OK;
+  }
+  // Stream 1 is read without going through ReadData(), which would check the
+  // header and key first.
+  if (header_and_key_check_needed_[0] && !CheckHeaderAndKey(0))
+    return net::ERR_FAILED;
+
+  bool has_crc32;
+  bool has_key_sha256;
+  uint32_t read_crc32;
+  int32_t stream_1_size;
+  int ret_value_crc32 =
+      GetEOFRecordData(1, entry_stat, &has_crc32, &has_key_sha256, &read_crc32,
+                       &stream_1_size);
+  if (ret_value_crc32 != net::OK)
+    return ret_value_crc32;
+  if (stream_1_size != entry_stat.data_size(1))
+    return net::ERR_FAILED;
+
+  const char* data = file_0_prefetch_.data() +
+                     entry_stat.GetOffsetInFile(key_.size(), 0, 1);
+  uint32_t expected_crc32 = crc32(
+      crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), stream_1_size);
+  if (has_crc32 && read_crc32 != expected_crc32) {
+    DVLOG(1) << "EOF record had bad crc.";
+    RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_CRC_MISMATCH);
+    return net::ERR_FAILED;
+  }
+  RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_SUCCESS);
+
+  *stream_1_data = new net::GrowableIOBuffer();
+  (*stream_1_data)->SetCapacity(stream_1_size);
+  std::memcpy((*stream_1_data)->data(), data, stream_1_size);
+  return net::OK;
+}
+
+int SimpleSynchronousEntry::InitializeForOpenPacked(
+    SimpleEntryStat* out_entry_stat,
+    scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
+    uint32_t* out_stream_0_crc32) {
+  packed_generation_ = packed_store_->AcquireEntry(entry_hash_);
+  packed_ = true;
+  int rv = packed_store_->ReadEntry(entry_hash_, &packed_data_);
+  if (rv != net::OK)
+    return rv;
+  if (!key_.empty() && key_ != packed_data_.key) {
+    RecordSyncOpenResult(cache_type_, OPEN_ENTRY_KEY_MISMATCH, had_index_);
+    return net::ERR_FAILED;
+  }
+  key_ = packed_data_.key;
+
+  // The store doesn't track accesses, so the entry counts as last used when
+  // it was last modified.
+  out_entry_stat->set_last_used(packed_data_.last_modified);
+  out_entry_stat->set_last_modified(packed_data_.last_modified);
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i) {
+    out_entry_stat->set_data_size(
+        i, static_cast<int32_t>(packed_data_.stream_data[i].size()));
+  }
+  out_entry_stat->set_sparse_data_size(0);
+
+  // The CRC of the record covers stream 0, so it needs no further checks.
+  const std::string& stream_0 = packed_data_.stream_data[0];
+  *stream_0_data = new net::GrowableIOBuffer();
+  (*stream_0_data)->SetCapacity(stream_0.size());
+  std::memcpy((*stream_0_data)->data(), stream_0.data(), stream_0.size());
+  *out_stream_0_crc32 =
+      crc32(crc32(0, Z_NULL, 0),
+            reinterpret_cast<const Bytef*>(stream_0.data()), stream_0.size());
+
+  RecordSyncOpenResult(cache_type_, OPEN_ENTRY_SUCCESS, had_index_);
+  initialized_ = true;
+  return net::OK;
+}
+
+int SimpleSynchronousEntry::InitializeForCreatePacked(
+    SimpleEntryStat* out_entry_stat) {
+  // An entry that was spilled to files of its own still exists.
+  if (packed_store_->HasEntry(entry_hash_) ||
+      base::PathExists(GetFilenameFromFileIndex(0))) {
+    return net::ERR_FILE_EXISTS;
+  }
+  packed_generation_ = packed_store_->AcquireEntry(entry_hash_);
+  packed_ = true;
+  packed_data_.key = key_;
+
+  base::Time creation_time = Time::Now();
+  out_entry_stat->set_last_modified(creation_time);
+  out_entry_stat->set_last_used(creation_time);
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+    out_entry_stat->set_data_size(i, 0);
+
+  RecordSyncCreateResult(CREATE_ENTRY_SUCCESS, had_index_);
+  initialized_ = true;
+  return net::OK;
+}
+
+bool SimpleSynchronousEntry::FitsInPackedStore(
+    const SimpleEntryStat& entry_stat) const {
+  int64_t size = key_.size();
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+    size += entry_stat.data_size(i);
+  return size <= SimplePackedStore::kMaxEntrySize;
+}
+
+bool SimpleSynchronousEntry::SpillPackedEntry() {
+  DCHECK(packed_);
+  // Don't create files for a doomed entry, to avoid it being mixed up with a
+  // newly-created entry with the same key.
+  if (!packed_store_->IsCurrentGeneration(entry_hash_, packed_generation_))
+    return false;
+  packed_store_->RemoveEntry(entry_hash_);
+  packed_store_->ReleaseEntry(entry_hash_);
+  packed_ = false;
+
+  // Stream 0 may since have changed in the SimpleEntryImpl; if so, it is
+  // rewritten on Close().
+  int32_t data_size[kSimpleEntryStreamCount];
+  std::vector<CRCRecord> crc32s_to_write;
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i) {
+    const std::string& data = packed_data_.stream_data[i];
+    data_size[i] = static_cast<int32_t>(data.size());
+    crc32s_to_write.push_back(CRCRecord(
+        i, true, crc32(crc32(0, Z_NULL, 0),
+                       reinterpret_cast<const Bytef*>(data.data()),
+                       data.size())));
+  }
+  base::Time now = Time::Now();
+  SimpleEntryStat entry_stat(now, now, data_size, 0);
+
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    const int stream_index = i == 0 ? 1 : 2;
+    File::Error error;
+    if (!MaybeCreateFile(
+            i, data_size[stream_index] == 0 ? FILE_NOT_REQUIRED : FILE_REQUIRED,
+            &error)) {
+      while (--i >= 0)
+        CloseFile(i);
+      return false;
+    }
+  }
+  have_open_files_ = true;
+  files_created_ = true;
+
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    if (empty_file_omitted_[i])
+      continue;
+    CreateEntryResult result;
+    if (!InitializeCreatedFile(i, &result))
+      return false;
+  }
+  for (int i = 1; i < kSimpleEntryStreamCount; ++i) {
+    const int file_index = GetFileIndexFromStreamIndex(i);
+    if (data_size[i] == 0)
+      continue;
+    if (files_[file_index].Write(entry_stat.GetOffsetInFile(key_.size(), 0, i),
+                                 packed_data_.stream_data[i].data(),
+                                 data_size[i]) != data_size[i]) {
+      return false;
+    }
+  }
+  return WriteEOFRecords(entry_stat, crc32s_to_write,
+                         packed_data_.stream_data[0].data());
+}
+
+bool SimpleSynchronousEntry::WriteEOFRecords(
+    const SimpleEntryStat& entry_stat,
+    const std::vector<CRCRecord>& crc32s_to_write,
+    const char* stream_0_data) {
+  typedef SimpleIOEngine::Operation Operation;
+  // The buffers of |operations| must outlive the call to RunFileOperations().
+  net::SHA256HashValue hash_value;
+  std::vector<SimpleFileEOF> eof_records;
+  eof_records.reserve(crc32s_to_write.size());
+  std::vector<Operation> operations;
+  for (std::vector<CRCRecord>::const_iterator it = crc32s_to_write.begin();
+       it != crc32s_to_write.end(); ++it) {
+    const int stream_index = it->index;
+    const int file_index = GetFileIndexFromStreamIndex(stream_index);
+    if (empty_file_omitted_[file_index])
+      continue;
+
+    int eof_offset = entry_stat.GetEOFOffsetInFile(key_.size(), stream_index);
+    if (stream_index == 0) {
+      // If stream 0 changed size, the file needs to be resized, otherwise the
+      // next open will yield wrong stream sizes. On stream 1 and stream 2
+      // proper resizing of the file is handled in
+      // SimpleSynchronousEntry::WriteData().
+      if (!files_[file_index].SetLength(eof_offset)) {
+        DVLOG(1) << "Could not truncate stream 0 file.";
+        return false;
+      }
+      // Write stream 0 data.
+      int stream_0_offset = entry_stat.GetOffsetInFile(key_.size(), 0, 0);
+      operations.push_back(Operation::Write(&files_[0], stream_0_offset,
+                                            stream_0_data,
+                                            entry_stat.data_size(0)));
+      CalculateSHA256OfKey(key_, &hash_value);
+      operations.push_back(Operation::Write(
+          &files_[0], stream_0_offset + entry_stat.data_size(0),
+          reinterpret_cast<char*>(hash_value.data), sizeof(hash_value)));
+    }
+
+    SimpleFileEOF eof_record;
+    eof_record.stream_size = entry_stat.data_size(stream_index);
+    eof_record.final_magic_number = kSimpleFinalMagicNumber;
+    eof_record.flags = 0;
+    if (it->has_crc32)
+      eof_record.flags |= SimpleFileEOF::FLAG_HAS_CRC32;
+    if (stream_index == 0)
+      eof_record.flags |= SimpleFileEOF::FLAG_HAS_KEY_SHA256;
+    eof_record.data_crc32 = it->data_crc32;
+    eof_records.push_back(eof_record);
+    operations.push_back(Operation::Write(
+        &files_[file_index], eof_offset,
+        reinterpret_cast<const char*>(&eof_records.back()),
+        sizeof(eof_record)));
+  }
+
+  RunFileOperations(&operations);
+  for (const Operation& operation : operations) {
+    if (operation.result != operation.size) {
+      DVLOG(1) << "Could not write stream 0 data or eof record.";
+      return false;
+    }
+  }
+  return true;
+}
+
 int SimpleSynchronousEntry::ReadAndValidateStream0(
     int file_size,
     SimpleEntryStat* out_entry_stat,
@@ -1199,7 +1552,7 @@ int SimpleSynchronousEntry::ReadAndValidateStream0(
   int read_size = stream_0_size;
   if (has_key_sha256)
     read_size += sizeof(net::SHA256HashValue);
-  if (files_[0].Read(file_offset, (*stream_0_data)->data(), read_size) !=
+  if (ReadFile(0, file_offset, (*stream_0_data)->data(), read_size) !=
       read_size)
     return net::ERR_FAILED;
 
@@ -1250,10 +1603,8 @@ int SimpleSynchronousEntry::GetEOFRecordData(int index,
   SimpleFileEOF eof_record;
   int file_offset = entry_stat.GetEOFOffsetInFile(key_.size(), index);
   int file_index = GetFileIndexFromStreamIndex(index);
-  File* file = const_cast<File*>(&files_[file_index]);
-  if (file->Read(file_offset, reinterpret_cast<char*>(&eof_record),
-                 sizeof(eof_record)) !=
-      sizeof(eof_record)) {
+  if (ReadFile(file_index, file_offset, reinterpret_cast<char*>(&eof_record),
+               sizeof(eof_record)) != sizeof(eof_record)) {
     RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_READ_FAILURE);
     return net::ERR_CACHE_CHECKSUM_READ_FAILURE;
   }
@@ -1278,7 +1629,61 @@ int SimpleSynchronousEntry::GetEOFRecordData(int index,
   return net::OK;
 }
 
+int SimpleSynchronousEntry::ReadFile(int file_index,
+                                     int64_t offset,
+                                     char* data,
+                                     int size) const {
+  if (file_index == 0 && !file_0_prefetch_.empty() &&
+      offset >= file_0_prefetch_offset_) {
+    // The prefetched data runs to the end of the file.
+    const int64_t available = std::max<int64_t>(
+        0, file_0_prefetch_offset_ +
+               static_cast<int64_t>(file_0_prefetch_.size()) - offset);
+    const int bytes_read = static_cast<int>(std::min<int64_t>(size, available));
+    if (bytes_read > 0) {
+      std::memcpy(data,
+                  file_0_prefetch_.data() + (offset - file_0_prefetch_offset_),
+                  bytes_read);
+    }
+    return bytes_read;
+  }
+  File* file = const_cast<File*>(&files_[file_index]);
+  if (!io_engine_)
+    return file->Read(offset, data, size);
+  std::vector<SimpleIOEngine::Operation> operations(
+      1, SimpleIOEngine::Operation::Read(file, offset, data, size));
+  io_engine_->Run(&operations);
+  return operations[0].result;
+}
+
+int SimpleSynchronousEntry::WriteFile(int file_index,
+                                      int64_t offset,
+                                      const char* data,
+                                      int size) {
+  if (!io_engine_)
+    return files_[file_index].Write(offset, data, size);
+  std::vector<SimpleIOEngine::Operation> operations(
+      1, SimpleIOEngine::Operation::Write(&files_[file_index], offset, data,
+                                          size));
+  io_engine_->Run(&operations);
+  return operations[0].result;
+}
+
+void SimpleSynchronousEntry::RunFileOperations(
+    std::vector<SimpleIOEngine::Operation>* operations) const {
+  if (io_engine_)
+    io_engine_->Run(operations);
+  else
+    SimpleIOEngine::RunSynchronously(operations);
+}
+
 void SimpleSynchronousEntry::Doom() const {
+  if (packed_) {
+    // A newer entry with the same hash may already have replaced this one.
+    if (packed_store_->IsCurrentGeneration(entry_hash_, packed_generation_))
+      packed_store_->RemoveEntry(entry_hash_);
+    return;
+  }
   DeleteFilesForEntryHash(path_, entry_hash_);
 }
 
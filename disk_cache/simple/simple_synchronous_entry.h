@@ -22,6 +22,8 @@
 #include "net/base/cache_type.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
+#include "net/disk_cache/simple/simple_io_engine.h"
+#include "net/disk_cache/simple/simple_packed_store.h"
 
 namespace net {
 class GrowableIOBuffer;
@@ -79,6 +81,9 @@ struct SimpleEntryCreationResults {
 
   SimpleSynchronousEntry* sync_entry;
   scoped_refptr<net::GrowableIOBuffer> stream_0_data;
+  // Set if stream 1 was read along with stream 0 when opening the entry. Its
+  // checksum has been verified.
+  scoped_refptr<net::GrowableIOBuffer> stream_1_data;
   SimpleEntryStat entry_stat;
   uint32_t stream_0_crc32;
   int result;
@@ -89,6 +94,12 @@ struct SimpleEntryCreationResults {
 // a single thread between synchronization points.
 class SimpleSynchronousEntry {
  public:
+  // With the SimpleSpeculativeOpen feature, opening an entry reads up to this
+  // much of the end of file 0 at once, which usually covers stream 0 and the
+  // EOF records. If that is the whole file, stream 1 is returned along with
+  // stream 0.
+  static const int kSpeculativeReadSize = 16 * 1024;
+
   struct CRCRecord {
     CRCRecord();
     CRCRecord(int index_p, bool has_crc32_p, uint32_t data_crc32_p);
@@ -117,9 +128,14 @@ class SimpleSynchronousEntry {
 
   // Opens a disk cache entry on disk. The |key| parameter is optional, if empty
   // the operation may be slower. The |entry_hash| parameter is required.
-  // |had_index| is provided only for histograms.
+  // |had_index| is provided only for histograms. |packed_store| is null unless
+  // small entries are kept in a SimplePackedStore, in which case the entry is
+  // looked for there first. |io_engine| is null unless the file operations of
+  // the entry are run through a SimpleIOEngine.
   static void OpenEntry(net::CacheType cache_type,
                         const base::FilePath& path,
+                        SimplePackedStore* packed_store,
+                        SimpleIOEngine* io_engine,
                         const std::string& key,
                         uint64_t entry_hash,
                         bool had_index,
@@ -127,6 +143,8 @@ class SimpleSynchronousEntry {
 
   static void CreateEntry(net::CacheType cache_type,
                           const base::FilePath& path,
+                          SimplePackedStore* packed_store,
+                          SimpleIOEngine* io_engine,
                           const std::string& key,
                           uint64_t entry_hash,
                           bool had_index,
@@ -135,20 +153,24 @@ class SimpleSynchronousEntry {
   // Deletes an entry from the file system without affecting the state of the
   // corresponding instance, if any (allowing operations to continue to be
   // executed through that instance). Returns a net error code.
-  static int DoomEntry(const base::FilePath& path, uint64_t entry_hash);
+  static int DoomEntry(const base::FilePath& path,
+                       SimplePackedStore* packed_store,
+                       uint64_t entry_hash);
 
   // Like |DoomEntry()| above, except that it truncates the entry files rather
   // than deleting them. Used when dooming entries after the backend has
   // shutdown. See implementation of |SimpleEntryImpl::DoomEntryInternal()| for
   // more.
   static int TruncateEntryFiles(const base::FilePath& path,
+                                SimplePackedStore* packed_store,
                                 uint64_t entry_hash);
 
   // Like |DoomEntry()| above. Deletes all entries corresponding to the
   // |key_hashes|. Succeeds only when all entries are deleted. Returns a net
   // error code.
   static int DoomEntrySet(const std::vector<uint64_t>* key_hashes,
-                          const base::FilePath& path);
+                          const base::FilePath& path,
+                          SimplePackedStore* packed_store);
 
   // N.B. ReadData(), WriteData(), CheckEOFRecord() and Close() may block on IO.
   void ReadData(const EntryOperationData& in_entry_op,
@@ -222,6 +244,8 @@ class SimpleSynchronousEntry {
 
   SimpleSynchronousEntry(net::CacheType cache_type,
                          const base::FilePath& path,
+                         SimplePackedStore* packed_store,
+                         SimpleIOEngine* io_engine,
                          const std::string& key,
                          uint64_t entry_hash,
                          bool had_index);
@@ -255,7 +279,20 @@ class SimpleSynchronousEntry {
   // Returns a net error, i.e. net::OK on success.
   int InitializeForOpen(SimpleEntryStat* out_entry_stat,
                         scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
-                        uint32_t* out_stream_0_crc32);
+                        uint32_t* out_stream_0_crc32,
+                        scoped_refptr<net::GrowableIOBuffer>* stream_1_data);
+
+  // Reads the last kSpeculativeReadSize bytes of file 0, or all of it if it is
+  // smaller, into |file_0_prefetch_|. Reads of that range are then served
+  // from memory by ReadFile().
+  void PrefetchFile0(int64_t file_size);
+
+  // If all of file 0 was prefetched, checks the header and key and copies
+  // stream 1 to |stream_1_data| once its checksum is verified. Returns a net
+  // error.
+  int ReadPrefetchedStream1(
+      const SimpleEntryStat& entry_stat,
+      scoped_refptr<net::GrowableIOBuffer>* stream_1_data);
 
   // Writes the header and key to a newly-created stream file. |index| is the
   // index of the stream. Returns true on success; returns false and sets
@@ -266,6 +303,40 @@ class SimpleSynchronousEntry {
   // when the entry already exists.
   int InitializeForCreate(SimpleEntryStat* out_entry_stat);
 
+  // Like InitializeForOpen() and InitializeForCreate(), for an entry in
+  // |packed_store_|.
+  int InitializeForOpenPacked(
+      SimpleEntryStat* out_entry_stat,
+      scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
+      uint32_t* out_stream_0_crc32);
+  int InitializeForCreatePacked(SimpleEntryStat* out_entry_stat);
+
+  // Returns true if an entry of the size in |entry_stat| can be kept in
+  // |packed_store_|.
+  bool FitsInPackedStore(const SimpleEntryStat& entry_stat) const;
+
+  // Moves an entry that outgrew |packed_store_| to files of its own, writing
+  // out all of its streams. Returns false on failure, or if the entry has been
+  // doomed.
+  bool SpillPackedEntry();
+
+  // Reads from or writes to |files_[file_index]|, through |io_engine_| if there
+  // is one. Return what base::File::Read() and base::File::Write() would.
+  int ReadFile(int file_index, int64_t offset, char* data, int size) const;
+  int WriteFile(int file_index, int64_t offset, const char* data, int size);
+
+  // Runs |operations| through |io_engine_| if there is one, or else one at a
+  // time through base::File.
+  void RunFileOperations(std::vector<SimpleIOEngine::Operation>* operations)
+      const;
+
+  // Writes stream 0 data from |stream_0_data|, and the EOF records of the
+  // streams in |crc32s_to_write|, as a single batch of file operations.
+  // Returns false on failure.
+  bool WriteEOFRecords(const SimpleEntryStat& entry_stat,
+                       const std::vector<CRCRecord>& crc32s_to_write,
+                       const char* stream_0_data);
+
   // Allocates and fills a buffer with stream 0 data in |stream_0_data|, then
   // checks its crc32.
   int ReadAndValidateStream0(
@@ -364,6 +435,24 @@ class SimpleSynchronousEntry {
   // True if the entry was created, or false if it was opened. Used to log
   // SimpleCache.*.EntryCreatedWithStream2Omitted only for created entries.
   bool files_created_;
+
+  // Null unless small entries are kept in a SimplePackedStore.
+  const scoped_refptr<SimplePackedStore> packed_store_;
+
+  // Null unless file operations are run through a SimpleIOEngine.
+  SimpleIOEngine* const io_engine_;
+
+  // The end of file 0, starting at |file_0_prefetch_offset_|, while the entry
+  // is being opened with the SimpleSpeculativeOpen feature.
+  std::vector<char> file_0_prefetch_;
+  int64_t file_0_prefetch_offset_;
+
+  // True while the entry is kept in |packed_store_| rather than in files of
+  // its own. Its streams are then held in |packed_data_|, and written back as
+  // a single record on Close().
+  bool packed_;
+  uint64_t packed_generation_;
+  SimplePackedStore::EntryData packed_data_;
 };
 
 }  // namespace disk_cache
@@ -23,6 +23,7 @@ DnsConfig::DnsConfig()
       attempts(2),
       rotate(false),
       edns0(false),
+      use_tcp(false),
       use_local_ipv6(false) {}
 
 DnsConfig::DnsConfig(const DnsConfig& other) = default;
@@ -43,6 +44,7 @@ bool DnsConfig::EqualsIgnoreHosts(const DnsConfig& d) const {
          (attempts == d.attempts) &&
          (rotate == d.rotate) &&
          (edns0 == d.edns0) &&
+         (use_tcp == d.use_tcp) &&
          (use_local_ipv6 == d.use_local_ipv6);
 }
 
@@ -56,6 +58,7 @@ void DnsConfig::CopyIgnoreHosts(const DnsConfig& d) {
   attempts = d.attempts;
   rotate = d.rotate;
   edns0 = d.edns0;
+  use_tcp = d.use_tcp;
   use_local_ipv6 = d.use_local_ipv6;
 }
 
@@ -79,6 +82,7 @@ std::unique_ptr<base::Value> DnsConfig::ToValue() const {
   dict->SetInteger("attempts", attempts);
   dict->SetBoolean("rotate", rotate);
   dict->SetBoolean("edns0", edns0);
+  dict->SetBoolean("use_tcp", use_tcp);
   dict->SetBoolean("use_local_ipv6", use_local_ipv6);
   dict->SetInteger("num_hosts", hosts.size());
 
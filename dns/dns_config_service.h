@@ -83,6 +83,11 @@ struct NET_EXPORT_PRIVATE DnsConfig {
   bool rotate;
   // Enable EDNS0 extensions.
   bool edns0;
+  // Send every query over a TCP connection to the server, which is kept open
+  // and shared by concurrent queries, see RES_USEVC.  Saves a round trip for
+  // answers too large for UDP, and lets bulk lookups against a local resolver
+  // run without a socket, and an ephemeral port, per query.
+  bool use_tcp;
 
   // Indicates system configuration uses local IPv6 connectivity, e.g.,
   // DirectAccess. This is exposed for HostResolver to skip IPv6 probes,
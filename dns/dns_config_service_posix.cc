@@ -538,6 +538,7 @@ ConfigParsePosixResult ConvertResStateToDnsConfig(const struct __res_state& res,
 #if defined(RES_USE_EDNS0)
   dns_config->edns0 = res.options & RES_USE_EDNS0;
 #endif
+  dns_config->use_tcp = res.options & RES_USEVC;
 #if !defined(RES_USE_DNSSEC)
   // Some versions of libresolv don't have support for the DO bit. In this
   // case, we proceed without it.
@@ -552,7 +553,7 @@ ConfigParsePosixResult ConvertResStateToDnsConfig(const struct __res_state& res,
     return CONFIG_PARSE_POSIX_MISSING_OPTIONS;
   }
 
-  const unsigned kUnhandledOptions = RES_USEVC | RES_IGNTC | RES_USE_DNSSEC;
+  const unsigned kUnhandledOptions = RES_IGNTC | RES_USE_DNSSEC;
   if (res.options & kUnhandledOptions) {
     dns_config->unhandled_options = true;
     return CONFIG_PARSE_POSIX_UNHANDLED_OPTIONS;
@@ -154,6 +154,17 @@ TEST(DnsConfigServicePosixTest, ConvertResStateToDnsConfig) {
   EXPECT_TRUE(expected_config.EqualsIgnoreHosts(config));
 }
 
+TEST(DnsConfigServicePosixTest, UseVC) {
+  struct __res_state res;
+  DnsConfig config;
+  InitializeResState(&res);
+  res.options |= RES_USEVC;
+  ASSERT_EQ(internal::CONFIG_PARSE_POSIX_OK,
+            internal::ConvertResStateToDnsConfig(res, &config));
+  CloseResState(&res);
+  EXPECT_TRUE(config.use_tcp);
+}
+
 TEST(DnsConfigServicePosixTest, RejectEmptyNameserver) {
   struct __res_state res = {};
   res.options = RES_INIT | RES_RECURSE | RES_DEFNAMES | RES_DNSRCH;
@@ -17,13 +17,16 @@
 #include "base/metrics/histogram_macros.h"
 #include "base/metrics/sample_vector.h"
 #include "base/rand_util.h"
+#include "base/single_thread_task_runner.h"
 #include "base/stl_util.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "base/time/time.h"
 #include "base/values.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
 #include "net/dns/dns_config_service.h"
 #include "net/dns/dns_socket_pool.h"
+#include "net/dns/dns_tcp_connection.h"
 #include "net/dns/dns_util.h"
 #include "net/log/net_log_event_type.h"
 #include "net/log/net_log_source.h"
@@ -111,7 +114,8 @@ DnsSession::DnsSession(const DnsConfig& config,
                                 0,
                                 std::numeric_limits<uint16_t>::max())),
       net_log_(net_log),
-      server_index_(0) {
+      server_index_(0),
+      tcp_connections_(config_.nameservers.size()) {
   socket_pool_->Initialize(&config_.nameservers, net_log);
   UMA_HISTOGRAM_CUSTOM_COUNTS("AsyncDNS.ServerCount",
                               config_.nameservers.size(), 1, 10, 11);
@@ -293,6 +297,23 @@ std::unique_ptr<StreamSocket> DnsSession::CreateTCPSocket(
   return socket_pool_->CreateTCPSocket(server_index, source);
 }
 
+DnsTCPConnection* DnsSession::GetTCPConnection(unsigned server_index,
+                                               const NetLogSource& source) {
+  DCHECK_LT(server_index, tcp_connections_.size());
+  std::unique_ptr<DnsTCPConnection>& connection =
+      tcp_connections_[server_index];
+  if (!connection || !connection->is_usable()) {
+    // The failed connection may still be running its callbacks.
+    if (connection) {
+      base::ThreadTaskRunnerHandle::Get()->DeleteSoon(FROM_HERE,
+                                                      connection.release());
+    }
+    connection.reset(
+        new DnsTCPConnection(CreateTCPSocket(server_index, source)));
+  }
+  return connection.get();
+}
+
 void DnsSession::ApplyPersistentData(const base::Value& data) {}
 
 std::unique_ptr<const base::Value> DnsSession::GetPersistentData() const {
@@ -28,6 +28,7 @@ class BucketRanges;
 namespace net {
 
 class DatagramClientSocket;
+class DnsTCPConnection;
 class NetLog;
 struct NetLogSource;
 class StreamSocket;
@@ -109,6 +110,12 @@ class NET_EXPORT_PRIVATE DnsSession
   std::unique_ptr<StreamSocket> CreateTCPSocket(unsigned server_index,
                                                 const NetLogSource& source);
 
+  // Returns the TCP connection to the server, which transactions share and
+  // pipeline their queries on.  Opens a new one, with a socket from
+  // CreateTCPSocket(), if there is none yet or the last one failed.
+  DnsTCPConnection* GetTCPConnection(unsigned server_index,
+                                     const NetLogSource& source);
+
   void ApplyPersistentData(const base::Value& data);
   std::unique_ptr<const base::Value> GetPersistentData() const;
 
@@ -149,6 +156,9 @@ class NET_EXPORT_PRIVATE DnsSession
   // Track runtime statistics of each DNS server.
   std::vector<std::unique_ptr<ServerStats>> server_stats_;
 
+  // TCP connection to each DNS server, created on first use.
+  std::vector<std::unique_ptr<DnsTCPConnection>> tcp_connections_;
+
   // Buckets shared for all |ServerStats::rtt_histogram|.
   struct RttBuckets : public base::BucketRanges {
     RttBuckets();
@@ -0,0 +1,301 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/dns_tcp_connection.h"
+
+#include <string.h>
+
+#include <utility>
+
+#include "base/big_endian.h"
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/single_thread_task_runner.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/default_tick_clock.h"
+#include "base/time/tick_clock.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/dns_response.h"
+#include "net/socket/stream_socket.h"
+
+namespace net {
+
+namespace {
+
+// How long the ID of a cancelled query stays in use, waiting for its response.
+// Longer than the longest DNS timeout.
+const int kCancelledIdLifetimeSeconds = 30;
+
+}  // namespace
+
+DnsTCPConnection::Request::Request(
+    const base::WeakPtr<DnsTCPConnection>& connection,
+    const DnsQuery* query,
+    const CompletionCallback& callback)
+    : connection_(connection), query_(query), callback_(callback) {}
+
+DnsTCPConnection::Request::~Request() {
+  if (connection_)
+    connection_->Cancel(this);
+}
+
+DnsTCPConnection::DnsTCPConnection(std::unique_ptr<StreamSocket> socket)
+    : socket_(std::move(socket)),
+      error_(OK),
+      connecting_(false),
+      connected_(false),
+      io_scheduled_(false),
+      writing_(false),
+      reading_(false),
+      num_queries_sent_(0),
+      length_buffer_(new IOBufferWithSize(sizeof(uint16_t))),
+      tick_clock_(new base::DefaultTickClock()),
+      weak_factory_(this) {
+  read_buffer_ =
+      new DrainableIOBuffer(length_buffer_.get(), length_buffer_->size());
+}
+
+DnsTCPConnection::~DnsTCPConnection() {}
+
+std::unique_ptr<DnsTCPConnection::Request> DnsTCPConnection::SendQuery(
+    const DnsQuery* query,
+    const CompletionCallback& callback) {
+  DCHECK(is_usable());
+  DCHECK(!IsIdInUse(query->id()));
+
+  std::unique_ptr<Request> request(
+      new Request(weak_factory_.GetWeakPtr(), query, callback));
+  pending_[query->id()] = request.get();
+  cancelled_ids_.erase(query->id());
+  ++num_queries_sent_;
+
+  // Write the length and the query at once, so that they go out in a single
+  // segment.
+  int query_size = query->io_buffer()->size();
+  DCHECK_LE(query_size, 0xffff);
+  scoped_refptr<IOBufferWithSize> buffer =
+      new IOBufferWithSize(sizeof(uint16_t) + query_size);
+  base::WriteBigEndian<uint16_t>(buffer->data(),
+                                 static_cast<uint16_t>(query_size));
+  memcpy(buffer->data() + sizeof(uint16_t), query->io_buffer()->data(),
+         query_size);
+  write_queue_.push_back(new DrainableIOBuffer(buffer.get(), buffer->size()));
+
+  if (!io_scheduled_) {
+    io_scheduled_ = true;
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        base::Bind(&DnsTCPConnection::DoIO, weak_factory_.GetWeakPtr()));
+  }
+  return request;
+}
+
+bool DnsTCPConnection::IsIdInUse(uint16_t id) const {
+  if (pending_.count(id) > 0)
+    return true;
+  auto it = cancelled_ids_.find(id);
+  return it != cancelled_ids_.end() && it->second > tick_clock_->NowTicks();
+}
+
+const NetLogWithSource& DnsTCPConnection::net_log() const {
+  return socket_->NetLog();
+}
+
+void DnsTCPConnection::SetTickClockForTesting(
+    std::unique_ptr<base::TickClock> tick_clock) {
+  tick_clock_ = std::move(tick_clock);
+}
+
+void DnsTCPConnection::DoIO() {
+  io_scheduled_ = false;
+  if (!is_usable())
+    return;
+
+  if (!connected_) {
+    if (connecting_)
+      return;
+    connecting_ = true;
+    int rv = socket_->Connect(base::Bind(&DnsTCPConnection::OnConnectComplete,
+                                         base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnConnectComplete(rv);
+    return;
+  }
+
+  base::WeakPtr<DnsTCPConnection> self = weak_factory_.GetWeakPtr();
+  if (!writing_)
+    DoWrite();
+  // The first query starts the reads, which then go on until the connection
+  // fails, so that the server closing it is noticed while idle.
+  if (self && is_usable() && !reading_)
+    DoRead();
+}
+
+void DnsTCPConnection::OnConnectComplete(int rv) {
+  DCHECK_NE(ERR_IO_PENDING, rv);
+  connecting_ = false;
+  if (rv != OK) {
+    Fail(rv);
+    return;
+  }
+  connected_ = true;
+  DoIO();
+}
+
+void DnsTCPConnection::DoWrite() {
+  DCHECK(!writing_);
+  while (!write_queue_.empty()) {
+    DrainableIOBuffer* buffer = write_queue_.front().get();
+    int rv = socket_->Write(buffer, buffer->BytesRemaining(),
+                            base::Bind(&DnsTCPConnection::OnWriteComplete,
+                                       base::Unretained(this)));
+    if (rv == ERR_IO_PENDING) {
+      writing_ = true;
+      return;
+    }
+    if (!HandleWriteResult(rv))
+      return;
+  }
+}
+
+void DnsTCPConnection::OnWriteComplete(int rv) {
+  DCHECK(writing_);
+  writing_ = false;
+  if (!is_usable())
+    return;
+  if (HandleWriteResult(rv))
+    DoWrite();
+}
+
+bool DnsTCPConnection::HandleWriteResult(int rv) {
+  DCHECK_NE(ERR_IO_PENDING, rv);
+  if (rv < 0) {
+    Fail(rv);
+    return false;
+  }
+  DrainableIOBuffer* buffer = write_queue_.front().get();
+  buffer->DidConsume(rv);
+  if (buffer->BytesRemaining() == 0)
+    write_queue_.pop_front();
+  return true;
+}
+
+void DnsTCPConnection::DoRead() {
+  DCHECK(!reading_);
+  for (;;) {
+    int rv = socket_->Read(read_buffer_.get(), read_buffer_->BytesRemaining(),
+                           base::Bind(&DnsTCPConnection::OnReadComplete,
+                                      base::Unretained(this)));
+    if (rv == ERR_IO_PENDING) {
+      reading_ = true;
+      return;
+    }
+    if (!HandleReadResult(rv))
+      return;
+  }
+}
+
+void DnsTCPConnection::OnReadComplete(int rv) {
+  DCHECK(reading_);
+  reading_ = false;
+  if (!is_usable())
+    return;
+  if (HandleReadResult(rv))
+    DoRead();
+}
+
+bool DnsTCPConnection::HandleReadResult(int rv) {
+  DCHECK_NE(ERR_IO_PENDING, rv);
+  if (rv <= 0) {
+    Fail(rv == 0 ? ERR_CONNECTION_CLOSED : rv);
+    return false;
+  }
+
+  read_buffer_->DidConsume(rv);
+  if (read_buffer_->BytesRemaining() > 0)
+    return true;
+
+  if (!response_) {
+    uint16_t length;
+    base::ReadBigEndian<uint16_t>(length_buffer_->data(), &length);
+    // Without a whole header there is no ID to match.
+    if (length < sizeof(dns_protocol::Header)) {
+      Fail(ERR_DNS_MALFORMED_RESPONSE);
+      return false;
+    }
+    // Allocate more space so that DnsResponse::InitParse sanity check passes.
+    response_.reset(new DnsResponse(length + 1));
+    read_buffer_ = new DrainableIOBuffer(response_->io_buffer(), length);
+    return true;
+  }
+
+  int length = read_buffer_->BytesConsumed();
+  std::unique_ptr<DnsResponse> response = std::move(response_);
+  read_buffer_ =
+      new DrainableIOBuffer(length_buffer_.get(), length_buffer_->size());
+
+  uint16_t id;
+  base::ReadBigEndian<uint16_t>(response->io_buffer()->data(), &id);
+  auto it = pending_.find(id);
+  if (it == pending_.end()) {
+    // The answer to a cancelled query, or to nothing at all.
+    cancelled_ids_.erase(id);
+    return true;
+  }
+  Request* request = it->second;
+  pending_.erase(it);
+
+  int result = response->InitParse(length, *request->query_)
+                   ? OK
+                   : ERR_DNS_MALFORMED_RESPONSE;
+  request->response_ = std::move(response);
+  base::WeakPtr<DnsTCPConnection> self = weak_factory_.GetWeakPtr();
+  CompletionCallback callback = request->callback_;
+  callback.Run(result);
+  return self && is_usable();
+}
+
+void DnsTCPConnection::Cancel(Request* request) {
+  uint16_t id = request->query_->id();
+  auto it = pending_.find(id);
+  if (it == pending_.end() || it->second != request)
+    return;
+  pending_.erase(it);
+
+  // Forget the cancelled queries whose response is not coming.
+  base::TimeTicks now = tick_clock_->NowTicks();
+  for (auto cancelled = cancelled_ids_.begin();
+       cancelled != cancelled_ids_.end();) {
+    if (cancelled->second <= now)
+      cancelled = cancelled_ids_.erase(cancelled);
+    else
+      ++cancelled;
+  }
+  cancelled_ids_[id] =
+      now + base::TimeDelta::FromSeconds(kCancelledIdLifetimeSeconds);
+}
+
+void DnsTCPConnection::Fail(int error) {
+  DCHECK_NE(OK, error);
+  DCHECK(is_usable());
+  error_ = error;
+  write_queue_.clear();
+  cancelled_ids_.clear();
+  socket_->Disconnect();
+
+  // Callbacks may cancel other requests, so take them one at a time.
+  base::WeakPtr<DnsTCPConnection> self = weak_factory_.GetWeakPtr();
+  while (self && !pending_.empty()) {
+    Request* request = pending_.begin()->second;
+    pending_.erase(pending_.begin());
+    CompletionCallback callback = request->callback_;
+    callback.Run(error);
+  }
+}
+
+}  // namespace net
@@ -0,0 +1,158 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DNS_DNS_TCP_CONNECTION_H_
+#define NET_DNS_DNS_TCP_CONNECTION_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "net/base/completion_callback.h"
+#include "net/base/net_export.h"
+
+namespace base {
+class TickClock;
+}
+
+namespace net {
+
+class DnsQuery;
+class DnsResponse;
+class DrainableIOBuffer;
+class IOBufferWithSize;
+class NetLogWithSource;
+class StreamSocket;
+
+// A TCP connection to a nameserver which carries any number of queries at
+// once, as RFC 7766 allows.  Each query is written as soon as it is sent,
+// without waiting for the responses to earlier ones, and responses are
+// matched to queries by ID in whatever order the server sends them.
+//
+// The connection connects on the first query and stays open.  If it fails,
+// or the server closes it, every outstanding query fails with the same error
+// and the connection is no longer usable.
+class NET_EXPORT_PRIVATE DnsTCPConnection {
+ public:
+  // An outstanding query.  Destroying it cancels the query.
+  class NET_EXPORT_PRIVATE Request {
+   public:
+    ~Request();
+
+    // The response, once the callback has run with OK or
+    // ERR_DNS_MALFORMED_RESPONSE.
+    DnsResponse* response() { return response_.get(); }
+
+   private:
+    friend class DnsTCPConnection;
+
+    Request(const base::WeakPtr<DnsTCPConnection>& connection,
+            const DnsQuery* query,
+            const CompletionCallback& callback);
+
+    base::WeakPtr<DnsTCPConnection> connection_;
+    const DnsQuery* query_;
+    CompletionCallback callback_;
+    std::unique_ptr<DnsResponse> response_;
+
+    DISALLOW_COPY_AND_ASSIGN(Request);
+  };
+
+  // |socket| must not be connected yet.
+  explicit DnsTCPConnection(std::unique_ptr<StreamSocket> socket);
+  ~DnsTCPConnection();
+
+  // Sends |query|, which must outlive the returned request.  Its ID must not
+  // be in use on this connection, see IsIdInUse().  Runs |callback| with OK
+  // once the response has been read, with ERR_DNS_MALFORMED_RESPONSE if the
+  // response with that ID does not answer |query|, or with a network error
+  // if the connection fails first.  |callback| never runs from within
+  // SendQuery().  Must only be called while is_usable().
+  std::unique_ptr<Request> SendQuery(const DnsQuery* query,
+                                     const CompletionCallback& callback);
+
+  // True if a query with |id| was sent and not answered yet.  A cancelled
+  // query keeps its ID for a while, so that a late response is not mistaken
+  // for the response to a new query, but not for longer than any server
+  // takes to answer, in case the response never comes.
+  bool IsIdInUse(uint16_t id) const;
+
+  // False once the connection has failed or the server has closed it.
+  bool is_usable() const { return error_ == OK; }
+
+  // True if a query was sent before.  A server may close an idle connection
+  // at any time, so a query which fails on a reused connection is worth
+  // sending again on a new one.
+  bool is_reused() const { return num_queries_sent_ > 0; }
+
+  const NetLogWithSource& net_log() const;
+
+  void SetTickClockForTesting(std::unique_ptr<base::TickClock> tick_clock);
+
+ private:
+  // Starts connecting, writing and reading as needed.  Posted by SendQuery()
+  // so that callbacks do not run from within it.
+  void DoIO();
+
+  void OnConnectComplete(int rv);
+
+  void DoWrite();
+  void OnWriteComplete(int rv);
+  // Returns false if the connection failed.
+  bool HandleWriteResult(int rv);
+
+  void DoRead();
+  void OnReadComplete(int rv);
+  // Returns false if the connection failed or was destroyed by a callback.
+  bool HandleReadResult(int rv);
+
+  // Cancels |request| unless its response was already read.
+  void Cancel(Request* request);
+
+  // Fails every outstanding query with |error|.  May destroy |this|.
+  void Fail(int error);
+
+  std::unique_ptr<StreamSocket> socket_;
+
+  // OK, or the error the connection failed with.
+  int error_;
+  bool connecting_;
+  bool connected_;
+  bool io_scheduled_;
+  bool writing_;
+  bool reading_;
+  int num_queries_sent_;
+
+  // Length prefixed queries waiting to be written, the first of which may be
+  // partly written.
+  std::deque<scoped_refptr<DrainableIOBuffer>> write_queue_;
+
+  // Queries waiting for a response, by ID.
+  std::map<uint16_t, Request*> pending_;
+  // The IDs of cancelled queries whose response has not arrived, and the
+  // time each stops being in use.
+  std::map<uint16_t, base::TimeTicks> cancelled_ids_;
+
+  std::unique_ptr<base::TickClock> tick_clock_;
+
+  // Reads the two byte length of the next response, then the response into
+  // |response_|.
+  scoped_refptr<IOBufferWithSize> length_buffer_;
+  scoped_refptr<DrainableIOBuffer> read_buffer_;
+  std::unique_ptr<DnsResponse> response_;
+
+  base::WeakPtrFactory<DnsTCPConnection> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsTCPConnection);
+};
+
+}  // namespace net
+
+#endif  // NET_DNS_DNS_TCP_CONNECTION_H_
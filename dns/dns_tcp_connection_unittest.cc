@@ -0,0 +1,330 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/dns_tcp_connection.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/big_endian.h"
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/memory/ptr_util.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "base/time/time.h"
+#include "net/base/address_list.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/dns_response.h"
+#include "net/dns/dns_util.h"
+#include "net/log/net_log_source.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_server_socket.h"
+#include "net/test/gtest_util.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsError;
+using net::test::IsOk;
+
+namespace net {
+
+namespace {
+
+// A stand-in for a local DNS server.  Accepts a single connection and,
+// whenever it has read |batch_size| queries, answers them with empty
+// responses in reverse order, as a server resolving them in parallel might.
+class TestTCPDnsServer {
+ public:
+  explicit TestTCPDnsServer(size_t batch_size)
+      : batch_size_(batch_size),
+        server_socket_(nullptr, NetLogSource()),
+        read_buffer_(new IOBufferWithSize(4096)),
+        writing_(false) {}
+
+  void Start() {
+    ASSERT_THAT(server_socket_.Listen(
+                    IPEndPoint(IPAddress::IPv4Localhost(), 0), 1),
+                IsOk());
+    ASSERT_THAT(server_socket_.GetLocalAddress(&address_), IsOk());
+    int rv = server_socket_.Accept(
+        &socket_,
+        base::Bind(&TestTCPDnsServer::OnAccept, base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnAccept(rv);
+  }
+
+  std::unique_ptr<StreamSocket> CreateClientSocket() const {
+    return std::unique_ptr<StreamSocket>(new TCPClientSocket(
+        AddressList(address_), nullptr, nullptr, NetLogSource()));
+  }
+
+  // Closes the connection once |num_queries| more queries have been read,
+  // without answering them.
+  void CloseAfter(size_t num_queries) { close_after_ = num_queries; }
+
+  size_t num_queries() const { return num_queries_; }
+
+ private:
+  void OnAccept(int rv) {
+    ASSERT_THAT(rv, IsOk());
+    Read();
+  }
+
+  void Read() {
+    int rv = socket_->Read(
+        read_buffer_.get(), read_buffer_->size(),
+        base::Bind(&TestTCPDnsServer::OnRead, base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnRead(rv);
+  }
+
+  void OnRead(int rv) {
+    if (rv <= 0)
+      return;
+    received_.append(read_buffer_->data(), rv);
+
+    while (received_.size() >= sizeof(uint16_t)) {
+      uint16_t length;
+      base::ReadBigEndian<uint16_t>(received_.data(), &length);
+      if (received_.size() < sizeof(uint16_t) + length)
+        break;
+      batch_.push_back(received_.substr(sizeof(uint16_t), length));
+      received_.erase(0, sizeof(uint16_t) + length);
+      ++num_queries_;
+      if (close_after_ > 0 && --close_after_ == 0) {
+        socket_->Disconnect();
+        return;
+      }
+    }
+    if (batch_.size() >= batch_size_) {
+      for (auto it = batch_.rbegin(); it != batch_.rend(); ++it)
+        AppendResponse(*it);
+      batch_.clear();
+      Write();
+    }
+    Read();
+  }
+
+  // Appends a length prefixed response to |query|, with no answers.
+  void AppendResponse(const std::string& query) {
+    std::string response = query;
+    dns_protocol::Header* header =
+        reinterpret_cast<dns_protocol::Header*>(&response[0]);
+    header->flags |= base::HostToNet16(dns_protocol::kFlagResponse);
+    char length[sizeof(uint16_t)];
+    base::WriteBigEndian<uint16_t>(length,
+                                   static_cast<uint16_t>(response.size()));
+    to_write_.append(length, sizeof(length));
+    to_write_.append(response);
+  }
+
+  void Write() {
+    if (writing_ || to_write_.empty())
+      return;
+    scoped_refptr<StringIOBuffer> buffer = new StringIOBuffer(to_write_);
+    to_write_.clear();
+    write_buffer_ = new DrainableIOBuffer(buffer.get(), buffer->size());
+    writing_ = true;
+    DoWrite();
+  }
+
+  void DoWrite() {
+    int rv = socket_->Write(
+        write_buffer_.get(), write_buffer_->BytesRemaining(),
+        base::Bind(&TestTCPDnsServer::OnWrite, base::Unretained(this)));
+    if (rv != ERR_IO_PENDING)
+      OnWrite(rv);
+  }
+
+  void OnWrite(int rv) {
+    ASSERT_GT(rv, 0);
+    write_buffer_->DidConsume(rv);
+    if (write_buffer_->BytesRemaining() > 0) {
+      DoWrite();
+      return;
+    }
+    writing_ = false;
+    Write();
+  }
+
+  const size_t batch_size_;
+  size_t close_after_ = 0;
+  size_t num_queries_ = 0;
+
+  TCPServerSocket server_socket_;
+  IPEndPoint address_;
+  std::unique_ptr<StreamSocket> socket_;
+
+  scoped_refptr<IOBufferWithSize> read_buffer_;
+  std::string received_;
+  std::vector<std::string> batch_;
+
+  std::string to_write_;
+  scoped_refptr<DrainableIOBuffer> write_buffer_;
+  bool writing_;
+
+  DISALLOW_COPY_AND_ASSIGN(TestTCPDnsServer);
+};
+
+class DnsTCPConnectionTest : public testing::Test {
+ protected:
+  struct Query {
+    std::unique_ptr<DnsQuery> query;
+    std::unique_ptr<DnsTCPConnection::Request> request;
+    int result = ERR_IO_PENDING;
+  };
+
+  DnsTCPConnectionTest() : num_completed_(0) {}
+
+  // Sends queries for "host<i>.example" with ID i, for each i in
+  // [first, first + count).
+  void SendQueries(DnsTCPConnection* connection, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+      std::string qname;
+      ASSERT_TRUE(DNSDomainFromDot(
+          base::StringPrintf("host%d.example", i), &qname));
+      std::unique_ptr<Query> query(new Query);
+      query->query.reset(new DnsQuery(i, qname, dns_protocol::kTypeA));
+      query->request = connection->SendQuery(
+          query->query.get(),
+          base::Bind(&DnsTCPConnectionTest::OnComplete, base::Unretained(this),
+                     query.get()));
+      queries_.push_back(std::move(query));
+    }
+  }
+
+  void OnComplete(Query* query, int rv) {
+    EXPECT_EQ(ERR_IO_PENDING, query->result);
+    query->result = rv;
+    if (++num_completed_ == expected_completions_ && run_loop_)
+      run_loop_->Quit();
+  }
+
+  void WaitForCompletions(int count) {
+    expected_completions_ = count;
+    if (num_completed_ >= count)
+      return;
+    run_loop_.reset(new base::RunLoop());
+    run_loop_->Run();
+    run_loop_.reset();
+  }
+
+  base::MessageLoopForIO message_loop_;
+  std::vector<std::unique_ptr<Query>> queries_;
+  int num_completed_;
+  int expected_completions_ = 0;
+  std::unique_ptr<base::RunLoop> run_loop_;
+};
+
+TEST_F(DnsTCPConnectionTest, PipelinedQueriesAnsweredOutOfOrder) {
+  const int kNumQueries = 100;
+  TestTCPDnsServer server(kNumQueries);
+  ASSERT_NO_FATAL_FAILURE(server.Start());
+
+  DnsTCPConnection connection(server.CreateClientSocket());
+  EXPECT_FALSE(connection.is_reused());
+  SendQueries(&connection, 0, kNumQueries);
+  EXPECT_TRUE(connection.IsIdInUse(0));
+  // Nothing completes from within SendQuery().
+  EXPECT_EQ(0, num_completed_);
+
+  WaitForCompletions(kNumQueries);
+  EXPECT_EQ(static_cast<size_t>(kNumQueries), server.num_queries());
+  for (const auto& query : queries_) {
+    EXPECT_THAT(query->result, IsOk());
+    DnsResponse* response = query->request->response();
+    ASSERT_TRUE(response);
+    EXPECT_TRUE(response->IsValid());
+    EXPECT_EQ(query->query->qname(), response->qname());
+  }
+  EXPECT_FALSE(connection.IsIdInUse(0));
+  EXPECT_TRUE(connection.is_usable());
+  EXPECT_TRUE(connection.is_reused());
+
+  // The connection stays open for more queries.
+  SendQueries(&connection, kNumQueries, kNumQueries);
+  WaitForCompletions(2 * kNumQueries);
+  EXPECT_EQ(static_cast<size_t>(2 * kNumQueries), server.num_queries());
+}
+
+TEST_F(DnsTCPConnectionTest, CancelledQueryKeepsIdUntilAnswered) {
+  TestTCPDnsServer server(2);
+  ASSERT_NO_FATAL_FAILURE(server.Start());
+
+  DnsTCPConnection connection(server.CreateClientSocket());
+  SendQueries(&connection, 0, 2);
+  queries_[1]->request.reset();
+  EXPECT_TRUE(connection.IsIdInUse(1));
+
+  WaitForCompletions(1);
+  EXPECT_THAT(queries_[0]->result, IsOk());
+  // The response to the cancelled query is read first, since the server
+  // answers in reverse order, and is dropped.
+  EXPECT_EQ(ERR_IO_PENDING, queries_[1]->result);
+  EXPECT_FALSE(connection.IsIdInUse(1));
+}
+
+// The ID of a cancelled query whose response never comes is not held forever.
+TEST_F(DnsTCPConnectionTest, CancelledQueryIdExpires) {
+  TestTCPDnsServer server(2);
+  ASSERT_NO_FATAL_FAILURE(server.Start());
+
+  DnsTCPConnection connection(server.CreateClientSocket());
+  base::SimpleTestTickClock* clock = new base::SimpleTestTickClock();
+  connection.SetTickClockForTesting(base::WrapUnique(clock));
+  SendQueries(&connection, 0, 1);
+  queries_[0]->request.reset();
+  EXPECT_TRUE(connection.IsIdInUse(0));
+
+  clock->Advance(base::TimeDelta::FromSeconds(10));
+  EXPECT_TRUE(connection.IsIdInUse(0));
+  clock->Advance(base::TimeDelta::FromMinutes(1));
+  EXPECT_FALSE(connection.IsIdInUse(0));
+}
+
+TEST_F(DnsTCPConnectionTest, ServerClosesConnection) {
+  TestTCPDnsServer server(10);
+  server.CloseAfter(3);
+  ASSERT_NO_FATAL_FAILURE(server.Start());
+
+  DnsTCPConnection connection(server.CreateClientSocket());
+  SendQueries(&connection, 0, 3);
+
+  WaitForCompletions(3);
+  for (const auto& query : queries_)
+    EXPECT_THAT(query->result, IsError(ERR_CONNECTION_CLOSED));
+  EXPECT_FALSE(connection.is_usable());
+}
+
+TEST_F(DnsTCPConnectionTest, ConnectFailure) {
+  // Take a free port, then stop listening on it.
+  std::unique_ptr<StreamSocket> socket;
+  {
+    TestTCPDnsServer server(1);
+    ASSERT_NO_FATAL_FAILURE(server.Start());
+    socket = server.CreateClientSocket();
+  }
+
+  DnsTCPConnection connection(std::move(socket));
+  SendQueries(&connection, 0, 2);
+  WaitForCompletions(2);
+  EXPECT_THAT(queries_[0]->result, IsError(ERR_CONNECTION_REFUSED));
+  EXPECT_THAT(queries_[1]->result, IsError(ERR_CONNECTION_REFUSED));
+  EXPECT_FALSE(connection.is_usable());
+}
+
+}  // namespace
+
+}  // namespace net
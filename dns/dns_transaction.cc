@@ -10,7 +10,6 @@
 #include <utility>
 #include <vector>
 
-#include "base/big_endian.h"
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/macros.h"
@@ -18,7 +17,6 @@
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/metrics/histogram_macros.h"
-#include "base/profiler/scoped_tracker.h"
 #include "base/rand_util.h"
 #include "base/single_thread_task_runner.h"
 #include "base/stl_util.h"
@@ -36,6 +34,7 @@
 #include "net/dns/dns_query.h"
 #include "net/dns/dns_response.h"
 #include "net/dns/dns_session.h"
+#include "net/dns/dns_tcp_connection.h"
 #include "net/dns/dns_util.h"
 #include "net/log/net_log.h"
 #include "net/log/net_log_capture_mode.h"
@@ -43,7 +42,6 @@
 #include "net/log/net_log_source.h"
 #include "net/log/net_log_with_source.h"
 #include "net/socket/datagram_client_socket.h"
-#include "net/socket/stream_socket.h"
 
 namespace net {
 
@@ -62,6 +60,10 @@ int CountLabels(const std::string& name) {
   return count;
 }
 
+// How many random IDs a TCP attempt tries before giving up on finding one that
+// is not in use on its connection.
+const int kMaxTCPQueryIdAttempts = 16;
+
 bool IsIPLiteral(const std::string& hostname) {
   IPAddress ip;
   return ip.AssignFromIPLiteral(hostname);
@@ -303,247 +305,116 @@ class DnsUDPAttempt : public DnsAttempt {
   DISALLOW_COPY_AND_ASSIGN(DnsUDPAttempt);
 };
 
+// An attempt over the session's TCP connection to the server, which it may
+// share with other attempts.
 class DnsTCPAttempt : public DnsAttempt {
  public:
-  DnsTCPAttempt(unsigned server_index,
-                std::unique_ptr<StreamSocket> socket,
+  DnsTCPAttempt(DnsSession* session,
+                unsigned server_index,
+                const NetLogSource& source,
                 std::unique_ptr<DnsQuery> query)
       : DnsAttempt(server_index),
-        next_state_(STATE_NONE),
-        socket_(std::move(socket)),
+        session_(session),
+        source_(source),
         query_(std::move(query)),
-        length_buffer_(new IOBufferWithSize(sizeof(uint16_t))),
-        response_length_(0) {}
+        connection_(session_->GetTCPConnection(server_index, source_)),
+        net_log_(connection_->net_log()),
+        reused_connection_(false),
+        retried_(false) {}
 
   // DnsAttempt:
   int Start(const CompletionCallback& callback) override {
-    DCHECK_EQ(STATE_NONE, next_state_);
+    DCHECK(callback_.is_null());
     callback_ = callback;
     start_time_ = base::TimeTicks::Now();
-    next_state_ = STATE_CONNECT_COMPLETE;
-    int rv = socket_->Connect(base::Bind(&DnsTCPAttempt::OnIOComplete,
-                                         base::Unretained(this)));
-    if (rv == ERR_IO_PENDING) {
-      set_result(rv);
-      return rv;
-    }
-    return DoLoop(rv);
+    int rv = SendQuery();
+    set_result(rv);
+    return rv;
   }
 
   const DnsQuery* GetQuery() const override { return query_.get(); }
 
   const DnsResponse* GetResponse() const override {
-    const DnsResponse* resp = response_.get();
+    const DnsResponse* resp = request_ ? request_->response() : NULL;
     return (resp != NULL && resp->IsValid()) ? resp : NULL;
   }
 
-  const NetLogWithSource& GetSocketNetLog() const override {
-    return socket_->NetLog();
-  }
+  const NetLogWithSource& GetSocketNetLog() const override { return net_log_; }
 
  private:
-  enum State {
-    STATE_CONNECT_COMPLETE,
-    STATE_SEND_LENGTH,
-    STATE_SEND_QUERY,
-    STATE_READ_LENGTH,
-    STATE_READ_LENGTH_COMPLETE,
-    STATE_READ_RESPONSE,
-    STATE_READ_RESPONSE_COMPLETE,
-    STATE_NONE,
-  };
-
-  int DoLoop(int result) {
-    CHECK_NE(STATE_NONE, next_state_);
-    int rv = result;
-    do {
-      State state = next_state_;
-      next_state_ = STATE_NONE;
-      switch (state) {
-        case STATE_CONNECT_COMPLETE:
-          rv = DoConnectComplete(rv);
-          break;
-        case STATE_SEND_LENGTH:
-          rv = DoSendLength(rv);
-          break;
-        case STATE_SEND_QUERY:
-          rv = DoSendQuery(rv);
-          break;
-        case STATE_READ_LENGTH:
-          rv = DoReadLength(rv);
-          break;
-        case STATE_READ_LENGTH_COMPLETE:
-          rv = DoReadLengthComplete(rv);
-          break;
-        case STATE_READ_RESPONSE:
-          rv = DoReadResponse(rv);
-          break;
-        case STATE_READ_RESPONSE_COMPLETE:
-          rv = DoReadResponseComplete(rv);
-          break;
-        default:
-          NOTREACHED();
-          break;
-      }
-    } while (rv != ERR_IO_PENDING && next_state_ != STATE_NONE);
+  // Returns ERR_IO_PENDING once the query is sent, or an error if no ID
+  // which is free on the connection was found for it.
+  int SendQuery() {
+    DnsTCPConnection* connection = connection_;
+    connection_ = NULL;
+    // Other queries on the connection may use the same ID.
+    for (int i = 0; connection->IsIdInUse(query_->id()); ++i) {
+      if (i == kMaxTCPQueryIdAttempts)
+        return ERR_INSUFFICIENT_RESOURCES;
+      query_ = query_->CloneWithNewId(session_->NextQueryId());
+    }
+    reused_connection_ = connection->is_reused();
+    request_ = connection->SendQuery(
+        query_.get(),
+        base::Bind(&DnsTCPAttempt::OnQueryComplete, base::Unretained(this)));
+    return ERR_IO_PENDING;
+  }
+
+  void OnQueryComplete(int rv) {
+    // The server may have closed the connection as idle just as the query
+    // was sent.  Try once more on a new connection.
+    if (reused_connection_ && !retried_ &&
+        (rv == ERR_CONNECTION_CLOSED || rv == ERR_CONNECTION_RESET ||
+         rv == ERR_CONNECTION_ABORTED)) {
+      retried_ = true;
+      request_.reset();
+      connection_ = session_->GetTCPConnection(server_index(), source_);
+      net_log_ = connection_->net_log();
+      rv = SendQuery();
+      if (rv == ERR_IO_PENDING)
+        return;
+    }
 
+    rv = InterpretResponse(rv);
     set_result(rv);
     if (rv == OK) {
-      DCHECK_EQ(STATE_NONE, next_state_);
       DNS_HISTOGRAM("AsyncDNS.TCPAttemptSuccess",
                     base::TimeTicks::Now() - start_time_);
-    } else if (rv != ERR_IO_PENDING) {
+    } else {
       DNS_HISTOGRAM("AsyncDNS.TCPAttemptFail",
                     base::TimeTicks::Now() - start_time_);
     }
-    return rv;
-  }
-
-  int DoConnectComplete(int rv) {
-    // TODO(rvargas): Remove ScopedTracker below once crbug.com/462784 is fixed.
-    tracked_objects::ScopedTracker tracking_profile(
-        FROM_HERE_WITH_EXPLICIT_FUNCTION(
-            "462784 DnsTCPAttempt::DoConnectComplete"));
-
-    DCHECK_NE(ERR_IO_PENDING, rv);
-    if (rv < 0)
-      return rv;
-
-    uint16_t query_size = static_cast<uint16_t>(query_->io_buffer()->size());
-    if (static_cast<int>(query_size) != query_->io_buffer()->size())
-      return ERR_FAILED;
-    base::WriteBigEndian<uint16_t>(length_buffer_->data(), query_size);
-    buffer_ =
-        new DrainableIOBuffer(length_buffer_.get(), length_buffer_->size());
-    next_state_ = STATE_SEND_LENGTH;
-    return OK;
-  }
-
-  int DoSendLength(int rv) {
-    DCHECK_NE(ERR_IO_PENDING, rv);
-    if (rv < 0)
-      return rv;
-
-    buffer_->DidConsume(rv);
-    if (buffer_->BytesRemaining() > 0) {
-      next_state_ = STATE_SEND_LENGTH;
-      return socket_->Write(
-          buffer_.get(),
-          buffer_->BytesRemaining(),
-          base::Bind(&DnsTCPAttempt::OnIOComplete, base::Unretained(this)));
-    }
-    buffer_ = new DrainableIOBuffer(query_->io_buffer(),
-                                    query_->io_buffer()->size());
-    next_state_ = STATE_SEND_QUERY;
-    return OK;
-  }
-
-  int DoSendQuery(int rv) {
-    DCHECK_NE(ERR_IO_PENDING, rv);
-    if (rv < 0)
-      return rv;
-
-    buffer_->DidConsume(rv);
-    if (buffer_->BytesRemaining() > 0) {
-      next_state_ = STATE_SEND_QUERY;
-      return socket_->Write(
-          buffer_.get(),
-          buffer_->BytesRemaining(),
-          base::Bind(&DnsTCPAttempt::OnIOComplete, base::Unretained(this)));
-    }
-    buffer_ =
-        new DrainableIOBuffer(length_buffer_.get(), length_buffer_->size());
-    next_state_ = STATE_READ_LENGTH;
-    return OK;
-  }
-
-  int DoReadLength(int rv) {
-    DCHECK_EQ(OK, rv);
-
-    next_state_ = STATE_READ_LENGTH_COMPLETE;
-    return ReadIntoBuffer();
+    callback_.Run(rv);
   }
 
-  int DoReadLengthComplete(int rv) {
-    DCHECK_NE(ERR_IO_PENDING, rv);
+  int InterpretResponse(int rv) {
     if (rv < 0)
       return rv;
-    if (rv == 0)
-      return ERR_CONNECTION_CLOSED;
-
-    buffer_->DidConsume(rv);
-    if (buffer_->BytesRemaining() > 0) {
-      next_state_ = STATE_READ_LENGTH;
-      return OK;
-    }
-
-    base::ReadBigEndian<uint16_t>(length_buffer_->data(), &response_length_);
-    // Check if advertised response is too short. (Optimization only.)
-    if (response_length_ < query_->io_buffer()->size())
-      return ERR_DNS_MALFORMED_RESPONSE;
-    // Allocate more space so that DnsResponse::InitParse sanity check passes.
-    response_.reset(new DnsResponse(response_length_ + 1));
-    buffer_ = new DrainableIOBuffer(response_->io_buffer(), response_length_);
-    next_state_ = STATE_READ_RESPONSE;
-    return OK;
-  }
-
-  int DoReadResponse(int rv) {
-    DCHECK_EQ(OK, rv);
-
-    next_state_ = STATE_READ_RESPONSE_COMPLETE;
-    return ReadIntoBuffer();
-  }
-
-  int DoReadResponseComplete(int rv) {
-    DCHECK_NE(ERR_IO_PENDING, rv);
-    if (rv < 0)
-      return rv;
-    if (rv == 0)
-      return ERR_CONNECTION_CLOSED;
-
-    buffer_->DidConsume(rv);
-    if (buffer_->BytesRemaining() > 0) {
-      next_state_ = STATE_READ_RESPONSE;
-      return OK;
-    }
-
-    if (!response_->InitParse(buffer_->BytesConsumed(), *query_))
-      return ERR_DNS_MALFORMED_RESPONSE;
-    if (response_->flags() & dns_protocol::kFlagTC)
+    const DnsResponse* response = GetResponse();
+    DCHECK(response);
+    if (response->flags() & dns_protocol::kFlagTC)
       return ERR_UNEXPECTED;
     // TODO(szym): Frankly, none of these are expected.
-    if (response_->rcode() == dns_protocol::kRcodeNXDOMAIN)
+    if (response->rcode() == dns_protocol::kRcodeNXDOMAIN)
       return ERR_NAME_NOT_RESOLVED;
-    if (response_->rcode() != dns_protocol::kRcodeNOERROR)
+    if (response->rcode() != dns_protocol::kRcodeNOERROR)
       return ERR_DNS_SERVER_FAILED;
 
     return OK;
   }
 
-  void OnIOComplete(int rv) {
-    rv = DoLoop(rv);
-    if (rv != ERR_IO_PENDING)
-      callback_.Run(rv);
-  }
+  DnsSession* session_;
+  NetLogSource source_;
+  std::unique_ptr<DnsQuery> query_;
 
-  int ReadIntoBuffer() {
-    return socket_->Read(
-        buffer_.get(),
-        buffer_->BytesRemaining(),
-        base::Bind(&DnsTCPAttempt::OnIOComplete, base::Unretained(this)));
-  }
+  // Only set until the query is sent.
+  DnsTCPConnection* connection_;
+  NetLogWithSource net_log_;
+  bool reused_connection_;
+  bool retried_;
 
-  State next_state_;
   base::TimeTicks start_time_;
-
-  std::unique_ptr<StreamSocket> socket_;
-  std::unique_ptr<DnsQuery> query_;
-  scoped_refptr<IOBufferWithSize> length_buffer_;
-  scoped_refptr<DrainableIOBuffer> buffer_;
-
-  uint16_t response_length_;
-  std::unique_ptr<DnsResponse> response_;
+  std::unique_ptr<DnsTCPConnection::Request> request_;
 
   CompletionCallback callback_;
 
@@ -726,26 +597,37 @@ class DnsTransactionImpl : public DnsTransaction,
     // Skip over known failed servers.
     server_index = session_->NextGoodServerIndex(server_index);
 
-    std::unique_ptr<DnsSession::SocketLease> lease =
-        session_->AllocateSocket(server_index, net_log_.source());
-
-    bool got_socket = !!lease.get();
-
-    DnsUDPAttempt* attempt =
-        new DnsUDPAttempt(server_index, std::move(lease), std::move(query));
+    // Configurations which use TCP from the start retry over TCP like they
+    // would over UDP, unlike the fallback after a truncated response.
+    DnsAttempt* attempt;
+    NetLogEventType event_type;
+    if (config.use_tcp) {
+      attempt = new DnsTCPAttempt(session_.get(), server_index,
+                                  net_log_.source(), std::move(query));
+      event_type = NetLogEventType::DNS_TRANSACTION_TCP_ATTEMPT;
+    } else {
+      std::unique_ptr<DnsSession::SocketLease> lease =
+          session_->AllocateSocket(server_index, net_log_.source());
+      bool got_socket = !!lease.get();
+      attempt =
+          new DnsUDPAttempt(server_index, std::move(lease), std::move(query));
+      if (!got_socket) {
+        attempts_.push_back(base::WrapUnique(attempt));
+        ++attempts_count_;
+        return AttemptResult(ERR_CONNECTION_REFUSED, NULL);
+      }
+      event_type = NetLogEventType::DNS_TRANSACTION_ATTEMPT;
+    }
 
     attempts_.push_back(base::WrapUnique(attempt));
     ++attempts_count_;
 
-    if (!got_socket)
-      return AttemptResult(ERR_CONNECTION_REFUSED, NULL);
-
     net_log_.AddEvent(
-        NetLogEventType::DNS_TRANSACTION_ATTEMPT,
+        event_type,
         attempt->GetSocketNetLog().source().ToEventParametersCallback());
 
     int rv = attempt->Start(
-        base::Bind(&DnsTransactionImpl::OnUdpAttemptComplete,
+        base::Bind(&DnsTransactionImpl::OnPrimaryAttemptComplete,
                    base::Unretained(this), attempt_number,
                    base::TimeTicks::Now()));
     if (rv == ERR_IO_PENDING) {
@@ -762,9 +644,6 @@ class DnsTransactionImpl : public DnsTransaction,
 
     unsigned server_index = previous_attempt->server_index();
 
-    std::unique_ptr<StreamSocket> socket(
-        session_->CreateTCPSocket(server_index, net_log_.source()));
-
     // TODO(szym): Reuse the same id to help the server?
     uint16_t id = session_->NextQueryId();
     std::unique_ptr<DnsQuery> query =
@@ -776,8 +655,8 @@ class DnsTransactionImpl : public DnsTransaction,
 
     unsigned attempt_number = attempts_.size();
 
-    DnsTCPAttempt* attempt =
-        new DnsTCPAttempt(server_index, std::move(socket), std::move(query));
+    DnsTCPAttempt* attempt = new DnsTCPAttempt(
+        session_.get(), server_index, net_log_.source(), std::move(query));
 
     attempts_.push_back(base::WrapUnique(attempt));
     ++attempts_count_;
@@ -811,9 +690,11 @@ class DnsTransactionImpl : public DnsTransaction,
     return MakeAttempt();
   }
 
-  void OnUdpAttemptComplete(unsigned attempt_number,
-                            base::TimeTicks start,
-                            int rv) {
+  // Called for attempts made by MakeAttempt(), whose round trip times feed
+  // the timeouts of later attempts.
+  void OnPrimaryAttemptComplete(unsigned attempt_number,
+                                base::TimeTicks start,
+                                int rv) {
     DCHECK_LT(attempt_number, attempts_.size());
     const DnsAttempt* attempt = attempts_[attempt_number].get();
     if (attempt->GetResponse()) {
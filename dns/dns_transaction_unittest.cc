@@ -55,21 +55,24 @@ class DnsSocketData {
                 bool use_tcp)
       : query_(new DnsQuery(id, DomainFromDot(dotted_name), qtype)),
         use_tcp_(use_tcp) {
-    if (use_tcp_) {
-      std::unique_ptr<uint16_t> length(new uint16_t);
-      *length = base::HostToNet16(query_->io_buffer()->size());
-      writes_.push_back(MockWrite(mode,
-                                  reinterpret_cast<const char*>(length.get()),
-                                  sizeof(uint16_t), num_reads_and_writes()));
-      lengths_.push_back(std::move(length));
-    }
-    writes_.push_back(MockWrite(mode, query_->io_buffer()->data(),
-                                query_->io_buffer()->size(),
-                                num_reads_and_writes()));
+    AddWrite(query_.get(), mode);
   }
   ~DnsSocketData() {}
 
-  // All responses must be added before GetProvider.
+  // All queries and responses must be added before GetProvider.
+
+  // Adds another query sent on the same connection. TCP mode only.
+  void AddQuery(uint16_t id,
+                const char* dotted_name,
+                uint16_t qtype,
+                IoMode mode) {
+    CHECK(!provider_.get());
+    CHECK(use_tcp_);
+    std::unique_ptr<DnsQuery> query(
+        new DnsQuery(id, DomainFromDot(dotted_name), qtype));
+    AddWrite(query.get(), mode);
+    extra_queries_.push_back(std::move(query));
+  }
 
   // Adds pre-built DnsResponse. |tcp_length| will be used in TCP mode only.
   void AddResponseWithLength(std::unique_ptr<DnsResponse> response,
@@ -141,7 +144,22 @@ class DnsSocketData {
  private:
   size_t num_reads_and_writes() const { return reads_.size() + writes_.size(); }
 
+  void AddWrite(const DnsQuery* query, IoMode mode) {
+    if (use_tcp_) {
+      std::unique_ptr<uint16_t> length(new uint16_t);
+      *length = base::HostToNet16(query->io_buffer()->size());
+      writes_.push_back(MockWrite(mode,
+                                  reinterpret_cast<const char*>(length.get()),
+                                  sizeof(uint16_t), num_reads_and_writes()));
+      lengths_.push_back(std::move(length));
+    }
+    writes_.push_back(MockWrite(mode, query->io_buffer()->data(),
+                                query->io_buffer()->size(),
+                                num_reads_and_writes()));
+  }
+
   std::unique_ptr<DnsQuery> query_;
+  std::vector<std::unique_ptr<DnsQuery>> extra_queries_;
   bool use_tcp_;
   std::vector<std::unique_ptr<uint16_t>> lengths_;
   std::vector<std::unique_ptr<DnsResponse>> responses_;
@@ -994,6 +1012,55 @@ TEST_F(DnsTransactionTest, TCPConnectionClosedSynchronous) {
   EXPECT_TRUE(helper0.Run(transaction_factory_.get()));
 }
 
+TEST_F(DnsTransactionTest, TCPPipelinedLookups) {
+  config_.use_tcp = true;
+  ConfigureFactory();
+  // Both queries are written before either response is read, and the server
+  // answers the second one first.
+  std::unique_ptr<DnsSocketData> data(
+      new DnsSocketData(0 /* id */, kT0HostName, kT0Qtype, ASYNC, true));
+  data->AddQuery(1 /* id */, kT1HostName, kT1Qtype, ASYNC);
+  data->AddResponseData(kT1ResponseDatagram, arraysize(kT1ResponseDatagram),
+                        ASYNC);
+  data->AddResponseData(kT0ResponseDatagram, arraysize(kT0ResponseDatagram),
+                        ASYNC);
+  AddSocketData(std::move(data));
+  transaction_ids_.push_back(1);
+
+  TransactionHelper helper0(kT0HostName, kT0Qtype, kT0RecordCount);
+  TransactionHelper helper1(kT1HostName, kT1Qtype, kT1RecordCount);
+  helper0.StartTransaction(transaction_factory_.get());
+  helper1.StartTransaction(transaction_factory_.get());
+
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_TRUE(helper0.has_completed());
+  EXPECT_TRUE(helper1.has_completed());
+}
+
+TEST_F(DnsTransactionTest, TCPReusedConnectionClosed) {
+  config_.use_tcp = true;
+  ConfigureFactory();
+  // The server closes the connection after the first lookup, just as the
+  // second query is sent on it.
+  std::unique_ptr<DnsSocketData> data(
+      new DnsSocketData(0 /* id */, kT0HostName, kT0Qtype, ASYNC, true));
+  data->AddResponseData(kT0ResponseDatagram, arraysize(kT0ResponseDatagram),
+                        ASYNC);
+  data->AddQuery(1 /* id */, kT1HostName, kT1Qtype, ASYNC);
+  data->AddReadError(0, ASYNC);
+  AddSocketData(std::move(data));
+  // The query is sent again on a new connection.
+  AddQueryAndResponse(1 /* id */, kT1HostName, kT1Qtype, kT1ResponseDatagram,
+                      arraysize(kT1ResponseDatagram), ASYNC,
+                      true /* use_tcp */);
+
+  TransactionHelper helper0(kT0HostName, kT0Qtype, kT0RecordCount);
+  EXPECT_TRUE(helper0.Run(transaction_factory_.get()));
+  TransactionHelper helper1(kT1HostName, kT1Qtype, kT1RecordCount);
+  EXPECT_TRUE(helper1.Run(transaction_factory_.get()));
+}
+
 TEST_F(DnsTransactionTest, InvalidQuery) {
   config_.timeout = TestTimeouts::tiny_timeout();
   ConfigureFactory();
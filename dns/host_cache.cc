@@ -4,12 +4,20 @@
 
 #include "net/dns/host_cache.h"
 
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+
 #include "base/logging.h"
 #include "base/memory/ptr_util.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/pickle.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/trace_event/trace_event.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
 #include "net/base/trace_constants.h"
 #include "net/dns/dns_util.h"
@@ -27,8 +35,48 @@ namespace {
 #define CACHE_HISTOGRAM_ENUM(name, value, max) \
   UMA_HISTOGRAM_ENUMERATION("DNS.HostCache." name, value, max)
 
+// Number of least recently used entries EvictOneEntry() chooses from.
+const size_t kMaxEvictionCandidates = 16;
+
+// A snapshot is a base::Pickle holding:
+//   int32 version, int64 wall clock time (internal value), uint32 count,
+// then for each entry:
+//   string hostname, int32 address family, int32 host resolver flags,
+//   int32 error, int64 TTL in microseconds, int64 microseconds to expiry,
+//   int32 network changes since the entry was set, string canonical name,
+//   uint32 address count, and the bytes and uint16 port of each address.
+// Bump the version when changing the format; older snapshots are ignored.
+const int kSnapshotVersion = 1;
+
+bool ReadSnapshotAddresses(base::PickleIterator* iter,
+                           AddressList* addresses) {
+  std::string canonical_name;
+  uint32_t count;
+  if (!iter->ReadString(&canonical_name) || !iter->ReadUInt32(&count))
+    return false;
+  addresses->set_canonical_name(canonical_name);
+  for (uint32_t i = 0; i < count; ++i) {
+    const char* bytes;
+    int length;
+    uint16_t port;
+    if (!iter->ReadData(&bytes, &length) || !iter->ReadUInt16(&port))
+      return false;
+    IPAddress address(reinterpret_cast<const uint8_t*>(bytes), length);
+    if (!address.IsValid())
+      return false;
+    addresses->push_back(IPEndPoint(address, port));
+  }
+  return true;
+}
+
 }  // namespace
 
+size_t HostCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = std::hash<std::string>()(key.hostname);
+  hash = hash * 31 + static_cast<size_t>(key.address_family);
+  return hash * 31 + static_cast<size_t>(key.host_resolver_flags);
+}
+
 // Used in histograms; do not modify existing values.
 enum HostCache::SetOutcome : int {
   SET_INSERT = 0,
@@ -103,8 +151,12 @@ void HostCache::Entry::GetStaleness(base::TimeTicks now,
   out->stale_hits = stale_hits_;
 }
 
+HostCache::Shard::Shard() {}
+
+HostCache::Shard::~Shard() {}
+
 HostCache::HostCache(size_t max_entries)
-    : max_entries_(max_entries), network_changes_(0) {}
+    : size_(0), max_entries_(max_entries), network_changes_(0) {}
 
 HostCache::~HostCache() {
   RecordEraseAll(ERASE_DESTRUCT, base::TimeTicks::Now());
@@ -126,7 +178,11 @@ const HostCache::Entry* HostCache::Lookup(const Key& key,
     return nullptr;
   }
 
-  entry->CountHit(/* hit_is_stale= */ false);
+  {
+    base::AutoLock lock(GetShard(key)->lock);
+    entry->CountHit(/* hit_is_stale= */ false);
+  }
+  Touch(entry);
   RecordLookup(LOOKUP_HIT_VALID, now, entry);
   return entry;
 }
@@ -146,7 +202,11 @@ const HostCache::Entry* HostCache::LookupStale(
   }
 
   bool is_stale = entry->IsStale(now, network_changes_);
-  entry->CountHit(/* hit_is_stale= */ is_stale);
+  {
+    base::AutoLock lock(GetShard(key)->lock);
+    entry->CountHit(/* hit_is_stale= */ is_stale);
+  }
+  Touch(entry);
   RecordLookup(is_stale ? LOOKUP_HIT_STALE : LOOKUP_HIT_VALID, now, entry);
 
   if (stale_out)
@@ -154,9 +214,49 @@ const HostCache::Entry* HostCache::LookupStale(
   return entry;
 }
 
+base::Optional<HostCache::Entry> HostCache::LookupFromAnyThread(
+    const Key& key,
+    base::TimeTicks now) const {
+  if (caching_is_disabled())
+    return base::nullopt;
+
+  const Shard* shard = GetShard(key);
+  base::AutoLock lock(shard->lock);
+  auto it = shard->entries.find(key);
+  if (it == shard->entries.end() ||
+      it->second.IsStale(now, base::subtle::Acquire_Load(&network_changes_))) {
+    return base::nullopt;
+  }
+  return it->second;
+}
+
+HostCache::Shard* HostCache::GetShard(const Key& key) {
+  return &shards_[KeyHash()(key) % kNumShards];
+}
+
+const HostCache::Shard* HostCache::GetShard(const Key& key) const {
+  return &shards_[KeyHash()(key) % kNumShards];
+}
+
 HostCache::Entry* HostCache::LookupInternal(const Key& key) {
-  auto it = entries_.find(key);
-  return (it != entries_.end()) ? &it->second : nullptr;
+  // Only the owning thread modifies the shards, so it can read them without
+  // the lock.
+  Shard* shard = GetShard(key);
+  auto it = shard->entries.find(key);
+  return (it != shard->entries.end()) ? &it->second : nullptr;
+}
+
+void HostCache::Touch(Entry* entry) {
+  lru_list_.splice(lru_list_.end(), lru_list_, entry->lru_position_);
+}
+
+void HostCache::Erase(Shard* shard, EntryMap::iterator it) {
+  lru_list_.erase(it->second.lru_position_);
+  {
+    base::AutoLock lock(shard->lock);
+    shard->entries.erase(it);
+  }
+  --size_;
 }
 
 void HostCache::Set(const Key& key,
@@ -168,14 +268,15 @@ void HostCache::Set(const Key& key,
   if (caching_is_disabled())
     return;
 
-  auto it = entries_.find(key);
-  if (it != entries_.end()) {
+  Shard* shard = GetShard(key);
+  auto it = shard->entries.find(key);
+  if (it != shard->entries.end()) {
     bool is_stale = it->second.IsStale(now, network_changes_);
     RecordSet(is_stale ? SET_UPDATE_STALE : SET_UPDATE_VALID, now, &it->second,
               entry);
     // TODO(juliatuttle): Remember some old metadata (hit count or frequency or
     // something like that) if it's useful for better eviction algorithms?
-    entries_.erase(it);
+    Erase(shard, it);
   } else {
     if (size() == max_entries_)
       EvictOneEntry(now);
@@ -183,20 +284,127 @@ void HostCache::Set(const Key& key,
   }
 
   DCHECK_GT(max_entries_, size());
-  DCHECK_EQ(0u, entries_.count(key));
-  entries_.insert(
-      std::make_pair(Key(key), Entry(entry, now, ttl, network_changes_)));
+  AddEntry(key, Entry(entry, now, ttl, network_changes_), lru_list_.end());
   DCHECK_GE(max_entries_, size());
 }
 
+void HostCache::AddEntry(const Key& key,
+                         const Entry& entry,
+                         std::list<const Key*>::iterator lru_position) {
+  Shard* shard = GetShard(key);
+  DCHECK_EQ(0u, shard->entries.count(key));
+  {
+    base::AutoLock lock(shard->lock);
+    auto it = shard->entries.insert(std::make_pair(key, entry)).first;
+    it->second.lru_position_ = lru_list_.insert(lru_position, &it->first);
+  }
+  ++size_;
+}
+
 void HostCache::OnNetworkChange() {
-  ++network_changes_;
+  base::subtle::Barrier_AtomicIncrement(&network_changes_, 1);
+}
+
+void HostCache::WriteSnapshot(base::TimeTicks now,
+                              base::Time now_wall,
+                              base::Pickle* pickle) const {
+  DCHECK(CalledOnValidThread());
+  pickle->WriteInt(kSnapshotVersion);
+  pickle->WriteInt64(now_wall.ToInternalValue());
+  pickle->WriteUInt32(static_cast<uint32_t>(size_));
+  for (auto it = lru_list_.rbegin(); it != lru_list_.rend(); ++it) {
+    const Key& key = **it;
+    const Entry& entry = GetShard(key)->entries.find(key)->second;
+    pickle->WriteString(key.hostname);
+    pickle->WriteInt(key.address_family);
+    pickle->WriteInt(key.host_resolver_flags);
+    pickle->WriteInt(entry.error());
+    pickle->WriteInt64(entry.ttl().InMicroseconds());
+    pickle->WriteInt64((entry.expires() - now).InMicroseconds());
+    pickle->WriteInt(network_changes_ - entry.network_changes());
+    pickle->WriteString(entry.addresses().canonical_name());
+    pickle->WriteUInt32(static_cast<uint32_t>(entry.addresses().size()));
+    for (const IPEndPoint& endpoint : entry.addresses()) {
+      const std::vector<uint8_t>& bytes = endpoint.address().bytes();
+      pickle->WriteData(reinterpret_cast<const char*>(bytes.data()),
+                        static_cast<int>(bytes.size()));
+      pickle->WriteUInt16(endpoint.port());
+    }
+  }
+}
+
+bool HostCache::RestoreFromSnapshot(const char* data,
+                                    size_t size,
+                                    base::TimeTicks now,
+                                    base::Time now_wall) {
+  DCHECK(CalledOnValidThread());
+  if (caching_is_disabled())
+    return true;
+
+  // Reads |data| in place, so a memory-mapped snapshot is never copied.
+  base::Pickle pickle(data, static_cast<int>(size));
+  base::PickleIterator iter(pickle);
+  int version;
+  int64_t written_wall;
+  uint32_t count;
+  if (!iter.ReadInt(&version) || version != kSnapshotVersion ||
+      !iter.ReadInt64(&written_wall) || !iter.ReadUInt32(&count)) {
+    return false;
+  }
+  // Expiry times move back by the time since the snapshot was written.  If
+  // the clock went backwards, trust the snapshot.
+  base::TimeDelta age = std::max(
+      base::TimeDelta(), now_wall - base::Time::FromInternalValue(written_wall));
+
+  // Entries are written most recently used first, so each one goes in front
+  // of the previous one, and all of them in front of the existing entries.
+  auto lru_position = lru_list_.begin();
+  for (uint32_t i = 0; i < count && size_ < max_entries_; ++i) {
+    std::string hostname;
+    int address_family;
+    int host_resolver_flags;
+    int error;
+    int64_t ttl_us;
+    int64_t expires_in_us;
+    int network_changes;
+    AddressList addresses;
+    if (!iter.ReadString(&hostname) || !iter.ReadInt(&address_family) ||
+        address_family < 0 || address_family > ADDRESS_FAMILY_LAST ||
+        !iter.ReadInt(&host_resolver_flags) || !iter.ReadInt(&error) ||
+        !iter.ReadInt64(&ttl_us) || !iter.ReadInt64(&expires_in_us) ||
+        !iter.ReadInt(&network_changes) || network_changes < 0 ||
+        !ReadSnapshotAddresses(&iter, &addresses)) {
+      return false;
+    }
+
+    Key key(hostname, static_cast<AddressFamily>(address_family),
+            host_resolver_flags);
+    if (GetShard(key)->entries.count(key))
+      continue;
+    base::TimeDelta ttl = base::TimeDelta::FromMicroseconds(ttl_us);
+    Entry entry = ttl >= base::TimeDelta() ? Entry(error, addresses, ttl)
+                                           : Entry(error, addresses);
+    base::TimeDelta expires_in =
+        base::TimeDelta::FromMicroseconds(expires_in_us) - age;
+    // One more network change for the restart.
+    AddEntry(key,
+             Entry(entry, now, expires_in,
+                   network_changes_ - network_changes - 1),
+             lru_position);
+    lru_position = std::prev(lru_position);
+  }
+  return true;
 }
 
 void HostCache::clear() {
   DCHECK(CalledOnValidThread());
   RecordEraseAll(ERASE_CLEAR, base::TimeTicks::Now());
-  entries_.clear();
+  for (Shard& shard : shards_) {
+    base::AutoLock lock(shard.lock);
+    shard.entries.clear();
+  }
+  lru_list_.clear();
+  size_ = 0;
 }
 
 void HostCache::ClearForHosts(
@@ -209,21 +417,24 @@ void HostCache::ClearForHosts(
   }
 
   base::TimeTicks now = base::TimeTicks::Now();
-  for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
-    EntryMap::iterator next_it = std::next(it);
+  for (Shard& shard : shards_) {
+    for (EntryMap::iterator it = shard.entries.begin();
+         it != shard.entries.end();) {
+      EntryMap::iterator next_it = std::next(it);
+
+      if (host_filter.Run(it->first.hostname)) {
+        RecordErase(ERASE_CLEAR, now, it->second);
+        Erase(&shard, it);
+      }
 
-    if (host_filter.Run(it->first.hostname)) {
-      RecordErase(ERASE_CLEAR, now, it->second);
-      entries_.erase(it);
+      it = next_it;
     }
-
-    it = next_it;
   }
 }
 
 size_t HostCache::size() const {
   DCHECK(CalledOnValidThread());
-  return entries_.size();
+  return size_;
 }
 
 size_t HostCache::max_entries() const {
@@ -231,6 +442,21 @@ size_t HostCache::max_entries() const {
   return max_entries_;
 }
 
+HostCache::EntryList HostCache::GetEntries() const {
+  DCHECK(CalledOnValidThread());
+  EntryList entries;
+  entries.reserve(size_);
+  for (const Shard& shard : shards_) {
+    for (const auto& pair : shard.entries)
+      entries.push_back(pair);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const EntryList::value_type& a, const EntryList::value_type& b) {
+              return a.first < b.first;
+            });
+  return entries;
+}
+
 // static
 std::unique_ptr<HostCache> HostCache::CreateDefaultCache() {
 // Cache capacity is determined by the field trial.
@@ -249,21 +475,29 @@ std::unique_ptr<HostCache> HostCache::CreateDefaultCache() {
 }
 
 void HostCache::EvictOneEntry(base::TimeTicks now) {
-  DCHECK_LT(0u, entries_.size());
-
-  auto oldest_it = entries_.begin();
-  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
-    if ((it->second.expires() < oldest_it->second.expires()) &&
-        (it->second.IsStale(now, network_changes_) ||
-         !oldest_it->second.IsStale(now, network_changes_))) {
-      oldest_it = it;
+  DCHECK_LT(0u, size());
+
+  auto lru_it = lru_list_.begin();
+  const Key* oldest_key = *lru_it;
+  const Entry* oldest = LookupInternal(*oldest_key);
+  for (size_t i = 1; i < kMaxEvictionCandidates; ++i) {
+    if (++lru_it == lru_list_.end())
+      break;
+    const Entry* entry = LookupInternal(**lru_it);
+    if ((entry->expires() < oldest->expires()) &&
+        (entry->IsStale(now, network_changes_) ||
+         !oldest->IsStale(now, network_changes_))) {
+      oldest_key = *lru_it;
+      oldest = entry;
     }
   }
 
+  Shard* shard = GetShard(*oldest_key);
+  auto oldest_it = shard->entries.find(*oldest_key);
   if (!eviction_callback_.is_null())
     eviction_callback_.Run(oldest_it->first, oldest_it->second);
   RecordErase(ERASE_EVICT, now, oldest_it->second);
-  entries_.erase(oldest_it);
+  Erase(shard, oldest_it);
 }
 
 void HostCache::RecordSet(SetOutcome outcome,
@@ -363,8 +597,10 @@ void HostCache::RecordErase(EraseReason reason,
 }
 
 void HostCache::RecordEraseAll(EraseReason reason, base::TimeTicks now) {
-  for (const auto& it : entries_)
-    RecordErase(reason, now, it.second);
+  for (const Shard& shard : shards_) {
+    for (const auto& it : shard.entries)
+      RecordErase(reason, now, it.second);
+  }
 }
 
 }  // namespace net
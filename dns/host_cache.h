@@ -8,12 +8,19 @@
 #include <stddef.h>
 
 #include <functional>
+#include <list>
 #include <memory>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "base/atomicops.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
+#include "base/optional.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/non_thread_safe.h"
 #include "base/time/time.h"
 #include "net/base/address_family.h"
@@ -22,9 +29,18 @@
 #include "net/base/net_export.h"
 #include "net/dns/dns_util.h"
 
+namespace base {
+class Pickle;
+}
+
 namespace net {
 
 // Cache used by HostResolver to map hostnames to their resolved result.
+//
+// The cache is owned and modified by a single thread, but
+// LookupFromAnyThread() may be called from any thread.  Entries are spread
+// over hash-table shards, each guarded by its own lock which the owning thread
+// only takes to modify the shard.
 class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
  public:
   struct Key {
@@ -44,11 +60,21 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
                       other.hostname);
     }
 
+    bool operator==(const Key& other) const {
+      return address_family == other.address_family &&
+             host_resolver_flags == other.host_resolver_flags &&
+             hostname == other.hostname;
+    }
+
     std::string hostname;
     AddressFamily address_family;
     HostResolverFlags host_resolver_flags;
   };
 
+  struct NET_EXPORT KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
   struct NET_EXPORT EntryStaleness {
     // Time since the entry's TTL has expired. Negative if not expired.
     base::TimeDelta expired_by;
@@ -110,9 +136,12 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
     int network_changes_;
     int total_hits_;
     int stale_hits_;
+    // Position in the cache's |lru_list_|.
+    std::list<const Key*>::iterator lru_position_;
   };
 
-  using EntryMap = std::map<Key, Entry>;
+  using EntryMap = std::unordered_map<Key, Entry, KeyHash>;
+  using EntryList = std::vector<std::pair<Key, Entry>>;
   using EvictionCallback = base::Callback<void(const Key&, const Entry&)>;
 
   // Constructs a HostCache that stores up to |max_entries|.
@@ -131,6 +160,15 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
                            base::TimeTicks now,
                            EntryStaleness* stale_out);
 
+  // Returns a copy of the entry for |key| if it is valid at time |now|.
+  // Unlike the other methods this may be called from any thread, while the
+  // owning thread uses the cache, so that callers elsewhere can answer from
+  // the cache without posting to the network thread.  It does not count as a
+  // hit, and does not make the entry less likely to be evicted.  Callers must
+  // stop using it before the cache is destroyed.
+  base::Optional<Entry> LookupFromAnyThread(const Key& key,
+                                            base::TimeTicks now) const;
+
   // Overwrites or creates an entry for |key|.
   // |entry| is the value to set, |now| is the current time
   // |ttl| is the "time to live".
@@ -142,6 +180,30 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   // Marks all entries as stale on account of a network change.
   void OnNetworkChange();
 
+  // Writes every entry to |pickle|, most recently used first, in the format
+  // read by RestoreFromSnapshot().  TimeTicks do not survive a restart, so
+  // expiry times are written relative to |now|, along with |now_wall|, the
+  // wall clock time at |now|.
+  void WriteSnapshot(base::TimeTicks now,
+                     base::Time now_wall,
+                     base::Pickle* pickle) const;
+
+  // Adds the entries in |data|, a snapshot written by WriteSnapshot(),
+  // probably in an earlier process.  Entries already in the cache are kept,
+  // and restored entries are less recently used than any of them.  Stops
+  // when the cache is full.
+  //
+  // The network may have changed since the snapshot was written, so
+  // restored entries count as received before a network change: Lookup()
+  // skips them, and LookupStale() returns them until they are Set() again.
+  //
+  // Returns false if |data| is not a valid snapshot, in which case some of
+  // its entries may have been restored anyway.
+  bool RestoreFromSnapshot(const char* data,
+                           size_t size,
+                           base::TimeTicks now,
+                           base::Time now_wall);
+
   void set_eviction_callback(const EvictionCallback& callback) {
     eviction_callback_ = callback;
   }
@@ -159,7 +221,8 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   // Following are used by net_internals UI.
   size_t max_entries() const;
 
-  const EntryMap& entries() const { return entries_; }
+  // Returns a copy of every entry, sorted by key.
+  EntryList GetEntries() const;
 
   // Creates a default cache.
   static std::unique_ptr<HostCache> CreateDefaultCache();
@@ -171,8 +234,34 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   enum LookupOutcome : int;
   enum EraseReason : int;
 
+  // Entries whose keys hash to the same shard.
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    // Held by the owning thread while modifying |entries|, and by other
+    // threads while reading it.
+    mutable base::Lock lock;
+    EntryMap entries;
+  };
+
+  Shard* GetShard(const Key& key);
+  const Shard* GetShard(const Key& key) const;
+
   Entry* LookupInternal(const Key& key);
 
+  // Marks |entry| as the most recently used.
+  void Touch(Entry* entry);
+
+  // Adds |entry| for |key|, which must not be in the cache, and places it in
+  // |lru_list_| before |lru_position|.
+  void AddEntry(const Key& key,
+                const Entry& entry,
+                std::list<const Key*>::iterator lru_position);
+
+  // Removes the entry at |it| from |shard| and from |lru_list_|.
+  void Erase(Shard* shard, EntryMap::iterator it);
+
   void RecordSet(SetOutcome outcome,
                  base::TimeTicks now,
                  const Entry* old_entry,
@@ -188,13 +277,25 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   // Returns true if this HostCache can contain no entries.
   bool caching_is_disabled() const { return max_entries_ == 0; }
 
+  // Evicts the entry which expires first among the least recently used
+  // ones, preferring stale entries.  Only looks at a bounded number of
+  // entries, so the cost does not grow with the size of the cache.
   void EvictOneEntry(base::TimeTicks now);
 
+  static const size_t kNumShards = 16;
+
   // Map from hostname (presumably in lowercase canonicalized format) to
-  // a resolved result entry.
-  EntryMap entries_;
+  // a resolved result entry, split by KeyHash.
+  Shard shards_[kNumShards];
+  size_t size_;
+
+  // Keys of all entries, least recently set or looked up first.  Only used
+  // on the owning thread.
+  std::list<const Key*> lru_list_;
+
   size_t max_entries_;
-  int network_changes_;
+  // Read by LookupFromAnyThread().
+  base::subtle::Atomic32 network_changes_;
   EvictionCallback eviction_callback_;
 
   DISALLOW_COPY_AND_ASSIGN(HostCache);
@@ -0,0 +1,164 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/pickle.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_time_logger.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "net/base/address_list.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/host_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumEntries = 100000;
+const int kNumLookups = 1000000;
+const int kNumReaderThreads = 4;
+const int kNumSnapshotEntries = 50000;
+
+HostCache::Key Key(int i) {
+  return HostCache::Key(base::StringPrintf("host%d.example.com", i),
+                        ADDRESS_FAMILY_UNSPECIFIED, 0);
+}
+
+std::vector<HostCache::Key> MakeKeys(int count) {
+  std::vector<HostCache::Key> keys;
+  keys.reserve(count);
+  for (int i = 0; i < count; ++i)
+    keys.push_back(Key(i));
+  return keys;
+}
+
+class Reader : public base::DelegateSimpleThread::Delegate {
+ public:
+  Reader(const HostCache* cache,
+         const std::vector<HostCache::Key>* keys,
+         base::TimeTicks now)
+      : cache_(cache), keys_(keys), now_(now), hits_(0) {}
+
+  void Run() override {
+    for (int i = 0; i < kNumLookups; ++i) {
+      if (cache_->LookupFromAnyThread((*keys_)[i % keys_->size()], now_))
+        ++hits_;
+    }
+  }
+
+  int hits() const { return hits_; }
+
+ private:
+  const HostCache* cache_;
+  const std::vector<HostCache::Key>* keys_;
+  base::TimeTicks now_;
+  int hits_;
+};
+
+TEST(HostCachePerfTest, SetAndLookup) {
+  HostCache cache(kNumEntries);
+  std::vector<HostCache::Key> keys = MakeKeys(kNumEntries);
+  HostCache::Entry entry(OK, AddressList());
+  base::TimeTicks now = base::TimeTicks::Now();
+  const base::TimeDelta ttl = base::TimeDelta::FromMinutes(1);
+
+  {
+    base::PerfTimeLogger timer("HostCache_set_100k");
+    for (const HostCache::Key& key : keys)
+      cache.Set(key, entry, now, ttl);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEntries), cache.size());
+
+  {
+    base::PerfTimeLogger timer("HostCache_lookup_1M");
+    for (int i = 0; i < kNumLookups; ++i)
+      EXPECT_TRUE(cache.Lookup(keys[i % kNumEntries], now));
+  }
+
+  // Every insert into the full cache evicts.
+  std::vector<HostCache::Key> new_keys = MakeKeys(2 * kNumEntries);
+  {
+    base::PerfTimeLogger timer("HostCache_set_evict_100k");
+    for (int i = kNumEntries; i < 2 * kNumEntries; ++i)
+      cache.Set(new_keys[i], entry, now, ttl);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEntries), cache.size());
+}
+
+TEST(HostCachePerfTest, LookupFromAnyThread) {
+  HostCache cache(kNumEntries);
+  std::vector<HostCache::Key> keys = MakeKeys(kNumEntries);
+  HostCache::Entry entry(OK, AddressList());
+  base::TimeTicks now = base::TimeTicks::Now();
+  for (const HostCache::Key& key : keys)
+    cache.Set(key, entry, now, base::TimeDelta::FromMinutes(1));
+
+  std::vector<std::unique_ptr<Reader>> readers;
+  for (int i = 0; i < kNumReaderThreads; ++i)
+    readers.push_back(std::unique_ptr<Reader>(new Reader(&cache, &keys, now)));
+
+  {
+    base::PerfTimeLogger timer("HostCache_lookup_from_4_threads_4M");
+    base::DelegateSimpleThreadPool pool("HostCacheReader", kNumReaderThreads);
+    for (const auto& reader : readers)
+      pool.AddWork(reader.get());
+    pool.Start();
+    pool.JoinAll();
+  }
+  for (const auto& reader : readers)
+    EXPECT_EQ(kNumLookups, reader->hits());
+}
+
+// Startup cost of a warm start: mapping a snapshot of 50k names and restoring
+// it into an empty cache.
+TEST(HostCachePerfTest, RestoreSnapshot) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.GetPath().AppendASCII("HostCache");
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::Time now_wall = base::Time::Now();
+
+  {
+    HostCache cache(kNumSnapshotEntries);
+    AddressList addresses(IPEndPoint(IPAddress(192, 0, 2, 1), 443));
+    addresses.push_back(IPEndPoint(IPAddress::IPv6Localhost(), 443));
+    HostCache::Entry entry(OK, addresses, base::TimeDelta::FromMinutes(1));
+    for (const HostCache::Key& key : MakeKeys(kNumSnapshotEntries))
+      cache.Set(key, entry, now, entry.ttl());
+
+    base::Pickle pickle;
+    {
+      base::PerfTimeLogger timer("HostCache_write_snapshot_50k");
+      cache.WriteSnapshot(now, now_wall, &pickle);
+    }
+    ASSERT_EQ(static_cast<int>(pickle.size()),
+              base::WriteFile(path, static_cast<const char*>(pickle.data()),
+                              pickle.size()));
+  }
+
+  HostCache cache(kNumSnapshotEntries);
+  {
+    base::PerfTimeLogger timer("HostCache_map_and_restore_snapshot_50k");
+    base::MemoryMappedFile snapshot;
+    ASSERT_TRUE(snapshot.Initialize(path));
+    ASSERT_TRUE(cache.RestoreFromSnapshot(
+        reinterpret_cast<const char*>(snapshot.data()), snapshot.length(), now,
+        now_wall));
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumSnapshotEntries), cache.size());
+}
+
+}  // namespace
+
+}  // namespace net
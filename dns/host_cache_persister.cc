@@ -0,0 +1,91 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/host_cache_persister.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/pickle.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
+#include "net/dns/host_cache.h"
+
+namespace net {
+
+namespace {
+
+// Runs on the background runner.  Returns nullptr if there is no snapshot.
+std::unique_ptr<base::MemoryMappedFile> MapSnapshot(
+    const base::FilePath& path) {
+  if (!base::PathExists(path))
+    return nullptr;
+  std::unique_ptr<base::MemoryMappedFile> snapshot =
+      base::MakeUnique<base::MemoryMappedFile>();
+  if (!snapshot->Initialize(path) || snapshot->length() == 0)
+    return nullptr;
+  return snapshot;
+}
+
+}  // namespace
+
+HostCachePersister::HostCachePersister(
+    HostCache* cache,
+    const base::FilePath& path,
+    const scoped_refptr<base::SequencedTaskRunner>& background_runner,
+    base::TimeDelta write_interval)
+    : cache_(cache),
+      writer_(path, background_runner),
+      background_runner_(background_runner),
+      write_interval_(write_interval),
+      loaded_(false),
+      weak_ptr_factory_(this) {
+  base::PostTaskAndReplyWithResult(
+      background_runner_.get(), FROM_HERE, base::Bind(&MapSnapshot, path),
+      base::Bind(&HostCachePersister::CompleteLoad,
+                 weak_ptr_factory_.GetWeakPtr()));
+}
+
+HostCachePersister::~HostCachePersister() {
+  if (loaded_)
+    WriteSnapshot();
+}
+
+bool HostCachePersister::SerializeData(std::string* data) {
+  base::Pickle pickle;
+  cache_->WriteSnapshot(base::TimeTicks::Now(), base::Time::Now(), &pickle);
+  data->assign(static_cast<const char*>(pickle.data()), pickle.size());
+  return true;
+}
+
+void HostCachePersister::CompleteLoad(
+    std::unique_ptr<base::MemoryMappedFile> snapshot) {
+  if (snapshot) {
+    if (!cache_->RestoreFromSnapshot(
+            reinterpret_cast<const char*>(snapshot->data()),
+            snapshot->length(), base::TimeTicks::Now(), base::Time::Now())) {
+      DVLOG(1) << "Ignoring invalid HostCache snapshot "
+               << writer_.path().value();
+    }
+    // Unmapping may block.
+    background_runner_->DeleteSoon(FROM_HERE, snapshot.release());
+  }
+
+  loaded_ = true;
+  write_timer_.Start(FROM_HERE, write_interval_, this,
+                     &HostCachePersister::WriteSnapshot);
+}
+
+void HostCachePersister::WriteSnapshot() {
+  std::unique_ptr<std::string> data = base::MakeUnique<std::string>();
+  if (SerializeData(data.get()))
+    writer_.WriteNow(std::move(data));
+}
+
+}  // namespace net
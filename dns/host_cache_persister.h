@@ -0,0 +1,82 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DNS_HOST_CACHE_PERSISTER_H_
+#define NET_DNS_HOST_CACHE_PERSISTER_H_
+
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/net_export.h"
+
+namespace base {
+class MemoryMappedFile;
+class SequencedTaskRunner;
+}
+
+namespace net {
+
+class HostCache;
+
+// Keeps a snapshot of a HostCache on disk, so that a restarted process starts
+// with the names its predecessor had resolved instead of resolving all of
+// them at once.  Restored entries are served as stale results, through
+// HostCache::LookupStale(), until they are resolved again.
+//
+// The snapshot at |path| is memory-mapped on |background_runner| when the
+// persister is created, and restored into the cache in place.  After that the
+// snapshot is rewritten every |write_interval|, and once more when the
+// persister is destroyed.  Nothing is written before the load completes, so
+// a previous snapshot is never replaced by an empty one.
+//
+// Must be created, used and destroyed on the cache's thread, and destroyed
+// before the cache.
+class NET_EXPORT HostCachePersister
+    : public base::ImportantFileWriter::DataSerializer {
+ public:
+  HostCachePersister(
+      HostCache* cache,
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_runner,
+      base::TimeDelta write_interval);
+  ~HostCachePersister() override;
+
+  // ImportantFileWriter::DataSerializer:
+  //
+  // Serializes the cache with HostCache::WriteSnapshot().
+  bool SerializeData(std::string* data) override;
+
+  // True once the snapshot on disk, if any, has been restored.
+  bool loaded() const { return loaded_; }
+
+ private:
+  void CompleteLoad(std::unique_ptr<base::MemoryMappedFile> snapshot);
+
+  void WriteSnapshot();
+
+  HostCache* const cache_;
+
+  base::ImportantFileWriter writer_;
+  scoped_refptr<base::SequencedTaskRunner> background_runner_;
+
+  const base::TimeDelta write_interval_;
+  base::RepeatingTimer write_timer_;
+
+  bool loaded_;
+
+  base::WeakPtrFactory<HostCachePersister> weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(HostCachePersister);
+};
+
+}  // namespace net
+
+#endif  // NET_DNS_HOST_CACHE_PERSISTER_H_
@@ -0,0 +1,109 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/host_cache_persister.h"
+
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "net/base/address_list.h"
+#include "net/base/net_errors.h"
+#include "net/dns/host_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const size_t kMaxCacheEntries = 10;
+
+HostCache::Key Key(const std::string& hostname) {
+  return HostCache::Key(hostname, ADDRESS_FAMILY_UNSPECIFIED, 0);
+}
+
+class HostCachePersisterTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.GetPath().AppendASCII("HostCache");
+  }
+
+  std::unique_ptr<HostCachePersister> CreatePersister(HostCache* cache) {
+    std::unique_ptr<HostCachePersister> persister(new HostCachePersister(
+        cache, path_, base::ThreadTaskRunnerHandle::Get(),
+        base::TimeDelta::FromMinutes(1)));
+    base::RunLoop().RunUntilIdle();
+    EXPECT_TRUE(persister->loaded());
+    return persister;
+  }
+
+  base::MessageLoopForIO message_loop_;
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+TEST_F(HostCachePersisterTest, NoSnapshot) {
+  HostCache cache(kMaxCacheEntries);
+  std::unique_ptr<HostCachePersister> persister = CreatePersister(&cache);
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(HostCachePersisterTest, RestoresSnapshotWrittenOnDestruction) {
+  {
+    HostCache cache(kMaxCacheEntries);
+    std::unique_ptr<HostCachePersister> persister = CreatePersister(&cache);
+    cache.Set(Key("foobar.com"), HostCache::Entry(OK, AddressList()),
+              base::TimeTicks::Now(), base::TimeDelta::FromMinutes(5));
+  }
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(base::PathExists(path_));
+
+  HostCache cache(kMaxCacheEntries);
+  std::unique_ptr<HostCachePersister> persister = CreatePersister(&cache);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_FALSE(cache.Lookup(Key("foobar.com"), base::TimeTicks::Now()));
+  EXPECT_TRUE(
+      cache.LookupStale(Key("foobar.com"), base::TimeTicks::Now(), nullptr));
+}
+
+TEST_F(HostCachePersisterTest, InvalidSnapshot) {
+  const char kGarbage[] = "garbage";
+  ASSERT_EQ(static_cast<int>(sizeof(kGarbage)),
+            base::WriteFile(path_, kGarbage, sizeof(kGarbage)));
+
+  HostCache cache(kMaxCacheEntries);
+  std::unique_ptr<HostCachePersister> persister = CreatePersister(&cache);
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(HostCachePersisterTest, DoesNotWriteBeforeLoad) {
+  const char kGarbage[] = "garbage";
+  ASSERT_EQ(static_cast<int>(sizeof(kGarbage)),
+            base::WriteFile(path_, kGarbage, sizeof(kGarbage)));
+
+  HostCache cache(kMaxCacheEntries);
+  cache.Set(Key("foobar.com"), HostCache::Entry(OK, AddressList()),
+            base::TimeTicks::Now(), base::TimeDelta::FromMinutes(5));
+  std::unique_ptr<HostCachePersister> persister(new HostCachePersister(
+      &cache, path_, base::ThreadTaskRunnerHandle::Get(),
+      base::TimeDelta::FromMinutes(1)));
+  // Destroyed before the snapshot is loaded.
+  persister.reset();
+  base::RunLoop().RunUntilIdle();
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+  EXPECT_EQ(std::string(kGarbage, sizeof(kGarbage)), contents);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -9,9 +9,14 @@
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/format_macros.h"
+#include "base/pickle.h"
 #include "base/stl_util.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -551,6 +556,265 @@ TEST(HostCacheTest, EvictStale) {
   EXPECT_FALSE(cache.LookupStale(key3, now, &stale));
 }
 
+// Eviction only looks at the least recently used entries, so a recently looked
+// up entry survives even if it expires first.
+TEST(HostCacheTest, EvictLeastRecentlyUsed) {
+  const size_t kNumEntries = 100;
+  HostCache cache(kNumEntries);
+
+  int evict_count = 0;
+  HostCache::Key evicted_key = Key("nothingevicted.com");
+  cache.set_eviction_callback(
+      base::Bind(&TestEvictionCallback, &evict_count, &evicted_key));
+
+  base::TimeTicks now;
+  HostCache::Entry entry = HostCache::Entry(OK, AddressList());
+
+  // foobar0.com expires first, the rest all expire at the same time.
+  cache.Set(Key("foobar0.com"), entry, now, base::TimeDelta::FromSeconds(5));
+  for (size_t i = 1; i < kNumEntries; ++i) {
+    cache.Set(Key(base::StringPrintf("foobar%" PRIuS ".com", i)), entry, now,
+              base::TimeDelta::FromSeconds(10));
+  }
+  EXPECT_TRUE(cache.Lookup(Key("foobar0.com"), now));
+
+  cache.Set(Key("new.com"), entry, now, base::TimeDelta::FromSeconds(10));
+  EXPECT_EQ(kNumEntries, cache.size());
+  EXPECT_EQ(1, evict_count);
+  EXPECT_EQ("foobar1.com", evicted_key.hostname);
+  EXPECT_TRUE(cache.Lookup(Key("foobar0.com"), now));
+}
+
+TEST(HostCacheTest, LookupFromAnyThread) {
+  const base::TimeDelta kTTL = base::TimeDelta::FromSeconds(10);
+  HostCache cache(kMaxCacheEntries);
+
+  base::TimeTicks now;
+  HostCache::Key key = Key("foobar.com");
+  HostCache::Entry entry = HostCache::Entry(ERR_NAME_NOT_RESOLVED,
+                                            AddressList());
+
+  EXPECT_FALSE(cache.LookupFromAnyThread(key, now));
+  cache.Set(key, entry, now, kTTL);
+
+  base::Optional<HostCache::Entry> result =
+      cache.LookupFromAnyThread(key, now);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(ERR_NAME_NOT_RESOLVED, result->error());
+  EXPECT_EQ(now + kTTL, result->expires());
+
+  // Stale entries are not returned.
+  EXPECT_FALSE(cache.LookupFromAnyThread(key, now + kTTL));
+  cache.OnNetworkChange();
+  EXPECT_FALSE(cache.LookupFromAnyThread(key, now));
+}
+
+// Reads from another thread while the owning thread keeps the cache full.
+// Mostly useful under ThreadSanitizer. The reader keeps going until it has
+// made a pass over the hosts after the last write, so it must see the
+// entries that are left in the cache.
+TEST(HostCacheTest, LookupFromAnyThreadConcurrently) {
+  const int kNumHosts = 20;
+  HostCache cache(kMaxCacheEntries);
+  base::TimeTicks now;
+  HostCache::Entry entry = HostCache::Entry(OK, AddressList());
+  base::WaitableEvent writes_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+
+  class Reader : public base::DelegateSimpleThread::Delegate {
+   public:
+    Reader(const HostCache* cache,
+           base::TimeTicks now,
+           base::WaitableEvent* writes_done)
+        : cache_(cache), now_(now), writes_done_(writes_done), hits_(0) {}
+
+    void Run() override {
+      bool last_pass;
+      do {
+        last_pass = writes_done_->IsSignaled();
+        for (int i = 0; i < kNumHosts; ++i) {
+          if (cache_->LookupFromAnyThread(
+                  Key(base::StringPrintf("foobar%d.com", i)), now_)) {
+            ++hits_;
+          }
+        }
+      } while (!last_pass);
+    }
+
+    int hits() const { return hits_; }
+
+   private:
+    const HostCache* cache_;
+    base::TimeTicks now_;
+    base::WaitableEvent* writes_done_;
+    int hits_;
+  } reader(&cache, now, &writes_done);
+
+  base::DelegateSimpleThread thread(&reader, "HostCacheReader");
+  thread.Start();
+  for (int i = 0; i < 10000; ++i) {
+    cache.Set(Key(base::StringPrintf("foobar%d.com", i % kNumHosts)), entry,
+              now, base::TimeDelta::FromSeconds(10));
+  }
+  writes_done.Signal();
+  thread.Join();
+  EXPECT_EQ(static_cast<size_t>(kMaxCacheEntries), cache.size());
+  EXPECT_LE(kMaxCacheEntries, reader.hits());
+}
+
+TEST(HostCacheTest, SnapshotRoundTrip) {
+  const base::TimeDelta kTTL = base::TimeDelta::FromSeconds(10);
+  base::TimeTicks now;
+  base::Time now_wall = base::Time::Now();
+
+  AddressList addresses(IPEndPoint(IPAddress(1, 2, 3, 4), 80));
+  addresses.push_back(IPEndPoint(IPAddress::IPv6Localhost(), 443));
+  addresses.set_canonical_name("canonical.foobar.com");
+
+  HostCache cache(kMaxCacheEntries);
+  cache.Set(Key("foobar.com"), HostCache::Entry(OK, addresses, kTTL), now,
+            kTTL);
+  cache.Set(Key("unknown-ttl.com"), HostCache::Entry(OK, addresses), now,
+            kTTL);
+  cache.OnNetworkChange();
+  cache.Set(Key("error.com"),
+            HostCache::Entry(ERR_NAME_NOT_RESOLVED, AddressList()), now, kTTL);
+
+  base::Pickle pickle;
+  cache.WriteSnapshot(now, now_wall, &pickle);
+
+  // Restore three seconds later, in a process with a different clock.
+  base::TimeTicks restore_now = now + base::TimeDelta::FromHours(1);
+  HostCache restored(kMaxCacheEntries);
+  ASSERT_TRUE(restored.RestoreFromSnapshot(
+      static_cast<const char*>(pickle.data()), pickle.size(), restore_now,
+      now_wall + base::TimeDelta::FromSeconds(3)));
+  EXPECT_EQ(3u, restored.size());
+
+  HostCache::EntryStaleness stale;
+  const HostCache::Entry* entry =
+      restored.LookupStale(Key("foobar.com"), restore_now, &stale);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(OK, entry->error());
+  EXPECT_EQ(kTTL, entry->ttl());
+  EXPECT_EQ(restore_now + base::TimeDelta::FromSeconds(7), entry->expires());
+  ASSERT_EQ(2u, entry->addresses().size());
+  EXPECT_EQ(addresses[0], entry->addresses()[0]);
+  EXPECT_EQ(addresses[1], entry->addresses()[1]);
+  EXPECT_EQ("canonical.foobar.com", entry->addresses().canonical_name());
+  // One network change before the snapshot, and one for the restart.
+  EXPECT_EQ(2, stale.network_changes);
+
+  entry = restored.LookupStale(Key("unknown-ttl.com"), restore_now, &stale);
+  ASSERT_TRUE(entry);
+  EXPECT_FALSE(entry->has_ttl());
+
+  entry = restored.LookupStale(Key("error.com"), restore_now, &stale);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(ERR_NAME_NOT_RESOLVED, entry->error());
+  EXPECT_EQ(1, stale.network_changes);
+}
+
+// Restored entries are only served stale, and only until they are set again.
+TEST(HostCacheTest, RestoredEntriesAreStale) {
+  const base::TimeDelta kTTL = base::TimeDelta::FromSeconds(10);
+  base::TimeTicks now;
+  base::Time now_wall = base::Time::Now();
+  HostCache::Key key = Key("foobar.com");
+  HostCache::Entry entry = HostCache::Entry(OK, AddressList());
+
+  HostCache cache(kMaxCacheEntries);
+  cache.Set(key, entry, now, kTTL);
+  base::Pickle pickle;
+  cache.WriteSnapshot(now, now_wall, &pickle);
+
+  HostCache restored(kMaxCacheEntries);
+  ASSERT_TRUE(restored.RestoreFromSnapshot(
+      static_cast<const char*>(pickle.data()), pickle.size(), now, now_wall));
+  EXPECT_FALSE(restored.Lookup(key, now));
+  EXPECT_FALSE(restored.LookupFromAnyThread(key, now));
+  HostCache::EntryStaleness stale;
+  EXPECT_TRUE(restored.LookupStale(key, now, &stale));
+  EXPECT_TRUE(stale.is_stale());
+
+  restored.Set(key, entry, now, kTTL);
+  EXPECT_TRUE(restored.Lookup(key, now));
+}
+
+TEST(HostCacheTest, RestoreKeepsExistingEntriesAndStopsWhenFull) {
+  const base::TimeDelta kTTL = base::TimeDelta::FromSeconds(10);
+  base::TimeTicks now;
+  base::Time now_wall = base::Time::Now();
+
+  HostCache cache(kMaxCacheEntries);
+  cache.Set(Key("existing.com"), HostCache::Entry(OK, AddressList()), now,
+            kTTL);
+  for (int i = 0; i < kMaxCacheEntries; ++i) {
+    cache.Set(Key(base::StringPrintf("foobar%d.com", i)),
+              HostCache::Entry(ERR_NAME_NOT_RESOLVED, AddressList()), now,
+              kTTL);
+  }
+  // existing.com was evicted; foobar9.com is the most recently used.
+  base::Pickle pickle;
+  cache.WriteSnapshot(now, now_wall, &pickle);
+
+  HostCache restored(kMaxCacheEntries);
+  restored.Set(Key("existing.com"), HostCache::Entry(OK, AddressList()), now,
+               kTTL);
+  restored.Set(Key("foobar9.com"), HostCache::Entry(OK, AddressList()), now,
+               kTTL);
+  ASSERT_TRUE(restored.RestoreFromSnapshot(
+      static_cast<const char*>(pickle.data()), pickle.size(), now, now_wall));
+  EXPECT_EQ(static_cast<size_t>(kMaxCacheEntries), restored.size());
+
+  // The existing entries win, and the least recently used ones are left out.
+  const HostCache::Entry* entry = restored.Lookup(Key("foobar9.com"), now);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(OK, entry->error());
+  EXPECT_TRUE(restored.Lookup(Key("existing.com"), now));
+  EXPECT_TRUE(restored.LookupStale(Key("foobar1.com"), now, nullptr));
+  EXPECT_FALSE(restored.LookupStale(Key("foobar0.com"), now, nullptr));
+
+  // Restored entries are older than the existing ones, and foobar1.com was
+  // just looked up.
+  int evict_count = 0;
+  HostCache::Key evicted_key = Key("nothingevicted.com");
+  restored.set_eviction_callback(
+      base::Bind(&TestEvictionCallback, &evict_count, &evicted_key));
+  restored.Set(Key("new.com"), HostCache::Entry(OK, AddressList()), now, kTTL);
+  EXPECT_EQ(1, evict_count);
+  EXPECT_EQ("foobar2.com", evicted_key.hostname);
+}
+
+TEST(HostCacheTest, RestoreInvalidSnapshot) {
+  base::TimeTicks now;
+  base::Time now_wall = base::Time::Now();
+  HostCache cache(kMaxCacheEntries);
+  cache.Set(Key("foobar.com"), HostCache::Entry(OK, AddressList()), now,
+            base::TimeDelta::FromSeconds(10));
+  base::Pickle pickle;
+  cache.WriteSnapshot(now, now_wall, &pickle);
+
+  HostCache restored(kMaxCacheEntries);
+  const char kGarbage[] = "not a snapshot";
+  EXPECT_FALSE(restored.RestoreFromSnapshot(kGarbage, sizeof(kGarbage), now,
+                                            now_wall));
+
+  // Truncated.
+  EXPECT_FALSE(restored.RestoreFromSnapshot(
+      static_cast<const char*>(pickle.data()), pickle.size() - 1, now,
+      now_wall));
+
+  // Another version.
+  base::Pickle other_version;
+  other_version.WriteInt(0);
+  EXPECT_FALSE(restored.RestoreFromSnapshot(
+      static_cast<const char*>(other_version.data()), other_version.size(),
+      now, now_wall));
+  EXPECT_EQ(0u, restored.size());
+}
+
 // Tests the less than and equal operators for HostCache::Key work.
 TEST(HostCacheTest, KeyComparators) {
   struct {
@@ -542,6 +542,8 @@ bool ResolveLocalHostname(base::StringPiece host,
 
 const unsigned HostResolverImpl::kMaximumDnsFailures = 16;
 
+const size_t HostResolverImpl::kMaxBatchDnsJobs = 64;
+
 // Holds the data for a request that could not be completed synchronously.
 // It is owned by a Job. Canceled Requests are only marked as canceled rather
 // than removed from the Job's |requests_| list.
@@ -620,6 +622,53 @@ class HostResolverImpl::RequestImpl : public HostResolver::Request {
   DISALLOW_COPY_AND_ASSIGN(RequestImpl);
 };
 
+// Holds the Requests of a ResolveBatch() which could not be completed
+// synchronously, and runs the batch's callback once the last one completes.
+class HostResolverImpl::BatchRequestImpl : public HostResolver::Request {
+ public:
+  BatchRequestImpl(std::vector<BatchResult>* results,
+                   const CompletionCallback& callback)
+      : results_(results), callback_(callback), adding_(true) {}
+
+  ~BatchRequestImpl() override {}
+
+  void ChangeRequestPriority(RequestPriority priority) override {
+    for (const auto& request : requests_)
+      request.second->ChangeRequestPriority(priority);
+  }
+
+  void AddRequest(size_t index, std::unique_ptr<Request> request) {
+    DCHECK(adding_);
+    requests_[index] = std::move(request);
+  }
+
+  // Called once all Requests were added.  Until then a Request which is
+  // evicted from the queue must not run the callback, since ResolveBatch()
+  // has not returned yet.  Returns true if any Request is still pending.
+  bool FinishAdding() {
+    adding_ = false;
+    return !requests_.empty();
+  }
+
+  void OnRequestComplete(size_t index, int error) {
+    (*results_)[index].error = error;
+    // A completed Request does nothing after running its callback.
+    requests_.erase(index);
+    if (requests_.empty() && !adding_)
+      base::ResetAndReturn(&callback_).Run(OK);
+  }
+
+ private:
+  std::vector<BatchResult>* results_;
+  CompletionCallback callback_;
+
+  // Pending Requests, by index in the batch.
+  std::map<size_t, std::unique_ptr<Request>> requests_;
+  bool adding_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchRequestImpl);
+};
+
 //------------------------------------------------------------------------------
 
 // Calls HostResolverProc using a worker task runner. Performs retries if
@@ -1277,20 +1326,24 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
                               public HostResolverImpl::DnsTask::Delegate {
  public:
   // Creates new job for |key| where |request_net_log| is bound to the
-  // request that spawned it.
+  // request that spawned it.  The job is scheduled in |dispatcher|, which is
+  // one of the resolver's.
   Job(const base::WeakPtr<HostResolverImpl>& resolver,
       const Key& key,
       RequestPriority priority,
       scoped_refptr<base::TaskRunner> worker_task_runner,
+      PrioritizedDispatcher* dispatcher,
       const NetLogWithSource& source_net_log)
       : resolver_(resolver),
         key_(key),
         priority_tracker_(priority),
         worker_task_runner_(std::move(worker_task_runner)),
+        dispatcher_(dispatcher),
         had_non_speculative_request_(false),
         had_dns_config_(false),
         num_occupied_job_slots_(0),
         dns_task_error_(OK),
+        needs_proc_task_(false),
         creation_time_(base::TimeTicks::Now()),
         priority_change_time_(creation_time_),
         net_log_(
@@ -1339,9 +1392,9 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
     DCHECK(!is_queued());
     PrioritizedDispatcher::Handle handle;
     if (!at_head) {
-      handle = resolver_->dispatcher_->Add(this, priority());
+      handle = dispatcher_->Add(this, priority());
     } else {
-      handle = resolver_->dispatcher_->AddAtHead(this, priority());
+      handle = dispatcher_->AddAtHead(this, priority());
     }
     // The dispatcher could have started |this| in the above call to Add, which
     // could have called Schedule again. In that case |handle| will be null,
@@ -1431,7 +1484,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
     if (dns_task_) {
       KillDnsTask();
       dns_task_error_ = OK;
-      StartProcTask();
+      StartProcTaskOrRequeue();
     }
   }
 
@@ -1488,10 +1541,10 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   void ReduceToOneJobSlot() {
     DCHECK_GE(num_occupied_job_slots_, 1u);
     if (is_queued()) {
-      resolver_->dispatcher_->Cancel(handle_);
+      dispatcher_->Cancel(handle_);
       handle_.Reset();
     } else if (num_occupied_job_slots_ > 1) {
-      resolver_->dispatcher_->OnJobFinished();
+      dispatcher_->OnJobFinished();
       --num_occupied_job_slots_;
     }
     DCHECK_EQ(1u, num_occupied_job_slots_);
@@ -1526,7 +1579,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
     if (is_queued()) {
       if (priority() != static_cast<RequestPriority>(handle_.priority()))
         priority_change_time_ = base::TimeTicks::Now();
-      handle_ = resolver_->dispatcher_->ChangePriority(handle_, priority());
+      handle_ = dispatcher_->ChangePriority(handle_, priority());
     }
   }
 
@@ -1567,12 +1620,28 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
         (key_.host_resolver_flags & HOST_RESOLVER_SYSTEM_ONLY) != 0;
 
     // Caution: Job::Start must not complete synchronously.
-    if (!system_only && had_dns_config_ &&
+    if (!needs_proc_task_ && !system_only && had_dns_config_ &&
         !ResemblesMulticastDNSName(key_.hostname)) {
       StartDnsTask();
     } else {
+      StartProcTaskOrRequeue();
+    }
+  }
+
+  // Jobs in the resolver's |batch_dispatcher_| only run DnsTasks.  ProcTasks
+  // use worker threads, so they wait for a slot in |dispatcher_| instead.
+  void StartProcTaskOrRequeue() {
+    if (dispatcher_ == resolver_->dispatcher_.get()) {
       StartProcTask();
+      return;
     }
+    DCHECK(!is_running());
+    DCHECK_EQ(1u, num_occupied_job_slots_);
+    needs_proc_task_ = true;
+    num_occupied_job_slots_ = 0;
+    dispatcher_->OnJobFinished();
+    dispatcher_ = resolver_->dispatcher_.get();
+    Schedule(false);
   }
 
   // TODO(szym): Since DnsTransaction does not consume threads, we can increase
@@ -1683,7 +1752,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
     // ProcTask in that case is a waste of time.
     if (resolver_->fallback_to_proctask_) {
       KillDnsTask();
-      StartProcTask();
+      StartProcTaskOrRequeue();
     } else {
       UmaAsyncDnsResolveStatus(RESOLVE_STATUS_FAIL);
       CompleteRequestsWithError(net_error);
@@ -1769,9 +1838,9 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
       KillDnsTask();
 
       // Signal dispatcher that a slot has opened.
-      resolver_->dispatcher_->OnJobFinished();
+      dispatcher_->OnJobFinished();
     } else if (is_queued()) {
-      resolver_->dispatcher_->Cancel(handle_);
+      dispatcher_->Cancel(handle_);
       handle_.Reset();
     }
 
@@ -1857,6 +1926,9 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   // Task runner where the HostResolverProc is invoked.
   scoped_refptr<base::TaskRunner> worker_task_runner_;
 
+  // Either |resolver_->dispatcher_| or |resolver_->batch_dispatcher_|.
+  PrioritizedDispatcher* dispatcher_;
+
   bool had_non_speculative_request_;
 
   // Distinguishes measurements taken while DnsClient was fully configured.
@@ -1868,6 +1940,10 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   // Result of DnsTask.
   int dns_task_error_;
 
+  // True once the Job was moved out of the batch dispatcher to run a
+  // ProcTask.
+  bool needs_proc_task_;
+
   const base::TimeTicks creation_time_;
   base::TimeTicks priority_change_time_;
 
@@ -1882,7 +1958,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   // All Requests waiting for the result of this Job. Some can be canceled.
   std::deque<RequestImpl*> requests_;
 
-  // A handle used in |HostResolverImpl::dispatcher_|.
+  // A handle used in |dispatcher_|.
   PrioritizedDispatcher::Handle handle_;
 };
 
@@ -1907,6 +1983,10 @@ HostResolverImpl::ProcTaskParams::ProcTaskParams(const ProcTaskParams& other) =
 
 HostResolverImpl::ProcTaskParams::~ProcTaskParams() {}
 
+HostResolverImpl::BatchResult::BatchResult() : error(ERR_IO_PENDING) {}
+
+HostResolverImpl::BatchResult::~BatchResult() {}
+
 HostResolverImpl::HostResolverImpl(const Options& options, NetLog* net_log)
     : HostResolverImpl(
           options,
@@ -1914,8 +1994,9 @@ HostResolverImpl::HostResolverImpl(const Options& options, NetLog* net_log)
           base::WorkerPool::GetTaskRunner(true /* task_is_slow */)) {}
 
 HostResolverImpl::~HostResolverImpl() {
-  // Prevent the dispatcher from starting new jobs.
+  // Prevent the dispatchers from starting new jobs.
   dispatcher_->SetLimitsToZero();
+  batch_dispatcher_->SetLimitsToZero();
   // It's now safe for Jobs to call KillDnsTask on destruction, because
   // OnJobComplete will not start any new jobs.
   jobs_.clear();
@@ -1937,6 +2018,59 @@ int HostResolverImpl::Resolve(const RequestInfo& info,
                               const CompletionCallback& callback,
                               std::unique_ptr<Request>* out_req,
                               const NetLogWithSource& source_net_log) {
+  return ResolveWithDispatcher(info, priority, addresses, callback, out_req,
+                               source_net_log, dispatcher_.get());
+}
+
+int HostResolverImpl::ResolveBatch(const std::vector<RequestInfo>& infos,
+                                   RequestPriority priority,
+                                   std::vector<BatchResult>* results,
+                                   const CompletionCallback& callback,
+                                   std::unique_ptr<Request>* out_req,
+                                   const NetLogWithSource& source_net_log) {
+  DCHECK(results);
+  DCHECK(CalledOnValidThread());
+  DCHECK_EQ(false, callback.is_null());
+  DCHECK(out_req);
+
+  // The Requests keep pointers into |results|, so size it once up front.
+  results->clear();
+  results->resize(infos.size());
+
+  // DnsTasks do not tie up worker threads, so without a DNS config there is
+  // nothing to gain from bypassing |dispatcher_|.
+  PrioritizedDispatcher* dispatcher =
+      HaveDnsConfig() ? batch_dispatcher_.get() : dispatcher_.get();
+
+  std::unique_ptr<BatchRequestImpl> batch(
+      new BatchRequestImpl(results, callback));
+  for (size_t i = 0; i < infos.size(); ++i) {
+    std::unique_ptr<Request> request;
+    int rv = ResolveWithDispatcher(
+        infos[i], priority, &(*results)[i].addresses,
+        base::Bind(&BatchRequestImpl::OnRequestComplete,
+                   base::Unretained(batch.get()), i),
+        &request, source_net_log, dispatcher);
+    if (rv == ERR_IO_PENDING)
+      batch->AddRequest(i, std::move(request));
+    else
+      (*results)[i].error = rv;
+  }
+
+  if (!batch->FinishAdding())
+    return OK;
+  *out_req = std::move(batch);
+  return ERR_IO_PENDING;
+}
+
+int HostResolverImpl::ResolveWithDispatcher(
+    const RequestInfo& info,
+    RequestPriority priority,
+    AddressList* addresses,
+    const CompletionCallback& callback,
+    std::unique_ptr<Request>* out_req,
+    const NetLogWithSource& source_net_log,
+    PrioritizedDispatcher* dispatcher) {
   DCHECK(addresses);
   DCHECK(CalledOnValidThread());
   DCHECK_EQ(false, callback.is_null());
@@ -1973,11 +2107,12 @@ int HostResolverImpl::Resolve(const RequestInfo& info,
   Job* job;
   if (jobit == jobs_.end()) {
     job = new Job(weak_ptr_factory_.GetWeakPtr(), key, priority,
-                  worker_task_runner_, source_net_log);
+                  worker_task_runner_, dispatcher, source_net_log);
     job->Schedule(false);
 
-    // Check for queue overflow.
-    if (dispatcher_->num_queued_jobs() > max_queued_jobs_) {
+    // Check for queue overflow.  A batch is its own queue, and is not limited.
+    if (dispatcher == dispatcher_.get() &&
+        dispatcher_->num_queued_jobs() > max_queued_jobs_) {
       Job* evicted = static_cast<Job*>(dispatcher_->EvictOldestLowest());
       DCHECK(evicted);
       evicted->OnEvicted();  // Deletes |evicted|.
@@ -2027,6 +2162,8 @@ HostResolverImpl::HostResolverImpl(
   PrioritizedDispatcher::Limits job_limits = options.GetDispatcherLimits();
   dispatcher_.reset(new PrioritizedDispatcher(job_limits));
   max_queued_jobs_ = job_limits.total_jobs * 100u;
+  batch_dispatcher_.reset(new PrioritizedDispatcher(
+      PrioritizedDispatcher::Limits(NUM_PRIORITIES, kMaxBatchDnsJobs)));
 
   DCHECK_GE(dispatcher_->num_priorities(), static_cast<size_t>(NUM_PRIORITIES));
 
@@ -2415,6 +2552,9 @@ void HostResolverImpl::AbortAllInProgressJobs() {
   PrioritizedDispatcher::Limits limits = dispatcher_->GetLimits();
   dispatcher_->SetLimits(
       PrioritizedDispatcher::Limits(limits.reserved_slots.size(), 0));
+  PrioritizedDispatcher::Limits batch_limits = batch_dispatcher_->GetLimits();
+  batch_dispatcher_->SetLimits(
+      PrioritizedDispatcher::Limits(batch_limits.reserved_slots.size(), 0));
 
   // Life check to bail once |this| is deleted.
   base::WeakPtr<HostResolverImpl> self = weak_ptr_factory_.GetWeakPtr();
@@ -2425,8 +2565,10 @@ void HostResolverImpl::AbortAllInProgressJobs() {
     ignore_result(jobs_to_abort[i].release());
   }
 
-  if (self)
+  if (self) {
     dispatcher_->SetLimits(limits);
+    batch_dispatcher_->SetLimits(batch_limits);
+  }
 }
 
 void HostResolverImpl::AbortDnsTasks() {
@@ -2436,10 +2578,14 @@ void HostResolverImpl::AbortDnsTasks() {
   PrioritizedDispatcher::Limits limits = dispatcher_->GetLimits();
   dispatcher_->SetLimits(
       PrioritizedDispatcher::Limits(limits.reserved_slots.size(), 0));
+  PrioritizedDispatcher::Limits batch_limits = batch_dispatcher_->GetLimits();
+  batch_dispatcher_->SetLimits(
+      PrioritizedDispatcher::Limits(batch_limits.reserved_slots.size(), 0));
 
   for (auto it = jobs_.begin(); it != jobs_.end(); ++it)
     it->second->AbortDnsTask();
   dispatcher_->SetLimits(limits);
+  batch_dispatcher_->SetLimits(batch_limits);
 }
 
 void HostResolverImpl::TryServingAllJobsFromHosts() {
@@ -10,6 +10,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
@@ -17,6 +18,7 @@
 #include "base/threading/non_thread_safe.h"
 #include "base/time/time.h"
 #include "base/timer/timer.h"
+#include "net/base/address_list.h"
 #include "net/base/net_export.h"
 #include "net/base/network_change_notifier.h"
 #include "net/dns/host_cache.h"
@@ -25,7 +27,6 @@
 
 namespace net {
 
-class AddressList;
 class DnsClient;
 class IPAddress;
 class NetLog;
@@ -146,6 +147,41 @@ class NET_EXPORT HostResolverImpl
   HostCache* GetHostCache() override;
   std::unique_ptr<base::Value> GetDnsConfigAsValue() const override;
 
+  // Maximum number of Jobs started by ResolveBatch() which run DnsTasks at
+  // once.
+  static const size_t kMaxBatchDnsJobs;
+
+  // The result of one name of a ResolveBatch().
+  struct NET_EXPORT BatchResult {
+    BatchResult();
+    ~BatchResult();
+
+    int error;
+    AddressList addresses;
+  };
+
+  // Resolves all of |infos| at once, for prefetching large sets of names.
+  // Resizes |results| to match |infos| and fills in the result of each name,
+  // as Resolve() would.  Names are served from the cache, HOSTS and IP
+  // literals right away, and attach to any Job already in flight for them.
+  //
+  // If there is a DnsClient with a valid DnsConfig, the Jobs started for the
+  // batch run their DnsTasks up to |kMaxBatchDnsJobs| at a time, outside of
+  // the limits on concurrent resolves, since DnsTasks do not use worker
+  // threads.  A Job which falls back to ProcTask waits for a slot like any
+  // other.
+  //
+  // Returns OK if every name completed synchronously.  Otherwise returns
+  // ERR_IO_PENDING, fills |out_req|, and runs |callback| with OK once, after
+  // the last name completes.  Deleting |out_req| cancels the names which have
+  // not completed yet.
+  int ResolveBatch(const std::vector<RequestInfo>& infos,
+                   RequestPriority priority,
+                   std::vector<BatchResult>* results,
+                   const CompletionCallback& callback,
+                   std::unique_ptr<Request>* out_req,
+                   const NetLogWithSource& source_net_log);
+
   // Like |ResolveFromCache()|, but can return a stale result if the
   // implementation supports it. Fills in |*stale_info| if a response is
   // returned to indicate how stale (or not) it is.
@@ -182,6 +218,7 @@ class NET_EXPORT HostResolverImpl
   class LoopbackProbeJob;
   class DnsTask;
   class RequestImpl;
+  class BatchRequestImpl;
   using Key = HostCache::Key;
   using JobMap = std::map<Key, std::unique_ptr<Job>>;
 
@@ -189,6 +226,15 @@ class NET_EXPORT HostResolverImpl
   // ProcTask) before the DnsClient is disabled until the next DNS change.
   static const unsigned kMaximumDnsFailures;
 
+  // Implements Resolve(), scheduling any new Job in |dispatcher|.
+  int ResolveWithDispatcher(const RequestInfo& info,
+                            RequestPriority priority,
+                            AddressList* addresses,
+                            const CompletionCallback& callback,
+                            std::unique_ptr<Request>* out_req,
+                            const NetLogWithSource& source_net_log,
+                            PrioritizedDispatcher* dispatcher);
+
   // Helper used by |Resolve()| and |ResolveFromCache()|.  Performs IP
   // literal, cache and HOSTS lookup (if enabled), returns OK if successful,
   // ERR_NAME_NOT_RESOLVED if either hostname is invalid or IP literal is
@@ -322,6 +368,10 @@ class NET_EXPORT HostResolverImpl
     return dispatcher_->num_running_jobs();
   }
 
+  size_t num_running_batch_dispatcher_jobs_for_tests() const {
+    return batch_dispatcher_->num_running_jobs();
+  }
+
   // Cache of host resolution results.
   std::unique_ptr<HostCache> cache_;
 
@@ -331,6 +381,9 @@ class NET_EXPORT HostResolverImpl
   // Starts Jobs according to their priority and the configured limits.
   std::unique_ptr<PrioritizedDispatcher> dispatcher_;
 
+  // Starts the Jobs of ResolveBatch() which run DnsTasks.
+  std::unique_ptr<PrioritizedDispatcher> batch_dispatcher_;
+
   // Limit on the maximum number of jobs queued in |dispatcher_|.
   size_t max_queued_jobs_;
 
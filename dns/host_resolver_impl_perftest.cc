@@ -0,0 +1,213 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/sys_byteorder.h"
+#include "base/test/perf_time_logger.h"
+#include "net/base/address_list.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_client.h"
+#include "net/dns/dns_config_service.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/host_resolver_impl.h"
+#include "net/dns/host_resolver_proc.h"
+#include "net/log/net_log_source.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/udp_server_socket.h"
+#include "net/test/gtest_util.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsError;
+using net::test::IsOk;
+
+namespace net {
+
+namespace {
+
+const int kNumNames = 10000;
+
+// A stand-in for a local nameserver, which answers every query on the
+// loopback interface with 127.0.0.1.
+class StubNameserver {
+ public:
+  StubNameserver()
+      : socket_(nullptr, NetLogSource()),
+        buffer_(new IOBufferWithSize(dns_protocol::kMaxUDPSize)),
+        num_queries_(0) {}
+
+  void Start() {
+    ASSERT_THAT(socket_.Listen(IPEndPoint(IPAddress::IPv4Localhost(), 0)),
+                IsOk());
+    ASSERT_THAT(socket_.GetLocalAddress(&address_), IsOk());
+    Read();
+  }
+
+  const IPEndPoint& address() const { return address_; }
+  int num_queries() const { return num_queries_; }
+
+ private:
+  void Read() {
+    for (;;) {
+      int rv = socket_.RecvFrom(
+          buffer_.get(), buffer_->size(), &peer_,
+          base::Bind(&StubNameserver::OnRead, base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!Answer(rv))
+        return;
+    }
+  }
+
+  void OnRead(int rv) {
+    if (Answer(rv))
+      Read();
+  }
+
+  // Sends the answer to the query of |rv| bytes in |buffer_|.  Returns false
+  // if the answer is pending, in which case reading resumes once it is sent.
+  bool Answer(int rv) {
+    if (rv < static_cast<int>(sizeof(dns_protocol::Header)))
+      return true;
+    ++num_queries_;
+
+    // The query, with one answer for its question appended.
+    static const uint8_t kAnswer[] = {
+        0xc0, 0x0c,              // Name: pointer to the question.
+        0x00, 0x01,              // Type: A.
+        0x00, 0x01,              // Class: IN.
+        0x00, 0x00, 0x00, 0x3c,  // TTL: 60 seconds.
+        0x00, 0x04,              // RDLENGTH.
+        0x7f, 0x00, 0x00, 0x01,  // 127.0.0.1
+    };
+    if (rv + sizeof(kAnswer) > static_cast<size_t>(buffer_->size()))
+      return true;
+    dns_protocol::Header* header =
+        reinterpret_cast<dns_protocol::Header*>(buffer_->data());
+    header->flags |= base::HostToNet16(dns_protocol::kFlagResponse);
+    header->ancount = base::HostToNet16(1);
+    memcpy(buffer_->data() + rv, kAnswer, sizeof(kAnswer));
+
+    int write_rv = socket_.SendTo(
+        buffer_.get(), rv + sizeof(kAnswer), peer_,
+        base::Bind(&StubNameserver::OnWrite, base::Unretained(this)));
+    return write_rv != ERR_IO_PENDING;
+  }
+
+  void OnWrite(int rv) { Read(); }
+
+  UDPServerSocket socket_;
+  IPEndPoint address_;
+  IPEndPoint peer_;
+  scoped_refptr<IOBufferWithSize> buffer_;
+  int num_queries_;
+
+  DISALLOW_COPY_AND_ASSIGN(StubNameserver);
+};
+
+class HostResolverImplPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_NO_FATAL_FAILURE(nameserver_.Start());
+
+    resolver_.reset(
+        new HostResolverImpl(HostResolver::Options(), nullptr /* net_log */));
+    // Keep the DnsClient in use even if the test suite overrides the default
+    // HostResolverProc.
+    resolver_->set_proc_params_for_test(HostResolverImpl::ProcTaskParams(
+        HostResolverProc::GetDefault(), 0u /* max_retry_attempts */));
+    resolver_->SetMaxQueuedJobs(kNumNames);
+
+    DnsConfig config;
+    config.nameservers.push_back(nameserver_.address());
+    config.attempts = 1;
+    std::unique_ptr<DnsClient> dns_client = DnsClient::CreateClient(nullptr);
+    dns_client->SetConfig(config);
+    resolver_->SetDnsClient(std::move(dns_client));
+
+    for (int i = 0; i < kNumNames; ++i) {
+      HostResolver::RequestInfo info(
+          HostPortPair(base::StringPrintf("host%d.example", i), 80));
+      info.set_address_family(ADDRESS_FAMILY_IPV4);
+      infos_.push_back(info);
+    }
+  }
+
+  void OnResolveComplete(int* num_pending,
+                         const base::Closure& quit_closure,
+                         int rv) {
+    EXPECT_THAT(rv, IsOk());
+    if (--*num_pending == 0)
+      quit_closure.Run();
+  }
+
+  base::MessageLoopForIO message_loop_;
+  StubNameserver nameserver_;
+  std::unique_ptr<HostResolverImpl> resolver_;
+  std::vector<HostResolver::RequestInfo> infos_;
+};
+
+// Resolves every name with its own call to Resolve(), all of them waiting for
+// the resolver's few dispatcher slots.
+TEST_F(HostResolverImplPerfTest, Resolve) {
+  std::vector<AddressList> addresses(infos_.size());
+  std::vector<std::unique_ptr<HostResolver::Request>> requests(infos_.size());
+  int num_pending = 0;
+  base::RunLoop run_loop;
+
+  base::PerfTimeLogger timer("HostResolverImpl_Resolve_10k");
+  for (size_t i = 0; i < infos_.size(); ++i) {
+    int rv = resolver_->Resolve(
+        infos_[i], MEDIUM, &addresses[i],
+        base::Bind(&HostResolverImplPerfTest::OnResolveComplete,
+                   base::Unretained(this), &num_pending,
+                   run_loop.QuitClosure()),
+        &requests[i], NetLogWithSource());
+    ASSERT_THAT(rv, IsError(ERR_IO_PENDING));
+    ++num_pending;
+  }
+  run_loop.Run();
+  timer.Done();
+
+  EXPECT_EQ(kNumNames, nameserver_.num_queries());
+}
+
+TEST_F(HostResolverImplPerfTest, ResolveBatch) {
+  std::vector<HostResolverImpl::BatchResult> results;
+  std::unique_ptr<HostResolver::Request> request;
+  int num_pending = 1;
+  base::RunLoop run_loop;
+
+  base::PerfTimeLogger timer("HostResolverImpl_ResolveBatch_10k");
+  int rv = resolver_->ResolveBatch(
+      infos_, MEDIUM, &results,
+      base::Bind(&HostResolverImplPerfTest::OnResolveComplete,
+                 base::Unretained(this), &num_pending, run_loop.QuitClosure()),
+      &request, NetLogWithSource());
+  ASSERT_THAT(rv, IsError(ERR_IO_PENDING));
+  run_loop.Run();
+  timer.Done();
+
+  EXPECT_EQ(kNumNames, nameserver_.num_queries());
+  for (const auto& result : results)
+    EXPECT_THAT(result.error, IsOk());
+}
+
+}  // namespace
+
+}  // namespace net
@@ -28,7 +28,9 @@
 #include "base/time/time.h"
 #include "net/base/address_list.h"
 #include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
 #include "net/dns/dns_client.h"
 #include "net/dns/dns_test_util.h"
 #include "net/dns/mock_host_resolver.h"
@@ -593,6 +595,14 @@ class HostResolverImplTest : public testing::Test {
     return CreateRequest(hostname, kDefaultPort);
   }
 
+  size_t num_running_dispatcher_jobs() const {
+    return resolver_->num_running_dispatcher_jobs_for_tests();
+  }
+
+  size_t num_running_batch_dispatcher_jobs() const {
+    return resolver_->num_running_batch_dispatcher_jobs_for_tests();
+  }
+
   void set_handler(Handler* handler) {
     handler_.reset(handler);
     handler_->test = this;
@@ -1797,6 +1807,148 @@ TEST_F(HostResolverImplDnsTest, OnDnsTaskFailureAbortedJob) {
   EXPECT_THAT(requests_[1]->result(), IsError(ERR_IO_PENDING));
 }
 
+std::vector<HostResolver::RequestInfo> CreateBatch(
+    const std::vector<std::string>& hostnames) {
+  std::vector<HostResolver::RequestInfo> infos;
+  for (size_t i = 0; i < hostnames.size(); ++i) {
+    infos.push_back(
+        HostResolver::RequestInfo(HostPortPair(hostnames[i], 80 + i)));
+    infos.back().set_address_family(ADDRESS_FAMILY_IPV4);
+  }
+  return infos;
+}
+
+TEST_F(HostResolverImplDnsTest, ResolveBatch) {
+  proc_->AddRuleForAllFamilies("nx_succeed", "192.168.1.102");
+  ChangeDnsConfig(CreateValidDnsConfig());
+
+  std::vector<HostResolver::RequestInfo> infos = CreateBatch(
+      {"ok", "192.168.1.1", "nx_succeed", "nx_fail", "ok", "a..b"});
+  std::vector<HostResolverImpl::BatchResult> results;
+  TestCompletionCallback callback;
+  std::unique_ptr<HostResolver::Request> request;
+  EXPECT_THAT(
+      resolver_->ResolveBatch(infos, MEDIUM, &results, callback.callback(),
+                              &request, NetLogWithSource()),
+      IsError(ERR_IO_PENDING));
+  ASSERT_EQ(infos.size(), results.size());
+  // IP literals and invalid names complete right away.
+  EXPECT_THAT(results[1].error, IsOk());
+  EXPECT_THAT(results[5].error, IsError(ERR_NAME_NOT_RESOLVED));
+  EXPECT_EQ(ERR_IO_PENDING, results[0].error);
+
+  proc_->SignalMultiple(infos.size());
+  EXPECT_THAT(callback.WaitForResult(), IsOk());
+
+  EXPECT_THAT(results[0].error, IsOk());
+  ASSERT_EQ(1u, results[0].addresses.size());
+  EXPECT_EQ(IPEndPoint(IPAddress::IPv4Localhost(), 80),
+            results[0].addresses.front());
+  // Fallback to ProcTask.
+  EXPECT_THAT(results[2].error, IsOk());
+  ASSERT_EQ(1u, results[2].addresses.size());
+  EXPECT_EQ(IPEndPoint(IPAddress(192, 168, 1, 102), 82),
+            results[2].addresses.front());
+  EXPECT_THAT(results[3].error, IsError(ERR_NAME_NOT_RESOLVED));
+  // The second request for "ok" attached to the first one's Job.
+  EXPECT_THAT(results[4].error, IsOk());
+  ASSERT_EQ(1u, results[4].addresses.size());
+  EXPECT_EQ(IPEndPoint(IPAddress::IPv4Localhost(), 84),
+            results[4].addresses.front());
+
+  // Now everything is served from the cache.
+  std::unique_ptr<HostResolver::Request> cached_request;
+  EXPECT_THAT(resolver_->ResolveBatch(CreateBatch({"ok", "nx_succeed"}),
+                                      MEDIUM, &results, callback.callback(),
+                                      &cached_request, NetLogWithSource()),
+              IsOk());
+  EXPECT_FALSE(cached_request);
+  ASSERT_EQ(2u, results.size());
+  EXPECT_THAT(results[0].error, IsOk());
+  EXPECT_THAT(results[1].error, IsOk());
+}
+
+// Test that the DnsTasks of a batch run outside of the limits on concurrent
+// resolves, but up to HostResolverImpl::kMaxBatchDnsJobs at a time.
+TEST_F(HostResolverImplDnsTest, ResolveBatchRunsDnsTasksInBursts) {
+  CreateSerialResolver();
+  ChangeDnsConfig(CreateValidDnsConfig());
+
+  const int kNumNames = HostResolverImpl::kMaxBatchDnsJobs + 10;
+  std::vector<std::string> hostnames;
+  for (int i = 0; i < kNumNames; ++i)
+    hostnames.push_back(base::StringPrintf("4slow_ok%d", i));
+
+  std::vector<HostResolverImpl::BatchResult> results;
+  TestCompletionCallback callback;
+  std::unique_ptr<HostResolver::Request> request;
+  EXPECT_THAT(resolver_->ResolveBatch(CreateBatch(hostnames), MEDIUM, &results,
+                                      callback.callback(), &request,
+                                      NetLogWithSource()),
+              IsError(ERR_IO_PENDING));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(HostResolverImpl::kMaxBatchDnsJobs,
+            num_running_batch_dispatcher_jobs());
+  EXPECT_EQ(0u, num_running_dispatcher_jobs());
+
+  dns_client_->CompleteDelayedTransactions();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(10u, num_running_batch_dispatcher_jobs());
+  EXPECT_FALSE(callback.have_result());
+
+  dns_client_->CompleteDelayedTransactions();
+  EXPECT_THAT(callback.WaitForResult(), IsOk());
+  for (const auto& result : results)
+    EXPECT_THAT(result.error, IsOk());
+  EXPECT_EQ(0u, num_running_batch_dispatcher_jobs());
+}
+
+// Test that Jobs of a batch which fall back to ProcTask wait for a slot in the
+// resolver's limits.
+TEST_F(HostResolverImplDnsTest, ResolveBatchFallbackWithinLimits) {
+  CreateSerialResolver();
+  ChangeDnsConfig(CreateValidDnsConfig());
+
+  std::vector<HostResolverImpl::BatchResult> results;
+  TestCompletionCallback callback;
+  std::unique_ptr<HostResolver::Request> request;
+  EXPECT_THAT(resolver_->ResolveBatch(CreateBatch({"nx0", "nx1", "nx2"}),
+                                      MEDIUM, &results, callback.callback(),
+                                      &request, NetLogWithSource()),
+              IsError(ERR_IO_PENDING));
+  // Every DnsTask fails, and one ProcTask runs at a time.
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(proc_->WaitFor(1u));
+  EXPECT_EQ(0u, num_running_batch_dispatcher_jobs());
+  EXPECT_EQ(1u, num_running_dispatcher_jobs());
+
+  proc_->SignalMultiple(3u);
+  EXPECT_THAT(callback.WaitForResult(), IsOk());
+  for (const auto& result : results)
+    EXPECT_THAT(result.error, IsError(ERR_NAME_NOT_RESOLVED));
+}
+
+TEST_F(HostResolverImplDnsTest, CancelResolveBatch) {
+  ChangeDnsConfig(CreateValidDnsConfig());
+
+  std::vector<HostResolverImpl::BatchResult> results;
+  TestCompletionCallback callback;
+  std::unique_ptr<HostResolver::Request> request;
+  EXPECT_THAT(resolver_->ResolveBatch(CreateBatch({"4slow_ok", "ok"}), MEDIUM,
+                                      &results, callback.callback(), &request,
+                                      NetLogWithSource()),
+              IsError(ERR_IO_PENDING));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_THAT(results[1].error, IsOk());
+  EXPECT_EQ(1u, num_running_batch_dispatcher_jobs());
+
+  request.reset();
+  EXPECT_EQ(0u, num_running_batch_dispatcher_jobs());
+  dns_client_->CompleteDelayedTransactions();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(callback.have_result());
+}
+
 TEST_F(HostResolverImplDnsTest, DnsTaskUnspec) {
   ChangeDnsConfig(CreateValidDnsConfig());
 
@@ -99,7 +99,9 @@ HttpCache::ActiveEntry::ActiveEntry(disk_cache::Entry* entry)
     : disk_entry(entry),
       writer(NULL),
       will_process_pending_queue(false),
-      doomed(false) {
+      doomed(false),
+      writer_streaming(false),
+      stream_result(OK) {
 }
 
 HttpCache::ActiveEntry::~ActiveEntry() {
@@ -367,6 +369,7 @@ HttpCache::~HttpCache() {
     ActiveEntry* entry = active_entries_.begin()->second.get();
     entry->will_process_pending_queue = false;
     entry->pending_queue.clear();
+    entry->waiting_readers.clear();
     entry->readers.clear();
     entry->writer = NULL;
     DeactivateEntry(entry);
@@ -837,10 +840,21 @@ int HttpCache::AddTransactionToEntry(ActiveEntry* entry, Transaction* trans) {
   //
   // NOTE: If the transaction can only write, then the entry should not be in
   // use (since any existing entry should have already been doomed).
+  //
+  // Once the writer is storing the body of a complete response, transactions
+  // that only need to read it don't have to wait: they join as readers and
+  // follow the writer.
 
   if (entry->writer || entry->will_process_pending_queue) {
-    entry->pending_queue.push_back(trans);
-    return ERR_IO_PENDING;
+    if (!entry->writer_streaming || entry->will_process_pending_queue ||
+        !trans->CanTailWriter()) {
+      entry->pending_queue.push_back(trans);
+      return ERR_IO_PENDING;
+    }
+    entry->readers.insert(trans);
+    if (!entry->pending_queue.empty())
+      ProcessPendingQueue(entry);
+    return OK;
   }
 
   if (trans->mode() & Transaction::WRITE) {
@@ -869,8 +883,10 @@ void HttpCache::DoneWithEntry(ActiveEntry* entry, Transaction* trans,
                               bool cancel) {
   // If we already posted a task to move on to the next transaction and this was
   // the writer, there is nothing to cancel.
-  if (entry->will_process_pending_queue && entry->readers.empty())
+  if (entry->will_process_pending_queue && entry->readers.empty() &&
+      entry->writer != trans) {
     return;
+  }
 
   if (entry->writer) {
     DCHECK(trans == entry->writer);
@@ -885,6 +901,9 @@ void HttpCache::DoneWithEntry(ActiveEntry* entry, Transaction* trans,
       // The previous operation may have deleted the entry.
       if (!trans->entry())
         return;
+      // Readers that followed the writer don't have the whole body either.
+      if (success && entry->writer_streaming && trans->is_truncated())
+        entry->stream_result = ERR_CACHE_WRITE_FAILURE;
     }
     DoneWritingToEntry(entry, success);
   } else {
@@ -893,21 +912,35 @@ void HttpCache::DoneWithEntry(ActiveEntry* entry, Transaction* trans,
 }
 
 void HttpCache::DoneWritingToEntry(ActiveEntry* entry, bool success) {
-  DCHECK(entry->readers.empty());
+  DCHECK(entry->writer_streaming || entry->readers.empty());
 
+  bool was_streaming = entry->writer_streaming;
   entry->writer = NULL;
+  entry->writer_streaming = false;
 
   if (success) {
     ProcessPendingQueue(entry);
   } else {
-    DCHECK(!entry->will_process_pending_queue);
-
     // We failed to create this entry.
     TransactionList pending_queue;
     pending_queue.swap(entry->pending_queue);
 
-    entry->disk_entry->Doom();
-    DestroyEntry(entry);
+    if (entry->readers.empty() && !entry->will_process_pending_queue) {
+      entry->disk_entry->Doom();
+      DestroyEntry(entry);
+    } else {
+      // Readers that followed the writer keep the entry open until they reach
+      // the end of what was stored, and fail there.
+      DCHECK(was_streaming || entry->readers.empty());
+      entry->stream_result = ERR_CACHE_WRITE_FAILURE;
+      if (entry->doomed) {
+        entry->disk_entry->Doom();
+      } else {
+        int rv = DoomEntry(entry->disk_entry->GetKey(), NULL);
+        DCHECK_EQ(OK, rv);
+      }
+      ProcessPendingQueue(entry);
+    }
 
     // We need to do something about these pending entries, which now need to
     // be added to a new entry.
@@ -920,19 +953,25 @@ void HttpCache::DoneWritingToEntry(ActiveEntry* entry, bool success) {
 }
 
 void HttpCache::DoneReadingFromEntry(ActiveEntry* entry, Transaction* trans) {
-  DCHECK(!entry->writer);
+  DCHECK(!entry->writer || entry->writer_streaming);
 
   auto it = entry->readers.find(trans);
   DCHECK(it != entry->readers.end());
 
   entry->readers.erase(it);
 
+  auto j = find(entry->waiting_readers.begin(), entry->waiting_readers.end(),
+                trans);
+  if (j != entry->waiting_readers.end())
+    entry->waiting_readers.erase(j);
+
   ProcessPendingQueue(entry);
 }
 
 void HttpCache::ConvertWriterToReader(ActiveEntry* entry) {
   DCHECK(entry->writer);
   DCHECK(entry->writer->mode() == Transaction::READ_WRITE);
+  DCHECK(!entry->writer_streaming);
   DCHECK(entry->readers.empty());
 
   Transaction* trans = entry->writer;
@@ -943,6 +982,47 @@ void HttpCache::ConvertWriterToReader(ActiveEntry* entry) {
   ProcessPendingQueue(entry);
 }
 
+void HttpCache::BeginStreamingEntry(ActiveEntry* entry) {
+  DCHECK(entry->writer);
+  if (entry->writer_streaming)
+    return;
+
+  DCHECK(entry->readers.empty());
+  entry->writer_streaming = true;
+  entry->stream_result = OK;
+  if (!entry->pending_queue.empty())
+    ProcessPendingQueue(entry);
+}
+
+void HttpCache::NotifyWaitingReaders(ActiveEntry* entry) {
+  // The readers are notified from OnProcessPendingQueue, so that they don't
+  // run while the writer is in the middle of its own work.
+  if (!entry->waiting_readers.empty())
+    ProcessPendingQueue(entry);
+}
+
+int HttpCache::WaitForEntryData(ActiveEntry* entry, Transaction* trans) {
+  DCHECK(entry->readers.count(trans));
+
+  if (!entry->writer_streaming)
+    return entry->stream_result;
+
+  entry->waiting_readers.push_back(trans);
+  return ERR_IO_PENDING;
+}
+
+void HttpCache::RequeueTailingReader(ActiveEntry* entry, Transaction* trans) {
+  auto it = entry->readers.find(trans);
+  DCHECK(it != entry->readers.end());
+
+  entry->readers.erase(it);
+  entry->pending_queue.push_back(trans);
+
+  // The writer may be done already.
+  if (!entry->writer)
+    ProcessPendingQueue(entry);
+}
+
 LoadState HttpCache::GetLoadStateForPendingTransaction(
       const Transaction* trans) {
   auto i = active_entries_.find(trans->key());
@@ -1033,8 +1113,20 @@ void HttpCache::ProcessPendingQueue(ActiveEntry* entry) {
 }
 
 void HttpCache::OnProcessPendingQueue(ActiveEntry* entry) {
+  // Readers that caught up with the writer can read what it stored since, or
+  // reach the end of the body. Notifying them may finish some of them, or make
+  // them wait again, so take only those that were waiting already, one at a
+  // time. Keeping |will_process_pending_queue| set meanwhile defers the
+  // destruction of |entry|.
+  size_t num_waiting = entry->waiting_readers.size();
+  while (num_waiting-- && !entry->waiting_readers.empty()) {
+    Transaction* reader = entry->waiting_readers.front();
+    entry->waiting_readers.pop_front();
+    reader->io_callback().Run(OK);
+  }
+
   entry->will_process_pending_queue = false;
-  DCHECK(!entry->writer);
+  DCHECK(!entry->writer || entry->writer_streaming);
 
   // If no one is interested in this entry, then we can deactivate it.
   if (entry->HasNoTransactions()) {
@@ -1047,8 +1139,12 @@ void HttpCache::OnProcessPendingQueue(ActiveEntry* entry) {
 
   // Promote next transaction from the pending queue.
   Transaction* next = entry->pending_queue.front();
-  if ((next->mode() & Transaction::WRITE) && !entry->readers.empty())
+  if (entry->writer) {
+    if (!next->CanTailWriter())
+      return;  // Have to wait for the writer.
+  } else if ((next->mode() & Transaction::WRITE) && !entry->readers.empty()) {
     return;  // Have to wait.
+  }
 
   entry->pending_queue.erase(entry->pending_queue.begin());
 
@@ -262,6 +262,19 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory,
     TransactionList    pending_queue;
     bool               will_process_pending_queue;
     bool               doomed;
+
+    // True while |writer| appends the body of a complete response, which
+    // |readers| may consume as it is written.
+    bool               writer_streaming;
+
+    // Readers that have read everything stored so far and wait for |writer|
+    // to append more data.
+    TransactionList    waiting_readers;
+
+    // What readers that joined while |writer| was streaming get once they
+    // reach the end of the stored body: OK if the body is complete, or an
+    // error if the writer failed to store all of it.
+    int                stream_result;
   };
 
   using ActiveEntriesMap =
@@ -365,6 +378,30 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory,
   // transactions can start reading from this entry.
   void ConvertWriterToReader(ActiveEntry* entry);
 
+  // Called when the writer of |entry| reads the body of a complete response
+  // from the network, to be appended to |entry|. From then on, transactions
+  // that only need to read the response join |entry| as readers right away
+  // and follow the writer, instead of waiting in the pending queue. Does
+  // nothing if the writer is streaming already.
+  void BeginStreamingEntry(ActiveEntry* entry);
+
+  // Called by the writer of |entry| after it appends data to the body, to let
+  // waiting readers know.
+  void NotifyWaitingReaders(ActiveEntry* entry);
+
+  // Called when |trans|, a reader that joined |entry| while it was being
+  // written, reaches the end of the stored body. Returns ERR_IO_PENDING if the
+  // writer may still append data, in which case |trans| will be notified via
+  // its IO callback once there is more to read. Otherwise returns OK if the
+  // body is complete, or ERR_CACHE_WRITE_FAILURE if the writer did not store
+  // all of it.
+  int WaitForEntryData(ActiveEntry* entry, Transaction* trans);
+
+  // Moves |trans|, a reader that joined |entry| while it was being written,
+  // to the pending queue, to wait for the writer to finish. |trans| will be
+  // notified via its IO callback once it is added to |entry| again.
+  void RequeueTailingReader(ActiveEntry* entry, Transaction* trans);
+
   // Returns the LoadState of the provided pending transaction.
   LoadState GetLoadStateForPendingTransaction(const Transaction* trans);
 
@@ -0,0 +1,162 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/run_loop.h"
+#include "base/test/perf_time_logger.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_transaction_test_util.h"
+#include "net/http/mock_http_cache.h"
+#include "net/log/net_log_with_source.h"
+#include "net/test/gtest_util.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsOk;
+
+namespace net {
+
+namespace {
+
+const int kNumTransactions = 100;
+const int64_t kResponseSize = 50 * 1024 * 1024;
+const int kReadSize = 32 * 1024;
+
+// Serves the body without filling the buffers; only the byte counts matter.
+int SkipBodyReader(int64_t content_length,
+                   int64_t offset,
+                   IOBuffer* buf,
+                   int buf_len) {
+  return static_cast<int>(
+      std::min(static_cast<int64_t>(buf_len), content_length - offset));
+}
+
+// Starts a transaction and reads its whole body.
+class Consumer {
+ public:
+  Consumer(MockHttpCache* cache,
+           const HttpRequestInfo* request,
+           const base::Closure& done_closure)
+      : done_closure_(done_closure),
+        buffer_(new IOBuffer(kReadSize)),
+        bytes_read_(0),
+        result_(ERR_IO_PENDING) {
+    EXPECT_THAT(cache->CreateTransaction(&trans_), IsOk());
+    int rv = trans_->Start(
+        request, base::Bind(&Consumer::OnStartComplete, base::Unretained(this)),
+        NetLogWithSource());
+    if (rv != ERR_IO_PENDING)
+      OnStartComplete(rv);
+  }
+
+  int64_t bytes_read() const { return bytes_read_; }
+  int result() const { return result_; }
+
+ private:
+  void OnStartComplete(int rv) {
+    if (rv != OK) {
+      Done(rv);
+      return;
+    }
+    Read();
+  }
+
+  void Read() {
+    for (;;) {
+      int rv = trans_->Read(
+          buffer_.get(), kReadSize,
+          base::Bind(&Consumer::OnReadComplete, base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!HandleReadResult(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int rv) {
+    if (HandleReadResult(rv))
+      Read();
+  }
+
+  // Returns true if there is more to read.
+  bool HandleReadResult(int rv) {
+    if (rv <= 0) {
+      Done(rv);
+      return false;
+    }
+    bytes_read_ += rv;
+    return true;
+  }
+
+  void Done(int rv) {
+    result_ = rv;
+    trans_.reset();
+    done_closure_.Run();
+  }
+
+  base::Closure done_closure_;
+  std::unique_ptr<HttpTransaction> trans_;
+  scoped_refptr<IOBuffer> buffer_;
+  int64_t bytes_read_;
+  int result_;
+
+  DISALLOW_COPY_AND_ASSIGN(Consumer);
+};
+
+class HttpCachePerfTest : public testing::Test {
+ protected:
+  void OnConsumerDone(const base::Closure& quit_closure) {
+    if (++num_done_ == kNumTransactions)
+      quit_closure.Run();
+  }
+
+  int num_done_ = 0;
+};
+
+// Many requests for the same large response arrive at once. The first one
+// fetches and stores it, and the others read it from the cache as it is
+// stored.
+TEST_F(HttpCachePerfTest, ConcurrentRequestsForLargeResponse) {
+  MockHttpCache cache;
+
+  MockTransaction transaction(kSimpleGET_Transaction);
+  transaction.response_headers =
+      "Cache-Control: max-age=10000\n"
+      "Content-Length: 52428800\n";
+  transaction.read_handler = &SkipBodyReader;
+  ScopedMockTransaction scoped_transaction(transaction);
+  MockHttpRequest request(transaction);
+
+  base::RunLoop run_loop;
+  base::Closure done_closure =
+      base::Bind(&HttpCachePerfTest::OnConsumerDone, base::Unretained(this),
+                 run_loop.QuitClosure());
+
+  base::PerfTimeLogger timer("HttpCache_ConcurrentRequests_100x50MB");
+  std::vector<std::unique_ptr<Consumer>> consumers;
+  for (int i = 0; i < kNumTransactions; ++i) {
+    consumers.push_back(
+        std::unique_ptr<Consumer>(new Consumer(&cache, &request, done_closure)));
+  }
+  run_loop.Run();
+  timer.Done();
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  for (const auto& consumer : consumers) {
+    EXPECT_THAT(consumer->result(), IsOk());
+    EXPECT_EQ(kResponseSize, consumer->bytes_read());
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -177,6 +177,8 @@ HttpCache::Transaction::Transaction(RequestPriority priority, HttpCache* cache)
       handling_206_(false),
       cache_pending_(false),
       done_reading_(false),
+      tailing_(false),
+      wait_for_writer_(false),
       vary_mismatch_(false),
       couldnt_conditionalize_request_(false),
       bypass_lock_for_test_(false),
@@ -260,6 +262,13 @@ bool HttpCache::Transaction::AddTruncatedFlag() {
   return true;
 }
 
+bool HttpCache::Transaction::CanTailWriter() const {
+  // Range requests need the whole entry to be written to tell which parts of
+  // it are stored.
+  return (mode_ == READ || mode_ == READ_WRITE) && !partial_ &&
+         !range_requested_ && !wait_for_writer_;
+}
+
 LoadState HttpCache::Transaction::GetWriterLoadState() const {
   if (network_trans_.get())
     return network_trans_->GetLoadState();
@@ -1085,6 +1094,15 @@ int HttpCache::Transaction::DoCreateEntryComplete(int result) {
       next_state_ = STATE_INIT_ENTRY;
       break;
 
+    case ERR_CACHE_ENTRY_NOT_ADMITTED:
+      // The backend would rather keep the entries it has. This is expected,
+      // unlike the failures below.
+      mode_ = NONE;
+      if (partial_)
+        partial_->RestoreHeaders(&custom_request_->extra_headers);
+      next_state_ = STATE_SEND_REQUEST;
+      break;
+
     default:
       // We have a race here: Maybe we failed to open the entry and decided to
       // create one, but by the time we called create, another transaction
@@ -1108,37 +1126,40 @@ int HttpCache::Transaction::DoAddToEntry() {
   DCHECK(entry_lock_waiting_since_.is_null());
   entry_lock_waiting_since_ = TimeTicks::Now();
   int rv = cache_->AddTransactionToEntry(new_entry_, this);
-  if (rv == ERR_IO_PENDING) {
-    if (bypass_lock_for_test_) {
-      OnAddToEntryTimeout(entry_lock_waiting_since_);
-    } else {
-      int timeout_milliseconds = 20 * 1000;
-      if (partial_ && new_entry_->writer &&
-          new_entry_->writer->range_requested_) {
-        // Quickly timeout and bypass the cache if we're a range request and
-        // we're blocked by the reader/writer lock. Doing so eliminates a long
-        // running issue, http://crbug.com/31014, where two of the same media
-        // resources could not be played back simultaneously due to one locking
-        // the cache entry until the entire video was downloaded.
-        //
-        // Bypassing the cache is not ideal, as we are now ignoring the cache
-        // entirely for all range requests to a resource beyond the first. This
-        // is however a much more succinct solution than the alternatives, which
-        // would require somewhat significant changes to the http caching logic.
-        //
-        // Allow some timeout slack for the entry addition to complete in case
-        // the writer lock is imminently released; we want to avoid skipping
-        // the cache if at all possible. See http://crbug.com/408765
-        timeout_milliseconds = 25;
-      }
-      base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
-          FROM_HERE,
-          base::Bind(&HttpCache::Transaction::OnAddToEntryTimeout,
-                     weak_factory_.GetWeakPtr(), entry_lock_waiting_since_),
-          TimeDelta::FromMilliseconds(timeout_milliseconds));
+  if (rv == ERR_IO_PENDING)
+    AddCacheLockTimeoutHandler(new_entry_);
+  return rv;
+}
+
+void HttpCache::Transaction::AddCacheLockTimeoutHandler(
+    HttpCache::ActiveEntry* entry) {
+  if (bypass_lock_for_test_) {
+    OnAddToEntryTimeout(entry_lock_waiting_since_);
+  } else {
+    int timeout_milliseconds = 20 * 1000;
+    if (partial_ && entry->writer && entry->writer->range_requested_) {
+      // Quickly timeout and bypass the cache if we're a range request and
+      // we're blocked by the reader/writer lock. Doing so eliminates a long
+      // running issue, http://crbug.com/31014, where two of the same media
+      // resources could not be played back simultaneously due to one locking
+      // the cache entry until the entire video was downloaded.
+      //
+      // Bypassing the cache is not ideal, as we are now ignoring the cache
+      // entirely for all range requests to a resource beyond the first. This
+      // is however a much more succinct solution than the alternatives, which
+      // would require somewhat significant changes to the http caching logic.
+      //
+      // Allow some timeout slack for the entry addition to complete in case
+      // the writer lock is imminently released; we want to avoid skipping
+      // the cache if at all possible. See http://crbug.com/408765
+      timeout_milliseconds = 25;
     }
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&HttpCache::Transaction::OnAddToEntryTimeout,
+                   weak_factory_.GetWeakPtr(), entry_lock_waiting_since_),
+        TimeDelta::FromMilliseconds(timeout_milliseconds));
   }
-  return rv;
 }
 
 int HttpCache::Transaction::DoAddToEntryComplete(int result) {
@@ -1153,8 +1174,12 @@ int HttpCache::Transaction::DoAddToEntryComplete(int result) {
   DCHECK(new_entry_);
   cache_pending_ = false;
 
-  if (result == OK)
+  if (result == OK) {
     entry_ = new_entry_;
+    // Only transactions that may read the entry while it is being written are
+    // let in before the writer is done.
+    tailing_ = entry_->writer && entry_->writer != this;
+  }
 
   // If there is a failure, the cache should have taken care of new_entry_.
   new_entry_ = NULL;
@@ -1227,6 +1252,17 @@ int HttpCache::Transaction::DoCacheReadResponseComplete(int result) {
   if (full_response_length == current_size)
     truncated_ = false;
 
+  // While the entry is being written, it can only be read as it is; anything
+  // that needs the whole body, or an update of the entry, waits for the
+  // writer.
+  if (tailing_ &&
+      (truncated_ || response_.headers->response_code() != 200 ||
+       response_.unused_since_prefetch !=
+           !!(request_->load_flags & LOAD_PREFETCH) ||
+       (mode_ == READ_WRITE && RequiresValidation() != VALIDATION_NONE))) {
+    return StopTailingWriter();
+  }
+
   // The state machine's handling of StopCaching unfortunately doesn't deal well
   // with resources that are larger than 2GB when there is a truncated or sparse
   // cache entry. While the state machine is reworked to resolve this, the
@@ -1764,6 +1800,15 @@ int HttpCache::Transaction::DoCacheReadMetadataComplete(int result) {
 int HttpCache::Transaction::DoNetworkRead() {
   TRACE_EVENT0("io", "HttpCacheTransaction::DoNetworkRead");
   next_state_ = STATE_NETWORK_READ_COMPLETE;
+
+  // Once the body of a complete response is being stored, readers may follow
+  // along. Until the consumer starts reading it, transactions waiting for the
+  // entry are better off restarting if this one goes away.
+  if (entry_ && mode_ == WRITE && !partial_ &&
+      response_.headers->response_code() == 200) {
+    cache_->BeginStreamingEntry(entry_);
+  }
+
   return network_trans_->Read(read_buf_.get(), io_buf_len_, io_callback_);
 }
 
@@ -1823,6 +1868,17 @@ int HttpCache::Transaction::DoCacheReadDataComplete(int result) {
   if (result > 0) {
     read_offset_ += result;
   } else if (result == 0) {  // End of file.
+    if (tailing_) {
+      // This may only be the end of what the writer stored so far.
+      int rv = cache_->WaitForEntryData(entry_, this);
+      if (rv == ERR_IO_PENDING) {
+        next_state_ = STATE_CACHE_READ_DATA;
+        return rv;
+      }
+      tailing_ = false;
+      if (rv != OK)
+        return rv;
+    }
     RecordHistograms();
     cache_->DoneReadingFromEntry(entry_, this);
     entry_ = NULL;
@@ -1874,6 +1930,9 @@ int HttpCache::Transaction::DoCacheWriteDataComplete(int result) {
       done_reading_ = true;
   }
 
+  if (entry_ && result > 0)
+    cache_->NotifyWaitingReaders(entry_);
+
   if (partial_) {
     // This may be the last request.
     if (result != 0 || truncated_ ||
@@ -2565,7 +2624,9 @@ int HttpCache::Transaction::SetupEntryForRead() {
       partial_.reset();
     }
   }
-  cache_->ConvertWriterToReader(entry_);
+  // A transaction that follows the writer is a reader already.
+  if (!tailing_)
+    cache_->ConvertWriterToReader(entry_);
   mode_ = READ;
 
   if (request_->method == "HEAD")
@@ -2576,6 +2637,23 @@ int HttpCache::Transaction::SetupEntryForRead() {
   return OK;
 }
 
+int HttpCache::Transaction::StopTailingWriter() {
+  DCHECK(tailing_);
+  tailing_ = false;
+  wait_for_writer_ = true;
+
+  cache_->RequeueTailingReader(entry_, this);
+  new_entry_ = entry_;
+  entry_ = NULL;
+
+  cache_pending_ = true;
+  next_state_ = STATE_ADD_TO_ENTRY_COMPLETE;
+  net_log_.BeginEvent(NetLogEventType::HTTP_CACHE_ADD_TO_ENTRY);
+  entry_lock_waiting_since_ = TimeTicks::Now();
+  AddCacheLockTimeoutHandler(new_entry_);
+  return ERR_IO_PENDING;
+}
+
 int HttpCache::Transaction::WriteToEntry(int index, int offset,
                                          IOBuffer* data, int data_len,
                                          const CompletionCallback& callback) {
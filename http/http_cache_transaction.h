@@ -109,6 +109,13 @@ class HttpCache::Transaction : public HttpTransaction {
 
   HttpCache::ActiveEntry* entry() { return entry_; }
 
+  // Returns true if the response data stored in the entry is incomplete.
+  bool is_truncated() const { return truncated_; }
+
+  // Returns true if this transaction may start reading the entry while its
+  // writer is still storing the response body.
+  bool CanTailWriter() const;
+
   // Returns the LoadState of the writer transaction of a given ActiveEntry. In
   // other words, returns the LoadState of this transaction without asking the
   // http cache, because this transaction should be the one currently writing
@@ -358,6 +365,11 @@ class HttpCache::Transaction : public HttpTransaction {
   // Setups the transaction for reading from the cache entry.
   int SetupEntryForRead();
 
+  // Called when this transaction joined the entry while it is being written,
+  // but cannot be served from the response that the writer is storing. Goes
+  // back to waiting for the writer to finish, as any other transaction would.
+  int StopTailingWriter();
+
   // Called to write data to the cache entry.  If the write fails, then the
   // cache entry is destroyed.  Future calls to this function will just do
   // nothing without side-effect.  Returns a network error code.
@@ -384,6 +396,10 @@ class HttpCache::Transaction : public HttpTransaction {
   // transaction should be restarted.
   int OnCacheReadError(int result, bool restart);
 
+  // Arranges for the wait for |entry| to end with ERR_CACHE_LOCK_TIMEOUT if
+  // the entry is not available soon enough.
+  void AddCacheLockTimeoutHandler(HttpCache::ActiveEntry* entry);
+
   // Called when the cache lock timeout fires.
   void OnAddToEntryTimeout(base::TimeTicks start_time);
 
@@ -459,6 +475,8 @@ class HttpCache::Transaction : public HttpTransaction {
   bool handling_206_;  // We must deal with this 206 response.
   bool cache_pending_;  // We are waiting for the HttpCache.
   bool done_reading_;  // All available data was read.
+  bool tailing_;  // We are reading the entry while it is being written.
+  bool wait_for_writer_;  // We may not read the entry before it is written.
   bool vary_mismatch_;  // The request doesn't match the stored vary data.
   bool couldnt_conditionalize_request_;
   bool bypass_lock_for_test_;  // A test is exercising the cache lock.
@@ -742,6 +742,29 @@ TEST(HttpCache, SimpleGETNoDiskCache) {
   TestLoadTimingNetworkRequest(load_timing_info);
 }
 
+// Tests that a transaction goes on without the cache when the backend turns
+// down a new entry.
+TEST(HttpCache, SimpleGETEntryNotAdmitted) {
+  MockHttpCache cache;
+  cache.disk_cache()->set_refuse_new_entries(true);
+
+  // Read from the network, and don't use the cache.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(0, cache.disk_cache()->create_count());
+
+  // Once the backend takes the entry, the response is cached.
+  cache.disk_cache()->set_refuse_new_entries(false);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->open_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
 TEST(HttpCache, SimpleGETNoDiskCache2) {
   // This will initialize a cache object with NULL backend.
   std::unique_ptr<MockBlockingBackendFactory> factory(
@@ -1452,11 +1475,11 @@ TEST(HttpCache, SimpleGET_RacingReaders) {
   c->result = c->callback.WaitForResult();
   ReadAndVerifyTransaction(c->trans.get(), kSimpleGET_Transaction);
 
-  // Now we have 2 active readers and two queued transactions.
+  // The other transactions joined the entry as readers while the first one was
+  // writing it.
 
   EXPECT_EQ(LOAD_STATE_IDLE, context_list[2]->trans->GetLoadState());
-  EXPECT_EQ(LOAD_STATE_WAITING_FOR_CACHE,
-            context_list[3]->trans->GetLoadState());
+  EXPECT_EQ(LOAD_STATE_IDLE, context_list[3]->trans->GetLoadState());
 
   c = context_list[1];
   ASSERT_THAT(c->result, IsError(ERR_IO_PENDING));
@@ -1464,10 +1487,9 @@ TEST(HttpCache, SimpleGET_RacingReaders) {
   if (c->result == OK)
     ReadAndVerifyTransaction(c->trans.get(), kSimpleGET_Transaction);
 
-  // At this point we have one reader, two pending transactions and a task on
-  // the queue to move to the next transaction. Now we cancel the request that
-  // is the current reader, and expect the queued task to be able to start the
-  // next request.
+  // At this point we have three readers, and possibly a task on the queue to
+  // process the entry. Now we cancel one of the readers, and expect the others
+  // to be able to finish.
 
   c = context_list[2];
   c->trans.reset();
@@ -1492,6 +1514,101 @@ TEST(HttpCache, SimpleGET_RacingReaders) {
   }
 }
 
+// Tests that a transaction waiting for the entry joins it as a reader once the
+// writer starts reading the body, and reads the body as it is written.
+TEST(HttpCache, SimpleGET_ReaderFollowsWriter) {
+  MockHttpCache cache;
+
+  MockHttpRequest request(kSimpleGET_Transaction);
+  const std::string kBody(kSimpleGET_Transaction.data);
+
+  Context writer, reader;
+  ASSERT_THAT(cache.CreateTransaction(&writer.trans), IsOk());
+  writer.result = writer.trans->Start(&request, writer.callback.callback(),
+                                      NetLogWithSource());
+  ASSERT_THAT(cache.CreateTransaction(&reader.trans), IsOk());
+  reader.result = reader.trans->Start(&request, reader.callback.callback(),
+                                      NetLogWithSource());
+  ASSERT_THAT(writer.callback.GetResult(writer.result), IsOk());
+
+  // The reader waits until the writer reads the body.
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(reader.callback.have_result());
+  EXPECT_EQ(LOAD_STATE_IDLE, reader.trans->GetLoadState());
+
+  scoped_refptr<IOBuffer> buf(new IOBuffer(kBody.size()));
+  int rv = writer.trans->Read(buf.get(), 5, writer.callback.callback());
+  EXPECT_EQ(5, writer.callback.GetResult(rv));
+
+  // Now the reader is served from the entry, without waiting for the rest.
+  ASSERT_THAT(reader.callback.GetResult(reader.result), IsOk());
+  scoped_refptr<IOBuffer> reader_buf(new IOBuffer(kBody.size()));
+  rv = reader.trans->Read(reader_buf.get(), kBody.size(),
+                          reader.callback.callback());
+  ASSERT_EQ(5, reader.callback.GetResult(rv));
+  EXPECT_EQ(kBody.substr(0, 5), std::string(reader_buf->data(), 5));
+
+  // There is nothing else to read until the writer stores more.
+  rv = reader.trans->Read(reader_buf.get(), kBody.size(),
+                          reader.callback.callback());
+  EXPECT_THAT(rv, IsError(ERR_IO_PENDING));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(reader.callback.have_result());
+
+  std::string content;
+  EXPECT_THAT(ReadTransaction(writer.trans.get(), &content), IsOk());
+  EXPECT_EQ(kBody.substr(5), content);
+
+  rv = reader.callback.WaitForResult();
+  ASSERT_GT(rv, 0);
+  std::string reader_content(reader_buf->data(), rv);
+  EXPECT_THAT(ReadTransaction(reader.trans.get(), &content), IsOk());
+  reader_content.append(content);
+  EXPECT_EQ(kBody.substr(5), reader_content);
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+// Tests that a reader that follows the writer fails once it reaches the end of
+// the stored data if the writer goes away before storing the whole body.
+TEST(HttpCache, SimpleGET_ReaderFollowsWriter_WriterCancelled) {
+  MockHttpCache cache;
+
+  MockHttpRequest request(kSimpleGET_Transaction);
+  const std::string kBody(kSimpleGET_Transaction.data);
+
+  std::unique_ptr<Context> writer(new Context);
+  Context reader;
+  ASSERT_THAT(cache.CreateTransaction(&writer->trans), IsOk());
+  writer->result = writer->trans->Start(&request, writer->callback.callback(),
+                                        NetLogWithSource());
+  ASSERT_THAT(cache.CreateTransaction(&reader.trans), IsOk());
+  reader.result = reader.trans->Start(&request, reader.callback.callback(),
+                                      NetLogWithSource());
+  ASSERT_THAT(writer->callback.GetResult(writer->result), IsOk());
+
+  scoped_refptr<IOBuffer> buf(new IOBuffer(kBody.size()));
+  int rv = writer->trans->Read(buf.get(), 5, writer->callback.callback());
+  EXPECT_EQ(5, writer->callback.GetResult(rv));
+  ASSERT_THAT(reader.callback.GetResult(reader.result), IsOk());
+
+  // The response cannot be resumed, so the entry goes away with the writer.
+  writer.reset();
+
+  std::string content;
+  EXPECT_THAT(ReadTransaction(reader.trans.get(), &content),
+              IsError(ERR_CACHE_WRITE_FAILURE));
+  reader.trans.reset();
+
+  // The next request goes to the network.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(2, cache.disk_cache()->create_count());
+}
+
 // Tests that we can doom an entry with pending transactions and delete one of
 // the pending transactions before the first one completes.
 // See http://code.google.com/p/chromium/issues/detail?id=25588
@@ -372,7 +372,7 @@ bool MockDiskEntry::ignore_callbacks_ = false;
 MockDiskCache::MockDiskCache()
     : open_count_(0), create_count_(0), fail_requests_(false),
       soft_failures_(false), double_create_check_(true),
-      fail_sparse_requests_(false) {
+      fail_sparse_requests_(false), refuse_new_entries_(false) {
 }
 
 MockDiskCache::~MockDiskCache() {
@@ -426,6 +426,9 @@ int MockDiskCache::CreateEntry(const std::string& key,
   if (fail_requests_)
     return ERR_CACHE_CREATE_FAILURE;
 
+  if (refuse_new_entries_)
+    return ERR_CACHE_ENTRY_NOT_ADMITTED;
+
   EntryMap::iterator it = entries_.find(key);
   if (it != entries_.end()) {
     if (!it->second->is_doomed()) {
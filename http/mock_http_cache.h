@@ -154,6 +154,10 @@ class MockDiskCache : public disk_cache::Backend {
   // Makes all requests for data ranges to fail as not implemented.
   void set_fail_sparse_requests() { fail_sparse_requests_ = true; }
 
+  // Makes CreateEntry fail with ERR_CACHE_ENTRY_NOT_ADMITTED, like a backend
+  // whose admission filter turns down new entries.
+  void set_refuse_new_entries(bool value) { refuse_new_entries_ = value; }
+
   void ReleaseAll();
 
  private:
@@ -169,6 +173,7 @@ class MockDiskCache : public disk_cache::Backend {
   bool soft_failures_;
   bool double_create_check_;
   bool fail_sparse_requests_;
+  bool refuse_new_entries_;
 };
 
 class MockBackendFactory : public HttpCache::BackendFactory {
@@ -348,6 +348,53 @@ struct ShortCodeInfo {
     {0x7a, 7},  // Match: 0b1111011, Symbol: z
 };
 
+// Number of leading bits of the bit buffer used to index the table returned by
+// GetMultiCodeTable().
+constexpr HuffmanAccumulatorBitCount kMultiCodeLookupBitCount = 12;
+constexpr size_t kMultiCodeTableSize = 1 << kMultiCodeLookupBitCount;
+
+// The maximum number of codes that fit in kMultiCodeLookupBitCount bits.
+constexpr size_t kMaxSymbolsPerMultiCode =
+    kMultiCodeLookupBitCount / kMinCodeBitCount;
+
+// Describes the whole codes at the start of a kMultiCodeLookupBitCount bit
+// sequence.
+struct MultiCodeInfo {
+  uint8_t symbols[kMaxSymbolsPerMultiCode];
+  // Zero if the first code is longer than kMultiCodeLookupBitCount bits.
+  uint8_t symbol_count;
+  // Total length of the codes of |symbols|.
+  uint8_t length;
+};
+
+const MultiCodeInfo* BuildMultiCodeTable() {
+  MultiCodeInfo* table = new MultiCodeInfo[kMultiCodeTableSize]();
+  for (HuffmanCode i = 0; i < kMultiCodeTableSize; ++i) {
+    MultiCodeInfo& info = table[i];
+    HuffmanCode bits = i << (kHuffmanCodeBitCount - kMultiCodeLookupBitCount);
+    while (info.symbol_count < kMaxSymbolsPerMultiCode) {
+      // The ranges of codes of each length tile the whole code space, so
+      // the trailing zero bits can't lead PrefixToInfo astray as long as the
+      // code it finds ends within the looked up bits.
+      PrefixInfo prefix_info = PrefixToInfo(bits);
+      if (info.length + prefix_info.code_length > kMultiCodeLookupBitCount) {
+        break;
+      }
+      uint32_t canonical = prefix_info.DecodeToCanonical(bits);
+      DCHECK_LT(canonical, 256u);
+      info.symbols[info.symbol_count++] = kCanonicalToSymbol[canonical];
+      info.length += prefix_info.code_length;
+      bits <<= prefix_info.code_length;
+    }
+  }
+  return table;
+}
+
+const MultiCodeInfo* GetMultiCodeTable() {
+  static const MultiCodeInfo* const table = BuildMultiCodeTable();
+  return table;
+}
+
 }  // namespace
 
 HuffmanBitBuffer::HuffmanBitBuffer() {
@@ -418,7 +465,7 @@ HpackHuffmanDecoder::HpackHuffmanDecoder() {}
 HpackHuffmanDecoder::~HpackHuffmanDecoder() {}
 
 bool HpackHuffmanDecoder::Decode(StringPiece input, string* output) {
-  return DecodeShortCodesFirst(input, output);
+  return DecodeMultipleSymbols(input, output);
 }
 
 // "Legacy" decoder, used until cl/129771019 submitted, which added
@@ -535,6 +582,72 @@ bool HpackHuffmanDecoder::DecodeShortCodesFirst(StringPiece input,
   }
 }
 
+bool HpackHuffmanDecoder::DecodeMultipleSymbols(StringPiece input,
+                                                string* output) {
+  DVLOG(1) << "HpackHuffmanDecoder::DecodeMultipleSymbols";
+  const MultiCodeInfo* multi_code_table = GetMultiCodeTable();
+
+  // Fill bit_buffer_ from input.
+  input.remove_prefix(bit_buffer_.AppendBytes(input));
+
+  while (true) {
+    DVLOG(3) << "Enter Decode Loop, bit_buffer_: " << bit_buffer_;
+    if (bit_buffer_.count() >= kMultiCodeLookupBitCount) {
+      size_t index = bit_buffer_.value() >>
+                     (kHuffmanAccumulatorBitCount - kMultiCodeLookupBitCount);
+      const MultiCodeInfo& info = multi_code_table[index];
+      if (info.symbol_count > 0) {
+        output->append(reinterpret_cast<const char*>(info.symbols),
+                       info.symbol_count);
+        bit_buffer_.ConsumeBits(info.length);
+        continue;
+      }
+      // The code is more than 12 bits long. Use PrefixToInfo, etc. to decode
+      // longer codes.
+    } else {
+      // We may have (mostly) drained bit_buffer_. If we can top it up, try
+      // using the table decoder above.
+      size_t byte_count = bit_buffer_.AppendBytes(input);
+      if (byte_count > 0) {
+        input.remove_prefix(byte_count);
+        continue;
+      }
+    }
+
+    HuffmanCode code_prefix = bit_buffer_.value() >> kExtraAccumulatorBitCount;
+    DVLOG(3) << "code_prefix: " << HuffmanCodeBitSet(code_prefix);
+
+    PrefixInfo prefix_info = PrefixToInfo(code_prefix);
+    DVLOG(3) << "prefix_info: " << prefix_info;
+    DCHECK_LE(kMinCodeBitCount, prefix_info.code_length);
+    DCHECK_LE(prefix_info.code_length, kMaxCodeBitCount);
+
+    if (prefix_info.code_length <= bit_buffer_.count()) {
+      // We have enough bits for one code.
+      uint32_t canonical = prefix_info.DecodeToCanonical(code_prefix);
+      if (canonical < 256) {
+        // Valid code.
+        char c = kCanonicalToSymbol[canonical];
+        output->push_back(c);
+        bit_buffer_.ConsumeBits(prefix_info.code_length);
+        continue;
+      }
+      // Encoder is not supposed to explicity encode the EOS symbol.
+      DLOG(ERROR) << "EOS explicitly encoded!\n " << bit_buffer_ << "\n "
+                  << prefix_info;
+      return false;
+    }
+    // bit_buffer_ doesn't have enough bits in it to decode the next symbol.
+    // Append to it as many bytes as are available AND fit.
+    size_t byte_count = bit_buffer_.AppendBytes(input);
+    if (byte_count == 0) {
+      DCHECK_EQ(input.size(), 0u);
+      return true;
+    }
+    input.remove_prefix(byte_count);
+  }
+}
+
 string HpackHuffmanDecoder::DebugString() const {
   return bit_buffer_.DebugString();
 }
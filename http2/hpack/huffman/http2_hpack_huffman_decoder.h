@@ -135,6 +135,13 @@ class NET_EXPORT_PRIVATE HpackHuffmanDecoder {
   // TODO(jamessynge): Be precise about that fraction.
   bool DecodeShortCodesFirst(base::StringPiece input, std::string* output);
 
+  // Based on DecodeShortCodesFirst, but looks up the leading 12 bits in a
+  // table that yields every symbol whose code lies entirely within them, so
+  // that runs of short codes are decoded two symbols at a time. Codes longer
+  // than 12 bits are decoded as in DecodeWithIfTreeAndStruct. This is the
+  // implementation used by Decode.
+  bool DecodeMultipleSymbols(base::StringPiece input, std::string* output);
+
  private:
   HuffmanBitBuffer bit_buffer_;
 };
@@ -15,6 +15,9 @@
 #include "net/http2/decoder/decode_status.h"
 #include "net/http2/tools/failure.h"
 #include "net/http2/tools/random_decoder_test.h"
+#include "net/spdy/hpack/hpack_constants.h"
+#include "net/spdy/hpack/hpack_huffman_table.h"
+#include "net/spdy/hpack/hpack_output_stream.h"
 #include "net/spdy/spdy_test_utils.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -148,7 +151,7 @@ TEST(HuffmanBitBufferTest, AppendBytesUnaligned) {
                                   << "\n expected: " << expected;
 }
 
-enum class DecoderChoice { IF_TREE, SHORT_CODE };
+enum class DecoderChoice { IF_TREE, SHORT_CODE, MULTIPLE_SYMBOLS };
 
 class HpackHuffmanDecoderTest
     : public RandomDecoderTest,
@@ -194,6 +197,8 @@ class HpackHuffmanDecoderTest
         return decoder_.DecodeWithIfTreeAndStruct(sp, &output_buffer_);
       case DecoderChoice::SHORT_CODE:
         return decoder_.DecodeShortCodesFirst(sp, &output_buffer_);
+      case DecoderChoice::MULTIPLE_SYMBOLS:
+        return decoder_.DecodeMultipleSymbols(sp, &output_buffer_);
     }
 
     NOTREACHED();
@@ -223,7 +228,8 @@ class HpackHuffmanDecoderTest
 INSTANTIATE_TEST_CASE_P(AllDecoders,
                         HpackHuffmanDecoderTest,
                         ::testing::Values(DecoderChoice::IF_TREE,
-                                          DecoderChoice::SHORT_CODE));
+                                          DecoderChoice::SHORT_CODE,
+                                          DecoderChoice::MULTIPLE_SYMBOLS));
 
 TEST_P(HpackHuffmanDecoderTest, SpecRequestExamples) {
   HpackHuffmanDecoder decoder;
@@ -279,6 +285,22 @@ TEST_P(HpackHuffmanDecoderTest, SpecResponseExamples) {
   }
 }
 
+// Decodes every symbol, next to short and long codes, across fragment
+// boundaries.
+TEST_P(HpackHuffmanDecoderTest, RoundTripAllSymbols) {
+  string plain;
+  for (size_t i = 0; i != 256; i++) {
+    plain.push_back(static_cast<char>(i));
+    plain.append("a0");
+    plain.push_back(static_cast<char>(255 - i));
+  }
+  HpackOutputStream output_stream;
+  ObtainHpackHuffmanTable().EncodeString(plain, &output_stream);
+  string encoded;
+  output_stream.TakeString(&encoded);
+  EXPECT_TRUE(HuffmanDecodeAndValidateSeveralWays(encoded, plain));
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
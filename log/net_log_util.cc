@@ -385,7 +385,7 @@ NET_EXPORT std::unique_ptr<base::DictionaryValue> GetNetInfo(
 
       base::ListValue* entry_list = new base::ListValue();
 
-      for (const auto& pair : cache->entries()) {
+      for (const auto& pair : cache->GetEntries()) {
         const HostCache::Key& key = pair.first;
         const HostCache::Entry& entry = pair.second;
 
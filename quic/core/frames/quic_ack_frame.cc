@@ -4,6 +4,8 @@
 
 #include "net/quic/core/frames/quic_ack_frame.h"
 
+#include <algorithm>
+
 #include "net/quic/core/quic_constants.h"
 #include "net/quic/platform/api/quic_bug_tracker.h"
 
@@ -47,20 +49,76 @@ PacketNumberQueue& PacketNumberQueue::operator=(PacketNumberQueue&& other) =
     default;
 
 void PacketNumberQueue::Add(QuicPacketNumber packet_number) {
-  packet_number_intervals_.Add(packet_number, packet_number + 1);
+  Add(packet_number, packet_number + 1);
 }
 
 void PacketNumberQueue::Add(QuicPacketNumber lower, QuicPacketNumber higher) {
-  packet_number_intervals_.Add(lower, higher);
+  if (lower >= higher) {
+    return;
+  }
+  // Packets nearly always arrive after the ones already in the queue.
+  if (packet_number_intervals_.empty() ||
+      lower > packet_number_intervals_.back().max()) {
+    packet_number_intervals_.push_back(
+        Interval<QuicPacketNumber>(lower, higher));
+    return;
+  }
+  Interval<QuicPacketNumber>& last = packet_number_intervals_.back();
+  if (lower >= last.min()) {
+    last.SetMax(std::max(last.max(), higher));
+    return;
+  }
+
+  // Merge the new interval with every interval it overlaps or touches.
+  auto first = FirstIntervalEndingAtOrAfter(lower);
+  auto it = first;
+  QuicPacketNumber new_min = lower;
+  QuicPacketNumber new_max = higher;
+  while (it != packet_number_intervals_.end() && it->min() <= higher) {
+    new_min = std::min(new_min, it->min());
+    new_max = std::max(new_max, it->max());
+    ++it;
+  }
+  if (first == it) {
+    packet_number_intervals_.insert(
+        first, Interval<QuicPacketNumber>(new_min, new_max));
+    return;
+  }
+  first->Set(new_min, new_max);
+  packet_number_intervals_.erase(first + 1, it);
 }
 
 void PacketNumberQueue::Remove(QuicPacketNumber packet_number) {
-  packet_number_intervals_.Difference(packet_number, packet_number + 1);
+  Remove(packet_number, packet_number + 1);
 }
 
 void PacketNumberQueue::Remove(QuicPacketNumber lower,
                                QuicPacketNumber higher) {
-  packet_number_intervals_.Difference(lower, higher);
+  if (lower >= higher) {
+    return;
+  }
+  // The first interval which ends after |lower|.
+  auto it = FirstIntervalEndingAtOrAfter(lower + 1);
+  while (it != packet_number_intervals_.end() && it->min() < higher) {
+    const QuicPacketNumber interval_min = it->min();
+    const QuicPacketNumber interval_max = it->max();
+    if (interval_min < lower && interval_max > higher) {
+      // Split the interval around the removed packets.
+      it->SetMax(lower);
+      packet_number_intervals_.insert(
+          it + 1, Interval<QuicPacketNumber>(higher, interval_max));
+      return;
+    }
+    if (interval_min < lower) {
+      it->SetMax(lower);
+      ++it;
+    } else if (interval_max > higher) {
+      it->SetMin(higher);
+      return;
+    } else {
+      it = packet_number_intervals_.erase(it);
+    }
+  }
 }
 
 bool PacketNumberQueue::RemoveUpTo(QuicPacketNumber higher) {
@@ -68,41 +126,64 @@ bool PacketNumberQueue::RemoveUpTo(QuicPacketNumber higher) {
     return false;
   }
   const QuicPacketNumber old_min = Min();
-  packet_number_intervals_.Difference(0, higher);
+  while (!packet_number_intervals_.empty() &&
+         packet_number_intervals_.front().max() <= higher) {
+    packet_number_intervals_.pop_front();
+  }
+  if (!packet_number_intervals_.empty() &&
+      packet_number_intervals_.front().min() < higher) {
+    packet_number_intervals_.front().SetMin(higher);
+  }
   return Empty() || old_min != Min();
 }
 
 void PacketNumberQueue::RemoveSmallestInterval() {
-  QUIC_BUG_IF(packet_number_intervals_.Size() < 2)
+  QUIC_BUG_IF(packet_number_intervals_.size() < 2)
       << (Empty() ? "No intervals to remove."
                   : "Can't remove the last interval.");
 
-  packet_number_intervals_.Difference(*packet_number_intervals_.begin());
+  if (!Empty()) {
+    packet_number_intervals_.pop_front();
+  }
 }
 
 void PacketNumberQueue::Complement() {
   if (Empty()) {
     return;
   }
-  packet_number_intervals_.Complement(Min(), Max() + 1);
+  std::deque<Interval<QuicPacketNumber>> gaps;
+  for (size_t i = 1; i < packet_number_intervals_.size(); ++i) {
+    gaps.push_back(Interval<QuicPacketNumber>(
+        packet_number_intervals_[i - 1].max(),
+        packet_number_intervals_[i].min()));
+  }
+  packet_number_intervals_.swap(gaps);
 }
 
 bool PacketNumberQueue::Contains(QuicPacketNumber packet_number) const {
-  return packet_number_intervals_.Contains(packet_number);
+  if (Empty() || packet_number < packet_number_intervals_.front().min() ||
+      packet_number >= packet_number_intervals_.back().max()) {
+    return false;
+  }
+  if (packet_number >= packet_number_intervals_.back().min()) {
+    return true;
+  }
+  auto it = FirstIntervalEndingAtOrAfter(packet_number + 1);
+  return it != packet_number_intervals_.end() && it->Contains(packet_number);
 }
 
 bool PacketNumberQueue::Empty() const {
-  return packet_number_intervals_.Empty();
+  return packet_number_intervals_.empty();
 }
 
 QuicPacketNumber PacketNumberQueue::Min() const {
   DCHECK(!Empty());
-  return packet_number_intervals_.begin()->min();
+  return packet_number_intervals_.front().min();
 }
 
 QuicPacketNumber PacketNumberQueue::Max() const {
   DCHECK(!Empty());
-  return packet_number_intervals_.rbegin()->max() - 1;
+  return packet_number_intervals_.back().max() - 1;
 }
 
 size_t PacketNumberQueue::NumPacketsSlow() const {
@@ -114,29 +195,19 @@ size_t PacketNumberQueue::NumPacketsSlow() const {
 }
 
 size_t PacketNumberQueue::NumIntervals() const {
-  return packet_number_intervals_.Size();
+  return packet_number_intervals_.size();
 }
 
 QuicPacketNumber PacketNumberQueue::LastIntervalLength() const {
   DCHECK(!Empty());
-  return packet_number_intervals_.rbegin()->Length();
+  return packet_number_intervals_.back().Length();
 }
 
 PacketNumberQueue::const_iterator PacketNumberQueue::lower_bound(
     QuicPacketNumber packet_number) const {
   // lower_bound returns the first interval that contains |packet_number| or the
   // first interval after |packet_number|.
-  auto itr = packet_number_intervals_.Find(packet_number);
-  if (itr != packet_number_intervals_.end()) {
-    return itr;
-  }
-  for (itr = packet_number_intervals_.begin();
-       itr != packet_number_intervals_.end(); ++itr) {
-    if (packet_number < itr->min()) {
-      return itr;
-    }
-  }
-  return packet_number_intervals_.end();
+  return FirstIntervalEndingAtOrAfter(packet_number + 1);
 }
 
 PacketNumberQueue::const_iterator PacketNumberQueue::begin() const {
@@ -155,6 +226,24 @@ PacketNumberQueue::const_reverse_iterator PacketNumberQueue::rend() const {
   return packet_number_intervals_.rend();
 }
 
+PacketNumberQueue::const_iterator
+PacketNumberQueue::FirstIntervalEndingAtOrAfter(QuicPacketNumber max) const {
+  return std::lower_bound(
+      packet_number_intervals_.begin(), packet_number_intervals_.end(), max,
+      [](const Interval<QuicPacketNumber>& interval, QuicPacketNumber value) {
+        return interval.max() < value;
+      });
+}
+
+PacketNumberQueue::iterator PacketNumberQueue::FirstIntervalEndingAtOrAfter(
+    QuicPacketNumber max) {
+  return std::lower_bound(
+      packet_number_intervals_.begin(), packet_number_intervals_.end(), max,
+      [](const Interval<QuicPacketNumber>& interval, QuicPacketNumber value) {
+        return interval.max() < value;
+      });
+}
+
 std::ostream& operator<<(std::ostream& os, const PacketNumberQueue& q) {
   for (const Interval<QuicPacketNumber>& interval : q) {
     for (QuicPacketNumber packet_number = interval.min();
@@ -5,6 +5,7 @@
 #ifndef NET_QUIC_CORE_FRAMES_QUIC_ACK_FRAME_H_
 #define NET_QUIC_CORE_FRAMES_QUIC_ACK_FRAME_H_
 
+#include <deque>
 #include <ostream>
 #include <string>
 
@@ -18,11 +19,15 @@ namespace net {
 // A sequence of packet numbers where each number is unique. Intended to be used
 // in a sliding window fashion, where smaller old packet numbers are removed and
 // larger new packet numbers are added, with the occasional random access.
+// The numbers are kept as a sorted run of disjoint, non-adjacent intervals, so
+// adding or removing at either end, where nearly all changes happen, does not
+// touch the intervals in between.
 class QUIC_EXPORT_PRIVATE PacketNumberQueue {
  public:
-  using const_iterator = QuicIntervalSet<QuicPacketNumber>::const_iterator;
+  using const_iterator =
+      std::deque<Interval<QuicPacketNumber>>::const_iterator;
   using const_reverse_iterator =
-      QuicIntervalSet<QuicPacketNumber>::const_reverse_iterator;
+      std::deque<Interval<QuicPacketNumber>>::const_reverse_iterator;
 
   PacketNumberQueue();
   PacketNumberQueue(const PacketNumberQueue& other);
@@ -95,7 +100,14 @@ class QUIC_EXPORT_PRIVATE PacketNumberQueue {
       const PacketNumberQueue& q);
 
  private:
-  QuicIntervalSet<QuicPacketNumber> packet_number_intervals_;
+  using iterator = std::deque<Interval<QuicPacketNumber>>::iterator;
+
+  // Returns the first interval whose end, one past its largest packet number,
+  // is at least |max|, or end() if there is none.
+  const_iterator FirstIntervalEndingAtOrAfter(QuicPacketNumber max) const;
+  iterator FirstIntervalEndingAtOrAfter(QuicPacketNumber max);
+
+  std::deque<Interval<QuicPacketNumber>> packet_number_intervals_;
 };
 
 struct QUIC_EXPORT_PRIVATE QuicAckFrame {
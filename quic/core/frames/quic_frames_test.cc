@@ -297,6 +297,63 @@ TEST(PacketNumberQueueTest, Complement) {
   EXPECT_TRUE(queue.Contains(21));
 }
 
+// Tests that adding packets out of order merges the intervals they join.
+TEST(PacketNumberQueueTest, AddOutOfOrder) {
+  PacketNumberQueue queue;
+  queue.Add(1, 10);
+  queue.Add(20, 30);
+  queue.Add(40, 50);
+  queue.Add(60, 70);
+
+  // Fills part of a gap.
+  queue.Add(12, 15);
+  EXPECT_EQ(5u, queue.NumIntervals());
+  EXPECT_FALSE(queue.Contains(11));
+  EXPECT_TRUE(queue.Contains(12));
+
+  // Touches the intervals on either side.
+  queue.Add(10, 12);
+  EXPECT_EQ(4u, queue.NumIntervals());
+  EXPECT_TRUE(queue.Contains(11));
+
+  // Covers two intervals and the gaps around them.
+  queue.Add(18, 55);
+  EXPECT_EQ(3u, queue.NumIntervals());
+
+  const std::vector<Interval<QuicPacketNumber>> actual_intervals(queue.begin(),
+                                                                 queue.end());
+  std::vector<Interval<QuicPacketNumber>> expected_intervals;
+  expected_intervals.push_back(Interval<QuicPacketNumber>(1, 15));
+  expected_intervals.push_back(Interval<QuicPacketNumber>(18, 55));
+  expected_intervals.push_back(Interval<QuicPacketNumber>(60, 70));
+  EXPECT_EQ(expected_intervals, actual_intervals);
+  EXPECT_EQ(14u + 37u + 10u, queue.NumPacketsSlow());
+}
+
+// Tests that removing packets from the middle of an interval splits it.
+TEST(PacketNumberQueueTest, RemoveSplitsInterval) {
+  PacketNumberQueue queue;
+  queue.Add(1, 100);
+  queue.Remove(40, 60);
+  EXPECT_EQ(2u, queue.NumIntervals());
+  EXPECT_TRUE(queue.Contains(39));
+  EXPECT_FALSE(queue.Contains(40));
+  EXPECT_FALSE(queue.Contains(59));
+  EXPECT_TRUE(queue.Contains(60));
+
+  // Removing packets which are not in the queue does nothing.
+  queue.Remove(45, 55);
+  EXPECT_EQ(2u, queue.NumIntervals());
+  EXPECT_EQ(79u, queue.NumPacketsSlow());
+
+  // Removes the end of one interval and the start of the next.
+  queue.Remove(30, 70);
+  EXPECT_EQ(2u, queue.NumIntervals());
+  EXPECT_EQ(1u, queue.Min());
+  EXPECT_EQ(99u, queue.Max());
+  EXPECT_EQ(59u, queue.NumPacketsSlow());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
@@ -22,6 +22,10 @@ UniqueStreamBuffer NewStreamBuffer(QuicBufferAllocator* allocator,
                             StreamBufferDeleter(allocator));
 }
 
+QuicReceivedPacketBuffer::QuicReceivedPacketBuffer() : held_(false) {}
+
+QuicReceivedPacketBuffer::~QuicReceivedPacketBuffer() {}
+
 QuicStreamFrame::QuicStreamFrame()
     : QuicStreamFrame(0, false, 0, nullptr, 0, nullptr) {}
 
@@ -10,8 +10,10 @@
 
 #include "base/strings/string_piece.h"
 #include "net/quic/core/quic_buffer_allocator.h"
+#include "net/quic/core/quic_constants.h"
 #include "net/quic/core/quic_types.h"
 #include "net/quic/platform/api/quic_export.h"
+#include "net/quic/platform/api/quic_reference_counted.h"
 
 namespace net {
 
@@ -39,6 +41,31 @@ using UniqueStreamBuffer = std::unique_ptr<char[], StreamBufferDeleter>;
 QUIC_EXPORT_PRIVATE UniqueStreamBuffer
 NewStreamBuffer(QuicBufferAllocator* allocator, size_t size);
 
+// A reference counted buffer which a received packet is decrypted into. The
+// stream frames parsed from the packet point into it, so a stream can keep the
+// data of a frame by holding a reference to the buffer instead of copying it.
+class QUIC_EXPORT_PRIVATE QuicReceivedPacketBuffer
+    : public QuicReferenceCounted {
+ public:
+  QuicReceivedPacketBuffer();
+
+  char* data() { return data_; }
+  size_t length() const { return sizeof(data_); }
+
+  // Records that a reference to this buffer is kept after its packet has been
+  // processed, so it must not be reused for the next packet.
+  void MarkHeld() { held_ = true; }
+  bool held() const { return held_; }
+
+ private:
+  ~QuicReceivedPacketBuffer() override;
+
+  bool held_;
+  char data_[kMaxPacketSize];
+
+  DISALLOW_COPY_AND_ASSIGN(QuicReceivedPacketBuffer);
+};
+
 struct QUIC_EXPORT_PRIVATE QuicStreamFrame {
   QuicStreamFrame();
   QuicStreamFrame(QuicStreamId stream_id,
@@ -62,6 +89,9 @@ struct QUIC_EXPORT_PRIVATE QuicStreamFrame {
   QuicStreamOffset offset;  // Location of this data in the stream.
   // nullptr when the QuicStreamFrame is received, and non-null when sent.
   UniqueStreamBuffer buffer;
+  // Set when the QuicStreamFrame is received and |data_buffer| points into
+  // this packet buffer, which may be held to keep the data without a copy.
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet_buffer;
 
  private:
   QuicStreamFrame(QuicStreamId stream_id,
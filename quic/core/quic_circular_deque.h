@@ -0,0 +1,193 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A double ended queue of T stored in one power of two sized ring buffer.
+// Unlike std::deque, every element is reached without going through a block
+// map, and elements which are next to each other in the queue are next to
+// each other in memory (except where the ring wraps around), which makes
+// walking a range of it cache friendly.  Growing the ring moves every element,
+// so references and iterators are invalidated by push_back; pop_front only
+// invalidates those to the front element.
+
+#ifndef NET_QUIC_CORE_QUIC_CIRCULAR_DEQUE_H_
+#define NET_QUIC_CORE_QUIC_CIRCULAR_DEQUE_H_
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace net {
+
+template <typename T>
+class QuicCircularDeque {
+ private:
+  // Iterates over the elements of a QuicCircularDeque from front to back.
+  template <typename Deque, typename Value>
+  class Iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value* pointer;
+    typedef Value& reference;
+
+    Iterator() : deque_(nullptr), index_(0) {}
+    Iterator(Deque* deque, size_t index) : deque_(deque), index_(index) {}
+    // Allows an iterator to be converted to a const_iterator.
+    template <typename OtherDeque, typename OtherValue>
+    Iterator(const Iterator<OtherDeque, OtherValue>& other)  // NOLINT
+        : deque_(other.deque_), index_(other.index_) {}
+
+    reference operator*() const { return (*deque_)[index_]; }
+    pointer operator->() const { return &(*deque_)[index_]; }
+
+    Iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator result = *this;
+      ++index_;
+      return result;
+    }
+    Iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator result = *this;
+      --index_;
+      return result;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return deque_ == other.deque_ && index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    template <typename OtherDeque, typename OtherValue>
+    friend class Iterator;
+
+    Deque* deque_;
+    // The position from the front of the queue.
+    size_t index_;
+  };
+
+ public:
+  typedef Iterator<QuicCircularDeque, T> iterator;
+  typedef Iterator<const QuicCircularDeque, const T> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  QuicCircularDeque() : capacity_(0), head_(0), size_(0) {}
+
+  ~QuicCircularDeque() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  // The number of elements which fit before the ring has to grow.
+  size_t capacity() const { return capacity_; }
+
+  T& operator[](size_t index) {
+    DCHECK_LT(index, size_);
+    return *Slot(index);
+  }
+  const T& operator[](size_t index) const {
+    DCHECK_LT(index, size_);
+    return *Slot(index);
+  }
+  T& at(size_t index) {
+    CHECK_LT(index, size_);
+    return *Slot(index);
+  }
+  const T& at(size_t index) const {
+    CHECK_LT(index, size_);
+    return *Slot(index);
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      Grow();
+    }
+    new (Slot(size_)) T(std::forward<Args>(args)...);
+    ++size_;
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  void pop_front() {
+    DCHECK(!empty());
+    Slot(0)->~T();
+    head_ = (head_ + 1) & (capacity_ - 1);
+    --size_;
+  }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  // The initial capacity, which must be a power of two.
+  static const size_t kInitialCapacity = 16;
+
+  T* Slot(size_t index) const {
+    return reinterpret_cast<T*>(&storage_[(head_ + index) & (capacity_ - 1)]);
+  }
+
+  // Doubles the capacity, moving the elements to the front of the new ring.
+  void Grow() {
+    const size_t capacity =
+        capacity_ == 0 ? kInitialCapacity : capacity_ * 2;
+    std::unique_ptr<Storage[]> storage(new Storage[capacity]);
+    for (size_t i = 0; i < size_; ++i) {
+      T* slot = Slot(i);
+      new (&storage[i]) T(std::move(*slot));
+      slot->~T();
+    }
+    storage_ = std::move(storage);
+    capacity_ = capacity;
+    head_ = 0;
+  }
+
+  std::unique_ptr<Storage[]> storage_;
+  size_t capacity_;
+  // The slot of the front element.
+  size_t head_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicCircularDeque);
+};
+
+}  // namespace net
+
+#endif  // NET_QUIC_CORE_QUIC_CIRCULAR_DEQUE_H_
@@ -0,0 +1,100 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/core/quic_circular_deque.h"
+
+#include <memory>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+TEST(QuicCircularDequeTest, PushAndPop) {
+  QuicCircularDeque<int> deque;
+  EXPECT_TRUE(deque.empty());
+  for (int i = 0; i < 10; ++i) {
+    deque.push_back(i);
+  }
+  EXPECT_EQ(10u, deque.size());
+  EXPECT_EQ(0, deque.front());
+  EXPECT_EQ(9, deque.back());
+
+  deque.pop_front();
+  deque.pop_front();
+  EXPECT_EQ(8u, deque.size());
+  EXPECT_EQ(2, deque.front());
+  EXPECT_EQ(5, deque[3]);
+  EXPECT_EQ(5, deque.at(3));
+}
+
+TEST(QuicCircularDequeTest, WrapsAroundAndGrows) {
+  QuicCircularDeque<int> deque;
+  int next_pushed = 0;
+  int next_popped = 0;
+  // Keep the queue a little short of full, so that it wraps around the ring
+  // many times before it has to grow.
+  for (int i = 0; i < 100; ++i) {
+    deque.push_back(next_pushed++);
+    if (deque.size() > 10) {
+      EXPECT_EQ(next_popped++, deque.front());
+      deque.pop_front();
+    }
+  }
+  const size_t capacity = deque.capacity();
+  EXPECT_LT(deque.size(), capacity);
+
+  // Grow it while the front is in the middle of the ring.
+  while (deque.size() <= capacity) {
+    deque.push_back(next_pushed++);
+  }
+  EXPECT_EQ(2 * capacity, deque.capacity());
+  for (size_t i = 0; i < deque.size(); ++i) {
+    EXPECT_EQ(next_popped + static_cast<int>(i), deque[i]);
+  }
+}
+
+TEST(QuicCircularDequeTest, Iterators) {
+  QuicCircularDeque<int> deque;
+  for (int i = 0; i < 20; ++i) {
+    deque.push_back(i);
+  }
+  for (int i = 0; i < 5; ++i) {
+    deque.pop_front();
+  }
+
+  int expected = 5;
+  for (QuicCircularDeque<int>::iterator it = deque.begin(); it != deque.end();
+       ++it) {
+    EXPECT_EQ(expected++, *it);
+    *it *= 2;
+  }
+  EXPECT_EQ(20, expected);
+
+  const QuicCircularDeque<int>& const_deque = deque;
+  std::vector<int> reversed(const_deque.rbegin(), const_deque.rend());
+  ASSERT_EQ(15u, reversed.size());
+  EXPECT_EQ(38, reversed.front());
+  EXPECT_EQ(10, reversed.back());
+}
+
+TEST(QuicCircularDequeTest, MovesAndDestroysElements) {
+  QuicCircularDeque<std::unique_ptr<int>> deque;
+  for (int i = 0; i < 100; ++i) {
+    deque.push_back(std::unique_ptr<int>(new int(i)));
+  }
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(i, *deque.front());
+    deque.pop_front();
+  }
+  EXPECT_EQ(99, *deque.back());
+  // The remaining elements are destroyed with the queue, which is checked by
+  // the leak checkers.
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
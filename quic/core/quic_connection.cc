@@ -782,6 +782,15 @@ const char* QuicConnection::ValidateAckFrame(const QuicAckFrame& incoming_ack) {
     return "Largest observed too high.";
   }
 
+  if (incoming_ack.largest_observed >
+      sent_packet_manager_.GetLargestSentPacket()) {
+    QUIC_DLOG(WARNING) << ENDPOINT << "Peer's observed queued packet:"
+                       << incoming_ack.largest_observed << " vs "
+                       << sent_packet_manager_.GetLargestSentPacket();
+    // Packets which are serialized but still queued have not been sent.
+    return "Largest observed too high.";
+  }
+
   if (incoming_ack.largest_observed <
       sent_packet_manager_.GetLargestObserved()) {
     QUIC_LOG(INFO) << ENDPOINT << "Peer's largest_observed packet decreased:"
@@ -1250,6 +1259,7 @@ void QuicConnection::OnCanWrite() {
   // we had queued and we're still not blocked, let the visitor know it can
   // write more.
   if (!CanWrite(HAS_RETRANSMITTABLE_DATA)) {
+    FlushWriterIfBatchMode();
     return;
   }
 
@@ -1268,6 +1278,30 @@ void QuicConnection::OnCanWrite() {
     // other connections and events have had a chance to use the thread.
     resume_writes_alarm_->Set(clock_->ApproximateNow());
   }
+  FlushWriterIfBatchMode();
+}
+
+void QuicConnection::FlushWriterIfBatchMode() {
+  if (!writer_->IsBatchMode() || writer_->IsWriteBlocked()) {
+    return;
+  }
+  WriteResult result = writer_->Flush();
+  if (result.status == WRITE_STATUS_BLOCKED) {
+    visitor_->OnWriteBlocked();
+    return;
+  }
+  // Only MTU probes are larger than |long_term_mtu_|, so while one may be
+  // outstanding EMSGSIZE means the probe failed, as in WritePacket.
+  if (result.status == WRITE_STATUS_ERROR &&
+      result.error_code == kMessageTooBigErrorCode &&
+      mtu_discovery_target_ > long_term_mtu_) {
+    mtu_discovery_target_ = 0;
+    mtu_discovery_alarm_->Cancel();
+    return;
+  }
+  if (result.status == WRITE_STATUS_ERROR) {
+    OnWriteError(result.error_code);
+  }
 }
 
 void QuicConnection::WriteIfNotBlocked() {
@@ -1392,8 +1426,6 @@ void QuicConnection::WritePendingRetransmissions() {
   // Keep writing as long as there's a pending retransmission which can be
   // written.
   while (sent_packet_manager_.HasPendingRetransmissions()) {
-    const QuicPendingRetransmission pending =
-        sent_packet_manager_.NextPendingRetransmission();
     if (!CanWrite(HAS_RETRANSMITTABLE_DATA)) {
       break;
     }
@@ -1401,10 +1433,14 @@ void QuicConnection::WritePendingRetransmissions() {
     // Re-packetize the frames with a new packet number for retransmission.
     // Retransmitted packets use the same packet number length as the
     // original.
-    // Flush the packet generator before making a new packet.
+    // Flush the packet generator before making a new packet.  This is done
+    // before getting the pending retransmission, which refers to frames held
+    // by the unacked packet map, because sending may move them.
     // TODO(ianswett): Implement ReserializeAllFrames as a separate path that
     // does not require the creator to be flushed.
     packet_generator_.FlushAllQueuedFrames();
+    const QuicPendingRetransmission pending =
+        sent_packet_manager_.NextPendingRetransmission();
     char buffer[kMaxPacketSize];
     packet_generator_.ReserializeAllFrames(pending, buffer, kMaxPacketSize);
   }
@@ -1677,6 +1713,12 @@ void QuicConnection::OnSerializedPacket(SerializedPacket* serialized_packet) {
   SendOrQueuePacket(serialized_packet);
 }
 
+char* QuicConnection::GetPacketBuffer() {
+  // A packet serialized into the writer's batch is not copied when it is
+  // written, and is copied out by SendOrQueuePacket if it is queued instead.
+  return writer_->GetNextWriteLocation();
+}
+
 void QuicConnection::OnUnrecoverableError(QuicErrorCode error,
                                           const string& error_details,
                                           ConnectionCloseSource source) {
@@ -2200,6 +2242,9 @@ QuicConnection::ScopedPacketBundler::~ScopedPacketBundler() {
     //     1 ms, the caller should send at least 125k bytes in order to not
     //     be marked as application-limited.
     connection_->CheckIfApplicationLimited();
+
+    // Let a batch mode writer send everything written within this bundler.
+    connection_->FlushWriterIfBatchMode();
   }
   DCHECK_EQ(already_in_batch_mode_,
             connection_->packet_generator_.InBatchMode());
@@ -2282,6 +2327,10 @@ void QuicConnection::SendMtuDiscoveryPacket(QuicByteCount target_mtu) {
 
   // Send the probe.
   packet_generator_.GenerateMtuDiscoveryPacket(target_mtu, nullptr);
+
+  // A batch mode writer only finds out that the probe is too big when it
+  // sends it, so do that now rather than leaving it for the next write.
+  FlushWriterIfBatchMode();
 }
 
 void QuicConnection::DiscoverMtu() {
@@ -461,6 +461,7 @@ class QUIC_EXPORT_PRIVATE QuicConnection
 
   // QuicPacketCreator::DelegateInterface
   void OnSerializedPacket(SerializedPacket* packet) override;
+  char* GetPacketBuffer() override;
 
   // QuicSentPacketManager::NetworkChangeVisitor
   void OnCongestionChange() override;
@@ -790,6 +791,10 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // Writes as many pending retransmissions as possible.
   void WritePendingRetransmissions();
 
+  // Sends the packets a batch mode writer is holding for this connection, if
+  // any.  Called once the connection is done writing for now.
+  void FlushWriterIfBatchMode();
+
   // Queues |packet| in the hopes that it can be decrypted in the
   // future, when a new key is installed.
   void QueueUndecryptablePacket(const QuicEncryptedPacket& packet);
@@ -286,7 +286,11 @@ class TestPacketWriter : public QuicPacketWriter {
         packets_write_attempts_(0),
         clock_(clock),
         write_pause_time_delta_(QuicTime::Delta::Zero()),
-        max_packet_size_(kMaxPacketSize) {}
+        max_packet_size_(kMaxPacketSize),
+        batch_mode_(false),
+        flush_count_(0),
+        write_attempts_at_last_flush_(0),
+        next_flush_error_(0) {}
 
   // QuicPacketWriter interface
   WriteResult WritePacket(const char* buffer,
@@ -352,6 +356,33 @@ class TestPacketWriter : public QuicPacketWriter {
     return max_packet_size_;
   }
 
+  bool IsBatchMode() const override { return batch_mode_; }
+
+  WriteResult Flush() override {
+    ++flush_count_;
+    write_attempts_at_last_flush_ = packets_write_attempts_;
+    if (next_flush_error_ != 0) {
+      int error_code = next_flush_error_;
+      next_flush_error_ = 0;
+      return WriteResult(WRITE_STATUS_ERROR, error_code);
+    }
+    return WriteResult(WRITE_STATUS_OK, 0);
+  }
+
+  // Makes the next Flush report that a buffered packet failed with
+  // |error_code|.
+  void SimulateNextFlushError(int error_code) {
+    next_flush_error_ = error_code;
+  }
+
+  void set_batch_mode(bool batch_mode) { batch_mode_ = batch_mode; }
+
+  uint32_t flush_count() const { return flush_count_; }
+
+  uint32_t write_attempts_at_last_flush() const {
+    return write_attempts_at_last_flush_;
+  }
+
   void BlockOnNextWrite() { block_on_next_write_ = true; }
 
   void SimulateNextPacketTooLarge() { next_packet_too_large_ = true; }
@@ -452,6 +483,10 @@ class TestPacketWriter : public QuicPacketWriter {
   // time.
   QuicTime::Delta write_pause_time_delta_;
   QuicByteCount max_packet_size_;
+  bool batch_mode_;
+  uint32_t flush_count_;
+  uint32_t write_attempts_at_last_flush_;
+  int next_flush_error_;
 
   DISALLOW_COPY_AND_ASSIGN(TestPacketWriter);
 };
@@ -1603,6 +1638,23 @@ TEST_P(QuicConnectionTest, AckUnsentData) {
   ProcessAckPacket(&frame);
 }
 
+TEST_P(QuicConnectionTest, AckQueuedData) {
+  // Ack a packet which has been serialized, but is queued behind a blocked
+  // writer and has not been sent.
+  BlockOnNextWrite();
+  connection_.SendStreamDataWithString(1, "foo", 0, !kFin, nullptr);
+  EXPECT_EQ(1u, connection_.NumQueuedPackets());
+
+  EXPECT_CALL(visitor_, OnConnectionClosed(QUIC_INVALID_ACK_DATA, _,
+                                           ConnectionCloseSource::FROM_SELF));
+  EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
+  EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _))
+      .Times(AnyNumber());
+  QuicAckFrame frame(MakeAckFrame(1));
+  ProcessAckPacket(&frame);
+  EXPECT_FALSE(connection_.connected());
+}
+
 TEST_P(QuicConnectionTest, AckAll) {
   EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
   ProcessPacket(1);
@@ -1964,6 +2016,40 @@ TEST_P(QuicConnectionTest, OnCanWrite) {
   EXPECT_EQ(kClientDataStreamId2, writer_->stream_frames()[1]->stream_id);
 }
 
+TEST_P(QuicConnectionTest, OnCanWriteFlushesBatchModeWriter) {
+  writer_->set_batch_mode(true);
+  EXPECT_CALL(visitor_, OnCanWrite())
+      .WillOnce(DoAll(IgnoreResult(InvokeWithoutArgs(
+                          &connection_, &TestConnection::SendStreamData3)),
+                      IgnoreResult(InvokeWithoutArgs(
+                          &connection_, &TestConnection::SendStreamData5))));
+  EXPECT_CALL(visitor_, WillingAndAbleToWrite()).WillRepeatedly(Return(false));
+  EXPECT_CALL(*send_algorithm_, TimeUntilSend(_, _))
+      .WillRepeatedly(testing::Return(QuicTime::Delta::Zero()));
+
+  connection_.OnCanWrite();
+
+  // Everything written was followed by a flush.
+  EXPECT_LT(0u, writer_->packets_write_attempts());
+  EXPECT_LT(0u, writer_->flush_count());
+  EXPECT_EQ(writer_->packets_write_attempts(),
+            writer_->write_attempts_at_last_flush());
+}
+
+TEST_P(QuicConnectionTest, NoFlushWithoutBatchModeWriter) {
+  EXPECT_CALL(visitor_, OnCanWrite())
+      .WillOnce(IgnoreResult(
+          InvokeWithoutArgs(&connection_, &TestConnection::SendStreamData3)));
+  EXPECT_CALL(visitor_, WillingAndAbleToWrite()).WillRepeatedly(Return(false));
+  EXPECT_CALL(*send_algorithm_, TimeUntilSend(_, _))
+      .WillRepeatedly(testing::Return(QuicTime::Delta::Zero()));
+
+  connection_.OnCanWrite();
+
+  EXPECT_LT(0u, writer_->packets_write_attempts());
+  EXPECT_EQ(0u, writer_->flush_count());
+}
+
 TEST_P(QuicConnectionTest, RetransmitOnNack) {
   QuicPacketNumber last_packet;
   QuicByteCount second_packet_size;
@@ -3158,6 +3244,38 @@ TEST_P(QuicConnectionTest, MtuDiscoveryWriterLimited) {
   EXPECT_EQ(1u, connection_.mtu_probe_count());
 }
 
+// Tests that a batch mode writer is flushed right after an MTU probe, and that
+// the probe failing with EMSGSIZE at flush time stops MTU discovery without
+// closing the connection.
+TEST_P(QuicConnectionTest, MtuDiscoveryBatchFlushFailed) {
+  EXPECT_TRUE(connection_.connected());
+  writer_->set_batch_mode(true);
+  connection_.EnablePathMtuDiscovery(send_algorithm_);
+
+  // Send enough packets so that the next one triggers path MTU discovery.
+  for (QuicPacketCount i = 0; i < kPacketsBetweenMtuProbesBase - 1; i++) {
+    SendStreamDataToPeer(3, ".", i, /*fin=*/false, nullptr);
+    ASSERT_FALSE(connection_.GetMtuDiscoveryAlarm()->IsSet());
+  }
+
+  // Trigger the probe.
+  SendStreamDataToPeer(3, "!", kPacketsBetweenMtuProbesBase,
+                       /*fin=*/false, nullptr);
+  ASSERT_TRUE(connection_.GetMtuDiscoveryAlarm()->IsSet());
+  writer_->SimulateNextFlushError(kMessageTooBigErrorCode);
+  connection_.GetMtuDiscoveryAlarm()->Fire();
+  EXPECT_EQ(writer_->packets_write_attempts(),
+            writer_->write_attempts_at_last_flush());
+  ASSERT_TRUE(connection_.connected());
+
+  // No more probes are sent.
+  for (QuicPacketCount i = 0; i < 4 * kPacketsBetweenMtuProbesBase; i++) {
+    connection_.EnsureWritableAndSendStreamData5();
+    ASSERT_FALSE(connection_.GetMtuDiscoveryAlarm()->IsSet());
+  }
+  EXPECT_EQ(1u, connection_.mtu_probe_count());
+}
+
 // Tests whether MTU discovery works when the writer returns an error despite
 // advertising higher packet length.
 TEST_P(QuicConnectionTest, MtuDiscoveryWriterFailed) {
@@ -165,3 +165,9 @@ QUIC_FLAG(bool, FLAGS_quic_reloadable_flag_quic_no_stop_waiting_frames, false)
 
 // Allows one self address change.
 QUIC_FLAG(bool, FLAGS_quic_reloadable_flag_quic_allow_one_address_change, false)
+
+// If true, received packets are decrypted into reference counted buffers,
+// which streams hold on to instead of copying the data of in order frames.
+QUIC_FLAG(bool,
+          FLAGS_quic_reloadable_flag_quic_hold_received_stream_data,
+          false)
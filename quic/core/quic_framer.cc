@@ -527,6 +527,22 @@ bool QuicFramer::ProcessPacket(const QuicEncryptedPacket& packet) {
     rv = ProcessVersionNegotiationPacket(&reader, &public_header);
   } else if (public_header.reset_flag) {
     rv = ProcessPublicResetPacket(&reader, public_header);
+  } else if (packet.length() <= kMaxPacketSize &&
+             FLAGS_quic_reloadable_flag_quic_hold_received_stream_data) {
+    // Decrypt into a reference counted buffer, so that streams can hold on to
+    // the data of in order stream frames instead of copying it.
+    QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet_buffer =
+        std::move(spare_packet_buffer_);
+    if (packet_buffer == nullptr) {
+      packet_buffer = new QuicReceivedPacketBuffer();
+    }
+    current_packet_buffer_ = packet_buffer;
+    rv = ProcessDataPacket(&reader, public_header, packet,
+                           packet_buffer->data(), packet_buffer->length());
+    current_packet_buffer_ = nullptr;
+    if (!packet_buffer->held()) {
+      spare_packet_buffer_ = std::move(packet_buffer);
+    }
   } else if (packet.length() <= kMaxPacketSize) {
     // The optimized decryption algorithm implementations run faster when
     // operating on aligned memory.
@@ -978,6 +994,7 @@ bool QuicFramer::ProcessFrameData(QuicDataReader* reader,
         if (!ProcessStreamFrame(reader, frame_type, &frame)) {
           return RaiseError(QUIC_INVALID_STREAM_DATA);
         }
+        frame.packet_buffer = current_packet_buffer_;
         if (!visitor_->OnStreamFrame(frame)) {
           QUIC_DVLOG(1) << ENDPOINT
                         << "Visitor asked to stop further processing.";
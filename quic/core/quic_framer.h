@@ -520,6 +520,11 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   QuicTime::Delta last_timestamp_;
   // The diversification nonce from the last received packet.
   DiversificationNonce last_nonce_;
+  // The buffer the packet being processed was decrypted into, if it was
+  // decrypted into a QuicReceivedPacketBuffer. Stream frames refer to it.
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> current_packet_buffer_;
+  // A buffer which no stream held on to, to decrypt the next packet into.
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> spare_packet_buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(QuicFramer);
 };
@@ -3593,6 +3593,45 @@ TEST_P(QuicFramerTest, ConstructEncryptedPacket) {
   EXPECT_EQ(QUIC_NO_ERROR, framer_.error());
 }
 
+static bool ExpectedStreamFrameInPacketBuffer(const QuicStreamFrame& frame) {
+  return ExpectedStreamFrame(frame) && frame.packet_buffer != nullptr &&
+         frame.data_buffer >= frame.packet_buffer->data() &&
+         frame.data_buffer + frame.data_length <=
+             frame.packet_buffer->data() + frame.packet_buffer->length();
+}
+
+// Verify that stream frames point into a reference counted packet buffer when
+// received stream data may be held.
+TEST_P(QuicFramerTest, StreamFrameInPacketBuffer) {
+  FLAGS_quic_reloadable_flag_quic_hold_received_stream_data = true;
+  framer_.SetDecrypter(ENCRYPTION_NONE,
+                       new NullDecrypter(framer_.perspective()));
+  framer_.SetEncrypter(ENCRYPTION_NONE,
+                       new NullEncrypter(framer_.perspective()));
+  QuicVersionVector versions;
+  versions.push_back(framer_.version());
+  std::unique_ptr<QuicEncryptedPacket> packet(ConstructEncryptedPacket(
+      42, false, false, false, kTestQuicStreamId, kTestString,
+      PACKET_8BYTE_CONNECTION_ID, PACKET_6BYTE_PACKET_NUMBER, &versions));
+
+  MockFramerVisitor visitor;
+  framer_.set_visitor(&visitor);
+  EXPECT_CALL(visitor, OnPacket());
+  EXPECT_CALL(visitor, OnUnauthenticatedPublicHeader(_))
+      .WillOnce(Return(true));
+  EXPECT_CALL(visitor, OnUnauthenticatedHeader(_)).WillOnce(Return(true));
+  EXPECT_CALL(visitor, OnPacketHeader(_)).WillOnce(Return(true));
+  EXPECT_CALL(visitor, OnDecryptedPacket(_));
+  EXPECT_CALL(visitor, OnError(_)).Times(0);
+  EXPECT_CALL(visitor, OnStreamFrame(_)).Times(0);
+  EXPECT_CALL(visitor, OnStreamFrame(Truly(ExpectedStreamFrameInPacketBuffer)))
+      .Times(1);
+  EXPECT_CALL(visitor, OnPacketComplete());
+
+  EXPECT_TRUE(framer_.ProcessPacket(*packet));
+  EXPECT_EQ(QUIC_NO_ERROR, framer_.error());
+}
+
 // Verify that the packet returned by ConstructMisFramedEncryptedPacket()
 // does cause the framer to return an error.
 TEST_P(QuicFramerTest, ConstructMisFramedEncryptedPacket) {
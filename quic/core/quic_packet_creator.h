@@ -42,6 +42,11 @@ class QUIC_EXPORT_PRIVATE QuicPacketCreator {
     // of |serialized_packet|, but takes ownership of any frames it removes
     // from |packet.retransmittable_frames|.
     virtual void OnSerializedPacket(SerializedPacket* serialized_packet) = 0;
+
+    // Returns a buffer of kMaxPacketSize bytes to serialize the next packet
+    // into, which stays valid until OnSerializedPacket returns.  If it returns
+    // nullptr, the packet is serialized on the stack.
+    virtual char* GetPacketBuffer() = 0;
   };
 
   // Interface which gets callbacks from the QuicPacketCreator at interesting
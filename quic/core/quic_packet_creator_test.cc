@@ -5,6 +5,7 @@
 #include "net/quic/core/quic_packet_creator.h"
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -74,7 +75,7 @@ std::vector<TestParams> GetTestParams() {
 
 class MockDelegate : public QuicPacketCreator::DelegateInterface {
  public:
-  MockDelegate() {}
+  MockDelegate() : packet_buffer_(nullptr) {}
   ~MockDelegate() override {}
 
   MOCK_METHOD1(OnSerializedPacket, void(SerializedPacket* packet));
@@ -82,8 +83,15 @@ class MockDelegate : public QuicPacketCreator::DelegateInterface {
                void(QuicErrorCode,
                     const string&,
                     ConnectionCloseSource source));
+  char* GetPacketBuffer() override { return packet_buffer_; }
+
+  void set_packet_buffer(char* packet_buffer) {
+    packet_buffer_ = packet_buffer;
+  }
 
  private:
+  char* packet_buffer_;
+
   DISALLOW_COPY_AND_ASSIGN(MockDelegate);
 };
 
@@ -824,6 +832,35 @@ TEST_P(QuicPacketCreatorTest, SerializeAndSendStreamFrame) {
   EXPECT_FALSE(creator_.HasPendingFrames());
 }
 
+TEST_P(QuicPacketCreatorTest, SerializeIntoDelegateBuffer) {
+  QUIC_CACHELINE_ALIGNED char packet_buffer[kMaxPacketSize];
+  memset(packet_buffer, 0, kMaxPacketSize);
+  delegate_.set_packet_buffer(packet_buffer);
+
+  QuicIOVector iov(MakeIOVectorFromStringPiece("test"));
+  EXPECT_CALL(delegate_, OnSerializedPacket(_))
+      .WillOnce(Invoke(this, &QuicPacketCreatorTest::SaveSerializedPacket));
+  size_t num_bytes_consumed;
+  creator_.CreateAndSerializeStreamFrame(kHeadersStreamId, iov, 0, 0, true,
+                                         nullptr, &num_bytes_consumed);
+  EXPECT_EQ(4u, num_bytes_consumed);
+  ASSERT_TRUE(serialized_packet_.encrypted_buffer);
+  EXPECT_EQ(0, memcmp(packet_buffer, serialized_packet_.encrypted_buffer,
+                      serialized_packet_.encrypted_length));
+  DeleteSerializedPacket();
+
+  QuicFrame frame;
+  EXPECT_CALL(delegate_, OnSerializedPacket(_))
+      .WillOnce(Invoke(this, &QuicPacketCreatorTest::SaveSerializedPacket));
+  ASSERT_TRUE(creator_.ConsumeData(kCryptoStreamId, iov, 0u, 0u, false, false,
+                                   &frame));
+  creator_.Flush();
+  ASSERT_TRUE(serialized_packet_.encrypted_buffer);
+  EXPECT_EQ(0, memcmp(packet_buffer, serialized_packet_.encrypted_buffer,
+                      serialized_packet_.encrypted_length));
+  DeleteSerializedPacket();
+}
+
 TEST_P(QuicPacketCreatorTest, AddUnencryptedStreamDataClosesConnection) {
   creator_.set_encryption_level(ENCRYPTION_NONE);
   EXPECT_CALL(delegate_, OnUnrecoverableError(_, _, _));
@@ -66,6 +66,49 @@ class QUIC_EXPORT_PRIVATE QuicPacketWriter {
   // size of a valid QUIC packet.
   virtual QuicByteCount GetMaxPacketSize(
       const QuicSocketAddress& peer_address) const = 0;
+
+  // Returns true if the writer may hold on to packets passed to WritePacket,
+  // reporting them as written, until Flush is called.  Such writers copy the
+  // packet, so the caller's buffer may be reused once WritePacket returns.
+  virtual bool IsBatchMode() const { return false; }
+
+  // Sends any packets held by a batch mode writer.  Returns WRITE_STATUS_OK
+  // with the number of bytes sent if all of them were sent, and
+  // WRITE_STATUS_BLOCKED if the socket became write blocked, in which case
+  // the remaining packets stay buffered and are sent by the next Flush after
+  // SetWritable.  A packet the socket rejects is dropped and the rest of the
+  // batch is still sent; WRITE_STATUS_ERROR means a packet written with
+  // WritePacket was dropped.
+  virtual WriteResult Flush() { return WriteResult(WRITE_STATUS_OK, 0); }
+
+  // Writes a packet on behalf of |sender|, a writer which passes its packets
+  // on to this one, such as a connection's writer sharing the dispatcher's.
+  // If a batch mode writer drops the packet when it is flushed, it calls
+  // |sender|->OnBufferedPacketDropped instead of failing the Flush, so that
+  // the error reaches the sender's connection rather than whichever
+  // connection flushed.
+  virtual WriteResult WritePacketForSender(const char* buffer,
+                                           size_t buf_len,
+                                           const QuicIpAddress& self_address,
+                                           const QuicSocketAddress& peer_address,
+                                           PerPacketOptions* options,
+                                           QuicPacketWriter* sender) {
+    return WritePacket(buffer, buf_len, self_address, peer_address, options);
+  }
+
+  // Called on the sender of a packet passed to WritePacketForSender when the
+  // batch mode writer failed to send it.  Must not write packets.
+  virtual void OnBufferedPacketDropped(int error_code) {}
+
+  // Forgets |sender|, which is going away, for the packets it still has
+  // buffered here.  The packets are still sent.
+  virtual void RemoveSender(QuicPacketWriter* sender) {}
+
+  // Returns a buffer of kMaxPacketSize bytes where a batch mode writer would
+  // copy the next packet passed to WritePacket, or nullptr.  A packet which is
+  // serialized there and then written does not need to be copied.  The buffer
+  // is only valid until the next call to WritePacket or Flush.
+  virtual char* GetNextWriteLocation() { return nullptr; }
 };
 
 }  // namespace net
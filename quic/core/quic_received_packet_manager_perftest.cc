@@ -0,0 +1,91 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/core/quic_received_packet_manager.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "net/quic/core/quic_connection_stats.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumPackets = 1000000;
+// An ack is generated after this many packets are received.
+const size_t kPacketsPerAck = 2;
+// Reordered packets arrive this many packets late.
+const int kReorderDistance = 20;
+// One packet in this many is lost.
+const int kLossInterval = 100;
+// The peer stops waiting for packets this far below the largest received.
+const QuicPacketNumber kLeastUnackedDistance = 1000;
+
+// Returns kNumPackets packet numbers in the order they are received, with
+// one packet in |reorder_interval| delayed by kReorderDistance packets.
+std::vector<QuicPacketNumber> ArrivalOrder(int reorder_interval) {
+  std::vector<QuicPacketNumber> packets;
+  for (int i = 1; i <= kNumPackets; ++i) {
+    if (i % kLossInterval != 0) {
+      packets.push_back(i);
+    }
+  }
+  for (size_t i = 0; i + kReorderDistance < packets.size();
+       i += reorder_interval) {
+    std::rotate(packets.begin() + i, packets.begin() + i + 1,
+                packets.begin() + i + kReorderDistance + 1);
+  }
+  return packets;
+}
+
+// Records the receipt of packets arriving in ArrivalOrder(|reorder_interval|),
+// builds an ack frame every kPacketsPerAck packets, and logs the CPU time per
+// packet.
+void ReceiveBenchmark(const std::string& name, int reorder_interval) {
+  const std::vector<QuicPacketNumber> packets = ArrivalOrder(reorder_interval);
+  QuicConnectionStats stats;
+  QuicReceivedPacketManager manager(&stats);
+  QuicTime now = QuicTime::Zero() + QuicTime::Delta::FromSeconds(1);
+  QuicPacketHeader header;
+
+  base::ThreadTicks cpu_start = base::ThreadTicks::Now();
+  {
+    base::PerfTimeLogger timer(name.c_str());
+    for (size_t i = 0; i < packets.size(); ++i) {
+      now = now + QuicTime::Delta::FromMicroseconds(10);
+      header.packet_number = packets[i];
+      manager.RecordPacketReceived(header, now);
+      if (i % kPacketsPerAck == kPacketsPerAck - 1) {
+        const QuicAckFrame* ack_frame =
+            manager.GetUpdatedAckFrame(now).ack_frame;
+        if (ack_frame->largest_observed > kLeastUnackedDistance) {
+          manager.DontWaitForPacketsBefore(ack_frame->largest_observed -
+                                           kLeastUnackedDistance);
+        }
+      }
+    }
+  }
+  LOG(INFO) << name << ": "
+            << (base::ThreadTicks::Now() - cpu_start).InNanoseconds() /
+                   static_cast<double>(packets.size())
+            << " CPU ns/packet";
+}
+
+TEST(QuicReceivedPacketManagerPerfTest, RecordPacketReceived) {
+  if (!base::ThreadTicks::IsSupported())
+    return;
+  ReceiveBenchmark("received_packet_manager_in_order", kNumPackets);
+  ReceiveBenchmark("received_packet_manager_reorder_1_in_10", 10);
+  ReceiveBenchmark("received_packet_manager_reorder_1_in_3", 3);
+}
+
+}  // namespace
+
+}  // namespace net
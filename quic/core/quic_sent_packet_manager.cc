@@ -283,36 +283,45 @@ void QuicSentPacketManager::MaybeInvokeCongestionEvent(
 
 void QuicSentPacketManager::HandleAckForSentPackets(
     const QuicAckFrame& ack_frame) {
-  // Go through the packets we have not received an ack for and see if this
-  // incoming_ack shows they've been seen by the peer.
+  // Go through the intervals of packets the incoming ack shows have been seen
+  // by the peer, and handle the packets in them we have not received an ack
+  // for, in order.  Packets which are still missing are skipped over.
   QuicTime::Delta ack_delay_time = ack_frame.ack_delay_time;
-  QuicPacketNumber packet_number = unacked_packets_.GetLeastUnacked();
-  for (QuicUnackedPacketMap::iterator it = unacked_packets_.begin();
-       it != unacked_packets_.end(); ++it, ++packet_number) {
-    if (packet_number > ack_frame.largest_observed) {
+  const QuicPacketNumber least_unacked = unacked_packets_.GetLeastUnacked();
+  // Packets past the largest sent one have no transmission info, and can't
+  // have been acked.
+  const QuicPacketNumber end_of_unacked =
+      unacked_packets_.largest_sent_packet() + 1;
+  for (const Interval<QuicPacketNumber>& interval : ack_frame.packets) {
+    if (interval.min() > ack_frame.largest_observed) {
       // These packets are still in flight.
       break;
     }
-
-    if (!ack_frame.packets.Contains(packet_number)) {
-      // Packet is still missing.
-      continue;
-    }
-    // Packet was acked, so remove it from our unacked packet list.
-    QUIC_DVLOG(1) << ENDPOINT << "Got an ack for packet " << packet_number;
-    if (it->largest_acked > 0) {
-      largest_packet_peer_knows_is_acked_ =
-          std::max(largest_packet_peer_knows_is_acked_, it->largest_acked);
-    }
-    // If data is associated with the most recent transmission of this
-    // packet, then inform the caller.
-    if (it->in_flight) {
-      packets_acked_.push_back(std::make_pair(packet_number, it->bytes_sent));
-    } else if (!it->is_unackable) {
-      // Packets are marked unackable after they've been acked once.
-      largest_newly_acked_ = packet_number;
+    const QuicPacketNumber end =
+        std::min(std::min(interval.max(), ack_frame.largest_observed + 1),
+                 end_of_unacked);
+    for (QuicPacketNumber packet_number =
+             std::max(interval.min(), least_unacked);
+         packet_number < end; ++packet_number) {
+      QuicTransmissionInfo* info =
+          unacked_packets_.GetMutableTransmissionInfo(packet_number);
+      // Packet was acked, so remove it from our unacked packet list.
+      QUIC_DVLOG(1) << ENDPOINT << "Got an ack for packet " << packet_number;
+      if (info->largest_acked > 0) {
+        largest_packet_peer_knows_is_acked_ =
+            std::max(largest_packet_peer_knows_is_acked_, info->largest_acked);
+      }
+      // If data is associated with the most recent transmission of this
+      // packet, then inform the caller.
+      if (info->in_flight) {
+        packets_acked_.push_back(
+            std::make_pair(packet_number, info->bytes_sent));
+      } else if (!info->is_unackable) {
+        // Packets are marked unackable after they've been acked once.
+        largest_newly_acked_ = packet_number;
+      }
+      MarkPacketHandled(packet_number, info, ack_delay_time);
     }
-    MarkPacketHandled(packet_number, &(*it), ack_delay_time);
   }
 }
 
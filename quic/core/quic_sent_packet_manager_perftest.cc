@@ -0,0 +1,94 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/core/quic_sent_packet_manager.h"
+
+#include "base/logging.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "net/quic/core/quic_connection_stats.h"
+#include "net/quic/test_tools/mock_clock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const QuicPacketNumber kPacketsInFlight = 10000;
+const int kNumAcks = 50000;
+// Each ack acks this many more packets, and as many are sent after it.
+const QuicPacketNumber kPacketsPerAck = 2;
+// One packet in this many is never acked, and is declared lost.
+const QuicPacketNumber kLossInterval = 50;
+const QuicPacketLength kPacketLength = 1350;
+
+class QuicSentPacketManagerPerfTest : public ::testing::Test {
+ protected:
+  QuicSentPacketManagerPerfTest()
+      : manager_(Perspective::IS_SERVER,
+                 &clock_,
+                 &stats_,
+                 kCubicBytes,
+                 kNack),
+        largest_sent_(0) {
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+  }
+
+  void SendPacket() {
+    SerializedPacket packet(++largest_sent_, PACKET_4BYTE_PACKET_NUMBER,
+                            nullptr, kPacketLength, false, false);
+    manager_.OnPacketSent(&packet, 0, clock_.Now(), NOT_RETRANSMISSION,
+                          HAS_RETRANSMITTABLE_DATA);
+  }
+
+  MockClock clock_;
+  QuicConnectionStats stats_;
+  QuicSentPacketManager manager_;
+  QuicPacketNumber largest_sent_;
+};
+
+// Keeps kPacketsInFlight packets in flight and processes acks for them, each
+// acking a few more packets and leaving a gap for the lost ones.
+TEST_F(QuicSentPacketManagerPerfTest, AckProcessing) {
+  if (!base::ThreadTicks::IsSupported())
+    return;
+  for (QuicPacketNumber i = 0; i < kPacketsInFlight; ++i) {
+    SendPacket();
+  }
+
+  QuicAckFrame ack_frame;
+  ack_frame.ack_delay_time = QuicTime::Delta::Zero();
+  QuicPacketNumber largest_acked = 0;
+  base::TimeDelta ack_time;
+  {
+    base::PerfTimeLogger timer("quic_sent_packet_manager_ack_processing");
+    for (int i = 0; i < kNumAcks; ++i) {
+      for (QuicPacketNumber j = 0; j < kPacketsPerAck; ++j) {
+        ++largest_acked;
+        if (largest_acked % kLossInterval != 0) {
+          ack_frame.packets.Add(largest_acked);
+        }
+      }
+      ack_frame.largest_observed = ack_frame.packets.Max();
+      // Acks only cover the packets the peer is still waiting for.
+      ack_frame.packets.RemoveUpTo(manager_.GetLeastUnacked());
+      clock_.AdvanceTime(QuicTime::Delta::FromMicroseconds(100));
+
+      base::ThreadTicks start = base::ThreadTicks::Now();
+      manager_.OnIncomingAck(ack_frame, clock_.Now());
+      ack_time += base::ThreadTicks::Now() - start;
+
+      for (QuicPacketNumber j = 0; j < kPacketsPerAck; ++j) {
+        SendPacket();
+      }
+    }
+  }
+  LOG(INFO) << "OnIncomingAck with " << kPacketsInFlight
+            << " packets in flight: "
+            << ack_time.InNanoseconds() / kNumAcks << " ns/ack";
+}
+
+}  // namespace
+
+}  // namespace net
@@ -0,0 +1,201 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/core/quic_session.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "net/quic/core/quic_config.h"
+#include "net/quic/core/quic_connection.h"
+#include "net/quic/core/quic_crypto_stream.h"
+#include "net/quic/core/quic_packet_writer.h"
+#include "net/quic/core/quic_spdy_session.h"
+#include "net/quic/core/quic_spdy_stream.h"
+#include "net/quic/platform/api/quic_ptr_util.h"
+#include "net/quic/platform/api/quic_socket_address.h"
+#include "net/tools/epoll_server/epoll_server.h"
+#include "net/tools/quic/quic_epoll_alarm_factory.h"
+#include "net/tools/quic/quic_epoll_connection_helper.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumStreams = 1000;
+const int kNumOnCanWrites = 1000;
+// Each write is a packet's worth, which doesn't divide the streams' batch
+// writes evenly.
+const size_t kBytesPerWrite = 1350;
+
+// Drops all packets.  The streams' data is never sent, so this only sees the
+// connection's own packets, if any.
+class DiscardingPacketWriter : public QuicPacketWriter {
+ public:
+  DiscardingPacketWriter() {}
+
+  WriteResult WritePacket(const char* /*buffer*/,
+                          size_t buf_len,
+                          const QuicIpAddress& /*self_address*/,
+                          const QuicSocketAddress& /*peer_address*/,
+                          PerPacketOptions* /*options*/) override {
+    return WriteResult(WRITE_STATUS_OK, buf_len);
+  }
+  bool IsWriteBlockedDataBuffered() const override { return false; }
+  bool IsWriteBlocked() const override { return false; }
+  void SetWritable() override {}
+  QuicByteCount GetMaxPacketSize(
+      const QuicSocketAddress& /*peer_address*/) const override {
+    return kMaxPacketSize;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DiscardingPacketWriter);
+};
+
+// A stream with more data buffered than it can ever write, which writes
+// kBytesPerWrite bytes each time it is allowed to and stays write blocked.
+class BulkStream : public QuicSpdyStream {
+ public:
+  BulkStream(QuicStreamId id, QuicSpdySession* session)
+      : QuicSpdyStream(id, session), data_(kBytesPerWrite, 'a') {}
+
+  void OnDataAvailable() override {}
+
+  void OnCanWrite() override {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data_.data());
+    iov.iov_len = data_.size();
+    session()->WritevData(this, id(), QuicIOVector(&iov, 1, data_.size()),
+                          stream_bytes_written(), false, nullptr);
+    session()->MarkConnectionLevelWriteBlocked(id());
+  }
+
+ private:
+  const std::string data_;
+
+  DISALLOW_COPY_AND_ASSIGN(BulkStream);
+};
+
+class PerfTestSession : public QuicSpdySession {
+ public:
+  explicit PerfTestSession(QuicConnection* connection)
+      : QuicSpdySession(connection, nullptr, QuicConfig()),
+        crypto_stream_(this) {
+    Initialize();
+  }
+
+  ~PerfTestSession() override { delete connection(); }
+
+  QuicCryptoStream* GetCryptoStream() override { return &crypto_stream_; }
+
+  BulkStream* CreateOutgoingDynamicStream(SpdyPriority priority) override {
+    BulkStream* stream = new BulkStream(GetNextOutgoingStreamId(), this);
+    stream->SetPriority(priority);
+    ActivateStream(QuicWrapUnique(stream));
+    return stream;
+  }
+
+  BulkStream* CreateIncomingDynamicStream(QuicStreamId /*id*/) override {
+    return nullptr;
+  }
+
+  bool ShouldCreateIncomingDynamicStream(QuicStreamId /*id*/) override {
+    return false;
+  }
+
+  bool ShouldCreateOutgoingDynamicStream() override { return true; }
+
+  // Consumes all the data without sending it, so that what is measured is
+  // the session picking the streams to write.
+  QuicConsumedData WritevData(
+      QuicStream* stream,
+      QuicStreamId id,
+      QuicIOVector data,
+      QuicStreamOffset /*offset*/,
+      bool fin,
+      QuicReferenceCountedPointer<QuicAckListenerInterface> /*ack_listener*/)
+      override {
+    stream->set_stream_bytes_written(stream->stream_bytes_written() +
+                                     data.total_length);
+    write_blocked_streams()->UpdateBytesForStream(id, data.total_length);
+    return QuicConsumedData(data.total_length, fin);
+  }
+
+ private:
+  QuicCryptoStream crypto_stream_;
+
+  DISALLOW_COPY_AND_ASSIGN(PerfTestSession);
+};
+
+// Blocks kNumStreams streams, with priorities from |priorities| in turn, calls
+// OnCanWrite on their session kNumOnCanWrites times, and logs the CPU time
+// per stream write and how evenly the writing was shared out.
+void OnCanWriteBenchmark(const std::string& name,
+                         const std::vector<SpdyPriority>& priorities) {
+  EpollServer epoll_server;
+  QuicEpollConnectionHelper helper(&epoll_server, QuicAllocator::SIMPLE);
+  QuicEpollAlarmFactory alarm_factory(&epoll_server);
+  PerfTestSession session(new QuicConnection(
+      42, QuicSocketAddress(QuicIpAddress::Loopback4(), 443), &helper,
+      &alarm_factory, new DiscardingPacketWriter(), /*owns_writer=*/true,
+      Perspective::IS_SERVER, AllSupportedVersions()));
+  std::vector<BulkStream*> streams;
+  for (int i = 0; i < kNumStreams; ++i) {
+    streams.push_back(session.CreateOutgoingDynamicStream(
+        priorities[i % priorities.size()]));
+    session.MarkConnectionLevelWriteBlocked(streams.back()->id());
+  }
+
+  base::ThreadTicks cpu_start = base::ThreadTicks::Now();
+  {
+    base::PerfTimeLogger timer(name.c_str());
+    for (int i = 0; i < kNumOnCanWrites; ++i) {
+      session.OnCanWrite();
+    }
+  }
+  LOG(INFO) << name << ": "
+            << (base::ThreadTicks::Now() - cpu_start).InNanoseconds() /
+                   static_cast<double>(kNumStreams * kNumOnCanWrites)
+            << " CPU ns/write";
+
+  // The streams of the highest priority present do all the writing, and
+  // should share it evenly.
+  const SpdyPriority highest_priority =
+      *std::min_element(priorities.begin(), priorities.end());
+  uint64_t min_bytes_written = std::numeric_limits<uint64_t>::max();
+  uint64_t max_bytes_written = 0;
+  for (BulkStream* stream : streams) {
+    if (stream->priority() != highest_priority) {
+      continue;
+    }
+    min_bytes_written =
+        std::min(min_bytes_written, stream->stream_bytes_written());
+    max_bytes_written =
+        std::max(max_bytes_written, stream->stream_bytes_written());
+  }
+  LOG(INFO) << name << ": " << min_bytes_written << " to "
+            << max_bytes_written << " bytes written by the streams of priority "
+            << static_cast<int>(highest_priority);
+}
+
+TEST(QuicSessionPerfTest, OnCanWrite) {
+  if (!base::ThreadTicks::IsSupported())
+    return;
+  OnCanWriteBenchmark("session_on_can_write_one_priority", {kDefaultPriority});
+  OnCanWriteBenchmark("session_on_can_write_all_priorities",
+                      {0, 1, 2, 3, 4, 5, 6, 7});
+}
+
+}  // namespace
+
+}  // namespace net
@@ -51,7 +51,8 @@ void QuicStreamSequencer::OnStreamFrame(const QuicStreamFrame& frame) {
   string error_details;
   QuicErrorCode result = buffered_frames_.OnStreamData(
       byte_offset, StringPiece(frame.data_buffer, frame.data_length),
-      clock_->ApproximateNow(), &bytes_written, &error_details);
+      frame.packet_buffer, clock_->ApproximateNow(), &bytes_written,
+      &error_details);
   if (result != QUIC_NO_ERROR) {
     string details = QuicStrCat(
         "Stream ", stream_->id(), ": ", QuicErrorCodeToString(result), ": ",
@@ -10,6 +10,7 @@
 #include "net/quic/platform/api/quic_logging.h"
 #include "net/quic/platform/api/quic_str_cat.h"
 
+using base::StringPiece;
 using std::string;
 
 namespace net {
@@ -33,12 +34,26 @@ QuicStreamSequencerBuffer::FrameInfo::FrameInfo(size_t length,
                                                 QuicTime timestamp)
     : length(length), timestamp(timestamp) {}
 
+QuicStreamSequencerBuffer::Slice::Slice(
+    const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>& packet_buffer,
+    StringPiece data,
+    QuicTime timestamp)
+    : packet_buffer(packet_buffer),
+      data(data.data()),
+      length(data.length()),
+      timestamp(timestamp) {}
+
+QuicStreamSequencerBuffer::Slice::Slice(const Slice& other) = default;
+
+QuicStreamSequencerBuffer::Slice::~Slice() {}
+
 QuicStreamSequencerBuffer::QuicStreamSequencerBuffer(size_t max_capacity_bytes)
     : max_buffer_capacity_bytes_(max_capacity_bytes),
       blocks_count_(
           ceil(static_cast<double>(max_capacity_bytes) / kBlockSizeBytes)),
       total_bytes_read_(0),
       blocks_(nullptr),
+      bytes_in_slices_(0),
       destruction_indicator_(123456) {
   CHECK_GT(blocks_count_, 1u)
       << "blocks_count_ = " << blocks_count_
@@ -60,6 +75,8 @@ void QuicStreamSequencerBuffer::Clear() {
     }
   }
   num_bytes_buffered_ = 0;
+  slices_.clear();
+  bytes_in_slices_ = 0;
   // Reset gaps_ so that buffer is in a state as if all data before
   // total_bytes_read_ has been consumed, and those after total_bytes_read_
   // has never arrived.
@@ -81,7 +98,18 @@ bool QuicStreamSequencerBuffer::RetireBlock(size_t idx) {
 
 QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     QuicStreamOffset starting_offset,
-    base::StringPiece data,
+    StringPiece data,
+    QuicTime timestamp,
+    size_t* const bytes_buffered,
+    std::string* error_details) {
+  return OnStreamData(starting_offset, data, nullptr, timestamp,
+                      bytes_buffered, error_details);
+}
+
+QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
+    QuicStreamOffset starting_offset,
+    StringPiece data,
+    const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>& packet_buffer,
     QuicTime timestamp,
     size_t* const bytes_buffered,
     std::string* error_details) {
@@ -151,6 +179,16 @@ QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     return QUIC_TOO_MANY_FRAME_GAPS;
   }
 
+  if (ShouldHoldSlice(starting_offset, size, packet_buffer)) {
+    packet_buffer->MarkHeld();
+    slices_.push_back(Slice(packet_buffer, data, timestamp));
+    bytes_in_slices_ += size;
+    *bytes_buffered = size;
+    UpdateGapList(current_gap, starting_offset, size);
+    num_bytes_buffered_ += size;
+    return QUIC_NO_ERROR;
+  }
+
   size_t total_written = 0;
   size_t source_remaining = size;
   const char* source = data.data();
@@ -267,11 +305,22 @@ QuicErrorCode QuicStreamSequencerBuffer::Readv(const iovec* dest_iov,
   CHECK_EQ(destruction_indicator_, 123456) << "This object has been destructed";
 
   *bytes_read = 0;
+  size_t bytes_read_from_blocks = 0;
   for (size_t i = 0; i < dest_count && ReadableBytes() > 0; ++i) {
     char* dest = reinterpret_cast<char*>(dest_iov[i].iov_base);
     CHECK_NE(dest, nullptr);
     size_t dest_remaining = dest_iov[i].iov_len;
     while (dest_remaining > 0 && ReadableBytes() > 0) {
+      if (!slices_.empty()) {
+        size_t bytes_to_copy =
+            std::min<size_t>(slices_.front().length, dest_remaining);
+        memcpy(dest, slices_.front().data, bytes_to_copy);
+        dest += bytes_to_copy;
+        dest_remaining -= bytes_to_copy;
+        *bytes_read += bytes_to_copy;
+        ConsumeFromSlices(bytes_to_copy);
+        continue;
+      }
       size_t block_idx = NextBlockToRead();
       size_t start_offset_in_block = ReadOffset();
       size_t block_capacity = GetBlockCapacity(block_idx);
@@ -298,6 +347,7 @@ QuicErrorCode QuicStreamSequencerBuffer::Readv(const iovec* dest_iov,
       num_bytes_buffered_ -= bytes_to_copy;
       total_bytes_read_ += bytes_to_copy;
       *bytes_read += bytes_to_copy;
+      bytes_read_from_blocks += bytes_to_copy;
 
       // Retire the block if all the data is read out and no other data is
       // stored in this block.
@@ -317,7 +367,7 @@ QuicErrorCode QuicStreamSequencerBuffer::Readv(const iovec* dest_iov,
     }
   }
 
-  if (*bytes_read > 0) {
+  if (bytes_read_from_blocks > 0) {
     UpdateFrameArrivalMap(total_bytes_read_);
   }
   return QUIC_NO_ERROR;
@@ -336,26 +386,49 @@ int QuicStreamSequencerBuffer::GetReadableRegions(struct iovec* iov,
     return 0;
   }
 
-  size_t start_block_idx = NextBlockToRead();
+  int iov_used = 0;
+  for (const Slice& slice : slices_) {
+    if (iov_used == iov_count) {
+      return iov_used;
+    }
+    iov[iov_used].iov_base = const_cast<char*>(slice.data);
+    iov[iov_used].iov_len = slice.length;
+    ++iov_used;
+  }
+  if (iov_used == iov_count ||
+      gaps_.front().begin_offset == total_bytes_read_ + bytes_in_slices_) {
+    return iov_used;
+  }
+  return iov_used +
+         GetBlockReadableRegions(iov + iov_used, iov_count - iov_used);
+}
+
+int QuicStreamSequencerBuffer::GetBlockReadableRegions(struct iovec* iov,
+                                                       int iov_count) const {
+  const QuicStreamOffset read_offset = total_bytes_read_ + bytes_in_slices_;
+  const size_t readable_bytes = gaps_.front().begin_offset - read_offset;
+  DCHECK_GT(readable_bytes, 0u);
+  const size_t start_block_offset = GetInBlockOffset(read_offset);
+  size_t start_block_idx = GetBlockIndex(read_offset);
   QuicStreamOffset readable_offset_end = gaps_.front().begin_offset - 1;
-  DCHECK_GE(readable_offset_end + 1, total_bytes_read_);
   size_t end_block_offset = GetInBlockOffset(readable_offset_end);
   size_t end_block_idx = GetBlockIndex(readable_offset_end);
 
   // If readable region is within one block, deal with it seperately.
-  if (start_block_idx == end_block_idx && ReadOffset() <= end_block_offset) {
-    iov[0].iov_base = blocks_[start_block_idx]->buffer + ReadOffset();
-    iov[0].iov_len = ReadableBytes();
+  if (start_block_idx == end_block_idx &&
+      start_block_offset <= end_block_offset) {
+    iov[0].iov_base = blocks_[start_block_idx]->buffer + start_block_offset;
+    iov[0].iov_len = readable_bytes;
     QUIC_DVLOG(1) << "Got only a single block with index: " << start_block_idx;
     return 1;
   }
 
   // Get first block
-  iov[0].iov_base = blocks_[start_block_idx]->buffer + ReadOffset();
-  iov[0].iov_len = GetBlockCapacity(start_block_idx) - ReadOffset();
+  iov[0].iov_base = blocks_[start_block_idx]->buffer + start_block_offset;
+  iov[0].iov_len = GetBlockCapacity(start_block_idx) - start_block_offset;
   QUIC_DVLOG(1) << "Got first block " << start_block_idx << " with len "
                 << iov[0].iov_len;
-  DCHECK_GT(readable_offset_end + 1, total_bytes_read_ + iov[0].iov_len)
+  DCHECK_GT(readable_offset_end + 1, read_offset + iov[0].iov_len)
       << "there should be more available data";
 
   // Get readable regions of the rest blocks till either 2nd to last block
@@ -393,6 +466,13 @@ bool QuicStreamSequencerBuffer::GetReadableRegion(iovec* iov,
     return false;
   }
 
+  if (!slices_.empty()) {
+    iov->iov_base = const_cast<char*>(slices_.front().data);
+    iov->iov_len = slices_.front().length;
+    *timestamp = slices_.front().timestamp;
+    return true;
+  }
+
   size_t start_block_idx = NextBlockToRead();
   iov->iov_base = blocks_[start_block_idx]->buffer + ReadOffset();
   size_t readable_bytes_in_block = std::min<size_t>(
@@ -431,6 +511,13 @@ bool QuicStreamSequencerBuffer::MarkConsumed(size_t bytes_used) {
     return false;
   }
   size_t bytes_to_consume = bytes_used;
+  while (bytes_to_consume > 0 && !slices_.empty()) {
+    size_t bytes_read =
+        std::min<size_t>(bytes_to_consume, slices_.front().length);
+    ConsumeFromSlices(bytes_read);
+    bytes_to_consume -= bytes_read;
+  }
+  const size_t bytes_consumed_from_blocks = bytes_to_consume;
   while (bytes_to_consume > 0) {
     size_t block_idx = NextBlockToRead();
     size_t offset_in_block = ReadOffset();
@@ -446,7 +533,7 @@ bool QuicStreamSequencerBuffer::MarkConsumed(size_t bytes_used) {
       RetireBlockIfEmpty(block_idx);
     }
   }
-  if (bytes_used > 0) {
+  if (bytes_consumed_from_blocks > 0) {
     UpdateFrameArrivalMap(total_bytes_read_);
   }
   return true;
@@ -464,6 +551,34 @@ void QuicStreamSequencerBuffer::ReleaseWholeBuffer() {
   blocks_.reset(nullptr);
 }
 
+bool QuicStreamSequencerBuffer::ShouldHoldSlice(
+    QuicStreamOffset offset,
+    size_t length,
+    const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>& packet_buffer)
+    const {
+  // Slices stay at the front of the readable region, so only data which
+  // directly follows them, with nothing buffered after it, can be held. Data
+  // which fills less than half of its packet is copied, which keeps the memory
+  // held in packets below twice the data held.
+  return packet_buffer != nullptr && gaps_.size() == 1 &&
+         offset == gaps_.front().begin_offset &&
+         offset == total_bytes_read_ + bytes_in_slices_ &&
+         2 * length >= packet_buffer->length();
+}
+
+void QuicStreamSequencerBuffer::ConsumeFromSlices(size_t bytes_consumed) {
+  Slice& slice = slices_.front();
+  DCHECK_LE(bytes_consumed, slice.length);
+  slice.data += bytes_consumed;
+  slice.length -= bytes_consumed;
+  if (slice.length == 0) {
+    slices_.pop_front();
+  }
+  bytes_in_slices_ -= bytes_consumed;
+  num_bytes_buffered_ -= bytes_consumed;
+  total_bytes_read_ += bytes_consumed;
+}
+
 size_t QuicStreamSequencerBuffer::ReadableBytes() const {
   return gaps_.front().begin_offset - total_bytes_read_;
 }
@@ -25,6 +25,12 @@
 // region, so pointers into it can be maintained, and the offset of a pointer
 // from the start of the read region can be calculated.
 //
+// Data which arrives in order, in a frame parsed from a
+// QuicReceivedPacketBuffer, can be held as a slice of that buffer instead of
+// being copied into the blocks, for as long as nothing after it has arrived.
+// Such slices are always at the front of the readable region, and are read
+// before any data in the blocks.
+//
 // Expected Use:
 //  QuicStreamSequencerBuffer buffer(2.5 * 8 * 1024);
 //  std::string source(1024, 'a');
@@ -60,11 +66,13 @@
 //  buffer.MarkConsumed(consumed);
 
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <list>
 #include <memory>
 
 #include "base/macros.h"
+#include "net/quic/core/frames/quic_stream_frame.h"
 #include "net/quic/core/quic_packets.h"
 #include "net/quic/platform/api/quic_export.h"
 
@@ -122,6 +130,18 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
                              size_t* bytes_buffered,
                              std::string* error_details);
 
+  // Same as above, but |data| lies within |packet_buffer|, which is held
+  // instead of copying |data| if it is the next data to be read and nothing
+  // after it has been buffered. |packet_buffer| may be nullptr.
+  QuicErrorCode OnStreamData(
+      QuicStreamOffset offset,
+      base::StringPiece data,
+      const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>&
+          packet_buffer,
+      QuicTime timestamp,
+      size_t* bytes_buffered,
+      std::string* error_details);
+
   // Reads from this buffer into given iovec array, up to number of iov_len
   // iovec objects and returns the number of bytes read.
   QuicErrorCode Readv(const struct iovec* dest_iov,
@@ -169,6 +189,37 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
  private:
   friend class test::QuicStreamSequencerBufferPeer;
 
+  // Buffered data which is held in the packet it arrived in.
+  struct QUIC_EXPORT_PRIVATE Slice {
+    Slice(const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>&
+              packet_buffer,
+          base::StringPiece data,
+          QuicTime timestamp);
+    Slice(const Slice& other);
+    ~Slice();
+
+    QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet_buffer;
+    const char* data;
+    size_t length;
+    QuicTime timestamp;
+  };
+
+  // Returns true if the data of a frame parsed from |packet_buffer| and
+  // covering [|offset|, |offset| + |length|) is to be held as a slice.
+  bool ShouldHoldSlice(
+      QuicStreamOffset offset,
+      size_t length,
+      const QuicReferenceCountedPointer<QuicReceivedPacketBuffer>&
+          packet_buffer) const;
+
+  // Marks |bytes_consumed| bytes at the front of |slices_| as read, and drops
+  // the slices which are read completely.
+  void ConsumeFromSlices(size_t bytes_consumed);
+
+  // Fills in up to |iov_count| iovecs with the readable region in the blocks,
+  // which starts after |slices_|, and returns the number of iovecs filled.
+  int GetBlockReadableRegions(struct iovec* iov, int iov_count) const;
+
   // Dispose the given buffer block.
   // After calling this method, blocks_[index] is set to nullptr
   // in order to indicate that no memory set is allocated for that block.
@@ -241,9 +292,17 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // Number of bytes in buffer.
   size_t num_bytes_buffered_;
 
-  // Stores all the buffered frames' start offset, length and arrival time.
+  // Stores all the buffered frames' start offset, length and arrival time,
+  // except for those held in |slices_|.
   std::map<QuicStreamOffset, FrameInfo> frame_arrival_time_map_;
 
+  // Data held in the packets it arrived in, which covers the readable region
+  // from |total_bytes_read_| on, in order.
+  std::deque<Slice> slices_;
+
+  // Number of bytes in |slices_|.
+  size_t bytes_in_slices_;
+
   // For debugging use after free, assigned to 123456 in constructor and 654321
   // in destructor. As long as it's not 123456, this means either use after free
   // or memory corruption.
@@ -0,0 +1,152 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/core/quic_stream_sequencer_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "net/quic/core/quic_constants.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const size_t kNumPackets = 500000;
+const size_t kFrameLength = 1300;
+// Data is read after this many packets are received.
+const size_t kPacketsPerRead = 4;
+// Reordered packets arrive this many packets late.
+const size_t kReorderDistance = 3;
+// The most data read at once, in frames.
+const int kMaxFramesPerRead = 2 * kPacketsPerRead;
+
+enum ReadMode {
+  // Copies the data out with Readv(), as QuicChromiumClientStream does.
+  READV,
+  // Reads the data in place with GetReadableRegions(), as QuicSpdyStream
+  // does.
+  READ_IN_PLACE,
+};
+
+// Returns the indices of kNumPackets stream frames in the order they arrive,
+// with one frame in |reorder_interval| arriving kReorderDistance frames late.
+std::vector<size_t> ArrivalOrder(size_t reorder_interval) {
+  std::vector<size_t> frames;
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    frames.push_back(i);
+  }
+  for (size_t i = 0; i + kReorderDistance < frames.size();
+       i += reorder_interval) {
+    std::rotate(frames.begin() + i, frames.begin() + i + 1,
+                frames.begin() + i + kReorderDistance + 1);
+  }
+  return frames;
+}
+
+// Receives kNumPackets stream frames of kFrameLength bytes in the order given
+// by ArrivalOrder(|reorder_interval|), reading the stream with |read_mode|,
+// and logs the CPU time per byte. If |hold_packets| is true, each frame is
+// passed in a packet buffer which may be held instead of copied, reusing the
+// packet buffer when it is not held as the framer does.
+void ReceiveBenchmark(const std::string& name,
+                      size_t reorder_interval,
+                      ReadMode read_mode,
+                      bool hold_packets) {
+  const std::vector<size_t> frames = ArrivalOrder(reorder_interval);
+  // The stand-in for the payloads of received packets, before decryption.
+  const std::string payload(kFrameLength, 'a');
+  std::unique_ptr<char[]> stack_buffer(new char[kMaxPacketSize]);
+  std::unique_ptr<char[]> dest(new char[kMaxFramesPerRead * kFrameLength]);
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> spare_packet_buffer;
+  QuicStreamSequencerBuffer buffer(kStreamReceiveWindowLimit);
+  std::string error_details;
+  size_t bytes_read = 0;
+
+  base::ThreadTicks cpu_start = base::ThreadTicks::Now();
+  {
+    base::PerfTimeLogger timer(name.c_str());
+    for (size_t i = 0; i < frames.size(); ++i) {
+      // Decrypt the packet, and buffer its stream frame.
+      QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet_buffer;
+      char* decrypted = stack_buffer.get();
+      if (hold_packets) {
+        packet_buffer = std::move(spare_packet_buffer);
+        if (packet_buffer == nullptr) {
+          packet_buffer = new QuicReceivedPacketBuffer();
+        }
+        decrypted = packet_buffer->data();
+      }
+      memcpy(decrypted, payload.data(), kFrameLength);
+      size_t bytes_buffered;
+      ASSERT_EQ(QUIC_NO_ERROR,
+                buffer.OnStreamData(frames[i] * kFrameLength,
+                                    base::StringPiece(decrypted, kFrameLength),
+                                    packet_buffer, QuicTime::Zero(),
+                                    &bytes_buffered, &error_details));
+      if (hold_packets && !packet_buffer->held()) {
+        spare_packet_buffer = std::move(packet_buffer);
+      }
+
+      if (i % kPacketsPerRead != kPacketsPerRead - 1) {
+        continue;
+      }
+      if (read_mode == READV) {
+        iovec iov;
+        iov.iov_base = dest.get();
+        iov.iov_len = kMaxFramesPerRead * kFrameLength;
+        size_t bytes_copied;
+        ASSERT_EQ(QUIC_NO_ERROR,
+                  buffer.Readv(&iov, 1, &bytes_copied, &error_details));
+        bytes_read += bytes_copied;
+      } else {
+        iovec iovs[kMaxFramesPerRead];
+        int num_regions = buffer.GetReadableRegions(iovs, kMaxFramesPerRead);
+        size_t bytes_consumed = 0;
+        for (int j = 0; j < num_regions; ++j) {
+          bytes_consumed += iovs[j].iov_len;
+        }
+        ASSERT_TRUE(buffer.MarkConsumed(bytes_consumed));
+        bytes_read += bytes_consumed;
+      }
+    }
+  }
+  LOG(INFO) << name << ": "
+            << (base::ThreadTicks::Now() - cpu_start).InNanoseconds() /
+                   static_cast<double>(bytes_read)
+            << " CPU ns/byte";
+}
+
+TEST(QuicStreamSequencerBufferPerfTest, Readv) {
+  if (!base::ThreadTicks::IsSupported())
+    return;
+  ReceiveBenchmark("sequencer_buffer_readv_copy", kNumPackets, READV, false);
+  ReceiveBenchmark("sequencer_buffer_readv_hold", kNumPackets, READV, true);
+  ReceiveBenchmark("sequencer_buffer_readv_reorder_copy", 10, READV, false);
+  ReceiveBenchmark("sequencer_buffer_readv_reorder_hold", 10, READV, true);
+}
+
+TEST(QuicStreamSequencerBufferPerfTest, ReadInPlace) {
+  if (!base::ThreadTicks::IsSupported())
+    return;
+  ReceiveBenchmark("sequencer_buffer_in_place_copy", kNumPackets,
+                   READ_IN_PLACE, false);
+  ReceiveBenchmark("sequencer_buffer_in_place_hold", kNumPackets,
+                   READ_IN_PLACE, true);
+  ReceiveBenchmark("sequencer_buffer_in_place_reorder_copy", 10,
+                   READ_IN_PLACE, false);
+  ReceiveBenchmark("sequencer_buffer_in_place_reorder_hold", 10,
+                   READ_IN_PLACE, true);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -21,6 +21,7 @@
 #include "testing/gmock_mutant.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
+using base::StringPiece;
 using std::string;
 
 namespace net {
@@ -800,6 +801,120 @@ TEST_F(QuicStreamSequencerBufferTest, TooManyGaps) {
   }
 }
 
+// Returns a packet buffer which starts with |length| bytes of |c|.
+QuicReferenceCountedPointer<QuicReceivedPacketBuffer> NewPacketBuffer(
+    char c,
+    size_t length) {
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet_buffer(
+      new QuicReceivedPacketBuffer());
+  memset(packet_buffer->data(), c, length);
+  return packet_buffer;
+}
+
+TEST_F(QuicStreamSequencerBufferTest, HoldInOrderDataInPacket) {
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet1 =
+      NewPacketBuffer('a', 1000);
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet2 =
+      NewPacketBuffer('b', 1000);
+  size_t written;
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer_->OnStreamData(0, StringPiece(packet1->data(), 1000),
+                                  packet1, clock_.ApproximateNow(), &written,
+                                  &error_details_));
+  EXPECT_EQ(1000u, written);
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer_->OnStreamData(1000, StringPiece(packet2->data(), 1000),
+                                  packet2, clock_.ApproximateNow(), &written,
+                                  &error_details_));
+  EXPECT_EQ(1000u, written);
+  // Neither frame is copied.
+  EXPECT_TRUE(packet1->held());
+  EXPECT_TRUE(packet2->held());
+  EXPECT_FALSE(helper_->IsBufferAllocated());
+  EXPECT_EQ(2000u, buffer_->BytesBuffered());
+
+  iovec iovs[5];
+  EXPECT_EQ(2, buffer_->GetReadableRegions(iovs, 5));
+  EXPECT_EQ(packet1->data(), iovs[0].iov_base);
+  EXPECT_EQ(1000u, iovs[0].iov_len);
+  EXPECT_EQ(packet2->data(), iovs[1].iov_base);
+  EXPECT_EQ(1000u, iovs[1].iov_len);
+
+  EXPECT_TRUE(buffer_->MarkConsumed(1500));
+  iovec iov;
+  QuicTime t = QuicTime::Zero();
+  EXPECT_TRUE(buffer_->GetReadableRegion(&iov, &t));
+  EXPECT_EQ(packet2->data() + 500, iov.iov_base);
+  EXPECT_EQ(500u, iov.iov_len);
+
+  char dest[500];
+  EXPECT_EQ(500u, helper_->Read(dest, 500));
+  EXPECT_EQ(string(500, 'b'), string(dest, 500));
+  EXPECT_EQ(2000u, buffer_->BytesConsumed());
+  EXPECT_TRUE(buffer_->Empty());
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
+TEST_F(QuicStreamSequencerBufferTest, CopyOutOfOrderOrSmallDataInPacket) {
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet1 =
+      NewPacketBuffer('a', 1000);
+  size_t written;
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer_->OnStreamData(1000, StringPiece(packet1->data(), 1000),
+                                  packet1, clock_.ApproximateNow(), &written,
+                                  &error_details_));
+  EXPECT_EQ(1000u, written);
+  EXPECT_FALSE(packet1->held());
+
+  // A frame which fills little of its packet is copied too.
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet2 =
+      NewPacketBuffer('b', 100);
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer_->OnStreamData(0, StringPiece(packet2->data(), 100),
+                                  packet2, clock_.ApproximateNow(), &written,
+                                  &error_details_));
+  EXPECT_EQ(100u, written);
+  EXPECT_FALSE(packet2->held());
+  EXPECT_TRUE(helper_->IsBufferAllocated());
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
+TEST_F(QuicStreamSequencerBufferTest, ReadHeldDataBeforeCopiedData) {
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet1 =
+      NewPacketBuffer('a', 1000);
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet2 =
+      NewPacketBuffer('b', 1000);
+  QuicReferenceCountedPointer<QuicReceivedPacketBuffer> packet3 =
+      NewPacketBuffer('c', 1000);
+  size_t written;
+  buffer_->OnStreamData(0, StringPiece(packet1->data(), 1000), packet1,
+                        clock_.ApproximateNow(), &written, &error_details_);
+  buffer_->OnStreamData(2000, StringPiece(packet3->data(), 1000), packet3,
+                        clock_.ApproximateNow(), &written, &error_details_);
+  // Filling the gap is in order, but data after it is already copied.
+  buffer_->OnStreamData(1000, StringPiece(packet2->data(), 1000), packet2,
+                        clock_.ApproximateNow(), &written, &error_details_);
+  EXPECT_TRUE(packet1->held());
+  EXPECT_FALSE(packet2->held());
+  EXPECT_FALSE(packet3->held());
+  EXPECT_EQ(3000u, buffer_->BytesBuffered());
+
+  iovec iovs[5];
+  EXPECT_EQ(2, buffer_->GetReadableRegions(iovs, 5));
+  EXPECT_EQ(packet1->data(), iovs[0].iov_base);
+  EXPECT_EQ(1000u, iovs[0].iov_len);
+  EXPECT_EQ(2000u, iovs[1].iov_len);
+  EXPECT_EQ('b', GetCharFromIOVecs(1000, iovs, 2));
+  EXPECT_EQ('c', GetCharFromIOVecs(2999, iovs, 2));
+
+  char dest[3000];
+  EXPECT_EQ(3000u, helper_->Read(dest, 3000));
+  EXPECT_EQ(string(1000, 'a') + string(1000, 'b') + string(1000, 'c'),
+            string(dest, 3000));
+  EXPECT_TRUE(buffer_->Empty());
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
 class QuicStreamSequencerBufferRandomIOTest
     : public QuicStreamSequencerBufferTest {
  public:
@@ -7,17 +7,17 @@
 namespace net {
 
 QuicTransmissionInfo::QuicTransmissionInfo()
-    : encryption_level(ENCRYPTION_NONE),
-      packet_number_length(PACKET_1BYTE_PACKET_NUMBER),
+    : sent_time(QuicTime::Zero()),
+      retransmission(0),
+      largest_acked(0),
       bytes_sent(0),
-      sent_time(QuicTime::Zero()),
-      transmission_type(NOT_RETRANSMISSION),
       in_flight(false),
       is_unackable(false),
       has_crypto_handshake(false),
       num_padding_bytes(0),
-      retransmission(0),
-      largest_acked(0) {}
+      transmission_type(NOT_RETRANSMISSION),
+      encryption_level(ENCRYPTION_NONE),
+      packet_number_length(PACKET_1BYTE_PACKET_NUMBER) {}
 
 QuicTransmissionInfo::QuicTransmissionInfo(
     EncryptionLevel level,
@@ -27,21 +27,24 @@ QuicTransmissionInfo::QuicTransmissionInfo(
     QuicPacketLength bytes_sent,
     bool has_crypto_handshake,
     int num_padding_bytes)
-    : encryption_level(level),
-      packet_number_length(packet_number_length),
+    : sent_time(sent_time),
+      retransmission(0),
+      largest_acked(0),
       bytes_sent(bytes_sent),
-      sent_time(sent_time),
-      transmission_type(transmission_type),
       in_flight(false),
       is_unackable(false),
       has_crypto_handshake(has_crypto_handshake),
       num_padding_bytes(num_padding_bytes),
-      retransmission(0),
-      largest_acked(0) {}
+      transmission_type(transmission_type),
+      encryption_level(level),
+      packet_number_length(packet_number_length) {}
 
 QuicTransmissionInfo::QuicTransmissionInfo(const QuicTransmissionInfo& other) =
     default;
 
+QuicTransmissionInfo::QuicTransmissionInfo(QuicTransmissionInfo&& other) =
+    default;
+
 QuicTransmissionInfo::~QuicTransmissionInfo() {}
 
 }  // namespace net
@@ -30,16 +30,19 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
                        int num_padding_bytes);
 
   QuicTransmissionInfo(const QuicTransmissionInfo& other);
+  QuicTransmissionInfo(QuicTransmissionInfo&& other);
 
   ~QuicTransmissionInfo();
 
-  QuicFrames retransmittable_frames;
-  EncryptionLevel encryption_level;
-  QuicPacketNumberLength packet_number_length;
-  QuicPacketLength bytes_sent;
+  // The fields read for every packet when an ack is processed come first, so
+  // that they share a cache line.
   QuicTime sent_time;
-  // Reason why this packet was transmitted.
-  TransmissionType transmission_type;
+  // Stores the packet number of the next retransmission of this packet.
+  // Zero if the packet has not been retransmitted.
+  QuicPacketNumber retransmission;
+  // The largest_acked in the ack frame, if the packet contains an ack.
+  QuicPacketNumber largest_acked;
+  QuicPacketLength bytes_sent;
   // In flight packets have not been abandoned or lost.
   bool in_flight;
   // True if the packet can never be acked, so it can be removed.  Occurs when
@@ -50,13 +53,13 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
   bool has_crypto_handshake;
   // Non-zero if the packet needs padding if it's retransmitted.
   int16_t num_padding_bytes;
-  // Stores the packet number of the next retransmission of this packet.
-  // Zero if the packet has not been retransmitted.
-  QuicPacketNumber retransmission;
+  // Reason why this packet was transmitted.
+  TransmissionType transmission_type;
+  EncryptionLevel encryption_level;
+  QuicPacketNumberLength packet_number_length;
+  QuicFrames retransmittable_frames;
   // Non-empty if there is a listener for this packet.
   std::list<AckListenerWrapper> ack_listeners;
-  // The largest_acked in the ack frame, if the packet contains an ack.
-  QuicPacketNumber largest_acked;
 };
 
 }  // namespace net
@@ -4,6 +4,8 @@
 
 #include "net/quic/core/quic_unacked_packet_map.h"
 
+#include <utility>
+
 #include "net/quic/core/quic_connection_stats.h"
 #include "net/quic/core/quic_utils.h"
 #include "net/quic/platform/api/quic_bug_tracker.h"
@@ -55,7 +57,7 @@ void QuicUnackedPacketMap::AddSentPacket(SerializedPacket* packet,
     info.in_flight = true;
     largest_sent_retransmittable_packet_ = packet_number;
   }
-  unacked_packets_.push_back(info);
+  unacked_packets_.push_back(std::move(info));
   // Swap the ack listeners and retransmittable frames to avoid allocations.
   // TODO(ianswett): Could use emplace_back when Chromium can.
   if (old_packet_number == 0) {
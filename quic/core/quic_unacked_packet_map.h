@@ -6,9 +6,9 @@
 #define NET_QUIC_CORE_QUIC_UNACKED_PACKET_MAP_H_
 
 #include <cstddef>
-#include <deque>
 
 #include "base/macros.h"
+#include "net/quic/core/quic_circular_deque.h"
 #include "net/quic/core/quic_packets.h"
 #include "net/quic/core/quic_transmission_info.h"
 #include "net/quic/platform/api/quic_export.h"
@@ -94,7 +94,10 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // been acked by the peer.  If there are no unacked packets, returns 0.
   QuicPacketNumber GetLeastUnacked() const;
 
-  typedef std::deque<QuicTransmissionInfo> UnackedPacketMap;
+  // The transmissions of packets least_unacked_ and up, one after the other.
+  // Sending a packet may move the others, so references into the map must not
+  // be held across AddSentPacket.
+  typedef QuicCircularDeque<QuicTransmissionInfo> UnackedPacketMap;
 
   typedef UnackedPacketMap::const_iterator const_iterator;
   typedef UnackedPacketMap::iterator iterator;
@@ -11,7 +11,6 @@ QuicWriteBlockedList::QuicWriteBlockedList()
       crypto_stream_blocked_(false),
       headers_stream_blocked_(false) {
   memset(batch_write_stream_id_, 0, sizeof(batch_write_stream_id_));
-  memset(bytes_left_for_batch_write_, 0, sizeof(bytes_left_for_batch_write_));
 }
 
 QuicWriteBlockedList::~QuicWriteBlockedList() {}
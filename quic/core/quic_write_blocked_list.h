@@ -5,8 +5,10 @@
 #ifndef NET_QUIC_CORE_QUIC_WRITE_BLOCKED_LIST_H_
 #define NET_QUIC_CORE_QUIC_WRITE_BLOCKED_LIST_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <unordered_map>
 
 #include "base/macros.h"
 #include "net/quic/core/quic_packets.h"
@@ -65,6 +67,10 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
 
   // Pops the highest priorty stream, special casing crypto and headers streams.
   // Latches the most recently popped data stream for batch writing purposes.
+  // Data streams of the same priority take turns by deficit round robin: each
+  // turn lets a stream write kBatchWriteSize bytes, and whatever it writes past
+  // that is taken out of its next turn, so that streams whose writes overrun
+  // their turns don't get more than their share.
   QuicStreamId PopFront() {
     if (crypto_stream_blocked_) {
       crypto_stream_blocked_ = false;
@@ -76,34 +82,52 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
       return kHeadersStreamId;
     }
 
-    const auto id_and_precedence =
-        priority_write_scheduler_.PopNextReadyStreamAndPrecedence();
-    const QuicStreamId id = std::get<0>(id_and_precedence);
-    const SpdyPriority priority =
-        std::get<1>(id_and_precedence).spdy3_priority();
-
-    if (!priority_write_scheduler_.HasReadyStreams()) {
-      // If no streams are blocked, don't bother latching.  This stream will be
-      // the first popped for its priority anyway.
-      batch_write_stream_id_[priority] = 0;
-      last_priority_popped_ = priority;
-    } else if (batch_write_stream_id_[priority] != id) {
-      // If newly latching this batch write stream, let it write 16k.
+    while (true) {
+      const auto id_and_precedence =
+          priority_write_scheduler_.PopNextReadyStreamAndPrecedence();
+      const QuicStreamId id = std::get<0>(id_and_precedence);
+      const SpdyPriority priority =
+          std::get<1>(id_and_precedence).spdy3_priority();
+      int64_t& bytes_left = bytes_left_for_batch_write_[id];
+
+      // Having been popped, the stream only yields to others of its priority.
+      if (!priority_write_scheduler_.ShouldYield(id)) {
+        // If no other streams of this priority are blocked, don't bother
+        // latching.  This stream will be the first popped for its priority
+        // anyway, and owes nothing to streams which weren't waiting.
+        batch_write_stream_id_[priority] = 0;
+        bytes_left = 0;
+        last_priority_popped_ = priority;
+        return id;
+      }
+
+      if (batch_write_stream_id_[priority] == id && bytes_left > 0) {
+        // The latched stream is resuming its batch write.
+        return id;
+      }
+
+      // Start a new turn, less whatever the stream overran its last one by.
+      bytes_left = std::min<int64_t>(bytes_left, 0) + kBatchWriteSize;
+      if (bytes_left <= 0) {
+        // The stream has more than a turn to make up, so it sits this one out.
+        priority_write_scheduler_.MarkStreamReady(id, false);
+        continue;
+      }
       batch_write_stream_id_[priority] = id;
-      bytes_left_for_batch_write_[priority] = 16000;
       last_priority_popped_ = priority;
+      return id;
     }
-
-    return id;
   }
 
   void RegisterStream(QuicStreamId stream_id, SpdyPriority priority) {
     priority_write_scheduler_.RegisterStream(stream_id,
                                              SpdyStreamPrecedence(priority));
+    bytes_left_for_batch_write_[stream_id] = 0;
   }
 
   void UnregisterStream(QuicStreamId stream_id) {
     priority_write_scheduler_.UnregisterStream(stream_id);
+    bytes_left_for_batch_write_.erase(stream_id);
   }
 
   void UpdateStreamPriority(QuicStreamId stream_id, SpdyPriority new_priority) {
@@ -112,11 +136,14 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
   }
 
   void UpdateBytesForStream(QuicStreamId stream_id, size_t bytes) {
-    if (batch_write_stream_id_[last_priority_popped_] == stream_id) {
-      // If this was the last data stream popped by PopFront, update the
-      // bytes remaining in its batch write.
-      bytes_left_for_batch_write_[last_priority_popped_] -=
-          static_cast<int32_t>(bytes);
+    if (batch_write_stream_id_[last_priority_popped_] != stream_id) {
+      return;
+    }
+    // If this was the last data stream popped by PopFront, update the bytes
+    // remaining in its batch write.
+    auto it = bytes_left_for_batch_write_.find(stream_id);
+    if (it != bytes_left_for_batch_write_.end()) {
+      it->second -= static_cast<int64_t>(bytes);
     }
   }
 
@@ -136,9 +163,11 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
       headers_stream_blocked_ = true;
       return;
     }
-    bool push_front =
-        stream_id == batch_write_stream_id_[last_priority_popped_] &&
-        bytes_left_for_batch_write_[last_priority_popped_] > 0;
+    bool push_front = false;
+    if (stream_id == batch_write_stream_id_[last_priority_popped_]) {
+      auto it = bytes_left_for_batch_write_.find(stream_id);
+      push_front = it != bytes_left_for_batch_write_.end() && it->second > 0;
+    }
     priority_write_scheduler_.MarkStreamReady(stream_id, push_front);
 
     return;
@@ -148,6 +177,9 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
   bool headers_stream_blocked() const { return headers_stream_blocked_; }
 
  private:
+  // The number of bytes a data stream may write per turn.
+  static const int64_t kBatchWriteSize = 16000;
+
   QuicPriorityWriteScheduler priority_write_scheduler_;
 
   // If performing batch writes, this will be the stream ID of the stream doing
@@ -155,10 +187,11 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList {
   // until it has written kBatchWriteSize bytes, it has no more data to write,
   // or a higher priority stream preempts.
   QuicStreamId batch_write_stream_id_[kV3LowestPriority + 1];
-  // Set to kBatchWriteSize when we set a new batch_write_stream_id_ for a given
-  // priority.  This is decremented with each write the stream does until it is
-  // done with its batch write.
-  int32_t bytes_left_for_batch_write_[kV3LowestPriority + 1];
+  // Per registered stream, the bytes left in its current turn.  This has
+  // kBatchWriteSize added when the stream starts a turn, and is decremented
+  // with each write the stream does until it is done with its batch write.  If
+  // negative, it is the number of bytes the stream overran its last turn by.
+  std::unordered_map<QuicStreamId, int64_t> bytes_left_for_batch_write_;
   // Tracks the last priority popped for UpdateBytesForStream.
   SpdyPriority last_priority_popped_;
 
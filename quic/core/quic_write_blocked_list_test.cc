@@ -167,6 +167,34 @@ TEST(QuicWriteBlockedListTest, BatchingWrites) {
   EXPECT_EQ(id1, write_blocked_list.PopFront());
 }
 
+TEST(QuicWriteBlockedListTest, OverrunBatchWritesAreMadeUp) {
+  QuicWriteBlockedList write_blocked_list;
+
+  const QuicStreamId id1 = kClientDataStreamId1;
+  const QuicStreamId id2 = kClientDataStreamId2;
+  write_blocked_list.RegisterStream(id1, kV3LowestPriority);
+  write_blocked_list.RegisterStream(id2, kV3LowestPriority);
+
+  write_blocked_list.AddStream(id1);
+  write_blocked_list.AddStream(id2);
+
+  // The first stream writes four batches' worth of data in its first batch.
+  EXPECT_EQ(id1, write_blocked_list.PopFront());
+  write_blocked_list.UpdateBytesForStream(id1, 64000);
+  write_blocked_list.AddStream(id1);
+
+  // So it sits out while the second stream writes as much.
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(id2, write_blocked_list.PopFront());
+    write_blocked_list.UpdateBytesForStream(id2, 16000);
+    write_blocked_list.AddStream(id2);
+    EXPECT_EQ(2u, write_blocked_list.NumBlockedStreams());
+  }
+  EXPECT_EQ(id1, write_blocked_list.PopFront());
+  EXPECT_EQ(id2, write_blocked_list.PopFront());
+  EXPECT_EQ(0u, write_blocked_list.NumBlockedStreams());
+}
+
 TEST(QuicWriteBlockedListTest, Ceding) {
   QuicWriteBlockedList write_blocked_list;
 
@@ -91,13 +91,13 @@ void BufferedSpdyFramer::OnStreamPadding(SpdyStreamId stream_id, size_t len) {
 
 SpdyHeadersHandlerInterface* BufferedSpdyFramer::OnHeaderFrameStart(
     SpdyStreamId stream_id) {
-  coalescer_.reset(new HeaderCoalescer());
-  return coalescer_.get();
+  coalescer_.Reset();
+  return &coalescer_;
 }
 
 void BufferedSpdyFramer::OnHeaderFrameEnd(SpdyStreamId stream_id,
                                           bool end_headers) {
-  if (coalescer_->error_seen()) {
+  if (coalescer_.error_seen()) {
     visitor_->OnStreamError(stream_id,
                             "Could not parse Spdy Control Frame Header.");
     control_frame_fields_.reset();
@@ -111,12 +111,12 @@ void BufferedSpdyFramer::OnHeaderFrameEnd(SpdyStreamId stream_id,
           control_frame_fields_->weight,
           control_frame_fields_->parent_stream_id,
           control_frame_fields_->exclusive, control_frame_fields_->fin,
-          coalescer_->release_headers());
+          coalescer_.headers());
       break;
     case PUSH_PROMISE:
       visitor_->OnPushPromise(control_frame_fields_->stream_id,
                               control_frame_fields_->promised_stream_id,
-                              coalescer_->release_headers());
+                              coalescer_.release_headers());
       break;
     default:
       DCHECK(false) << "Unexpect control frame type: "
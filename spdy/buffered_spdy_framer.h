@@ -39,7 +39,7 @@ class NET_EXPORT_PRIVATE BufferedSpdyFramerVisitorInterface {
                          SpdyStreamId parent_stream_id,
                          bool exclusive,
                          bool fin,
-                         SpdyHeaderBlock headers) = 0;
+                         const SpdyHeaderBlock& headers) = 0;
 
   // Called when a data frame header is received.
   virtual void OnDataFrameHeader(SpdyStreamId stream_id,
@@ -267,7 +267,9 @@ class NET_EXPORT_PRIVATE BufferedSpdyFramer
   };
   std::unique_ptr<GoAwayFields> goaway_fields_;
 
-  std::unique_ptr<HeaderCoalescer> coalescer_;
+  // Reused for every header block, so that its SpdyHeaderBlock keeps its
+  // memory from one HEADERS frame to the next.
+  HeaderCoalescer coalescer_;
 
   DISALLOW_COPY_AND_ASSIGN(BufferedSpdyFramer);
 };
@@ -46,11 +46,11 @@ class TestBufferedSpdyVisitor : public BufferedSpdyFramerVisitorInterface {
                  SpdyStreamId parent_stream_id,
                  bool exclusive,
                  bool fin,
-                 SpdyHeaderBlock headers) override {
+                 const SpdyHeaderBlock& headers) override {
     header_stream_id_ = stream_id;
     EXPECT_NE(header_stream_id_, SpdyFramer::kInvalidStream);
     headers_frame_count_++;
-    headers_ = std::move(headers);
+    headers_ = headers.Clone();
   }
 
   void OnDataFrameHeader(SpdyStreamId stream_id,
@@ -73,6 +73,19 @@ void HeaderCoalescer::OnHeader(base::StringPiece key, base::StringPiece value) {
   }
 }
 
+void HeaderCoalescer::Reset() {
+  headers_.clear();
+  headers_valid_ = true;
+  header_list_size_ = 0;
+  error_seen_ = false;
+  regular_header_seen_ = false;
+}
+
+const SpdyHeaderBlock& HeaderCoalescer::headers() const {
+  DCHECK(headers_valid_);
+  return headers_;
+}
+
 SpdyHeaderBlock HeaderCoalescer::release_headers() {
   DCHECK(headers_valid_);
   headers_valid_ = false;
@@ -23,6 +23,15 @@ class NET_EXPORT_PRIVATE HeaderCoalescer : public SpdyHeadersHandlerInterface {
   void OnHeaderBlockEnd(size_t uncompressed_header_bytes,
                         size_t compressed_header_bytes) override {}
 
+  // Gets ready for another header block. Keeps the memory of the current
+  // block, unless it was released, so that a session can reuse it for every
+  // HEADERS frame it receives.
+  void Reset();
+
+  // The headers received since the last Reset(). Not valid after
+  // release_headers().
+  const SpdyHeaderBlock& headers() const;
+
   SpdyHeaderBlock release_headers();
   bool error_seen() const { return error_seen_; }
 
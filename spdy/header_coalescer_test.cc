@@ -136,6 +136,29 @@ TEST_F(HeaderCoalescerTest, HeaderValueValid) {
                                                  header_values[1].size()))));
 }
 
+// A coalescer which is reset starts a new header block, whether or not the
+// last one was released or had an error.
+TEST_F(HeaderCoalescerTest, Reset) {
+  header_coalescer_.OnHeader("foo", "bar");
+  header_coalescer_.OnHeader(":baz", "qux");
+  EXPECT_TRUE(header_coalescer_.error_seen());
+
+  header_coalescer_.Reset();
+  EXPECT_FALSE(header_coalescer_.error_seen());
+  header_coalescer_.OnHeader(":baz", "qux");
+  header_coalescer_.OnHeader("foo", "quux");
+  EXPECT_FALSE(header_coalescer_.error_seen());
+  EXPECT_THAT(header_coalescer_.headers(),
+              ElementsAre(Pair(":baz", "qux"), Pair("foo", "quux")));
+
+  SpdyHeaderBlock header_block = header_coalescer_.release_headers();
+  header_coalescer_.Reset();
+  header_coalescer_.OnHeader("foo", "bar");
+  EXPECT_THAT(header_coalescer_.headers(), ElementsAre(Pair("foo", "bar")));
+  EXPECT_THAT(header_block,
+              ElementsAre(Pair(":baz", "qux"), Pair("foo", "quux")));
+}
+
 }  // namespace test
 
 }  // namespace net
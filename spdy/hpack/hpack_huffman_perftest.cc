@@ -0,0 +1,130 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "base/test/perf_time_logger.h"
+#include "net/http2/hpack/huffman/http2_hpack_huffman_decoder.h"
+#include "net/spdy/fuzzing/hpack_fuzz_util.h"
+#include "net/spdy/hpack/hpack_constants.h"
+#include "net/spdy/hpack/hpack_huffman_table.h"
+#include "net/spdy/hpack/hpack_output_stream.h"
+#include "net/spdy/spdy_header_block.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumHeaderSets = 1000;
+const int kNumIterations = 100;
+
+class HpackHuffmanPerfTest : public testing::Test {
+ protected:
+  // Builds a corpus of header names and values from the same generator that
+  // hpack_example_generator uses to produce the fuzzer's seed corpus, along
+  // with the strings of the examples in RFC 7541, and Huffman encodes it.
+  void SetUp() override {
+    plain_ = {
+        "www.example.com",
+        "no-cache",
+        "custom-key",
+        "custom-value",
+        "302",
+        "private",
+        "Mon, 21 Oct 2013 20:13:21 GMT",
+        "https://www.example.com",
+        "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1",
+    };
+    HpackFuzzUtil::GeneratorContext context;
+    HpackFuzzUtil::InitializeGeneratorContext(&context);
+    for (int i = 0; i < kNumHeaderSets; ++i) {
+      SpdyHeaderBlock headers = HpackFuzzUtil::NextGeneratedHeaderSet(&context);
+      for (const auto& header : headers) {
+        plain_.push_back(header.first.as_string());
+        plain_.push_back(header.second.as_string());
+      }
+    }
+
+    const HpackHuffmanTable& table = ObtainHpackHuffmanTable();
+    for (const std::string& plain : plain_) {
+      HpackOutputStream output_stream;
+      table.EncodeString(plain, &output_stream);
+      std::string encoded;
+      output_stream.TakeString(&encoded);
+      encoded_.push_back(encoded);
+      plain_size_ += plain.size();
+    }
+  }
+
+  std::vector<std::string> plain_;
+  std::vector<std::string> encoded_;
+  size_t plain_size_ = 0;
+};
+
+TEST_F(HpackHuffmanPerfTest, Encode) {
+  const HpackHuffmanTable& table = ObtainHpackHuffmanTable();
+  HpackOutputStream output_stream;
+  std::string encoded;
+  size_t encoded_size = 0;
+
+  base::PerfTimeLogger timer("HpackHuffman_Encode");
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const std::string& plain : plain_) {
+      table.EncodeString(plain, &output_stream);
+      output_stream.TakeString(&encoded);
+      encoded_size += encoded.size();
+    }
+  }
+  timer.Done();
+
+  EXPECT_LT(0u, encoded_size);
+}
+
+TEST_F(HpackHuffmanPerfTest, Decode) {
+  HpackHuffmanDecoder decoder;
+  std::string plain;
+  size_t plain_size = 0;
+
+  base::PerfTimeLogger timer("HpackHuffman_Decode");
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const std::string& encoded : encoded_) {
+      plain.clear();
+      decoder.Reset();
+      ASSERT_TRUE(decoder.Decode(encoded, &plain));
+      ASSERT_TRUE(decoder.InputProperlyTerminated());
+      plain_size += plain.size();
+    }
+  }
+  timer.Done();
+
+  EXPECT_EQ(kNumIterations * plain_size_, plain_size);
+}
+
+TEST_F(HpackHuffmanPerfTest, DecodeShortCodesFirst) {
+  HpackHuffmanDecoder decoder;
+  std::string plain;
+  size_t plain_size = 0;
+
+  base::PerfTimeLogger timer("HpackHuffman_DecodeShortCodesFirst");
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const std::string& encoded : encoded_) {
+      plain.clear();
+      decoder.Reset();
+      ASSERT_TRUE(decoder.DecodeShortCodesFirst(encoded, &plain));
+      plain_size += plain.size();
+    }
+  }
+  timer.Done();
+
+  EXPECT_EQ(kNumIterations * plain_size_, plain_size);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -8,6 +8,7 @@
 #include <cmath>
 #include <memory>
 
+#include "base/big_endian.h"
 #include "base/logging.h"
 #include "base/numerics/safe_conversions.h"
 #include "net/spdy/hpack/hpack_input_stream.h"
@@ -221,35 +222,42 @@ bool HpackHuffmanTable::IsInitialized() const {
 
 void HpackHuffmanTable::EncodeString(StringPiece in,
                                      HpackOutputStream* out) const {
-  size_t bit_remnant = 0;
+  // Codes are packed into |bits| from its most significant end, and moved to
+  // |buffer| 32 bits at a time. No code is longer than 32 bits, so the next
+  // one always fits while fewer than 32 bits are pending.
+  char buffer[256];
+  size_t buffer_size = 0;
+  uint64_t bits = 0;
+  size_t bit_count = 0;
   for (size_t i = 0; i != in.size(); i++) {
     uint16_t symbol_id = static_cast<uint8_t>(in[i]);
     CHECK_GT(code_by_id_.size(), symbol_id);
 
-    // Load, and shift code to low bits.
-    unsigned length = length_by_id_[symbol_id];
-    uint32_t code = code_by_id_[symbol_id] >> (32 - length);
-
-    bit_remnant = (bit_remnant + length) % 8;
-
-    if (length > 24) {
-      out->AppendBits(static_cast<uint8_t>(code >> 24), length - 24);
-      length = 24;
-    }
-    if (length > 16) {
-      out->AppendBits(static_cast<uint8_t>(code >> 16), length - 16);
-      length = 16;
-    }
-    if (length > 8) {
-      out->AppendBits(static_cast<uint8_t>(code >> 8), length - 8);
-      length = 8;
+    bits |= static_cast<uint64_t>(code_by_id_[symbol_id]) << (32 - bit_count);
+    bit_count += length_by_id_[symbol_id];
+    if (bit_count >= 32) {
+      if (buffer_size + 4 > sizeof(buffer)) {
+        out->AppendBytes(StringPiece(buffer, buffer_size));
+        buffer_size = 0;
+      }
+      base::WriteBigEndian(buffer + buffer_size,
+                           static_cast<uint32_t>(bits >> 32));
+      buffer_size += 4;
+      bits <<= 32;
+      bit_count -= 32;
     }
-    out->AppendBits(static_cast<uint8_t>(code), length);
   }
-  if (bit_remnant != 0) {
-    // Pad current byte as required.
-    out->AppendBits(pad_bits_ >> bit_remnant, 8 - bit_remnant);
+  if (buffer_size + 4 > sizeof(buffer)) {
+    out->AppendBytes(StringPiece(buffer, buffer_size));
+    buffer_size = 0;
+  }
+  // Pad the current byte as required. Any pad bits past it are dropped.
+  bits |= (static_cast<uint64_t>(pad_bits_) << 56) >> bit_count;
+  for (; bit_count > 0; bit_count -= std::min<size_t>(bit_count, 8)) {
+    buffer[buffer_size++] = static_cast<char>(bits >> 56);
+    bits <<= 8;
   }
+  out->AppendBytes(StringPiece(buffer, buffer_size));
 }
 
 size_t HpackHuffmanTable::EncodedSize(StringPiece in) const {
@@ -76,7 +76,7 @@ class NET_EXPORT_PRIVATE HpackHuffmanTable {
   bool IsInitialized() const;
 
   // Encodes the input string to the output stream using the table's Huffman
-  // context.
+  // context. |out| must end on a byte boundary.
   void EncodeString(base::StringPiece in, HpackOutputStream* out) const;
 
   // Returns the encoded size of the input string.
@@ -9,12 +9,13 @@
 #include <stdint.h>
 
 #include <algorithm>
-#include <deque>
+#include <memory>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "base/containers/linked_list.h"
 #include "base/logging.h"
 #include "net/spdy/spdy_bug_tracker.h"
 #include "net/spdy/spdy_protocol.h"
@@ -34,7 +35,9 @@ class PriorityWriteSchedulerPeer;
 // Internally, PriorityWriteScheduler consists of 8 PriorityInfo objects, one
 // for each priority value.  Each PriorityInfo contains a list of streams of
 // that priority that are ready to write, as well as a timestamp of the last
-// I/O event that occurred for a stream of that priority.
+// I/O event that occurred for a stream of that priority.  The lists are linked
+// through the streams' own state, so that any stream can be added to or removed
+// from them in constant time, however many streams are ready.
 template <typename StreamIdType>
 class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
  public:
@@ -57,9 +60,11 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       SPDY_BUG << "Stream " << kHttp2RootStreamId << " already registered";
       return;
     }
-    StreamInfo stream_info = {precedence.spdy3_priority(), stream_id, false};
+    std::unique_ptr<StreamInfo> stream_info(
+        new StreamInfo(precedence.spdy3_priority(), stream_id));
     bool inserted =
-        stream_infos_.insert(std::make_pair(stream_id, stream_info)).second;
+        stream_infos_.insert(std::make_pair(stream_id, std::move(stream_info)))
+            .second;
     SPDY_BUG_IF(!inserted) << "Stream " << stream_id << " already registered";
   }
 
@@ -69,11 +74,9 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       SPDY_BUG << "Stream " << stream_id << " not registered";
       return;
     }
-    StreamInfo& stream_info = it->second;
-    if (stream_info.ready) {
-      bool erased =
-          Erase(&priority_infos_[stream_info.priority].ready_list, stream_info);
-      DCHECK(erased);
+    StreamInfo* stream_info = it->second.get();
+    if (stream_info->ready) {
+      Unready(stream_info);
     }
     stream_infos_.erase(it);
   }
@@ -89,7 +92,7 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       DVLOG(1) << "Stream " << stream_id << " not registered";
       return StreamPrecedenceType(kV3LowestPriority);
     }
-    return StreamPrecedenceType(it->second.priority);
+    return StreamPrecedenceType(it->second->priority);
   }
 
   void UpdateStreamPrecedence(StreamIdType stream_id,
@@ -108,19 +111,16 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       DVLOG(1) << "Stream " << stream_id << " not registered";
       return;
     }
-    StreamInfo& stream_info = it->second;
+    StreamInfo* stream_info = it->second.get();
     SpdyPriority new_priority = precedence.spdy3_priority();
-    if (stream_info.priority == new_priority) {
+    if (stream_info->priority == new_priority) {
       return;
     }
-    if (stream_info.ready) {
-      bool erased =
-          Erase(&priority_infos_[stream_info.priority].ready_list, stream_info);
-      DCHECK(erased);
-      priority_infos_[new_priority].ready_list.push_back(&stream_info);
-      ++num_ready_streams_;
+    if (stream_info->ready) {
+      stream_info->RemoveFromList();
+      priority_infos_[new_priority].ready_list.Append(stream_info);
     }
-    stream_info.priority = new_priority;
+    stream_info->priority = new_priority;
   }
 
   std::vector<StreamIdType> GetStreamChildren(
@@ -135,7 +135,7 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       SPDY_BUG << "Stream " << stream_id << " not registered";
       return;
     }
-    PriorityInfo& priority_info = priority_infos_[it->second.priority];
+    PriorityInfo& priority_info = priority_infos_[it->second->priority];
     priority_info.last_event_time_usec =
         std::max(priority_info.last_event_time_usec, now_in_usec);
   }
@@ -147,7 +147,7 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       return 0;
     }
     int64_t last_event_time_usec = 0;
-    const StreamInfo& stream_info = it->second;
+    const StreamInfo& stream_info = *it->second;
     for (SpdyPriority p = kV3HighestPriority; p < stream_info.priority; ++p) {
       last_event_time_usec = std::max(last_event_time_usec,
                                       priority_infos_[p].last_event_time_usec);
@@ -165,12 +165,9 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
     for (SpdyPriority p = kV3HighestPriority; p <= kV3LowestPriority; ++p) {
       ReadyList& ready_list = priority_infos_[p].ready_list;
       if (!ready_list.empty()) {
-        StreamInfo* info = ready_list.front();
-        ready_list.pop_front();
-        --num_ready_streams_;
-
+        StreamInfo* info = ready_list.head()->value();
         DCHECK(stream_infos_.find(info->stream_id) != stream_infos_.end());
-        info->ready = false;
+        Unready(info);
         return std::make_tuple(info->stream_id,
                                StreamPrecedenceType(info->priority));
       }
@@ -187,7 +184,7 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
     }
 
     // If there's a higher priority stream, this stream should yield.
-    const StreamInfo& stream_info = it->second;
+    const StreamInfo& stream_info = *it->second;
     for (SpdyPriority p = kV3HighestPriority; p < stream_info.priority; ++p) {
       if (!priority_infos_[p].ready_list.empty()) {
         return true;
@@ -196,8 +193,9 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
 
     // If this priority level is empty, or this stream is the next up, there's
     // no need to yield.
-    const auto& ready_list = priority_infos_[it->second.priority].ready_list;
-    if (ready_list.empty() || ready_list.front()->stream_id == stream_id) {
+    const auto& ready_list = priority_infos_[stream_info.priority].ready_list;
+    if (ready_list.empty() ||
+        ready_list.head()->value()->stream_id == stream_id) {
       return false;
     }
 
@@ -212,18 +210,18 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       SPDY_BUG << "Stream " << stream_id << " not registered";
       return;
     }
-    StreamInfo& stream_info = it->second;
-    if (stream_info.ready) {
+    StreamInfo* stream_info = it->second.get();
+    if (stream_info->ready) {
       return;
     }
-    ReadyList& ready_list = priority_infos_[stream_info.priority].ready_list;
-    if (add_to_front) {
-      ready_list.push_front(&stream_info);
+    ReadyList& ready_list = priority_infos_[stream_info->priority].ready_list;
+    if (add_to_front && !ready_list.empty()) {
+      stream_info->InsertBefore(ready_list.head());
     } else {
-      ready_list.push_back(&stream_info);
+      ready_list.Append(stream_info);
     }
     ++num_ready_streams_;
-    stream_info.ready = true;
+    stream_info->ready = true;
   }
 
   void MarkStreamNotReady(StreamIdType stream_id) override {
@@ -232,14 +230,11 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
       SPDY_BUG << "Stream " << stream_id << " not registered";
       return;
     }
-    StreamInfo& stream_info = it->second;
-    if (!stream_info.ready) {
+    StreamInfo* stream_info = it->second.get();
+    if (!stream_info->ready) {
       return;
     }
-    bool erased =
-        Erase(&priority_infos_[stream_info.priority].ready_list, stream_info);
-    DCHECK(erased);
-    stream_info.ready = false;
+    Unready(stream_info);
   }
 
   // Returns true iff the number of ready streams is non-zero.
@@ -253,14 +248,17 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
 
   // State kept for all registered streams. All ready streams have ready = true
   // and should be present in priority_infos_[priority].ready_list.
-  struct StreamInfo {
+  struct StreamInfo : public base::LinkNode<StreamInfo> {
+    StreamInfo(SpdyPriority priority, StreamIdType stream_id)
+        : priority(priority), stream_id(stream_id), ready(false) {}
+
     SpdyPriority priority;
     StreamIdType stream_id;
     bool ready;
   };
 
-  // 0(1) size lookup, 0(1) insert at front or back.
-  typedef std::deque<StreamInfo*> ReadyList;
+  // 0(1) insert at front or back, 0(1) removal of any element.
+  typedef base::LinkedList<StreamInfo> ReadyList;
 
   // State kept for each priority level.
   struct PriorityInfo {
@@ -270,19 +268,16 @@ class PriorityWriteScheduler : public WriteScheduler<StreamIdType> {
     int64_t last_event_time_usec = 0;
   };
 
-  typedef std::unordered_map<StreamIdType, StreamInfo> StreamInfoMap;
+  // StreamInfos are held by pointer, since they are linked into ready lists.
+  typedef std::unordered_map<StreamIdType, std::unique_ptr<StreamInfo>>
+      StreamInfoMap;
 
-  // Erases first occurrence (which should be the only one) of |info| in
-  // |ready_list|, returning true if found (and erased), or false otherwise.
-  // Decrements |num_ready_streams_| if an entry is erased.
-  bool Erase(ReadyList* ready_list, const StreamInfo& info) {
-    auto it = std::find(ready_list->begin(), ready_list->end(), &info);
-    if (it == ready_list->end()) {
-      return false;
-    }
-    ready_list->erase(it);
+  // Removes |info|, which must be ready, from its ready list.
+  void Unready(StreamInfo* info) {
+    DCHECK(info->ready);
+    info->RemoveFromList();
+    info->ready = false;
     --num_ready_streams_;
-    return true;
   }
 
   // Number of ready streams.
@@ -19,7 +19,13 @@ class PriorityWriteSchedulerPeer {
       : scheduler_(scheduler) {}
 
   size_t NumReadyStreams(SpdyPriority priority) const {
-    return scheduler_->priority_infos_[priority].ready_list.size();
+    const auto& ready_list = scheduler_->priority_infos_[priority].ready_list;
+    size_t num_ready_streams = 0;
+    for (auto* node = ready_list.head(); node != ready_list.end();
+         node = node->next()) {
+      ++num_ready_streams;
+    }
+    return num_ready_streams;
   }
 
  private:
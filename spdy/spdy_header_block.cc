@@ -28,13 +28,9 @@ using std::string;
 namespace net {
 namespace {
 
-// By default, linked_hash_map's internal map allocates space for 100 map
-// buckets on construction, which is larger than necessary.  Standard library
-// unordered map implementations use a list of prime numbers to set the bucket
-// count for a particular capacity.  |kInitialMapBuckets| is chosen to reduce
-// memory usage for small header blocks, at the cost of having to rehash for
-// large header blocks.
-const size_t kInitialMapBuckets = 11;
+// Above this many headers, lookups go through a hash index rather than a scan
+// of the header list. Typical request and response blocks stay below it.
+const size_t kMaxHeadersWithoutIndex = 32;
 
 // SpdyHeaderBlock::Storage allocates blocks of this size by default.
 const size_t kDefaultStorageBlockSize = 2048;
@@ -64,7 +60,7 @@ StringPiece SeparatorForKey(StringPiece key) {
 class SpdyHeaderBlock::Storage {
  public:
   Storage() : arena_(kDefaultStorageBlockSize) {}
-  ~Storage() { Clear(); }
+  ~Storage() {}
 
   StringPiece Write(const StringPiece s) {
     return StringPiece(arena_.Memdup(s.data(), s.size()), s.size());
@@ -76,23 +72,22 @@ class SpdyHeaderBlock::Storage {
     arena_.Free(const_cast<char*>(s.data()), s.size());
   }
 
-  void Clear() { arena_.Reset(); }
-
-  // Given a list of fragments and a separator, writes the fragments joined by
-  // the separator to a contiguous region of memory. Returns a StringPiece
-  // pointing to the region of memory.
-  StringPiece WriteFragments(const std::vector<StringPiece>& fragments,
-                             StringPiece separator) {
-    if (fragments.empty()) {
-      return StringPiece();
-    }
-    size_t total_size = separator.size() * (fragments.size() - 1);
-    for (const auto fragment : fragments) {
-      total_size += fragment.size();
-    }
-    char* dst = arena_.Alloc(total_size);
-    size_t written = Join(dst, fragments, separator);
-    DCHECK_EQ(written, total_size);
+  // Invalidates all StringPieces, keeping some memory for later writes.
+  void Clear() { arena_.Recycle(); }
+
+  // Returns |original| followed by |separator| and |fragment|. If |original|
+  // is the most recent write, it is extended in place when there is room;
+  // otherwise the result is written to a new region of memory.
+  StringPiece Append(StringPiece original,
+                     StringPiece separator,
+                     StringPiece fragment) {
+    size_t total_size = original.size() + separator.size() + fragment.size();
+    char* dst = arena_.Realloc(const_cast<char*>(original.data()),
+                               original.size(), total_size);
+    char* end = dst + original.size();
+    memcpy(end, separator.data(), separator.size());
+    end += separator.size();
+    memcpy(end, fragment.data(), fragment.size());
     return StringPiece(dst, total_size);
   }
 
@@ -109,67 +104,22 @@ class SpdyHeaderBlock::Storage {
   DISALLOW_COPY_AND_ASSIGN(Storage);
 };
 
-SpdyHeaderBlock::HeaderValue::HeaderValue(Storage* storage,
-                                          StringPiece key,
-                                          StringPiece initial_value)
-    : storage_(storage), fragments_({initial_value}), pair_({key, {}}) {}
-
-SpdyHeaderBlock::HeaderValue::HeaderValue(HeaderValue&& other)
-    : storage_(other.storage_),
-      fragments_(std::move(other.fragments_)),
-      pair_(std::move(other.pair_)) {}
-
-SpdyHeaderBlock::HeaderValue& SpdyHeaderBlock::HeaderValue::operator=(
-    HeaderValue&& other) {
-  storage_ = other.storage_;
-  fragments_ = std::move(other.fragments_);
-  pair_ = std::move(other.pair_);
-  return *this;
-}
-
-SpdyHeaderBlock::HeaderValue::~HeaderValue() {}
-
-StringPiece SpdyHeaderBlock::HeaderValue::ConsolidatedValue() const {
-  if (fragments_.empty()) {
-    return StringPiece();
-  }
-  if (fragments_.size() > 1) {
-    fragments_ = {
-        storage_->WriteFragments(fragments_, SeparatorForKey(pair_.first))};
-  }
-  return fragments_[0];
-}
-
-void SpdyHeaderBlock::HeaderValue::Append(StringPiece fragment) {
-  fragments_.push_back(fragment);
-}
-
-const std::pair<StringPiece, StringPiece>&
-SpdyHeaderBlock::HeaderValue::as_pair() const {
-  pair_.second = ConsolidatedValue();
-  return pair_;
-}
+// static
+const size_t SpdyHeaderBlock::kNotFound = static_cast<size_t>(-1);
 
-SpdyHeaderBlock::iterator::iterator(MapType::const_iterator it) : it_(it) {}
+SpdyHeaderBlock::iterator::iterator(ListType::const_iterator it) : it_(it) {}
 
 SpdyHeaderBlock::iterator::iterator(const iterator& other) : it_(other.it_) {}
 
 SpdyHeaderBlock::iterator::~iterator() {}
 
-SpdyHeaderBlock::ValueProxy::ValueProxy(
-    SpdyHeaderBlock::MapType* block,
-    SpdyHeaderBlock::Storage* storage,
-    SpdyHeaderBlock::MapType::iterator lookup_result,
-    const StringPiece key)
-    : block_(block),
-      storage_(storage),
-      lookup_result_(lookup_result),
-      key_(key),
-      valid_(true) {}
+SpdyHeaderBlock::ValueProxy::ValueProxy(SpdyHeaderBlock* block,
+                                        size_t lookup_result,
+                                        const StringPiece key)
+    : block_(block), lookup_result_(lookup_result), key_(key), valid_(true) {}
 
 SpdyHeaderBlock::ValueProxy::ValueProxy(ValueProxy&& other)
     : block_(other.block_),
-      storage_(other.storage_),
       lookup_result_(other.lookup_result_),
       key_(other.key_),
       valid_(true) {
@@ -179,7 +129,6 @@ SpdyHeaderBlock::ValueProxy::ValueProxy(ValueProxy&& other)
 SpdyHeaderBlock::ValueProxy& SpdyHeaderBlock::ValueProxy::operator=(
     SpdyHeaderBlock::ValueProxy&& other) {
   block_ = other.block_;
-  storage_ = other.storage_;
   lookup_result_ = other.lookup_result_;
   key_ = other.key_;
   valid_ = true;
@@ -188,54 +137,53 @@ SpdyHeaderBlock::ValueProxy& SpdyHeaderBlock::ValueProxy::operator=(
 }
 
 SpdyHeaderBlock::ValueProxy::~ValueProxy() {
-  // If the ValueProxy is destroyed while lookup_result_ == block_->end(),
-  // the assignment operator was never used, and the block's Storage can
-  // reclaim the memory used by the key. This makes lookup-only access to
+  // If the ValueProxy is destroyed while lookup_result_ == kNotFound, the
+  // assignment operator was never used, and the block's Storage can reclaim
+  // the memory used by the key. This makes lookup-only access to
   // SpdyHeaderBlock through operator[] memory-neutral.
-  if (valid_ && lookup_result_ == block_->end()) {
-    storage_->Rewind(key_);
+  if (valid_ && lookup_result_ == kNotFound) {
+    block_->GetStorage()->Rewind(key_);
   }
 }
 
 SpdyHeaderBlock::ValueProxy& SpdyHeaderBlock::ValueProxy::operator=(
     const StringPiece value) {
-  if (lookup_result_ == block_->end()) {
+  if (lookup_result_ == kNotFound) {
     DVLOG(1) << "Inserting: (" << key_ << ", " << value << ")";
-    lookup_result_ =
-        block_
-            ->emplace(make_pair(
-                key_, HeaderValue(storage_, key_, storage_->Write(value))))
-            .first;
+    block_->AppendBackedHeader(key_, value);
+    lookup_result_ = block_->headers_.size() - 1;
   } else {
     DVLOG(1) << "Updating key: " << key_ << " with value: " << value;
-    lookup_result_->second =
-        HeaderValue(storage_, key_, storage_->Write(value));
+    block_->headers_[lookup_result_].second =
+        block_->GetStorage()->Write(value);
   }
   return *this;
 }
 
 string SpdyHeaderBlock::ValueProxy::as_string() const {
-  if (lookup_result_ == block_->end()) {
+  if (lookup_result_ == kNotFound) {
     return "";
   } else {
-    return lookup_result_->second.value().as_string();
+    return block_->headers_[lookup_result_].second.as_string();
   }
 }
 
-SpdyHeaderBlock::SpdyHeaderBlock() : block_(kInitialMapBuckets) {}
+SpdyHeaderBlock::SpdyHeaderBlock() {}
 
 SpdyHeaderBlock::SpdyHeaderBlock(SpdyHeaderBlock&& other) = default;
 
 SpdyHeaderBlock::~SpdyHeaderBlock() {}
 
 SpdyHeaderBlock& SpdyHeaderBlock::operator=(SpdyHeaderBlock&& other) {
-  block_.swap(other.block_);
+  headers_.swap(other.headers_);
+  index_.swap(other.index_);
   storage_.swap(other.storage_);
   return *this;
 }
 
 SpdyHeaderBlock SpdyHeaderBlock::Clone() const {
   SpdyHeaderBlock copy;
+  copy.headers_.reserve(headers_.size());
   for (const auto& p : *this) {
     copy.AppendHeader(p.first, p.second);
   }
@@ -264,31 +212,43 @@ string SpdyHeaderBlock::DebugString() const {
   return output;
 }
 
+void SpdyHeaderBlock::erase(StringPiece key) {
+  size_t position = Lookup(key);
+  if (position == kNotFound) {
+    return;
+  }
+  headers_.erase(headers_.begin() + position);
+  if (index_) {
+    RebuildIndex();
+  }
+}
+
 void SpdyHeaderBlock::clear() {
-  block_.clear();
-  storage_.reset();
+  headers_.clear();
+  index_.reset();
+  if (storage_) {
+    storage_->Clear();
+  }
 }
 
 void SpdyHeaderBlock::insert(const SpdyHeaderBlock::value_type& value) {
   // TODO(birenroy): Write new value in place of old value, if it fits.
-  auto iter = block_.find(value.first);
-  if (iter == block_.end()) {
+  size_t position = Lookup(value.first);
+  if (position == kNotFound) {
     DVLOG(1) << "Inserting: (" << value.first << ", " << value.second << ")";
     AppendHeader(value.first, value.second);
   } else {
-    DVLOG(1) << "Updating key: " << iter->first
+    DVLOG(1) << "Updating key: " << headers_[position].first
              << " with value: " << value.second;
-    auto* storage = GetStorage();
-    iter->second =
-        HeaderValue(storage, iter->first, storage->Write(value.second));
+    headers_[position].second = GetStorage()->Write(value.second);
   }
 }
 
 SpdyHeaderBlock::ValueProxy SpdyHeaderBlock::operator[](const StringPiece key) {
   DVLOG(2) << "Operator[] saw key: " << key;
   StringPiece out_key;
-  auto iter = block_.find(key);
-  if (iter == block_.end()) {
+  size_t position = Lookup(key);
+  if (position == kNotFound) {
     // We write the key first, to assure that the ValueProxy has a
     // reference to a valid StringPiece in its operator=.
     out_key = GetStorage()->Write(key);
@@ -296,35 +256,77 @@ SpdyHeaderBlock::ValueProxy SpdyHeaderBlock::operator[](const StringPiece key) {
              << static_cast<const void*>(key.data()) << ", " << std::dec
              << key.size();
   } else {
-    out_key = iter->first;
+    out_key = headers_[position].first;
   }
-  return ValueProxy(&block_, GetStorage(), iter, out_key);
+  return ValueProxy(this, position, out_key);
 }
 
 void SpdyHeaderBlock::AppendValueOrAddHeader(const StringPiece key,
                                              const StringPiece value) {
-  auto iter = block_.find(key);
-  if (iter == block_.end()) {
+  size_t position = Lookup(key);
+  if (position == kNotFound) {
     DVLOG(1) << "Inserting: (" << key << ", " << value << ")";
     AppendHeader(key, value);
     return;
   }
-  DVLOG(1) << "Updating key: " << iter->first << "; appending value: " << value;
-  iter->second.Append(GetStorage()->Write(value));
+  value_type& header = headers_[position];
+  DVLOG(1) << "Updating key: " << header.first
+           << "; appending value: " << value;
+  header.second = GetStorage()->Append(header.second,
+                                       SeparatorForKey(header.first), value);
 }
 
 size_t SpdyHeaderBlock::EstimateMemoryUsage() const {
-  // TODO(xunjieli): https://crbug.com/669108. Also include |block_| when EMU()
-  // supports linked_hash_map.
-  return SpdyEstimateMemoryUsage(storage_);
+  // TODO(xunjieli): https://crbug.com/669108. Also include |index_| when EMU()
+  // supports StringPiece keys.
+  return SpdyEstimateMemoryUsage(storage_) +
+         headers_.capacity() * sizeof(value_type);
+}
+
+size_t SpdyHeaderBlock::Lookup(StringPiece key) const {
+  if (index_) {
+    auto it = index_->find(key);
+    return it == index_->end() ? kNotFound : it->second;
+  }
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    if (headers_[i].first == key) {
+      return i;
+    }
+  }
+  return kNotFound;
+}
+
+SpdyHeaderBlock::iterator SpdyHeaderBlock::IteratorAt(size_t position) const {
+  if (position == kNotFound) {
+    return end();
+  }
+  return iterator(headers_.begin() + position);
+}
+
+void SpdyHeaderBlock::AppendBackedHeader(const StringPiece backed_key,
+                                         const StringPiece value) {
+  headers_.push_back(make_pair(backed_key, GetStorage()->Write(value)));
+  if (index_) {
+    index_->emplace(backed_key, headers_.size() - 1);
+  } else if (headers_.size() > kMaxHeadersWithoutIndex) {
+    RebuildIndex();
+  }
 }
 
 void SpdyHeaderBlock::AppendHeader(const StringPiece key,
                                    const StringPiece value) {
-  auto* storage = GetStorage();
-  auto backed_key = storage->Write(key);
-  block_.emplace(make_pair(
-      backed_key, HeaderValue(storage, backed_key, storage->Write(value))));
+  AppendBackedHeader(GetStorage()->Write(key), value);
+}
+
+void SpdyHeaderBlock::RebuildIndex() {
+  if (!index_) {
+    index_.reset(new IndexType);
+  }
+  index_->clear();
+  index_->reserve(headers_.size());
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    index_->emplace(headers_[i].first, i);
+  }
 }
 
 SpdyHeaderBlock::Storage* SpdyHeaderBlock::GetStorage() {
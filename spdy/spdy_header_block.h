@@ -7,15 +7,14 @@
 
 #include <stddef.h>
 
-#include <list>
-#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "base/macros.h"
 #include "base/strings/string_piece.h"
-#include "net/base/linked_hash_map.h"
 #include "net/base/net_export.h"
 #include "net/log/net_log.h"
 
@@ -36,10 +35,17 @@ class ValueProxyPeer;
 // names and values. This data structure preserves insertion order.
 //
 // Under the hood, this data structure uses large, contiguous blocks of memory
-// to store names and values. Lookups may be performed with StringPiece keys,
-// and values are returned as StringPieces (via ValueProxy, below).
-// Value StringPieces are valid as long as the SpdyHeaderBlock exists; allocated
-// memory is never freed until SpdyHeaderBlock's destruction.
+// to store names and values, and a flat vector of StringPiece pairs pointing
+// into them. Lookups scan the vector until the block grows past a few dozen
+// headers, at which point a hash index is built alongside it. Lookups may be
+// performed with StringPiece keys, and values are returned as StringPieces
+// (via ValueProxy, below). Value StringPieces are valid as long as the
+// SpdyHeaderBlock exists and clear() has not been called; allocated memory is
+// never freed until then.
+//
+// clear() keeps the vector's capacity and the first block of backing memory,
+// so a SpdyHeaderBlock that is cleared and refilled for each header block on a
+// connection, as the HPACK decoders do, stops allocating once warm.
 //
 // This implementation does not make much of an effort to minimize wasted space.
 // It's expected that keys are rarely deleted from a SpdyHeaderBlock.
@@ -47,50 +53,15 @@ class NET_EXPORT SpdyHeaderBlock {
  private:
   class Storage;
 
-  // Stores a list of value fragments that can be joined later with a
-  // key-dependent separator.
-  class NET_EXPORT HeaderValue {
-   public:
-    HeaderValue(Storage* storage,
-                base::StringPiece key,
-                base::StringPiece initial_value);
-
-    // Moves are allowed.
-    HeaderValue(HeaderValue&& other);
-    HeaderValue& operator=(HeaderValue&& other);
-
-    // Copies are not.
-    HeaderValue(const HeaderValue& other) = delete;
-    HeaderValue& operator=(const HeaderValue& other) = delete;
-
-    ~HeaderValue();
-
-    // Consumes at most |fragment.size()| bytes of memory.
-    void Append(base::StringPiece fragment);
-
-    base::StringPiece value() const { return as_pair().second; }
-    const std::pair<base::StringPiece, base::StringPiece>& as_pair() const;
-
-   private:
-    // May allocate a large contiguous region of memory to hold the concatenated
-    // fragments and separators.
-    base::StringPiece ConsolidatedValue() const;
-
-    mutable Storage* storage_;
-    mutable std::vector<base::StringPiece> fragments_;
-    // The first element is the key; the second is the consolidated value.
-    mutable std::pair<base::StringPiece, base::StringPiece> pair_;
-  };
-
-  typedef linked_hash_map<base::StringPiece, HeaderValue, base::StringPieceHash>
-      MapType;
+  typedef std::vector<std::pair<base::StringPiece, base::StringPiece>>
+      ListType;
 
  public:
   typedef std::pair<base::StringPiece, base::StringPiece> value_type;
 
-  // Provides iteration over a sequence of std::pair<StringPiece, StringPiece>,
-  // even though the underlying MapType::value_type is different. Dereferencing
-  // the iterator will result in memory allocation for multi-value headers.
+  // Provides iteration over a sequence of std::pair<StringPiece, StringPiece>.
+  // Like the iterators of std::vector, it is invalidated by any change to the
+  // block.
   class NET_EXPORT iterator {
    public:
     // The following type definitions fulfill the requirements for iterator
@@ -99,19 +70,17 @@ class NET_EXPORT SpdyHeaderBlock {
     typedef value_type& reference;
     typedef value_type* pointer;
     typedef std::forward_iterator_tag iterator_category;
-    typedef MapType::iterator::difference_type difference_type;
+    typedef ListType::const_iterator::difference_type difference_type;
 
     // In practice, this iterator only offers access to const value_type.
     typedef const value_type& const_reference;
     typedef const value_type* const_pointer;
 
-    explicit iterator(MapType::const_iterator it);
+    explicit iterator(ListType::const_iterator it);
     iterator(const iterator& other);
     ~iterator();
 
-    // This will result in memory allocation if the value consists of multiple
-    // fragments.
-    const_reference operator*() const { return it_->second.as_pair(); }
+    const_reference operator*() const { return *it_; }
 
     const_pointer operator->() const { return &(this->operator*()); }
     bool operator==(const iterator& it) const { return it_ == it.it_; }
@@ -129,7 +98,7 @@ class NET_EXPORT SpdyHeaderBlock {
     }
 
    private:
-    MapType::const_iterator it_;
+    ListType::const_iterator it_;
   };
   typedef iterator const_iterator;
 
@@ -151,19 +120,20 @@ class NET_EXPORT SpdyHeaderBlock {
   // keys and values.
   std::string DebugString() const;
 
-  iterator begin() { return iterator(block_.begin()); }
-  iterator end() { return iterator(block_.end()); }
-  const_iterator begin() const { return const_iterator(block_.begin()); }
-  const_iterator end() const { return const_iterator(block_.end()); }
-  bool empty() const { return block_.empty(); }
-  size_t size() const { return block_.size(); }
-  iterator find(base::StringPiece key) { return iterator(block_.find(key)); }
+  iterator begin() { return iterator(headers_.begin()); }
+  iterator end() { return iterator(headers_.end()); }
+  const_iterator begin() const { return const_iterator(headers_.begin()); }
+  const_iterator end() const { return const_iterator(headers_.end()); }
+  bool empty() const { return headers_.empty(); }
+  size_t size() const { return headers_.size(); }
+  iterator find(base::StringPiece key) { return IteratorAt(Lookup(key)); }
   const_iterator find(base::StringPiece key) const {
-    return const_iterator(block_.find(key));
+    return IteratorAt(Lookup(key));
   }
-  void erase(base::StringPiece key) { block_.erase(key); }
+  void erase(base::StringPiece key);
 
-  // Clears both our MapType member and the memory used to hold headers.
+  // Removes all headers. The memory used to hold them is kept for reuse by
+  // later insertions.
   void clear();
 
   // The next few methods copy data into our backing storage.
@@ -206,14 +176,13 @@ class NET_EXPORT SpdyHeaderBlock {
     friend class SpdyHeaderBlock;
     friend class test::ValueProxyPeer;
 
-    ValueProxy(SpdyHeaderBlock::MapType* block,
-               SpdyHeaderBlock::Storage* storage,
-               SpdyHeaderBlock::MapType::iterator lookup_result,
+    ValueProxy(SpdyHeaderBlock* block,
+               size_t lookup_result,
                const base::StringPiece key);
 
-    SpdyHeaderBlock::MapType* block_;
-    SpdyHeaderBlock::Storage* storage_;
-    SpdyHeaderBlock::MapType::iterator lookup_result_;
+    SpdyHeaderBlock* block_;
+    // The position of |key_| in the block, or kNotFound.
+    size_t lookup_result_;
     base::StringPiece key_;
     bool valid_;
   };
@@ -224,13 +193,29 @@ class NET_EXPORT SpdyHeaderBlock {
  private:
   friend class test::SpdyHeaderBlockPeer;
 
+  typedef std::unordered_map<base::StringPiece, size_t, base::StringPieceHash>
+      IndexType;
+
+  static const size_t kNotFound;
+
+  // Returns the position of |key| in |headers_|, or kNotFound.
+  size_t Lookup(base::StringPiece key) const;
+  iterator IteratorAt(size_t position) const;
+
+  // Adds a header whose key is already in backing storage.
+  void AppendBackedHeader(const base::StringPiece backed_key,
+                          const base::StringPiece value);
   void AppendHeader(const base::StringPiece key, const base::StringPiece value);
+  void RebuildIndex();
   Storage* GetStorage();
   size_t bytes_allocated() const;
 
-  // StringPieces held by |block_| point to memory owned by |*storage_|.
-  // |storage_| might be nullptr as long as |block_| is empty.
-  MapType block_;
+  // StringPieces held by |headers_| point to memory owned by |*storage_|.
+  // |storage_| might be nullptr as long as |headers_| is empty.
+  ListType headers_;
+  // Maps each key to its position in |headers_|. Only built once the block
+  // holds more than a few dozen headers; until then lookups scan |headers_|.
+  std::unique_ptr<IndexType> index_;
   std::unique_ptr<Storage> storage_;
 };
 
@@ -0,0 +1,123 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/spdy/spdy_header_block.h"
+
+#include <stddef.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/format_macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_time_logger.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 100000;
+
+// Returns the headers of a typical browser request, padded with custom headers
+// up to |num_headers|, and with the cookie split into crumbs as HPACK encoders
+// do.
+std::vector<std::pair<std::string, std::string>> RequestHeaders(
+    size_t num_headers) {
+  std::vector<std::pair<std::string, std::string>> headers = {
+      {":method", "GET"},
+      {":scheme", "https"},
+      {":authority", "www.example.com"},
+      {":path", "/static/js/application.min.js?v=1493069312"},
+      {"user-agent",
+       "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like "
+       "Gecko) Chrome/58.0.3029.81 Safari/537.36"},
+      {"accept", "*/*"},
+      {"referer", "https://www.example.com/"},
+      {"accept-encoding", "gzip, deflate, br"},
+      {"accept-language", "en-US,en;q=0.8"},
+      {"cookie", "session=3fa1c8e2d7b94a6c"},
+      {"cookie", "prefs=lang:en|tz:utc"},
+      {"cookie", "_ga=GA1.2.1043948221.1493069312"},
+  };
+  for (size_t i = headers.size(); i < num_headers; ++i) {
+    headers.push_back(
+        std::make_pair("x-custom-header-" + base::SizeTToString(i),
+                       "custom-value-" + base::SizeTToString(i)));
+  }
+  return headers;
+}
+
+void FillBlock(const std::vector<std::pair<std::string, std::string>>& headers,
+               SpdyHeaderBlock* block) {
+  for (const auto& header : headers)
+    block->AppendValueOrAddHeader(header.first, header.second);
+}
+
+class SpdyHeaderBlockPerfTest : public testing::TestWithParam<size_t> {};
+
+INSTANTIATE_TEST_CASE_P(Sizes,
+                        SpdyHeaderBlockPerfTest,
+                        testing::Values(20u, 40u));
+
+// Builds, reads and destroys a new block for every request.
+TEST_P(SpdyHeaderBlockPerfTest, NewBlocks) {
+  const auto headers = RequestHeaders(GetParam());
+  size_t found = 0;
+
+  base::PerfTimeLogger timer(
+      base::StringPrintf("SpdyHeaderBlock_NewBlocks_%" PRIuS, GetParam())
+          .c_str());
+  for (int i = 0; i < kNumIterations; ++i) {
+    SpdyHeaderBlock block;
+    FillBlock(headers, &block);
+    found += block.find(":path") != block.end();
+    found += block.find("cookie") != block.end();
+  }
+  timer.Done();
+
+  EXPECT_EQ(2u * kNumIterations, found);
+}
+
+// Clears and refills one block for every request, as BufferedSpdyFramer does
+// for the HEADERS frames a session receives.
+TEST_P(SpdyHeaderBlockPerfTest, ReusedBlock) {
+  const auto headers = RequestHeaders(GetParam());
+  size_t found = 0;
+
+  base::PerfTimeLogger timer(
+      base::StringPrintf("SpdyHeaderBlock_ReusedBlock_%" PRIuS, GetParam())
+          .c_str());
+  SpdyHeaderBlock block;
+  for (int i = 0; i < kNumIterations; ++i) {
+    block.clear();
+    FillBlock(headers, &block);
+    found += block.find(":path") != block.end();
+    found += block.find("cookie") != block.end();
+  }
+  timer.Done();
+
+  EXPECT_EQ(2u * kNumIterations, found);
+}
+
+// Copies a block, as happens when a stream keeps the headers it was handed.
+TEST_P(SpdyHeaderBlockPerfTest, Clone) {
+  SpdyHeaderBlock block;
+  FillBlock(RequestHeaders(GetParam()), &block);
+  size_t size = 0;
+
+  base::PerfTimeLogger timer(
+      base::StringPrintf("SpdyHeaderBlock_Clone_%" PRIuS, GetParam()).c_str());
+  for (int i = 0; i < kNumIterations; ++i)
+    size += block.Clone().size();
+  timer.Done();
+
+  EXPECT_EQ(block.size() * kNumIterations, size);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -7,6 +7,7 @@
 #include <memory>
 #include <utility>
 
+#include "base/strings/string_number_conversions.h"
 #include "base/values.h"
 #include "net/log/net_log_capture_mode.h"
 #include "net/spdy/spdy_test_utils.h"
@@ -26,6 +27,13 @@ class ValueProxyPeer {
   static StringPiece key(SpdyHeaderBlock::ValueProxy* p) { return p->key_; }
 };
 
+class SpdyHeaderBlockPeer {
+ public:
+  static size_t bytes_allocated(const SpdyHeaderBlock& block) {
+    return block.bytes_allocated();
+  }
+};
+
 std::pair<StringPiece, StringPiece> Pair(StringPiece k, StringPiece v) {
   return make_pair(k, v);
 }
@@ -195,6 +203,65 @@ TEST(SpdyHeaderBlockTest, AppendHeaders) {
   EXPECT_EQ("singleton", block["h4"]);
 }
 
+// This test verifies lookups, updates and erasure in a block large enough to be
+// indexed.
+TEST(SpdyHeaderBlockTest, LargeBlock) {
+  const int kNumHeaders = 100;
+  SpdyHeaderBlock block;
+  for (int i = 0; i < kNumHeaders; ++i) {
+    block["key" + base::IntToString(i)] = "value" + base::IntToString(i);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumHeaders), block.size());
+  EXPECT_EQ(Pair("key0", "value0"), *block.begin());
+  EXPECT_EQ(Pair("key99", "value99"), *block.find("key99"));
+
+  block.erase("key0");
+  block.erase("key50");
+  EXPECT_EQ(block.end(), block.find("key0"));
+  EXPECT_EQ(block.end(), block.find("key50"));
+  EXPECT_EQ(Pair("key51", "value51"), *block.find("key51"));
+  EXPECT_EQ(Pair("key1", "value1"), *block.begin());
+
+  block.insert(make_pair("key75", "updated"));
+  block.AppendValueOrAddHeader("key99", "appended");
+  block.AppendValueOrAddHeader("key0", "re-added");
+  EXPECT_EQ("updated", block["key75"]);
+  EXPECT_EQ(string("value99\0appended", 16), block["key99"]);
+  EXPECT_EQ(static_cast<size_t>(kNumHeaders - 1), block.size());
+
+  // Insertion order is preserved, with the re-added key at the end.
+  auto it = block.begin();
+  for (int i = 1; i < kNumHeaders; ++i, ++it) {
+    if (i == 50) {
+      ++i;
+    }
+    EXPECT_EQ("key" + base::IntToString(i), it->first);
+  }
+  EXPECT_EQ(Pair("key0", "re-added"), *it);
+}
+
+// This test verifies that a cleared block can be refilled, and keeps memory to
+// do so.
+TEST(SpdyHeaderBlockTest, ClearAndReuse) {
+  SpdyHeaderBlock block;
+  block["foo"] = "bar";
+  block.AppendValueOrAddHeader("cookie", "key1=value1");
+  block.AppendValueOrAddHeader("cookie", "key2=value2");
+  size_t bytes_allocated = SpdyHeaderBlockPeer::bytes_allocated(block);
+  EXPECT_LT(0u, bytes_allocated);
+
+  block.clear();
+  EXPECT_TRUE(block.empty());
+  EXPECT_EQ(block.end(), block.find("foo"));
+  EXPECT_EQ(bytes_allocated, SpdyHeaderBlockPeer::bytes_allocated(block));
+
+  block.AppendValueOrAddHeader("cookie", "key3=value3");
+  block["baz"] = "qux";
+  EXPECT_THAT(block, ElementsAre(Pair("cookie", "key3=value3"),
+                                 Pair("baz", "qux")));
+  EXPECT_EQ(bytes_allocated, SpdyHeaderBlockPeer::bytes_allocated(block));
+}
+
 TEST(JoinTest, JoinEmpty) {
   std::vector<StringPiece> empty;
   StringPiece separator = ", ";
@@ -2888,7 +2888,7 @@ void SpdySession::OnHeaders(SpdyStreamId stream_id,
                             SpdyStreamId parent_stream_id,
                             bool exclusive,
                             bool fin,
-                            SpdyHeaderBlock headers) {
+                            const SpdyHeaderBlock& headers) {
   CHECK(in_io_loop_);
 
   if (net_log().IsCapturing()) {
@@ -893,7 +893,7 @@ class NET_EXPORT SpdySession : public BufferedSpdyFramerVisitorInterface,
                  SpdyStreamId parent_stream_id,
                  bool exclusive,
                  bool fin,
-                 SpdyHeaderBlock headers) override;
+                 const SpdyHeaderBlock& headers) override;
   void OnAltSvc(SpdyStreamId stream_id,
                 base::StringPiece origin,
                 const SpdyAltSvcWireFormat::AlternativeServiceVector&
@@ -197,7 +197,7 @@ class PriorityGetter : public BufferedSpdyFramerVisitorInterface {
                  SpdyStreamId parent_stream_id,
                  bool exclusive,
                  bool fin,
-                 SpdyHeaderBlock headers) override {
+                 const SpdyHeaderBlock& headers) override {
     if (has_priority) {
       priority_ = Http2WeightToSpdy3Priority(weight);
     }
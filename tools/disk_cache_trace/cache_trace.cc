@@ -0,0 +1,193 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/disk_cache_trace/cache_trace.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/sequenced_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+#include "net/disk_cache/simple/simple_util.h"
+
+namespace disk_cache {
+
+namespace {
+
+const char kLookupOp[] = "lookup";
+const char kWriteOp[] = "write";
+const char kDoomOp[] = "doom";
+
+// Records are written out once this many bytes of them are buffered.
+const size_t kFlushSize = 64 * 1024;
+
+const char* OpToString(CacheTraceRecord::Op op) {
+  switch (op) {
+    case CacheTraceRecord::LOOKUP:
+      return kLookupOp;
+    case CacheTraceRecord::WRITE:
+      return kWriteOp;
+    case CacheTraceRecord::DOOM:
+      return kDoomOp;
+  }
+  NOTREACHED();
+  return "";
+}
+
+bool StringToOp(const base::StringPiece& str, CacheTraceRecord::Op* op) {
+  if (str == kLookupOp) {
+    *op = CacheTraceRecord::LOOKUP;
+  } else if (str == kWriteOp) {
+    *op = CacheTraceRecord::WRITE;
+  } else if (str == kDoomOp) {
+    *op = CacheTraceRecord::DOOM;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseRecord(const base::StringPiece& line, CacheTraceRecord* record) {
+  std::vector<base::StringPiece> tokens = base::SplitStringPiece(
+      line, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (tokens.size() != 6)
+    return false;
+  int64_t time_us;
+  if (!base::StringToInt64(tokens[0], &time_us) || time_us < 0)
+    return false;
+  record->time = base::TimeDelta::FromMicroseconds(time_us);
+  return StringToOp(tokens[1], &record->op) &&
+         simple_util::GetEntryHashKeyFromHexString(tokens[2],
+                                                   &record->key_hash) &&
+         base::StringToInt(tokens[3], &record->key_length) &&
+         record->key_length >= 0 &&
+         base::StringToInt(tokens[4], &record->header_size) &&
+         record->header_size >= 0 &&
+         base::StringToInt64(tokens[5], &record->body_size) &&
+         record->body_size >= 0;
+}
+
+void AppendToTrace(const base::FilePath& path, const std::string& data) {
+  if (!base::AppendToFile(path, data.data(), static_cast<int>(data.size())))
+    LOG(ERROR) << "Could not write to " << path.LossyDisplayName();
+}
+
+void TruncateTrace(const base::FilePath& path) {
+  if (base::WriteFile(path, "", 0) != 0)
+    LOG(ERROR) << "Could not create " << path.LossyDisplayName();
+}
+
+}  // namespace
+
+CacheTraceRecord::CacheTraceRecord()
+    : op(LOOKUP), key_hash(0), key_length(0), header_size(0), body_size(0) {}
+
+CacheTraceRecord::CacheTraceRecord(base::TimeDelta time,
+                                   Op op,
+                                   uint64_t key_hash,
+                                   int key_length,
+                                   int header_size,
+                                   int64_t body_size)
+    : time(time),
+      op(op),
+      key_hash(key_hash),
+      key_length(key_length),
+      header_size(header_size),
+      body_size(body_size) {}
+
+bool CacheTraceRecord::operator==(const CacheTraceRecord& other) const {
+  return time == other.time && op == other.op && key_hash == other.key_hash &&
+         key_length == other.key_length && header_size == other.header_size &&
+         body_size == other.body_size;
+}
+
+std::string SerializeCacheTraceRecord(const CacheTraceRecord& record) {
+  return base::StringPrintf(
+      "%" PRId64 " %s %s %d %d %" PRId64 "\n", record.time.InMicroseconds(),
+      OpToString(record.op),
+      simple_util::ConvertEntryHashKeyToHexString(record.key_hash).c_str(),
+      record.key_length, record.header_size, record.body_size);
+}
+
+bool ParseCacheTrace(const std::string& contents,
+                     std::vector<CacheTraceRecord>* records) {
+  records->clear();
+  for (const base::StringPiece& line : base::SplitStringPiece(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (line.starts_with("#"))
+      continue;
+    CacheTraceRecord record;
+    if (!ParseRecord(line, &record)) {
+      LOG(ERROR) << "Malformed trace line: " << line;
+      return false;
+    }
+    records->push_back(record);
+  }
+  // Lookups are recorded when the entry is closed, so they can come after
+  // accesses which started later.
+  std::stable_sort(records->begin(), records->end(),
+                   [](const CacheTraceRecord& a, const CacheTraceRecord& b) {
+                     return a.time < b.time;
+                   });
+  return true;
+}
+
+std::string MakeCacheTraceKey(uint64_t key_hash, int key_length) {
+  std::string key = simple_util::ConvertEntryHashKeyToHexString(key_hash);
+  if (key_length > static_cast<int>(key.size()))
+    key.append(key_length - key.size(), 'x');
+  return key;
+}
+
+CacheTraceWriter::CacheTraceWriter(
+    const base::FilePath& path,
+    scoped_refptr<base::SequencedTaskRunner> file_task_runner)
+    : path_(path),
+      file_task_runner_(std::move(file_task_runner)),
+      start_time_(base::TimeTicks::Now()) {
+  file_task_runner_->PostTask(FROM_HERE, base::Bind(&TruncateTrace, path_));
+}
+
+CacheTraceWriter::~CacheTraceWriter() {
+  Flush();
+}
+
+void CacheTraceWriter::Record(CacheTraceRecord::Op op,
+                              const std::string& key,
+                              int header_size,
+                              int64_t body_size) {
+  RecordWithStartTime(base::TimeTicks::Now(), op, key, header_size,
+                      body_size);
+}
+
+void CacheTraceWriter::RecordWithStartTime(base::TimeTicks start_time,
+                                           CacheTraceRecord::Op op,
+                                           const std::string& key,
+                                           int header_size,
+                                           int64_t body_size) {
+  buffer_.append(SerializeCacheTraceRecord(CacheTraceRecord(
+      start_time - start_time_, op, simple_util::GetEntryHashKey(key),
+      static_cast<int>(key.size()), header_size, body_size)));
+  if (buffer_.size() >= kFlushSize)
+    Flush();
+}
+
+void CacheTraceWriter::Flush() {
+  if (buffer_.empty())
+    return;
+  file_task_runner_->PostTask(FROM_HERE,
+                              base::Bind(&AppendToTrace, path_, buffer_));
+  buffer_.clear();
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,113 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_DISK_CACHE_TRACE_CACHE_TRACE_H_
+#define NET_TOOLS_DISK_CACHE_TRACE_CACHE_TRACE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace disk_cache {
+
+// A cache trace is a text file with one access to a disk cache per line:
+//
+//   <time> <op> <key hash> <key length> <header size> <body size>
+//
+// where <time> is in microseconds since the trace started, <op> is one of
+// "lookup", "write" or "doom", <key hash> is the 16 hex digit hash of the key
+// as used by the Simple cache, and the sizes are in bytes. Keys are only
+// recorded as hashes so that traces don't carry URLs around. Lines starting
+// with '#' are comments.
+struct CacheTraceRecord {
+  enum Op {
+    // The entry is looked up and, if it is missing, stored with the sizes in
+    // the record. This is what the HttpCache does for most requests.
+    LOOKUP,
+    // The entry is stored without being looked up first, replacing any entry
+    // with the same key.
+    WRITE,
+    // The entry is removed.
+    DOOM,
+  };
+
+  CacheTraceRecord();
+  CacheTraceRecord(base::TimeDelta time,
+                   Op op,
+                   uint64_t key_hash,
+                   int key_length,
+                   int header_size,
+                   int64_t body_size);
+
+  bool operator==(const CacheTraceRecord& other) const;
+
+  base::TimeDelta time;
+  Op op;
+  uint64_t key_hash;
+  int key_length;
+  int header_size;
+  int64_t body_size;
+};
+
+// Returns |record| as a line of a trace, with the trailing newline.
+std::string SerializeCacheTraceRecord(const CacheTraceRecord& record);
+
+// Parses the contents of a trace into |records|, sorted by time. Returns false
+// if any line is malformed.
+bool ParseCacheTrace(const std::string& contents,
+                     std::vector<CacheTraceRecord>* records);
+
+// Returns a key of |key_length| characters (or 16, if that's longer) which is
+// unique to |key_hash|, to stand in for the key recorded in a trace.
+std::string MakeCacheTraceKey(uint64_t key_hash, int key_length);
+
+// Appends records to a trace file. Records are buffered, and written on
+// |file_task_runner| so that the thread doing the recording never blocks on
+// the disk. The file is truncated when the writer is created. Must be used on
+// a single thread.
+class CacheTraceWriter {
+ public:
+  CacheTraceWriter(const base::FilePath& path,
+                   scoped_refptr<base::SequencedTaskRunner> file_task_runner);
+  // Writes any buffered records.
+  ~CacheTraceWriter();
+
+  // Adds a record at the current time.
+  void Record(CacheTraceRecord::Op op,
+              const std::string& key,
+              int header_size,
+              int64_t body_size);
+
+  // Adds a record for an access which started at |start_time|.
+  void RecordWithStartTime(base::TimeTicks start_time,
+                           CacheTraceRecord::Op op,
+                           const std::string& key,
+                           int header_size,
+                           int64_t body_size);
+
+  // Posts a task to write the buffered records.
+  void Flush();
+
+ private:
+  const base::FilePath path_;
+  scoped_refptr<base::SequencedTaskRunner> file_task_runner_;
+  const base::TimeTicks start_time_;
+  std::string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(CacheTraceWriter);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_TOOLS_DISK_CACHE_TRACE_CACHE_TRACE_H_
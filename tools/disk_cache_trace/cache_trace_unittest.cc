@@ -0,0 +1,154 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/disk_cache_trace/cache_trace.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/run_loop.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/simple/simple_util.h"
+#include "net/http/http_cache.h"
+#include "net/tools/disk_cache_trace/trace_recording_backend.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+TEST(CacheTraceTest, SerializeAndParse) {
+  const CacheTraceRecord records[] = {
+      CacheTraceRecord(base::TimeDelta::FromMicroseconds(5),
+                       CacheTraceRecord::LOOKUP, 0x0123456789abcdef, 40, 300,
+                       5000000000),
+      CacheTraceRecord(base::TimeDelta::FromMicroseconds(7),
+                       CacheTraceRecord::WRITE, 1, 2, 0, 0),
+      CacheTraceRecord(base::TimeDelta::FromMicroseconds(6),
+                       CacheTraceRecord::DOOM, 0xffffffffffffffff, 10, 0, 0),
+  };
+  std::string contents = "# A comment\n";
+  for (const CacheTraceRecord& record : records)
+    contents += SerializeCacheTraceRecord(record);
+
+  std::vector<CacheTraceRecord> parsed;
+  ASSERT_TRUE(ParseCacheTrace(contents, &parsed));
+  ASSERT_EQ(3u, parsed.size());
+  // The records come back sorted by time.
+  EXPECT_EQ(records[0], parsed[0]);
+  EXPECT_EQ(records[2], parsed[1]);
+  EXPECT_EQ(records[1], parsed[2]);
+}
+
+TEST(CacheTraceTest, ParseMalformed) {
+  std::vector<CacheTraceRecord> records;
+  EXPECT_FALSE(ParseCacheTrace("1 lookup 0123456789abcdef 1 2\n", &records));
+  EXPECT_FALSE(ParseCacheTrace("1 read 0123456789abcdef 1 2 3\n", &records));
+  EXPECT_FALSE(ParseCacheTrace("1 lookup nothex 1 2 3\n", &records));
+  EXPECT_FALSE(ParseCacheTrace("1 lookup 0123456789abcdef 1 -2 3\n", &records));
+  EXPECT_TRUE(ParseCacheTrace("1 lookup 0123456789abcdef 1 2 3\n", &records));
+}
+
+TEST(CacheTraceTest, MakeKey) {
+  EXPECT_EQ("0000000000000001", MakeCacheTraceKey(1, 0));
+  EXPECT_EQ(40u, MakeCacheTraceKey(1, 40).size());
+  EXPECT_NE(MakeCacheTraceKey(1, 40), MakeCacheTraceKey(2, 40));
+}
+
+int WriteBody(Entry* entry, int index, int size) {
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(size));
+  memset(buffer->data(), 0, size);
+  net::TestCompletionCallback cb;
+  return cb.GetResult(
+      entry->WriteData(index, 0, buffer.get(), size, cb.callback(), false));
+}
+
+TEST(CacheTraceTest, RecordingBackend) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath trace_path = temp_dir.GetPath().AppendASCII("trace");
+
+  TraceRecordingBackendFactory factory(
+      net::HttpCache::DefaultBackend::InMemory(0), trace_path,
+      base::ThreadTaskRunnerHandle::Get());
+  std::unique_ptr<Backend> backend;
+  net::TestCompletionCallback cb;
+  ASSERT_EQ(net::OK, cb.GetResult(factory.CreateBackend(nullptr, &backend,
+                                                        cb.callback())));
+  ASSERT_TRUE(backend);
+
+  // A lookup which misses and stores the entry.
+  Entry* entry = nullptr;
+  EXPECT_NE(net::OK, cb.GetResult(backend->OpenEntry("a", &entry,
+                                                     cb.callback())));
+  ASSERT_EQ(net::OK, cb.GetResult(backend->CreateEntry("a", &entry,
+                                                       cb.callback())));
+  EXPECT_EQ(10, WriteBody(entry, 0, 10));
+  EXPECT_EQ(100, WriteBody(entry, 1, 100));
+  entry->Close();
+
+  // A lookup which hits.
+  ASSERT_EQ(net::OK, cb.GetResult(backend->OpenEntry("a", &entry,
+                                                     cb.callback())));
+  entry->Close();
+
+  EXPECT_EQ(net::OK, cb.GetResult(backend->DoomEntry("a", cb.callback())));
+
+  // A write without a lookup.
+  ASSERT_EQ(net::OK, cb.GetResult(backend->CreateEntry("bb", &entry,
+                                                       cb.callback())));
+  EXPECT_EQ(5, WriteBody(entry, 1, 5));
+  entry->Close();
+
+  // A lookup which misses and stores nothing.
+  EXPECT_NE(net::OK, cb.GetResult(backend->OpenEntry("ccc", &entry,
+                                                     cb.callback())));
+
+  backend.reset();
+  base::RunLoop().RunUntilIdle();
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(trace_path, &contents));
+  std::vector<CacheTraceRecord> records;
+  ASSERT_TRUE(ParseCacheTrace(contents, &records));
+  ASSERT_EQ(5u, records.size());
+
+  const uint64_t hash_a = simple_util::GetEntryHashKey("a");
+  EXPECT_EQ(CacheTraceRecord::LOOKUP, records[0].op);
+  EXPECT_EQ(hash_a, records[0].key_hash);
+  EXPECT_EQ(1, records[0].key_length);
+  EXPECT_EQ(10, records[0].header_size);
+  EXPECT_EQ(100, records[0].body_size);
+
+  EXPECT_EQ(CacheTraceRecord::LOOKUP, records[1].op);
+  EXPECT_EQ(hash_a, records[1].key_hash);
+  EXPECT_EQ(100, records[1].body_size);
+
+  EXPECT_EQ(CacheTraceRecord::DOOM, records[2].op);
+  EXPECT_EQ(hash_a, records[2].key_hash);
+
+  EXPECT_EQ(CacheTraceRecord::WRITE, records[3].op);
+  EXPECT_EQ(simple_util::GetEntryHashKey("bb"), records[3].key_hash);
+  EXPECT_EQ(2, records[3].key_length);
+  EXPECT_EQ(0, records[3].header_size);
+  EXPECT_EQ(5, records[3].body_size);
+
+  EXPECT_EQ(CacheTraceRecord::LOOKUP, records[4].op);
+  EXPECT_EQ(simple_util::GetEntryHashKey("ccc"), records[4].key_hash);
+  EXPECT_EQ(0, records[4].header_size);
+  EXPECT_EQ(0, records[4].body_size);
+}
+
+}  // namespace
+
+}  // namespace disk_cache
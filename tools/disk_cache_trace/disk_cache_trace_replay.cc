@@ -0,0 +1,357 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays a cache trace (see cache_trace.h) against one of the disk cache
+// backends, and reports how well it did: the hit ratio, the latency of each
+// kind of backend operation, the bytes read and written, and the memory used.
+// Records are replayed one at a time, in order.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/feature_list.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process_metrics.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "net/base/cache_type.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/tools/disk_cache_trace/cache_trace.h"
+
+namespace disk_cache {
+namespace {
+
+const char kTraceSwitch[] = "trace";
+const char kBackendSwitch[] = "backend";
+const char kCachePathSwitch[] = "cache_path";
+const char kMaxSizeSwitch[] = "max_size";
+const char kRealTimeSwitch[] = "real_time";
+
+// Entries are read and written in chunks of this size, as the HttpCache does
+// with data from the network.
+const int kChunkSize = 32 * 1024;
+
+void PrintUsage(std::ostream* stream) {
+  *stream << "Usage: disk_cache_trace_replay --trace=<file> "
+          << "[--backend=blockfile|simple|memory] [--cache_path=<dir>] "
+          << "[--max_size=<bytes>] [--real_time] "
+          << "[--enable-features=<features>] "
+          << "[--disable-features=<features>]" << std::endl
+          << "  --backend defaults to simple, and --cache_path to a new "
+          << "temporary directory." << std::endl
+          << "  --real_time waits between records as long as the trace did."
+          << std::endl;
+}
+
+// The outcome of a replay.
+struct ReplayStats {
+  ReplayStats()
+      : lookups(0),
+        hits(0),
+        writes(0),
+        dooms(0),
+        not_admitted(0),
+        failures(0),
+        bytes_read(0),
+        bytes_written(0) {}
+
+  int lookups;
+  int hits;
+  int writes;
+  int dooms;
+  // Entries which the backend chose not to create.
+  int not_admitted;
+  // Operations which failed unexpectedly.
+  int failures;
+  int64_t bytes_read;
+  int64_t bytes_written;
+  // How long each call to the backend took, by operation.
+  std::map<std::string, std::vector<base::TimeDelta>> latencies;
+};
+
+class TraceReplayer {
+ public:
+  TraceReplayer(Backend* backend, ReplayStats* stats)
+      : backend_(backend),
+        stats_(stats),
+        buffer_(new net::IOBuffer(kChunkSize)) {
+    memset(buffer_->data(), 'x', kChunkSize);
+  }
+
+  void Replay(const CacheTraceRecord& record) {
+    const std::string key =
+        MakeCacheTraceKey(record.key_hash, record.key_length);
+    switch (record.op) {
+      case CacheTraceRecord::LOOKUP:
+        Lookup(key, record);
+        break;
+      case CacheTraceRecord::WRITE:
+        ++stats_->writes;
+        Store(key, record);
+        break;
+      case CacheTraceRecord::DOOM: {
+        ++stats_->dooms;
+        net::TestCompletionCallback cb;
+        const base::TimeTicks start = base::TimeTicks::Now();
+        int rv = cb.GetResult(backend_->DoomEntry(key, cb.callback()));
+        AddLatency("doom", start);
+        if (rv != net::OK && rv != net::ERR_FAILED)
+          ++stats_->failures;
+        break;
+      }
+    }
+  }
+
+ private:
+  void Lookup(const std::string& key, const CacheTraceRecord& record) {
+    ++stats_->lookups;
+    Entry* entry = nullptr;
+    net::TestCompletionCallback cb;
+    const base::TimeTicks start = base::TimeTicks::Now();
+    int rv = cb.GetResult(backend_->OpenEntry(key, &entry, cb.callback()));
+    AddLatency("open", start);
+    if (rv != net::OK) {
+      // The HttpCache would fetch the entry and store it.
+      if (record.header_size > 0 || record.body_size > 0)
+        Store(key, record);
+      return;
+    }
+    ++stats_->hits;
+    ReadStream(entry, 0, std::min(record.header_size, entry->GetDataSize(0)));
+    ReadStream(entry, 1, std::min<int64_t>(record.body_size,
+                                           entry->GetDataSize(1)));
+    entry->Close();
+  }
+
+  // Creates the entry for |key|, replacing any existing one, and writes the
+  // sizes in |record| to it.
+  void Store(const std::string& key, const CacheTraceRecord& record) {
+    Entry* entry = nullptr;
+    int rv = Create(key, &entry);
+    if (rv != net::OK && rv != net::ERR_CACHE_ENTRY_NOT_ADMITTED) {
+      net::TestCompletionCallback cb;
+      cb.GetResult(backend_->DoomEntry(key, cb.callback()));
+      rv = Create(key, &entry);
+    }
+    if (rv == net::ERR_CACHE_ENTRY_NOT_ADMITTED) {
+      ++stats_->not_admitted;
+      return;
+    }
+    if (rv != net::OK) {
+      ++stats_->failures;
+      return;
+    }
+    WriteStream(entry, 0, record.header_size);
+    WriteStream(entry, 1, record.body_size);
+    entry->Close();
+  }
+
+  int Create(const std::string& key, Entry** entry) {
+    net::TestCompletionCallback cb;
+    const base::TimeTicks start = base::TimeTicks::Now();
+    int rv = cb.GetResult(backend_->CreateEntry(key, entry, cb.callback()));
+    AddLatency("create", start);
+    return rv;
+  }
+
+  void ReadStream(Entry* entry, int index, int64_t size) {
+    for (int64_t offset = 0; offset < size; offset += kChunkSize) {
+      const int len = static_cast<int>(std::min<int64_t>(kChunkSize,
+                                                         size - offset));
+      net::TestCompletionCallback cb;
+      const base::TimeTicks start = base::TimeTicks::Now();
+      int rv = cb.GetResult(entry->ReadData(
+          index, static_cast<int>(offset), buffer_.get(), len, cb.callback()));
+      AddLatency("read", start);
+      if (rv != len) {
+        ++stats_->failures;
+        return;
+      }
+      stats_->bytes_read += rv;
+    }
+  }
+
+  void WriteStream(Entry* entry, int index, int64_t size) {
+    for (int64_t offset = 0; offset < size; offset += kChunkSize) {
+      const int len = static_cast<int>(std::min<int64_t>(kChunkSize,
+                                                         size - offset));
+      net::TestCompletionCallback cb;
+      const base::TimeTicks start = base::TimeTicks::Now();
+      int rv = cb.GetResult(entry->WriteData(index, static_cast<int>(offset),
+                                             buffer_.get(), len,
+                                             cb.callback(), false));
+      AddLatency("write", start);
+      if (rv != len) {
+        ++stats_->failures;
+        return;
+      }
+      stats_->bytes_written += rv;
+    }
+  }
+
+  void AddLatency(const char* op, base::TimeTicks start) {
+    stats_->latencies[op].push_back(base::TimeTicks::Now() - start);
+  }
+
+  Backend* const backend_;
+  ReplayStats* const stats_;
+  scoped_refptr<net::IOBuffer> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceReplayer);
+};
+
+// Returns the latency below which |percentile| percent of |latencies| fall.
+base::TimeDelta GetPercentile(std::vector<base::TimeDelta>* latencies,
+                              int percentile) {
+  DCHECK(!latencies->empty());
+  auto nth = latencies->begin() + (latencies->size() - 1) * percentile / 100;
+  std::nth_element(latencies->begin(), nth, latencies->end());
+  return *nth;
+}
+
+void PrintStats(ReplayStats* stats, base::TimeDelta elapsed) {
+  std::cout << "Replayed in " << elapsed.InMillisecondsF() << " ms"
+            << std::endl;
+  std::cout << "Lookups: " << stats->lookups << ", hits: " << stats->hits;
+  if (stats->lookups > 0)
+    std::cout << " (" << 100.0 * stats->hits / stats->lookups << "%)";
+  std::cout << std::endl;
+  std::cout << "Writes: " << stats->writes << ", dooms: " << stats->dooms
+            << ", not admitted: " << stats->not_admitted
+            << ", failures: " << stats->failures << std::endl;
+  std::cout << "Bytes read: " << stats->bytes_read
+            << ", bytes written: " << stats->bytes_written << std::endl;
+  for (auto& it : stats->latencies) {
+    std::cout << it.first << " latency (us): p50 "
+              << GetPercentile(&it.second, 50).InMicroseconds() << ", p99 "
+              << GetPercentile(&it.second, 99).InMicroseconds() << " over "
+              << it.second.size() << " calls" << std::endl;
+  }
+  std::unique_ptr<base::ProcessMetrics> metrics =
+      base::ProcessMetrics::CreateCurrentProcessMetrics();
+  std::cout << "Working set: " << metrics->GetWorkingSetSize() / 1024 << " kB"
+            << std::endl;
+}
+
+bool Main(int argc, char** argv) {
+  base::AtExitManager at_exit_manager;
+  base::MessageLoopForIO message_loop;
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine& command_line =
+      *base::CommandLine::ForCurrentProcess();
+  if (command_line.HasSwitch("help")) {
+    PrintUsage(&std::cout);
+    return true;
+  }
+  base::FeatureList::InitializeInstance(
+      command_line.GetSwitchValueASCII("enable-features"),
+      command_line.GetSwitchValueASCII("disable-features"));
+
+  const base::FilePath trace_path =
+      command_line.GetSwitchValuePath(kTraceSwitch);
+  std::string contents;
+  std::vector<CacheTraceRecord> records;
+  if (trace_path.empty() || !base::ReadFileToString(trace_path, &contents) ||
+      !ParseCacheTrace(contents, &records)) {
+    std::cerr << "Could not read a trace from "
+              << trace_path.LossyDisplayName() << std::endl;
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  net::CacheType cache_type = net::DISK_CACHE;
+  net::BackendType backend_type = net::CACHE_BACKEND_SIMPLE;
+  const std::string backend = command_line.GetSwitchValueASCII(kBackendSwitch);
+  if (backend == "blockfile") {
+    backend_type = net::CACHE_BACKEND_BLOCKFILE;
+  } else if (backend == "memory") {
+    cache_type = net::MEMORY_CACHE;
+    backend_type = net::CACHE_BACKEND_DEFAULT;
+  } else if (!backend.empty() && backend != "simple") {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  int max_size = 0;
+  if (command_line.HasSwitch(kMaxSizeSwitch) &&
+      !base::StringToInt(command_line.GetSwitchValueASCII(kMaxSizeSwitch),
+                         &max_size)) {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  base::ScopedTempDir temp_dir;
+  base::FilePath cache_path = command_line.GetSwitchValuePath(kCachePathSwitch);
+  if (cache_path.empty() && cache_type != net::MEMORY_CACHE) {
+    if (!temp_dir.CreateUniqueTempDir()) {
+      std::cerr << "Could not create a temporary directory." << std::endl;
+      return false;
+    }
+    cache_path = temp_dir.GetPath();
+  }
+
+  base::Thread cache_thread("CacheThread");
+  if (!cache_thread.StartWithOptions(
+          base::Thread::Options(base::MessageLoop::TYPE_IO, 0))) {
+    std::cerr << "Could not start the cache thread." << std::endl;
+    return false;
+  }
+
+  std::unique_ptr<Backend> cache_backend;
+  net::TestCompletionCallback cb;
+  int rv = CreateCacheBackend(cache_type, backend_type, cache_path, max_size,
+                              false, cache_thread.task_runner(), nullptr,
+                              &cache_backend, cb.callback());
+  if (cb.GetResult(rv) != net::OK) {
+    std::cerr << "Could not create the cache." << std::endl;
+    return false;
+  }
+
+  ReplayStats stats;
+  TraceReplayer replayer(cache_backend.get(), &stats);
+  const bool real_time = command_line.HasSwitch(kRealTimeSwitch);
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (const CacheTraceRecord& record : records) {
+    if (real_time) {
+      const base::TimeDelta delay =
+          record.time - (base::TimeTicks::Now() - start);
+      if (delay > base::TimeDelta())
+        base::PlatformThread::Sleep(delay);
+    }
+    replayer.Replay(record);
+  }
+  PrintStats(&stats, base::TimeTicks::Now() - start);
+
+  base::RunLoop().RunUntilIdle();
+  cache_backend = nullptr;
+  base::RunLoop().RunUntilIdle();
+  return true;
+}
+
+}  // namespace
+}  // namespace disk_cache
+
+int main(int argc, char** argv) {
+  return !disk_cache::Main(argc, argv);
+}
@@ -0,0 +1,343 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/disk_cache_trace/trace_recording_backend.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/sequenced_task_runner.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/tools/disk_cache_trace/cache_trace.h"
+
+namespace disk_cache {
+
+namespace {
+
+// Lookups which missed and were not followed by a create are only recorded once
+// this many of them pile up, or the backend goes away.
+const size_t kMaxMissedLookups = 1000;
+
+// The backend being created by a TraceRecordingBackendFactory, and the writer
+// for its trace.
+struct PendingBackend {
+  std::unique_ptr<Backend> backend;
+  std::unique_ptr<CacheTraceWriter> writer;
+};
+
+void WrapBackend(PendingBackend* pending,
+                 std::unique_ptr<Backend>* backend,
+                 int rv) {
+  if (rv != net::OK)
+    return;
+  backend->reset(new TraceRecordingBackend(std::move(pending->backend),
+                                           std::move(pending->writer)));
+}
+
+void OnBackendCreated(PendingBackend* pending,
+                      std::unique_ptr<Backend>* backend,
+                      const net::CompletionCallback& callback,
+                      int rv) {
+  WrapBackend(pending, backend, rv);
+  callback.Run(rv);
+}
+
+}  // namespace
+
+// Records the entry when it is closed, or doomed.
+class TraceRecordingBackend::RecordingEntry : public Entry {
+ public:
+  RecordingEntry(Entry* entry,
+                 base::WeakPtr<TraceRecordingBackend> backend,
+                 base::TimeTicks start_time,
+                 bool lookup)
+      : entry_(entry),
+        backend_(backend),
+        start_time_(start_time),
+        lookup_(lookup),
+        sparse_size_(0) {}
+
+  // Entry implementation.
+  void Doom() override {
+    if (backend_) {
+      backend_->writer_->Record(CacheTraceRecord::DOOM, entry_->GetKey(), 0,
+                                0);
+    }
+    entry_->Doom();
+  }
+
+  void Close() override {
+    if (backend_) {
+      backend_->RecordEntryClosed(
+          start_time_, lookup_, entry_->GetKey(), entry_->GetDataSize(0),
+          std::max<int64_t>(entry_->GetDataSize(1), sparse_size_));
+    }
+    entry_->Close();
+    delete this;
+  }
+
+  std::string GetKey() const override { return entry_->GetKey(); }
+
+  base::Time GetLastUsed() const override { return entry_->GetLastUsed(); }
+
+  base::Time GetLastModified() const override {
+    return entry_->GetLastModified();
+  }
+
+  int32_t GetDataSize(int index) const override {
+    return entry_->GetDataSize(index);
+  }
+
+  int ReadData(int index,
+               int offset,
+               net::IOBuffer* buf,
+               int buf_len,
+               const CompletionCallback& callback) override {
+    return entry_->ReadData(index, offset, buf, buf_len, callback);
+  }
+
+  int WriteData(int index,
+                int offset,
+                net::IOBuffer* buf,
+                int buf_len,
+                const CompletionCallback& callback,
+                bool truncate) override {
+    return entry_->WriteData(index, offset, buf, buf_len, callback, truncate);
+  }
+
+  int ReadSparseData(int64_t offset,
+                     net::IOBuffer* buf,
+                     int buf_len,
+                     const CompletionCallback& callback) override {
+    sparse_size_ = std::max(sparse_size_, offset + buf_len);
+    return entry_->ReadSparseData(offset, buf, buf_len, callback);
+  }
+
+  int WriteSparseData(int64_t offset,
+                      net::IOBuffer* buf,
+                      int buf_len,
+                      const CompletionCallback& callback) override {
+    sparse_size_ = std::max(sparse_size_, offset + buf_len);
+    return entry_->WriteSparseData(offset, buf, buf_len, callback);
+  }
+
+  int GetAvailableRange(int64_t offset,
+                        int len,
+                        int64_t* start,
+                        const CompletionCallback& callback) override {
+    return entry_->GetAvailableRange(offset, len, start, callback);
+  }
+
+  bool CouldBeSparse() const override { return entry_->CouldBeSparse(); }
+
+  void CancelSparseIO() override { entry_->CancelSparseIO(); }
+
+  int ReadyForSparseIO(const CompletionCallback& callback) override {
+    return entry_->ReadyForSparseIO(callback);
+  }
+
+ private:
+  ~RecordingEntry() override {}
+
+  Entry* const entry_;
+  base::WeakPtr<TraceRecordingBackend> backend_;
+  const base::TimeTicks start_time_;
+  const bool lookup_;
+  // How far into the entry sparse IO has gone. A trace doesn't tell sparse
+  // entries apart, so this counts as the size of the body.
+  int64_t sparse_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingEntry);
+};
+
+TraceRecordingBackend::TraceRecordingBackend(
+    std::unique_ptr<Backend> backend,
+    std::unique_ptr<CacheTraceWriter> writer)
+    : backend_(std::move(backend)),
+      writer_(std::move(writer)),
+      weak_factory_(this) {}
+
+TraceRecordingBackend::~TraceRecordingBackend() {
+  RecordMissedLookups();
+}
+
+net::CacheType TraceRecordingBackend::GetCacheType() const {
+  return backend_->GetCacheType();
+}
+
+int32_t TraceRecordingBackend::GetEntryCount() const {
+  return backend_->GetEntryCount();
+}
+
+int TraceRecordingBackend::OpenEntry(const std::string& key,
+                                     Entry** entry,
+                                     const CompletionCallback& callback) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  int rv = backend_->OpenEntry(
+      key, entry,
+      base::Bind(&TraceRecordingBackend::OnEntryOpened,
+                 weak_factory_.GetWeakPtr(), key, start_time, true, true,
+                 entry, callback));
+  if (rv != net::ERR_IO_PENDING)
+    EntryOpenComplete(key, start_time, true, true, entry, rv);
+  return rv;
+}
+
+int TraceRecordingBackend::CreateEntry(const std::string& key,
+                                       Entry** entry,
+                                       const CompletionCallback& callback) {
+  // The HttpCache creates an entry right after failing to open it, and the
+  // two together make up a lookup which missed.
+  base::TimeTicks start_time = base::TimeTicks::Now();
+  bool lookup = false;
+  auto it = missed_lookups_.find(key);
+  if (it != missed_lookups_.end()) {
+    start_time = it->second;
+    lookup = true;
+    missed_lookups_.erase(it);
+  }
+  int rv = backend_->CreateEntry(
+      key, entry,
+      base::Bind(&TraceRecordingBackend::OnEntryOpened,
+                 weak_factory_.GetWeakPtr(), key, start_time, false, lookup,
+                 entry, callback));
+  if (rv != net::ERR_IO_PENDING)
+    EntryOpenComplete(key, start_time, false, lookup, entry, rv);
+  return rv;
+}
+
+int TraceRecordingBackend::DoomEntry(const std::string& key,
+                                     const CompletionCallback& callback) {
+  writer_->Record(CacheTraceRecord::DOOM, key, 0, 0);
+  return backend_->DoomEntry(key, callback);
+}
+
+int TraceRecordingBackend::DoomAllEntries(const CompletionCallback& callback) {
+  return backend_->DoomAllEntries(callback);
+}
+
+int TraceRecordingBackend::DoomEntriesBetween(
+    base::Time initial_time,
+    base::Time end_time,
+    const CompletionCallback& callback) {
+  return backend_->DoomEntriesBetween(initial_time, end_time, callback);
+}
+
+int TraceRecordingBackend::DoomEntriesSince(
+    base::Time initial_time,
+    const CompletionCallback& callback) {
+  return backend_->DoomEntriesSince(initial_time, callback);
+}
+
+int TraceRecordingBackend::CalculateSizeOfAllEntries(
+    const CompletionCallback& callback) {
+  return backend_->CalculateSizeOfAllEntries(callback);
+}
+
+int TraceRecordingBackend::CalculateSizeOfEntriesBetween(
+    base::Time initial_time,
+    base::Time end_time,
+    const CompletionCallback& callback) {
+  return backend_->CalculateSizeOfEntriesBetween(initial_time, end_time,
+                                                 callback);
+}
+
+std::unique_ptr<Backend::Iterator> TraceRecordingBackend::CreateIterator() {
+  return backend_->CreateIterator();
+}
+
+void TraceRecordingBackend::GetStats(base::StringPairs* stats) {
+  backend_->GetStats(stats);
+}
+
+void TraceRecordingBackend::OnExternalCacheHit(const std::string& key) {
+  backend_->OnExternalCacheHit(key);
+}
+
+size_t TraceRecordingBackend::EstimateMemoryUsage() const {
+  return backend_->EstimateMemoryUsage();
+}
+
+void TraceRecordingBackend::OnEntryOpened(const std::string& key,
+                                          base::TimeTicks start_time,
+                                          bool opening,
+                                          bool lookup,
+                                          Entry** entry,
+                                          const CompletionCallback& callback,
+                                          int rv) {
+  EntryOpenComplete(key, start_time, opening, lookup, entry, rv);
+  callback.Run(rv);
+}
+
+void TraceRecordingBackend::EntryOpenComplete(const std::string& key,
+                                              base::TimeTicks start_time,
+                                              bool opening,
+                                              bool lookup,
+                                              Entry** entry,
+                                              int rv) {
+  if (rv == net::OK) {
+    *entry = new RecordingEntry(*entry, weak_factory_.GetWeakPtr(),
+                                start_time, lookup);
+    return;
+  }
+  if (opening) {
+    if (missed_lookups_.size() >= kMaxMissedLookups)
+      RecordMissedLookups();
+    missed_lookups_[key] = start_time;
+    return;
+  }
+  // Nothing was stored for the lookup.
+  if (lookup)
+    writer_->RecordWithStartTime(start_time, CacheTraceRecord::LOOKUP, key, 0,
+                                 0);
+}
+
+void TraceRecordingBackend::RecordEntryClosed(base::TimeTicks start_time,
+                                              bool lookup,
+                                              const std::string& key,
+                                              int header_size,
+                                              int64_t body_size) {
+  writer_->RecordWithStartTime(
+      start_time, lookup ? CacheTraceRecord::LOOKUP : CacheTraceRecord::WRITE,
+      key, header_size, body_size);
+}
+
+void TraceRecordingBackend::RecordMissedLookups() {
+  for (const auto& it : missed_lookups_) {
+    writer_->RecordWithStartTime(it.second, CacheTraceRecord::LOOKUP, it.first,
+                                 0, 0);
+  }
+  missed_lookups_.clear();
+}
+
+TraceRecordingBackendFactory::TraceRecordingBackendFactory(
+    std::unique_ptr<net::HttpCache::BackendFactory> factory,
+    const base::FilePath& path,
+    scoped_refptr<base::SequencedTaskRunner> file_task_runner)
+    : factory_(std::move(factory)),
+      path_(path),
+      file_task_runner_(std::move(file_task_runner)) {}
+
+TraceRecordingBackendFactory::~TraceRecordingBackendFactory() {}
+
+int TraceRecordingBackendFactory::CreateBackend(
+    net::NetLog* net_log,
+    std::unique_ptr<Backend>* backend,
+    const net::CompletionCallback& callback) {
+  // |pending| is owned by the callback, so that it outlives this factory if
+  // the HttpCache goes away while the backend is being created.
+  PendingBackend* pending = new PendingBackend;
+  pending->writer.reset(new CacheTraceWriter(path_, file_task_runner_));
+  net::CompletionCallback on_created = base::Bind(
+      &OnBackendCreated, base::Owned(pending), backend, callback);
+  int rv = factory_->CreateBackend(net_log, &pending->backend, on_created);
+  if (rv != net::ERR_IO_PENDING)
+    WrapBackend(pending, backend, rv);
+  return rv;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,140 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_DISK_CACHE_TRACE_TRACE_RECORDING_BACKEND_H_
+#define NET_TOOLS_DISK_CACHE_TRACE_TRACE_RECORDING_BACKEND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/http/http_cache.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace disk_cache {
+
+class CacheTraceWriter;
+
+// Forwards everything to another backend, and writes the accesses made through
+// it to a cache trace (see cache_trace.h). An entry which is opened, or created
+// right after failing to be opened, is recorded as a lookup, and one which is
+// only created as a write, with the sizes it has when it is closed. A lookup
+// which stores nothing is recorded with zero sizes. Iterators and mass dooms
+// are not recorded.
+class TraceRecordingBackend : public Backend {
+ public:
+  TraceRecordingBackend(std::unique_ptr<Backend> backend,
+                        std::unique_ptr<CacheTraceWriter> writer);
+  ~TraceRecordingBackend() override;
+
+  // Backend implementation.
+  net::CacheType GetCacheType() const override;
+  int32_t GetEntryCount() const override;
+  int OpenEntry(const std::string& key,
+                Entry** entry,
+                const CompletionCallback& callback) override;
+  int CreateEntry(const std::string& key,
+                  Entry** entry,
+                  const CompletionCallback& callback) override;
+  int DoomEntry(const std::string& key,
+                const CompletionCallback& callback) override;
+  int DoomAllEntries(const CompletionCallback& callback) override;
+  int DoomEntriesBetween(base::Time initial_time,
+                         base::Time end_time,
+                         const CompletionCallback& callback) override;
+  int DoomEntriesSince(base::Time initial_time,
+                       const CompletionCallback& callback) override;
+  int CalculateSizeOfAllEntries(const CompletionCallback& callback) override;
+  int CalculateSizeOfEntriesBetween(
+      base::Time initial_time,
+      base::Time end_time,
+      const CompletionCallback& callback) override;
+  std::unique_ptr<Iterator> CreateIterator() override;
+  void GetStats(base::StringPairs* stats) override;
+  void OnExternalCacheHit(const std::string& key) override;
+  size_t EstimateMemoryUsage() const override;
+
+ private:
+  class RecordingEntry;
+
+  // Called when an open (if |opening|) or a create of the entry for |key|
+  // completes with |rv|. If it succeeded, wraps the entry |backend_| returned
+  // in |*entry| so that it is recorded when it is closed, as a lookup if
+  // |lookup| is true.
+  void OnEntryOpened(const std::string& key,
+                     base::TimeTicks start_time,
+                     bool opening,
+                     bool lookup,
+                     Entry** entry,
+                     const CompletionCallback& callback,
+                     int rv);
+  void EntryOpenComplete(const std::string& key,
+                         base::TimeTicks start_time,
+                         bool opening,
+                         bool lookup,
+                         Entry** entry,
+                         int rv);
+
+  void RecordEntryClosed(base::TimeTicks start_time,
+                         bool lookup,
+                         const std::string& key,
+                         int header_size,
+                         int64_t body_size);
+
+  // Records the lookups in |missed_lookups_| as storing nothing.
+  void RecordMissedLookups();
+
+  std::unique_ptr<Backend> backend_;
+  std::unique_ptr<CacheTraceWriter> writer_;
+
+  // The keys which failed to be opened, and when, until they are created.
+  std::map<std::string, base::TimeTicks> missed_lookups_;
+
+  base::WeakPtrFactory<TraceRecordingBackend> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceRecordingBackend);
+};
+
+// Makes an HttpCache record a trace of the accesses to its backend in |path|,
+// with the file writes done on |file_task_runner|:
+//
+//   std::unique_ptr<HttpCache::BackendFactory> factory(
+//       new disk_cache::TraceRecordingBackendFactory(
+//           std::move(default_factory), trace_path, file_task_runner));
+class TraceRecordingBackendFactory : public net::HttpCache::BackendFactory {
+ public:
+  TraceRecordingBackendFactory(
+      std::unique_ptr<net::HttpCache::BackendFactory> factory,
+      const base::FilePath& path,
+      scoped_refptr<base::SequencedTaskRunner> file_task_runner);
+  ~TraceRecordingBackendFactory() override;
+
+  // HttpCache::BackendFactory implementation.
+  int CreateBackend(net::NetLog* net_log,
+                    std::unique_ptr<Backend>* backend,
+                    const net::CompletionCallback& callback) override;
+
+ private:
+  std::unique_ptr<net::HttpCache::BackendFactory> factory_;
+  const base::FilePath path_;
+  scoped_refptr<base::SequencedTaskRunner> file_task_runner_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceRecordingBackendFactory);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_TOOLS_DISK_CACHE_TRACE_TRACE_RECORDING_BACKEND_H_
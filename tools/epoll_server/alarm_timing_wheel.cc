@@ -0,0 +1,273 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/epoll_server/alarm_timing_wheel.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "base/logging.h"
+
+namespace net {
+
+namespace {
+
+// Number of entries allocated at once when the free list runs out.
+const size_t kEntriesPerBlock = 1024;
+
+const int64_t kNoTime = std::numeric_limits<int64_t>::max();
+
+}  // namespace
+
+struct AlarmTimingWheel::Entry {
+  int64_t time;
+  AlarmCB* cb;
+  // The list the entry is on, or nullptr if it is free.
+  Slot* slot;
+  Entry* prev;
+  Entry* next;
+};
+
+AlarmTimingWheel::Slot::Slot()
+    : head(nullptr), tail(nullptr), min_time(kNoTime) {}
+
+AlarmTimingWheel::AlarmTimingWheel()
+    : current_time_(0), size_(0), free_list_(nullptr) {
+  for (int level = 0; level < kNumLevels; ++level) {
+    occupied_[level] = 0;
+  }
+}
+
+AlarmTimingWheel::~AlarmTimingWheel() {}
+
+AlarmTimingWheel::Entry* AlarmTimingWheel::Insert(int64_t time_in_us,
+                                                  AlarmCB* cb) {
+  Entry* entry = NewEntry();
+  entry->time = time_in_us;
+  entry->cb = cb;
+  File(entry);
+  ++size_;
+  return entry;
+}
+
+AlarmTimingWheel::AlarmCB* AlarmTimingWheel::Remove(Entry* entry) {
+  DCHECK(entry->slot);
+  AlarmCB* cb = entry->cb;
+  Unlink(entry);
+  FreeEntry(entry);
+  --size_;
+  return cb;
+}
+
+void AlarmTimingWheel::Reschedule(Entry* entry, int64_t time_in_us) {
+  DCHECK(entry->slot);
+  Unlink(entry);
+  entry->time = time_in_us;
+  File(entry);
+}
+
+int64_t AlarmTimingWheel::NextAlarmTime() const {
+  DCHECK(!empty());
+  int64_t next = std::min(overdue_.min_time, expired_.min_time);
+  int level = LowestOccupiedLevel();
+  if (level < kNumLevels) {
+    int index = __builtin_ctzll(occupied_[level]);
+    int64_t start = SlotStart(level, index);
+    // Level 0 slots hold a single time.
+    if (level > 0) {
+      start = std::max(start, slots_[level][index].min_time);
+    }
+    next = std::min(next, start);
+  }
+  return next;
+}
+
+void AlarmTimingWheel::CollectExpired(int64_t now_in_us) {
+  // Overdue entries are earlier than anything in the wheel.
+  if (overdue_.head != nullptr) {
+    std::vector<Entry*> due;
+    for (Entry* entry = overdue_.head; entry != nullptr; entry = entry->next) {
+      if (entry->time <= now_in_us) {
+        due.push_back(entry);
+      }
+    }
+    std::stable_sort(due.begin(), due.end(), [](Entry* a, Entry* b) {
+      return a->time < b->time;
+    });
+    for (Entry* entry : due) {
+      Unlink(entry);
+      Append(&expired_, entry);
+    }
+  }
+
+  for (;;) {
+    int level = LowestOccupiedLevel();
+    if (level == kNumLevels) {
+      return;
+    }
+    int index = __builtin_ctzll(occupied_[level]);
+    int64_t start = SlotStart(level, index);
+    if (start > now_in_us) {
+      return;
+    }
+
+    Slot* slot = &slots_[level][index];
+    Entry* entry = slot->head;
+    *slot = Slot();
+    occupied_[level] &= ~(uint64_t{1} << index);
+
+    if (level == 0) {
+      // Every entry in the slot is due at |start|.
+      while (entry != nullptr) {
+        Entry* next = entry->next;
+        Append(&expired_, entry);
+        entry = next;
+      }
+      continue;
+    }
+
+    // Nothing is filed before this slot, so the wheel can move to its start
+    // and spread its entries over the lower levels.
+    current_time_ = start;
+    while (entry != nullptr) {
+      Entry* next = entry->next;
+      File(entry);
+      entry = next;
+    }
+  }
+}
+
+AlarmTimingWheel::AlarmCB* AlarmTimingWheel::PopExpired() {
+  if (expired_.head == nullptr) {
+    return nullptr;
+  }
+  return Remove(expired_.head);
+}
+
+std::vector<std::pair<int64_t, AlarmTimingWheel::AlarmCB*>>
+AlarmTimingWheel::GetAlarms() const {
+  std::vector<std::pair<int64_t, AlarmCB*>> alarms;
+  alarms.reserve(size_);
+  auto add_slot = [&alarms](const Slot& slot) {
+    for (Entry* entry = slot.head; entry != nullptr; entry = entry->next) {
+      alarms.push_back(std::make_pair(entry->time, entry->cb));
+    }
+  };
+  add_slot(expired_);
+  add_slot(overdue_);
+  for (int level = 0; level < kNumLevels; ++level) {
+    for (int index = 0; index < kSlotsPerLevel; ++index) {
+      add_slot(slots_[level][index]);
+    }
+  }
+  return alarms;
+}
+
+void AlarmTimingWheel::File(Entry* entry) {
+  if (entry->time < current_time_) {
+    Append(&overdue_, entry);
+    return;
+  }
+  uint64_t diff = static_cast<uint64_t>(entry->time) ^
+                  static_cast<uint64_t>(current_time_);
+  int level = 0;
+  if (diff >= static_cast<uint64_t>(kSlotsPerLevel)) {
+    level = (63 - __builtin_clzll(diff)) / kSlotBits;
+  }
+  int index = (static_cast<uint64_t>(entry->time) >> (level * kSlotBits)) &
+              (kSlotsPerLevel - 1);
+  Append(&slots_[level][index], entry);
+  occupied_[level] |= uint64_t{1} << index;
+}
+
+void AlarmTimingWheel::Append(Slot* slot, Entry* entry) {
+  entry->slot = slot;
+  entry->prev = slot->tail;
+  entry->next = nullptr;
+  if (slot->tail != nullptr) {
+    slot->tail->next = entry;
+  } else {
+    slot->head = entry;
+  }
+  slot->tail = entry;
+  slot->min_time = std::min(slot->min_time, entry->time);
+}
+
+void AlarmTimingWheel::Unlink(Entry* entry) {
+  Slot* slot = entry->slot;
+  if (entry->prev != nullptr) {
+    entry->prev->next = entry->next;
+  } else {
+    slot->head = entry->next;
+  }
+  if (entry->next != nullptr) {
+    entry->next->prev = entry->prev;
+  } else {
+    slot->tail = entry->prev;
+  }
+  entry->slot = nullptr;
+
+  if (slot->head == nullptr) {
+    slot->min_time = kNoTime;
+    int level;
+    int index;
+    if (GetWheelSlot(slot, &level, &index)) {
+      occupied_[level] &= ~(uint64_t{1} << index);
+    }
+  }
+}
+
+int64_t AlarmTimingWheel::SlotStart(int level, int slot) const {
+  const int shift = (level + 1) * kSlotBits;
+  uint64_t high = 0;
+  if (shift < 64) {
+    high = static_cast<uint64_t>(current_time_) & ~((uint64_t{1} << shift) - 1);
+  }
+  return static_cast<int64_t>(
+      high | (static_cast<uint64_t>(slot) << (level * kSlotBits)));
+}
+
+int AlarmTimingWheel::LowestOccupiedLevel() const {
+  int level = 0;
+  while (level < kNumLevels && occupied_[level] == 0) {
+    ++level;
+  }
+  return level;
+}
+
+bool AlarmTimingWheel::GetWheelSlot(const Slot* slot,
+                                    int* level,
+                                    int* index) const {
+  const Slot* first = &slots_[0][0];
+  if (slot < first || slot >= first + kNumLevels * kSlotsPerLevel) {
+    return false;
+  }
+  const ptrdiff_t offset = slot - first;
+  *level = offset / kSlotsPerLevel;
+  *index = offset % kSlotsPerLevel;
+  return true;
+}
+
+AlarmTimingWheel::Entry* AlarmTimingWheel::NewEntry() {
+  if (free_list_ == nullptr) {
+    std::unique_ptr<Entry[]> block(new Entry[kEntriesPerBlock]);
+    for (size_t i = 0; i < kEntriesPerBlock; ++i) {
+      block[i].slot = nullptr;
+      block[i].next = free_list_;
+      free_list_ = &block[i];
+    }
+    blocks_.push_back(std::move(block));
+  }
+  Entry* entry = free_list_;
+  free_list_ = entry->next;
+  return entry;
+}
+
+void AlarmTimingWheel::FreeEntry(Entry* entry) {
+  entry->cb = nullptr;
+  entry->next = free_list_;
+  free_list_ = entry;
+}
+
+}  // namespace net
@@ -0,0 +1,141 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_EPOLL_SERVER_ALARM_TIMING_WHEEL_H_
+#define NET_TOOLS_EPOLL_SERVER_ALARM_TIMING_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace net {
+
+class EpollAlarmCallbackInterface;
+
+// The alarm store behind EpollServer.  Insert, Remove and Reschedule are O(1)
+// regardless of how many alarms are registered, which matters on servers
+// where every connection keeps several alarms that are rescheduled on almost
+// every packet.
+//
+// This is a hierarchical timing wheel with microsecond resolution: level 0
+// has one slot per microsecond of the current 64us block, level 1 one slot
+// per 64us block of the current 4096us block, and so on, with 64 slots per
+// level.  An alarm is filed at the level of the highest bit in which its
+// time differs from the wheel's current time, and is moved down a level
+// ("cascaded") when the wheel's current time reaches its slot.  Each alarm
+// is cascaded at most once per level, and level 0 slots hold a single exact
+// time, so alarms never fire early and alarms for the same time fire in the
+// order they were inserted.
+class AlarmTimingWheel {
+ public:
+  typedef EpollAlarmCallbackInterface AlarmCB;
+
+  // An alarm in the wheel.  Stays valid, and at the same address, until the
+  // alarm is removed or popped.
+  struct Entry;
+
+  AlarmTimingWheel();
+  ~AlarmTimingWheel();
+
+  // Files |cb| to go off at |time_in_us|.  Times which are already in the
+  // past go off on the next CollectExpired.
+  Entry* Insert(int64_t time_in_us, AlarmCB* cb);
+
+  // Removes |entry| and returns its callback.  |entry| is invalid afterwards.
+  AlarmCB* Remove(Entry* entry);
+
+  // Moves |entry| to |time_in_us|.  |entry| stays valid.  If |entry| was
+  // collected by CollectExpired but not popped yet it is uncollected.
+  void Reschedule(Entry* entry, int64_t time_in_us);
+
+  // Returns a lower bound on the time of the earliest alarm, which is exact
+  // unless that alarm's slot lost its earliest alarm to Remove or Reschedule.
+  // In that case a caller sleeping until the returned time wakes up early,
+  // collects nothing and asks again.  Must not be called when empty().
+  int64_t NextAlarmTime() const;
+
+  // Collects every alarm due at or before |now_in_us|, in time order, for
+  // PopExpired.  Alarms inserted after this call are not collected, even if
+  // they are already due, until the next call.
+  void CollectExpired(int64_t now_in_us);
+
+  // Removes the next alarm collected by CollectExpired and returns its
+  // callback, or returns nullptr if there is none left.
+  AlarmCB* PopExpired();
+
+  // Returns every alarm as a (time, callback) pair, in no particular order.
+  std::vector<std::pair<int64_t, AlarmCB*>> GetAlarms() const;
+
+  bool empty() const { return size_ == 0; }
+
+  size_t size() const { return size_; }
+
+ private:
+  // An intrusive FIFO list of entries.
+  struct Slot {
+    Slot();
+
+    Entry* head;
+    Entry* tail;
+    // A lower bound on the times of the entries in the slot.
+    int64_t min_time;
+  };
+
+  static const int kSlotBits = 6;
+  static const int kSlotsPerLevel = 1 << kSlotBits;
+  // Enough levels to cover every non-negative int64_t time.
+  static const int kNumLevels = (63 + kSlotBits - 1) / kSlotBits;
+
+  // Files |entry| in the wheel, or in |overdue_| if its time is before
+  // |current_time_|.
+  void File(Entry* entry);
+
+  void Append(Slot* slot, Entry* entry);
+  void Unlink(Entry* entry);
+
+  // Returns the time at which |slot| of |level| starts, relative to
+  // |current_time_|.
+  int64_t SlotStart(int level, int slot) const;
+
+  // Returns the lowest level with an occupied slot, or kNumLevels.
+  int LowestOccupiedLevel() const;
+
+  // Returns true if |slot| is one of the wheel slots, and if so sets |level|
+  // and |index|.
+  bool GetWheelSlot(const Slot* slot, int* level, int* index) const;
+
+  Entry* NewEntry();
+  void FreeEntry(Entry* entry);
+
+  // Every entry in the wheel is at or after |current_time_|.  It only moves
+  // forward, to the start of a slot being cascaded.
+  int64_t current_time_;
+
+  Slot slots_[kNumLevels][kSlotsPerLevel];
+  // Bit i of |occupied_[level]| is set if slots_[level][i] is not empty.
+  uint64_t occupied_[kNumLevels];
+
+  // Entries inserted with a time before |current_time_|.
+  Slot overdue_;
+  // Entries collected by CollectExpired and not popped yet.
+  Slot expired_;
+
+  size_t size_;
+
+  // Entries are allocated in blocks and recycled through a free list, so that
+  // steady state churn does not allocate.
+  std::vector<std::unique_ptr<Entry[]>> blocks_;
+  Entry* free_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(AlarmTimingWheel);
+};
+
+}  // namespace net
+
+#endif  // NET_TOOLS_EPOLL_SERVER_ALARM_TIMING_WHEEL_H_
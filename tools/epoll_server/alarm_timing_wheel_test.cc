@@ -0,0 +1,168 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/epoll_server/alarm_timing_wheel.h"
+
+#include <stdint.h>
+
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/rand_util.h"
+#include "net/tools/epoll_server/epoll_server.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+// The wheel never calls into its callbacks, so EpollAlarm works as an
+// opaque tag.
+class AlarmTimingWheelTest : public ::testing::Test {
+ protected:
+  AlarmTimingWheelTest() : alarms_(16) {}
+
+  // Collects up to |now_in_us| and returns the popped alarms in order.
+  std::vector<AlarmTimingWheel::AlarmCB*> Collect(int64_t now_in_us) {
+    std::vector<AlarmTimingWheel::AlarmCB*> fired;
+    wheel_.CollectExpired(now_in_us);
+    while (AlarmTimingWheel::AlarmCB* cb = wheel_.PopExpired()) {
+      fired.push_back(cb);
+    }
+    return fired;
+  }
+
+  AlarmTimingWheel wheel_;
+  std::vector<EpollAlarm> alarms_;
+};
+
+TEST_F(AlarmTimingWheelTest, FiresInTimeOrder) {
+  // Spread over several levels.
+  const int64_t times[] = {5000000, 70, 1, 4097, 64, 300000};
+  for (size_t i = 0; i < arraysize(times); ++i) {
+    wheel_.Insert(times[i], &alarms_[i]);
+  }
+  EXPECT_EQ(arraysize(times), wheel_.size());
+  EXPECT_EQ(1, wheel_.NextAlarmTime());
+
+  EXPECT_TRUE(Collect(0).empty());
+  std::vector<AlarmTimingWheel::AlarmCB*> expected = {
+      &alarms_[2], &alarms_[4], &alarms_[1], &alarms_[3]};
+  EXPECT_EQ(expected, Collect(4097));
+  EXPECT_EQ(300000, wheel_.NextAlarmTime());
+
+  expected = {&alarms_[5], &alarms_[0]};
+  EXPECT_EQ(expected, Collect(std::numeric_limits<int64_t>::max()));
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(AlarmTimingWheelTest, NeverFiresEarly) {
+  wheel_.Insert(1000000, &alarms_[0]);
+  EXPECT_TRUE(Collect(999999).empty());
+  EXPECT_EQ(1000000, wheel_.NextAlarmTime());
+  EXPECT_EQ(1u, Collect(1000000).size());
+}
+
+TEST_F(AlarmTimingWheelTest, SameTimeFiresInInsertionOrder) {
+  for (size_t i = 0; i < 4; ++i) {
+    wheel_.Insert(100000, &alarms_[i]);
+  }
+  std::vector<AlarmTimingWheel::AlarmCB*> expected = {
+      &alarms_[0], &alarms_[1], &alarms_[2], &alarms_[3]};
+  EXPECT_EQ(expected, Collect(100000));
+}
+
+TEST_F(AlarmTimingWheelTest, RemoveAndReschedule) {
+  AlarmTimingWheel::Entry* first = wheel_.Insert(10, &alarms_[0]);
+  AlarmTimingWheel::Entry* second = wheel_.Insert(20, &alarms_[1]);
+  wheel_.Insert(30, &alarms_[2]);
+
+  EXPECT_EQ(&alarms_[0], wheel_.Remove(first));
+  wheel_.Reschedule(second, 40);
+  EXPECT_EQ(2u, wheel_.size());
+
+  std::vector<AlarmTimingWheel::AlarmCB*> expected = {&alarms_[2]};
+  EXPECT_EQ(expected, Collect(39));
+  expected = {&alarms_[1]};
+  EXPECT_EQ(expected, Collect(40));
+}
+
+TEST_F(AlarmTimingWheelTest, NextAlarmTimeIsLowerBoundAfterRemove) {
+  AlarmTimingWheel::Entry* first = wheel_.Insert(100000, &alarms_[0]);
+  wheel_.Insert(100100, &alarms_[1]);
+  wheel_.Remove(first);
+  // Both alarms share a slot which still remembers the removed alarm, so
+  // the first answer is early.  Collecting at that time fixes it up.
+  EXPECT_EQ(100000, wheel_.NextAlarmTime());
+  EXPECT_TRUE(Collect(100000).empty());
+  EXPECT_EQ(100100, wheel_.NextAlarmTime());
+}
+
+TEST_F(AlarmTimingWheelTest, InsertsDuringCollectionWaitForNextCollect) {
+  wheel_.Insert(100, &alarms_[0]);
+  wheel_.CollectExpired(200);
+  // Both already due, but inserted after CollectExpired.
+  wheel_.Insert(150, &alarms_[1]);
+  wheel_.Insert(50, &alarms_[2]);
+  EXPECT_EQ(&alarms_[0], wheel_.PopExpired());
+  EXPECT_EQ(nullptr, wheel_.PopExpired());
+
+  EXPECT_EQ(50, wheel_.NextAlarmTime());
+  std::vector<AlarmTimingWheel::AlarmCB*> expected = {&alarms_[2],
+                                                      &alarms_[1]};
+  EXPECT_EQ(expected, Collect(200));
+}
+
+TEST_F(AlarmTimingWheelTest, RescheduleCollectedEntry) {
+  AlarmTimingWheel::Entry* entry = wheel_.Insert(100, &alarms_[0]);
+  wheel_.CollectExpired(100);
+  wheel_.Reschedule(entry, 500);
+  EXPECT_EQ(nullptr, wheel_.PopExpired());
+  EXPECT_EQ(500, wheel_.NextAlarmTime());
+}
+
+TEST_F(AlarmTimingWheelTest, RandomChurn) {
+  std::map<AlarmTimingWheel::AlarmCB*, AlarmTimingWheel::Entry*> entries;
+  std::map<AlarmTimingWheel::AlarmCB*, int64_t> deadlines;
+  int64_t now = 1000;
+  for (int i = 0; i < 20000; ++i) {
+    AlarmTimingWheel::AlarmCB* cb = &alarms_[base::RandGenerator(16)];
+    int64_t time = now + static_cast<int64_t>(base::RandGenerator(
+                             uint64_t{1} << base::RandInt(1, 30)));
+    if (entries.count(cb) == 0) {
+      entries[cb] = wheel_.Insert(time, cb);
+      deadlines[cb] = time;
+    } else if (base::RandInt(0, 1) == 0) {
+      wheel_.Remove(entries[cb]);
+      entries.erase(cb);
+      deadlines.erase(cb);
+    } else {
+      wheel_.Reschedule(entries[cb], time);
+      deadlines[cb] = time;
+    }
+    ASSERT_EQ(entries.size(), wheel_.size());
+
+    if (i % 16 == 0) {
+      now += static_cast<int64_t>(
+          base::RandGenerator(uint64_t{1} << base::RandInt(1, 24)));
+      int64_t previous = std::numeric_limits<int64_t>::min();
+      for (AlarmTimingWheel::AlarmCB* fired : Collect(now)) {
+        ASSERT_LE(deadlines[fired], now);
+        ASSERT_LE(previous, deadlines[fired]);
+        previous = deadlines[fired];
+        entries.erase(fired);
+        deadlines.erase(fired);
+      }
+      for (const auto& deadline : deadlines) {
+        ASSERT_GT(deadline.second, now);
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
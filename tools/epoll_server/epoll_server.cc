@@ -8,6 +8,7 @@
 #include <stdlib.h>  // for abort
 #include <errno.h>    // for errno and strerror_r
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "base/auto_reset.h"
@@ -126,21 +127,14 @@ void EpollServer::CleanupFDToCBMap() {
   }
 }
 
-void EpollServer::CleanupTimeToAlarmCBMap() {
-  TimeToAlarmCBMap::iterator erase_it;
-
-  // Call OnShutdown() on alarms. Note that the structure of the loop
-  // is similar to the structure of loop in the function HandleAlarms()
-  for (TimeToAlarmCBMap::iterator i = alarm_map_.begin();
-       i != alarm_map_.end();
-      ) {
-    // Note that OnShutdown() can call UnregisterAlarm() on
-    // other iterators. OnShutdown() should not call UnregisterAlarm()
-    // on self because by definition the iterator is not valid any more.
-    i->second->OnShutdown(this);
-    erase_it = i;
-    ++i;
-    alarm_map_.erase(erase_it);
+void EpollServer::CleanupAlarms() {
+  // Call OnShutdown() on alarms, in time order. Note that OnShutdown() can
+  // call UnregisterAlarm() on other alarms, but not on itself because by
+  // definition its token is not valid any more.
+  alarm_wheel_.CollectExpired(std::numeric_limits<int64_t>::max());
+  while (AlarmCB* cb = alarm_wheel_.PopExpired()) {
+    all_alarms_.erase(cb);
+    cb->OnShutdown(this);
   }
 }
 
@@ -156,7 +150,7 @@ EpollServer::~EpollServer() {
   LIST_INIT(&ready_list_);
   LIST_INIT(&tmp_list_);
 
-  CleanupTimeToAlarmCBMap();
+  CleanupAlarms();
 
   close(read_fd_);
   close(write_fd_);
@@ -347,7 +341,7 @@ void EpollServer::WaitForEventsAndExecuteCallbacks() {
   }
   base::AutoReset<bool> recursion_guard(
       &in_wait_for_events_and_execute_callbacks_, true);
-  if (alarm_map_.empty()) {
+  if (alarm_wheel_.empty()) {
     // no alarms, this is business as usual.
     WaitForEventsAndCallHandleEvents(timeout_in_us_,
                                      events_,
@@ -363,9 +357,9 @@ void EpollServer::WaitForEventsAndExecuteCallbacks() {
   // a more reasonable amount of work is done here.
   int64_t now_in_us = NowInUsec();
 
-  // Get the first timeout from the alarm_map where it is
+  // Get the first timeout from the alarm wheel where it is
   // stored in absolute time.
-  int64_t next_alarm_time_in_us = alarm_map_.begin()->first;
+  int64_t next_alarm_time_in_us = alarm_wheel_.NextAlarmTime();
   VLOG(4) << "next_alarm_time = " << next_alarm_time_in_us
           << " now             = " << now_in_us
           << " timeout_in_us = " << timeout_in_us_;
@@ -447,23 +441,27 @@ void EpollServer::RegisterAlarm(int64_t timeout_time_in_us, AlarmCB* ac) {
   }
   VLOG(4) << "RegisteringAlarm at : " << timeout_time_in_us;
 
-  TimeToAlarmCBMap::iterator alarm_iter =
-      alarm_map_.insert(std::make_pair(timeout_time_in_us, ac));
+  AlarmRegToken token = alarm_wheel_.Insert(timeout_time_in_us, ac);
 
   all_alarms_.insert(ac);
-  // Pass the iterator to the EpollAlarmCallbackInterface.
-  ac->OnRegistration(alarm_iter, this);
+  // Pass the token to the EpollAlarmCallbackInterface.
+  ac->OnRegistration(token, this);
 }
 
 // Unregister a specific alarm callback: iterator_token must be a
-//  valid iterator. The caller must ensure the validity of the iterator.
+//  valid token. The caller must ensure the validity of the token.
 void EpollServer::UnregisterAlarm(const AlarmRegToken& iterator_token) {
-  AlarmCB* cb = iterator_token->second;
-  alarm_map_.erase(iterator_token);
+  AlarmCB* cb = alarm_wheel_.Remove(iterator_token);
   all_alarms_.erase(cb);
   cb->OnUnregistration();
 }
 
+void EpollServer::ReregisterAlarm(const AlarmRegToken& iterator_token,
+                                  int64_t timeout_time_in_us) {
+  VLOG(4) << "ReregisteringAlarm at : " << timeout_time_in_us;
+  alarm_wheel_.Reschedule(iterator_token, timeout_time_in_us);
+}
+
 int EpollServer::NumFDsRegistered() const {
   DCHECK_GE(cb_map_.size(), 1u);
   // Omit the internal FD (read_fd_)
@@ -510,15 +508,10 @@ void EpollServer::LogStateOnCrash() {
   LOG(ERROR) << "timeout_in_us_: " << timeout_in_us_;
 
   // Log sessions with alarms.
-  LOG(ERROR) << alarm_map_.size() << " alarms registered.";
-  for (TimeToAlarmCBMap::iterator it = alarm_map_.begin();
-       it != alarm_map_.end();
-       ++it) {
-    const bool skipped =
-        alarms_reregistered_and_should_be_skipped_.find(it->second)
-        != alarms_reregistered_and_should_be_skipped_.end();
-    LOG(ERROR) << "Alarm " << it->second << " registered at time " << it->first
-               << " and should be skipped = " << skipped;
+  LOG(ERROR) << alarm_wheel_.size() << " alarms registered.";
+  for (const auto& alarm : alarm_wheel_.GetAlarms()) {
+    LOG(ERROR) << "Alarm " << alarm.second << " registered at time "
+               << alarm.first;
   }
 
   LOG(ERROR) << cb_map_.size() << " fd callbacks registered.";
@@ -719,51 +712,28 @@ void EpollServer::CallAndReregisterAlarmEvents() {
   int64_t now_in_us = recorded_now_in_us_;
   DCHECK_NE(0, recorded_now_in_us_);
 
-  TimeToAlarmCBMap::iterator erase_it;
+  // Only alarms which are due before any of them runs are executed here.
+  // Alarms which are (re)registered while executing them, even for a time
+  // which has already passed, wait for the next call. This ensures that we
+  // do not go in an infinite loop.
+  alarm_wheel_.CollectExpired(now_in_us);
 
   // execute alarms.
-  for (TimeToAlarmCBMap::iterator i = alarm_map_.begin();
-       i != alarm_map_.end();
-      ) {
-    if (i->first > now_in_us) {
-      break;
-    }
-    AlarmCB* cb = i->second;
-    // Execute the OnAlarm() only if we did not register
-    // it in this loop itself.
-    const bool added_in_this_round =
-        alarms_reregistered_and_should_be_skipped_.find(cb)
-        != alarms_reregistered_and_should_be_skipped_.end();
-    if (added_in_this_round) {
-      ++i;
-      continue;
-    }
+  while (AlarmCB* cb = alarm_wheel_.PopExpired()) {
     all_alarms_.erase(cb);
     const int64_t new_timeout_time_in_us = cb->OnAlarm();
 
-    erase_it = i;
-    ++i;
-    alarm_map_.erase(erase_it);
-
     if (new_timeout_time_in_us > 0) {
-      // We add to hash_set only if the new timeout is <= now_in_us.
-      // if timeout is > now_in_us then we have no fear that this alarm
-      // can be reexecuted in this loop, and hence we do not need to
-      // worry about a recursive loop.
       DVLOG(3) << "Reregistering alarm "
                << " " << cb
                << " " << new_timeout_time_in_us
                << " " << now_in_us;
-      if (new_timeout_time_in_us <= now_in_us) {
-        alarms_reregistered_and_should_be_skipped_.insert(cb);
-      }
       RegisterAlarm(new_timeout_time_in_us, cb);
     }
   }
-  alarms_reregistered_and_should_be_skipped_.clear();
 }
 
-EpollAlarm::EpollAlarm() : eps_(NULL), registered_(false) {
+EpollAlarm::EpollAlarm() : token_(nullptr), eps_(NULL), registered_(false) {
 }
 
 EpollAlarm::~EpollAlarm() {
@@ -801,4 +771,12 @@ void EpollAlarm::UnregisterIfRegistered() {
   eps_->UnregisterAlarm(token_);
 }
 
+bool EpollAlarm::ReregisterIfRegistered(int64_t timeout_time_in_us) {
+  if (!registered_) {
+    return false;
+  }
+  eps_->ReregisterAlarm(token_, timeout_time_in_us);
+  return true;
+}
+
 }  // namespace net
@@ -10,7 +10,6 @@
 #include <stdint.h>
 #include <sys/queue.h>
 
-#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -38,6 +37,7 @@
 
 #include "base/compiler_specific.h"
 #include "base/macros.h"
+#include "net/tools/epoll_server/alarm_timing_wheel.h"
 #include <sys/epoll.h>
 
 namespace net {
@@ -124,8 +124,7 @@ class EpollServer {
   typedef EpollAlarmCallbackInterface AlarmCB;
   typedef EpollCallbackInterface CB;
 
-  typedef std::multimap<int64_t, AlarmCB*> TimeToAlarmCBMap;
-  typedef TimeToAlarmCBMap::iterator AlarmRegToken;
+  typedef AlarmTimingWheel::Entry* AlarmRegToken;
 
   // Summary:
   //   Constructor:
@@ -402,6 +401,20 @@ class EpollServer {
 
   ////////////////////////////////////////
 
+  // Summary:
+  //   Moves the alarm referred to by iterator_token to go off at time
+  //   'timeout_time_in_us' instead. This is cheaper than unregistering and
+  //   registering it again, and the token stays valid. Neither
+  //   OnUnregistration() nor OnRegistration() is called. The same warnings
+  //   about the validity of the token as for UnregisterAlarm() apply.
+  // Args:
+  //    iterator_token - token of the alarm callback to move.
+  //    timeout_time_in_us - the absolute time at which the alarm should go off
+  virtual void ReregisterAlarm(const EpollServer::AlarmRegToken& iterator_token,
+                               int64_t timeout_time_in_us);
+
+  ////////////////////////////////////////
+
   // Summary:
   //   returns the number of file-descriptors registered in this EpollServer.
   // Returns:
@@ -668,7 +681,7 @@ class EpollServer {
   using AlarmCBMap = std::unordered_set<AlarmCB*, AlarmCBHash>;
   AlarmCBMap all_alarms_;
 
-  TimeToAlarmCBMap alarm_map_;
+  AlarmTimingWheel alarm_wheel_;
 
   // The amount of time in microseconds that we'll wait before returning
   // from the WaitForEventsAndExecuteCallbacks() function.
@@ -684,15 +697,6 @@ class EpollServer {
   // ApproximateNowInUs() function. See that function for more details.
   int64_t recorded_now_in_us_;
 
-  // This is used to implement CallAndReregisterAlarmEvents. This stores
-  // all alarms that were reregistered because OnAlarm() returned a
-  // value > 0 and the time at which they should be executed is less that
-  // the current time.  By storing such alarms in this map we ensure
-  // that while calling CallAndReregisterAlarmEvents we do not call
-  // OnAlarm on any alarm in this set. This ensures that we do not
-  // go in an infinite loop.
-  AlarmCBMap alarms_reregistered_and_should_be_skipped_;
-
   LIST_HEAD(ReadyList, CBAndEventMask) ready_list_;
   LIST_HEAD(TmpList, CBAndEventMask) tmp_list_;
   int ready_list_size_;
@@ -936,7 +940,7 @@ class EpollServer {
  private:
   // Helper functions used in the destructor.
   void CleanupFDToCBMap();
-  void CleanupTimeToAlarmCBMap();
+  void CleanupAlarms();
 
   // The callback registered to the fds below.  As the purpose of their
   // registration is to wake the epoll server it just clears the pipe and
@@ -975,7 +979,7 @@ class EpollAlarmCallbackInterface {
   // Summary:
   //   Called when the an alarm is registered. Invalidates an AlarmRegToken.
   // Args:
-  //   token: the iterator to the the alarm registered in the alarm map.
+  //   token: the token of the alarm registered in the alarm wheel.
   //   WARNING: this token becomes invalid when the alarm fires, is
   //   unregistered, or OnShutdown is called on that alarm.
   //   eps: the epoll server the alarm is registered with.
@@ -1029,6 +1033,10 @@ class EpollAlarm : public EpollAlarmCallbackInterface {
   // If the alarm was registered, unregister it.
   void UnregisterIfRegistered();
 
+  // If the alarm was registered, move it to 'timeout_time_in_us' and return
+  // true.
+  bool ReregisterIfRegistered(int64_t timeout_time_in_us);
+
   bool registered() const { return registered_; }
 
   const EpollServer* eps() const { return eps_; }
@@ -0,0 +1,147 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/rand_util.h"
+#include "base/test/perf_time_logger.h"
+#include "net/quic/core/quic_alarm.h"
+#include "net/tools/epoll_server/epoll_server.h"
+#include "net/tools/quic/quic_epoll_alarm_factory.h"
+#include "net/tools/quic/test_tools/mock_epoll_server.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+using test::FakeTimeEpollServer;
+
+const int kNumAlarms = 1000000;
+const int kNumReschedules = 10000000;
+// Alarms are spread over the next ten seconds, like QUIC's retransmission,
+// ack, ping and idle alarms.
+const uint64_t kAlarmSpreadUs = 10 * 1000 * 1000;
+
+class CountingAlarm : public EpollAlarm {
+ public:
+  CountingAlarm() : fired_(nullptr) {}
+
+  void set_fired(int* fired) { fired_ = fired; }
+
+  int64_t OnAlarm() override {
+    EpollAlarm::OnAlarm();
+    ++*fired_;
+    return 0;
+  }
+
+ private:
+  int* fired_;
+};
+
+class CountingDelegate : public QuicAlarm::Delegate {
+ public:
+  explicit CountingDelegate(int* fired) : fired_(fired) {}
+
+  void OnAlarm() override { ++*fired_; }
+
+ private:
+  int* fired_;
+};
+
+int64_t RandomDeadline(const EpollServer& eps) {
+  return eps.ApproximateNowInUsec() + 1 +
+         static_cast<int64_t>(base::RandGenerator(kAlarmSpreadUs));
+}
+
+// Advances time until every alarm has fired.
+void FireAll(FakeTimeEpollServer* eps) {
+  for (uint64_t elapsed = 0; elapsed <= kAlarmSpreadUs; elapsed += 1000) {
+    eps->AdvanceByAndWaitForEventsAndExecuteCallbacks(1000);
+  }
+}
+
+TEST(EpollServerAlarmPerfTest, AlarmChurn) {
+  FakeTimeEpollServer eps;
+  int fired = 0;
+  std::vector<CountingAlarm> alarms(kNumAlarms);
+  for (CountingAlarm& alarm : alarms) {
+    alarm.set_fired(&fired);
+  }
+
+  {
+    base::PerfTimeLogger timer("EpollServer_register_1M_alarms");
+    for (CountingAlarm& alarm : alarms) {
+      eps.RegisterAlarm(RandomDeadline(eps), &alarm);
+    }
+  }
+
+  {
+    base::PerfTimeLogger timer("EpollServer_unregister_register_10M_alarms");
+    for (int i = 0; i < kNumReschedules; ++i) {
+      CountingAlarm* alarm = &alarms[base::RandGenerator(kNumAlarms)];
+      alarm->UnregisterIfRegistered();
+      eps.RegisterAlarm(RandomDeadline(eps), alarm);
+    }
+  }
+
+  {
+    base::PerfTimeLogger timer("EpollServer_reregister_10M_alarms");
+    for (int i = 0; i < kNumReschedules; ++i) {
+      CountingAlarm* alarm = &alarms[base::RandGenerator(kNumAlarms)];
+      alarm->ReregisterIfRegistered(RandomDeadline(eps));
+    }
+  }
+
+  {
+    base::PerfTimeLogger timer("EpollServer_fire_1M_alarms");
+    FireAll(&eps);
+  }
+  EXPECT_EQ(kNumAlarms, fired);
+}
+
+// The same churn through QuicAlarm, the way QuicConnection drives it: every
+// Update moves an already set alarm.
+TEST(EpollServerAlarmPerfTest, QuicEpollAlarmChurn) {
+  FakeTimeEpollServer eps;
+  QuicEpollAlarmFactory alarm_factory(&eps);
+  int fired = 0;
+  std::vector<std::unique_ptr<QuicAlarm>> alarms;
+  alarms.reserve(kNumAlarms);
+  for (int i = 0; i < kNumAlarms; ++i) {
+    alarms.push_back(std::unique_ptr<QuicAlarm>(
+        alarm_factory.CreateAlarm(new CountingDelegate(&fired))));
+  }
+
+  {
+    base::PerfTimeLogger timer("QuicEpollAlarm_set_1M_alarms");
+    for (const auto& alarm : alarms) {
+      alarm->Set(QuicTime::Zero() +
+                 QuicTime::Delta::FromMicroseconds(RandomDeadline(eps)));
+    }
+  }
+
+  {
+    base::PerfTimeLogger timer("QuicEpollAlarm_update_10M_alarms");
+    for (int i = 0; i < kNumReschedules; ++i) {
+      QuicAlarm* alarm = alarms[base::RandGenerator(kNumAlarms)].get();
+      alarm->Update(QuicTime::Zero() + QuicTime::Delta::FromMicroseconds(
+                                           RandomDeadline(eps)),
+                    QuicTime::Delta::Zero());
+    }
+  }
+
+  {
+    base::PerfTimeLogger timer("QuicEpollAlarm_fire_1M_alarms");
+    FireAll(&eps);
+  }
+  EXPECT_EQ(kNumAlarms, fired);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -0,0 +1,124 @@
+#!/usr/bin/env python
+
+# Copyright 2017 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+import os
+import shlex
+import subprocess
+import sys
+import threading
+import time
+from optparse import OptionParser
+
+"""Measure how epoll_quic_server throughput scales with --num_workers.
+Usage: This invocation
+  run_server_scaling.py --quic_binary_dir=../../../../out/Release \
+      --certificate_file=leaf_cert.pem --key_file=leaf_cert.pkcs8 \
+      --quic_response_cache_dir=/tmp/quic-data/www.example.org \
+      --url=https://www.example.org/ --workers=1,2,4,8 --clients=64 \
+      --requests_per_client=20
+  starts epoll_quic_server on 127.0.0.1 once per worker count, runs
+  --clients concurrent epoll_quic_client processes which each fetch --url
+  --requests_per_client times over fresh connections, and prints the number
+  of completed requests per second for each worker count.
+"""
+
+
+class ScalingExperiment:
+  def __init__(self, quic_binary_dir, port, certificate_file, key_file,
+               response_cache_dir):
+    """Initialize ScalingExperiment.
+
+    Args:
+      quic_binary_dir: Directory containing epoll_quic_server and
+        epoll_quic_client.
+      port: Port the server listens on.
+      certificate_file: Certificate chain for the server.
+      key_file: PKCS8 private key for the server.
+      response_cache_dir: Directory containing the responses to serve.
+    """
+    self.server_binary = os.path.join(quic_binary_dir, 'epoll_quic_server')
+    self.client_binary = os.path.join(quic_binary_dir, 'epoll_quic_client')
+    for binary in [self.server_binary, self.client_binary]:
+      if not os.path.isfile(binary):
+        raise IOError('There is no %s.' % binary)
+    self.port = port
+    self.certificate_file = certificate_file
+    self.key_file = key_file
+    self.response_cache_dir = response_cache_dir
+
+  def StartServer(self, num_workers):
+    """Start the server with |num_workers| workers and return its process."""
+    cmd = ('%s --port=%s --num_workers=%d --certificate_file=%s '
+           '--key_file=%s --quic_response_cache_dir=%s' % (
+               self.server_binary, self.port, num_workers,
+               self.certificate_file, self.key_file, self.response_cache_dir))
+    server = subprocess.Popen(shlex.split(cmd))
+    # Give the workers time to bind before the clients start.
+    time.sleep(1)
+    return server
+
+  def RunClient(self, url, num_requests, failures):
+    """Fetch |url| |num_requests| times, counting failures in |failures|."""
+    cmd = ('%s --host=127.0.0.1 --port=%s --quiet '
+           '--disable-certificate-verification %s' % (
+               self.client_binary, self.port, url))
+    for _ in range(num_requests):
+      with open(os.devnull, 'w') as devnull:
+        rc = subprocess.call(shlex.split(cmd), stdout=devnull, stderr=devnull)
+      if rc != 0:
+        failures.append(rc)
+
+  def RunOnce(self, num_workers, url, num_clients, requests_per_client):
+    """Return (requests per second, failed requests) for |num_workers|."""
+    server = self.StartServer(num_workers)
+    failures = []
+    try:
+      threads = [threading.Thread(target=self.RunClient,
+                                  args=(url, requests_per_client, failures))
+                 for _ in range(num_clients)]
+      start_time = time.time()
+      for thread in threads:
+        thread.start()
+      for thread in threads:
+        thread.join()
+      elapsed = time.time() - start_time
+    finally:
+      server.terminate()
+      server.wait()
+    completed = num_clients * requests_per_client - len(failures)
+    return completed / elapsed, len(failures)
+
+
+def main():
+  parser = OptionParser()
+  parser.add_option('--quic_binary_dir', dest='quic_binary_dir',
+                    default='../../../../out/Release')
+  parser.add_option('--port', dest='port', default='6121')
+  parser.add_option('--certificate_file', dest='certificate_file')
+  parser.add_option('--key_file', dest='key_file')
+  parser.add_option('--quic_response_cache_dir',
+                    dest='quic_response_cache_dir')
+  parser.add_option('--url', dest='url',
+                    default='https://www.example.org/')
+  parser.add_option('--workers', dest='workers', default='1,2,4,8')
+  parser.add_option('--clients', dest='clients', type='int', default=64)
+  parser.add_option('--requests_per_client', dest='requests_per_client',
+                    type='int', default=20)
+  (options, _) = parser.parse_args()
+  if not options.certificate_file or not options.key_file:
+    parser.error('--certificate_file and --key_file are required')
+
+  exp = ScalingExperiment(options.quic_binary_dir, options.port,
+                          options.certificate_file, options.key_file,
+                          options.quic_response_cache_dir)
+  print 'workers,requests_per_sec,failures'
+  for num_workers in [int(w) for w in options.workers.split(',')]:
+    rate, failures = exp.RunOnce(num_workers, options.url, options.clients,
+                                 options.requests_per_client)
+    print '%d,%.1f,%d' % (num_workers, rate, failures)
+
+if __name__ == '__main__':
+  sys.exit(main())
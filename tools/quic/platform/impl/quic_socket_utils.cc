@@ -5,6 +5,7 @@
 #include "net/tools/quic/platform/impl/quic_socket_utils.h"
 
 #include <errno.h>
+#include <linux/filter.h>
 #include <linux/net_tstamp.h>
 #include <netinet/in.h>
 #include <string.h>
@@ -22,6 +23,14 @@
 #define SO_RXQ_OVFL 40
 #endif
 
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 using std::string;
 
 namespace net {
@@ -129,6 +138,48 @@ bool QuicSocketUtils::SetReceiveBufferSize(int fd, size_t size) {
   return true;
 }
 
+// static
+bool QuicSocketUtils::SetReusePort(int fd) {
+  int reuse_port = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse_port,
+                 sizeof(reuse_port)) != 0) {
+    QUIC_LOG(ERROR) << "Failed to set SO_REUSEPORT: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// static
+bool QuicSocketUtils::SetReusePortConnectionIdSteering(int fd,
+                                                       size_t num_sockets) {
+  DCHECK_LT(0u, num_sockets);
+  // The program runs with the UDP header already pulled, so absolute offsets
+  // are relative to the start of the QUIC packet. A failed load (a packet
+  // shorter than five bytes) returns 0, like a packet without a connection ID.
+  sock_filter code[] = {
+      // A = public flags.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+      // Skip the next instruction if a connection ID is present.
+      BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+               PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID, 1, 0),
+      BPF_STMT(BPF_RET | BPF_K, 0),
+      // A = first four bytes of the connection ID in network byte order.
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 1),
+      BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(num_sockets)),
+      BPF_STMT(BPF_RET | BPF_A, 0),
+  };
+  sock_fprog program;
+  program.len = arraysize(code);
+  program.filter = code;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                 sizeof(program)) != 0) {
+    QUIC_LOG(WARNING) << "SO_ATTACH_REUSEPORT_CBPF not supported; connections "
+                      << "are steered by address: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
 // static
 int QuicSocketUtils::ReadPacket(int fd,
                                 char* buffer,
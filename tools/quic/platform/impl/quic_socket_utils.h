@@ -123,6 +123,21 @@ class QuicSocketUtils {
   static int CreateUDPSocket(const QuicSocketAddress& address,
                              bool* overflow_supported);
 
+  // Sets SO_REUSEPORT on the socket so that several sockets may be bound to
+  // the same address, with the kernel load balancing datagrams across them.
+  // Must be called before bind. Returns false if it fails.
+  static bool SetReusePort(int fd);
+
+  // Attaches a classic BPF program to the SO_REUSEPORT group |fd| belongs to
+  // which steers every datagram to a socket by its connection ID: the first
+  // four bytes of the ID, read in network byte order, modulo |num_sockets|
+  // give the index of the socket in bind order. Datagrams without a
+  // connection ID go to the first socket. This keeps a connection on the same
+  // socket when the client's address changes. Returns false if the kernel
+  // lacks SO_ATTACH_REUSEPORT_CBPF, in which case the kernel's 4-tuple hash is
+  // used.
+  static bool SetReusePortConnectionIdSteering(int fd, size_t num_sockets);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(QuicSocketUtils);
 };
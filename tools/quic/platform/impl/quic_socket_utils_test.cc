@@ -168,6 +168,101 @@ TEST_F(QuicSocketUtilsTest, PacketRoundTrip) {
   }
 }
 
+// This test verifies that two SO_REUSEPORT sockets can share an address.
+TEST_F(QuicSocketUtilsTest, ReusePort) {
+  QuicIpAddress localhost = QuicIpAddress::Loopback4();
+  QuicSocketAddress first_addr(localhost, 0);
+
+  int first_fd = CreateUDPSocket(first_addr);
+  ASSERT_NE(-1, first_fd);
+  ASSERT_TRUE(QuicSocketUtils::SetReusePort(first_fd));
+  first_addr = BindSocket(first_fd, first_addr);
+  ASSERT_TRUE(first_addr.IsInitialized());
+
+  QuicSocketAddress second_addr = first_addr;
+  int second_fd = CreateUDPSocket(second_addr);
+  ASSERT_NE(-1, second_fd);
+  ASSERT_TRUE(QuicSocketUtils::SetReusePort(second_fd));
+  second_addr = BindSocket(second_fd, second_addr);
+  ASSERT_TRUE(second_addr.IsInitialized());
+  EXPECT_EQ(first_addr.port(), second_addr.port());
+
+  // Steering is only available on newer kernels; it must not fail the socket.
+  QuicSocketUtils::SetReusePortConnectionIdSteering(first_fd, 2);
+}
+
+// This test verifies that the steering program sends datagrams to the
+// SO_REUSEPORT socket picked by their connection ID, whatever their source.
+TEST_F(QuicSocketUtilsTest, ReusePortConnectionIdSteering) {
+  QuicIpAddress localhost = QuicIpAddress::Loopback4();
+  QuicSocketAddress server_addr(localhost, 0);
+  int server_fds[2];
+  for (int i = 0; i < 2; ++i) {
+    server_fds[i] = CreateUDPSocket(server_addr);
+    ASSERT_NE(-1, server_fds[i]);
+    ASSERT_TRUE(QuicSocketUtils::SetReusePort(server_fds[i]));
+    server_addr = BindSocket(server_fds[i], server_addr);
+    ASSERT_TRUE(server_addr.IsInitialized());
+  }
+  if (!QuicSocketUtils::SetReusePortConnectionIdSteering(server_fds[0], 2))
+    return;
+
+  // clang-format off
+  unsigned char packet[] = {
+    // public flags (8 byte connection_id)
+    0x38,
+    // connection_id
+    0x00, 0x00, 0x01, 0x03,
+    0x98, 0xBA, 0xDC, 0xFE,
+    // packet number
+    0xBC,
+  };
+  // clang-format on
+  const char* data = reinterpret_cast<const char*>(packet);
+
+  // The first four bytes of the connection ID, modulo 2, pick the socket;
+  // the rest of it and the client's port don't matter.
+  struct {
+    unsigned char connection_id_byte_3;
+    unsigned char connection_id_byte_8;
+    int server_index;
+  } cases[] = {
+      {0x03, 0xFE, 1}, {0x03, 0x01, 1}, {0x02, 0xFE, 0}, {0x02, 0x01, 0},
+  };
+  for (const auto& test_case : cases) {
+    packet[4] = test_case.connection_id_byte_3;
+    packet[8] = test_case.connection_id_byte_8;
+    int client_fd = CreateUDPSocket(QuicSocketAddress(localhost, 0));
+    ASSERT_NE(-1, client_fd);
+    auto res = QuicSocketUtils::WritePacket(client_fd, data, sizeof(packet),
+                                            QuicIpAddress(), server_addr);
+    ASSERT_EQ(WRITE_STATUS_OK, res.status);
+
+    int fd = server_fds[test_case.server_index];
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(fd, &read_fds);
+    timeval select_timeout;
+    select_timeout.tv_sec = 5;
+    select_timeout.tv_usec = 0;
+    ASSERT_EQ(1, select(1 + fd, &read_fds, nullptr, nullptr, &select_timeout))
+        << "The datagram didn't reach socket " << test_case.server_index;
+
+    std::array<char, 64> read_buffer;
+    QuicIpAddress target_server_addr;
+    auto walltimestamp = QuicWallTime::Zero();
+    QuicSocketAddress remote_addr;
+    EXPECT_EQ(static_cast<int>(sizeof(packet)),
+              QuicSocketUtils::ReadPacket(
+                  fd, read_buffer.data(), read_buffer.size(), nullptr,
+                  &target_server_addr, &walltimestamp, &remote_addr));
+    EXPECT_EQ(-1, QuicSocketUtils::ReadPacket(
+                      server_fds[1 - test_case.server_index],
+                      read_buffer.data(), read_buffer.size(), nullptr,
+                      &target_server_addr, &walltimestamp, &remote_addr));
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
@@ -0,0 +1,341 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_batch_packet_writer.h"
+
+#include <errno.h>
+#include <netinet/udp.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "net/quic/platform/api/quic_logging.h"
+#include "net/tools/quic/platform/impl/quic_socket_utils.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+namespace net {
+
+namespace {
+
+// Largest UDP payload which fits in an IPv4 datagram.
+const size_t kMaxGsoPacketSize = 65507;
+
+// Control message space for the self address and a UDP_SEGMENT size.
+const size_t kControlSpace =
+    CMSG_SPACE(sizeof(in6_pktinfo)) + CMSG_SPACE(sizeof(uint16_t));
+
+socklen_t AddressLength(const sockaddr_storage& address) {
+  return address.ss_family == AF_INET ? sizeof(sockaddr_in)
+                                      : sizeof(sockaddr_in6);
+}
+
+}  // namespace
+
+QuicBatchPacketWriter::Stats::Stats()
+    : packets_sent(0), send_calls(0), gso_send_calls(0), packets_dropped(0) {}
+
+QuicBatchPacketWriter::QuicBatchPacketWriter(int fd,
+                                             size_t max_batch_size,
+                                             bool use_gso)
+    : QuicDefaultPacketWriter(fd),
+      max_batch_size_(std::max<size_t>(max_batch_size, 1)),
+      use_gso_(use_gso),
+      flushes_deferred_(false),
+      buffer_(new char[max_batch_size_ * kMaxPacketSize]),
+      mmsg_hdrs_(new mmsghdr[max_batch_size_]),
+      iovs_(new iovec[max_batch_size_]),
+      raw_addresses_(new sockaddr_storage[max_batch_size_]),
+      control_(new char[max_batch_size_ * kControlSpace]) {
+  packets_.reserve(max_batch_size_);
+}
+
+QuicBatchPacketWriter::~QuicBatchPacketWriter() {}
+
+WriteResult QuicBatchPacketWriter::WritePacket(
+    const char* buffer,
+    size_t buf_len,
+    const QuicIpAddress& self_address,
+    const QuicSocketAddress& peer_address,
+    PerPacketOptions* options) {
+  return WritePacketForSender(buffer, buf_len, self_address, peer_address,
+                              options, nullptr);
+}
+
+WriteResult QuicBatchPacketWriter::WritePacketForSender(
+    const char* buffer,
+    size_t buf_len,
+    const QuicIpAddress& self_address,
+    const QuicSocketAddress& peer_address,
+    PerPacketOptions* options,
+    QuicPacketWriter* sender) {
+  DCHECK(!IsWriteBlocked());
+  DCHECK(nullptr == options)
+      << "QuicBatchPacketWriter does not accept any options.";
+  DCHECK_LE(buf_len, kMaxPacketSize);
+
+  if (packets_.size() == max_batch_size_) {
+    WriteResult result = SendBufferedPackets();
+    if (result.status == WRITE_STATUS_BLOCKED) {
+      // The packet was not buffered and the caller must write it again.
+      return result;
+    }
+    // Otherwise the whole batch was sent or dropped, and the senders of
+    // dropped packets have been told.
+  }
+
+  char* location = PacketBuffer(packets_.size());
+  if (buffer != location) {
+    memcpy(location, buffer, buf_len);
+  }
+  BufferedPacket packet;
+  packet.length = buf_len;
+  packet.self_address = self_address;
+  packet.peer_address = peer_address;
+  packet.sender = sender;
+  packets_.push_back(packet);
+  return WriteResult(WRITE_STATUS_OK, buf_len);
+}
+
+bool QuicBatchPacketWriter::IsBatchMode() const {
+  return true;
+}
+
+WriteResult QuicBatchPacketWriter::Flush() {
+  if (flushes_deferred_ || packets_.empty()) {
+    return WriteResult(WRITE_STATUS_OK, 0);
+  }
+  if (IsWriteBlocked()) {
+    return WriteResult(WRITE_STATUS_BLOCKED, EAGAIN);
+  }
+  return SendBufferedPackets();
+}
+
+char* QuicBatchPacketWriter::GetNextWriteLocation() {
+  // A full batch is sent before the next packet is copied into it.
+  if (packets_.size() == max_batch_size_) {
+    return nullptr;
+  }
+  return PacketBuffer(packets_.size());
+}
+
+void QuicBatchPacketWriter::RemoveSender(QuicPacketWriter* sender) {
+  for (BufferedPacket& packet : packets_) {
+    if (packet.sender == sender) {
+      packet.sender = nullptr;
+    }
+  }
+}
+
+void QuicBatchPacketWriter::DeferFlushes() {
+  flushes_deferred_ = true;
+}
+
+WriteResult QuicBatchPacketWriter::FinishDeferredFlushes() {
+  flushes_deferred_ = false;
+  return Flush();
+}
+
+WriteResult QuicBatchPacketWriter::SendBufferedPackets() {
+  // Packets before |sent| have been sent or dropped.
+  size_t sent = 0;
+  int bytes_sent = 0;
+  // Set if a packet without a sender was dropped.
+  int unreported_error = 0;
+  // Packets before |no_gso_until| are sent without GSO, so that the packet
+  // which made a GSO send fail is found and dropped on its own.
+  size_t no_gso_until = 0;
+  WriteResult result(WRITE_STATUS_OK, 0);
+  while (sent < packets_.size()) {
+    size_t run = use_gso_ && sent >= no_gso_until ? GsoRunLength(sent) : 1;
+    if (run > 1) {
+      int rc = SendGso(sent, run);
+      if (rc < 0 && (errno == EINVAL || errno == ENOPROTOOPT || errno == EIO)) {
+        // Either the kernel or the egress device cannot segment.
+        QUIC_LOG(WARNING) << "UDP GSO not supported, using sendmmsg: "
+                          << strerror(errno);
+        use_gso_ = false;
+        continue;
+      }
+      if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        result = WriteResult(WRITE_STATUS_BLOCKED, errno);
+        break;
+      }
+      if (rc < 0) {
+        no_gso_until = sent + run;
+        continue;
+      }
+      ++stats_.send_calls;
+      ++stats_.gso_send_calls;
+      stats_.packets_sent += run;
+      sent += run;
+      bytes_sent += rc;
+      continue;
+    }
+
+    // Send everything up to the next GSO run with one sendmmsg.
+    size_t count = 1;
+    while (sent + count < packets_.size() &&
+           (!use_gso_ || sent + count < no_gso_until ||
+            GsoRunLength(sent + count) == 1)) {
+      ++count;
+    }
+    int rc = SendMmsg(sent, count);
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      result = WriteResult(WRITE_STATUS_BLOCKED, errno);
+      break;
+    }
+    if (rc < 0) {
+      // sendmmsg fails only for its first message; the others are tried
+      // again after it.
+      int error_code = errno;
+      if (!DropPacket(sent, error_code)) {
+        unreported_error = error_code;
+      }
+      ++sent;
+      continue;
+    }
+    ++stats_.send_calls;
+    stats_.packets_sent += rc;
+    for (int i = 0; i < rc; ++i) {
+      bytes_sent += packets_[sent + i].length;
+    }
+    sent += rc;
+  }
+
+  // Move the unsent packets to the front of the batch.
+  for (size_t i = sent; i < packets_.size(); ++i) {
+    memmove(PacketBuffer(i - sent), PacketBuffer(i), packets_[i].length);
+  }
+  packets_.erase(packets_.begin(), packets_.begin() + sent);
+
+  if (result.status == WRITE_STATUS_BLOCKED) {
+    set_write_blocked(true);
+    return result;
+  }
+  if (unreported_error != 0) {
+    return WriteResult(WRITE_STATUS_ERROR, unreported_error);
+  }
+  return WriteResult(WRITE_STATUS_OK, bytes_sent);
+}
+
+bool QuicBatchPacketWriter::DropPacket(size_t index, int error_code) {
+  const BufferedPacket& packet = packets_[index];
+  QUIC_LOG_FIRST_N(ERROR, 10) << "Dropping a " << packet.length
+                              << " byte packet to "
+                              << packet.peer_address.ToString() << ": "
+                              << strerror(error_code);
+  ++stats_.packets_dropped;
+  if (packet.sender == nullptr) {
+    return false;
+  }
+  packet.sender->OnBufferedPacketDropped(error_code);
+  return true;
+}
+
+size_t QuicBatchPacketWriter::GsoRunLength(size_t first) const {
+  const BufferedPacket& head = packets_[first];
+  size_t total_length = head.length;
+  size_t last = first + 1;
+  while (last < packets_.size() && last - first < kMaxGsoSegments) {
+    const BufferedPacket& packet = packets_[last];
+    if (packet.peer_address != head.peer_address ||
+        packet.self_address != head.self_address ||
+        packet.length > head.length ||
+        total_length + packet.length > kMaxGsoPacketSize) {
+      break;
+    }
+    total_length += packet.length;
+    ++last;
+    if (packet.length < head.length) {
+      // Only the last segment may be shorter.
+      break;
+    }
+  }
+  return last - first;
+}
+
+int QuicBatchPacketWriter::SendGso(size_t first, size_t count) {
+  const BufferedPacket& head = packets_[first];
+  for (size_t i = 0; i < count; ++i) {
+    iovs_[i].iov_base = PacketBuffer(first + i);
+    iovs_[i].iov_len = packets_[first + i].length;
+  }
+  raw_addresses_[0] = head.peer_address.generic_address();
+
+  msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_name = &raw_addresses_[0];
+  hdr.msg_namelen = AddressLength(raw_addresses_[0]);
+  hdr.msg_iov = iovs_.get();
+  hdr.msg_iovlen = count;
+  SetControl(head, static_cast<uint16_t>(head.length), control_.get(), &hdr);
+
+  int rc;
+  do {
+    rc = sendmsg(fd(), &hdr, 0);
+  } while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+int QuicBatchPacketWriter::SendMmsg(size_t first, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const BufferedPacket& packet = packets_[first + i];
+    iovs_[i].iov_base = PacketBuffer(first + i);
+    iovs_[i].iov_len = packet.length;
+    raw_addresses_[i] = packet.peer_address.generic_address();
+
+    msghdr* hdr = &mmsg_hdrs_[i].msg_hdr;
+    memset(&mmsg_hdrs_[i], 0, sizeof(mmsghdr));
+    hdr->msg_name = &raw_addresses_[i];
+    hdr->msg_namelen = AddressLength(raw_addresses_[i]);
+    hdr->msg_iov = &iovs_[i];
+    hdr->msg_iovlen = 1;
+    SetControl(packet, 0, control_.get() + i * kControlSpace, hdr);
+  }
+
+  int rc;
+  do {
+    rc = sendmmsg(fd(), mmsg_hdrs_.get(), count, 0);
+  } while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+// static
+void QuicBatchPacketWriter::SetControl(const BufferedPacket& packet,
+                                       uint16_t segment_size,
+                                       char* control,
+                                       msghdr* hdr) {
+  if (!packet.self_address.IsInitialized() && segment_size == 0) {
+    hdr->msg_control = nullptr;
+    hdr->msg_controllen = 0;
+    return;
+  }
+  memset(control, 0, kControlSpace);
+  hdr->msg_control = control;
+  hdr->msg_controllen = kControlSpace;
+  size_t control_length = 0;
+  cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
+  if (packet.self_address.IsInitialized()) {
+    QuicSocketUtils::SetIpInfoInCmsg(packet.self_address, cmsg);
+    control_length += CMSG_SPACE(cmsg->cmsg_len - CMSG_LEN(0));
+    cmsg = CMSG_NXTHDR(hdr, cmsg);
+  }
+  if (segment_size != 0) {
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    control_length += CMSG_SPACE(sizeof(uint16_t));
+  }
+  hdr->msg_controllen = control_length;
+}
+
+}  // namespace net
@@ -0,0 +1,153 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
+#define NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+#include "net/quic/core/quic_packets.h"
+#include "net/quic/platform/api/quic_ip_address.h"
+#include "net/quic/platform/api/quic_socket_address.h"
+#include "net/tools/quic/quic_default_packet_writer.h"
+
+namespace net {
+
+// Maximum number of segments the kernel accepts in one UDP_SEGMENT send.
+const size_t kMaxGsoSegments = 64;
+
+// A packet writer which copies packets into a batch and sends the batch with
+// as few syscalls as possible when it fills up or when Flush is called:
+// consecutive packets to the same peer are sent as one UDP_SEGMENT (GSO)
+// super packet when |use_gso| is set and the kernel supports it, and
+// everything else with sendmmsg.
+//
+// WritePacket reports buffered packets as written.  A packet is only
+// rejected with WRITE_STATUS_BLOCKED if the batch is full and could not be
+// sent, so IsWriteBlockedDataBuffered is false.  A packet the socket refuses
+// with an error other than EAGAIN is dropped on its own, and the rest of the
+// batch is still sent; the error goes to the packet's sender if it was
+// written with WritePacketForSender.  Packets still buffered when the writer
+// is destroyed are dropped; Flush first to send them.
+class QuicBatchPacketWriter : public QuicDefaultPacketWriter {
+ public:
+  struct Stats {
+    Stats();
+
+    // Number of packets handed to the kernel.
+    uint64_t packets_sent;
+    // Number of sendmmsg and sendmsg calls which sent at least one packet.
+    uint64_t send_calls;
+    // Number of those calls which used UDP_SEGMENT.
+    uint64_t gso_send_calls;
+    // Number of packets dropped because the socket refused them.
+    uint64_t packets_dropped;
+  };
+
+  QuicBatchPacketWriter(int fd, size_t max_batch_size, bool use_gso);
+  ~QuicBatchPacketWriter() override;
+
+  // QuicPacketWriter
+  WriteResult WritePacket(const char* buffer,
+                          size_t buf_len,
+                          const QuicIpAddress& self_address,
+                          const QuicSocketAddress& peer_address,
+                          PerPacketOptions* options) override;
+  bool IsBatchMode() const override;
+  WriteResult Flush() override;
+  char* GetNextWriteLocation() override;
+  WriteResult WritePacketForSender(const char* buffer,
+                                   size_t buf_len,
+                                   const QuicIpAddress& self_address,
+                                   const QuicSocketAddress& peer_address,
+                                   PerPacketOptions* options,
+                                   QuicPacketWriter* sender) override;
+  void RemoveSender(QuicPacketWriter* sender) override;
+
+  // Until FinishDeferredFlushes is called, Flush returns WRITE_STATUS_OK
+  // without sending, so that packets written by several connections while
+  // the dispatcher handles one event share syscalls.  Full batches are still
+  // sent as they fill up.
+  void DeferFlushes();
+
+  // Stops deferring flushes and sends everything buffered.
+  WriteResult FinishDeferredFlushes();
+
+  size_t buffered_packets() const { return packets_.size(); }
+
+  bool use_gso() const { return use_gso_; }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct BufferedPacket {
+    size_t length;
+    QuicIpAddress self_address;
+    QuicSocketAddress peer_address;
+    // Told if the packet is dropped, or nullptr.
+    QuicPacketWriter* sender;
+  };
+
+  // Returns the copy of the packet at |index| in the batch.
+  char* PacketBuffer(size_t index) {
+    return buffer_.get() + index * kMaxPacketSize;
+  }
+
+  // Sends as much of the batch as the socket accepts and removes the sent
+  // and dropped packets from it.
+  WriteResult SendBufferedPackets();
+
+  // Drops the packet at |index|, which the socket refused with |error_code|,
+  // and tells its sender.  Returns false if it has none.
+  bool DropPacket(size_t index, int error_code);
+
+  // Returns the number of packets starting at |first| which can be sent as
+  // one GSO super packet: same addresses, the same length except for a
+  // possibly shorter last one, and at most kMaxGsoSegments of them.
+  size_t GsoRunLength(size_t first) const;
+
+  // Sends |count| packets starting at |first| as one GSO super packet.
+  // Returns the number of bytes sent, or -1 with errno set.
+  int SendGso(size_t first, size_t count);
+
+  // Sends |count| packets starting at |first| with sendmmsg.  Returns the
+  // number of packets sent, or -1 with errno set.
+  int SendMmsg(size_t first, size_t count);
+
+  // Points |hdr| at |control|, filled with the self address of |packet| and,
+  // if |segment_size| is non-zero, a UDP_SEGMENT size.
+  static void SetControl(const BufferedPacket& packet,
+                         uint16_t segment_size,
+                         char* control,
+                         msghdr* hdr);
+
+  const size_t max_batch_size_;
+  bool use_gso_;
+  bool flushes_deferred_;
+
+  // Copies of the buffered packets, kMaxPacketSize bytes per packet.
+  std::unique_ptr<char[]> buffer_;
+  std::vector<BufferedPacket> packets_;
+
+  // Per-packet scratch space for building the send calls.
+  std::unique_ptr<mmsghdr[]> mmsg_hdrs_;
+  std::unique_ptr<iovec[]> iovs_;
+  std::unique_ptr<sockaddr_storage[]> raw_addresses_;
+  std::unique_ptr<char[]> control_;
+
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicBatchPacketWriter);
+};
+
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
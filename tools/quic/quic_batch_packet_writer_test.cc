@@ -0,0 +1,210 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_batch_packet_writer.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "net/quic/platform/api/quic_socket_address.h"
+#include "net/tools/quic/platform/impl/quic_socket_utils.h"
+#include "net/tools/quic/quic_per_connection_packet_writer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+class QuicBatchPacketWriterTest : public ::testing::Test {
+ protected:
+  QuicBatchPacketWriterTest() : server_fd_(-1), client_fd_(-1) {}
+
+  ~QuicBatchPacketWriterTest() override {
+    if (server_fd_ >= 0) {
+      close(server_fd_);
+    }
+    if (client_fd_ >= 0) {
+      close(client_fd_);
+    }
+  }
+
+  void SetUp() override {
+    bool overflow_supported = false;
+    server_address_ = QuicSocketAddress(QuicIpAddress::Loopback4(), 0);
+    server_fd_ =
+        QuicSocketUtils::CreateUDPSocket(server_address_, &overflow_supported);
+    ASSERT_LE(0, server_fd_);
+    sockaddr_storage addr = server_address_.generic_address();
+    ASSERT_EQ(0, bind(server_fd_, reinterpret_cast<sockaddr*>(&addr),
+                      sizeof(sockaddr_in)));
+    ASSERT_EQ(0, server_address_.FromSocket(server_fd_));
+
+    client_fd_ = QuicSocketUtils::CreateUDPSocket(
+        QuicSocketAddress(QuicIpAddress::Loopback4(), 0), &overflow_supported);
+    ASSERT_LE(0, client_fd_);
+  }
+
+  WriteResult Write(QuicBatchPacketWriter* writer, const std::string& data) {
+    return writer->WritePacket(data.data(), data.size(), QuicIpAddress(),
+                               server_address_, nullptr);
+  }
+
+  // Returns the datagrams waiting on the server socket.
+  std::vector<std::string> ReadAll() {
+    std::vector<std::string> packets;
+    char buffer[kMaxPacketSize];
+    QuicSocketAddress peer_address;
+    int bytes_read;
+    while ((bytes_read = QuicSocketUtils::ReadPacket(
+                server_fd_, buffer, sizeof(buffer), nullptr, nullptr, nullptr,
+                &peer_address)) >= 0) {
+      packets.push_back(std::string(buffer, bytes_read));
+    }
+    return packets;
+  }
+
+  QuicSocketAddress server_address_;
+  int server_fd_;
+  int client_fd_;
+};
+
+TEST_F(QuicBatchPacketWriterTest, HoldsPacketsUntilFlush) {
+  QuicBatchPacketWriter writer(client_fd_, 8, false);
+  EXPECT_TRUE(writer.IsBatchMode());
+  EXPECT_FALSE(writer.IsWriteBlockedDataBuffered());
+  for (int i = 0; i < 3; ++i) {
+    WriteResult result = Write(&writer, "packet " + std::to_string(i));
+    EXPECT_EQ(WRITE_STATUS_OK, result.status);
+    EXPECT_EQ(8, result.bytes_written);
+  }
+  EXPECT_EQ(3u, writer.buffered_packets());
+  EXPECT_TRUE(ReadAll().empty());
+
+  WriteResult result = writer.Flush();
+  EXPECT_EQ(WRITE_STATUS_OK, result.status);
+  EXPECT_EQ(24, result.bytes_written);
+  EXPECT_EQ(0u, writer.buffered_packets());
+  EXPECT_EQ(1u, writer.stats().send_calls);
+  EXPECT_EQ(3u, writer.stats().packets_sent);
+
+  std::vector<std::string> packets = ReadAll();
+  ASSERT_EQ(3u, packets.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ("packet " + std::to_string(i), packets[i]);
+  }
+}
+
+TEST_F(QuicBatchPacketWriterTest, SendsFullBatchOnNextWrite) {
+  QuicBatchPacketWriter writer(client_fd_, 2, false);
+  Write(&writer, "a");
+  Write(&writer, "b");
+  EXPECT_EQ(2u, writer.buffered_packets());
+  Write(&writer, "c");
+  EXPECT_EQ(1u, writer.buffered_packets());
+  EXPECT_EQ(2u, ReadAll().size());
+}
+
+TEST_F(QuicBatchPacketWriterTest, DeferredFlushes) {
+  QuicBatchPacketWriter writer(client_fd_, 8, false);
+  writer.DeferFlushes();
+  Write(&writer, "a");
+  EXPECT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  Write(&writer, "b");
+  EXPECT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  EXPECT_EQ(2u, writer.buffered_packets());
+
+  EXPECT_EQ(WRITE_STATUS_OK, writer.FinishDeferredFlushes().status);
+  EXPECT_EQ(0u, writer.buffered_packets());
+  EXPECT_EQ(1u, writer.stats().send_calls);
+  EXPECT_EQ(2u, ReadAll().size());
+}
+
+TEST_F(QuicBatchPacketWriterTest, WritesFromNextWriteLocation) {
+  QuicBatchPacketWriter writer(client_fd_, 2, false);
+  for (int i = 0; i < 2; ++i) {
+    char* location = writer.GetNextWriteLocation();
+    ASSERT_TRUE(location);
+    memset(location, 'a' + i, 10);
+    WriteResult result = writer.WritePacket(location, 10, QuicIpAddress(),
+                                            server_address_, nullptr);
+    EXPECT_EQ(WRITE_STATUS_OK, result.status);
+  }
+  // The batch is full, so the next packet can not be serialized into it.
+  EXPECT_EQ(nullptr, writer.GetNextWriteLocation());
+  EXPECT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  EXPECT_TRUE(writer.GetNextWriteLocation());
+
+  std::vector<std::string> packets = ReadAll();
+  ASSERT_EQ(2u, packets.size());
+  EXPECT_EQ(std::string(10, 'a'), packets[0]);
+  EXPECT_EQ(std::string(10, 'b'), packets[1]);
+}
+
+TEST_F(QuicBatchPacketWriterTest, GsoKeepsDatagramBoundaries) {
+  QuicBatchPacketWriter writer(client_fd_, 8, true);
+  std::string full(1000, 'x');
+  Write(&writer, full);
+  Write(&writer, full);
+  Write(&writer, "short");
+  EXPECT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  // GSO is optional: kernels without UDP_SEGMENT fall back to sendmmsg.
+  if (writer.use_gso()) {
+    EXPECT_EQ(1u, writer.stats().gso_send_calls);
+  }
+
+  std::vector<std::string> packets = ReadAll();
+  ASSERT_EQ(3u, packets.size());
+  EXPECT_EQ(full, packets[0]);
+  EXPECT_EQ(full, packets[1]);
+  EXPECT_EQ("short", packets[2]);
+}
+
+TEST_F(QuicBatchPacketWriterTest, DropsOnlyRefusedPacket) {
+  QuicBatchPacketWriter writer(client_fd_, 8, false);
+  // An IPv4 socket refuses to send to an IPv6 address.
+  QuicSocketAddress bad_address(QuicIpAddress::Loopback6(),
+                                server_address_.port());
+  Write(&writer, "a");
+  writer.WritePacket("b", 1, QuicIpAddress(), bad_address, nullptr);
+  Write(&writer, "c");
+
+  WriteResult result = writer.Flush();
+  EXPECT_EQ(WRITE_STATUS_ERROR, result.status);
+  EXPECT_EQ(0u, writer.buffered_packets());
+  EXPECT_EQ(1u, writer.stats().packets_dropped);
+  EXPECT_EQ(2u, writer.stats().packets_sent);
+
+  std::vector<std::string> packets = ReadAll();
+  ASSERT_EQ(2u, packets.size());
+  EXPECT_EQ("a", packets[0]);
+  EXPECT_EQ("c", packets[1]);
+}
+
+TEST_F(QuicBatchPacketWriterTest, ReportsDroppedPacketToSender) {
+  QuicBatchPacketWriter writer(client_fd_, 8, false);
+  QuicPerConnectionPacketWriter good_sender(&writer);
+  QuicPerConnectionPacketWriter bad_sender(&writer);
+  QuicSocketAddress bad_address(QuicIpAddress::Loopback6(),
+                                server_address_.port());
+  good_sender.WritePacket("a", 1, QuicIpAddress(), server_address_, nullptr);
+  bad_sender.WritePacket("b", 1, QuicIpAddress(), bad_address, nullptr);
+  good_sender.WritePacket("c", 1, QuicIpAddress(), server_address_, nullptr);
+
+  // The sender which flushes does not see the other sender's error.
+  EXPECT_EQ(WRITE_STATUS_OK, good_sender.Flush().status);
+  EXPECT_EQ(1u, writer.stats().packets_dropped);
+  EXPECT_EQ(2u, ReadAll().size());
+
+  WriteResult result = bad_sender.Flush();
+  EXPECT_EQ(WRITE_STATUS_ERROR, result.status);
+  EXPECT_NE(0, result.error_code);
+  EXPECT_EQ(WRITE_STATUS_OK, bad_sender.Flush().status);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
@@ -66,6 +66,8 @@ class PacketCollector : public QuicPacketCreator::DelegateInterface {
                             const string& error_details,
                             ConnectionCloseSource source) override {}
 
+  char* GetPacketBuffer() override { return nullptr; }
+
   std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets() {
     return &packets_;
   }
@@ -457,6 +459,12 @@ void QuicDispatcher::OnCanWrite() {
   // The socket is now writable.
   writer_->SetWritable();
 
+  // Send whatever a batch mode writer is still holding before letting the
+  // blocked writers add to it.
+  if (writer_->IsBatchMode()) {
+    writer_->Flush();
+  }
+
   // Give all the blocked writers one chance to write, until we're blocked again
   // or there's no work left.
   while (!write_blocked_list_.empty() && !writer_->IsWriteBlocked()) {
@@ -467,6 +475,16 @@ void QuicDispatcher::OnCanWrite() {
   }
 }
 
+void QuicDispatcher::OnSharedWriterBlocked() {
+  for (const auto& it : session_map_) {
+    QuicSession* session = it.second.get();
+    if (session->WillingAndAbleToWrite() ||
+        session->connection()->HasQueuedData()) {
+      OnWriteBlocked(session->connection());
+    }
+  }
+}
+
 bool QuicDispatcher::HasPendingWrites() const {
   return !write_blocked_list_.empty();
 }
@@ -70,6 +70,12 @@ class QuicDispatcher : public QuicTimeWaitListManager::Visitor,
   // Returns true if there's anything in the blocked writer list.
   virtual bool HasPendingWrites() const;
 
+  // Called when the shared writer became write blocked while no connection
+  // was writing, for example when flushing a batch of packets several
+  // connections wrote.  Queues the connections which still have data to send
+  // for resumption, as a connection whose own write blocks queues itself.
+  void OnSharedWriterBlocked();
+
   // Sends ConnectionClose frames to all connected clients.
   void Shutdown();
 
@@ -30,6 +30,16 @@ class QuicEpollAlarm : public QuicAlarm {
     epoll_alarm_impl_.UnregisterIfRegistered();
   }
 
+  void UpdateImpl() override {
+    DCHECK(deadline().IsInitialized());
+    // Moving the registered alarm avoids a round trip through the epoll
+    // server's alarm bookkeeping for every rescheduled alarm.
+    if (!epoll_alarm_impl_.ReregisterIfRegistered(
+            (deadline() - QuicTime::Zero()).ToMicroseconds())) {
+      QuicAlarm::UpdateImpl();
+    }
+  }
+
  private:
   class EpollAlarmImpl : public EpollAlarm {
    public:
@@ -0,0 +1,180 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_multi_threaded_server.h"
+
+#include <utility>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/atomic_flag.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "net/quic/core/crypto/proof_source.h"
+#include "net/quic/core/crypto/quic_random.h"
+#include "net/quic/platform/api/quic_logging.h"
+#include "net/quic/platform/impl/quic_chromium_clock.h"
+#include "net/tools/quic/platform/impl/quic_socket_utils.h"
+#include "net/tools/quic/quic_server.h"
+
+namespace net {
+
+// Runs one QuicServer on its own thread.  The QuicServer is created, used and
+// destroyed on that thread.
+class QuicMultiThreadedServer::Worker : public base::SimpleThread {
+ public:
+  Worker(size_t index,
+         const QuicMultiThreadedServer* owner,
+         std::unique_ptr<ProofSource> proof_source,
+         const QuicSocketAddress& address)
+      : base::SimpleThread("QuicServerWorker" + base::SizeTToString(index)),
+        index_(index),
+        owner_(owner),
+        proof_source_(std::move(proof_source)),
+        address_(address),
+        listening_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                         base::WaitableEvent::InitialState::NOT_SIGNALED),
+        listening_(false),
+        steering_attached_(false),
+        port_(0) {}
+
+  ~Worker() override {}
+
+  // Starts the thread and blocks until the worker's socket is bound.  Returns
+  // false if it could not listen, in which case the thread has exited.
+  bool StartAndWaitForListening() {
+    Start();
+    listening_event_.Wait();
+    if (!listening_) {
+      Join();
+    }
+    return listening_;
+  }
+
+  // Asks the worker to shut down.  The worker notices within one
+  // QuicServer::WaitForEvents timeout.
+  void Stop() { stop_.Set(); }
+
+  // base::SimpleThread implementation.
+  void Run() override {
+    QuicServer server(std::move(proof_source_), owner_->config_,
+                      owner_->crypto_config_options_,
+                      owner_->supported_versions_, owner_->response_cache_);
+    server.set_reuse_port(true);
+    server.SetPacketReaderBatchSize(owner_->packet_reader_batch_size_);
+    server.SetPacketWriterBatchSize(owner_->packet_writer_batch_size_,
+                                    owner_->packet_writer_use_gso_);
+    listening_ = server.SetServerConfigs(owner_->server_configs_) &&
+                 server.CreateUDPSocketAndListen(address_);
+    if (listening_) {
+      port_ = server.port();
+      // The program is shared by the whole SO_REUSEPORT group, so attaching
+      // it through the first socket is enough.  Until the remaining workers
+      // have bound, indexes past the end of the group fall back to the
+      // kernel's address hash.
+      if (index_ == 0 && owner_->num_workers_ > 1) {
+        steering_attached_ = QuicSocketUtils::SetReusePortConnectionIdSteering(
+            server.fd(), owner_->num_workers_);
+      }
+    }
+    listening_event_.Signal();
+    if (!listening_) {
+      return;
+    }
+
+    while (!stop_.IsSet()) {
+      server.WaitForEvents();
+    }
+    server.Shutdown();
+  }
+
+  bool steering_attached() const { return steering_attached_; }
+
+  int port() const { return port_; }
+
+ private:
+  const size_t index_;
+  const QuicMultiThreadedServer* owner_;  // unowned.
+  std::unique_ptr<ProofSource> proof_source_;
+  const QuicSocketAddress address_;
+
+  // Signaled once the worker has attempted to bind.  |listening_|,
+  // |steering_attached_| and |port_| are written before it is signaled and
+  // never again.
+  base::WaitableEvent listening_event_;
+  bool listening_;
+  bool steering_attached_;
+  int port_;
+
+  base::AtomicFlag stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+QuicMultiThreadedServer::QuicMultiThreadedServer(
+    size_t num_workers,
+    const ProofSourceFactory& proof_source_factory,
+    const QuicConfig& config,
+    const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+    const QuicVersionVector& supported_versions,
+    QuicHttpResponseCache* response_cache)
+    : num_workers_(num_workers),
+      proof_source_factory_(proof_source_factory),
+      config_(config),
+      crypto_config_options_(crypto_config_options),
+      supported_versions_(supported_versions),
+      response_cache_(response_cache),
+      connection_id_steering_(false),
+      packet_reader_batch_size_(1),
+      packet_writer_batch_size_(1),
+      packet_writer_use_gso_(false),
+      port_(0) {
+  DCHECK_LT(0u, num_workers_);
+  QuicChromiumClock clock;
+  server_configs_.push_back(QuicCryptoServerConfig::GenerateConfig(
+      QuicRandom::GetInstance(), &clock, crypto_config_options_));
+}
+
+QuicMultiThreadedServer::~QuicMultiThreadedServer() {
+  Shutdown();
+}
+
+bool QuicMultiThreadedServer::CreateUDPSocketsAndListen(
+    const QuicSocketAddress& address) {
+  DCHECK(workers_.empty());
+  // Workers are started one after another so that their sockets join the
+  // SO_REUSEPORT group in index order, which the steering program relies on.
+  QuicSocketAddress worker_address = address;
+  for (size_t i = 0; i < num_workers_; ++i) {
+    std::unique_ptr<Worker> worker(
+        new Worker(i, this, proof_source_factory_.Run(), worker_address));
+    if (!worker->StartAndWaitForListening()) {
+      QUIC_LOG(ERROR) << "Worker " << i << " failed to listen on "
+                      << worker_address.ToString();
+      Shutdown();
+      return false;
+    }
+    if (i == 0) {
+      port_ = worker->port();
+      connection_id_steering_ = worker->steering_attached();
+      worker_address = QuicSocketAddress(address.host(), port_);
+    }
+    workers_.push_back(std::move(worker));
+  }
+  QUIC_LOG(INFO) << num_workers_ << " workers listening on port " << port_
+                 << (connection_id_steering_ ? " with" : " without")
+                 << " connection ID steering";
+  return true;
+}
+
+void QuicMultiThreadedServer::Shutdown() {
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    worker->Stop();
+  }
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    worker->Join();
+  }
+  workers_.clear();
+}
+
+}  // namespace net
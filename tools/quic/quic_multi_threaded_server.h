@@ -0,0 +1,116 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A QUIC server which runs one QuicServer per worker thread.  Every worker
+// owns its own SO_REUSEPORT socket, EpollServer, QuicDispatcher (and with it a
+// QuicTimeWaitListManager) and QuicCryptoServerConfig, so workers share no
+// mutable state on the packet path.  All workers are loaded with the same
+// server config so that a client's cached SCFG is valid on every worker.
+//
+// Datagrams are steered to workers by connection ID (see
+// QuicSocketUtils::SetReusePortConnectionIdSteering), so a client whose
+// address changes mid-connection still reaches the worker which owns its
+// session.
+
+#ifndef NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
+#define NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/macros.h"
+#include "net/quic/core/crypto/crypto_server_config_protobuf.h"
+#include "net/quic/core/crypto/quic_crypto_server_config.h"
+#include "net/quic/core/quic_config.h"
+#include "net/quic/core/quic_versions.h"
+#include "net/quic/platform/api/quic_socket_address.h"
+
+namespace net {
+
+class ProofSource;
+class QuicHttpResponseCache;
+
+class QuicMultiThreadedServer {
+ public:
+  // Creates the ProofSource for one worker.  Called on the thread which calls
+  // CreateUDPSocketsAndListen, once per worker.
+  typedef base::Callback<std::unique_ptr<ProofSource>()> ProofSourceFactory;
+
+  // |response_cache| is shared by all workers and must be fully populated
+  // before CreateUDPSocketsAndListen is called; it is only read afterwards.
+  QuicMultiThreadedServer(
+      size_t num_workers,
+      const ProofSourceFactory& proof_source_factory,
+      const QuicConfig& config,
+      const QuicCryptoServerConfig::ConfigOptions& crypto_config_options,
+      const QuicVersionVector& supported_versions,
+      QuicHttpResponseCache* response_cache);
+
+  ~QuicMultiThreadedServer();
+
+  // Starts the workers one at a time, each listening on |address|.  If the
+  // port of |address| is 0 the first worker picks an ephemeral port and the
+  // remaining workers join it.  Returns false, after stopping any workers
+  // already started, if a worker fails to listen.
+  bool CreateUDPSocketsAndListen(const QuicSocketAddress& address);
+
+  // Stops and joins every worker.  Each worker gives its sessions a chance to
+  // send a connection close before its socket is closed.
+  void Shutdown();
+
+  // True if datagrams are steered to workers by connection ID rather than by
+  // the kernel's address hash.
+  bool connection_id_steering() const { return connection_id_steering_; }
+
+  size_t num_workers() const { return num_workers_; }
+
+  // Number of packets each worker reads per recvmmsg call.  Must be set
+  // before CreateUDPSocketsAndListen.
+  void set_packet_reader_batch_size(size_t batch_size) {
+    packet_reader_batch_size_ = batch_size;
+  }
+
+  // Number of packets each worker's writer sends per sendmmsg call, with UDP
+  // GSO if |use_gso| is true.  Must be set before CreateUDPSocketsAndListen.
+  void set_packet_writer_batch_size(size_t batch_size, bool use_gso) {
+    packet_writer_batch_size_ = batch_size;
+    packet_writer_use_gso_ = use_gso;
+  }
+
+  int port() const { return port_; }
+
+ private:
+  class Worker;
+
+  const size_t num_workers_;
+  ProofSourceFactory proof_source_factory_;
+  const QuicConfig config_;
+  const QuicCryptoServerConfig::ConfigOptions crypto_config_options_;
+  const QuicVersionVector supported_versions_;
+  QuicHttpResponseCache* response_cache_;  // unowned.
+
+  // The server config loaded into every worker.  Only read once the workers
+  // are started.
+  std::vector<std::unique_ptr<QuicServerConfigProtobuf>> server_configs_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  bool connection_id_steering_;
+
+  size_t packet_reader_batch_size_;
+  size_t packet_writer_batch_size_;
+  bool packet_writer_use_gso_;
+
+  // The port the workers are listening on.
+  int port_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicMultiThreadedServer);
+};
+
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
@@ -0,0 +1,63 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_multi_threaded_server.h"
+
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base/bind.h"
+#include "net/quic/platform/api/quic_socket_address.h"
+#include "net/quic/test_tools/crypto_test_utils.h"
+#include "net/tools/quic/quic_http_response_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+class QuicMultiThreadedServerTest : public ::testing::Test {
+ public:
+  QuicMultiThreadedServerTest()
+      : server_(4,
+                base::Bind(&crypto_test_utils::ProofSourceForTesting),
+                QuicConfig(),
+                QuicCryptoServerConfig::ConfigOptions(),
+                AllSupportedVersions(),
+                &response_cache_) {}
+
+ protected:
+  QuicHttpResponseCache response_cache_;
+  QuicMultiThreadedServer server_;
+};
+
+TEST_F(QuicMultiThreadedServerTest, ListenAndShutdown) {
+  ASSERT_TRUE(server_.CreateUDPSocketsAndListen(
+      QuicSocketAddress(QuicIpAddress::Loopback4(), 0)));
+  EXPECT_EQ(4u, server_.num_workers());
+  EXPECT_NE(0, server_.port());
+  server_.Shutdown();
+}
+
+TEST_F(QuicMultiThreadedServerTest, PortInUseByPlainSocket) {
+  // A socket without SO_REUSEPORT on the port keeps the workers from joining.
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  ASSERT_LT(0, fd);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  QuicSocketAddress bound_address;
+  ASSERT_EQ(0, bound_address.FromSocket(fd));
+
+  EXPECT_FALSE(server_.CreateUDPSocketsAndListen(bound_address));
+  close(fd);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
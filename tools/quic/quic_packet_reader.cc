@@ -11,6 +11,8 @@
 #endif
 #include <string.h>
 
+#include <algorithm>
+
 #include "net/quic/core/quic_flags.h"
 #include "net/quic/platform/api/quic_bug_tracker.h"
 #include "net/quic/platform/api/quic_logging.h"
@@ -25,22 +27,43 @@
 
 namespace net {
 
+QuicPacketReader::Stats::Stats()
+    : read_calls(0), packets_read(0), full_batches(0), packets_dropped(0) {}
+
+double QuicPacketReader::Stats::PacketsPerReadCall() const {
+  if (read_calls == 0) {
+    return 0;
+  }
+  return static_cast<double>(packets_read) / read_calls;
+}
+
+QuicPacketReader::QuicPacketReader() : QuicPacketReader(1) {}
 
-QuicPacketReader::QuicPacketReader() {
+QuicPacketReader::QuicPacketReader(size_t batch_size)
+    : batch_size_(std::min(std::max<size_t>(batch_size, 1),
+                           kMaxNumPacketsPerReadMmsgCall)) {
   Initialize();
 }
 
 void QuicPacketReader::Initialize() {
-#if MMSG_MORE
+#if !defined(__linux__)
+  // recvmmsg is Linux only.
+  batch_size_ = 1;
+#endif
+  if (batch_size_ == 1) {
+    return;
+  }
+
+  packets_.reset(new PacketData[batch_size_]);
+  mmsg_hdr_.reset(new mmsghdr[batch_size_]);
   // Zero initialize uninitialized memory.
-  memset(mmsg_hdr_, 0, sizeof(mmsg_hdr_));
+  memset(mmsg_hdr_.get(), 0, batch_size_ * sizeof(mmsghdr));
 
-  for (int i = 0; i < kNumPacketsPerReadMmsgCall; ++i) {
+  for (size_t i = 0; i < batch_size_; ++i) {
     packets_[i].iov.iov_base = packets_[i].buf;
     packets_[i].iov.iov_len = kMaxPacketSize;
     memset(&packets_[i].raw_address, 0, sizeof(packets_[i].raw_address));
     memset(packets_[i].cbuf, 0, sizeof(packets_[i].cbuf));
-    memset(packets_[i].buf, 0, sizeof(packets_[i].buf));
 
     msghdr* hdr = &mmsg_hdr_[i].msg_hdr;
     hdr->msg_name = &packets_[i].raw_address;
@@ -51,7 +74,6 @@ void QuicPacketReader::Initialize() {
     hdr->msg_control = packets_[i].cbuf;
     hdr->msg_controllen = QuicSocketUtils::kSpaceForCmsg;
   }
-#endif
 }
 
 QuicPacketReader::~QuicPacketReader() {}
@@ -62,13 +84,12 @@ bool QuicPacketReader::ReadAndDispatchPackets(
     const QuicClock& clock,
     ProcessPacketInterface* processor,
     QuicPacketCount* packets_dropped) {
-#if MMSG_MORE
-  return ReadAndDispatchManyPackets(fd, port, clock, processor,
-                                    packets_dropped);
-#else
+  if (batch_size_ > 1) {
+    return ReadAndDispatchManyPackets(fd, port, clock, processor,
+                                      packets_dropped);
+  }
   return ReadAndDispatchSinglePacket(fd, port, clock, processor,
                                      packets_dropped);
-#endif
 }
 
 bool QuicPacketReader::ReadAndDispatchManyPackets(
@@ -77,22 +98,33 @@ bool QuicPacketReader::ReadAndDispatchManyPackets(
     const QuicClock& clock,
     ProcessPacketInterface* processor,
     QuicPacketCount* packets_dropped) {
-#if MMSG_MORE
+#if defined(__linux__)
   // Re-set the length fields in case recvmmsg has changed them.
-  for (int i = 0; i < kNumPacketsPerReadMmsgCall; ++i) {
+  for (size_t i = 0; i < batch_size_; ++i) {
     DCHECK_EQ(kMaxPacketSize, packets_[i].iov.iov_len);
     msghdr* hdr = &mmsg_hdr_[i].msg_hdr;
     hdr->msg_namelen = sizeof(sockaddr_storage);
-    DCHECK_EQ(1, hdr->msg_iovlen);
+    DCHECK_EQ(1u, hdr->msg_iovlen);
     hdr->msg_controllen = QuicSocketUtils::kSpaceForCmsg;
   }
 
-  int packets_read =
-      recvmmsg(fd, mmsg_hdr_, kNumPacketsPerReadMmsgCall, 0, nullptr);
+  int packets_read = recvmmsg(fd, mmsg_hdr_.get(),
+                              static_cast<unsigned int>(batch_size_), 0,
+                              nullptr);
 
   if (packets_read <= 0) {
+    if (packets_read < 0 && errno == ENOSYS) {
+      QUIC_LOG(WARNING) << "recvmmsg not supported; falling back to recvmsg";
+      batch_size_ = 1;
+      return ReadAndDispatchSinglePacket(fd, port, clock, processor,
+                                         packets_dropped);
+    }
     return false;  // recvmmsg failed.
   }
+  ++stats_.read_calls;
+  if (static_cast<size_t>(packets_read) == batch_size_) {
+    ++stats_.full_batches;
+  }
 
   QuicWallTime fallback_walltimestamp = QuicWallTime::Zero();
   for (int i = 0; i < packets_read; ++i) {
@@ -134,23 +166,28 @@ bool QuicPacketReader::ReadAndDispatchManyPackets(
                               mmsg_hdr_[i].msg_len, timestamp, false, ttl,
                               has_ttl);
     QuicSocketAddress server_address(server_ip, port);
+    ++stats_.packets_read;
     processor->ProcessPacket(server_address, client_address, packet);
   }
 
-  if (packets_dropped != nullptr) {
-    QuicSocketUtils::GetOverflowFromMsghdr(&mmsg_hdr_[0].msg_hdr,
-                                           packets_dropped);
+  // The last packet carries the most recent overflow count.
+  if (QuicSocketUtils::GetOverflowFromMsghdr(
+          &mmsg_hdr_[packets_read - 1].msg_hdr, &stats_.packets_dropped) &&
+      packets_dropped != nullptr) {
+    *packets_dropped = stats_.packets_dropped;
   }
+  QUIC_DVLOG(2) << "recvmmsg returned " << packets_read << " of "
+                << batch_size_ << " packets, " << stats_.packets_dropped
+                << " dropped by the kernel so far";
 
   // We may not have read all of the packets available on the socket.
-  return packets_read == kNumPacketsPerReadMmsgCall;
+  return static_cast<size_t>(packets_read) == batch_size_;
 #else
   QUIC_LOG(FATAL) << "Unsupported";
   return false;
 #endif
 }
 
-/* static */
 bool QuicPacketReader::ReadAndDispatchSinglePacket(
     int fd,
     int port,
@@ -162,12 +199,16 @@ bool QuicPacketReader::ReadAndDispatchSinglePacket(
   QuicSocketAddress client_address;
   QuicIpAddress server_ip;
   QuicWallTime walltimestamp = QuicWallTime::Zero();
-  int bytes_read =
-      QuicSocketUtils::ReadPacket(fd, buf, arraysize(buf), packets_dropped,
-                                  &server_ip, &walltimestamp, &client_address);
+  int bytes_read = QuicSocketUtils::ReadPacket(
+      fd, buf, arraysize(buf), &stats_.packets_dropped, &server_ip,
+      &walltimestamp, &client_address);
   if (bytes_read < 0) {
     return false;  // ReadPacket failed.
   }
+  ++stats_.read_calls;
+  if (packets_dropped != nullptr) {
+    *packets_dropped = stats_.packets_dropped;
+  }
 
   if (!server_ip.IsInitialized()) {
     QUIC_BUG << "Unable to get server address.";
@@ -182,6 +223,7 @@ bool QuicPacketReader::ReadAndDispatchSinglePacket(
 
   QuicReceivedPacket packet(buf, bytes_read, timestamp, false);
   QuicSocketAddress server_address(server_ip, port);
+  ++stats_.packets_read;
   processor->ProcessPacket(server_address, client_address, packet);
 
   // The socket read was successful, so return true even if packet dispatch
@@ -189,5 +231,4 @@ bool QuicPacketReader::ReadAndDispatchSinglePacket(
   return true;
 }
 
-
 }  // namespace net
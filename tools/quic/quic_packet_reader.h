@@ -12,6 +12,11 @@
 // regardless of how the below transitive header include set may change.
 #include <sys/socket.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
 #include "base/macros.h"
 #include "net/quic/core/quic_packets.h"
 #include "net/quic/platform/api/quic_clock.h"
@@ -19,19 +24,41 @@
 #include "net/tools/quic/platform/impl/quic_socket_utils.h"
 #include "net/tools/quic/quic_process_packet_interface.h"
 
-#define MMSG_MORE 0
-
 namespace net {
 
-#if MMSG_MORE
-// Read in larger batches to minimize recvmmsg overhead.
-const int kNumPacketsPerReadMmsgCall = 16;
-#endif
+// Upper bound on the batch size, matching the kernel's UIO_MAXIOV.
+const size_t kMaxNumPacketsPerReadMmsgCall = 1024;
 
 class QuicPacketReader {
  public:
+  // Counters describing how packets were read off the socket.
+  struct Stats {
+    Stats();
+
+    // Average number of packets returned per successful read syscall.
+    double PacketsPerReadCall() const;
+
+    // Number of recvmsg/recvmmsg calls which returned at least one packet.
+    uint64_t read_calls;
+    // Number of packets dispatched to the processor.
+    uint64_t packets_read;
+    // Number of recvmmsg calls which filled the whole batch, i.e. the socket
+    // had a backlog of at least one batch.
+    uint64_t full_batches;
+    // The most recent SO_RXQ_OVFL count, the number of packets the kernel
+    // dropped because the socket's receive buffer was full.
+    QuicPacketCount packets_dropped;
+  };
+
+  // Creates a reader which issues one recvmsg per packet.
   QuicPacketReader();
 
+  // Creates a reader which reads up to |batch_size| packets per recvmmsg call
+  // on platforms which support it, and one packet per recvmsg call otherwise
+  // or if |batch_size| is 1. |batch_size| is capped at
+  // kMaxNumPacketsPerReadMmsgCall.
+  explicit QuicPacketReader(size_t batch_size);
+
   virtual ~QuicPacketReader();
 
   // Reads a number of packets from the given fd, and then passes them off to
@@ -41,38 +68,21 @@ class QuicPacketReader {
   // to track dropped packets and some packets are read.
   // If the socket has timestamping enabled, the per packet timestamps will be
   // passed to the processor. Otherwise, |clock| will be used.
+  // Packets handed to |processor| point into the reader's buffers and are
+  // only valid for the duration of the ProcessPacket call.
   virtual bool ReadAndDispatchPackets(int fd,
                                       int port,
                                       const QuicClock& clock,
                                       ProcessPacketInterface* processor,
                                       QuicPacketCount* packets_dropped);
 
- private:
-  // Initialize the internal state of the reader.
-  void Initialize();
-
-  // Reads and dispatches many packets using recvmmsg.
-  bool ReadAndDispatchManyPackets(int fd,
-                                  int port,
-                                  const QuicClock& clock,
-                                  ProcessPacketInterface* processor,
-                                  QuicPacketCount* packets_dropped);
-
-  // Reads and dispatches a single packet using recvmsg.
-  static bool ReadAndDispatchSinglePacket(int fd,
-                                          int port,
-                                          const QuicClock& clock,
-                                          ProcessPacketInterface* processor,
-                                          QuicPacketCount* packets_dropped);
-
-  // Storage only used when recvmmsg is available.
+  // Returns the number of packets read per syscall, 1 if recvmmsg is not used.
+  size_t batch_size() const { return batch_size_; }
 
-#if MMSG_MORE
-  // TODO(danzh): change it to be a pointer to avoid the allocation on the stack
-  // from exceeding maximum allowed frame size.
-  // packets_ and mmsg_hdr_ are used to supply cbuf and buf to the recvmmsg
-  // call.
+  const Stats& stats() const { return stats_; }
 
+ private:
+  // The storage for a single packet in a recvmmsg batch.
   struct PacketData {
     iovec iov;
     // raw_address is used for address information provided by the recvmmsg
@@ -83,9 +93,34 @@ class QuicPacketReader {
     // buf is used for the data read from the kernel on recvmmsg.
     char buf[kMaxPacketSize];
   };
-  PacketData packets_[kNumPacketsPerReadMmsgCall];
-  mmsghdr mmsg_hdr_[kNumPacketsPerReadMmsgCall];
-#endif
+
+  // Initialize the internal state of the reader.
+  void Initialize();
+
+  // Reads and dispatches many packets using recvmmsg.
+  bool ReadAndDispatchManyPackets(int fd,
+                                  int port,
+                                  const QuicClock& clock,
+                                  ProcessPacketInterface* processor,
+                                  QuicPacketCount* packets_dropped);
+
+  // Reads and dispatches a single packet using recvmsg.
+  bool ReadAndDispatchSinglePacket(int fd,
+                                   int port,
+                                   const QuicClock& clock,
+                                   ProcessPacketInterface* processor,
+                                   QuicPacketCount* packets_dropped);
+
+  // Number of packets read per recvmmsg call.  1 selects recvmsg.
+  size_t batch_size_;
+
+  // Storage only used when recvmmsg is used.  packets_ and mmsg_hdr_ supply
+  // cbuf and buf to the recvmmsg call.  They are allocated once, on the heap,
+  // and the buffers are handed to the processor in place.
+  std::unique_ptr<PacketData[]> packets_;
+  std::unique_ptr<mmsghdr[]> mmsg_hdr_;
+
+  Stats stats_;
 
   DISALLOW_COPY_AND_ASSIGN(QuicPacketReader);
 };
@@ -0,0 +1,134 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_packet_reader.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "net/quic/platform/api/quic_socket_address.h"
+#include "net/quic/platform/impl/quic_chromium_clock.h"
+#include "net/tools/quic/platform/impl/quic_socket_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+// Records every packet it is handed.
+class RecordingProcessor : public ProcessPacketInterface {
+ public:
+  void ProcessPacket(const QuicSocketAddress& server_address,
+                     const QuicSocketAddress& client_address,
+                     const QuicReceivedPacket& packet) override {
+    packets_.push_back(std::string(packet.data(), packet.length()));
+    client_address_ = client_address;
+  }
+
+  const std::vector<std::string>& packets() const { return packets_; }
+  const QuicSocketAddress& client_address() const { return client_address_; }
+
+ private:
+  std::vector<std::string> packets_;
+  QuicSocketAddress client_address_;
+};
+
+class QuicPacketReaderTest : public ::testing::Test {
+ protected:
+  QuicPacketReaderTest() : server_fd_(-1), client_fd_(-1) {}
+
+  ~QuicPacketReaderTest() override {
+    if (server_fd_ >= 0) {
+      close(server_fd_);
+    }
+    if (client_fd_ >= 0) {
+      close(client_fd_);
+    }
+  }
+
+  void SetUp() override {
+    bool overflow_supported = false;
+    server_address_ = QuicSocketAddress(QuicIpAddress::Loopback4(), 0);
+    server_fd_ =
+        QuicSocketUtils::CreateUDPSocket(server_address_, &overflow_supported);
+    ASSERT_LE(0, server_fd_);
+    sockaddr_storage addr = server_address_.generic_address();
+    ASSERT_EQ(0, bind(server_fd_, reinterpret_cast<sockaddr*>(&addr),
+                      sizeof(sockaddr_in)));
+    ASSERT_EQ(0, server_address_.FromSocket(server_fd_));
+
+    client_fd_ = QuicSocketUtils::CreateUDPSocket(
+        QuicSocketAddress(QuicIpAddress::Loopback4(), 0), &overflow_supported);
+    ASSERT_LE(0, client_fd_);
+  }
+
+  void SendPackets(int count) {
+    for (int i = 0; i < count; ++i) {
+      std::string payload = "packet " + std::to_string(i);
+      WriteResult result = QuicSocketUtils::WritePacket(
+          client_fd_, payload.data(), payload.size(), QuicIpAddress(),
+          server_address_);
+      ASSERT_EQ(WRITE_STATUS_OK, result.status);
+    }
+  }
+
+  // Reads until the socket is drained.
+  void ReadAll(QuicPacketReader* reader) {
+    while (reader->ReadAndDispatchPackets(server_fd_, server_address_.port(),
+                                          clock_, &processor_, nullptr)) {
+    }
+  }
+
+  QuicChromiumClock clock_;
+  QuicSocketAddress server_address_;
+  int server_fd_;
+  int client_fd_;
+  RecordingProcessor processor_;
+};
+
+TEST_F(QuicPacketReaderTest, SinglePacketReads) {
+  QuicPacketReader reader;
+  EXPECT_EQ(1u, reader.batch_size());
+  SendPackets(5);
+  ReadAll(&reader);
+
+  ASSERT_EQ(5u, processor_.packets().size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ("packet " + std::to_string(i), processor_.packets()[i]);
+  }
+  EXPECT_EQ(5u, reader.stats().read_calls);
+  EXPECT_EQ(5u, reader.stats().packets_read);
+  EXPECT_EQ(0u, reader.stats().full_batches);
+}
+
+TEST_F(QuicPacketReaderTest, BatchedReads) {
+  QuicPacketReader reader(4);
+  ASSERT_EQ(4u, reader.batch_size());
+  SendPackets(10);
+  ReadAll(&reader);
+
+  ASSERT_EQ(10u, processor_.packets().size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ("packet " + std::to_string(i), processor_.packets()[i]);
+  }
+  EXPECT_TRUE(processor_.client_address().IsInitialized());
+  // Two full batches and one partial one.
+  EXPECT_EQ(3u, reader.stats().read_calls);
+  EXPECT_EQ(2u, reader.stats().full_batches);
+  EXPECT_EQ(10u, reader.stats().packets_read);
+  EXPECT_DOUBLE_EQ(10.0 / 3, reader.stats().PacketsPerReadCall());
+}
+
+TEST_F(QuicPacketReaderTest, BatchSizeIsCapped) {
+  QuicPacketReader reader(kMaxNumPacketsPerReadMmsgCall + 1);
+  EXPECT_EQ(kMaxNumPacketsPerReadMmsgCall, reader.batch_size());
+  QuicPacketReader zero_reader(0);
+  EXPECT_EQ(1u, zero_reader.batch_size());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
@@ -39,6 +39,14 @@ QuicByteCount QuicPacketWriterWrapper::GetMaxPacketSize(
   return writer_->GetMaxPacketSize(peer_address);
 }
 
+bool QuicPacketWriterWrapper::IsBatchMode() const {
+  return writer_->IsBatchMode();
+}
+
+WriteResult QuicPacketWriterWrapper::Flush() {
+  return writer_->Flush();
+}
+
 void QuicPacketWriterWrapper::set_writer(QuicPacketWriter* writer) {
   writer_.reset(writer);
 }
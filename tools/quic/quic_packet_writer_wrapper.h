@@ -34,6 +34,8 @@ class QuicPacketWriterWrapper : public QuicPacketWriter {
   void SetWritable() override;
   QuicByteCount GetMaxPacketSize(
       const QuicSocketAddress& peer_address) const override;
+  bool IsBatchMode() const override;
+  WriteResult Flush() override;
 
   // Takes ownership of |writer|.
   void set_writer(QuicPacketWriter* writer);
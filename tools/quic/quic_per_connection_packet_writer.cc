@@ -8,9 +8,11 @@ namespace net {
 
 QuicPerConnectionPacketWriter::QuicPerConnectionPacketWriter(
     QuicPacketWriter* shared_writer)
-    : shared_writer_(shared_writer) {}
+    : shared_writer_(shared_writer), dropped_packet_error_(0) {}
 
-QuicPerConnectionPacketWriter::~QuicPerConnectionPacketWriter() {}
+QuicPerConnectionPacketWriter::~QuicPerConnectionPacketWriter() {
+  shared_writer_->RemoveSender(this);
+}
 
 WriteResult QuicPerConnectionPacketWriter::WritePacket(
     const char* buffer,
@@ -18,8 +20,8 @@ WriteResult QuicPerConnectionPacketWriter::WritePacket(
     const QuicIpAddress& self_address,
     const QuicSocketAddress& peer_address,
     PerPacketOptions* options) {
-  return shared_writer_->WritePacket(buffer, buf_len, self_address,
-                                     peer_address, options);
+  return shared_writer_->WritePacketForSender(
+      buffer, buf_len, self_address, peer_address, options, this);
 }
 
 bool QuicPerConnectionPacketWriter::IsWriteBlockedDataBuffered() const {
@@ -39,4 +41,33 @@ QuicByteCount QuicPerConnectionPacketWriter::GetMaxPacketSize(
   return shared_writer_->GetMaxPacketSize(peer_address);
 }
 
+bool QuicPerConnectionPacketWriter::IsBatchMode() const {
+  return shared_writer_->IsBatchMode();
+}
+
+WriteResult QuicPerConnectionPacketWriter::Flush() {
+  WriteResult result = shared_writer_->Flush();
+  if (dropped_packet_error_ != 0) {
+    int error_code = dropped_packet_error_;
+    dropped_packet_error_ = 0;
+    return WriteResult(WRITE_STATUS_ERROR, error_code);
+  }
+  if (result.status == WRITE_STATUS_ERROR) {
+    // The dropped packet was not written through this writer.
+    return WriteResult(WRITE_STATUS_OK, 0);
+  }
+  return result;
+}
+
+char* QuicPerConnectionPacketWriter::GetNextWriteLocation() {
+  return shared_writer_->GetNextWriteLocation();
+}
+
+void QuicPerConnectionPacketWriter::OnBufferedPacketDropped(int error_code) {
+  // Keep the first error for the next Flush to report.
+  if (dropped_packet_error_ == 0) {
+    dropped_packet_error_ = error_code;
+  }
+}
+
 }  // namespace net
@@ -13,7 +13,10 @@
 
 namespace net {
 
-// A connection-specific packet writer that wraps a shared writer.
+// A connection-specific packet writer that wraps a shared writer.  Packets
+// written through it are attributed to it, so a batch mode shared writer
+// which drops one of them at flush time reports the error here; it is then
+// returned from this writer's next Flush, to the connection it belongs to.
 class QuicPerConnectionPacketWriter : public QuicPacketWriter {
  public:
   // Does not take ownership of |shared_writer|.
@@ -32,10 +35,17 @@ class QuicPerConnectionPacketWriter : public QuicPacketWriter {
   void SetWritable() override;
   QuicByteCount GetMaxPacketSize(
       const QuicSocketAddress& peer_address) const override;
+  bool IsBatchMode() const override;
+  WriteResult Flush() override;
+  char* GetNextWriteLocation() override;
+  void OnBufferedPacketDropped(int error_code) override;
 
  private:
   QuicPacketWriter* shared_writer_;  // Not owned.
 
+  // The error a packet written through this writer was dropped with, or 0.
+  int dropped_packet_error_;
+
   DISALLOW_COPY_AND_ASSIGN(QuicPerConnectionPacketWriter);
 };
 
@@ -21,6 +21,7 @@
 #include "net/quic/platform/api/quic_logging.h"
 #include "net/tools/quic/platform/impl/quic_epoll_clock.h"
 #include "net/tools/quic/platform/impl/quic_socket_utils.h"
+#include "net/tools/quic/quic_batch_packet_writer.h"
 #include "net/tools/quic/quic_dispatcher.h"
 #include "net/tools/quic/quic_epoll_alarm_factory.h"
 #include "net/tools/quic/quic_epoll_connection_helper.h"
@@ -68,6 +69,10 @@ QuicServer::QuicServer(
       packets_dropped_(0),
       overflow_supported_(false),
       silent_close_(false),
+      reuse_port_(false),
+      writer_batch_size_(1),
+      writer_use_gso_(false),
+      batch_writer_(nullptr),
       config_(config),
       crypto_config_(kSourceAddressTokenSecret,
                      QuicRandom::GetInstance(),
@@ -116,6 +121,10 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
     return false;
   }
 
+  if (reuse_port_ && !QuicSocketUtils::SetReusePort(fd_)) {
+    return false;
+  }
+
   sockaddr_storage addr = address.generic_address();
   int rc = bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
   if (rc < 0) {
@@ -140,7 +149,32 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
   return true;
 }
 
+bool QuicServer::SetServerConfigs(
+    const std::vector<std::unique_ptr<QuicServerConfigProtobuf>>& configs) {
+  QuicEpollClock clock(&epoll_server_);
+  return crypto_config_.SetConfigs(configs, clock.WallNow());
+}
+
+void QuicServer::SetPacketReaderBatchSize(size_t batch_size) {
+  packet_reader_.reset(new QuicPacketReader(batch_size));
+}
+
+const QuicPacketReader& QuicServer::packet_reader() const {
+  return *packet_reader_;
+}
+
+void QuicServer::SetPacketWriterBatchSize(size_t batch_size, bool use_gso) {
+  DCHECK(dispatcher_ == nullptr);
+  writer_batch_size_ = batch_size;
+  writer_use_gso_ = use_gso;
+}
+
 QuicDefaultPacketWriter* QuicServer::CreateWriter(int fd) {
+  if (writer_batch_size_ > 1) {
+    batch_writer_ =
+        new QuicBatchPacketWriter(fd, writer_batch_size_, writer_use_gso_);
+    return batch_writer_;
+  }
   return new QuicDefaultPacketWriter(fd);
 }
 
@@ -168,6 +202,11 @@ void QuicServer::Shutdown() {
     dispatcher_->Shutdown();
   }
 
+  if (batch_writer_ != nullptr) {
+    // Send the connection closes before the socket goes away.
+    batch_writer_->Flush();
+  }
+
   close(fd_);
   fd_ = -1;
 }
@@ -183,6 +222,12 @@ void QuicServer::OnEvent(int fd, EpollEvent* event) {
       dispatcher_->ProcessBufferedChlos(kNumSessionsToCreatePerSocketEvent);
     }
 
+    // Let packets written in response to this batch of reads share syscalls
+    // across connections.
+    if (batch_writer_ != nullptr) {
+      batch_writer_->DeferFlushes();
+    }
+
     bool more_to_read = true;
     while (more_to_read) {
       more_to_read = packet_reader_->ReadAndDispatchPackets(
@@ -190,6 +235,20 @@ void QuicServer::OnEvent(int fd, EpollEvent* event) {
           overflow_supported_ ? &packets_dropped_ : nullptr);
     }
 
+    if (batch_writer_ != nullptr) {
+      WriteResult result = batch_writer_->FinishDeferredFlushes();
+      if (result.status == WRITE_STATUS_BLOCKED) {
+        // The remaining packets are sent on EPOLLOUT, and the connections
+        // which have more to send resume after them.
+        dispatcher_->OnSharedWriterBlocked();
+      } else if (result.status == WRITE_STATUS_ERROR) {
+        // Connections are told about their own dropped packets; this one
+        // had no connection to tell, such as a time wait list reply.
+        QUIC_LOG_FIRST_N(ERROR, 10) << "Deferred flush dropped a packet: "
+                                    << strerror(result.error_code);
+      }
+    }
+
     if (FLAGS_quic_reloadable_flag_quic_limit_num_new_sessions_per_epoll_loop &&
         dispatcher_->HasChlosBuffered()) {
       // Register EPOLLIN event to consume buffered CHLO(s).
@@ -12,9 +12,11 @@
 #define NET_TOOLS_QUIC_QUIC_SERVER_H_
 
 #include <memory>
+#include <vector>
 
 #include "base/macros.h"
 #include "net/quic/chromium/quic_chromium_connection_helper.h"
+#include "net/quic/core/crypto/crypto_server_config_protobuf.h"
 #include "net/quic/core/crypto/quic_crypto_server_config.h"
 #include "net/quic/core/quic_config.h"
 #include "net/quic/core/quic_framer.h"
@@ -30,6 +32,7 @@ namespace test {
 class QuicServerPeer;
 }  // namespace test
 
+class QuicBatchPacketWriter;
 class QuicDispatcher;
 class QuicPacketReader;
 
@@ -48,6 +51,12 @@ class QuicServer : public EpollCallbackInterface {
   // Start listening on the specified address.
   bool CreateUDPSocketAndListen(const QuicSocketAddress& address);
 
+  // Replaces the server config generated at construction with |configs|, so
+  // that several servers can hand out the same SCFG.  Returns false if any of
+  // the configs fails to parse, in which case the old config is kept.
+  bool SetServerConfigs(
+      const std::vector<std::unique_ptr<QuicServerConfigProtobuf>>& configs);
+
   // Wait up to 50ms, and handle any events which occur.
   void WaitForEvents();
 
@@ -72,6 +81,25 @@ class QuicServer : public EpollCallbackInterface {
 
   int port() { return port_; }
 
+  int fd() { return fd_; }
+
+  // If true, the listening socket is created with SO_REUSEPORT so that other
+  // servers may listen on the same address.  Must be set before calling
+  // CreateUDPSocketAndListen.
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+
+  // Reads up to |batch_size| packets per recvmmsg call instead of one packet
+  // per recvmsg call.  A |batch_size| of 1 restores the default.
+  void SetPacketReaderBatchSize(size_t batch_size);
+
+  const QuicPacketReader& packet_reader() const;
+
+  // Makes the dispatcher's writer hold up to |batch_size| packets and send
+  // them together with sendmmsg, or with UDP GSO if |use_gso| is true.
+  // Packets written while handling one EPOLLIN event are sent together.  Must
+  // be called before CreateUDPSocketAndListen.
+  void SetPacketWriterBatchSize(size_t batch_size, bool use_gso);
+
  protected:
   virtual QuicDefaultPacketWriter* CreateWriter(int fd);
 
@@ -119,6 +147,16 @@ class QuicServer : public EpollCallbackInterface {
   // without sending a final connection close.
   bool silent_close_;
 
+  // If true, set SO_REUSEPORT on the listening socket.
+  bool reuse_port_;
+
+  // Number of packets the writer batches; 1 disables batching.
+  size_t writer_batch_size_;
+  // If true, the batching writer sends with UDP GSO where possible.
+  bool writer_use_gso_;
+  // The dispatcher's writer, if it batches.  Owned by the dispatcher.
+  QuicBatchPacketWriter* batch_writer_;
+
   // config_ contains non-crypto parameters that are negotiated in the crypto
   // handshake.
   QuicConfig config_;
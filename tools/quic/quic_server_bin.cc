@@ -5,9 +5,12 @@
 // A binary wrapper for QuicServer.  It listens forever on --port
 // (default 6121) until it's killed or ctrl-cd to death.
 
+#include <unistd.h>
+
 #include <iostream>
 
 #include "base/at_exit.h"
+#include "base/bind.h"
 #include "base/command_line.h"
 #include "base/logging.h"
 #include "base/run_loop.h"
@@ -16,10 +19,19 @@
 #include "net/quic/core/quic_packets.h"
 #include "net/quic/platform/api/quic_socket_address.h"
 #include "net/tools/quic/quic_http_response_cache.h"
+#include "net/tools/quic/quic_multi_threaded_server.h"
 #include "net/tools/quic/quic_server.h"
 
 // The port the quic server will listen on.
 int32_t FLAGS_port = 6121;
+// The number of worker threads, each with its own socket and dispatcher.
+int32_t FLAGS_num_workers = 1;
+// The number of packets read per recvmmsg call.  1 reads with recvmsg.
+int32_t FLAGS_recvmmsg_batch_size = 1;
+// The number of packets sent per sendmmsg call.  1 writes with sendmsg.
+int32_t FLAGS_sendmmsg_batch_size = 1;
+// Whether batched packets to the same client are sent with UDP GSO.
+bool FLAGS_udp_gso = false;
 
 std::unique_ptr<net::ProofSource> CreateProofSource(
     const base::FilePath& cert_path,
@@ -51,7 +63,15 @@ int main(int argc, char* argv[]) {
         "--quic_response_cache_dir  directory containing response data\n"
         "                            to load\n"
         "--certificate_file=<file>   path to the certificate chain\n"
-        "--key_file=<file>           path to the pkcs8 private key\n";
+        "--key_file=<file>           path to the pkcs8 private key\n"
+        "--num_workers=<n>           number of worker threads, each with its\n"
+        "                            own SO_REUSEPORT socket (default 1)\n"
+        "--recvmmsg_batch_size=<n>   number of packets to read per recvmmsg\n"
+        "                            call (default 1, one recvmsg per packet)\n"
+        "--sendmmsg_batch_size=<n>   number of packets to send per sendmmsg\n"
+        "                            call (default 1, one sendmsg per packet)\n"
+        "--udp_gso                   send batched packets to the same client\n"
+        "                            as one UDP GSO super packet\n";
     std::cout << help_str;
     exit(0);
   }
@@ -69,6 +89,39 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (line->HasSwitch("num_workers")) {
+    if (!base::StringToInt(line->GetSwitchValueASCII("num_workers"),
+                           &FLAGS_num_workers) ||
+        FLAGS_num_workers < 1) {
+      LOG(ERROR) << "--num_workers must be a positive integer\n";
+      return 1;
+    }
+  }
+
+  if (line->HasSwitch("recvmmsg_batch_size")) {
+    if (!base::StringToInt(line->GetSwitchValueASCII("recvmmsg_batch_size"),
+                           &FLAGS_recvmmsg_batch_size) ||
+        FLAGS_recvmmsg_batch_size < 1) {
+      LOG(ERROR) << "--recvmmsg_batch_size must be a positive integer\n";
+      return 1;
+    }
+  }
+
+  if (line->HasSwitch("sendmmsg_batch_size")) {
+    if (!base::StringToInt(line->GetSwitchValueASCII("sendmmsg_batch_size"),
+                           &FLAGS_sendmmsg_batch_size) ||
+        FLAGS_sendmmsg_batch_size < 1) {
+      LOG(ERROR) << "--sendmmsg_batch_size must be a positive integer\n";
+      return 1;
+    }
+  }
+
+  FLAGS_udp_gso = line->HasSwitch("udp_gso");
+  if (FLAGS_udp_gso && FLAGS_sendmmsg_batch_size < 2) {
+    LOG(ERROR) << "--udp_gso requires --sendmmsg_batch_size of at least 2\n";
+    return 1;
+  }
+
   if (!line->HasSwitch("certificate_file")) {
     LOG(ERROR) << "missing --certificate_file";
     return 1;
@@ -80,11 +133,34 @@ int main(int argc, char* argv[]) {
   }
 
   net::QuicConfig config;
+  if (FLAGS_num_workers > 1) {
+    net::QuicMultiThreadedServer server(
+        FLAGS_num_workers,
+        base::Bind(&CreateProofSource,
+                   line->GetSwitchValuePath("certificate_file"),
+                   line->GetSwitchValuePath("key_file")),
+        config, net::QuicCryptoServerConfig::ConfigOptions(),
+        net::AllSupportedVersions(), &response_cache);
+    server.set_packet_reader_batch_size(FLAGS_recvmmsg_batch_size);
+    server.set_packet_writer_batch_size(FLAGS_sendmmsg_batch_size,
+                                        FLAGS_udp_gso);
+    if (!server.CreateUDPSocketsAndListen(
+            net::QuicSocketAddress(net::QuicIpAddress::Any6(), FLAGS_port))) {
+      return 1;
+    }
+    // The workers serve until the process is killed.
+    while (1) {
+      pause();
+    }
+  }
+
   net::QuicServer server(
       CreateProofSource(line->GetSwitchValuePath("certificate_file"),
                         line->GetSwitchValuePath("key_file")),
       config, net::QuicCryptoServerConfig::ConfigOptions(),
       net::AllSupportedVersions(), &response_cache);
+  server.SetPacketReaderBatchSize(FLAGS_recvmmsg_batch_size);
+  server.SetPacketWriterBatchSize(FLAGS_sendmmsg_batch_size, FLAGS_udp_gso);
 
   int rc = server.CreateUDPSocketAndListen(
       net::QuicSocketAddress(net::QuicIpAddress::Any6(), FLAGS_port));
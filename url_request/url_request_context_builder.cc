@@ -27,6 +27,7 @@
 #include "net/cert/ct_verifier.h"
 #include "net/cert/multi_log_ct_verifier.h"
 #include "net/cookies/cookie_monster.h"
+#include "net/dns/host_cache_persister.h"
 #include "net/dns/host_resolver.h"
 #include "net/http/http_auth_handler_factory.h"
 #include "net/http/http_cache.h"
@@ -62,6 +63,9 @@ namespace net {
 
 namespace {
 
+// How often the HostCache is saved when it is persisted.
+const int kHostCacheWriteIntervalSeconds = 60;
+
 class BasicNetworkDelegate : public NetworkDelegateImpl {
  public:
   BasicNetworkDelegate() {}
@@ -162,6 +166,11 @@ class ContainerURLRequestContext : public URLRequestContext {
     transport_security_persister_ = std::move(transport_security_persister);
   }
 
+  void set_host_cache_persister(
+      std::unique_ptr<HostCachePersister> host_cache_persister) {
+    host_cache_persister_ = std::move(host_cache_persister);
+  }
+
  private:
   // The thread should be torn down last.
   std::unique_ptr<base::Thread> file_thread_;
@@ -169,6 +178,8 @@ class ContainerURLRequestContext : public URLRequestContext {
 
   URLRequestContextStorage storage_;
   std::unique_ptr<TransportSecurityPersister> transport_security_persister_;
+  // Must be destroyed before |storage_|, which owns the HostCache.
+  std::unique_ptr<HostCachePersister> host_cache_persister_;
 
   DISALLOW_COPY_AND_ASSIGN(ContainerURLRequestContext);
 };
@@ -323,6 +334,13 @@ std::unique_ptr<URLRequestContext> URLRequestContextBuilder::Build() {
     host_resolver_ = HostResolver::CreateDefaultResolver(context->net_log());
   }
   storage->set_host_resolver(std::move(host_resolver_));
+  if (!host_cache_persister_path_.empty() &&
+      context->host_resolver()->GetHostCache()) {
+    context->set_host_cache_persister(base::MakeUnique<HostCachePersister>(
+        context->host_resolver()->GetHostCache(), host_cache_persister_path_,
+        context->GetFileTaskRunner(),
+        base::TimeDelta::FromSeconds(kHostCacheWriteIntervalSeconds)));
+  }
 
   if (!proxy_service_) {
     // TODO(willchan): Switch to using this code when
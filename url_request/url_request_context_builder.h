@@ -212,6 +212,14 @@ class NET_EXPORT URLRequestContextBuilder {
     transport_security_persister_path_ = transport_security_persister_path;
   }
 
+  // If set, the contents of the HostCache of the context's HostResolver are
+  // saved to this file, and restored from it when the next context is built.
+  // Has no effect if the HostResolver has no HostCache.
+  void set_host_cache_persister_path(
+      const base::FilePath& host_cache_persister_path) {
+    host_cache_persister_path_ = host_cache_persister_path;
+  }
+
   void SetSpdyAndQuicEnabled(bool spdy_enabled,
                              bool quic_enabled);
 
@@ -348,6 +356,7 @@ class NET_EXPORT URLRequestContextBuilder {
   HttpCacheParams http_cache_params_;
   HttpNetworkSessionParams http_network_session_params_;
   base::FilePath transport_security_persister_path_;
+  base::FilePath host_cache_persister_path_;
   NetLog* net_log_;
   std::unique_ptr<HostResolver> host_resolver_;
   std::unique_ptr<ChannelIDService> channel_id_service_;
@@ -6,12 +6,21 @@
 
 #include <memory>
 
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/memory/ptr_util.h"
 #include "base/message_loop/message_loop.h"
 #include "base/run_loop.h"
 #include "base/test/scoped_task_scheduler.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
 #include "build/build_config.h"
+#include "net/base/address_list.h"
+#include "net/base/net_errors.h"
 #include "net/base/request_priority.h"
+#include "net/dns/host_cache.h"
+#include "net/dns/host_resolver.h"
 #include "net/http/http_auth_challenge_tokenizer.h"
 #include "net/http/http_auth_handler.h"
 #include "net/http/http_auth_handler_factory.h"
@@ -147,6 +156,40 @@ TEST_F(URLRequestContextBuilderTest, CustomHttpAuthHandlerFactory) {
                 NetLogWithSource(), &handler));
 }
 
+// The HostCache of one context is restored into the next one built with the
+// same persister path, as stale entries.
+TEST_F(URLRequestContextBuilderTest, PersistsHostCache) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath path = temp_dir.GetPath().AppendASCII("HostCache");
+  const HostCache::Key key("foobar.com", ADDRESS_FAMILY_UNSPECIFIED, 0);
+
+  builder_.SetFileTaskRunner(base::ThreadTaskRunnerHandle::Get());
+  builder_.set_host_cache_persister_path(path);
+  std::unique_ptr<URLRequestContext> context(builder_.Build());
+  base::RunLoop().RunUntilIdle();
+  HostCache* cache = context->host_resolver()->GetHostCache();
+  ASSERT_TRUE(cache);
+  cache->Set(key, HostCache::Entry(OK, AddressList()), base::TimeTicks::Now(),
+             base::TimeDelta::FromMinutes(5));
+  context.reset();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(base::PathExists(path));
+
+  URLRequestContextBuilder builder;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  builder.set_proxy_config_service(
+      base::MakeUnique<ProxyConfigServiceFixed>(ProxyConfig::CreateDirect()));
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+  builder.SetFileTaskRunner(base::ThreadTaskRunnerHandle::Get());
+  builder.set_host_cache_persister_path(path);
+  context = builder.Build();
+  base::RunLoop().RunUntilIdle();
+  cache = context->host_resolver()->GetHostCache();
+  ASSERT_TRUE(cache);
+  EXPECT_TRUE(cache->LookupStale(key, base::TimeTicks::Now(), nullptr));
+}
+
 }  // namespace
 
 }  // namespace net